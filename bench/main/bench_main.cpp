@@ -0,0 +1,75 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "fast_boot/fast_boot.hpp"
+#include "nvs_flash.h"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+static const char *TAG = "bench";
+
+/* The subsystems production firmware brings up on every wake, initialized
+ * through fast_boot so the report starts with a measured boot timeline. */
+static esp_err_t init_nvs(void *)
+{
+    esp_err_t err = nvs_flash_init();
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        err = nvs_flash_init();
+    }
+    return err;
+}
+
+static esp_err_t init_event_loop(void *)
+{
+    return esp_event_loop_create_default();
+}
+
+static esp_err_t init_netif(void *)
+{
+    return esp_netif_init();
+}
+
+static fast_boot::Subsystem nvs{"nvs", init_nvs};
+static fast_boot::Subsystem event_loop{"event_loop", init_event_loop};
+static fast_boot::Subsystem netif{"netif", init_netif, nullptr, event_loop};
+static fast_boot::Subsystem network{"network", nullptr, nullptr, nvs, netif};
+
+#if CONFIG_FREERTOS_UNICORE
+#define BENCH_CORE 0
+#else
+#define BENCH_CORE CONFIG_PERF_BENCH_PIN_CORE
+#endif
+
+static void bench_task(void *arg)
+{
+    auto *done = static_cast<TaskHandle_t>(arg);
+    esp_err_t err = perf_bench::run_all(perf_bench::default_config());
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "some benchmarks failed: %s", esp_err_to_name(err));
+    }
+    xTaskNotifyGive(done);
+    vTaskDelete(nullptr);
+}
+
+extern "C" void app_main(void)
+{
+    fast_boot::mark("app_main");
+    esp_err_t err = network.require();
+    fast_boot::mark("network ready");
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "boot subsystems failed: %s", esp_err_to_name(err));
+    }
+    fast_boot::print_timeline();
+
+    /* Give the console a moment so the report is not interleaved with boot logs. */
+    vTaskDelay(pdMS_TO_TICKS(200));
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xTaskCreatePinnedToCore(bench_task, "bench", 8192, self, 5, nullptr, BENCH_CORE);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    ESP_LOGI(TAG, "done");
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "asset_store/format.hpp"
+#include "esp_err.h"
+#include "esp_partition.h"
+
+namespace asset_store {
+
+/**
+ * @brief View of one asset inside the mapped bundle.
+ *
+ * Both views point straight into the flash cache mapping and stay valid until
+ * Bundle::deinit(). A default-constructed Asset (lookup miss) is empty and
+ * tests false.
+ */
+struct Asset {
+    std::string_view name;
+    std::span<const uint8_t> data;
+    uint32_t crc = 0;
+
+    explicit operator bool() const { return data.data() != nullptr; }
+
+    /**
+     * @brief The data as text.
+     *
+     * Every asset is followed by a NUL byte in the bundle, so text().data()
+     * is also a valid C string, and PEM certificates can be handed to
+     * mbedTLS / esp_tls as (data().data(), size() + 1) without a copy.
+     */
+    std::string_view text() const { return {reinterpret_cast<const char *>(data.data()), data.size()}; }
+};
+
+/**
+ * @brief Read-only asset bundle mapped from a data partition.
+ *
+ * init() reads the bundle header, maps exactly the bundle's bytes with
+ * esp_partition_mmap() and validates the index; lookups are a binary search
+ * over the sorted entry table and return views into the mapping. Nothing is
+ * copied into RAM, so boot cost no longer scales with asset size and the
+ * only DRAM used is this object.
+ *
+ * Reads go through the flash cache: the first touch of each 64 KiB MMU page
+ * (32 KiB cache line set on ESP32) costs a cache miss, after which access is
+ * at cache speed. Data must not be used from ISRs that run while the cache is
+ * disabled (flash writes, OTA); copy what such code needs.
+ */
+class Bundle {
+public:
+    struct Config {
+        const char *partition_label = "assets";
+        /** Check every asset's CRC in init(); costs one pass over the bundle. */
+        bool verify = false;
+    };
+
+    Bundle() = default;
+    ~Bundle() { deinit(); }
+
+    Bundle(const Bundle &) = delete;
+    Bundle &operator=(const Bundle &) = delete;
+
+    /**
+     * @return ESP_ERR_NOT_FOUND if the partition is missing,
+     *         ESP_ERR_INVALID_VERSION for a bundle from an incompatible tool,
+     *         ESP_ERR_INVALID_CRC / ESP_ERR_INVALID_SIZE for a corrupt bundle.
+     */
+    esp_err_t init(const Config &config);
+
+    /** Unmap the bundle; every view handed out becomes invalid. */
+    void deinit();
+
+    /** Empty Asset if @p name is not in the bundle. */
+    Asset find(std::string_view name) const;
+
+    std::span<const uint8_t> data(std::string_view name) const { return find(name).data; }
+
+    std::string_view text(std::string_view name) const { return find(name).text(); }
+
+    size_t size() const { return count_; }
+
+    /** Entry @p index in name order, for iteration. */
+    Asset at(size_t index) const;
+
+    /** Bytes of flash mapped into the address space. */
+    size_t mapped_size() const { return mapped_size_; }
+
+private:
+    std::string_view entry_name(const BundleEntry &e) const;
+    esp_err_t validate(const BundleHeader &header, bool verify);
+
+    const uint8_t *base_ = nullptr;
+    const BundleEntry *entries_ = nullptr;
+    size_t count_ = 0;
+    size_t mapped_size_ = 0;
+    esp_partition_mmap_handle_t handle_ = 0;
+};
+
+} // namespace asset_store
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+namespace asset_store {
+
+/*
+ * On-flash bundle layout, written by tools/pack_assets.py. All integers are
+ * little-endian and every offset is from the start of the bundle:
+ *
+ *   BundleHeader
+ *   BundleEntry[entry_count]        sorted by name, bytewise
+ *   name pool                       NUL-terminated names
+ *   asset data                      each at a data_alignment boundary and
+ *                                   followed by one NUL byte
+ *
+ * index_crc covers the entry table and the name pool; each entry carries the
+ * CRC-32 of its own data. Both are the zlib CRC-32 (esp_rom_crc32_le(0, ...)).
+ */
+
+constexpr uint32_t bundle_magic = 0x31425341; /* "ASB1" */
+constexpr uint16_t bundle_version = 1;
+constexpr uint32_t data_alignment = 16;
+
+struct BundleHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entry_count;
+    /** Bytes from the start of the header to the end of the last asset. */
+    uint32_t bundle_size;
+    /** Offset of the first byte after the name pool. */
+    uint32_t index_size;
+    uint32_t index_crc;
+    uint32_t reserved[3];
+};
+
+struct BundleEntry {
+    uint32_t name_offset;
+    uint32_t data_offset;
+    uint32_t size;
+    uint32_t crc;
+    uint16_t name_length;
+    uint16_t flags;
+};
+
+static_assert(sizeof(BundleHeader) == 32, "layout is shared with pack_assets.py");
+static_assert(sizeof(BundleEntry) == 20, "layout is shared with pack_assets.py");
+
+} // namespace asset_store
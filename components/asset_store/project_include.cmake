@@ -0,0 +1,39 @@
+set(ASSET_STORE_PACK_TOOL "${CMAKE_CURRENT_LIST_DIR}/../../tools/pack_assets.py")
+
+# asset_store_create_bundle(<partition> <base_dir> [FLASH_IN_PROJECT] [DEPENDS dep...])
+#
+# Pack every file under <base_dir> into an asset bundle sized for
+# <partition>. Adds a <partition>-flash target, and with FLASH_IN_PROJECT also
+# writes the bundle on `idf.py flash`. Call it from the project (or main
+# component) CMakeLists.txt after project().
+function(asset_store_create_bundle partition base_dir)
+    cmake_parse_arguments(arg "FLASH_IN_PROJECT" "" "DEPENDS" ${ARGN})
+    idf_build_get_property(python PYTHON)
+    get_filename_component(base_dir_full "${base_dir}" ABSOLUTE)
+
+    partition_table_get_partition_info(size "--partition-name ${partition}" "size")
+    partition_table_get_partition_info(offset "--partition-name ${partition}" "offset")
+    if(NOT "${size}" OR NOT "${offset}")
+        message(FATAL_ERROR "asset_store: partition '${partition}' is not in the partition table")
+    endif()
+
+    set(image "${CMAKE_BINARY_DIR}/${partition}.bin")
+    file(GLOB_RECURSE asset_files CONFIGURE_DEPENDS "${base_dir_full}/*")
+    add_custom_command(OUTPUT "${image}"
+        COMMAND ${python} "${ASSET_STORE_PACK_TOOL}" --size ${size} --output "${image}" "${base_dir_full}"
+        DEPENDS ${asset_files} ${arg_DEPENDS} "${ASSET_STORE_PACK_TOOL}"
+        COMMENT "Packing ${base_dir} into ${partition}.bin"
+        VERBATIM)
+    add_custom_target(${partition}_bin ALL DEPENDS "${image}")
+    set_property(DIRECTORY "${CMAKE_CURRENT_SOURCE_DIR}" APPEND PROPERTY ADDITIONAL_CLEAN_FILES "${image}")
+
+    idf_component_get_property(main_args esptool_py FLASH_ARGS)
+    idf_component_get_property(sub_args esptool_py FLASH_SUB_ARGS)
+    esptool_py_flash_target(${partition}-flash "${main_args}" "${sub_args}")
+    esptool_py_flash_target_image(${partition}-flash "${partition}" "${offset}" "${image}")
+    add_dependencies(${partition}-flash ${partition}_bin)
+    if(arg_FLASH_IN_PROJECT)
+        esptool_py_flash_target_image(flash "${partition}" "${offset}" "${image}")
+        add_dependencies(flash ${partition}_bin)
+    endif()
+endfunction()
@@ -0,0 +1,148 @@
+#include "asset_store/asset_store.hpp"
+
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "asset_store";
+
+namespace asset_store {
+
+esp_err_t Bundle::init(const Config &config)
+{
+    if (base_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_partition_t *partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, config.partition_label);
+    if (partition == nullptr) {
+        ESP_LOGE(TAG, "partition '%s' not found", config.partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Read the header first so only the bundle itself is mapped, not the
+     * whole (usually padded) partition. */
+    BundleHeader header;
+    esp_err_t err = esp_partition_read(partition, 0, &header, sizeof(header));
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (header.magic != bundle_magic) {
+        ESP_LOGE(TAG, "%s: no asset bundle", partition->label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (header.version != bundle_version) {
+        ESP_LOGE(TAG, "%s: bundle version %u, expected %u", partition->label, header.version, bundle_version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.bundle_size < sizeof(header) || header.bundle_size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const void *ptr = nullptr;
+    err = esp_partition_mmap(partition, 0, header.bundle_size, ESP_PARTITION_MMAP_DATA, &ptr, &handle_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap of %u bytes failed: %s", static_cast<unsigned>(header.bundle_size), esp_err_to_name(err));
+        return err;
+    }
+    base_ = static_cast<const uint8_t *>(ptr);
+    mapped_size_ = header.bundle_size;
+
+    err = validate(header, config.verify);
+    if (err != ESP_OK) {
+        deinit();
+        return err;
+    }
+    ESP_LOGI(TAG, "%s: %u assets, %u bytes mapped", partition->label, static_cast<unsigned>(count_),
+             static_cast<unsigned>(mapped_size_));
+    return ESP_OK;
+}
+
+esp_err_t Bundle::validate(const BundleHeader &header, bool verify)
+{
+    const size_t table_end = sizeof(BundleHeader) + static_cast<size_t>(header.entry_count) * sizeof(BundleEntry);
+    if (header.index_size < table_end || header.index_size > header.bundle_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    const uint8_t *index = base_ + sizeof(BundleHeader);
+    if (esp_rom_crc32_le(0, index, header.index_size - sizeof(BundleHeader)) != header.index_crc) {
+        ESP_LOGE(TAG, "index CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    entries_ = reinterpret_cast<const BundleEntry *>(index);
+    count_ = header.entry_count;
+    /* The index CRC already rules out corruption; the range checks keep a
+     * malformed bundle from producing views outside the mapping. */
+    for (size_t i = 0; i < count_; ++i) {
+        const BundleEntry &e = entries_[i];
+        if (e.name_offset < table_end || e.name_offset + e.name_length >= header.index_size ||
+            e.data_offset < header.index_size || e.data_offset >= header.bundle_size ||
+            e.data_offset % data_alignment != 0 ||
+            e.size >= header.bundle_size - e.data_offset) {
+            ESP_LOGE(TAG, "entry %u out of range", static_cast<unsigned>(i));
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (i != 0 && !(entry_name(entries_[i - 1]) < entry_name(e))) {
+            ESP_LOGE(TAG, "index not sorted at entry %u", static_cast<unsigned>(i));
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (verify && esp_rom_crc32_le(0, base_ + e.data_offset, e.size) != e.crc) {
+            ESP_LOGE(TAG, "'%.*s': CRC mismatch", static_cast<int>(e.name_length), base_ + e.name_offset);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+    return ESP_OK;
+}
+
+void Bundle::deinit()
+{
+    if (base_ != nullptr) {
+        esp_partition_munmap(handle_);
+        base_ = nullptr;
+    }
+    entries_ = nullptr;
+    count_ = 0;
+    mapped_size_ = 0;
+    handle_ = 0;
+}
+
+std::string_view Bundle::entry_name(const BundleEntry &e) const
+{
+    return {reinterpret_cast<const char *>(base_ + e.name_offset), e.name_length};
+}
+
+Asset Bundle::at(size_t index) const
+{
+    if (index >= count_) {
+        return {};
+    }
+    const BundleEntry &e = entries_[index];
+    Asset asset;
+    asset.name = entry_name(e);
+    asset.data = {base_ + e.data_offset, e.size};
+    asset.crc = e.crc;
+    return asset;
+}
+
+Asset Bundle::find(std::string_view name) const
+{
+    size_t lo = 0;
+    size_t hi = count_;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = entry_name(entries_[mid]).compare(name);
+        if (cmp == 0) {
+            return at(mid);
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return {};
+}
+
+} // namespace asset_store
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "bin_log/format.hpp"
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+/**
+ * @file
+ * Deferred binary logging.
+ *
+ *     BIN_LOGI(TAG, "rx %u bytes from %s, rssi %d", len, peer_name, rssi);
+ *
+ * The format string is never formatted on the target. Each call site owns a
+ * constexpr Site (format plus argument type codes) in flash, and the call
+ * copies that Site's address, a timestamp, the tag pointer and the raw
+ * argument values into the calling core's ring. No lock, no allocation
+ * and no UART wait; ISRs may log too. A low-priority task started by
+ * bin_log::start() drains the rings in frames to a Sink (UART, a file on
+ * flash, a socket...). tools/bin_log_decode.py turns the frames back into
+ * ESP_LOG-style text with the firmware's ELF file.
+ *
+ * Levels are esp_log's: calls above LOG_LOCAL_LEVEL compile to nothing, and
+ * set_level() filters the rest at run time. Arguments are those printf
+ * takes (integers, pointers, float/double, C strings), checked against the
+ * format by the compiler. Strings are copied, up to
+ * CONFIG_BIN_LOG_MAX_STRING bytes, because the pointer may not outlive the
+ * call. A full ring drops the record and counts it.
+ */
+
+#define BIN_LOG_INLINE __attribute__((always_inline)) inline
+
+namespace bin_log {
+
+using Sink = void (*)(void *ctx, const uint8_t *data, size_t len);
+
+struct Config {
+    /** Called on the drain task with each frame. Required. */
+    Sink sink = nullptr;
+    void *sink_ctx = nullptr;
+    /** Rings are drained this often; they must not fill up in between. */
+    uint32_t interval_ms = 20;
+    /**
+     * Largest frame, header included; a full frame is sent and the pass goes
+     * on. At least a header plus the longest record (255 words), and a
+     * multiple of 4.
+     */
+    size_t frame_size = 2048;
+    uint32_t task_stack_size = 3072;
+    UBaseType_t task_priority = 1;
+    BaseType_t task_core = tskNO_AFFINITY;
+};
+
+struct Stats {
+    uint32_t records;
+    /** Records refused because the ring of their core was full. */
+    uint32_t dropped;
+    uint32_t frames;
+    uint32_t bytes;
+};
+
+/** Start the drain task. Records logged before it starts wait in the rings. */
+esp_err_t start(const Config &config);
+
+/** Drain what is left and stop the task. */
+void stop();
+
+/** Drain the rings to the sink now, from the calling task. No-op unless started. */
+void flush();
+
+Stats stats();
+
+void set_level(esp_log_level_t level);
+esp_log_level_t level();
+
+/** Sink for a UART driver that is already installed; ctx is the uart_port_t. */
+void uart_sink(void *port, const uint8_t *data, size_t len);
+
+/** Sink for a FILE *, e.g. on SPIFFS/FATFS or stdout; ctx is the FILE *. */
+void file_sink(void *file, const uint8_t *data, size_t len);
+
+namespace detail {
+
+constexpr uint32_t ring_words = CONFIG_BIN_LOG_RING_WORDS;
+static_assert(ring_words >= 64 && (ring_words & (ring_words - 1)) == 0, "ring size must be a power of two");
+constexpr uint32_t max_string = CONFIG_BIN_LOG_MAX_STRING;
+constexpr uint32_t max_arg_words = 1 + (max_string + 3) / 4 > 2 ? 1 + (max_string + 3) / 4 : 2;
+
+/*
+ * Producers claim words with a CAS on tail and publish the record by
+ * storing its non-zero header word last. The drain task copies committed
+ * records from head, zeroes their words and advances head; a zero header
+ * means the rest of the ring is not yet written.
+ */
+struct Ring {
+    alignas(32) std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+    alignas(32) std::atomic<uint32_t> head{0};
+    alignas(32) std::atomic<uint32_t> words[ring_words];
+};
+
+extern Ring rings[portNUM_PROCESSORS];
+extern std::atomic<uint8_t> runtime_level;
+
+template <typename T>
+constexpr char type_code()
+{
+    if constexpr (std::is_same_v<T, float>) {
+        return 'f';
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return 'd';
+    } else if constexpr (std::is_same_v<T, char *> || std::is_same_v<T, const char *>) {
+        return 's';
+    } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> ||
+                         std::is_same_v<T, std::nullptr_t>) {
+        return sizeof(T) <= 4 ? 'w' : 'q';
+    } else {
+        static_assert(sizeof(T) == 0, "bin_log takes integers, pointers, floating point and C strings");
+        return '?';
+    }
+}
+
+template <typename... Args>
+struct Codes {
+    static constexpr char value[sizeof...(Args) + 1] = {type_code<Args>()..., '\0'};
+};
+
+/** Only named in decltype(), to get the decayed argument types of a call site. */
+template <typename... Args>
+Codes<std::decay_t<Args>...> codes_of(const Args &...);
+
+template <typename T>
+BIN_LOG_INLINE uint32_t string_length(const T &v)
+{
+    if constexpr (type_code<std::decay_t<T>>() == 's') {
+        /* Char arrays are never null and are not read past their end. */
+        constexpr uint32_t limit = std::is_array_v<T> && sizeof(T) < max_string ? sizeof(T) : max_string;
+        const char *s = v;
+        uint32_t n = 0;
+        if (s != nullptr) {
+            while (n < limit && s[n] != '\0') {
+                ++n;
+            }
+        }
+        return n;
+    } else {
+        return 0;
+    }
+}
+
+template <typename T>
+BIN_LOG_INLINE uint32_t words_of(uint32_t length)
+{
+    constexpr char code = type_code<std::decay_t<T>>();
+    if constexpr (code == 's') {
+        return 1 + (length + 3) / 4;
+    } else {
+        return code == 'q' || code == 'd' ? 2 : 1;
+    }
+}
+
+class Writer {
+public:
+    BIN_LOG_INLINE Writer(Ring &ring, uint32_t pos) : ring_(ring), pos_(pos) {}
+
+    BIN_LOG_INLINE void word(uint32_t w) { ring_.words[pos_++ & (ring_words - 1)].store(w, std::memory_order_relaxed); }
+
+    template <typename T>
+    BIN_LOG_INLINE void arg(const T &v, uint32_t length)
+    {
+        using U = std::decay_t<T>;
+        constexpr char code = type_code<U>();
+        if constexpr (code == 's') {
+            word(length);
+            for (uint32_t i = 0; i < length; i += 4) {
+                uint32_t w = 0;
+                memcpy(&w, v + i, length - i < 4 ? length - i : 4);
+                word(w);
+            }
+        } else if constexpr (code == 'f') {
+            uint32_t w;
+            memcpy(&w, &v, 4);
+            word(w);
+        } else if constexpr (code == 'd') {
+            double d = v;
+            uint64_t q;
+            memcpy(&q, &d, 8);
+            word(static_cast<uint32_t>(q));
+            word(static_cast<uint32_t>(q >> 32));
+        } else if constexpr (std::is_pointer_v<U> || std::is_same_v<U, std::nullptr_t>) {
+            auto q = reinterpret_cast<uintptr_t>(static_cast<const void *>(v));
+            word(static_cast<uint32_t>(q));
+            if constexpr (code == 'q') {
+                word(static_cast<uint32_t>(uint64_t{q} >> 32));
+            }
+        } else {
+            auto q = static_cast<uint64_t>(v);
+            word(static_cast<uint32_t>(q));
+            if constexpr (code == 'q') {
+                word(static_cast<uint32_t>(q >> 32));
+            }
+        }
+    }
+
+private:
+    Ring &ring_;
+    uint32_t pos_;
+};
+
+template <typename... Args>
+BIN_LOG_INLINE void write(esp_log_level_t level, const char *tag, const Site *site, const Args &...args)
+{
+    [[maybe_unused]] uint32_t lengths[sizeof...(Args) + 1];
+    uint32_t count = record_header_words;
+    size_t i = 0;
+    ((lengths[i] = string_length(args), count += words_of<Args>(lengths[i]), ++i), ...);
+    static_assert(record_header_words + sizeof...(Args) * max_arg_words <= 255, "too many arguments");
+
+    int core = esp_cpu_get_core_id();
+    Ring &ring = rings[core];
+    uint32_t pos = ring.tail.load(std::memory_order_relaxed);
+    do {
+        if (pos + count - ring.head.load(std::memory_order_acquire) > ring_words) {
+            ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!ring.tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed,
+                                              std::memory_order_relaxed));
+
+    Writer w(ring, pos + 1);
+    w.word(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(site)));
+    w.word(static_cast<uint32_t>(esp_timer_get_time()));
+    w.word(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(tag)));
+    i = 0;
+    (w.arg(args, lengths[i++]), ...);
+    uint32_t header = count | static_cast<uint32_t>(level) << 8 | static_cast<uint32_t>(core) << 11;
+    ring.words[pos & (ring_words - 1)].store(header, std::memory_order_release);
+}
+
+} // namespace detail
+
+BIN_LOG_INLINE bool enabled(esp_log_level_t level)
+{
+    return static_cast<uint8_t>(level) <= detail::runtime_level.load(std::memory_order_relaxed);
+}
+
+} // namespace bin_log
+
+/* The dead printf() call only makes the compiler check the arguments against the format. */
+#define BIN_LOG_LEVEL(level, tag, format, ...)                                                                         \
+    do {                                                                                                               \
+        if constexpr (LOG_LOCAL_LEVEL >= (level)) {                                                                    \
+            if (false) {                                                                                               \
+                (void)printf(format __VA_OPT__(, ) __VA_ARGS__);                                                       \
+            }                                                                                                          \
+            if (::bin_log::enabled(level)) {                                                                           \
+                using bin_log_codes_ = decltype(::bin_log::detail::codes_of(__VA_ARGS__));                           \
+                static constexpr ::bin_log::Site bin_log_site_{format, bin_log_codes_::value};                        \
+                ::bin_log::detail::write(level, tag, &bin_log_site_ __VA_OPT__(, ) __VA_ARGS__);                      \
+            }                                                                                                          \
+        }                                                                                                              \
+    } while (0)
+
+#define BIN_LOGE(tag, format, ...) BIN_LOG_LEVEL(ESP_LOG_ERROR, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define BIN_LOGW(tag, format, ...) BIN_LOG_LEVEL(ESP_LOG_WARN, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define BIN_LOGI(tag, format, ...) BIN_LOG_LEVEL(ESP_LOG_INFO, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define BIN_LOGD(tag, format, ...) BIN_LOG_LEVEL(ESP_LOG_DEBUG, tag, format __VA_OPT__(, ) __VA_ARGS__)
+#define BIN_LOGV(tag, format, ...) BIN_LOG_LEVEL(ESP_LOG_VERBOSE, tag, format __VA_OPT__(, ) __VA_ARGS__)
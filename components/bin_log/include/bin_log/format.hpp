@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bin_log {
+
+/*
+ * Stream layout, read by tools/bin_log_decode.py. All integers are
+ * little-endian. The drain task writes one frame per pass:
+ *
+ *   FrameHeader
+ *   records[payload_len / 4]        each a whole number of 32-bit words
+ *
+ * A record is
+ *
+ *   word 0    bits 0-7 length in words including this one, bits 8-10 the
+ *             esp_log_level_t, bit 11 the core that logged it
+ *   word 1    address of the call site's Site in the firmware image
+ *   word 2    esp_timer_get_time() of the call, low 32 bits (us)
+ *   word 3    the tag pointer, or 0
+ *   args      one group per character of Site::types:
+ *             'w' 32-bit integer or pointer       1 word
+ *             'q' 64-bit integer                  2 words, low first
+ *             'f' float                           1 word
+ *             'd' double                          2 words, low first
+ *             's' string                          1 word byte count n, then
+ *                                                 n bytes padded to a word
+ *
+ * Formats, type strings and tags are never sent: the decoder looks the
+ * addresses up in the ELF file of the running firmware, whose SHA-256 starts
+ * with FrameHeader::elf_sha256. Timestamps are unwrapped against the frame's
+ * 64-bit time_us, which is later than every record in the frame.
+ *
+ * crc is the zlib CRC-32 of the header up to that field followed by the
+ * records; a reader that loses sync scans for the next magic.
+ */
+
+constexpr uint32_t frame_magic = 0x31474c42; /* "BLG1" */
+constexpr uint16_t frame_version = 1;
+
+struct FrameHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t time_us;
+    uint32_t payload_len;
+    /** Records refused because a ring was full, since the previous frame. */
+    uint32_t dropped;
+    uint8_t elf_sha256[4];
+    uint32_t crc;
+};
+
+static_assert(sizeof(FrameHeader) == 32, "layout is shared with bin_log_decode.py");
+
+/** What a record's word 1 points to; one per call site, in flash. */
+struct Site {
+    const char *format;
+    /** Argument type codes, see above; "" for none. */
+    const char *types;
+};
+
+constexpr uint32_t record_header_words = 4;
+
+} // namespace bin_log
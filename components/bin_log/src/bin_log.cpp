@@ -0,0 +1,207 @@
+#include "bin_log/bin_log.hpp"
+
+#include <cinttypes>
+#include <cstddef>
+
+#include "driver/uart.h"
+#include "esp_app_desc.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace bin_log {
+
+namespace detail {
+
+Ring rings[portNUM_PROCESSORS];
+std::atomic<uint8_t> runtime_level{CONFIG_LOG_DEFAULT_LEVEL};
+
+} // namespace detail
+
+namespace {
+
+const char *TAG = "bin_log";
+
+using detail::ring_words;
+using detail::Ring;
+
+Config config_;
+TaskHandle_t task_ = nullptr;
+SemaphoreHandle_t mutex_ = nullptr;
+uint8_t *frame_ = nullptr;
+size_t frame_used_ = 0;
+std::atomic<bool> stopping_{false};
+std::atomic<bool> stopped_{false};
+Stats stats_ = {};
+
+void send_frame()
+{
+    uint32_t dropped = 0;
+    for (Ring &ring : detail::rings) {
+        dropped += ring.dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (frame_used_ == sizeof(FrameHeader) && dropped == 0) {
+        return;
+    }
+    stats_.dropped += dropped;
+
+    FrameHeader header = {};
+    header.magic = frame_magic;
+    header.version = frame_version;
+    header.time_us = esp_timer_get_time();
+    header.payload_len = frame_used_ - sizeof(FrameHeader);
+    header.dropped = dropped;
+    memcpy(header.elf_sha256, esp_app_get_description()->app_elf_sha256, sizeof(header.elf_sha256));
+    uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&header), offsetof(FrameHeader, crc));
+    header.crc = esp_rom_crc32_le(crc, frame_ + sizeof(FrameHeader), header.payload_len);
+    memcpy(frame_, &header, sizeof(header));
+
+    config_.sink(config_.sink_ctx, frame_, frame_used_);
+    ++stats_.frames;
+    stats_.bytes += frame_used_;
+    frame_used_ = sizeof(FrameHeader);
+}
+
+/* Move the committed records of one ring into the frame, sending full frames as needed. */
+void drain_ring(Ring &ring)
+{
+    uint32_t head = ring.head.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t header = ring.words[head & (ring_words - 1)].load(std::memory_order_acquire);
+        if (header == 0) {
+            break;
+        }
+        uint32_t count = header & 0xff;
+        if (frame_used_ + count * 4 > config_.frame_size) {
+            send_frame();
+        }
+        /* The header word goes in as read; the rest were published before it. */
+        auto *out = reinterpret_cast<uint32_t *>(frame_ + frame_used_);
+        out[0] = header;
+        ring.words[head & (ring_words - 1)].store(0, std::memory_order_relaxed);
+        for (uint32_t i = 1; i < count; ++i) {
+            std::atomic<uint32_t> &w = ring.words[(head + i) & (ring_words - 1)];
+            out[i] = w.load(std::memory_order_relaxed);
+            w.store(0, std::memory_order_relaxed);
+        }
+        frame_used_ += count * 4;
+        head += count;
+        ++stats_.records;
+        /* Release: producers must see the zeroed words before reusing them. */
+        ring.head.store(head, std::memory_order_release);
+    }
+}
+
+void drain()
+{
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (Ring &ring : detail::rings) {
+        drain_ring(ring);
+    }
+    send_frame();
+    xSemaphoreGive(mutex_);
+}
+
+void drain_task(void *)
+{
+    while (!stopping_.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(config_.interval_ms));
+        drain();
+    }
+    stopped_.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+} // namespace
+
+esp_err_t start(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* The longest record must fit in a frame of its own. */
+    if (config.sink == nullptr || config.frame_size < sizeof(FrameHeader) + 255 * 4 || config.frame_size % 4 != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+    frame_ = static_cast<uint8_t *>(heap_caps_malloc(config.frame_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    mutex_ = xSemaphoreCreateMutex();
+    if (frame_ == nullptr || mutex_ == nullptr) {
+        stop();
+        return ESP_ERR_NO_MEM;
+    }
+    frame_used_ = sizeof(FrameHeader);
+    stopping_.store(false, std::memory_order_relaxed);
+    stopped_.store(false, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(drain_task, "bin_log", config.task_stack_size, nullptr, config.task_priority, &task_,
+                                config.task_core) != pdPASS) {
+        task_ = nullptr;
+        stop();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "%u words per core, draining every %" PRIu32 " ms", static_cast<unsigned>(ring_words),
+             config.interval_ms);
+    return ESP_OK;
+}
+
+void stop()
+{
+    if (task_ != nullptr) {
+        stopping_.store(true, std::memory_order_release);
+        xTaskNotifyGive(task_);
+        while (!stopped_.load(std::memory_order_acquire)) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        task_ = nullptr;
+        drain();
+    }
+    if (mutex_ != nullptr) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+    heap_caps_free(frame_);
+    frame_ = nullptr;
+}
+
+void flush()
+{
+    if (task_ != nullptr) {
+        drain();
+    }
+}
+
+Stats stats()
+{
+    if (mutex_ == nullptr) {
+        return stats_;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    Stats s = stats_;
+    xSemaphoreGive(mutex_);
+    return s;
+}
+
+void set_level(esp_log_level_t level)
+{
+    detail::runtime_level.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+esp_log_level_t level()
+{
+    return static_cast<esp_log_level_t>(detail::runtime_level.load(std::memory_order_relaxed));
+}
+
+void uart_sink(void *port, const uint8_t *data, size_t len)
+{
+    uart_write_bytes(static_cast<uart_port_t>(reinterpret_cast<intptr_t>(port)), data, len);
+}
+
+void file_sink(void *file, const uint8_t *data, size_t len)
+{
+    auto *f = static_cast<FILE *>(file);
+    fwrite(data, 1, len, f);
+    fflush(f);
+}
+
+} // namespace bin_log
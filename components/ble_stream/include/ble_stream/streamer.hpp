@@ -0,0 +1,225 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace ble_stream {
+
+/**
+ * 128-bit UUIDs of the streaming service, as phone apps write them. The data
+ * characteristic notifies; the credit characteristic takes writes.
+ */
+constexpr const char *service_uuid = "6e4a0001-7b3c-4f1e-9a52-3d0c8f2b1e70";
+constexpr const char *data_uuid = "6e4a0002-7b3c-4f1e-9a52-3d0c8f2b1e70";
+constexpr const char *credit_uuid = "6e4a0003-7b3c-4f1e-9a52-3d0c8f2b1e70";
+
+/** Every notification starts with a little-endian 16-bit sequence number, then the records. */
+constexpr size_t notification_header_size = 2;
+
+/** Largest notification value: an attribute value is at most 512 bytes. */
+constexpr size_t max_notification_size = 512;
+
+/** Largest record: fixed-size records fill one notification; variable ones carry a one-byte length. */
+constexpr size_t max_record_size = max_notification_size - notification_header_size;
+constexpr size_t max_variable_record_size = 255;
+
+struct Stats {
+    /** Records accepted by write(). */
+    uint32_t records;
+    /** write() calls refused for lack of queue space. */
+    uint32_t rejected;
+    /** Records given up on: larger than a notification at the MTU the peer agreed to. */
+    uint32_t dropped;
+    uint32_t notifications;
+    /** Record bytes carried, without sequence numbers and length bytes. */
+    uint64_t payload_bytes;
+    /** Times the task waited for the host stack to drain (the transmit window was full). */
+    uint32_t window_stalls;
+    /** Times the task waited for the peer to grant credits. */
+    uint32_t credit_stalls;
+    /** Notifications the stack refused for a reason other than memory; they are retried. */
+    uint32_t tx_errors;
+    uint32_t connections;
+    /** Bytes waiting in the queue. */
+    uint32_t queued_bytes;
+};
+
+/** Parameters of the current connection, as negotiated. */
+struct Link {
+    bool connected;
+    /** The peer enabled notifications on the data characteristic. */
+    bool subscribed;
+    uint16_t mtu;
+    /** 1 for LE 1M, 2 for LE 2M, 3 for coded. */
+    uint8_t tx_phy;
+    uint32_t interval_us;
+    /** Notifications the peer may still be sent (Config::peer_credits only). */
+    uint32_t credits;
+};
+
+/**
+ * @brief Peripheral that streams small records to one phone over GATT notifications.
+ *
+ * Sending one notification per reading at the default 23-byte MTU caps a
+ * link at around 10 KB/s, most of it headers and idle connection events.
+ * This streamer instead:
+ *
+ * - packs queued records into notifications of up to MTU - 3 bytes, sending
+ *   once a notification is full or the oldest record has waited
+ *   Config::linger_ms;
+ * - on every connection, asks for the large MTU, data length extension
+ *   (251-byte link-layer packets), the LE 2M PHY where the chip has it, and
+ *   Config's connection interval;
+ * - keeps the controller's ACL buffers full rather than one packet per
+ *   connection event: it hands notifications to the host stack until
+ *   Config::tx_window of the stack's mbufs are in use, which is the backlog
+ *   left once the controller has taken all it can, and resumes as they free;
+ * - optionally applies end-to-end credits: with Config::peer_credits the app
+ *   grants notifications by writing a little-endian uint16 count to the
+ *   credit characteristic, so a busy phone is never sent more than it can
+ *   take.
+ *
+ * Records are queued while no phone is subscribed and sent once one is;
+ * write() fails with ESP_ERR_NO_MEM when the queue is full. Each
+ * notification starts with a 16-bit sequence number, then either fixed-size
+ * records (Config::record_size) or records each preceded by a length byte.
+ *
+ * The streamer brings up NimBLE itself (controller included), so there is
+ * one per device and nothing else may use the host stack. NVS must be
+ * initialized first: the PHY calibration data lives there.
+ */
+class Streamer {
+public:
+    struct Config {
+        const char *device_name = "esp-stream";
+        /** Bytes per record; 0 for variable-length records of up to max_variable_record_size bytes. */
+        size_t record_size = 0;
+        /** Bytes of records buffered for the stream. */
+        size_t queue_size = 8192;
+        /** Longest the oldest queued record waits for others to share its notification. */
+        uint32_t linger_ms = 10;
+        /** MTU asked of the peer; phones grant 185-517. */
+        uint16_t preferred_mtu = 517;
+        /**
+         * Connection interval asked for, in 1.25 ms units. iOS accepts 15 ms
+         * (12) and multiples; Android goes down to 7.5 ms (6).
+         */
+        uint16_t interval_min = 12;
+        uint16_t interval_max = 24;
+        /** Supervision timeout, in 10 ms units. */
+        uint16_t supervision_timeout = 400;
+        bool prefer_2m_phy = true;
+        /**
+         * Host stack mbufs (CONFIG_BT_NIMBLE_MSYS_1_BLOCK_COUNT) in use beyond
+         * which the stream waits; a 244-byte notification takes two. Keep it
+         * below the pool size so ATT responses still get one.
+         */
+        size_t tx_window = 12;
+        /** Send only as many notifications as the peer has granted through the credit characteristic. */
+        bool peer_credits = false;
+        uint32_t adv_interval_ms = 100;
+        const char *task_name = "ble_stream";
+        uint32_t stack_size = 4096;
+        UBaseType_t priority = 5;
+        BaseType_t core = tskNO_AFFINITY;
+    };
+
+    Streamer() = default;
+    ~Streamer() { deinit(); }
+
+    Streamer(const Streamer &) = delete;
+    Streamer &operator=(const Streamer &) = delete;
+
+    /** Bring up NimBLE, register the service, start advertising and the stream task. */
+    esp_err_t init(const Config &config);
+
+    /** Disconnect, stop the task and shut NimBLE and the controller down. Queued records are dropped. */
+    void deinit();
+
+    /**
+     * @brief Queue one record.
+     *
+     * @p wait bounds how long to block for queue space; 0 fails at once.
+     * @return ESP_ERR_NO_MEM when the queue stays full, ESP_ERR_INVALID_SIZE
+     * for a length other than Config::record_size (or over
+     * max_variable_record_size in variable mode).
+     */
+    esp_err_t write(const void *data, size_t len, TickType_t wait = 0);
+
+    /** Send what is queued now instead of waiting out the linger time. */
+    void flush();
+
+    Link link() const;
+    Stats stats() const;
+
+private:
+    /* The NimBLE callbacks, defined next to the host types in streamer.cpp. */
+    struct Callbacks;
+
+    static void task_entry(void *arg);
+
+    void run();
+    bool transmit(int64_t now, TickType_t *timeout);
+    /* Record bytes one notification carries at the current MTU. */
+    size_t payload_capacity() const;
+    void put_locked(const void *data, size_t len);
+    void take_locked(void *out, size_t len);
+    /* Move as many whole records as fit @p capacity into frame_. */
+    void fill_locked(size_t capacity);
+    /* Bytes of the record at @p pos in frame_, length prefix included; its payload in @p payload. */
+    size_t frame_record(size_t pos, size_t *payload) const;
+    /* Drop the records before @p end from frame_, keeping the header. */
+    void trim_frame(size_t end, size_t payload);
+    void notify(uint32_t bits);
+
+    Config config_;
+    TaskHandle_t task_ = nullptr;
+    SemaphoreHandle_t lock_ = nullptr;
+    /* Given whenever the task takes records off the queue; write() waits on it. */
+    SemaphoreHandle_t space_ = nullptr;
+
+    /* Guarded by lock_: a byte ring of records. */
+    uint8_t *queue_ = nullptr;
+    size_t head_ = 0;
+    size_t used_ = 0;
+    int64_t oldest_us_ = 0;
+
+    /* Stream task only: the notification being built or retried. */
+    uint8_t *frame_ = nullptr;
+    size_t frame_len_ = 0;
+    size_t frame_payload_ = 0;
+    uint16_t seq_ = 0;
+    bool host_started_ = false;
+
+    /* Written by the host task's GAP handler. 0xffff is BLE_HS_CONN_HANDLE_NONE. */
+    std::atomic<uint16_t> conn_handle_{0xffff};
+    std::atomic<bool> subscribed_{false};
+    std::atomic<uint16_t> mtu_{23};
+    /* The MTU exchange of this connection has finished, one way or the other. */
+    std::atomic<bool> mtu_settled_{false};
+    std::atomic<uint8_t> tx_phy_{1};
+    std::atomic<uint32_t> interval_us_{0};
+    std::atomic<uint32_t> credits_{0};
+    std::atomic<bool> flush_requested_{false};
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint32_t> records_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> notifications_{0};
+    std::atomic<uint64_t> payload_bytes_{0};
+    std::atomic<uint32_t> window_stalls_{0};
+    std::atomic<uint32_t> credit_stalls_{0};
+    std::atomic<uint32_t> tx_errors_{0};
+    std::atomic<uint32_t> connections_{0};
+};
+
+} // namespace ble_stream
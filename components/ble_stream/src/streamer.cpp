@@ -0,0 +1,721 @@
+#include "ble_stream/streamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "host/util/util.h"
+#include "nimble/nimble_port.h"
+#include "nimble/nimble_port_freertos.h"
+#include "services/gap/ble_svc_gap.h"
+#include "services/gatt/ble_svc_gatt.h"
+#include "soc/soc_caps.h"
+
+namespace ble_stream {
+
+static const char *TAG = "ble_stream";
+
+namespace {
+
+constexpr uint32_t wake_bit = 1u << 0;
+
+/* ATT opcode and handle in front of a notification's value. */
+constexpr size_t att_notify_overhead = 3;
+
+/* Longest advertised name that fits the scan response next to its header. */
+constexpr size_t max_name_len = 29;
+
+/* Link-layer payload and its air time at 1M, the largest data length extension allows. */
+constexpr uint16_t max_tx_octets = 251;
+constexpr uint16_t max_tx_time_us = 2120;
+
+/* Connection interval limits of the spec, in 1.25 ms units: 7.5 ms to 4 s. */
+constexpr uint16_t min_interval = 6;
+constexpr uint16_t max_interval = 3200;
+
+/* How soon to look again when the host stack is out of room; it frees
+ * mbufs as the controller reports completed packets, a few per connection
+ * event. */
+constexpr TickType_t window_poll = 1;
+
+/* UUIDs of streamer.hpp, little-endian as NimBLE stores them. */
+const ble_uuid128_t s_service_uuid =
+    BLE_UUID128_INIT(0x70, 0x1e, 0x2b, 0x8f, 0x0c, 0x3d, 0x52, 0x9a, 0x1e, 0x4f, 0x3c, 0x7b, 0x01, 0x00, 0x4a, 0x6e);
+const ble_uuid128_t s_data_uuid =
+    BLE_UUID128_INIT(0x70, 0x1e, 0x2b, 0x8f, 0x0c, 0x3d, 0x52, 0x9a, 0x1e, 0x4f, 0x3c, 0x7b, 0x02, 0x00, 0x4a, 0x6e);
+const ble_uuid128_t s_credit_uuid =
+    BLE_UUID128_INIT(0x70, 0x1e, 0x2b, 0x8f, 0x0c, 0x3d, 0x52, 0x9a, 0x1e, 0x4f, 0x3c, 0x7b, 0x03, 0x00, 0x4a, 0x6e);
+
+/* NimBLE keeps pointers to the service table and its callbacks carry no
+ * context of their own: the one Streamer they serve. */
+Streamer *s_streamer = nullptr;
+ble_gatt_chr_def s_characteristics[3];
+ble_gatt_svc_def s_services[2];
+uint16_t s_data_handle;
+uint8_t s_own_addr_type;
+
+TickType_t ticks_until(int64_t deadline_us, int64_t now_us)
+{
+    if (deadline_us <= now_us) {
+        return 0;
+    }
+    /* Round up so the task does not wake just short of the deadline. */
+    return pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000) + 1;
+}
+
+/* Host stack mbufs in use, ours and anyone else's. */
+size_t mbufs_in_use()
+{
+    return static_cast<size_t>(os_msys_count() - os_msys_num_free());
+}
+
+} // namespace
+
+struct Streamer::Callbacks {
+    static void host_task(void *)
+    {
+        nimble_port_run();
+        nimble_port_freertos_deinit();
+    }
+
+    static void on_reset(int reason)
+    {
+        ESP_LOGW(TAG, "host reset, reason %d", reason);
+    }
+
+    static void on_sync()
+    {
+        int rc = ble_hs_util_ensure_addr(0);
+        if (rc == 0) {
+            rc = ble_hs_id_infer_auto(0, &s_own_addr_type);
+        }
+        if (rc != 0) {
+            ESP_LOGE(TAG, "no usable address: %d", rc);
+            return;
+        }
+        advertise();
+    }
+
+    static void advertise()
+    {
+        Streamer *s = s_streamer;
+        if (s == nullptr) {
+            return;
+        }
+        ble_hs_adv_fields fields = {};
+        fields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
+        fields.uuids128 = &s_service_uuid;
+        fields.num_uuids128 = 1;
+        fields.uuids128_is_complete = 1;
+        int rc = ble_gap_adv_set_fields(&fields);
+        if (rc == 0) {
+            ble_hs_adv_fields response = {};
+            response.name = reinterpret_cast<const uint8_t *>(s->config_.device_name);
+            response.name_len = static_cast<uint8_t>(strlen(s->config_.device_name));
+            response.name_is_complete = 1;
+            rc = ble_gap_adv_rsp_set_fields(&response);
+        }
+        if (rc == 0) {
+            ble_gap_adv_params params = {};
+            params.conn_mode = BLE_GAP_CONN_MODE_UND;
+            params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+            params.itvl_min = params.itvl_max = BLE_GAP_ADV_ITVL_MS(s->config_.adv_interval_ms);
+            rc = ble_gap_adv_start(s_own_addr_type, nullptr, BLE_HS_FOREVER, &params, on_gap_event, s);
+        }
+        if (rc != 0 && rc != BLE_HS_EALREADY) {
+            ESP_LOGE(TAG, "advertising failed: %d", rc);
+        }
+    }
+
+    /* Ask for everything that raises throughput; the peer may refuse any of it. */
+    static void negotiate(Streamer *s, uint16_t conn)
+    {
+        int rc = ble_gattc_exchange_mtu(conn, on_mtu_exchanged, s);
+        if (rc != 0) {
+            ESP_LOGD(TAG, "MTU exchange: %d", rc);
+            s->mtu_settled_.store(true, std::memory_order_release);
+        }
+        rc = ble_gap_set_data_len(conn, max_tx_octets, max_tx_time_us);
+        if (rc != 0) {
+            ESP_LOGD(TAG, "data length: %d", rc);
+        }
+#if SOC_BLE_50_SUPPORTED
+        if (s->config_.prefer_2m_phy) {
+            rc = ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                             BLE_GAP_LE_PHY_CODED_ANY);
+            if (rc != 0) {
+                ESP_LOGD(TAG, "2M PHY: %d", rc);
+            }
+        }
+#endif
+        ble_gap_upd_params params = {};
+        params.itvl_min = s->config_.interval_min;
+        params.itvl_max = s->config_.interval_max;
+        params.latency = 0;
+        params.supervision_timeout = s->config_.supervision_timeout;
+        /* Let connection events run the whole interval while there is data
+         * (CE lengths are in 0.625 ms units, intervals in 1.25 ms). */
+        params.min_ce_len = 0;
+        params.max_ce_len = static_cast<uint16_t>(s->config_.interval_max * 2);
+        rc = ble_gap_update_params(conn, &params);
+        if (rc != 0) {
+            ESP_LOGD(TAG, "connection parameters: %d", rc);
+        }
+    }
+
+    /* Whatever the outcome, the MTU is now as large as it will get: the
+     * agreed one, or the default if the exchange failed. */
+    static int on_mtu_exchanged(uint16_t, const ble_gatt_error *error, uint16_t mtu, void *arg)
+    {
+        auto *s = static_cast<Streamer *>(arg);
+        if (error->status != 0) {
+            ESP_LOGD(TAG, "MTU exchange failed: %u", error->status);
+            mtu = BLE_ATT_MTU_DFLT;
+        }
+        s->mtu_.store(mtu, std::memory_order_relaxed);
+        s->mtu_settled_.store(true, std::memory_order_release);
+        s->notify(wake_bit);
+        return 0;
+    }
+
+    static void read_interval(Streamer *s, uint16_t conn)
+    {
+        ble_gap_conn_desc desc;
+        if (ble_gap_conn_find(conn, &desc) == 0) {
+            s->interval_us_.store(desc.conn_itvl * 1250u, std::memory_order_relaxed);
+        }
+    }
+
+    /* Host task. */
+    static int on_gap_event(ble_gap_event *event, void *arg)
+    {
+        auto *s = static_cast<Streamer *>(arg);
+        switch (event->type) {
+        case BLE_GAP_EVENT_CONNECT:
+            if (event->connect.status != 0) {
+                advertise();
+                break;
+            }
+            s->connections_.fetch_add(1, std::memory_order_relaxed);
+            s->credits_.store(0, std::memory_order_relaxed);
+            s->mtu_settled_.store(false, std::memory_order_relaxed);
+            s->mtu_.store(ble_att_mtu(event->connect.conn_handle), std::memory_order_relaxed);
+            read_interval(s, event->connect.conn_handle);
+            s->conn_handle_.store(event->connect.conn_handle, std::memory_order_release);
+            ESP_LOGI(TAG, "connected");
+            negotiate(s, event->connect.conn_handle);
+            break;
+        case BLE_GAP_EVENT_DISCONNECT:
+            s->conn_handle_.store(BLE_HS_CONN_HANDLE_NONE, std::memory_order_release);
+            s->subscribed_.store(false, std::memory_order_relaxed);
+            s->mtu_.store(BLE_ATT_MTU_DFLT, std::memory_order_relaxed);
+            s->tx_phy_.store(1, std::memory_order_relaxed);
+            s->interval_us_.store(0, std::memory_order_relaxed);
+            ESP_LOGI(TAG, "disconnected, reason 0x%x", event->disconnect.reason);
+            s->notify(wake_bit);
+            advertise();
+            break;
+        case BLE_GAP_EVENT_CONN_UPDATE:
+            if (event->conn_update.status == 0) {
+                read_interval(s, event->conn_update.conn_handle);
+            }
+            break;
+        case BLE_GAP_EVENT_MTU:
+            s->mtu_.store(event->mtu.value, std::memory_order_relaxed);
+            s->mtu_settled_.store(true, std::memory_order_release);
+            ESP_LOGI(TAG, "MTU %u", event->mtu.value);
+            s->notify(wake_bit);
+            break;
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            if (event->phy_updated.status == 0) {
+                s->tx_phy_.store(event->phy_updated.tx_phy, std::memory_order_relaxed);
+            }
+            break;
+        case BLE_GAP_EVENT_SUBSCRIBE:
+            if (event->subscribe.attr_handle == s_data_handle) {
+                s->subscribed_.store(event->subscribe.cur_notify != 0, std::memory_order_release);
+                s->notify(wake_bit);
+            }
+            break;
+        case BLE_GAP_EVENT_ADV_COMPLETE:
+            if (s->conn_handle_.load(std::memory_order_acquire) == BLE_HS_CONN_HANDLE_NONE) {
+                advertise();
+            }
+            break;
+        default:
+            break;
+        }
+        return 0;
+    }
+
+    /* Host task: the credit characteristic takes a little-endian uint16 count of notifications granted. */
+    static int on_access(uint16_t, uint16_t, ble_gatt_access_ctxt *ctxt, void *arg)
+    {
+        auto *s = static_cast<Streamer *>(arg);
+        if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
+            return BLE_ATT_ERR_REQ_NOT_SUPPORTED;
+        }
+        uint8_t value[2];
+        uint16_t len = 0;
+        if (OS_MBUF_PKTLEN(ctxt->om) != sizeof(value) ||
+            ble_hs_mbuf_to_flat(ctxt->om, value, sizeof(value), &len) != 0) {
+            return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+        }
+        s->credits_.fetch_add(static_cast<uint32_t>(value[0] | value[1] << 8), std::memory_order_release);
+        s->notify(wake_bit);
+        return 0;
+    }
+};
+
+esp_err_t Streamer::init(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_streamer != nullptr) {
+        ESP_LOGE(TAG, "NimBLE already has a streamer; one per device");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.device_name == nullptr || strlen(config.device_name) > max_name_len ||
+        config.record_size > max_record_size || config.queue_size < max_notification_size ||
+        config.tx_window == 0 || config.preferred_mtu < BLE_ATT_MTU_DFLT || config.preferred_mtu > BLE_ATT_MTU_MAX ||
+        config.interval_min < min_interval || config.interval_max > max_interval ||
+        config.interval_min > config.interval_max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+
+    constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    queue_ = static_cast<uint8_t *>(heap_caps_malloc(config_.queue_size, caps));
+    frame_ = static_cast<uint8_t *>(heap_caps_malloc(max_notification_size, caps));
+    lock_ = xSemaphoreCreateMutex();
+    space_ = xSemaphoreCreateBinary();
+    if (queue_ == nullptr || frame_ == nullptr || lock_ == nullptr || space_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    head_ = 0;
+    used_ = 0;
+    frame_len_ = 0;
+    frame_payload_ = 0;
+    seq_ = 0;
+    conn_handle_.store(BLE_HS_CONN_HANDLE_NONE, std::memory_order_relaxed);
+    subscribed_.store(false, std::memory_order_relaxed);
+    mtu_.store(BLE_ATT_MTU_DFLT, std::memory_order_relaxed);
+    flush_requested_.store(false, std::memory_order_relaxed);
+
+    esp_err_t err = nimble_port_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nimble_port_init failed: %s", esp_err_to_name(err));
+        deinit();
+        return err;
+    }
+    s_streamer = this;
+    ble_hs_cfg.sync_cb = Callbacks::on_sync;
+    ble_hs_cfg.reset_cb = Callbacks::on_reset;
+    ble_svc_gap_init();
+    ble_svc_gatt_init();
+
+    s_characteristics[0] = {};
+    s_characteristics[0].uuid = &s_data_uuid.u;
+    s_characteristics[0].access_cb = Callbacks::on_access;
+    s_characteristics[0].arg = this;
+    s_characteristics[0].flags = BLE_GATT_CHR_F_NOTIFY;
+    s_characteristics[0].val_handle = &s_data_handle;
+    s_characteristics[1] = {};
+    s_characteristics[1].uuid = &s_credit_uuid.u;
+    s_characteristics[1].access_cb = Callbacks::on_access;
+    s_characteristics[1].arg = this;
+    s_characteristics[1].flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP;
+    s_characteristics[2] = {};
+    s_services[0] = {};
+    s_services[0].type = BLE_GATT_SVC_TYPE_PRIMARY;
+    s_services[0].uuid = &s_service_uuid.u;
+    s_services[0].characteristics = s_characteristics;
+    s_services[1] = {};
+
+    int rc = ble_gatts_count_cfg(s_services);
+    if (rc == 0) {
+        rc = ble_gatts_add_svcs(s_services);
+    }
+    if (rc == 0) {
+        rc = ble_svc_gap_device_name_set(config_.device_name);
+    }
+    if (rc == 0) {
+        rc = ble_att_set_preferred_mtu(config_.preferred_mtu);
+    }
+    if (rc != 0) {
+        ESP_LOGE(TAG, "GATT setup failed: %d", rc);
+        deinit();
+        return ESP_FAIL;
+    }
+
+    stopping_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(task_entry, config_.task_name, config_.stack_size, this, config_.priority, &task_,
+                                config_.core) != pdPASS) {
+        running_.store(false, std::memory_order_relaxed);
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    nimble_port_freertos_init(Callbacks::host_task);
+    host_started_ = true;
+    ESP_LOGI(TAG, "advertising as \"%s\", %u-byte queue", config_.device_name,
+             static_cast<unsigned>(config_.queue_size));
+    return ESP_OK;
+}
+
+void Streamer::deinit()
+{
+    /* The host first, so no callback touches the task below. The stream task
+     * may still try a notification meanwhile; a stopped host refuses it. */
+    stopping_.store(true, std::memory_order_seq_cst);
+    if (host_started_) {
+        uint16_t conn = conn_handle_.load(std::memory_order_acquire);
+        if (conn != BLE_HS_CONN_HANDLE_NONE) {
+            ble_gap_terminate(conn, BLE_ERR_REM_USER_CONN_TERM);
+        }
+        ble_gap_adv_stop();
+        nimble_port_stop();
+        host_started_ = false;
+    }
+    notify(wake_bit);
+    while (running_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    if (s_streamer == this) {
+        nimble_port_deinit();
+        s_streamer = nullptr;
+    }
+    conn_handle_.store(BLE_HS_CONN_HANDLE_NONE, std::memory_order_relaxed);
+    subscribed_.store(false, std::memory_order_relaxed);
+    if (space_ != nullptr) {
+        vSemaphoreDelete(space_);
+        space_ = nullptr;
+    }
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+    heap_caps_free(queue_);
+    heap_caps_free(frame_);
+    queue_ = nullptr;
+    frame_ = nullptr;
+    used_ = 0;
+}
+
+esp_err_t Streamer::write(const void *data, size_t len, TickType_t wait)
+{
+    if (task_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (data == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    bool variable = config_.record_size == 0;
+    if (variable ? len == 0 || len > max_variable_record_size : len != config_.record_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t need = len + (variable ? 1 : 0);
+    size_t capacity = payload_capacity();
+
+    TickType_t start = xTaskGetTickCount();
+    for (;;) {
+        bool wake = false;
+        bool queued = false;
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        if (config_.queue_size - used_ >= need) {
+            size_t before = used_;
+            if (before == 0) {
+                oldest_us_ = esp_timer_get_time();
+            }
+            if (variable) {
+                uint8_t prefix = static_cast<uint8_t>(len);
+                put_locked(&prefix, 1);
+            }
+            put_locked(data, len);
+            /* The task wants to hear of the first record (to start the linger
+             * clock) and of a notification's worth; not of every record. */
+            wake = before == 0 || (before < capacity && used_ >= capacity);
+            queued = true;
+        }
+        xSemaphoreGive(lock_);
+        if (queued) {
+            records_.fetch_add(1, std::memory_order_relaxed);
+            if (wake) {
+                notify(wake_bit);
+            }
+            return ESP_OK;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return ESP_ERR_NO_MEM;
+        }
+        xSemaphoreTake(space_, wait - elapsed);
+    }
+}
+
+void Streamer::flush()
+{
+    flush_requested_.store(true, std::memory_order_release);
+    notify(wake_bit);
+}
+
+Link Streamer::link() const
+{
+    Link l = {};
+    l.connected = conn_handle_.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE;
+    l.subscribed = subscribed_.load(std::memory_order_relaxed);
+    l.mtu = mtu_.load(std::memory_order_relaxed);
+    l.tx_phy = tx_phy_.load(std::memory_order_relaxed);
+    l.interval_us = interval_us_.load(std::memory_order_relaxed);
+    l.credits = credits_.load(std::memory_order_relaxed);
+    return l;
+}
+
+Stats Streamer::stats() const
+{
+    Stats s = {};
+    s.records = records_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.notifications = notifications_.load(std::memory_order_relaxed);
+    s.payload_bytes = payload_bytes_.load(std::memory_order_relaxed);
+    s.window_stalls = window_stalls_.load(std::memory_order_relaxed);
+    s.credit_stalls = credit_stalls_.load(std::memory_order_relaxed);
+    s.tx_errors = tx_errors_.load(std::memory_order_relaxed);
+    s.connections = connections_.load(std::memory_order_relaxed);
+    if (lock_ != nullptr) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        s.queued_bytes = static_cast<uint32_t>(used_);
+        xSemaphoreGive(lock_);
+    }
+    return s;
+}
+
+size_t Streamer::payload_capacity() const
+{
+    size_t value = std::min<size_t>(mtu_.load(std::memory_order_relaxed) - att_notify_overhead, max_notification_size);
+    return value - notification_header_size;
+}
+
+void Streamer::put_locked(const void *data, size_t len)
+{
+    size_t tail = (head_ + used_) % config_.queue_size;
+    size_t first = std::min(len, config_.queue_size - tail);
+    memcpy(queue_ + tail, data, first);
+    memcpy(queue_, static_cast<const uint8_t *>(data) + first, len - first);
+    used_ += len;
+}
+
+void Streamer::take_locked(void *out, size_t len)
+{
+    size_t first = std::min(len, config_.queue_size - head_);
+    memcpy(out, queue_ + head_, first);
+    memcpy(static_cast<uint8_t *>(out) + first, queue_, len - first);
+    head_ = (head_ + len) % config_.queue_size;
+    used_ -= len;
+}
+
+void Streamer::fill_locked(size_t capacity)
+{
+    size_t len = notification_header_size;
+    size_t payload = 0;
+    while (used_ != 0) {
+        size_t record = config_.record_size;
+        size_t prefix = 0;
+        if (record == 0) {
+            record = queue_[head_];
+            prefix = 1;
+        }
+        if (prefix + record > capacity) {
+            /* Until the MTU exchange is over the record may still fit; after
+             * it, it fits no notification on this link. */
+            if (!mtu_settled_.load(std::memory_order_acquire)) {
+                break;
+            }
+            uint8_t scratch[max_variable_record_size + 1];
+            for (size_t left = prefix + record; left != 0;) {
+                size_t n = std::min(left, sizeof(scratch));
+                take_locked(scratch, n);
+                left -= n;
+            }
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (len + prefix + record > notification_header_size + capacity) {
+            break;
+        }
+        take_locked(frame_ + len, prefix + record);
+        len += prefix + record;
+        payload += record;
+    }
+    frame_len_ = len > notification_header_size ? len : 0;
+    frame_payload_ = payload;
+}
+
+size_t Streamer::frame_record(size_t pos, size_t *payload) const
+{
+    if (config_.record_size != 0) {
+        *payload = config_.record_size;
+        return config_.record_size;
+    }
+    *payload = frame_[pos];
+    return 1 + frame_[pos];
+}
+
+void Streamer::trim_frame(size_t end, size_t payload)
+{
+    memmove(frame_ + notification_header_size, frame_ + end, frame_len_ - end);
+    frame_len_ -= end - notification_header_size;
+    frame_payload_ -= payload;
+    if (frame_len_ == notification_header_size) {
+        frame_len_ = 0;
+    }
+}
+
+void Streamer::task_entry(void *arg)
+{
+    static_cast<Streamer *>(arg)->run();
+}
+
+void Streamer::run()
+{
+    TickType_t timeout = portMAX_DELAY;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        xTaskNotifyWait(0, UINT32_MAX, nullptr, timeout);
+        timeout = portMAX_DELAY;
+        while (!stopping_.load(std::memory_order_acquire) && transmit(esp_timer_get_time(), &timeout)) {
+        }
+    }
+    running_.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+bool Streamer::transmit(int64_t now, TickType_t *timeout)
+{
+    /* Connection, subscription and credit changes all notify the task, so
+     * returning without a timeout waits for them. */
+    uint16_t conn = conn_handle_.load(std::memory_order_acquire);
+    if (conn == BLE_HS_CONN_HANDLE_NONE || !subscribed_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (config_.peer_credits && credits_.load(std::memory_order_acquire) == 0) {
+        credit_stalls_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (mbufs_in_use() >= config_.tx_window) {
+        window_stalls_.fetch_add(1, std::memory_order_relaxed);
+        *timeout = window_poll;
+        return false;
+    }
+
+    if (frame_len_ == 0) {
+        size_t capacity = payload_capacity();
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        if (used_ == 0) {
+            flush_requested_.store(false, std::memory_order_relaxed);
+            xSemaphoreGive(lock_);
+            return false;
+        }
+        int64_t due = oldest_us_ + int64_t{config_.linger_ms} * 1000;
+        if (used_ < capacity && now < due && !flush_requested_.load(std::memory_order_acquire)) {
+            xSemaphoreGive(lock_);
+            *timeout = ticks_until(due, now);
+            return false;
+        }
+        fill_locked(capacity);
+        /* What is left was queued before now; time its linger from here. */
+        oldest_us_ = now;
+        if (used_ == 0) {
+            flush_requested_.store(false, std::memory_order_relaxed);
+        }
+        xSemaphoreGive(lock_);
+        xSemaphoreGive(space_);
+        if (frame_len_ == 0) {
+            /* Everything was dropped, or the head record waits for the MTU exchange. */
+            return false;
+        }
+    }
+
+    /* A notification the stack refused stays in frame_ and goes out first
+     * next time, after a reconnect if need be. It was built for the MTU of
+     * the link at the time; a new link starts at the default MTU, and the
+     * stack would cut a longer notification short. So a frame too long for
+     * this link waits for the MTU exchange, then goes out as many whole
+     * records at a time as fit. */
+    size_t limit = notification_header_size + payload_capacity();
+    size_t send_len = frame_len_;
+    size_t send_payload = frame_payload_;
+    if (frame_len_ > limit) {
+        if (!mtu_settled_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        send_len = notification_header_size;
+        send_payload = 0;
+        for (size_t payload; send_len < frame_len_;) {
+            size_t n = frame_record(send_len, &payload);
+            if (send_len + n > limit) {
+                break;
+            }
+            send_len += n;
+            send_payload += payload;
+        }
+        if (send_len == notification_header_size) {
+            /* The head record fits no notification on this link. */
+            size_t payload;
+            size_t n = frame_record(send_len, &payload);
+            trim_frame(send_len + n, payload);
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    frame_[0] = static_cast<uint8_t>(seq_);
+    frame_[1] = static_cast<uint8_t>(seq_ >> 8);
+    os_mbuf *om = ble_hs_mbuf_from_flat(frame_, static_cast<uint16_t>(send_len));
+    if (om == nullptr) {
+        window_stalls_.fetch_add(1, std::memory_order_relaxed);
+        *timeout = window_poll;
+        return false;
+    }
+    int rc = ble_gatts_notify_custom(conn, s_data_handle, om);
+    if (rc == BLE_HS_ENOMEM) {
+        window_stalls_.fetch_add(1, std::memory_order_relaxed);
+        *timeout = window_poll;
+        return false;
+    }
+    if (rc != 0) {
+        tx_errors_.fetch_add(1, std::memory_order_relaxed);
+        ESP_LOGD(TAG, "notify: %d", rc);
+        *timeout = pdMS_TO_TICKS(10) + 1;
+        return false;
+    }
+    ++seq_;
+    if (config_.peer_credits) {
+        credits_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    notifications_.fetch_add(1, std::memory_order_relaxed);
+    payload_bytes_.fetch_add(send_payload, std::memory_order_relaxed);
+    if (send_len == frame_len_) {
+        frame_len_ = 0;
+    } else {
+        trim_frame(send_len, send_payload);
+    }
+    return true;
+}
+
+void Streamer::notify(uint32_t bits)
+{
+    TaskHandle_t task = task_;
+    if (task != nullptr) {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
+
+} // namespace ble_stream
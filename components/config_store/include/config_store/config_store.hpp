@@ -0,0 +1,317 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace config_store {
+
+/** How a field is stored in NVS. Floats are kept as their bit patterns, bools as one byte. */
+enum class Type : uint8_t {
+    boolean,
+    u8,
+    i8,
+    u16,
+    i16,
+    u32,
+    i32,
+    u64,
+    i64,
+    f32,
+    f64,
+    /** A NUL-terminated char array. */
+    str,
+    /** Any other trivially copyable field, stored as a blob of its exact size. */
+    blob,
+};
+
+/** One persisted member of the settings struct. */
+struct Field {
+    /** NVS key: 1 to 15 characters, unique within the schema. */
+    const char *key;
+    Type type;
+    uint16_t offset;
+    uint16_t size;
+};
+
+/** Fields one schema may have; dirty fields are tracked in a 64-bit mask. */
+constexpr size_t max_fields = 64;
+
+/** Change listeners one store may have. */
+constexpr size_t max_listeners = 8;
+
+namespace detail {
+
+/* Not constexpr: reaching a call to either from make_field() is what fails the build. */
+void nvs_key_must_be_1_to_15_characters();
+void field_must_fit_in_65535_bytes();
+
+template <typename M>
+constexpr Type type_of()
+{
+    static_assert(std::is_trivially_copyable<M>::value, "fields are copied and compared bytewise");
+    if constexpr (std::is_same<M, bool>::value) {
+        return Type::boolean;
+    } else if constexpr (std::is_integral<M>::value || std::is_enum<M>::value) {
+        constexpr bool is_signed = std::is_signed<M>::value;
+        if constexpr (sizeof(M) == 1) {
+            return is_signed ? Type::i8 : Type::u8;
+        } else if constexpr (sizeof(M) == 2) {
+            return is_signed ? Type::i16 : Type::u16;
+        } else if constexpr (sizeof(M) == 4) {
+            return is_signed ? Type::i32 : Type::u32;
+        } else {
+            return is_signed ? Type::i64 : Type::u64;
+        }
+    } else if constexpr (std::is_same<M, float>::value) {
+        return Type::f32;
+    } else if constexpr (std::is_same<M, double>::value) {
+        return Type::f64;
+    } else if constexpr (std::is_array<M>::value && std::is_same<std::remove_extent_t<M>, char>::value) {
+        return Type::str;
+    } else {
+        return Type::blob;
+    }
+}
+
+} // namespace detail
+
+/** A schema entry for a member of type @p M at @p offset; see CONFIG_STORE_FIELD. */
+template <typename M>
+consteval Field make_field(const char *key, size_t offset)
+{
+    size_t len = 0;
+    while (key[len] != '\0') {
+        ++len;
+    }
+    if (len == 0 || len > 15) {
+        detail::nvs_key_must_be_1_to_15_characters();
+    }
+    if (sizeof(M) > UINT16_MAX || offset > UINT16_MAX) {
+        detail::field_must_fit_in_65535_bytes();
+    }
+    return Field{key, detail::type_of<M>(), static_cast<uint16_t>(offset), static_cast<uint16_t>(sizeof(M))};
+}
+
+/**
+ * Schema entry for @p member of @p Struct, stored under @p key. Evaluated at
+ * compile time, so a key NVS would refuse fails the build:
+ *
+ *     struct Settings {
+ *         float gain = 1.0f;
+ *         uint32_t report_ms = 1000;
+ *         char broker[64] = "mqtt://broker.local";
+ *     };
+ *     constexpr config_store::Field settings_schema[] = {
+ *         CONFIG_STORE_FIELD(Settings, gain, "gain"),
+ *         CONFIG_STORE_FIELD(Settings, report_ms, "report_ms"),
+ *         CONFIG_STORE_FIELD(Settings, broker, "broker"),
+ *     };
+ */
+#define CONFIG_STORE_FIELD(Struct, member, key)                                                                      \
+    ::config_store::make_field<decltype(Struct::member)>(key, offsetof(Struct, member))
+
+struct Stats {
+    /** set() calls that changed a field. */
+    uint32_t sets;
+    /** set() calls with the value the field already had; nothing is written or reported. */
+    uint32_t unchanged_sets;
+    /** Fields loaded from NVS at init(); the others kept their defaults. */
+    uint32_t loaded;
+    /** nvs_commit() calls. */
+    uint32_t commits;
+    /** Keys written to NVS. */
+    uint32_t keys_written;
+    /** Dirty fields not written because they were back at the value already in flash. */
+    uint32_t coalesced;
+    /** Failed writes or commits; the fields stay dirty and are retried. */
+    uint32_t errors;
+    /** Fields changed but not committed yet. */
+    uint32_t dirty;
+};
+
+/** Called after @p field changed, with the cached struct already holding the new value. */
+using ChangeFn = void (*)(void *ctx, const Field &field);
+
+/**
+ * @brief Typed settings held in RAM, persisted to NVS in debounced batches.
+ *
+ * The settings are a plain struct owned by the application, described by a
+ * compile-time schema of CONFIG_STORE_FIELD entries. init() takes whatever the
+ * struct holds as the defaults, then loads each field whose key is in NVS
+ * over it, once. From then on the struct is the cache: hot paths read its
+ * members directly, with no NVS lookup and no lock.
+ *
+ * set() updates the struct, calls the change listeners and marks the field
+ * dirty. The store's task commits dirty fields once Config::commit_delay_ms
+ * passes with no further set(), and at the latest Config::max_commit_delay_ms
+ * after the first. A batch writes only fields that differ from what is in
+ * flash, then commits once, so a value nudged back and forth or a slider
+ * dragged through a hundred positions costs at most one write per key.
+ * flush() commits at once, for example before a restart; deinit() does too.
+ *
+ * Reads are unsynchronised with set(): a naturally aligned member of 32 bits
+ * or less is always read whole, but strings, blobs, 64-bit members and
+ * several members that must agree are read through snapshot(). Changes made
+ * by set() are lost if power fails before they are committed.
+ */
+class Store {
+public:
+    struct Config {
+        /** NVS namespace, at most 15 characters; nvs_flash_init() must have run. */
+        const char *nvs_namespace = "config";
+        /** The settings struct and its schema; see init(T&, const Field (&)[N], Config). */
+        void *values = nullptr;
+        size_t size = 0;
+        const Field *schema = nullptr;
+        size_t field_count = 0;
+        /** Quiet time after the last set() before dirty fields are committed. */
+        uint32_t commit_delay_ms = 1000;
+        /** Longest a change waits for its commit while set() keeps being called. */
+        uint32_t max_commit_delay_ms = 10000;
+        const char *task_name = "config_store";
+        uint32_t stack_size = 3072;
+        UBaseType_t priority = 2;
+        BaseType_t core = tskNO_AFFINITY;
+    };
+
+    Store() = default;
+    ~Store() { deinit(); }
+
+    Store(const Store &) = delete;
+    Store &operator=(const Store &) = delete;
+
+    /**
+     * @brief Check the schema, load the stored fields into Config::values and start the commit task.
+     *
+     * A field stored with another type or size (the schema changed) keeps its
+     * default. @return ESP_ERR_INVALID_ARG for a schema with duplicate keys or
+     * fields outside the struct, or an error of nvs_open().
+     */
+    esp_err_t init(const Config &config);
+
+    template <typename T, size_t N>
+    esp_err_t init(T &values, const Field (&schema)[N], Config config = {})
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "the settings struct is copied bytewise");
+        static_assert(N <= max_fields, "too many fields for one store");
+        config.values = &values;
+        config.size = sizeof(T);
+        config.schema = schema;
+        config.field_count = N;
+        return init(config);
+    }
+
+    /** Commit what is dirty, stop the task and close NVS. The struct keeps its values. */
+    void deinit();
+
+    /**
+     * @brief Set field @p index to @p value.
+     *
+     * @return ESP_ERR_INVALID_ARG for an unknown field, ESP_ERR_INVALID_SIZE if
+     * @p size is not the field's (a string field takes up to its size, NUL included).
+     */
+    esp_err_t set(size_t index, const void *value, size_t size);
+
+    template <typename S, typename M>
+    esp_err_t set(M S::*member, const M &value)
+    {
+        return set(index_of(member), &value, sizeof(M));
+    }
+
+    /** Set a char-array member from a NUL-terminated string. */
+    template <typename S, size_t N>
+    esp_err_t set_string(char (S::*member)[N], const char *value)
+    {
+        return set_string(index_of(member), value);
+    }
+    esp_err_t set_string(size_t index, const char *value);
+
+    /** Restore a field to the value it had before init() loaded NVS. */
+    esp_err_t reset(size_t index);
+
+    /** Copy the whole settings struct, consistent with respect to set(). */
+    esp_err_t snapshot(void *out, size_t size) const;
+
+    template <typename T>
+    esp_err_t snapshot(T &out) const
+    {
+        return snapshot(&out, sizeof(T));
+    }
+
+    /** Call @p fn after every change to a field. Listeners run on the task that called set(). */
+    esp_err_t listen(ChangeFn fn, void *ctx = nullptr);
+
+    /** Write and commit dirty fields now, without waiting out the delays. */
+    esp_err_t flush();
+
+    /** Index of the field at @p member, or field_count() if the schema has none there. */
+    template <typename S, typename M>
+    size_t index_of(M S::*member) const
+    {
+        if (values_ == nullptr) {
+            return field_count();
+        }
+        return index_at(&(reinterpret_cast<const S *>(values_)->*member));
+    }
+
+    /** Index of the field stored under @p key, or field_count(). */
+    size_t find(const char *key) const;
+    size_t field_count() const { return config_.field_count; }
+    const Field &field(size_t index) const { return config_.schema[index]; }
+
+    /**
+     * @brief Sequence count of changes: odd while a set() is writing the struct.
+     *
+     * Members read between two equal, even values were read with no set() in
+     * between; compare to a value saved earlier to notice any change at all.
+     */
+    uint32_t version() const { return version_.load(std::memory_order_acquire); }
+
+    Stats stats() const;
+
+private:
+    static void task_entry(void *arg);
+
+    void run();
+    size_t index_at(const void *address) const;
+    esp_err_t apply(size_t index, const void *value, size_t len);
+    esp_err_t load(const Field &field, uint8_t *out);
+    esp_err_t write(const Field &field, const uint8_t *value);
+    esp_err_t commit();
+
+    Config config_;
+    TaskHandle_t task_ = nullptr;
+    uint32_t handle_ = 0;
+    bool open_ = false;
+    /* Guards the struct against snapshot(), and the fields below. */
+    mutable SemaphoreHandle_t lock_ = nullptr;
+    /* Held across one batch of NVS writes, so flush() and the task do not interleave. */
+    SemaphoreHandle_t commit_lock_ = nullptr;
+    uint8_t *values_ = nullptr;
+    /* The struct's contents before init() loaded NVS. */
+    uint8_t *defaults_ = nullptr;
+    /* What NVS holds (defaults for absent keys), and a batch copied out for writing. */
+    uint8_t *flash_ = nullptr;
+    uint8_t *staging_ = nullptr;
+    uint64_t dirty_ = 0;
+    int64_t first_dirty_us_ = 0;
+    int64_t last_set_us_ = 0;
+    ChangeFn listeners_[max_listeners] = {};
+    void *listener_ctx_[max_listeners] = {};
+    size_t listener_count_ = 0;
+    std::atomic<uint32_t> version_{0};
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> running_{false};
+
+    Stats stats_ = {};
+};
+
+} // namespace config_store
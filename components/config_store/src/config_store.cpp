@@ -0,0 +1,536 @@
+#include "config_store/config_store.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+static const char *TAG = "config_store";
+
+namespace config_store {
+
+namespace {
+
+template <typename T>
+T read_as(const uint8_t *p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <typename T>
+void write_as(uint8_t *p, T v)
+{
+    memcpy(p, &v, sizeof(T));
+}
+
+/* A string field holds a NUL within its size. */
+bool terminated(const uint8_t *p, size_t size)
+{
+    return memchr(p, '\0', size) != nullptr;
+}
+
+} // namespace
+
+esp_err_t Store::init(const Config &config)
+{
+    if (values_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.values == nullptr || config.size == 0 || config.schema == nullptr || config.field_count == 0 ||
+        config.field_count > max_fields || config.nvs_namespace == nullptr ||
+        config.max_commit_delay_ms < config.commit_delay_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < config.field_count; ++i) {
+        const Field &f = config.schema[i];
+        if (f.key == nullptr || f.size == 0 || f.offset + f.size > config.size) {
+            ESP_LOGE(TAG, "field %u lies outside the %u-byte struct", static_cast<unsigned>(i),
+                     static_cast<unsigned>(config.size));
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (size_t k = 0; k < i; ++k) {
+            if (strcmp(config.schema[k].key, f.key) == 0) {
+                ESP_LOGE(TAG, "key %s appears twice", f.key);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+    config_ = config;
+
+    constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    defaults_ = static_cast<uint8_t *>(heap_caps_malloc(config_.size, caps));
+    flash_ = static_cast<uint8_t *>(heap_caps_malloc(config_.size, caps));
+    staging_ = static_cast<uint8_t *>(heap_caps_malloc(config_.size, caps));
+    lock_ = xSemaphoreCreateMutex();
+    commit_lock_ = xSemaphoreCreateMutex();
+    if (defaults_ == nullptr || flash_ == nullptr || staging_ == nullptr || lock_ == nullptr ||
+        commit_lock_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(config_.nvs_namespace, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "nvs_open(%s) failed: %s", config_.nvs_namespace, esp_err_to_name(err));
+        deinit();
+        return err;
+    }
+    handle_ = handle;
+    open_ = true;
+
+    values_ = static_cast<uint8_t *>(config_.values);
+    memcpy(defaults_, values_, config_.size);
+    stats_ = {};
+    for (size_t i = 0; i < config_.field_count; ++i) {
+        const Field &f = config_.schema[i];
+        err = load(f, values_ + f.offset);
+        if (err == ESP_OK) {
+            ++stats_.loaded;
+        } else if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "%s not loaded (%s), keeping its default", f.key, esp_err_to_name(err));
+        }
+    }
+    memcpy(flash_, values_, config_.size);
+    dirty_ = 0;
+    listener_count_ = 0;
+    version_.store(0, std::memory_order_relaxed);
+
+    stopping_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(task_entry, config_.task_name, config_.stack_size, this, config_.priority, &task_,
+                                config_.core) != pdPASS) {
+        running_.store(false, std::memory_order_relaxed);
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "%s: %u of %u fields loaded", config_.nvs_namespace, static_cast<unsigned>(stats_.loaded),
+             static_cast<unsigned>(config_.field_count));
+    return ESP_OK;
+}
+
+void Store::deinit()
+{
+    stopping_.store(true, std::memory_order_seq_cst);
+    if (task_ != nullptr) {
+        xTaskNotifyGive(task_);
+        while (running_.load(std::memory_order_acquire)) {
+            vTaskDelay(1);
+        }
+        task_ = nullptr;
+    }
+    if (open_) {
+        if (values_ != nullptr) {
+            commit();
+        }
+        nvs_close(handle_);
+        open_ = false;
+    }
+    if (commit_lock_ != nullptr) {
+        vSemaphoreDelete(commit_lock_);
+        commit_lock_ = nullptr;
+    }
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+    heap_caps_free(defaults_);
+    heap_caps_free(flash_);
+    heap_caps_free(staging_);
+    defaults_ = nullptr;
+    flash_ = nullptr;
+    staging_ = nullptr;
+    values_ = nullptr;
+    dirty_ = 0;
+}
+
+esp_err_t Store::load(const Field &f, uint8_t *out)
+{
+    esp_err_t err = ESP_OK;
+    switch (f.type) {
+    case Type::boolean: {
+        uint8_t v;
+        err = nvs_get_u8(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as<bool>(out, v != 0);
+        }
+        break;
+    }
+    case Type::u8:
+        err = nvs_get_u8(handle_, f.key, out);
+        break;
+    case Type::i8:
+        err = nvs_get_i8(handle_, f.key, reinterpret_cast<int8_t *>(out));
+        break;
+    case Type::u16: {
+        uint16_t v;
+        err = nvs_get_u16(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::i16: {
+        int16_t v;
+        err = nvs_get_i16(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::u32:
+    case Type::f32: {
+        uint32_t v;
+        err = nvs_get_u32(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::i32: {
+        int32_t v;
+        err = nvs_get_i32(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::u64:
+    case Type::f64: {
+        uint64_t v;
+        err = nvs_get_u64(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::i64: {
+        int64_t v;
+        err = nvs_get_i64(handle_, f.key, &v);
+        if (err == ESP_OK) {
+            write_as(out, v);
+        }
+        break;
+    }
+    case Type::str: {
+        /* Read into staging_ first: a string too long for the field leaves the default alone. */
+        size_t len = f.size;
+        err = nvs_get_str(handle_, f.key, reinterpret_cast<char *>(staging_), &len);
+        if (err == ESP_OK) {
+            memset(out, 0, f.size);
+            memcpy(out, staging_, len);
+        }
+        break;
+    }
+    case Type::blob: {
+        size_t len = 0;
+        err = nvs_get_blob(handle_, f.key, nullptr, &len);
+        if (err == ESP_OK && len != f.size) {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        if (err == ESP_OK) {
+            err = nvs_get_blob(handle_, f.key, out, &len);
+        }
+        break;
+    }
+    }
+    return err;
+}
+
+esp_err_t Store::write(const Field &f, const uint8_t *v)
+{
+    switch (f.type) {
+    case Type::boolean:
+        return nvs_set_u8(handle_, f.key, read_as<bool>(v) ? 1 : 0);
+    case Type::u8:
+        return nvs_set_u8(handle_, f.key, v[0]);
+    case Type::i8:
+        return nvs_set_i8(handle_, f.key, static_cast<int8_t>(v[0]));
+    case Type::u16:
+        return nvs_set_u16(handle_, f.key, read_as<uint16_t>(v));
+    case Type::i16:
+        return nvs_set_i16(handle_, f.key, read_as<int16_t>(v));
+    case Type::u32:
+    case Type::f32:
+        return nvs_set_u32(handle_, f.key, read_as<uint32_t>(v));
+    case Type::i32:
+        return nvs_set_i32(handle_, f.key, read_as<int32_t>(v));
+    case Type::u64:
+    case Type::f64:
+        return nvs_set_u64(handle_, f.key, read_as<uint64_t>(v));
+    case Type::i64:
+        return nvs_set_i64(handle_, f.key, read_as<int64_t>(v));
+    case Type::str:
+        return nvs_set_str(handle_, f.key, reinterpret_cast<const char *>(v));
+    case Type::blob:
+        return nvs_set_blob(handle_, f.key, v, f.size);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t Store::set(size_t index, const void *value, size_t size)
+{
+    if (values_ == nullptr || index >= config_.field_count || value == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const Field &f = config_.schema[index];
+    if (f.type == Type::str ? size > f.size || !terminated(static_cast<const uint8_t *>(value), size)
+                            : size != f.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return apply(index, value, size);
+}
+
+esp_err_t Store::set_string(size_t index, const char *value)
+{
+    if (value == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (values_ != nullptr && index < config_.field_count && config_.schema[index].type != Type::str) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return set(index, value, strnlen(value, UINT16_MAX) + 1);
+}
+
+esp_err_t Store::reset(size_t index)
+{
+    if (values_ == nullptr || index >= config_.field_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const Field &f = config_.schema[index];
+    return apply(index, defaults_ + f.offset, f.size);
+}
+
+esp_err_t Store::apply(size_t index, const void *value, size_t len)
+{
+    /* A string shorter than its field is compared and stored zero-padded. */
+    const Field &f = config_.schema[index];
+    uint8_t *dst = values_ + f.offset;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    bool same = memcmp(dst, value, len) == 0;
+    for (size_t i = len; same && i < f.size; ++i) {
+        same = dst[i] == 0;
+    }
+    if (same) {
+        ++stats_.unchanged_sets;
+        xSemaphoreGive(lock_);
+        return ESP_OK;
+    }
+    uint32_t version = version_.load(std::memory_order_relaxed);
+    version_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(dst, value, len);
+    memset(dst + len, 0, f.size - len);
+    version_.store(version + 2, std::memory_order_release);
+    ++stats_.sets;
+    int64_t now = esp_timer_get_time();
+    bool wake = dirty_ == 0;
+    if (wake) {
+        first_dirty_us_ = now;
+    }
+    dirty_ |= uint64_t{1} << index;
+    last_set_us_ = now;
+    size_t listeners = listener_count_;
+    xSemaphoreGive(lock_);
+
+    /* An idle task sleeps until something is dirty; once it is, the task
+     * works its deadline out from last_set_us_ itself. */
+    if (wake) {
+        xTaskNotifyGive(task_);
+    }
+    for (size_t i = 0; i < listeners; ++i) {
+        listeners_[i](listener_ctx_[i], f);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Store::snapshot(void *out, size_t size) const
+{
+    if (values_ == nullptr || out == nullptr || size != config_.size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    memcpy(out, values_, size);
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Store::listen(ChangeFn fn, void *ctx)
+{
+    if (values_ == nullptr || fn == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (listener_count_ == max_listeners) {
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NO_MEM;
+    }
+    listeners_[listener_count_] = fn;
+    listener_ctx_[listener_count_] = ctx;
+    ++listener_count_;
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Store::flush()
+{
+    if (values_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return commit();
+}
+
+esp_err_t Store::commit()
+{
+    xSemaphoreTake(commit_lock_, portMAX_DELAY);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint64_t batch = dirty_;
+    dirty_ = 0;
+    for (size_t i = 0; i < config_.field_count; ++i) {
+        if (batch & (uint64_t{1} << i)) {
+            const Field &f = config_.schema[i];
+            memcpy(staging_ + f.offset, values_ + f.offset, f.size);
+        }
+    }
+    xSemaphoreGive(lock_);
+
+    /* NVS is written from the copy, so set() and snapshot() never wait on flash. */
+    uint64_t failed = 0;
+    uint32_t written = 0;
+    uint32_t coalesced = 0;
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < config_.field_count; ++i) {
+        uint64_t bit = uint64_t{1} << i;
+        if (!(batch & bit)) {
+            continue;
+        }
+        const Field &f = config_.schema[i];
+        if (memcmp(staging_ + f.offset, flash_ + f.offset, f.size) == 0) {
+            ++coalesced;
+            continue;
+        }
+        esp_err_t err = write(f, staging_ + f.offset);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "writing %s failed: %s", f.key, esp_err_to_name(err));
+            failed |= bit;
+            result = err;
+        } else {
+            ++written;
+        }
+    }
+    bool committed = false;
+    if (written != 0) {
+        esp_err_t err = nvs_commit(handle_);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "nvs_commit failed: %s", esp_err_to_name(err));
+            failed = batch;
+            result = err;
+        } else {
+            committed = true;
+        }
+    }
+    for (size_t i = 0; committed && i < config_.field_count; ++i) {
+        if ((batch & ~failed) & (uint64_t{1} << i)) {
+            const Field &f = config_.schema[i];
+            memcpy(flash_ + f.offset, staging_ + f.offset, f.size);
+        }
+    }
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (committed) {
+        ++stats_.commits;
+        stats_.keys_written += written;
+    }
+    stats_.coalesced += coalesced;
+    if (failed != 0) {
+        /* Retried a full delay later, not in a tight loop against a failing flash. */
+        ++stats_.errors;
+        if (dirty_ == 0) {
+            first_dirty_us_ = esp_timer_get_time();
+        }
+        dirty_ |= failed;
+        last_set_us_ = esp_timer_get_time();
+    }
+    xSemaphoreGive(lock_);
+    xSemaphoreGive(commit_lock_);
+    return result;
+}
+
+void Store::task_entry(void *arg)
+{
+    static_cast<Store *>(arg)->run();
+}
+
+void Store::run()
+{
+    TickType_t timeout = portMAX_DELAY;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, timeout);
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        bool dirty = dirty_ != 0;
+        int64_t due_us = std::min<int64_t>(last_set_us_ + int64_t{config_.commit_delay_ms} * 1000,
+                                           first_dirty_us_ + int64_t{config_.max_commit_delay_ms} * 1000);
+        xSemaphoreGive(lock_);
+        if (!dirty) {
+            timeout = portMAX_DELAY;
+            continue;
+        }
+        int64_t wait_us = due_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            timeout = std::max<TickType_t>(1, pdMS_TO_TICKS((wait_us + 999) / 1000));
+            continue;
+        }
+        commit();
+        /* A failed batch is dirty again; go round to wait out its delay. */
+        timeout = 0;
+    }
+    running_.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+size_t Store::index_at(const void *address) const
+{
+    const uint8_t *p = static_cast<const uint8_t *>(address);
+    if (p >= values_ && p < values_ + config_.size) {
+        size_t offset = static_cast<size_t>(p - values_);
+        for (size_t i = 0; i < config_.field_count; ++i) {
+            if (config_.schema[i].offset == offset) {
+                return i;
+            }
+        }
+    }
+    return config_.field_count;
+}
+
+size_t Store::find(const char *key) const
+{
+    for (size_t i = 0; key != nullptr && i < config_.field_count; ++i) {
+        if (strcmp(config_.schema[i].key, key) == 0) {
+            return i;
+        }
+    }
+    return config_.field_count;
+}
+
+Stats Store::stats() const
+{
+    Stats s = {};
+    if (lock_ == nullptr) {
+        return s;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    s = stats_;
+    s.dirty = static_cast<uint32_t>(__builtin_popcountll(dirty_));
+    xSemaphoreGive(lock_);
+    return s;
+}
+
+} // namespace config_store
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <coroutine>
+
+#include "coro/scheduler.hpp"
+#include "freertos/FreeRTOS.h"
+
+namespace coro {
+
+/**
+ * @brief Manual-reset event: set() from any task or ISR releases every waiter.
+ *
+ * The coroutine counterpart of an event-group bit. Waiters may be on
+ * different schedulers; each is resumed on its own. Stays set until reset(),
+ * so a wait() after set() completes immediately.
+ */
+class Event {
+public:
+    Event() = default;
+
+    Event(const Event &) = delete;
+    Event &operator=(const Event &) = delete;
+
+    void set();
+    void reset();
+    bool is_set() const { return set_; }
+
+    auto wait(Scheduler &scheduler)
+    {
+        struct Awaiter {
+            bool await_ready() noexcept { return event->is_set(); }
+            bool await_suspend(std::coroutine_handle<> h) noexcept
+            {
+                node.handle = h;
+                return event->enqueue(&node);
+            }
+            void await_resume() noexcept {}
+
+            Event *event;
+            detail::Waiter node;
+        };
+        Awaiter a{this, {}};
+        a.node.scheduler = &scheduler;
+        return a;
+    }
+
+private:
+    /* @return false (resume now) if the event was set meanwhile. */
+    bool enqueue(detail::Waiter *w);
+
+    portMUX_TYPE lock_ = portMUX_INITIALIZER_UNLOCKED;
+    volatile bool set_ = false;
+    detail::Waiter *waiters_ = nullptr;
+};
+
+} // namespace coro
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+#include "esp_err.h"
+#include "mem_pool/placement.hpp"
+
+namespace coro {
+
+/**
+ * @brief Slab pools coroutine frames are carved from.
+ *
+ * Frames are rounded up to the smallest class that fits (128, 256 or 512
+ * bytes); larger frames, and any frame once its class is exhausted, come from
+ * the heap. Pools show up in mem_pool::log_stats() as coro_128 etc., which is
+ * the quickest way to size them. Call once at startup, before any coroutine
+ * is created; without it every frame is a heap allocation.
+ */
+struct FramePoolConfig {
+    size_t count_128 = 64;
+    size_t count_256 = 32;
+    size_t count_512 = 16;
+    mem_pool::Placement placement = mem_pool::Placement::Internal;
+};
+
+esp_err_t init_frame_pools(const FramePoolConfig &config);
+
+} // namespace coro
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+
+#include "coro/scheduler.hpp"
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+namespace coro {
+
+/**
+ * @brief Await edges on one GPIO.
+ *
+ * Edges are counted in the ISR, so none are lost while no coroutine is
+ * waiting; wait() returns the number seen since the previous wait (at least
+ * one). One coroutine waits at a time.
+ */
+class GpioEdge {
+public:
+    GpioEdge() = default;
+    ~GpioEdge() { deinit(); }
+
+    GpioEdge(const GpioEdge &) = delete;
+    GpioEdge &operator=(const GpioEdge &) = delete;
+
+    /**
+     * @brief Attach to @p pin, which must already be configured as an input.
+     *
+     * Installs the shared GPIO ISR service if nobody has yet.
+     */
+    esp_err_t init(gpio_num_t pin, gpio_int_type_t edge);
+    void deinit();
+
+    auto wait(Scheduler &scheduler)
+    {
+        struct Awaiter {
+            bool await_ready() noexcept { return gpio->pending_.load(std::memory_order_acquire) != 0; }
+            bool await_suspend(std::coroutine_handle<> h) noexcept
+            {
+                node.handle = h;
+                gpio->waiter_.store(&node, std::memory_order_seq_cst);
+                /* An edge between await_ready() and the store above: take the
+                 * waiter back unless the ISR already claimed it. */
+                if (gpio->pending_.load(std::memory_order_seq_cst) != 0 &&
+                    gpio->waiter_.exchange(nullptr, std::memory_order_acq_rel) == &node) {
+                    return false;
+                }
+                return true;
+            }
+            uint32_t await_resume() noexcept { return gpio->pending_.exchange(0, std::memory_order_acq_rel); }
+
+            GpioEdge *gpio;
+            detail::Waiter node;
+        };
+        Awaiter a{this, {}};
+        a.node.scheduler = &scheduler;
+        return a;
+    }
+
+private:
+    static void isr(void *arg);
+
+    gpio_num_t pin_ = GPIO_NUM_NC;
+    std::atomic<uint32_t> pending_{0};
+    std::atomic<detail::Waiter *> waiter_{nullptr};
+};
+
+} // namespace coro
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+
+#include "coro/task.hpp"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+namespace coro {
+
+struct SchedulerStats {
+    uint32_t resumes;
+    /** Wakeups posted from other tasks or ISRs. */
+    uint32_t remote_wakeups;
+    /** Spawned coroutines that have not finished. */
+    uint32_t live;
+    uint32_t sleeping;
+    uint32_t io_waiting;
+};
+
+/**
+ * @brief Runs coroutines on one FreeRTOS task.
+ *
+ * Every coroutine spawned here, and everything it awaits, resumes on this
+ * task's stack; a suspended coroutine costs only its frame (typically
+ * 100-400 bytes) instead of a task stack, so thousands of concurrent flows
+ * fit where a handful of tasks did, and switching between them is a
+ * function call rather than a context switch. Use one scheduler per core
+ * that should run coroutines.
+ *
+ * Wakeups from other tasks and ISRs (events, GPIO edges, SPI completion)
+ * are pushed onto a lock-free intrusive stack and the scheduler task is woken
+ * with a task notification; post() is in IRAM, so IRAM ISRs may use it.
+ * Sleeps share one esp_timer armed for the earliest deadline. Socket waits go
+ * to a small poller task that select()s over every waiting descriptor and
+ * posts the ready ones back, so the scheduler itself only ever blocks on its
+ * notification.
+ *
+ * Coroutines must not block the task (vTaskDelay, blocking socket calls,
+ * xQueueReceive with a timeout): that stalls every other flow on it.
+ */
+class Scheduler {
+public:
+    struct Config {
+        const char *name = "coro";
+        uint32_t stack_size = 6144;
+        UBaseType_t priority = 5;
+        BaseType_t core = tskNO_AFFINITY;
+        /** Start the socket poller task (registers the eventfd VFS if needed). */
+        bool enable_io = true;
+        uint32_t io_stack_size = 3072;
+    };
+
+    Scheduler() = default;
+    ~Scheduler() { deinit(); }
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    esp_err_t init(const Config &config);
+
+    /**
+     * @brief Stop the task once it is idle.
+     *
+     * Coroutines still suspended at that point are abandoned, not destroyed
+     * (their awaiters may be registered with objects the scheduler does not
+     * own); finish or cancel flows first.
+     */
+    void deinit();
+
+    /**
+     * @brief Start @p task as a detached flow; its frame is freed when it returns.
+     *
+     * Callable from any task. @return ESP_ERR_NO_MEM if the frame could not
+     * be allocated.
+     */
+    esp_err_t spawn(Task<void> &&task);
+
+    /** @name Awaitables that suspend the calling coroutine on this scheduler. */
+    /** @{ */
+
+    /** Requeue behind every coroutine already ready to run. */
+    auto yield()
+    {
+        struct Awaiter : detail::Waiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) noexcept
+            {
+                handle = h;
+                scheduler->post_local(this);
+            }
+            void await_resume() noexcept {}
+        };
+        Awaiter a;
+        a.scheduler = this;
+        return a;
+    }
+
+    struct SleepAwaiter;
+    struct IoAwaiter;
+
+    /** Resume after @p us microseconds (esp_timer resolution). */
+    SleepAwaiter sleep_us(int64_t us);
+    SleepAwaiter sleep_ms(uint32_t ms);
+    /** Resume at esp_timer_get_time() >= @p deadline_us. */
+    SleepAwaiter sleep_until(int64_t deadline_us);
+
+    /** Resume once @p fd is readable (or has an error pending). */
+    IoAwaiter readable(int fd);
+    IoAwaiter writable(int fd);
+
+    /** @} */
+
+    /** Queue @p w from any task or ISR; see class comment. */
+    void post(detail::Waiter *w);
+
+    /** Queue @p w from the scheduler task itself (no atomics, no wakeup). */
+    void post_local(detail::Waiter *w);
+
+    /** True if the caller is running on this scheduler's task. */
+    bool on_scheduler() const { return xTaskGetCurrentTaskHandle() == task_; }
+
+    SchedulerStats stats() const;
+
+    struct SleepAwaiter {
+        bool await_ready() noexcept { return deadline_us <= esp_timer_get_time(); }
+        void await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            node.handle = h;
+            scheduler->add_timer(this);
+        }
+        void await_resume() noexcept {}
+
+        detail::Waiter node;
+        Scheduler *scheduler;
+        int64_t deadline_us;
+        /* Pairing-heap links, owned by the scheduler while queued. */
+        SleepAwaiter *child = nullptr;
+        SleepAwaiter *sibling = nullptr;
+    };
+
+    struct IoAwaiter {
+        bool await_ready() noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            node.handle = h;
+            return scheduler->add_io(this);
+        }
+        /** @return false if the scheduler has no I/O support (enable_io off). */
+        bool await_resume() noexcept { return ok; }
+
+        detail::Waiter node;
+        Scheduler *scheduler;
+        int fd;
+        bool write;
+        bool ok = true;
+        IoAwaiter *next_io = nullptr;
+    };
+
+private:
+    static void scheduler_task(void *arg);
+    static void io_task(void *arg);
+    static void timer_callback(void *arg);
+    static void on_root_done(Scheduler *scheduler);
+
+    void run();
+    void run_ready();
+    void take_remote();
+    void fire_timers(int64_t now);
+    void arm_timer();
+    void add_timer(SleepAwaiter *s);
+    bool add_io(IoAwaiter *io);
+    void poll_io();
+    void wake();
+
+    static SleepAwaiter *meld(SleepAwaiter *a, SleepAwaiter *b);
+    static SleepAwaiter *merge_pairs(SleepAwaiter *first);
+
+    Config config_;
+    TaskHandle_t task_ = nullptr;
+    TaskHandle_t io_task_ = nullptr;
+    esp_timer_handle_t timer_ = nullptr;
+    /* Wakes the poller when waiters are added or on shutdown. */
+    int event_fd_ = -1;
+
+    /* Ready FIFO, touched only by the scheduler task. */
+    detail::Waiter *ready_head_ = nullptr;
+    detail::Waiter *ready_tail_ = nullptr;
+    /* Remote wakeups: intrusive Treiber stack, drained all at once. */
+    std::atomic<detail::Waiter *> remote_{nullptr};
+    std::atomic<bool> timer_fired_{false};
+
+    SleepAwaiter *timers_ = nullptr;
+    int64_t armed_deadline_us_ = INT64_MAX;
+    /* Shared with the poller task. */
+    portMUX_TYPE io_lock_ = portMUX_INITIALIZER_UNLOCKED;
+    IoAwaiter *io_waiters_ = nullptr;
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint32_t> running_tasks_{0};
+
+    /* Written by the scheduler task, read approximately by stats(). */
+    uint32_t resumes_ = 0;
+    uint32_t sleeping_ = 0;
+    std::atomic<uint32_t> io_waiting_{0};
+    std::atomic<uint32_t> remote_wakeups_{0};
+    std::atomic<uint32_t> live_{0};
+};
+
+inline Scheduler::SleepAwaiter Scheduler::sleep_until(int64_t deadline_us)
+{
+    SleepAwaiter s;
+    s.node.scheduler = this;
+    s.scheduler = this;
+    s.deadline_us = deadline_us;
+    return s;
+}
+
+inline Scheduler::SleepAwaiter Scheduler::sleep_us(int64_t us)
+{
+    return sleep_until(esp_timer_get_time() + us);
+}
+
+inline Scheduler::SleepAwaiter Scheduler::sleep_ms(uint32_t ms)
+{
+    return sleep_us(static_cast<int64_t>(ms) * 1000);
+}
+
+inline Scheduler::IoAwaiter Scheduler::readable(int fd)
+{
+    IoAwaiter io;
+    io.node.scheduler = this;
+    io.scheduler = this;
+    io.fd = fd;
+    io.write = false;
+    return io;
+}
+
+inline Scheduler::IoAwaiter Scheduler::writable(int fd)
+{
+    IoAwaiter io = readable(fd);
+    io.write = true;
+    return io;
+}
+
+} // namespace coro
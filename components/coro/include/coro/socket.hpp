@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/types.h>
+
+#include "coro/scheduler.hpp"
+#include "coro/task.hpp"
+#include "lwip/sockets.h"
+
+namespace coro {
+
+/*
+ * Socket operations that suspend instead of blocking. @p fd must be
+ * non-blocking (set_non_blocking()). Failures return -1 with errno set, as
+ * the blocking calls do.
+ */
+
+esp_err_t set_non_blocking(int fd);
+
+/** Up to @p length bytes; 0 at end of stream. */
+Task<ssize_t> async_recv(Scheduler &scheduler, int fd, void *buf, size_t length);
+
+/** All @p length bytes, resuming as the send buffer drains. */
+Task<ssize_t> async_send(Scheduler &scheduler, int fd, const void *buf, size_t length);
+
+/** The accepted descriptor, already non-blocking. */
+Task<int> async_accept(Scheduler &scheduler, int listen_fd);
+
+Task<int> async_connect(Scheduler &scheduler, int fd, const struct sockaddr *addr, socklen_t addr_length);
+
+} // namespace coro
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <coroutine>
+
+#include "coro/scheduler.hpp"
+#include "driver/spi_master.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+namespace coro {
+
+namespace detail {
+
+/* The driver calls post_cb from its ISR a few instructions before it queues
+ * the result, so a scheduler on the other core can ask for the result first.
+ * This is how long it waits for it; two ticks at least, since one can end
+ * at once. */
+constexpr TickType_t spi_result_wait = pdMS_TO_TICKS(10) > 2 ? pdMS_TO_TICKS(10) : 2;
+
+} // namespace detail
+
+/**
+ * @brief post_cb for SPI devices used with spi_transfer().
+ *
+ * Set it in spi_device_interface_config_t::post_cb when adding the device.
+ * It uses spi_transaction_t::user, so transactions on that device must not.
+ * In IRAM, so CONFIG_SPI_MASTER_ISR_IN_IRAM is fine.
+ */
+void spi_post_transfer(spi_transaction_t *trans);
+
+/**
+ * @brief Queue @p trans on @p device and resume when it has completed.
+ *
+ * @p trans and its buffers must stay valid until the await returns (they
+ * normally live in the coroutine frame or its owner). Several coroutines may
+ * have transfers queued on one device; each collects one result from the
+ * driver queue when it resumes, which keeps the driver's in-flight count
+ * right even though results are not matched to their owners. The result can
+ * still be on its way from the ISR when the coroutine resumes on another
+ * core; the awaiter waits for it, which takes a few instructions, not a
+ * transfer.
+ * @return the queue or result error, ESP_OK on success.
+ */
+inline auto spi_transfer(Scheduler &scheduler, spi_device_handle_t device, spi_transaction_t *trans)
+{
+    struct Awaiter {
+        bool await_ready() noexcept { return false; }
+        bool await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            node.handle = h;
+            trans->user = &node;
+            err = spi_device_queue_trans(device, trans, 0);
+            return err == ESP_OK;
+        }
+        esp_err_t await_resume() noexcept
+        {
+            if (err != ESP_OK) {
+                return err;
+            }
+            spi_transaction_t *done = nullptr;
+            return spi_device_get_trans_result(device, &done, detail::spi_result_wait);
+        }
+
+        spi_device_handle_t device;
+        spi_transaction_t *trans;
+        detail::Waiter node;
+        esp_err_t err = ESP_OK;
+    };
+    Awaiter a{device, trans, {}};
+    a.node.scheduler = &scheduler;
+    return a;
+}
+
+} // namespace coro
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace coro {
+
+class Scheduler;
+
+namespace detail {
+
+/**
+ * @brief A suspended coroutine queued for resumption on a scheduler.
+ *
+ * Lives inside the awaiter (and so inside the suspended coroutine's frame),
+ * which keeps every wakeup path - timers, I/O, ISRs - free of allocation.
+ */
+struct Waiter {
+    std::coroutine_handle<> handle;
+    Scheduler *scheduler = nullptr;
+    Waiter *next = nullptr;
+};
+
+void *allocate_frame(size_t size) noexcept;
+void free_frame(void *ptr, size_t size) noexcept;
+
+template <typename T>
+struct Result {
+    template <typename V>
+    void return_value(V &&v)
+    {
+        new (storage) T(std::forward<V>(v));
+        has_value = true;
+    }
+
+    T take() { return std::move(*reinterpret_cast<T *>(storage)); }
+
+    ~Result()
+    {
+        if (has_value) {
+            reinterpret_cast<T *>(storage)->~T();
+        }
+    }
+
+    alignas(T) unsigned char storage[sizeof(T)];
+    bool has_value = false;
+};
+
+template <>
+struct Result<void> {
+    void return_void() {}
+    void take() {}
+};
+
+} // namespace detail
+
+/**
+ * @brief Lazily started coroutine returning T.
+ *
+ * Nothing runs until the Task is co_awaited (the awaiting coroutine resumes
+ * when it finishes, by symmetric transfer, so deep await chains use no
+ * stack) or handed to Scheduler::spawn(). Frames come from the frame pools
+ * (see FramePools) with a heap fallback. If a frame cannot be allocated the
+ * Task is invalid: spawn() reports ESP_ERR_NO_MEM, and awaiting it aborts.
+ *
+ * Exceptions are disabled in this tree, so there is no error channel other
+ * than the return value.
+ */
+template <typename T = void>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : detail::Result<T> {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        static Task get_return_object_on_allocation_failure() { return Task(); }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                promise_type &p = h.promise();
+                if (p.continuation) {
+                    return p.continuation;
+                }
+                /* Spawned root: nobody will read the result. */
+                void (*on_done)(Scheduler *) = p.on_detached_done;
+                Scheduler *scheduler = p.scheduler;
+                h.destroy();
+                if (on_done != nullptr) {
+                    on_done(scheduler);
+                }
+                return std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() noexcept { abort(); }
+
+        static void *operator new(size_t size) noexcept { return detail::allocate_frame(size); }
+        static void operator delete(void *ptr, size_t size) noexcept { detail::free_frame(ptr, size); }
+
+        std::coroutine_handle<> continuation;
+        /* Set by Scheduler::spawn() for detached roots. */
+        detail::Waiter start;
+        Scheduler *scheduler = nullptr;
+        void (*on_detached_done)(Scheduler *) = nullptr;
+    };
+
+    Task() = default;
+    ~Task()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    bool valid() const { return static_cast<bool>(handle_); }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter {
+            bool await_ready() noexcept
+            {
+                if (!handle) {
+                    abort(); /* frame allocation failed */
+                }
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take(); }
+
+            std::coroutine_handle<promise_type> handle;
+        };
+        return Awaiter{handle_};
+    }
+
+    /** Give up ownership of the frame (used by Scheduler::spawn()). */
+    std::coroutine_handle<promise_type> release() { return std::exchange(handle_, nullptr); }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+} // namespace coro
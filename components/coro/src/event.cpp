@@ -0,0 +1,42 @@
+#include "coro/event.hpp"
+
+#include "esp_attr.h"
+
+namespace coro {
+
+void IRAM_ATTR Event::set()
+{
+    portENTER_CRITICAL_SAFE(&lock_);
+    set_ = true;
+    detail::Waiter *w = waiters_;
+    waiters_ = nullptr;
+    portEXIT_CRITICAL_SAFE(&lock_);
+    while (w != nullptr) {
+        /* post() reuses the link. */
+        detail::Waiter *next = w->next;
+        w->scheduler->post(w);
+        w = next;
+    }
+}
+
+void Event::reset()
+{
+    portENTER_CRITICAL(&lock_);
+    set_ = false;
+    portEXIT_CRITICAL(&lock_);
+}
+
+bool Event::enqueue(detail::Waiter *w)
+{
+    portENTER_CRITICAL(&lock_);
+    if (set_) {
+        portEXIT_CRITICAL(&lock_);
+        return false;
+    }
+    w->next = waiters_;
+    waiters_ = w;
+    portEXIT_CRITICAL(&lock_);
+    return true;
+}
+
+} // namespace coro
@@ -0,0 +1,76 @@
+#include "coro/frame_pool.hpp"
+
+#include "coro/task.hpp"
+#include "esp_heap_caps.h"
+#include "mem_pool/slab_pool.hpp"
+
+namespace coro {
+
+namespace {
+
+constexpr size_t class_sizes[] = {128, 256, 512};
+constexpr size_t class_count = sizeof(class_sizes) / sizeof(class_sizes[0]);
+
+mem_pool::SlabPool pools[class_count];
+
+/* Index of the smallest class that fits @p size, or class_count. */
+size_t class_of(size_t size)
+{
+    size_t i = 0;
+    while (i < class_count && class_sizes[i] < size) {
+        ++i;
+    }
+    return i;
+}
+
+} // namespace
+
+esp_err_t init_frame_pools(const FramePoolConfig &config)
+{
+    static const char *const names[class_count] = {"coro_128", "coro_256", "coro_512"};
+    const size_t counts[class_count] = {config.count_128, config.count_256, config.count_512};
+    for (size_t i = 0; i < class_count; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        mem_pool::SlabPool::Config pool;
+        pool.name = names[i];
+        pool.block_size = class_sizes[i];
+        pool.block_count = counts[i];
+        pool.placement = config.placement;
+        esp_err_t err = pools[i].init(pool);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+namespace detail {
+
+void *allocate_frame(size_t size) noexcept
+{
+    size_t c = class_of(size);
+    if (c < class_count && pools[c].block_count() != 0) {
+        void *p = pools[c].allocate();
+        if (p != nullptr) {
+            return p;
+        }
+        pools[c].note_fallback();
+    }
+    return heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+void free_frame(void *ptr, size_t size) noexcept
+{
+    size_t c = class_of(size);
+    if (c < class_count && pools[c].owns(ptr)) {
+        pools[c].deallocate(ptr);
+        return;
+    }
+    heap_caps_free(ptr);
+}
+
+} // namespace detail
+
+} // namespace coro
@@ -0,0 +1,48 @@
+#include "coro/gpio.hpp"
+
+#include "esp_attr.h"
+
+namespace coro {
+
+esp_err_t GpioEdge::init(gpio_num_t pin, gpio_int_type_t edge)
+{
+    if (pin_ != GPIO_NUM_NC) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    pending_.store(0, std::memory_order_relaxed);
+    err = gpio_set_intr_type(pin, edge);
+    if (err == ESP_OK) {
+        err = gpio_isr_handler_add(pin, isr, this);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+    pin_ = pin;
+    return gpio_intr_enable(pin);
+}
+
+void GpioEdge::deinit()
+{
+    if (pin_ == GPIO_NUM_NC) {
+        return;
+    }
+    gpio_intr_disable(pin_);
+    gpio_isr_handler_remove(pin_);
+    pin_ = GPIO_NUM_NC;
+}
+
+void IRAM_ATTR GpioEdge::isr(void *arg)
+{
+    auto *self = static_cast<GpioEdge *>(arg);
+    self->pending_.fetch_add(1, std::memory_order_seq_cst);
+    detail::Waiter *w = self->waiter_.exchange(nullptr, std::memory_order_acq_rel);
+    if (w != nullptr) {
+        w->scheduler->post(w);
+    }
+}
+
+} // namespace coro
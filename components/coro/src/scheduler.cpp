@@ -0,0 +1,406 @@
+#include "coro/scheduler.hpp"
+
+#include <cerrno>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_vfs_eventfd.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "coro";
+
+namespace coro {
+
+esp_err_t Scheduler::init(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    config_ = config;
+
+    esp_timer_create_args_t args = {};
+    args.callback = timer_callback;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = config.name;
+    esp_err_t err = esp_timer_create(&args, &timer_);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    stopping_.store(false, std::memory_order_relaxed);
+    if (config.enable_io) {
+        esp_vfs_eventfd_config_t eventfd_config = {};
+        eventfd_config.max_fds = 5;
+        err = esp_vfs_eventfd_register(&eventfd_config);
+        if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+            deinit();
+            return err;
+        }
+        event_fd_ = eventfd(0, 0);
+        if (event_fd_ < 0) {
+            ESP_LOGE(TAG, "eventfd failed: errno %d", errno);
+            deinit();
+            return ESP_ERR_NO_MEM;
+        }
+        running_tasks_.fetch_add(1, std::memory_order_relaxed);
+        if (xTaskCreatePinnedToCore(io_task, "coro_io", config.io_stack_size, this, config.priority, &io_task_,
+                                    config.core) != pdPASS) {
+            running_tasks_.fetch_sub(1, std::memory_order_relaxed);
+            deinit();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    running_tasks_.fetch_add(1, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(scheduler_task, config.name, config.stack_size, this, config.priority, &task_,
+                                config.core) != pdPASS) {
+        running_tasks_.fetch_sub(1, std::memory_order_relaxed);
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void Scheduler::deinit()
+{
+    stopping_.store(true, std::memory_order_seq_cst);
+    if (task_ != nullptr) {
+        xTaskNotifyGive(task_);
+    }
+    if (event_fd_ >= 0) {
+        uint64_t one = 1;
+        write(event_fd_, &one, sizeof(one));
+    }
+    while (running_tasks_.load(std::memory_order_acquire) != 0) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    io_task_ = nullptr;
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+        event_fd_ = -1;
+    }
+    if (timer_ != nullptr) {
+        esp_timer_stop(timer_);
+        esp_timer_delete(timer_);
+        timer_ = nullptr;
+    }
+    if (live_.load(std::memory_order_relaxed) != 0) {
+        ESP_LOGW(TAG, "%s stopped with %u coroutines suspended", config_.name,
+                 static_cast<unsigned>(live_.load(std::memory_order_relaxed)));
+    }
+    ready_head_ = ready_tail_ = nullptr;
+    remote_.store(nullptr, std::memory_order_relaxed);
+    timers_ = nullptr;
+    armed_deadline_us_ = INT64_MAX;
+    io_waiters_ = nullptr;
+}
+
+esp_err_t Scheduler::spawn(Task<void> &&task)
+{
+    if (!task.valid()) {
+        return ESP_ERR_NO_MEM;
+    }
+    auto handle = task.release();
+    auto &promise = handle.promise();
+    promise.scheduler = this;
+    promise.on_detached_done = on_root_done;
+    promise.start.handle = handle;
+    promise.start.scheduler = this;
+    live_.fetch_add(1, std::memory_order_relaxed);
+    post(&promise.start);
+    return ESP_OK;
+}
+
+void Scheduler::on_root_done(Scheduler *scheduler)
+{
+    scheduler->live_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void IRAM_ATTR Scheduler::post(detail::Waiter *w)
+{
+    const bool in_isr = xPortInIsrContext();
+    if (!in_isr && xTaskGetCurrentTaskHandle() == task_) {
+        post_local(w);
+        return;
+    }
+    detail::Waiter *head = remote_.load(std::memory_order_relaxed);
+    do {
+        w->next = head;
+    } while (!remote_.compare_exchange_weak(head, w, std::memory_order_release, std::memory_order_relaxed));
+    remote_wakeups_.fetch_add(1, std::memory_order_relaxed);
+    /* Only the push onto an empty stack needs to wake the task: a non-empty
+     * stack means a wakeup is already pending or the task has yet to drain. */
+    if (head != nullptr) {
+        return;
+    }
+    if (in_isr) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(task_, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(task_);
+    }
+}
+
+void Scheduler::post_local(detail::Waiter *w)
+{
+    w->next = nullptr;
+    if (ready_tail_ != nullptr) {
+        ready_tail_->next = w;
+    } else {
+        ready_head_ = w;
+    }
+    ready_tail_ = w;
+}
+
+void Scheduler::take_remote()
+{
+    detail::Waiter *w = remote_.exchange(nullptr, std::memory_order_acquire);
+    /* The stack is newest-first; reverse it so wakeups run in posting order. */
+    detail::Waiter *fifo = nullptr;
+    while (w != nullptr) {
+        detail::Waiter *next = w->next;
+        w->next = fifo;
+        fifo = w;
+        w = next;
+    }
+    while (fifo != nullptr) {
+        detail::Waiter *next = fifo->next;
+        post_local(fifo);
+        fifo = next;
+    }
+}
+
+void Scheduler::run_ready()
+{
+    /* Run what is ready now; anything queued meanwhile waits for the next
+     * round, so timers and remote wakeups are never starved by yield loops. */
+    detail::Waiter *w = ready_head_;
+    ready_head_ = ready_tail_ = nullptr;
+    while (w != nullptr) {
+        /* Resuming may destroy the frame w lives in, or requeue it. */
+        detail::Waiter *next = w->next;
+        ++resumes_;
+        w->handle.resume();
+        w = next;
+    }
+}
+
+Scheduler::SleepAwaiter *Scheduler::meld(SleepAwaiter *a, SleepAwaiter *b)
+{
+    if (a == nullptr) {
+        return b;
+    }
+    if (b == nullptr) {
+        return a;
+    }
+    if (b->deadline_us < a->deadline_us) {
+        SleepAwaiter *t = a;
+        a = b;
+        b = t;
+    }
+    b->sibling = a->child;
+    a->child = b;
+    return a;
+}
+
+Scheduler::SleepAwaiter *Scheduler::merge_pairs(SleepAwaiter *first)
+{
+    /* Standard two-pass pairing: meld neighbours left to right, then fold the
+     * pairs right to left. */
+    SleepAwaiter *pairs = nullptr;
+    while (first != nullptr) {
+        SleepAwaiter *a = first;
+        SleepAwaiter *b = a->sibling;
+        if (b == nullptr) {
+            a->sibling = pairs;
+            pairs = a;
+            break;
+        }
+        first = b->sibling;
+        a->sibling = nullptr;
+        b->sibling = nullptr;
+        SleepAwaiter *m = meld(a, b);
+        m->sibling = pairs;
+        pairs = m;
+    }
+    SleepAwaiter *root = nullptr;
+    while (pairs != nullptr) {
+        SleepAwaiter *next = pairs->sibling;
+        pairs->sibling = nullptr;
+        root = meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+void Scheduler::add_timer(SleepAwaiter *s)
+{
+    s->child = nullptr;
+    s->sibling = nullptr;
+    timers_ = meld(timers_, s);
+    ++sleeping_;
+    if (s->deadline_us < armed_deadline_us_) {
+        arm_timer();
+    }
+}
+
+void Scheduler::fire_timers(int64_t now)
+{
+    while (timers_ != nullptr && timers_->deadline_us <= now) {
+        SleepAwaiter *s = timers_;
+        timers_ = merge_pairs(s->child);
+        --sleeping_;
+        post_local(&s->node);
+    }
+}
+
+void Scheduler::arm_timer()
+{
+    if (timers_ == nullptr) {
+        if (armed_deadline_us_ != INT64_MAX) {
+            esp_timer_stop(timer_);
+            armed_deadline_us_ = INT64_MAX;
+        }
+        return;
+    }
+    const int64_t deadline = timers_->deadline_us;
+    if (deadline == armed_deadline_us_) {
+        return;
+    }
+    esp_timer_stop(timer_);
+    int64_t delay = deadline - esp_timer_get_time();
+    esp_timer_start_once(timer_, delay > 0 ? static_cast<uint64_t>(delay) : 1);
+    armed_deadline_us_ = deadline;
+}
+
+void Scheduler::timer_callback(void *arg)
+{
+    auto *self = static_cast<Scheduler *>(arg);
+    self->timer_fired_.store(true, std::memory_order_seq_cst);
+    xTaskNotifyGive(self->task_);
+}
+
+void Scheduler::scheduler_task(void *arg)
+{
+    auto *self = static_cast<Scheduler *>(arg);
+    self->run();
+    self->running_tasks_.fetch_sub(1, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void Scheduler::run()
+{
+    while (!stopping_.load(std::memory_order_acquire)) {
+        if (timer_fired_.exchange(false, std::memory_order_acquire)) {
+            /* The one-shot timer is no longer running. */
+            armed_deadline_us_ = INT64_MAX;
+        }
+        take_remote();
+        fire_timers(esp_timer_get_time());
+        run_ready();
+        arm_timer();
+        if (ready_head_ != nullptr) {
+            continue;
+        }
+        /* Pairs with the CAS in post(): a push after this check saw an empty
+         * stack and notifies us. */
+        if (remote_.load(std::memory_order_seq_cst) != nullptr || timer_fired_.load(std::memory_order_seq_cst)) {
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+bool Scheduler::add_io(IoAwaiter *io)
+{
+    if (event_fd_ < 0) {
+        io->ok = false;
+        return false;
+    }
+    portENTER_CRITICAL(&io_lock_);
+    io->next_io = io_waiters_;
+    io_waiters_ = io;
+    portEXIT_CRITICAL(&io_lock_);
+    io_waiting_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t one = 1;
+    write(event_fd_, &one, sizeof(one));
+    return true;
+}
+
+void Scheduler::io_task(void *arg)
+{
+    auto *self = static_cast<Scheduler *>(arg);
+    while (!self->stopping_.load(std::memory_order_acquire)) {
+        self->poll_io();
+    }
+    self->running_tasks_.fetch_sub(1, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void Scheduler::poll_io()
+{
+    fd_set readable;
+    fd_set writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(event_fd_, &readable);
+    int max_fd = event_fd_;
+    portENTER_CRITICAL(&io_lock_);
+    for (IoAwaiter *io = io_waiters_; io != nullptr; io = io->next_io) {
+        FD_SET(io->fd, io->write ? &writable : &readable);
+        if (io->fd > max_fd) {
+            max_fd = io->fd;
+        }
+    }
+    portEXIT_CRITICAL(&io_lock_);
+
+    int ready = select(max_fd + 1, &readable, &writable, nullptr, nullptr);
+    /* A descriptor closed under a waiter (EBADF) fails everyone; they retry
+     * their operation and see the real error. */
+    const bool wake_all = ready < 0 && errno == EBADF;
+    if (ready < 0 && !wake_all) {
+        return;
+    }
+    if (FD_ISSET(event_fd_, &readable)) {
+        uint64_t count;
+        read(event_fd_, &count, sizeof(count));
+    }
+
+    IoAwaiter *done = nullptr;
+    portENTER_CRITICAL(&io_lock_);
+    for (IoAwaiter **link = &io_waiters_; *link != nullptr;) {
+        IoAwaiter *io = *link;
+        if (wake_all || FD_ISSET(io->fd, io->write ? &writable : &readable)) {
+            *link = io->next_io;
+            io->next_io = done;
+            done = io;
+        } else {
+            link = &io->next_io;
+        }
+    }
+    portEXIT_CRITICAL(&io_lock_);
+
+    while (done != nullptr) {
+        IoAwaiter *next = done->next_io;
+        io_waiting_.fetch_sub(1, std::memory_order_relaxed);
+        post(&done->node);
+        done = next;
+    }
+}
+
+SchedulerStats Scheduler::stats() const
+{
+    SchedulerStats st;
+    st.resumes = resumes_;
+    st.remote_wakeups = remote_wakeups_.load(std::memory_order_relaxed);
+    st.live = live_.load(std::memory_order_relaxed);
+    st.sleeping = sleeping_;
+    st.io_waiting = io_waiting_.load(std::memory_order_relaxed);
+    return st;
+}
+
+} // namespace coro
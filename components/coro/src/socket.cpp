@@ -0,0 +1,88 @@
+#include "coro/socket.hpp"
+
+#include <cerrno>
+
+namespace coro {
+
+namespace {
+
+bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+} // namespace
+
+esp_err_t set_non_blocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+Task<ssize_t> async_recv(Scheduler &scheduler, int fd, void *buf, size_t length)
+{
+    for (;;) {
+        ssize_t n = recv(fd, buf, length, 0);
+        if (n >= 0 || !would_block()) {
+            co_return n;
+        }
+        if (!co_await scheduler.readable(fd)) {
+            errno = ENOTSUP;
+            co_return -1;
+        }
+    }
+}
+
+Task<ssize_t> async_send(Scheduler &scheduler, int fd, const void *buf, size_t length)
+{
+    auto *p = static_cast<const uint8_t *>(buf);
+    size_t sent = 0;
+    while (sent < length) {
+        ssize_t n = send(fd, p + sent, length - sent, 0);
+        if (n >= 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (!would_block() || !co_await scheduler.writable(fd)) {
+            co_return -1;
+        }
+    }
+    co_return static_cast<ssize_t>(sent);
+}
+
+Task<int> async_accept(Scheduler &scheduler, int listen_fd)
+{
+    for (;;) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd >= 0) {
+            set_non_blocking(fd);
+            co_return fd;
+        }
+        if (!would_block() || !co_await scheduler.readable(listen_fd)) {
+            co_return -1;
+        }
+    }
+}
+
+Task<int> async_connect(Scheduler &scheduler, int fd, const struct sockaddr *addr, socklen_t addr_length)
+{
+    if (connect(fd, addr, addr_length) == 0) {
+        co_return 0;
+    }
+    if (errno != EINPROGRESS || !co_await scheduler.writable(fd)) {
+        co_return -1;
+    }
+    int error = 0;
+    socklen_t error_length = sizeof(error);
+    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length);
+    if (error != 0) {
+        errno = error;
+        co_return -1;
+    }
+    co_return 0;
+}
+
+} // namespace coro
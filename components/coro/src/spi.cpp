@@ -0,0 +1,13 @@
+#include "coro/spi.hpp"
+
+#include "esp_attr.h"
+
+namespace coro {
+
+void IRAM_ATTR spi_post_transfer(spi_transaction_t *trans)
+{
+    auto *w = static_cast<detail::Waiter *>(trans->user);
+    w->scheduler->post(w);
+}
+
+} // namespace coro
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+
+#include "esp_err.h"
+
+namespace executor {
+class Executor;
+} // namespace executor
+
+namespace dataflow {
+
+using NodeId = uint16_t;
+
+constexpr NodeId invalid_node = 0xffff;
+
+/** Inputs one derived node may declare. */
+constexpr size_t max_inputs = 8;
+
+/** Current values of a node's inputs, in the order they were declared. */
+class Inputs {
+public:
+    size_t size() const { return count_; }
+
+    const void *operator[](size_t i) const { return values_[i]; }
+
+    template <typename T>
+    const T &get(size_t i) const
+    {
+        return *static_cast<const T *>(values_[i]);
+    }
+
+private:
+    friend class Graph;
+
+    const void *values_[max_inputs];
+    size_t count_ = 0;
+};
+
+/**
+ * @brief Computes a derived node's value into @p out from its inputs.
+ *
+ * Must be a pure function of @p inputs (and of @p ctx, if that never
+ * changes): the graph skips calls whose inputs are unchanged, and calls that
+ * run in parallel may land on any core. Keep per-sample state such as filter
+ * integrators out of derived nodes; update it where the samples arrive and
+ * set() it as a source.
+ */
+using ComputeFn = void (*)(void *ctx, const Inputs &inputs, void *out);
+
+/** Called by update() with the new value of a subscribed node that changed. */
+using ChangeFn = void (*)(void *ctx, NodeId node, const void *value);
+
+struct NodeSpec {
+    const char *name = nullptr;
+    /** Bytes of the node's value. */
+    size_t size = 0;
+    ComputeFn compute = nullptr;
+    void *ctx = nullptr;
+    /** Nodes this one reads, all added earlier; at most max_inputs. */
+    const NodeId *inputs = nullptr;
+    size_t input_count = 0;
+};
+
+struct GraphStats {
+    /** set() calls that changed a source. */
+    uint32_t sets;
+    /** set() calls with the value the source already had; nothing downstream is invalidated. */
+    uint32_t unchanged_sets;
+    uint32_t computations;
+    /** Computations that produced the value the node already had, so its dependents kept theirs. */
+    uint32_t cutoffs;
+    /** Invalidated nodes found current without computing, because no input had actually changed. */
+    uint32_t skipped;
+    /** Levels of independent nodes handed to the executor. */
+    uint32_t parallel_levels;
+};
+
+/**
+ * @brief Derived signals as a dataflow graph, computed lazily and cached.
+ *
+ * Sources hold sampled values; derived nodes compute theirs from declared
+ * inputs. set() on a source only marks what depends on it as stale. Nothing
+ * is computed until get() or update() needs a value, and then only the stale
+ * nodes on the way to it. So with one sample stream feeding twenty derived
+ * quantities of which a consumer reads three, each sample costs those three
+ * and their inputs. Change is tracked per node as well: a node recomputed
+ * to the same bytes (a heading that rounds to the same degree, a threshold
+ * flag that stays low) leaves everything downstream cached.
+ *
+ * update() evaluates every subscribed node. What it may need is planned
+ * once per change of subscriptions, grouped into levels that do not depend
+ * on each other, for example the accelerometer and magnetometer branches of
+ * an attitude estimate; each update() then visits that plan and computes the
+ * nodes in it that are stale. A level
+ * whose nodes together have taken at least Config::parallel_threshold_cycles
+ * recently runs through Executor::parallel_for; cheaper levels run on the
+ * caller, where the hand-off would cost more than it saves.
+ *
+ * Inputs must be added before the nodes that read them, so node order is a
+ * topological order and the graph cannot have cycles. Not thread-safe: one
+ * task adds, sets, gets and updates, and only the compute functions run
+ * elsewhere.
+ */
+class Graph {
+public:
+    struct Config {
+        size_t max_nodes = 32;
+        /** Input declarations across all nodes. */
+        size_t max_edges = 64;
+        /** Bytes for node values; each takes twice its size, rounded up to 8. */
+        size_t value_bytes = 2048;
+        /**
+         * Runs independent nodes in parallel; nullptr computes everything on
+         * the caller, and then node costs are not measured at all.
+         */
+        executor::Executor *executor = nullptr;
+        /** Smallest measured cost of a level, in CPU cycles, worth spreading over the workers. */
+        uint32_t parallel_threshold_cycles = 24000;
+    };
+
+    Graph() = default;
+    ~Graph() { deinit(); }
+
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+
+    esp_err_t init(const Config &config);
+    void deinit();
+
+    /** Add a source of @p size bytes, initially zero. */
+    esp_err_t add_source(const char *name, size_t size, NodeId *out);
+
+    /**
+     * @brief Add a derived node.
+     *
+     * @return ESP_ERR_INVALID_ARG for inputs not yet added or more than
+     * max_inputs, ESP_ERR_NO_MEM when nodes, edges or value bytes run out.
+     */
+    esp_err_t add_node(const NodeSpec &spec, NodeId *out);
+
+    template <typename T>
+    esp_err_t add_source(const char *name, NodeId *out)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "node values are compared and copied bytewise");
+        return add_source(name, sizeof(T), out);
+    }
+
+    template <typename T>
+    esp_err_t add_node(const char *name, ComputeFn compute, void *ctx, std::initializer_list<NodeId> inputs,
+                       NodeId *out)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "node values are compared and copied bytewise");
+        NodeSpec spec;
+        spec.name = name;
+        spec.size = sizeof(T);
+        spec.compute = compute;
+        spec.ctx = ctx;
+        spec.inputs = inputs.begin();
+        spec.input_count = inputs.size();
+        return add_node(spec, out);
+    }
+
+    /**
+     * @brief Store a source's new value and invalidate what depends on it.
+     *
+     * Writing the value the source already holds invalidates nothing.
+     * @return ESP_ERR_INVALID_ARG if @p node is not a source, ESP_ERR_INVALID_SIZE
+     * if @p size is not its size.
+     */
+    esp_err_t set(NodeId node, const void *value, size_t size);
+
+    template <typename T>
+    esp_err_t set(NodeId node, const T &value)
+    {
+        return set(node, &value, sizeof(T));
+    }
+
+    /**
+     * @brief Current value of @p node, computing whatever is stale on the way to it.
+     *
+     * Runs on the caller; use update() to have independent branches computed
+     * in parallel. The pointer stays valid until the node is next computed.
+     * @return nullptr for an unknown node.
+     */
+    const void *get(NodeId node);
+
+    template <typename T>
+    const T &get(NodeId node)
+    {
+        return *static_cast<const T *>(get(node));
+    }
+
+    /** Have update() keep @p node current, calling @p on_change (if set) whenever its value changes. */
+    esp_err_t subscribe(NodeId node, ChangeFn on_change = nullptr, void *ctx = nullptr);
+    esp_err_t unsubscribe(NodeId node);
+
+    /** Bring every subscribed node up to date, then report those that changed. */
+    void update();
+
+    NodeId find(const char *name) const;
+    size_t node_count() const { return count_; }
+    GraphStats stats() const;
+
+    /** Log each node's computations and cost, and the graph's counters. */
+    void report() const;
+
+private:
+    struct Node;
+
+    /* dst is the dependent; next chains the edges out of one node. */
+    struct Edge {
+        NodeId dst;
+        uint16_t next;
+    };
+
+    esp_err_t add(const NodeSpec &spec, bool source, NodeId *out);
+    void invalidate(NodeId node);
+    /* Put @p target and its stale ancestors into schedule_ in node order; returns their number. */
+    size_t plan(NodeId target);
+    /* Group the subscribed nodes and all their ancestors by level into order_. */
+    void build_levels();
+    /* Bring a stale node whose inputs are all current up to date. */
+    void refresh(Node &node);
+
+    Config config_;
+    Node *nodes_ = nullptr;
+    Edge *edges_ = nullptr;
+    uint8_t *values_ = nullptr;
+    /* Scratch for plan(), invalidate() and update(). */
+    NodeId *schedule_ = nullptr;
+    /* Subscribed nodes in node order, so update() never scans the rest. */
+    NodeId *subs_ = nullptr;
+    size_t sub_count_ = 0;
+    /* What update() may need to compute, planned once per change of the
+     * subscriptions rather than on every call: the subscribed nodes and all
+     * their ancestors, grouped by level (nodes of one level read none of each
+     * other), with level_end_[l] where level l ends in order_. */
+    NodeId *order_ = nullptr;
+    uint16_t *level_ = nullptr;
+    uint16_t *level_end_ = nullptr;
+    uint16_t level_count_ = 0;
+    bool levels_dirty_ = false;
+    size_t count_ = 0;
+    size_t edge_count_ = 0;
+    size_t value_used_ = 0;
+    /* Bumped by each set() that changes a source; nodes record when they last changed. */
+    uint32_t epoch_ = 1;
+    /* Caller-side counters; per-node ones live in Node, since nodes may be computed on any core. */
+    uint32_t sets_ = 0;
+    uint32_t unchanged_sets_ = 0;
+    uint32_t parallel_levels_ = 0;
+};
+
+} // namespace dataflow
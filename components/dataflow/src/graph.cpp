@@ -0,0 +1,487 @@
+#include "dataflow/graph.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "executor/executor.hpp"
+
+namespace dataflow {
+
+static const char *TAG = "dataflow";
+
+namespace {
+
+constexpr uint16_t no_edge = 0xffff;
+constexpr size_t value_align = 8;
+constexpr uint32_t cost_sample_period = 8;
+
+size_t round_up(size_t n)
+{
+    return (n + value_align - 1) & ~(value_align - 1);
+}
+
+} // namespace
+
+struct Graph::Node {
+    const char *name;
+    ComputeFn compute;
+    void *ctx;
+    ChangeFn on_change;
+    void *change_ctx;
+    /* Derived nodes compute into the slot they are not showing and flip only
+     * if the bytes differ; sources have one slot. */
+    uint8_t *value[2];
+    uint16_t size;
+    uint8_t current;
+    uint8_t input_count;
+    NodeId inputs[max_inputs];
+    uint16_t first_edge;
+    bool source;
+    /* An input may have changed since computed_at. */
+    bool stale;
+    /* Computed at least once. */
+    bool valid;
+    bool subscribed;
+    /* Scratch for plan() and build_levels(). */
+    bool needed;
+    uint32_t changed_at;
+    uint32_t computed_at;
+    uint32_t reported_at;
+    uint32_t computations;
+    uint32_t cutoffs;
+    uint32_t skipped;
+    /* Cycles per computation, smoothed over every cost_sample_period-th one. */
+    uint32_t cost_cycles;
+
+    const uint8_t *data() const { return value[current]; }
+};
+
+esp_err_t Graph::init(const Config &config)
+{
+    if (nodes_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.max_nodes == 0 || config.max_nodes >= invalid_node || config.max_edges >= no_edge ||
+        config.value_bytes == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+    constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    nodes_ = static_cast<Node *>(heap_caps_calloc(config_.max_nodes, sizeof(Node), caps));
+    edges_ = static_cast<Edge *>(heap_caps_calloc(std::max<size_t>(config_.max_edges, 1), sizeof(Edge), caps));
+    values_ = static_cast<uint8_t *>(heap_caps_aligned_calloc(value_align, 1, round_up(config_.value_bytes), caps));
+    schedule_ = static_cast<NodeId *>(heap_caps_calloc(config_.max_nodes, sizeof(NodeId), caps));
+    order_ = static_cast<NodeId *>(heap_caps_calloc(config_.max_nodes, sizeof(NodeId), caps));
+    level_ = static_cast<uint16_t *>(heap_caps_calloc(config_.max_nodes, sizeof(uint16_t), caps));
+    level_end_ = static_cast<uint16_t *>(heap_caps_calloc(config_.max_nodes + 1, sizeof(uint16_t), caps));
+    subs_ = static_cast<NodeId *>(heap_caps_calloc(config_.max_nodes, sizeof(NodeId), caps));
+    if (nodes_ == nullptr || edges_ == nullptr || values_ == nullptr || schedule_ == nullptr || order_ == nullptr ||
+        level_ == nullptr || level_end_ == nullptr || subs_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    count_ = 0;
+    edge_count_ = 0;
+    value_used_ = 0;
+    sub_count_ = 0;
+    level_count_ = 0;
+    levels_dirty_ = false;
+    epoch_ = 1;
+    sets_ = 0;
+    unchanged_sets_ = 0;
+    parallel_levels_ = 0;
+    return ESP_OK;
+}
+
+void Graph::deinit()
+{
+    heap_caps_free(nodes_);
+    heap_caps_free(edges_);
+    heap_caps_free(values_);
+    heap_caps_free(schedule_);
+    heap_caps_free(order_);
+    heap_caps_free(level_);
+    heap_caps_free(level_end_);
+    heap_caps_free(subs_);
+    nodes_ = nullptr;
+    edges_ = nullptr;
+    values_ = nullptr;
+    schedule_ = nullptr;
+    order_ = nullptr;
+    level_ = nullptr;
+    level_end_ = nullptr;
+    subs_ = nullptr;
+    count_ = 0;
+    sub_count_ = 0;
+}
+
+esp_err_t Graph::add_source(const char *name, size_t size, NodeId *out)
+{
+    NodeSpec spec;
+    spec.name = name;
+    spec.size = size;
+    return add(spec, true, out);
+}
+
+esp_err_t Graph::add_node(const NodeSpec &spec, NodeId *out)
+{
+    return add(spec, false, out);
+}
+
+esp_err_t Graph::add(const NodeSpec &spec, bool source, NodeId *out)
+{
+    if (nodes_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (out == nullptr || spec.size == 0 || spec.size > UINT16_MAX ||
+        (!source && (spec.compute == nullptr || spec.input_count > max_inputs ||
+                     (spec.input_count != 0 && spec.inputs == nullptr)))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; !source && i < spec.input_count; ++i) {
+        if (spec.inputs[i] >= count_) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    size_t slot = round_up(spec.size);
+    size_t bytes = source ? slot : 2 * slot;
+    if (count_ == config_.max_nodes || edge_count_ + (source ? 0 : spec.input_count) > config_.max_edges ||
+        value_used_ + bytes > config_.value_bytes) {
+        ESP_LOGE(TAG, "no room for node %s", spec.name != nullptr ? spec.name : "?");
+        return ESP_ERR_NO_MEM;
+    }
+
+    NodeId id = static_cast<NodeId>(count_);
+    Node &n = nodes_[id];
+    n = {};
+    n.name = spec.name;
+    n.source = source;
+    n.size = static_cast<uint16_t>(spec.size);
+    n.value[0] = values_ + value_used_;
+    n.value[1] = source ? n.value[0] : n.value[0] + slot;
+    value_used_ += bytes;
+    n.first_edge = no_edge;
+    if (!source) {
+        n.compute = spec.compute;
+        n.ctx = spec.ctx;
+        n.input_count = static_cast<uint8_t>(spec.input_count);
+        n.stale = true;
+        for (size_t i = 0; i < spec.input_count; ++i) {
+            NodeId in = spec.inputs[i];
+            n.inputs[i] = in;
+            Edge &e = edges_[edge_count_];
+            e.dst = id;
+            e.next = nodes_[in].first_edge;
+            nodes_[in].first_edge = static_cast<uint16_t>(edge_count_);
+            ++edge_count_;
+        }
+    } else {
+        n.valid = true;
+    }
+    ++count_;
+    *out = id;
+    return ESP_OK;
+}
+
+esp_err_t Graph::set(NodeId node, const void *value, size_t size)
+{
+    if (node >= count_ || !nodes_[node].source || value == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Node &n = nodes_[node];
+    if (size != n.size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (memcmp(n.value[0], value, size) == 0) {
+        ++unchanged_sets_;
+        return ESP_OK;
+    }
+    memcpy(n.value[0], value, size);
+    n.changed_at = ++epoch_;
+    ++sets_;
+    invalidate(node);
+    return ESP_OK;
+}
+
+void Graph::invalidate(NodeId node)
+{
+    /* A stale node's dependents are stale already, so the walk stops there
+     * and each node is pushed at most once. */
+    size_t top = 0;
+    for (;;) {
+        for (uint16_t e = nodes_[node].first_edge; e != no_edge; e = edges_[e].next) {
+            Node &dst = nodes_[edges_[e].dst];
+            if (!dst.stale) {
+                dst.stale = true;
+                schedule_[top++] = edges_[e].dst;
+            }
+        }
+        if (top == 0) {
+            return;
+        }
+        node = schedule_[--top];
+    }
+}
+
+const void *Graph::get(NodeId node)
+{
+    if (node >= count_) {
+        return nullptr;
+    }
+    if (nodes_[node].stale) {
+        size_t planned = plan(node);
+        for (size_t i = 0; i < planned; ++i) {
+            nodes_[schedule_[i]].needed = false;
+            refresh(nodes_[schedule_[i]]);
+        }
+    }
+    return nodes_[node].data();
+}
+
+esp_err_t Graph::subscribe(NodeId node, ChangeFn on_change, void *ctx)
+{
+    if (node >= count_) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Node &n = nodes_[node];
+    if (!n.subscribed) {
+        size_t at = sub_count_++;
+        for (; at > 0 && subs_[at - 1] > node; --at) {
+            subs_[at] = subs_[at - 1];
+        }
+        subs_[at] = node;
+        levels_dirty_ = true;
+    }
+    n.subscribed = true;
+    n.on_change = on_change;
+    n.change_ctx = ctx;
+    /* Report the current value on the next update(). */
+    n.reported_at = 0;
+    return ESP_OK;
+}
+
+esp_err_t Graph::unsubscribe(NodeId node)
+{
+    if (node >= count_) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (nodes_[node].subscribed) {
+        NodeId *end = std::remove(subs_, subs_ + sub_count_, node);
+        sub_count_ = static_cast<size_t>(end - subs_);
+        levels_dirty_ = true;
+    }
+    nodes_[node].subscribed = false;
+    nodes_[node].on_change = nullptr;
+    return ESP_OK;
+}
+
+void Graph::update()
+{
+    if (levels_dirty_) {
+        build_levels();
+    }
+    const bool parallel = config_.executor != nullptr;
+    size_t begin = 0;
+    for (uint16_t level = 0; level < level_count_; ++level) {
+        size_t end = level_end_[level];
+        if (!parallel) {
+            for (size_t i = begin; i < end; ++i) {
+                if (nodes_[order_[i]].stale) {
+                    refresh(nodes_[order_[i]]);
+                }
+            }
+            begin = end;
+            continue;
+        }
+        size_t stale = 0;
+        uint32_t cost = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (nodes_[order_[i]].stale) {
+                schedule_[stale++] = order_[i];
+                cost += nodes_[order_[i]].cost_cycles;
+            }
+        }
+        if (stale > 1 && cost >= config_.parallel_threshold_cycles) {
+            ++parallel_levels_;
+            const NodeId *run = schedule_;
+            config_.executor->parallel_for(0, stale, 1, [this, run](size_t lo, size_t hi) {
+                for (size_t i = lo; i < hi; ++i) {
+                    refresh(nodes_[run[i]]);
+                }
+            });
+        } else {
+            for (size_t i = 0; i < stale; ++i) {
+                refresh(nodes_[schedule_[i]]);
+            }
+        }
+        begin = end;
+    }
+    for (size_t s = 0; s < sub_count_; ++s) {
+        Node &n = nodes_[subs_[s]];
+        if (n.on_change != nullptr && n.valid && (n.changed_at > n.reported_at || n.reported_at == 0)) {
+            n.reported_at = n.changed_at != 0 ? n.changed_at : epoch_;
+            n.on_change(n.change_ctx, subs_[s], n.data());
+        }
+    }
+}
+
+size_t Graph::plan(NodeId target)
+{
+    /* Breadth-first back from the target through stale inputs, with
+     * schedule_ as the queue: each needed node is queued once. */
+    size_t planned = 0;
+    nodes_[target].needed = true;
+    schedule_[planned++] = target;
+    for (size_t next = 0; next < planned; ++next) {
+        const Node &n = nodes_[schedule_[next]];
+        for (size_t k = 0; k < n.input_count; ++k) {
+            Node &in = nodes_[n.inputs[k]];
+            if (in.stale && !in.needed) {
+                in.needed = true;
+                schedule_[planned++] = n.inputs[k];
+            }
+        }
+    }
+    /* Inputs come before their readers, so node order computes each after its inputs. */
+    std::sort(schedule_, schedule_ + planned);
+    return planned;
+}
+
+void Graph::build_levels()
+{
+    /* Every derived ancestor of a subscribed node, stale now or not: which
+     * of them are stale changes with each set(), the plan does not. */
+    size_t count = 0;
+    for (size_t s = 0; s < sub_count_; ++s) {
+        if (!nodes_[subs_[s]].source) {
+            nodes_[subs_[s]].needed = true;
+            schedule_[count++] = subs_[s];
+        }
+    }
+    for (size_t next = 0; next < count; ++next) {
+        const Node &n = nodes_[schedule_[next]];
+        for (size_t k = 0; k < n.input_count; ++k) {
+            Node &in = nodes_[n.inputs[k]];
+            if (!in.source && !in.needed) {
+                in.needed = true;
+                schedule_[count++] = n.inputs[k];
+            }
+        }
+    }
+    std::sort(schedule_, schedule_ + count);
+
+    /* A node's level is one past its deepest derived input's. Then a
+     * counting sort groups the nodes by level, keeping node order inside
+     * each: level_end_[l] starts as where level l begins and ends up where
+     * it ends. */
+    uint16_t levels = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Node &n = nodes_[schedule_[i]];
+        uint16_t level = 0;
+        for (size_t k = 0; k < n.input_count; ++k) {
+            if (!nodes_[n.inputs[k]].source) {
+                level = std::max<uint16_t>(level, level_[n.inputs[k]] + 1);
+            }
+        }
+        level_[schedule_[i]] = level;
+        levels = std::max<uint16_t>(levels, level + 1);
+    }
+    std::fill(level_end_, level_end_ + levels + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++level_end_[level_[schedule_[i]] + 1];
+    }
+    for (uint16_t level = 1; level < levels; ++level) {
+        level_end_[level] += level_end_[level - 1];
+    }
+    for (size_t i = 0; i < count; ++i) {
+        order_[level_end_[level_[schedule_[i]]]++] = schedule_[i];
+        nodes_[schedule_[i]].needed = false;
+    }
+    level_count_ = levels;
+    levels_dirty_ = false;
+}
+
+void Graph::refresh(Node &n)
+{
+    bool inputs_changed = !n.valid;
+    Inputs inputs;
+    inputs.count_ = n.input_count;
+    for (size_t k = 0; k < n.input_count; ++k) {
+        const Node &in = nodes_[n.inputs[k]];
+        inputs_changed |= in.changed_at > n.computed_at;
+        inputs.values_[k] = in.data();
+    }
+    if (!inputs_changed) {
+        ++n.skipped;
+    } else {
+        uint8_t *out = n.value[n.current ^ 1];
+        /* The cost only steers parallel levels, so a sample of the calls is
+         * enough to track it, and without an executor none is. */
+        if (config_.executor != nullptr && n.computations % cost_sample_period == 0) {
+            uint32_t start = esp_cpu_get_cycle_count();
+            n.compute(n.ctx, inputs, out);
+            uint32_t cycles = esp_cpu_get_cycle_count() - start;
+            n.cost_cycles = n.computations == 0 ? cycles : (3 * n.cost_cycles + cycles) / 4;
+        } else {
+            n.compute(n.ctx, inputs, out);
+        }
+        ++n.computations;
+        if (!n.valid || memcmp(out, n.data(), n.size) != 0) {
+            n.current ^= 1;
+            n.changed_at = epoch_;
+        } else {
+            ++n.cutoffs;
+        }
+        n.valid = true;
+    }
+    n.computed_at = epoch_;
+    n.stale = false;
+}
+
+NodeId Graph::find(const char *name) const
+{
+    for (size_t i = 0; name != nullptr && i < count_; ++i) {
+        if (nodes_[i].name != nullptr && strcmp(nodes_[i].name, name) == 0) {
+            return static_cast<NodeId>(i);
+        }
+    }
+    return invalid_node;
+}
+
+GraphStats Graph::stats() const
+{
+    GraphStats s = {};
+    s.sets = sets_;
+    s.unchanged_sets = unchanged_sets_;
+    s.parallel_levels = parallel_levels_;
+    for (size_t i = 0; i < count_; ++i) {
+        s.computations += nodes_[i].computations;
+        s.cutoffs += nodes_[i].cutoffs;
+        s.skipped += nodes_[i].skipped;
+    }
+    return s;
+}
+
+void Graph::report() const
+{
+    GraphStats s = stats();
+    ESP_LOGI(TAG, "%u nodes: %u sets (%u unchanged), %u computations, %u cutoffs, %u skipped, %u parallel levels",
+             static_cast<unsigned>(count_), static_cast<unsigned>(s.sets), static_cast<unsigned>(s.unchanged_sets),
+             static_cast<unsigned>(s.computations), static_cast<unsigned>(s.cutoffs),
+             static_cast<unsigned>(s.skipped), static_cast<unsigned>(s.parallel_levels));
+    for (size_t i = 0; i < count_; ++i) {
+        const Node &n = nodes_[i];
+        if (n.source) {
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-20s %8u computations %8u cutoffs %8u skipped %8u cycles%s",
+                 n.name != nullptr ? n.name : "?", static_cast<unsigned>(n.computations),
+                 static_cast<unsigned>(n.cutoffs), static_cast<unsigned>(n.skipped),
+                 static_cast<unsigned>(n.cost_cycles), n.subscribed ? "  subscribed" : "");
+    }
+}
+
+} // namespace dataflow
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace delta_ota {
+
+/*
+ * Patch layout, written by tools/make_delta.py. All integers are
+ * little-endian:
+ *
+ *   PatchHeader
+ *   body                            compressed as PatchHeader::compression says
+ *
+ * The uncompressed body is a sequence of bsdiff-style control records that
+ * rebuild the target image front to back from the source (the image in the
+ * running partition), each three LEB128 varints followed by data:
+ *
+ *   diff_length                     target gets source[pos + i] + diff[i]
+ *   extra_length                    target gets the bytes verbatim
+ *   adjust                          zigzag-encoded; pos += adjust afterwards
+ *   diff[diff_length] extra[extra_length]
+ *
+ * pos starts at 0 and advances by diff_length within each record. A patch
+ * against an empty source (source_size 0) is a compressed full image.
+ *
+ * The source hash is checked against the running partition before anything
+ * is written, and the target hash over everything written before the new
+ * partition is made bootable. header_crc is the zlib CRC-32 of the header
+ * up to that field.
+ */
+
+constexpr uint32_t patch_magic = 0x31544f44; /* "DOT1" */
+constexpr uint16_t patch_version = 1;
+
+/* heatshrink sizes a patch may use; tools/make_delta.py accepts the same. */
+constexpr uint8_t min_window_bits = 4;
+constexpr uint8_t max_window_bits = 15;
+constexpr uint8_t min_lookahead_bits = 3;
+
+enum class Compression : uint8_t {
+    None = 0,
+    /** heatshrink with the header's window and lookahead sizes. */
+    Heatshrink = 1,
+};
+
+struct PatchHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint8_t compression;
+    /** heatshrink window: 2^window_bits bytes of history, min_window_bits..max_window_bits. */
+    uint8_t window_bits;
+    /** heatshrink back-references cover up to 2^lookahead_bits bytes, min_lookahead_bits..window_bits-1. */
+    uint8_t lookahead_bits;
+    uint8_t reserved[3];
+    uint32_t source_size;
+    uint32_t target_size;
+    uint8_t source_sha256[32];
+    uint8_t target_sha256[32];
+    uint32_t header_crc;
+};
+
+static_assert(sizeof(PatchHeader) == 88, "layout is shared with make_delta.py");
+
+} // namespace delta_ota
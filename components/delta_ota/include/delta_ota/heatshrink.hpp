@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+namespace delta_ota {
+
+/**
+ * @brief Streaming heatshrink decoder (LZSS over a 2^window_bits history).
+ *
+ * The bit stream is MSB first: a 1 tag bit and 8 literal bits, or a 0 tag
+ * bit, window_bits of (distance - 1) and lookahead_bits of (length - 1).
+ * This is the format of the reference heatshrink encoder, so streams made
+ * by either that or tools/make_delta.py decode alike. RAM is the window
+ * alone; input and output may be split anywhere.
+ */
+class HeatshrinkDecoder {
+public:
+    HeatshrinkDecoder() = default;
+    ~HeatshrinkDecoder() { deinit(); }
+
+    HeatshrinkDecoder(const HeatshrinkDecoder &) = delete;
+    HeatshrinkDecoder &operator=(const HeatshrinkDecoder &) = delete;
+
+    /**
+     * @return ESP_ERR_INVALID_ARG unless min_window_bits <= window_bits <= max_window_bits
+     * and min_lookahead_bits <= lookahead_bits < window_bits (format.hpp).
+     */
+    esp_err_t init(uint8_t window_bits, uint8_t lookahead_bits);
+    void deinit();
+
+    /**
+     * @brief Decode from @p in until it is used up or @p out is full.
+     *
+     * @param[out] consumed Input bytes taken; the rest must be passed again.
+     * @return Bytes written to @p out.
+     */
+    size_t decode(const uint8_t *in, size_t in_len, size_t *consumed, uint8_t *out, size_t out_cap);
+
+    /** True if no more than the final byte's padding is left of an unfinished operation. */
+    bool idle() const { return state_ != State::Copy && op_bits_ + bit_count_ < 8; }
+
+private:
+    enum class State : uint8_t {
+        Tag,
+        Literal,
+        Distance,
+        Length,
+        Copy,
+    };
+
+    uint8_t *window_ = nullptr;
+    uint32_t mask_ = 0;
+    uint32_t head_ = 0;
+    uint8_t window_bits_ = 0;
+    uint8_t lookahead_bits_ = 0;
+    State state_ = State::Tag;
+    uint32_t bits_ = 0;
+    uint8_t bit_count_ = 0;
+    /** Bits of the current operation already taken from bits_. */
+    uint8_t op_bits_ = 0;
+    uint32_t distance_ = 0;
+    uint32_t remaining_ = 0;
+};
+
+} // namespace delta_ota
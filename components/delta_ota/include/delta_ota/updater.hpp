@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "delta_ota/format.hpp"
+#include "delta_ota/heatshrink.hpp"
+#include "esp_err.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+
+namespace delta_ota {
+
+struct Progress {
+    /** Patch bytes accepted by feed(), header included. */
+    uint32_t received;
+    /** Target image bytes rebuilt so far. */
+    uint32_t rebuilt;
+    /** Target image size, 0 until the header has arrived. */
+    uint32_t target_size;
+};
+
+/**
+ * @brief Applies a delta patch (see format.hpp) against the running image, straight into the next OTA slot.
+ *
+ * The patch is fed in whatever pieces the transport delivers. Each piece is
+ * decompressed, run through the bsdiff-style records against the running
+ * partition and written out through esp_ota_write, so RAM use is fixed:
+ * the heatshrink window (2^window_bits bytes), Config::source_buffer_size
+ * of source data and Config::write_buffer_size of output. No copy of the
+ * patch or of either image is ever held. The target slot is erased as it
+ * is written (OTA_WITH_SEQUENTIAL_WRITES), so begin() does not stall.
+ *
+ * Typical use, e.g. from an HTTP download loop:
+ *
+ *     updater.begin(config);
+ *     while (err == ESP_OK && (n = read(buf, sizeof(buf))) > 0) {
+ *         err = updater.feed(buf, n);
+ *     }
+ *     if (err == ESP_OK && updater.finish() == ESP_OK) {
+ *         esp_restart();
+ *     }
+ *
+ * Any error is sticky: later feed() and finish() calls return it, and the
+ * half-written slot is released with esp_ota_abort(). The running image is
+ * never touched.
+ */
+class Updater {
+public:
+    struct Config {
+        /** Slot to write; nullptr picks esp_ota_get_next_update_partition(). */
+        const esp_partition_t *target = nullptr;
+        /** Bytes handed to each esp_ota_write(); a flash sector keeps erases and writes aligned. */
+        size_t write_buffer_size = 4096;
+        /** Source image read-ahead for diff records. */
+        size_t source_buffer_size = 512;
+        /** Hash the running image before writing anything, so a patch made for another build is refused. */
+        bool verify_source = true;
+        /** Let finish() make the target the boot partition. */
+        bool set_boot_partition = true;
+    };
+
+    Updater() = default;
+    ~Updater() { abort(); }
+
+    Updater(const Updater &) = delete;
+    Updater &operator=(const Updater &) = delete;
+
+    /**
+     * @brief Start an update; the target slot is opened once the patch header has arrived.
+     *
+     * @return ESP_ERR_INVALID_STATE if an update is in progress, ESP_ERR_NOT_FOUND without an OTA slot.
+     */
+    esp_err_t begin(const Config &config);
+
+    /**
+     * @brief Apply the next @p len bytes of the patch.
+     *
+     * @return ESP_ERR_INVALID_VERSION for an unknown patch format,
+     *         ESP_ERR_INVALID_CRC if the header or the running image does not
+     *         match, ESP_ERR_INVALID_SIZE for a record outside either image,
+     *         or an esp_ota_write() / esp_partition_read() error.
+     */
+    esp_err_t feed(const void *data, size_t len);
+
+    /**
+     * @brief Check that the whole target was rebuilt and matches its hash, then close the slot.
+     *
+     * @return ESP_ERR_INVALID_SIZE if the patch was cut short,
+     *         ESP_ERR_INVALID_CRC on a hash mismatch, or the error of
+     *         esp_ota_end() (image validation) / esp_ota_set_boot_partition().
+     */
+    esp_err_t finish();
+
+    /** Drop an update in progress; the target slot is left unbootable. */
+    void abort();
+
+    bool active() const { return target_ != nullptr; }
+    Progress progress() const
+    {
+        return {received_, rebuilt_, header_fill_ == sizeof(PatchHeader) ? header_.target_size : 0};
+    }
+
+private:
+    enum class Step : uint8_t {
+        DiffLength,
+        ExtraLength,
+        Adjust,
+        Diff,
+        Extra,
+    };
+
+    esp_err_t fail(esp_err_t err);
+    void release();
+    esp_err_t start(const PatchHeader &header);
+    esp_err_t hash_source(uint8_t out[32]) const;
+    esp_err_t apply(const uint8_t *data, size_t len);
+    esp_err_t end_record();
+    esp_err_t emit(const uint8_t *data, size_t len);
+    esp_err_t emit_diff(const uint8_t *diff, size_t len);
+    esp_err_t flush();
+
+    Config config_;
+    const esp_partition_t *source_ = nullptr;
+    const esp_partition_t *target_ = nullptr;
+    esp_ota_handle_t handle_ = 0;
+    bool ota_open_ = false;
+    esp_err_t error_ = ESP_OK;
+
+    PatchHeader header_ = {};
+    size_t header_fill_ = 0;
+    HeatshrinkDecoder decoder_;
+    bool compressed_ = false;
+
+    Step step_ = Step::DiffLength;
+    uint64_t varint_ = 0;
+    uint8_t varint_shift_ = 0;
+    uint32_t diff_left_ = 0;
+    uint32_t extra_left_ = 0;
+    int64_t source_pos_ = 0;
+    int64_t adjust_ = 0;
+
+    uint8_t *out_ = nullptr;
+    size_t out_fill_ = 0;
+    uint8_t *source_buf_ = nullptr;
+    uint32_t source_base_ = 0;
+    size_t source_len_ = 0;
+    mbedtls_sha256_context sha_;
+
+    uint32_t received_ = 0;
+    uint32_t rebuilt_ = 0;
+};
+
+} // namespace delta_ota
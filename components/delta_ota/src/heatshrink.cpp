@@ -0,0 +1,101 @@
+#include "delta_ota/heatshrink.hpp"
+
+#include "delta_ota/format.hpp"
+#include "esp_heap_caps.h"
+
+namespace delta_ota {
+
+esp_err_t HeatshrinkDecoder::init(uint8_t window_bits, uint8_t lookahead_bits)
+{
+    if (window_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (window_bits < min_window_bits || window_bits > max_window_bits || lookahead_bits < min_lookahead_bits ||
+        lookahead_bits >= window_bits) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Zeroed: the reference decoder reads zeros for distances before the start. */
+    window_ = static_cast<uint8_t *>(
+        heap_caps_calloc(1, size_t{1} << window_bits, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (window_ == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    mask_ = (uint32_t{1} << window_bits) - 1;
+    head_ = 0;
+    window_bits_ = window_bits;
+    lookahead_bits_ = lookahead_bits;
+    state_ = State::Tag;
+    bits_ = 0;
+    bit_count_ = 0;
+    op_bits_ = 0;
+    return ESP_OK;
+}
+
+void HeatshrinkDecoder::deinit()
+{
+    heap_caps_free(window_);
+    window_ = nullptr;
+}
+
+size_t HeatshrinkDecoder::decode(const uint8_t *in, size_t in_len, size_t *consumed, uint8_t *out, size_t out_cap)
+{
+    size_t used = 0;
+    size_t produced = 0;
+    while (produced < out_cap) {
+        if (state_ == State::Copy) {
+            while (remaining_ != 0 && produced < out_cap) {
+                uint8_t b = window_[(head_ - distance_) & mask_];
+                window_[head_++ & mask_] = b;
+                out[produced++] = b;
+                --remaining_;
+            }
+            if (remaining_ == 0) {
+                state_ = State::Tag;
+            }
+            continue;
+        }
+
+        uint8_t need = state_ == State::Tag       ? 1
+                       : state_ == State::Literal ? 8
+                       : state_ == State::Distance ? window_bits_
+                                                   : lookahead_bits_;
+        if (bit_count_ < need) {
+            if (used == in_len) {
+                break;
+            }
+            bits_ = bits_ << 8 | in[used++];
+            bit_count_ += 8;
+            continue;
+        }
+        bit_count_ -= need;
+        op_bits_ += need;
+        uint32_t value = (bits_ >> bit_count_) & ((uint32_t{1} << need) - 1);
+
+        switch (state_) {
+        case State::Tag:
+            state_ = value != 0 ? State::Literal : State::Distance;
+            break;
+        case State::Literal:
+            window_[head_++ & mask_] = static_cast<uint8_t>(value);
+            out[produced++] = static_cast<uint8_t>(value);
+            state_ = State::Tag;
+            op_bits_ = 0;
+            break;
+        case State::Distance:
+            distance_ = value + 1;
+            state_ = State::Length;
+            break;
+        case State::Length:
+            remaining_ = value + 1;
+            state_ = State::Copy;
+            op_bits_ = 0;
+            break;
+        case State::Copy:
+            break;
+        }
+    }
+    *consumed = used;
+    return produced;
+}
+
+} // namespace delta_ota
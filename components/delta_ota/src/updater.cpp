@@ -0,0 +1,401 @@
+#include "delta_ota/updater.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "delta_ota";
+
+namespace delta_ota {
+
+namespace {
+
+constexpr uint32_t internal_caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+/* Decompressed body bytes per apply() call. */
+constexpr size_t decode_chunk = 256;
+
+} // namespace
+
+esp_err_t Updater::begin(const Config &config)
+{
+    if (active() && error_ == ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    abort();
+    if (config.write_buffer_size == 0 || config.source_buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *target =
+        config.target != nullptr ? config.target : esp_ota_get_next_update_partition(nullptr);
+    const esp_partition_t *source = esp_ota_get_running_partition();
+    if (target == nullptr || source == nullptr || target == source) {
+        ESP_LOGE(TAG, "no OTA slot to update: the partition table needs otadata, ota_0 and ota_1");
+        return ESP_ERR_NOT_FOUND;
+    }
+    out_ = static_cast<uint8_t *>(heap_caps_malloc(config.write_buffer_size, internal_caps));
+    source_buf_ = static_cast<uint8_t *>(heap_caps_malloc(config.source_buffer_size, internal_caps));
+    if (out_ == nullptr || source_buf_ == nullptr) {
+        release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    config_ = config;
+    source_ = source;
+    target_ = target;
+    error_ = ESP_OK;
+    header_fill_ = 0;
+    step_ = Step::DiffLength;
+    varint_ = 0;
+    varint_shift_ = 0;
+    source_pos_ = 0;
+    out_fill_ = 0;
+    source_len_ = 0;
+    received_ = 0;
+    rebuilt_ = 0;
+    mbedtls_sha256_init(&sha_);
+    mbedtls_sha256_starts(&sha_, 0);
+    return ESP_OK;
+}
+
+void Updater::release()
+{
+    heap_caps_free(out_);
+    heap_caps_free(source_buf_);
+    out_ = nullptr;
+    source_buf_ = nullptr;
+    decoder_.deinit();
+    if (target_ != nullptr) {
+        mbedtls_sha256_free(&sha_);
+    }
+}
+
+esp_err_t Updater::fail(esp_err_t err)
+{
+    ESP_LOGE(TAG, "update to %s failed after %u patch bytes: %s", target_->label, static_cast<unsigned>(received_),
+             esp_err_to_name(err));
+    if (ota_open_) {
+        esp_ota_abort(handle_);
+        ota_open_ = false;
+    }
+    error_ = err;
+    return err;
+}
+
+void Updater::abort()
+{
+    if (ota_open_) {
+        esp_ota_abort(handle_);
+        ota_open_ = false;
+    }
+    release();
+    target_ = nullptr;
+    error_ = ESP_OK;
+}
+
+esp_err_t Updater::hash_source(uint8_t out[32]) const
+{
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    esp_err_t err = ESP_OK;
+    for (uint32_t offset = 0; offset < header_.source_size && err == ESP_OK;) {
+        size_t len = std::min<size_t>(config_.source_buffer_size, header_.source_size - offset);
+        err = esp_partition_read(source_, offset, source_buf_, len);
+        mbedtls_sha256_update(&sha, source_buf_, len);
+        offset += len;
+    }
+    mbedtls_sha256_finish(&sha, out);
+    mbedtls_sha256_free(&sha);
+    return err;
+}
+
+esp_err_t Updater::start(const PatchHeader &header)
+{
+    if (header.magic != patch_magic || header.version != patch_version) {
+        ESP_LOGE(TAG, "not a version %u patch", static_cast<unsigned>(patch_version));
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (header.header_crc !=
+        esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&header), offsetof(PatchHeader, header_crc))) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (header.source_size > source_->size || header.target_size == 0 || header.target_size > target_->size) {
+        ESP_LOGE(TAG, "patch for a %u -> %u byte image does not fit %s -> %s",
+                 static_cast<unsigned>(header.source_size), static_cast<unsigned>(header.target_size),
+                 source_->label, target_->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    switch (static_cast<Compression>(header.compression)) {
+    case Compression::None:
+        compressed_ = false;
+        break;
+    case Compression::Heatshrink: {
+        esp_err_t err = decoder_.init(header.window_bits, header.lookahead_bits);
+        if (err != ESP_OK) {
+            return err == ESP_ERR_INVALID_ARG ? ESP_ERR_INVALID_VERSION : err;
+        }
+        compressed_ = true;
+        break;
+    }
+    default:
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (config_.verify_source) {
+        uint8_t digest[32];
+        esp_err_t err = hash_source(digest);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (memcmp(digest, header.source_sha256, sizeof(digest)) != 0) {
+            ESP_LOGE(TAG, "patch was made against a different image than the one in %s", source_->label);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    esp_err_t err = esp_ota_begin(target_, OTA_WITH_SEQUENTIAL_WRITES, &handle_);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ota_open_ = true;
+    ESP_LOGI(TAG, "rebuilding %u bytes into %s from %u bytes of %s", static_cast<unsigned>(header.target_size),
+             target_->label, static_cast<unsigned>(header.source_size), source_->label);
+    return ESP_OK;
+}
+
+esp_err_t Updater::feed(const void *data, size_t len)
+{
+    if (!active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (error_ != ESP_OK) {
+        return error_;
+    }
+    auto *p = static_cast<const uint8_t *>(data);
+    received_ += len;
+
+    if (header_fill_ < sizeof(PatchHeader)) {
+        size_t take = std::min(len, sizeof(PatchHeader) - header_fill_);
+        memcpy(reinterpret_cast<uint8_t *>(&header_) + header_fill_, p, take);
+        header_fill_ += take;
+        p += take;
+        len -= take;
+        if (header_fill_ < sizeof(PatchHeader)) {
+            return ESP_OK;
+        }
+        esp_err_t err = start(header_);
+        if (err != ESP_OK) {
+            return fail(err);
+        }
+    }
+
+    if (!compressed_) {
+        esp_err_t err = apply(p, len);
+        return err != ESP_OK ? fail(err) : ESP_OK;
+    }
+    /* The decoder stops short of a full chunk only once the input is used up. */
+    uint8_t chunk[decode_chunk];
+    size_t produced;
+    do {
+        size_t used;
+        produced = decoder_.decode(p, len, &used, chunk, sizeof(chunk));
+        p += used;
+        len -= used;
+        esp_err_t err = apply(chunk, produced);
+        if (err != ESP_OK) {
+            return fail(err);
+        }
+    } while (produced == sizeof(chunk));
+    return ESP_OK;
+}
+
+esp_err_t Updater::apply(const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+    while (i < len) {
+        size_t take;
+        esp_err_t err = ESP_OK;
+        switch (step_) {
+        case Step::DiffLength:
+        case Step::ExtraLength:
+        case Step::Adjust: {
+            uint8_t b = data[i++];
+            if (varint_shift_ > 63) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            varint_ |= static_cast<uint64_t>(b & 0x7f) << varint_shift_;
+            varint_shift_ += 7;
+            if ((b & 0x80) != 0) {
+                break;
+            }
+            uint64_t value = varint_;
+            varint_ = 0;
+            varint_shift_ = 0;
+            if (step_ == Step::DiffLength) {
+                if (rebuilt_ == header_.target_size || source_pos_ + value > header_.source_size ||
+                    rebuilt_ + value > header_.target_size) {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                diff_left_ = static_cast<uint32_t>(value);
+                step_ = Step::ExtraLength;
+            } else if (step_ == Step::ExtraLength) {
+                if (rebuilt_ + diff_left_ + value > header_.target_size) {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                extra_left_ = static_cast<uint32_t>(value);
+                step_ = Step::Adjust;
+            } else {
+                adjust_ = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+                step_ = diff_left_ != 0 ? Step::Diff : Step::Extra;
+                if (diff_left_ == 0 && extra_left_ == 0) {
+                    err = end_record();
+                }
+            }
+            break;
+        }
+        case Step::Diff:
+            take = std::min<size_t>(len - i, diff_left_);
+            err = emit_diff(data + i, take);
+            i += take;
+            diff_left_ -= take;
+            if (diff_left_ == 0) {
+                step_ = Step::Extra;
+                if (extra_left_ == 0) {
+                    err = err != ESP_OK ? err : end_record();
+                }
+            }
+            break;
+        case Step::Extra:
+            take = std::min<size_t>(len - i, extra_left_);
+            err = emit(data + i, take);
+            i += take;
+            extra_left_ -= take;
+            if (extra_left_ == 0) {
+                err = err != ESP_OK ? err : end_record();
+            }
+            break;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Updater::end_record()
+{
+    source_pos_ += adjust_;
+    if (source_pos_ < 0 || source_pos_ > header_.source_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    step_ = Step::DiffLength;
+    return ESP_OK;
+}
+
+esp_err_t Updater::emit_diff(const uint8_t *diff, size_t len)
+{
+    while (len != 0) {
+        auto pos = static_cast<uint32_t>(source_pos_);
+        if (pos < source_base_ || pos >= source_base_ + source_len_) {
+            size_t read = std::min<size_t>(config_.source_buffer_size, header_.source_size - pos);
+            esp_err_t err = esp_partition_read(source_, pos, source_buf_, read);
+            if (err != ESP_OK) {
+                return err;
+            }
+            source_base_ = pos;
+            source_len_ = read;
+        }
+        const uint8_t *src = source_buf_ + (pos - source_base_);
+        size_t take = std::min({len, source_base_ + source_len_ - pos, config_.write_buffer_size - out_fill_});
+        uint8_t *dst = out_ + out_fill_;
+        for (size_t k = 0; k < take; ++k) {
+            dst[k] = static_cast<uint8_t>(src[k] + diff[k]);
+        }
+        out_fill_ += take;
+        source_pos_ += take;
+        rebuilt_ += take;
+        diff += take;
+        len -= take;
+        if (out_fill_ == config_.write_buffer_size) {
+            esp_err_t err = flush();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Updater::emit(const uint8_t *data, size_t len)
+{
+    while (len != 0) {
+        size_t take = std::min(len, config_.write_buffer_size - out_fill_);
+        memcpy(out_ + out_fill_, data, take);
+        out_fill_ += take;
+        rebuilt_ += take;
+        data += take;
+        len -= take;
+        if (out_fill_ == config_.write_buffer_size) {
+            esp_err_t err = flush();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Updater::flush()
+{
+    if (out_fill_ == 0) {
+        return ESP_OK;
+    }
+    mbedtls_sha256_update(&sha_, out_, out_fill_);
+    esp_err_t err = esp_ota_write(handle_, out_, out_fill_);
+    out_fill_ = 0;
+    return err;
+}
+
+esp_err_t Updater::finish()
+{
+    if (!active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (error_ != ESP_OK) {
+        return error_;
+    }
+    if (!ota_open_ || rebuilt_ != header_.target_size || step_ != Step::DiffLength ||
+        (compressed_ && !decoder_.idle())) {
+        return fail(ESP_ERR_INVALID_SIZE);
+    }
+    esp_err_t err = flush();
+    if (err != ESP_OK) {
+        return fail(err);
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha_, digest);
+    if (memcmp(digest, header_.target_sha256, sizeof(digest)) != 0) {
+        return fail(ESP_ERR_INVALID_CRC);
+    }
+    ota_open_ = false;
+    err = esp_ota_end(handle_);
+    if (err == ESP_OK && config_.set_boot_partition) {
+        err = esp_ota_set_boot_partition(target_);
+    }
+    if (err != ESP_OK) {
+        return fail(err);
+    }
+    ESP_LOGI(TAG, "%s ready: %u bytes rebuilt from a %u byte patch", target_->label, static_cast<unsigned>(rebuilt_),
+             static_cast<unsigned>(received_));
+    release();
+    target_ = nullptr;
+    return ESP_OK;
+}
+
+} // namespace delta_ota
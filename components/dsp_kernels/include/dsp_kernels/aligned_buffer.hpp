@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "mem_pool/placement.hpp"
+#include "sdkconfig.h"
+
+#if CONFIG_DSP_KERNELS_USE_PIE
+#define DSP_KERNELS_HAVE_PIE 1
+#else
+#define DSP_KERNELS_HAVE_PIE 0
+#endif
+
+namespace dsp_kernels {
+
+/** Alignment the SIMD kernels need to take their vector path (one 128-bit load). */
+constexpr size_t simd_alignment = 16;
+
+/** True when the dispatched kernels use the S3 PIE instructions. */
+constexpr bool has_simd = DSP_KERNELS_HAVE_PIE;
+
+inline bool is_simd_aligned(const void *p)
+{
+    return (reinterpret_cast<uintptr_t>(p) & (simd_alignment - 1)) == 0;
+}
+
+/** Fixed-size array aligned for the vector path, for static or member buffers. */
+template <typename T, size_t N>
+struct alignas(simd_alignment) AlignedArray {
+    using value_type = T;
+
+    T *data() { return values; }
+    const T *data() const { return values; }
+    static constexpr size_t size() { return N; }
+    T &operator[](size_t i) { return values[i]; }
+    const T &operator[](size_t i) const { return values[i]; }
+    T *begin() { return values; }
+    T *end() { return values + N; }
+    const T *begin() const { return values; }
+    const T *end() const { return values + N; }
+
+    T values[N];
+};
+
+/**
+ * @brief Heap buffer of @p T aligned for the vector path.
+ *
+ * Zero-filled on init(). Placement::Internal is the right choice for
+ * anything on the hot path; PSRAM works but is far slower per load.
+ */
+template <typename T>
+class AlignedBuffer {
+public:
+    using value_type = T;
+
+    AlignedBuffer() = default;
+    ~AlignedBuffer() { deinit(); }
+
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+    esp_err_t init(size_t count, mem_pool::Placement placement = mem_pool::Placement::Internal)
+    {
+        if (data_ != nullptr) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        /* Round up so a full vector load at the end stays inside the block. */
+        size_t bytes = (count * sizeof(T) + simd_alignment - 1) & ~(simd_alignment - 1);
+        data_ = static_cast<T *>(heap_caps_aligned_calloc(simd_alignment, 1, bytes, mem_pool::caps_of(placement)));
+        if (data_ == nullptr) {
+            return ESP_ERR_NO_MEM;
+        }
+        size_ = count;
+        return ESP_OK;
+    }
+
+    void deinit()
+    {
+        heap_caps_free(data_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    size_t size() const { return size_; }
+    T &operator[](size_t i) { return data_[i]; }
+    const T &operator[](size_t i) const { return data_[i]; }
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+
+private:
+    T *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace dsp_kernels
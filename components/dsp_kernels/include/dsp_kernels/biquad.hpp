@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+
+namespace dsp_kernels {
+
+/** Normalised biquad (a0 == 1): y = b0 x + b1 x[-1] + b2 x[-2] - a1 y[-1] - a2 y[-2]. */
+struct BiquadCoeffs {
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+};
+
+/* Audio EQ cookbook designs; @p freq is the corner or centre frequency as a
+ * fraction of the sample rate (0 < freq < 0.5). */
+BiquadCoeffs biquad_lowpass(float freq, float q);
+BiquadCoeffs biquad_highpass(float freq, float q);
+BiquadCoeffs biquad_bandpass(float freq, float q);
+BiquadCoeffs biquad_notch(float freq, float q);
+
+/**
+ * @brief Run one transposed direct-form II section over a block.
+ *
+ * @p state holds the two delay elements between calls. @p in and @p out may
+ * alias. The recursion leaves nothing to vectorise across samples, so this
+ * is one scalar kernel for every target: five multiply-adds per sample with
+ * the state kept in FPU registers for the whole block.
+ */
+void biquad_process(const BiquadCoeffs &coeffs, float state[2], const float *in, float *out, size_t n);
+
+/** @p Stages sections in series, e.g. a 4th-order Butterworth split into two. */
+template <size_t Stages>
+class BiquadCascade {
+public:
+    void set(size_t stage, const BiquadCoeffs &coeffs) { coeffs_[stage] = coeffs; }
+
+    void reset()
+    {
+        for (auto &s : state_) {
+            s[0] = 0.0f;
+            s[1] = 0.0f;
+        }
+    }
+
+    /** @p in and @p out may be the same buffer. */
+    void process(const float *in, float *out, size_t n)
+    {
+        biquad_process(coeffs_[0], state_[0], in, out, n);
+        for (size_t i = 1; i < Stages; ++i) {
+            biquad_process(coeffs_[i], state_[i], out, out, n);
+        }
+    }
+
+    template <typename In, typename Out>
+    void process(const In &in, Out &out)
+    {
+        process(in.data(), out.data(), in.size() < out.size() ? in.size() : out.size());
+    }
+
+private:
+    static_assert(Stages >= 1, "a cascade needs at least one section");
+
+    BiquadCoeffs coeffs_[Stages] = {};
+    float state_[Stages][2] = {};
+};
+
+} // namespace dsp_kernels
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp_kernels/aligned_buffer.hpp"
+#include "esp_err.h"
+
+namespace dsp_kernels {
+
+struct Complex {
+    float re;
+    float im;
+};
+
+/**
+ * @brief In-place radix-2 complex FFT of one fixed power-of-two size.
+ *
+ * init() precomputes the twiddle factors and the bit-reversal permutation,
+ * so a transform does no trigonometry and no allocation. The butterflies are
+ * scalar FPU code on every target: the PIE unit has no float lanes, and the
+ * S3 FPU already issues one multiply-add per cycle.
+ */
+class Fft {
+public:
+    static constexpr size_t max_size = 4096;
+
+    Fft() = default;
+    ~Fft() { deinit(); }
+
+    Fft(const Fft &) = delete;
+    Fft &operator=(const Fft &) = delete;
+
+    /** @return ESP_ERR_INVALID_ARG unless 4 <= @p n <= max_size and n is a power of two. */
+    esp_err_t init(size_t n);
+    void deinit();
+
+    size_t size() const { return n_; }
+
+    /** Forward transform, unscaled. */
+    void forward(Complex *data) const;
+
+    /** Inverse transform, scaled by 1/n so inverse(forward(x)) == x. */
+    void inverse(Complex *data) const;
+
+    /** Squared magnitude of the first n/2 + 1 bins of a forward transform. */
+    void power_spectrum(const Complex *data, float *out) const;
+
+private:
+    void permute(Complex *data) const;
+    void butterflies(Complex *data, bool inverse) const;
+
+    AlignedBuffer<Complex> twiddles_;
+    AlignedBuffer<uint16_t> bitrev_;
+    size_t n_ = 0;
+};
+
+} // namespace dsp_kernels
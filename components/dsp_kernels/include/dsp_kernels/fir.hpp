@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp_kernels/aligned_buffer.hpp"
+#include "esp_err.h"
+
+namespace dsp_kernels {
+
+/**
+ * @brief Block FIR filter for float or Q15 (int16_t) samples.
+ *
+ * Each output is one dot product over a linear history buffer, so it runs on
+ * the vector dot product. Vector loads must start on a 16-byte boundary but
+ * the window slides one sample per output; the filter therefore keeps one
+ * zero-padded copy of the coefficients per sub-vector offset (4 for float,
+ * 8 for int16) and always reads the history from the aligned address below
+ * the window. That costs a few extra (zero) lanes per output instead of
+ * unaligned loads.
+ *
+ * Q15 outputs are the Q30 sum rounded and saturated back to Q15. On the
+ * vector path float inputs must be finite, since padding lanes multiply
+ * neighbouring samples by zero.
+ */
+template <typename T>
+class Fir {
+public:
+    using value_type = T;
+
+    struct Config {
+        /** h[0] applies to the newest sample. Copied by init(). */
+        const T *coeffs = nullptr;
+        size_t taps = 0;
+        /** Largest block passed to one internal pass; longer calls are split. */
+        size_t max_block = 256;
+        /** Ignore the vector path, e.g. to compare against it. */
+        bool force_scalar = false;
+    };
+
+    Fir() = default;
+    ~Fir() { deinit(); }
+
+    Fir(const Fir &) = delete;
+    Fir &operator=(const Fir &) = delete;
+
+    esp_err_t init(const Config &config);
+    void deinit();
+
+    /** Clear the delay line. */
+    void reset();
+
+    /** Filter @p n samples. @p in and @p out may be the same buffer. */
+    void process(const T *in, T *out, size_t n);
+
+    template <typename In, typename Out>
+    void process(const In &in, Out &out)
+    {
+        process(in.data(), out.data(), in.size() < out.size() ? in.size() : out.size());
+    }
+
+    size_t taps() const { return taps_; }
+    bool uses_simd() const { return phase_count_ > 1; }
+
+private:
+    static constexpr size_t lanes = simd_alignment / sizeof(T);
+
+    void process_block(const T *in, T *out, size_t n);
+
+    AlignedBuffer<T> phases_;
+    AlignedBuffer<T> history_;
+    size_t taps_ = 0;
+    size_t window_ = 0;
+    size_t phase_count_ = 0;
+    size_t max_block_ = 0;
+};
+
+extern template class Fir<float>;
+extern template class Fir<int16_t>;
+
+} // namespace dsp_kernels
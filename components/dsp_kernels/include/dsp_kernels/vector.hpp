@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "dsp_kernels/aligned_buffer.hpp"
+
+namespace dsp_kernels {
+
+/**
+ * @brief Portable kernels, built for every target.
+ *
+ * The dispatched functions below forward here on targets without PIE; on the
+ * S3 they stay available to benchmark or cross-check the vector path.
+ */
+namespace scalar {
+
+float dot_product(const float *a, const float *b, size_t n);
+int64_t dot_product(const int16_t *a, const int16_t *b, size_t n);
+int32_t dot_product(const int8_t *a, const int8_t *b, size_t n);
+void q15_to_float(const int16_t *in, float *out, size_t n);
+void float_to_q15(const float *in, int16_t *out, size_t n);
+
+} // namespace scalar
+
+/**
+ * @brief Sum of a[i] * b[i].
+ *
+ * The vector path needs both pointers 16-byte aligned (AlignedArray,
+ * AlignedBuffer); unaligned inputs are still correct but run scalar.
+ */
+float dot_product(const float *a, const float *b, size_t n);
+
+/** Exact int16 dot product: products are accumulated in 64 bits. Not for ISRs on the S3. */
+int64_t dot_product(const int16_t *a, const int16_t *b, size_t n);
+
+/**
+ * @brief Exact int8 dot product, for quantized inference.
+ *
+ * Products are accumulated in 32 bits, which is exact for n below 2^17.
+ * Not for ISRs on the S3.
+ */
+int32_t dot_product(const int8_t *a, const int8_t *b, size_t n);
+
+/** Q15 to float in [-1, 1). */
+void q15_to_float(const int16_t *in, float *out, size_t n);
+
+/** Float to Q15, rounded to nearest and saturated to [-32768, 32767]. */
+void float_to_q15(const float *in, int16_t *out, size_t n);
+
+/** Dot product of two aligned containers; uses the shorter length. */
+template <typename A, typename B>
+auto dot_product(const A &a, const B &b)
+{
+    size_t n = a.size() < b.size() ? a.size() : b.size();
+    return dot_product(a.data(), b.data(), n);
+}
+
+template <typename In, typename Out>
+void q15_to_float(const In &in, Out &out)
+{
+    q15_to_float(in.data(), out.data(), in.size() < out.size() ? in.size() : out.size());
+}
+
+template <typename In, typename Out>
+void float_to_q15(const In &in, Out &out)
+{
+    float_to_q15(in.data(), out.data(), in.size() < out.size() ? in.size() : out.size());
+}
+
+namespace detail {
+
+/* Vector bodies of the dispatched kernels, S3 only. Both pointers must be
+ * 16-byte aligned and n a multiple of two vectors for float and int16 (8
+ * floats, 16 int16) and of one for int8 (16). */
+float pie_dot_product(const float *a, const float *b, size_t n);
+int64_t pie_dot_product(const int16_t *a, const int16_t *b, size_t n);
+int32_t pie_dot_product(const int8_t *a, const int8_t *b, size_t n);
+
+} // namespace detail
+
+} // namespace dsp_kernels
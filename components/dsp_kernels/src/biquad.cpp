@@ -0,0 +1,76 @@
+#include "dsp_kernels/biquad.hpp"
+
+#include <cmath>
+
+namespace dsp_kernels {
+
+namespace {
+
+constexpr float pi = 3.14159265358979f;
+
+struct Prewarp {
+    float cos_w;
+    float alpha;
+};
+
+Prewarp prewarp(float freq, float q)
+{
+    float w = 2.0f * pi * freq;
+    return {cosf(w), sinf(w) / (2.0f * q)};
+}
+
+BiquadCoeffs normalise(float b0, float b1, float b2, float a0, float a1, float a2)
+{
+    return {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+} // namespace
+
+BiquadCoeffs biquad_lowpass(float freq, float q)
+{
+    Prewarp p = prewarp(freq, q);
+    float b1 = 1.0f - p.cos_w;
+    return normalise(b1 / 2.0f, b1, b1 / 2.0f, 1.0f + p.alpha, -2.0f * p.cos_w, 1.0f - p.alpha);
+}
+
+BiquadCoeffs biquad_highpass(float freq, float q)
+{
+    Prewarp p = prewarp(freq, q);
+    float b1 = -(1.0f + p.cos_w);
+    return normalise(-b1 / 2.0f, b1, -b1 / 2.0f, 1.0f + p.alpha, -2.0f * p.cos_w, 1.0f - p.alpha);
+}
+
+BiquadCoeffs biquad_bandpass(float freq, float q)
+{
+    /* Constant 0 dB peak gain. */
+    Prewarp p = prewarp(freq, q);
+    return normalise(p.alpha, 0.0f, -p.alpha, 1.0f + p.alpha, -2.0f * p.cos_w, 1.0f - p.alpha);
+}
+
+BiquadCoeffs biquad_notch(float freq, float q)
+{
+    Prewarp p = prewarp(freq, q);
+    return normalise(1.0f, -2.0f * p.cos_w, 1.0f, 1.0f + p.alpha, -2.0f * p.cos_w, 1.0f - p.alpha);
+}
+
+void biquad_process(const BiquadCoeffs &coeffs, float state[2], const float *in, float *out, size_t n)
+{
+    const float b0 = coeffs.b0;
+    const float b1 = coeffs.b1;
+    const float b2 = coeffs.b2;
+    const float a1 = coeffs.a1;
+    const float a2 = coeffs.a2;
+    float s0 = state[0];
+    float s1 = state[1];
+    for (size_t i = 0; i < n; ++i) {
+        float x = in[i];
+        float y = b0 * x + s0;
+        s0 = b1 * x - a1 * y + s1;
+        s1 = b2 * x - a2 * y;
+        out[i] = y;
+    }
+    state[0] = s0;
+    state[1] = s1;
+}
+
+} // namespace dsp_kernels
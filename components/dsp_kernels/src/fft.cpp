@@ -0,0 +1,119 @@
+#include "dsp_kernels/fft.hpp"
+
+#include <cmath>
+
+namespace dsp_kernels {
+
+esp_err_t Fft::init(size_t n)
+{
+    if (n_ != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (n < 4 || n > max_size || (n & (n - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = twiddles_.init(n / 2);
+    if (err == ESP_OK) {
+        err = bitrev_.init(n);
+    }
+    if (err != ESP_OK) {
+        deinit();
+        return err;
+    }
+
+    /* Twiddles in double precision so large sizes do not accumulate error. */
+    for (size_t k = 0; k < n / 2; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(n);
+        twiddles_[k] = {static_cast<float>(cos(angle)), static_cast<float>(sin(angle))};
+    }
+    size_t bits = 0;
+    while ((size_t(1) << bits) < n) {
+        ++bits;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitrev_[i] = static_cast<uint16_t>(r);
+    }
+    n_ = n;
+    return ESP_OK;
+}
+
+void Fft::deinit()
+{
+    twiddles_.deinit();
+    bitrev_.deinit();
+    n_ = 0;
+}
+
+void Fft::permute(Complex *data) const
+{
+    for (size_t i = 0; i < n_; ++i) {
+        size_t j = bitrev_[i];
+        if (i < j) {
+            Complex t = data[i];
+            data[i] = data[j];
+            data[j] = t;
+        }
+    }
+}
+
+void Fft::butterflies(Complex *data, bool inverse) const
+{
+    const Complex *tw = twiddles_.data();
+    const float sign = inverse ? -1.0f : 1.0f;
+
+    /* First stage: every twiddle is 1, so no multiplies. */
+    for (size_t i = 0; i < n_; i += 2) {
+        Complex a = data[i];
+        Complex b = data[i + 1];
+        data[i] = {a.re + b.re, a.im + b.im};
+        data[i + 1] = {a.re - b.re, a.im - b.im};
+    }
+
+    for (size_t half = 2; half < n_; half <<= 1) {
+        const size_t stride = n_ / (2 * half);
+        for (size_t start = 0; start < n_; start += 2 * half) {
+            Complex *lo = data + start;
+            Complex *hi = lo + half;
+            for (size_t k = 0; k < half; ++k) {
+                const float wr = tw[k * stride].re;
+                const float wi = sign * tw[k * stride].im;
+                const float tr = hi[k].re * wr - hi[k].im * wi;
+                const float ti = hi[k].re * wi + hi[k].im * wr;
+                hi[k].re = lo[k].re - tr;
+                hi[k].im = lo[k].im - ti;
+                lo[k].re += tr;
+                lo[k].im += ti;
+            }
+        }
+    }
+}
+
+void Fft::forward(Complex *data) const
+{
+    permute(data);
+    butterflies(data, false);
+}
+
+void Fft::inverse(Complex *data) const
+{
+    permute(data);
+    butterflies(data, true);
+    const float scale = 1.0f / static_cast<float>(n_);
+    for (size_t i = 0; i < n_; ++i) {
+        data[i].re *= scale;
+        data[i].im *= scale;
+    }
+}
+
+void Fft::power_spectrum(const Complex *data, float *out) const
+{
+    for (size_t i = 0; i <= n_ / 2; ++i) {
+        out[i] = data[i].re * data[i].re + data[i].im * data[i].im;
+    }
+}
+
+} // namespace dsp_kernels
@@ -0,0 +1,123 @@
+#include "dsp_kernels/fir.hpp"
+
+#include <cstring>
+
+#include "dsp_kernels/vector.hpp"
+
+namespace dsp_kernels {
+
+namespace {
+
+size_t round_up(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+float to_output(float acc)
+{
+    return acc;
+}
+
+int16_t to_output(int64_t acc)
+{
+    int64_t v = (acc + (1 << 14)) >> 15;
+    if (v > 32767) {
+        return 32767;
+    }
+    if (v < -32768) {
+        return -32768;
+    }
+    return static_cast<int16_t>(v);
+}
+
+} // namespace
+
+template <typename T>
+esp_err_t Fir<T>::init(const Config &config)
+{
+    if (taps_ != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.coeffs == nullptr || config.taps == 0 || config.max_block == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const size_t taps = config.taps;
+    const bool simd = has_simd && !config.force_scalar;
+    /* Vector windows cover every sub-vector offset and a whole number of the
+     * two-vector steps the dot product takes. */
+    phase_count_ = simd ? lanes : 1;
+    window_ = simd ? round_up(taps + lanes - 1, 2 * lanes) : taps;
+
+    esp_err_t err = phases_.init(phase_count_ * window_);
+    if (err == ESP_OK) {
+        err = history_.init(taps - 1 + config.max_block + window_);
+    }
+    if (err != ESP_OK) {
+        phases_.deinit();
+        history_.deinit();
+        return err;
+    }
+    /* Phase k holds the reversed coefficients shifted right by k. */
+    for (size_t k = 0; k < phase_count_; ++k) {
+        T *phase = phases_.data() + k * window_;
+        for (size_t m = 0; m < taps; ++m) {
+            phase[k + m] = config.coeffs[taps - 1 - m];
+        }
+    }
+    taps_ = taps;
+    max_block_ = config.max_block;
+    return ESP_OK;
+}
+
+template <typename T>
+void Fir<T>::deinit()
+{
+    phases_.deinit();
+    history_.deinit();
+    taps_ = 0;
+}
+
+template <typename T>
+void Fir<T>::reset()
+{
+    memset(history_.data(), 0, history_.size() * sizeof(T));
+}
+
+template <typename T>
+void Fir<T>::process(const T *in, T *out, size_t n)
+{
+    while (n != 0) {
+        size_t chunk = n < max_block_ ? n : max_block_;
+        process_block(in, out, chunk);
+        in += chunk;
+        out += chunk;
+        n -= chunk;
+    }
+}
+
+template <typename T>
+void Fir<T>::process_block(const T *in, T *out, size_t n)
+{
+    T *buf = history_.data();
+    const size_t hist = taps_ - 1;
+    memcpy(buf + hist, in, n * sizeof(T));
+
+    if (phase_count_ > 1) {
+        for (size_t j = 0; j < n; ++j) {
+            size_t base = j & ~(lanes - 1);
+            const T *phase = phases_.data() + (j - base) * window_;
+            out[j] = to_output(dot_product(phase, buf + base, window_));
+        }
+    } else {
+        for (size_t j = 0; j < n; ++j) {
+            out[j] = to_output(scalar::dot_product(phases_.data(), buf + j, taps_));
+        }
+    }
+    memmove(buf, buf + n, hist * sizeof(T));
+}
+
+template class Fir<float>;
+template class Fir<int16_t>;
+
+} // namespace dsp_kernels
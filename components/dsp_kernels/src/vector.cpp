@@ -0,0 +1,158 @@
+#include "dsp_kernels/vector.hpp"
+
+namespace dsp_kernels {
+
+namespace scalar {
+
+float dot_product(const float *a, const float *b, size_t n)
+{
+    /* Four independent accumulators hide the FPU's multiply-add latency. */
+    float acc0 = 0.0f;
+    float acc1 = 0.0f;
+    float acc2 = 0.0f;
+    float acc3 = 0.0f;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        acc0 += a[i] * b[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+int64_t dot_product(const int16_t *a, const int16_t *b, size_t n)
+{
+    int64_t acc = 0;
+    size_t i = 0;
+    /* 32-bit partial sums are exact for two full-scale products. */
+    for (; i + 2 <= n; i += 2) {
+        acc += static_cast<int64_t>(int32_t(a[i]) * b[i]) + int32_t(a[i + 1]) * b[i + 1];
+    }
+    if (i < n) {
+        acc += int32_t(a[i]) * b[i];
+    }
+    return acc;
+}
+
+int32_t dot_product(const int8_t *a, const int8_t *b, size_t n)
+{
+    /* Independent accumulators, as in the float kernel; products fit 16 bits. */
+    int32_t acc0 = 0;
+    int32_t acc1 = 0;
+    int32_t acc2 = 0;
+    int32_t acc3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 += int32_t(a[i]) * b[i];
+        acc1 += int32_t(a[i + 1]) * b[i + 1];
+        acc2 += int32_t(a[i + 2]) * b[i + 2];
+        acc3 += int32_t(a[i + 3]) * b[i + 3];
+    }
+    for (; i < n; ++i) {
+        acc0 += int32_t(a[i]) * b[i];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+void q15_to_float(const int16_t *in, float *out, size_t n)
+{
+    constexpr float scale = 1.0f / 32768.0f;
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<float>(in[i]) * scale;
+    }
+}
+
+void float_to_q15(const float *in, int16_t *out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        /* Saturate before converting; rounding by hand avoids a libm call. */
+        float v = in[i] * 32768.0f;
+        if (v >= 32767.0f) {
+            out[i] = 32767;
+        } else if (v <= -32768.0f) {
+            out[i] = -32768;
+        } else {
+            out[i] = static_cast<int16_t>(v >= 0.0f ? v + 0.5f : v - 0.5f);
+        }
+    }
+}
+
+} // namespace scalar
+
+#if DSP_KERNELS_HAVE_PIE
+
+float dot_product(const float *a, const float *b, size_t n)
+{
+    if (!is_simd_aligned(a) || !is_simd_aligned(b)) {
+        return scalar::dot_product(a, b, n);
+    }
+    size_t body = n & ~size_t(7);
+    float acc = detail::pie_dot_product(a, b, body);
+    for (size_t i = body; i < n; ++i) {
+        acc += a[i] * b[i];
+    }
+    return acc;
+}
+
+int64_t dot_product(const int16_t *a, const int16_t *b, size_t n)
+{
+    if (!is_simd_aligned(a) || !is_simd_aligned(b)) {
+        return scalar::dot_product(a, b, n);
+    }
+    size_t body = n & ~size_t(15);
+    int64_t acc = detail::pie_dot_product(a, b, body);
+    for (size_t i = body; i < n; ++i) {
+        acc += int32_t(a[i]) * b[i];
+    }
+    return acc;
+}
+
+int32_t dot_product(const int8_t *a, const int8_t *b, size_t n)
+{
+    if (!is_simd_aligned(a) || !is_simd_aligned(b)) {
+        return scalar::dot_product(a, b, n);
+    }
+    size_t body = n & ~size_t(15);
+    int32_t acc = body != 0 ? detail::pie_dot_product(a, b, body) : 0;
+    for (size_t i = body; i < n; ++i) {
+        acc += int32_t(a[i]) * b[i];
+    }
+    return acc;
+}
+
+#else
+
+float dot_product(const float *a, const float *b, size_t n)
+{
+    return scalar::dot_product(a, b, n);
+}
+
+int64_t dot_product(const int16_t *a, const int16_t *b, size_t n)
+{
+    return scalar::dot_product(a, b, n);
+}
+
+int32_t dot_product(const int8_t *a, const int8_t *b, size_t n)
+{
+    return scalar::dot_product(a, b, n);
+}
+
+#endif // DSP_KERNELS_HAVE_PIE
+
+/* No PIE instruction helps here: float.s / round.s already convert one value
+ * per instruction, so the scalar loop is the kernel on every target. */
+void q15_to_float(const int16_t *in, float *out, size_t n)
+{
+    scalar::q15_to_float(in, out, n);
+}
+
+void float_to_q15(const float *in, int16_t *out, size_t n)
+{
+    scalar::float_to_q15(in, out, n);
+}
+
+} // namespace dsp_kernels
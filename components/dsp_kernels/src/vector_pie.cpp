@@ -0,0 +1,106 @@
+/*
+ * ESP32-S3 vector bodies. Only the compiler's own registers can be named in
+ * constraints, so the PIE q registers and ACCX are used directly: GCC never
+ * allocates them, and FreeRTOS saves them lazily on a context switch like
+ * the FPU. Neither may be used from an ISR.
+ */
+#include "dsp_kernels/vector.hpp"
+
+#if DSP_KERNELS_HAVE_PIE
+
+namespace dsp_kernels {
+namespace detail {
+
+float pie_dot_product(const float *a, const float *b, size_t n)
+{
+    float acc0 = 0.0f;
+    float acc1 = 0.0f;
+    float acc2 = 0.0f;
+    float acc3 = 0.0f;
+    /* EE.LDF.128.IP fills four FPU registers per load, halving the load
+     * count against lsi; the madd.s chains stay independent. */
+    for (size_t i = 0; i < n; i += 8) {
+        asm volatile("ee.ldf.128.ip f11, f10, f9, f8, %[a], 16\n"
+                     "ee.ldf.128.ip f15, f14, f13, f12, %[b], 16\n"
+                     "madd.s %[s0], f8, f12\n"
+                     "madd.s %[s1], f9, f13\n"
+                     "madd.s %[s2], f10, f14\n"
+                     "madd.s %[s3], f11, f15\n"
+                     "ee.ldf.128.ip f11, f10, f9, f8, %[a], 16\n"
+                     "ee.ldf.128.ip f15, f14, f13, f12, %[b], 16\n"
+                     "madd.s %[s0], f8, f12\n"
+                     "madd.s %[s1], f9, f13\n"
+                     "madd.s %[s2], f10, f14\n"
+                     "madd.s %[s3], f11, f15\n"
+                     : [a] "+r"(a), [b] "+r"(b), [s0] "+f"(acc0), [s1] "+f"(acc1), [s2] "+f"(acc2), [s3] "+f"(acc3)
+                     :
+                     : "f8", "f9", "f10", "f11", "f12", "f13", "f14", "f15", "memory");
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+int64_t pie_dot_product(const int16_t *a, const int16_t *b, size_t n)
+{
+    /* ACCX is 40 bits: 496 full-scale products (2^30 each) cannot overflow it. */
+    constexpr size_t max_chunk = 496;
+    int64_t total = 0;
+    while (n != 0) {
+        size_t chunk = n < max_chunk ? n : max_chunk;
+        asm volatile("ee.zero.accx");
+        for (size_t i = 0; i < chunk; i += 16) {
+            asm volatile("ee.vld.128.ip q0, %[a], 16\n"
+                         "ee.vld.128.ip q1, %[b], 16\n"
+                         "ee.vld.128.ip q2, %[a], 16\n"
+                         "ee.vld.128.ip q3, %[b], 16\n"
+                         "ee.vmulas.s16.accx q0, q1\n"
+                         "ee.vmulas.s16.accx q2, q3\n"
+                         : [a] "+r"(a), [b] "+r"(b)
+                         :
+                         : "memory");
+        }
+        uint32_t lo;
+        uint32_t hi;
+        asm volatile("rur.accx_0 %0" : "=r"(lo));
+        asm volatile("rur.accx_1 %0" : "=r"(hi));
+        /* Sign-extend the 40-bit accumulator. */
+        total += static_cast<int64_t>(static_cast<uint64_t>(static_cast<int8_t>(hi & 0xff)) << 32 | lo);
+        n -= chunk;
+    }
+    return total;
+}
+
+int32_t pie_dot_product(const int8_t *a, const int8_t *b, size_t n)
+{
+    /* Products are at most 2^14, so ACCX cannot overflow for any n whose
+     * sum fits the int32 result; its low word is that result. */
+    asm volatile("ee.zero.accx");
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        asm volatile("ee.vld.128.ip q0, %[a], 16\n"
+                     "ee.vld.128.ip q1, %[b], 16\n"
+                     "ee.vld.128.ip q2, %[a], 16\n"
+                     "ee.vld.128.ip q3, %[b], 16\n"
+                     "ee.vmulas.s8.accx q0, q1\n"
+                     "ee.vmulas.s8.accx q2, q3\n"
+                     : [a] "+r"(a), [b] "+r"(b)
+                     :
+                     : "memory");
+    }
+    /* Layer widths are often a multiple of 16 and not of 32: one more vector. */
+    if (i < n) {
+        asm volatile("ee.vld.128.ip q0, %[a], 16\n"
+                     "ee.vld.128.ip q1, %[b], 16\n"
+                     "ee.vmulas.s8.accx q0, q1\n"
+                     : [a] "+r"(a), [b] "+r"(b)
+                     :
+                     : "memory");
+    }
+    uint32_t lo;
+    asm volatile("rur.accx_0 %0" : "=r"(lo));
+    return static_cast<int32_t>(lo);
+}
+
+} // namespace detail
+} // namespace dsp_kernels
+
+#endif // DSP_KERNELS_HAVE_PIE
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "espnow_mesh/route_cache.hpp"
+#include "mem_pool/slab_pool.hpp"
+
+namespace espnow_mesh {
+
+namespace wire {
+struct Header;
+} // namespace wire
+
+constexpr NodeId broadcast_node = 0xffff;
+
+/** ESP-NOW payload limit (ESP_NOW_MAX_DATA_LEN). */
+constexpr size_t max_frame_size = 250;
+
+/** Frame and message headers on the air; see src/wire.hpp. */
+constexpr size_t frame_header_size = 4;
+constexpr size_t message_header_size = 9;
+
+/** Largest payload of one message: a frame carrying nothing else. */
+constexpr size_t max_payload_size = max_frame_size - frame_header_size - message_header_size;
+
+/**
+ * @brief Transmit priority. Also carried on the air, so forwarders honour it.
+ *
+ * Lower values go first. Each level may only take a queue slot while more
+ * than its reserve (MeshConfig::queue_size / 8 per level below Control) is
+ * free, so a flood of Bulk traffic is refused well before Control has no
+ * room.
+ */
+enum class Priority : uint8_t {
+    Control = 0,
+    High = 1,
+    Normal = 2,
+    Bulk = 3,
+};
+
+constexpr size_t priority_count = 4;
+
+struct RxInfo {
+    NodeId origin;
+    /** Neighbour that delivered the last hop. */
+    NodeId sender;
+    uint8_t hops;
+    int8_t rssi;
+    Priority priority;
+};
+
+/**
+ * @brief Called on the mesh task for each message addressed to this node or broadcast.
+ *
+ * @p data is only valid during the call.
+ */
+using ReceiveFn = void (*)(void *ctx, const RxInfo &info, const uint8_t *data, size_t len);
+
+struct MeshStats {
+    /** Messages accepted by send(). */
+    uint32_t sent;
+    /** send() calls refused for lack of queue space (backpressure). */
+    uint32_t rejected;
+    /** ESP-NOW frames transmitted; (sent + forwarded) / frames is the aggregation factor. */
+    uint32_t frames;
+    uint32_t frame_bytes;
+    /** Frames the next hop did not acknowledge; their messages are retried once by flooding. */
+    uint32_t frame_failures;
+    uint32_t delivered;
+    uint32_t forwarded;
+    /** Queued or forwarded messages given up on: no queue space, out of hops, or failed twice. */
+    uint32_t dropped;
+    /** Flooded messages seen before. */
+    uint32_t duplicates;
+    /** Messages flooded because no route to their destination was cached. */
+    uint32_t route_misses;
+    /** Frames from the RX callback dropped because the mesh task fell behind. */
+    uint32_t rx_overruns;
+    uint32_t queued;
+};
+
+/**
+ * @brief Multi-hop ESP-NOW transport that aggregates small messages into full frames.
+ *
+ * send() queues a message and returns. The mesh task packs queued messages
+ * that share a next hop into one ESP-NOW frame of up to 250 bytes, highest
+ * priority first, once a frame's worth has accumulated or the oldest has
+ * waited Config::linger_ms (Control messages go at once). A node sending a
+ * 12-byte reading every second then puts one frame on the air per dozen
+ * readings instead of one per reading, which is where the airtime and the
+ * collision-driven losses go.
+ *
+ * Queue space is a fixed pool of Config::queue_size messages split across
+ * four priorities with reserves, so backpressure reaches senders as
+ * ESP_ERR_NO_MEM (or a bounded wait) instead of as silent losses.
+ *
+ * Routing learns from traffic: every received message caches its origin as
+ * reachable through the neighbour that delivered it. Unicast messages
+ * follow the cached next hop; without one - or when the next hop stops
+ * acknowledging - they are flooded with a hop limit and duplicate
+ * suppression, which in turn teaches the routes back. ESP-NOW peers are
+ * added and evicted on demand to stay under the driver's peer limit.
+ *
+ * Wi-Fi must be started (STA or AP) on the deployment's common channel
+ * before init(). ESP-NOW has one set of callbacks per device, so there is
+ * one Mesh per device.
+ */
+class Mesh {
+public:
+    struct Config {
+        /** This node's 16-bit address, unique in the deployment; 0 derives it from the station MAC. */
+        NodeId node_id = 0;
+        /** Messages queued for transmission or forwarding, across all priorities. */
+        size_t queue_size = 48;
+        /**
+         * Largest payload send() accepts; sets the queue block size. Use the
+         * same value on every node: larger messages cannot be forwarded.
+         */
+        size_t max_payload = 64;
+        /** Longest a queued message waits for others to share its frame. */
+        uint32_t linger_ms = 20;
+        /** Hop limit of originated messages, at most 15. */
+        uint8_t ttl = 6;
+        size_t route_cache_size = 48;
+        /** Routes not refreshed by traffic for this long are dropped. */
+        uint32_t route_timeout_ms = 120000;
+        /** ESP-NOW peers this mesh keeps registered; the driver allows 20 in total. */
+        size_t max_peers = 16;
+        /** Received frames buffered between the Wi-Fi task and the mesh task. */
+        size_t rx_queue_depth = 8;
+        ReceiveFn on_receive = nullptr;
+        void *receive_ctx = nullptr;
+        const char *task_name = "espnow_mesh";
+        uint32_t stack_size = 4096;
+        UBaseType_t priority = 6;
+        BaseType_t core = tskNO_AFFINITY;
+    };
+
+    Mesh() = default;
+    ~Mesh() { deinit(); }
+
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    /** Initialize ESP-NOW, register the callbacks and start the mesh task. */
+    esp_err_t init(const Config &config);
+
+    /** Stop the task and deinitialize ESP-NOW. Queued messages are dropped. */
+    void deinit();
+
+    NodeId node_id() const { return config_.node_id; }
+
+    /**
+     * @brief Queue @p len bytes for @p dest (broadcast_node floods to every node).
+     *
+     * @p wait bounds how long to block for queue space; 0 fails at once.
+     * @return ESP_ERR_NO_MEM when the priority's share of the queue stays
+     * full, ESP_ERR_INVALID_SIZE for payloads over Config::max_payload.
+     */
+    esp_err_t send(NodeId dest, const void *data, size_t len, Priority priority = Priority::Normal,
+                   TickType_t wait = 0);
+
+    /** Transmit what is queued now instead of waiting out the linger time. */
+    void flush();
+
+    /** Hops to @p dest as currently cached, or 0 if unknown. */
+    uint8_t route_hops(NodeId dest) const;
+
+    MeshStats stats() const;
+
+private:
+    struct Message;
+    struct RxFrame;
+    /* The ESP-NOW callbacks, defined next to the driver types in mesh.cpp. */
+    struct Callbacks;
+
+    static void task_entry(void *arg);
+
+    void run();
+    void handle_frame(const RxFrame &frame, int64_t now);
+    void handle_message(const RxFrame &frame, NodeId sender, const uint8_t *message, int64_t now);
+    esp_err_t enqueue_locked(const wire::Header &header, uint8_t retries, const void *payload, int64_t now,
+                             bool *wake);
+    void route_locked(Message *m, int64_t now);
+    void append_locked(Message *m);
+    Message *take_block_locked(Priority priority);
+    void free_block_locked(Message *m);
+    bool transmit(int64_t now);
+    int64_t next_deadline();
+    void finish_frame(bool acked);
+    esp_err_t use_peer(const uint8_t mac[6], int64_t now);
+    void notify(uint32_t bits);
+
+    Config config_;
+    mem_pool::SlabPool pool_;
+    TaskHandle_t task_ = nullptr;
+    QueueHandle_t rx_queue_ = nullptr;
+    SemaphoreHandle_t lock_ = nullptr;
+    /* Given whenever a queue block is freed; send() waits on it. */
+    SemaphoreHandle_t space_ = nullptr;
+    int ifidx_ = 0;
+
+    /* Guarded by lock_. */
+    RouteCache routes_;
+    Message *head_[priority_count] = {};
+    Message *tail_[priority_count] = {};
+    size_t free_blocks_ = 0;
+    /* Bytes the queued messages take on the air. */
+    size_t queued_bytes_ = 0;
+    uint16_t next_seq_ = 0;
+    bool flush_requested_ = false;
+
+    /* Mesh task only: the frame on the air and the messages it carries. */
+    DuplicateFilter seen_;
+    Message *in_flight_ = nullptr;
+    uint8_t in_flight_mac_[6] = {};
+    uint8_t frame_[max_frame_size];
+    uint8_t (*peers_)[6] = nullptr;
+    int64_t *peer_used_ = nullptr;
+    size_t peer_count_ = 0;
+
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint32_t> sent_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> frames_{0};
+    std::atomic<uint32_t> frame_bytes_{0};
+    std::atomic<uint32_t> frame_failures_{0};
+    std::atomic<uint32_t> delivered_{0};
+    std::atomic<uint32_t> forwarded_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> duplicates_{0};
+    std::atomic<uint32_t> route_misses_{0};
+    std::atomic<uint32_t> rx_overruns_{0};
+};
+
+} // namespace espnow_mesh
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+namespace espnow_mesh {
+
+using NodeId = uint16_t;
+
+/**
+ * @brief Destination -> next-hop MAC table, learned from received traffic.
+ *
+ * A fresh route is only replaced by one at most as long, or by any route
+ * once it has gone Config::timeout_ms without being refreshed; when full,
+ * the least recently refreshed entry goes. Linear search: sized for tens of
+ * nodes. Not thread-safe.
+ */
+class RouteCache {
+public:
+    struct Entry {
+        NodeId dest;
+        uint8_t hops;
+        bool valid;
+        uint8_t next_hop[6];
+        int64_t refreshed_us;
+    };
+
+    RouteCache() = default;
+    ~RouteCache() { deinit(); }
+
+    RouteCache(const RouteCache &) = delete;
+    RouteCache &operator=(const RouteCache &) = delete;
+
+    esp_err_t init(size_t capacity, uint32_t timeout_ms);
+    void deinit();
+
+    /** Live route to @p dest, or nullptr. */
+    const Entry *lookup(NodeId dest, int64_t now_us) const;
+
+    /** @p dest was heard @p hops away through @p next_hop. */
+    void learn(NodeId dest, const uint8_t next_hop[6], uint8_t hops, int64_t now_us);
+
+    /** Drop every route through @p next_hop, e.g. after it stopped acknowledging. */
+    void forget_via(const uint8_t next_hop[6]);
+
+private:
+    bool expired(const Entry &e, int64_t now_us) const { return now_us - e.refreshed_us > timeout_us_; }
+
+    Entry *entries_ = nullptr;
+    size_t capacity_ = 0;
+    int64_t timeout_us_ = 0;
+};
+
+/**
+ * @brief Recently seen (origin, sequence) pairs, to drop flooded and retried duplicates.
+ *
+ * A ring: the window is the last Capacity messages, whatever their origin.
+ */
+class DuplicateFilter {
+public:
+    static constexpr size_t capacity = 64;
+
+    /** @return true if (@p origin, @p seq) was already seen; records it otherwise. */
+    bool check_and_insert(NodeId origin, uint16_t seq);
+
+private:
+    uint32_t keys_[capacity] = {};
+    size_t next_ = 0;
+    size_t used_ = 0;
+};
+
+} // namespace espnow_mesh
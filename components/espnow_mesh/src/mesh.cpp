@@ -0,0 +1,716 @@
+#include "espnow_mesh/mesh.hpp"
+
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_now.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "wire.hpp"
+
+namespace espnow_mesh {
+
+static const char *TAG = "espnow_mesh";
+
+namespace {
+
+constexpr uint32_t wake_bit = 1u << 0;
+constexpr uint32_t sent_ok_bit = 1u << 1;
+constexpr uint32_t sent_fail_bit = 1u << 2;
+
+/* The driver reports a unicast's fate within a few retries; past this the
+ * frame is treated as lost. */
+constexpr int64_t send_timeout_us = 100 * 1000;
+
+const uint8_t broadcast_mac[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+/* ESP-NOW callbacks carry no context: the one Mesh they serve. */
+Mesh *s_mesh = nullptr;
+
+bool is_broadcast(const uint8_t *mac)
+{
+    return memcmp(mac, broadcast_mac, 6) == 0;
+}
+
+TickType_t ticks_until(int64_t deadline_us, int64_t now_us)
+{
+    if (deadline_us == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    if (deadline_us <= now_us) {
+        return 0;
+    }
+    /* Round up so the task does not wake just short of the deadline. */
+    return pdMS_TO_TICKS((deadline_us - now_us + 999) / 1000) + 1;
+}
+
+} // namespace
+
+/* A queue block: header, routing state, then Config::max_payload bytes. */
+struct Mesh::Message {
+    Message *next;
+    int64_t queued_us;
+    wire::Header header;
+    uint8_t next_hop[6];
+    uint8_t retries;
+
+    uint8_t *payload() { return reinterpret_cast<uint8_t *>(this + 1); }
+    size_t air_size() const { return message_header_size + header.len; }
+};
+
+struct Mesh::RxFrame {
+    uint8_t mac[6];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t data[max_frame_size];
+};
+
+struct Mesh::Callbacks {
+    /* Wi-Fi task: copy the frame out and leave the parsing to the mesh task. */
+    static void on_recv(const esp_now_recv_info_t *info, const uint8_t *data, int len)
+    {
+        Mesh *mesh = s_mesh;
+        if (mesh == nullptr || len < static_cast<int>(frame_header_size) || len > static_cast<int>(max_frame_size)) {
+            return;
+        }
+        RxFrame frame;
+        memcpy(frame.mac, info->src_addr, 6);
+        frame.rssi = info->rx_ctrl != nullptr ? static_cast<int8_t>(info->rx_ctrl->rssi) : 0;
+        frame.len = static_cast<uint8_t>(len);
+        memcpy(frame.data, data, len);
+        if (xQueueSend(mesh->rx_queue_, &frame, 0) != pdTRUE) {
+            mesh->rx_overruns_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        mesh->notify(wake_bit);
+    }
+
+    static void on_send(const uint8_t *, esp_now_send_status_t status)
+    {
+        Mesh *mesh = s_mesh;
+        if (mesh != nullptr) {
+            mesh->notify(status == ESP_NOW_SEND_SUCCESS ? sent_ok_bit : sent_fail_bit);
+        }
+    }
+};
+
+esp_err_t Mesh::init(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_mesh != nullptr) {
+        ESP_LOGE(TAG, "ESP-NOW already has a mesh; one per device");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.queue_size < 8 || config.queue_size > mem_pool::SlabPool::max_blocks || config.max_payload == 0 ||
+        config.max_payload > max_payload_size || config.ttl == 0 || config.ttl > wire::max_hops ||
+        config.route_cache_size == 0 || config.max_peers == 0 || config.rx_queue_depth == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+    if (config_.node_id == 0) {
+        uint8_t mac[6];
+        esp_err_t err = esp_read_mac(mac, ESP_MAC_WIFI_STA);
+        if (err != ESP_OK) {
+            return err;
+        }
+        config_.node_id = static_cast<NodeId>(mac[4] << 8 | mac[5]);
+        if (config_.node_id == 0 || config_.node_id == broadcast_node) {
+            config_.node_id ^= 1;
+        }
+    }
+    wifi_mode_t mode;
+    esp_err_t err = esp_wifi_get_mode(&mode);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "start Wi-Fi before the mesh: %s", esp_err_to_name(err));
+        return err;
+    }
+    ifidx_ = mode == WIFI_MODE_AP ? WIFI_IF_AP : WIFI_IF_STA;
+
+    mem_pool::SlabPool::Config pool_config;
+    pool_config.name = "espnow_mesh";
+    pool_config.block_size = sizeof(Message) + config_.max_payload;
+    pool_config.block_count = config_.queue_size;
+    pool_config.alignment = alignof(Message);
+    err = pool_.init(pool_config);
+    if (err == ESP_OK) {
+        err = routes_.init(config_.route_cache_size, config_.route_timeout_ms);
+    }
+    if (err != ESP_OK) {
+        deinit();
+        return err;
+    }
+    constexpr uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    peers_ = static_cast<uint8_t(*)[6]>(heap_caps_calloc(config_.max_peers, 6, caps));
+    peer_used_ = static_cast<int64_t *>(heap_caps_calloc(config_.max_peers, sizeof(int64_t), caps));
+    lock_ = xSemaphoreCreateMutex();
+    space_ = xSemaphoreCreateBinary();
+    rx_queue_ = xQueueCreate(config_.rx_queue_depth, sizeof(RxFrame));
+    if (peers_ == nullptr || peer_used_ == nullptr || lock_ == nullptr || space_ == nullptr ||
+        rx_queue_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t p = 0; p < priority_count; ++p) {
+        head_[p] = tail_[p] = nullptr;
+    }
+    free_blocks_ = config_.queue_size;
+    queued_bytes_ = 0;
+    peer_count_ = 0;
+    in_flight_ = nullptr;
+    flush_requested_ = false;
+    /* Other nodes' duplicate filters may still hold sequence numbers from
+     * before a reboot. */
+    next_seq_ = static_cast<uint16_t>(esp_random());
+
+    err = esp_now_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_now_init failed: %s", esp_err_to_name(err));
+        deinit();
+        return err;
+    }
+    s_mesh = this;
+    esp_now_register_recv_cb(Callbacks::on_recv);
+    esp_now_register_send_cb(Callbacks::on_send);
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, broadcast_mac, 6);
+    peer.ifidx = static_cast<wifi_interface_t>(ifidx_);
+    err = esp_now_add_peer(&peer);
+    if (err != ESP_OK && err != ESP_ERR_ESPNOW_EXIST) {
+        deinit();
+        return err;
+    }
+
+    stopping_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(task_entry, config_.task_name, config_.stack_size, this, config_.priority, &task_,
+                                config_.core) != pdPASS) {
+        running_.store(false, std::memory_order_relaxed);
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "node %04x, %u-message queue", config_.node_id, static_cast<unsigned>(config_.queue_size));
+    return ESP_OK;
+}
+
+void Mesh::deinit()
+{
+    /* Callbacks first, so none touches the task or the RX queue below; a
+     * send the task still attempts fails and is requeued. */
+    if (s_mesh == this) {
+        esp_now_unregister_recv_cb();
+        esp_now_unregister_send_cb();
+        esp_now_deinit();
+        s_mesh = nullptr;
+    }
+    stopping_.store(true, std::memory_order_seq_cst);
+    notify(wake_bit);
+    while (running_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    for (size_t p = 0; p < priority_count; ++p) {
+        for (Message *m = head_[p]; m != nullptr;) {
+            Message *next = m->next;
+            pool_.deallocate(m);
+            m = next;
+        }
+        head_[p] = tail_[p] = nullptr;
+    }
+    for (Message *m = in_flight_; m != nullptr;) {
+        Message *next = m->next;
+        pool_.deallocate(m);
+        m = next;
+    }
+    in_flight_ = nullptr;
+    pool_.deinit();
+    routes_.deinit();
+    if (rx_queue_ != nullptr) {
+        vQueueDelete(rx_queue_);
+        rx_queue_ = nullptr;
+    }
+    if (space_ != nullptr) {
+        vSemaphoreDelete(space_);
+        space_ = nullptr;
+    }
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+    heap_caps_free(peers_);
+    heap_caps_free(peer_used_);
+    peers_ = nullptr;
+    peer_used_ = nullptr;
+}
+
+esp_err_t Mesh::send(NodeId dest, const void *data, size_t len, Priority priority, TickType_t wait)
+{
+    if (task_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len == 0 || len > config_.max_payload) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (data == nullptr || dest == config_.node_id || static_cast<size_t>(priority) >= priority_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    wire::Header header = {};
+    header.dest = dest;
+    header.origin = config_.node_id;
+    header.ttl = config_.ttl;
+    header.priority = priority;
+    header.len = static_cast<uint8_t>(len);
+
+    TickType_t start = xTaskGetTickCount();
+    for (;;) {
+        bool wake = false;
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        header.seq = next_seq_;
+        esp_err_t err = enqueue_locked(header, 0, data, esp_timer_get_time(), &wake);
+        if (err == ESP_OK) {
+            ++next_seq_;
+        }
+        xSemaphoreGive(lock_);
+        if (err == ESP_OK) {
+            sent_.fetch_add(1, std::memory_order_relaxed);
+            if (wake) {
+                notify(wake_bit);
+            }
+            return ESP_OK;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= wait) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return err;
+        }
+        xSemaphoreTake(space_, wait - elapsed);
+    }
+}
+
+void Mesh::flush()
+{
+    if (lock_ == nullptr) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    flush_requested_ = true;
+    xSemaphoreGive(lock_);
+    notify(wake_bit);
+}
+
+uint8_t Mesh::route_hops(NodeId dest) const
+{
+    if (lock_ == nullptr) {
+        return 0;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const RouteCache::Entry *e = routes_.lookup(dest, esp_timer_get_time());
+    uint8_t hops = e != nullptr ? e->hops : 0;
+    xSemaphoreGive(lock_);
+    return hops;
+}
+
+MeshStats Mesh::stats() const
+{
+    MeshStats s = {};
+    s.sent = sent_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.frames = frames_.load(std::memory_order_relaxed);
+    s.frame_bytes = frame_bytes_.load(std::memory_order_relaxed);
+    s.frame_failures = frame_failures_.load(std::memory_order_relaxed);
+    s.delivered = delivered_.load(std::memory_order_relaxed);
+    s.forwarded = forwarded_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.duplicates = duplicates_.load(std::memory_order_relaxed);
+    s.route_misses = route_misses_.load(std::memory_order_relaxed);
+    s.rx_overruns = rx_overruns_.load(std::memory_order_relaxed);
+    if (lock_ != nullptr) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        s.queued = static_cast<uint32_t>(config_.queue_size - free_blocks_);
+        xSemaphoreGive(lock_);
+    }
+    return s;
+}
+
+/* Each priority below Control keeps queue_size / 8 more blocks in reserve
+ * for the levels above it. */
+Mesh::Message *Mesh::take_block_locked(Priority priority)
+{
+    size_t reserve = config_.queue_size / 8 * static_cast<size_t>(priority);
+    if (free_blocks_ <= reserve) {
+        return nullptr;
+    }
+    auto *m = static_cast<Message *>(pool_.allocate());
+    if (m != nullptr) {
+        --free_blocks_;
+    }
+    return m;
+}
+
+void Mesh::free_block_locked(Message *m)
+{
+    pool_.deallocate(m);
+    ++free_blocks_;
+    xSemaphoreGive(space_);
+}
+
+esp_err_t Mesh::enqueue_locked(const wire::Header &header, uint8_t retries, const void *payload, int64_t now,
+                               bool *wake)
+{
+    Message *m = take_block_locked(header.priority);
+    if (m == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    m->header = header;
+    m->header.flood = false;
+    m->retries = retries;
+    m->queued_us = now;
+    memcpy(m->payload(), payload, header.len);
+    route_locked(m, now);
+
+    /* The mesh task only needs waking when its next deadline moves earlier
+     * or a frame's worth is waiting; otherwise its linger timer covers it. */
+    bool was_empty = queued_bytes_ == 0;
+    append_locked(m);
+    *wake = was_empty || header.priority == Priority::Control ||
+            queued_bytes_ >= max_frame_size - frame_header_size;
+    return ESP_OK;
+}
+
+void Mesh::route_locked(Message *m, int64_t now)
+{
+    const RouteCache::Entry *e = m->header.dest != broadcast_node ? routes_.lookup(m->header.dest, now) : nullptr;
+    if (e != nullptr) {
+        memcpy(m->next_hop, e->next_hop, 6);
+        m->header.flood = false;
+        return;
+    }
+    if (m->header.dest != broadcast_node) {
+        route_misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    memcpy(m->next_hop, broadcast_mac, 6);
+    m->header.flood = true;
+}
+
+void Mesh::append_locked(Message *m)
+{
+    auto p = static_cast<size_t>(m->header.priority);
+    m->next = nullptr;
+    if (tail_[p] != nullptr) {
+        tail_[p]->next = m;
+    } else {
+        head_[p] = m;
+    }
+    tail_[p] = m;
+    queued_bytes_ += m->air_size();
+}
+
+void Mesh::task_entry(void *arg)
+{
+    static_cast<Mesh *>(arg)->run();
+}
+
+void Mesh::run()
+{
+    int64_t sent_at = 0;
+    while (!stopping_.load(std::memory_order_acquire)) {
+        int64_t now = esp_timer_get_time();
+        TickType_t timeout =
+            in_flight_ != nullptr ? ticks_until(sent_at + send_timeout_us, now) : ticks_until(next_deadline(), now);
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, timeout);
+        now = esp_timer_get_time();
+
+        if (in_flight_ != nullptr) {
+            if ((bits & (sent_ok_bit | sent_fail_bit)) != 0) {
+                finish_frame((bits & sent_ok_bit) != 0);
+            } else if (now - sent_at >= send_timeout_us) {
+                finish_frame(false);
+            }
+        }
+        RxFrame frame;
+        while (xQueueReceive(rx_queue_, &frame, 0) == pdTRUE) {
+            handle_frame(frame, now);
+        }
+        if (in_flight_ == nullptr && transmit(now)) {
+            sent_at = now;
+        }
+    }
+    running_.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+/* When the oldest message of the highest priority stops lingering. */
+int64_t Mesh::next_deadline()
+{
+    int64_t deadline = INT64_MAX;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    for (size_t p = 0; p < priority_count; ++p) {
+        if (head_[p] != nullptr) {
+            deadline = flush_requested_ ? 0 : head_[p]->queued_us + static_cast<int64_t>(config_.linger_ms) * 1000;
+            break;
+        }
+    }
+    xSemaphoreGive(lock_);
+    return deadline;
+}
+
+/*
+ * Send one frame to the next hop of the highest-priority queued message,
+ * filled with every queued message for that hop, by priority and then age,
+ * that fits - if it is worth sending yet.
+ */
+bool Mesh::transmit(int64_t now)
+{
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    Message *first = nullptr;
+    for (size_t p = 0; p < priority_count && first == nullptr; ++p) {
+        first = head_[p];
+    }
+    if (first == nullptr) {
+        flush_requested_ = false;
+        xSemaphoreGive(lock_);
+        return false;
+    }
+    uint8_t hop[6];
+    memcpy(hop, first->next_hop, 6);
+
+    /* First pass: would the frame be full, urgent or overdue? */
+    size_t used = frame_header_size;
+    bool ready = flush_requested_;
+    for (size_t p = 0; p < priority_count; ++p) {
+        for (Message *m = head_[p]; m != nullptr; m = m->next) {
+            if (memcmp(m->next_hop, hop, 6) != 0) {
+                continue;
+            }
+            if (used + m->air_size() > max_frame_size) {
+                ready = true;
+                continue;
+            }
+            used += m->air_size();
+            if (m->header.priority == Priority::Control ||
+                now - m->queued_us >= static_cast<int64_t>(config_.linger_ms) * 1000) {
+                ready = true;
+            }
+        }
+    }
+    if (!ready && used + message_header_size < max_frame_size) {
+        xSemaphoreGive(lock_);
+        return false;
+    }
+
+    /* Second pass: move the same messages into the frame. */
+    wire::encode_frame_header(config_.node_id, frame_);
+    size_t len = frame_header_size;
+    Message **chain = &in_flight_;
+    for (size_t p = 0; p < priority_count; ++p) {
+        Message *prev = nullptr;
+        for (Message *m = head_[p]; m != nullptr;) {
+            Message *next = m->next;
+            if (memcmp(m->next_hop, hop, 6) != 0 || len + m->air_size() > max_frame_size) {
+                prev = m;
+                m = next;
+                continue;
+            }
+            (prev != nullptr ? prev->next : head_[p]) = next;
+            if (tail_[p] == m) {
+                tail_[p] = prev;
+            }
+            queued_bytes_ -= m->air_size();
+            wire::encode(m->header, frame_ + len);
+            memcpy(frame_ + len + message_header_size, m->payload(), m->header.len);
+            len += m->air_size();
+            m->next = nullptr;
+            *chain = m;
+            chain = &m->next;
+            m = next;
+        }
+    }
+    xSemaphoreGive(lock_);
+
+    memcpy(in_flight_mac_, hop, 6);
+    esp_err_t err = use_peer(hop, now);
+    if (err == ESP_OK) {
+        err = esp_now_send(hop, frame_, len);
+    }
+    if (err != ESP_OK) {
+        /* Local trouble (driver out of buffers, peer table full): not the
+         * next hop's fault, so requeue without spending the retry. */
+        ESP_LOGD(TAG, "esp_now_send: %s", esp_err_to_name(err));
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        for (Message *m = in_flight_; m != nullptr;) {
+            Message *next = m->next;
+            append_locked(m);
+            m = next;
+        }
+        xSemaphoreGive(lock_);
+        in_flight_ = nullptr;
+        vTaskDelay(1);
+        return false;
+    }
+    frames_.fetch_add(1, std::memory_order_relaxed);
+    frame_bytes_.fetch_add(static_cast<uint32_t>(len), std::memory_order_relaxed);
+    return true;
+}
+
+void Mesh::finish_frame(bool acked)
+{
+    bool failed = !acked && !is_broadcast(in_flight_mac_);
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (failed) {
+        frame_failures_.fetch_add(1, std::memory_order_relaxed);
+        routes_.forget_via(in_flight_mac_);
+    }
+    int64_t now = esp_timer_get_time();
+    for (Message *m = in_flight_; m != nullptr;) {
+        Message *next = m->next;
+        if (failed && m->retries == 0) {
+            /* Reroute: another cached path, or a flood. */
+            m->retries = 1;
+            route_locked(m, now);
+            append_locked(m);
+        } else {
+            if (failed) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            free_block_locked(m);
+        }
+        m = next;
+    }
+    xSemaphoreGive(lock_);
+    in_flight_ = nullptr;
+}
+
+void Mesh::handle_frame(const RxFrame &frame, int64_t now)
+{
+    NodeId sender;
+    if (!wire::decode_frame_header(frame.data, frame.len, &sender) || sender == config_.node_id) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    routes_.learn(sender, frame.mac, 1, now);
+    xSemaphoreGive(lock_);
+
+    size_t offset = frame_header_size;
+    while (offset + message_header_size <= frame.len) {
+        const uint8_t *message = frame.data + offset;
+        size_t size = message_header_size + message[8];
+        if (offset + size > frame.len) {
+            break;
+        }
+        handle_message(frame, sender, message, now);
+        offset += size;
+    }
+}
+
+void Mesh::handle_message(const RxFrame &frame, NodeId sender, const uint8_t *message, int64_t now)
+{
+    wire::Header h = wire::decode(message);
+    const uint8_t *payload = message + message_header_size;
+    /* Our own flood coming back, or a copy already handled. */
+    if (h.origin == config_.node_id) {
+        return;
+    }
+    if (seen_.check_and_insert(h.origin, h.seq)) {
+        duplicates_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint8_t hops = h.hops < wire::max_hops ? h.hops + 1 : wire::max_hops;
+    if (h.origin != sender) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        routes_.learn(h.origin, frame.mac, hops, now);
+        xSemaphoreGive(lock_);
+    }
+
+    bool mine = h.dest == config_.node_id;
+    bool everyone = h.dest == broadcast_node;
+    if (mine || everyone) {
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+        if (config_.on_receive != nullptr) {
+            RxInfo info = {h.origin, sender, hops, frame.rssi, h.priority};
+            config_.on_receive(config_.receive_ctx, info, payload, h.len);
+        }
+    }
+    if (mine) {
+        return;
+    }
+    if (h.ttl <= 1 || h.len > config_.max_payload) {
+        /* A broadcast running out of hops is its normal end. */
+        if (!everyone) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    wire::Header forward = h;
+    forward.ttl = h.ttl - 1;
+    forward.hops = hops;
+    bool wake = false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    esp_err_t err = enqueue_locked(forward, 0, payload, now, &wake);
+    xSemaphoreGive(lock_);
+    (err == ESP_OK ? forwarded_ : dropped_).fetch_add(1, std::memory_order_relaxed);
+}
+
+/* Keep @p mac registered with ESP-NOW, evicting our least recently used peer if needed. */
+esp_err_t Mesh::use_peer(const uint8_t mac[6], int64_t now)
+{
+    if (is_broadcast(mac)) {
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < peer_count_; ++i) {
+        if (memcmp(peers_[i], mac, 6) == 0) {
+            peer_used_[i] = now;
+            return ESP_OK;
+        }
+    }
+    if (esp_now_is_peer_exist(mac)) {
+        /* Registered by the application; leave it alone. */
+        return ESP_OK;
+    }
+    size_t slot = peer_count_;
+    if (peer_count_ == config_.max_peers) {
+        slot = 0;
+        for (size_t i = 1; i < peer_count_; ++i) {
+            if (peer_used_[i] < peer_used_[slot]) {
+                slot = i;
+            }
+        }
+        esp_now_del_peer(peers_[slot]);
+        peers_[slot][0] = 0xff; /* never matches a unicast MAC until reused */
+    }
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, mac, 6);
+    peer.ifidx = static_cast<wifi_interface_t>(ifidx_);
+    esp_err_t err = esp_now_add_peer(&peer);
+    if (err != ESP_OK) {
+        if (slot < peer_count_) {
+            /* The evicted slot is empty now: fill it from the end. */
+            --peer_count_;
+            memcpy(peers_[slot], peers_[peer_count_], 6);
+            peer_used_[slot] = peer_used_[peer_count_];
+        }
+        return err;
+    }
+    memcpy(peers_[slot], mac, 6);
+    peer_used_[slot] = now;
+    if (slot == peer_count_) {
+        ++peer_count_;
+    }
+    return ESP_OK;
+}
+
+void Mesh::notify(uint32_t bits)
+{
+    TaskHandle_t task = task_;
+    if (task != nullptr) {
+        xTaskNotify(task, bits, eSetBits);
+    }
+}
+
+} // namespace espnow_mesh
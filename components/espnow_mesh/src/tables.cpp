@@ -0,0 +1,105 @@
+#include "espnow_mesh/route_cache.hpp"
+
+#include <cstring>
+
+#include "esp_heap_caps.h"
+
+namespace espnow_mesh {
+
+esp_err_t RouteCache::init(size_t capacity, uint32_t timeout_ms)
+{
+    if (entries_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (capacity == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    entries_ = static_cast<Entry *>(heap_caps_calloc(capacity, sizeof(Entry), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (entries_ == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    capacity_ = capacity;
+    timeout_us_ = static_cast<int64_t>(timeout_ms) * 1000;
+    return ESP_OK;
+}
+
+void RouteCache::deinit()
+{
+    heap_caps_free(entries_);
+    entries_ = nullptr;
+    capacity_ = 0;
+}
+
+const RouteCache::Entry *RouteCache::lookup(NodeId dest, int64_t now_us) const
+{
+    for (size_t i = 0; i < capacity_; ++i) {
+        const Entry &e = entries_[i];
+        if (e.valid && e.dest == dest) {
+            return expired(e, now_us) ? nullptr : &e;
+        }
+    }
+    return nullptr;
+}
+
+void RouteCache::learn(NodeId dest, const uint8_t next_hop[6], uint8_t hops, int64_t now_us)
+{
+    Entry *slot = nullptr;
+    Entry *oldest = nullptr;
+    for (size_t i = 0; i < capacity_; ++i) {
+        Entry &e = entries_[i];
+        if (e.valid && e.dest == dest) {
+            bool same_hop = memcmp(e.next_hop, next_hop, 6) == 0;
+            if (!same_hop && hops > e.hops && !expired(e, now_us)) {
+                return;
+            }
+            slot = &e;
+            break;
+        }
+        if (slot == nullptr && !e.valid) {
+            slot = &e;
+        }
+        if (oldest == nullptr || e.refreshed_us < oldest->refreshed_us) {
+            oldest = &e;
+        }
+    }
+    if (slot == nullptr) {
+        slot = oldest;
+    }
+    if (slot == nullptr) {
+        return;
+    }
+    /* The first free slot may precede the entry for dest; the loop only
+     * stops early on that entry, so this never duplicates one. */
+    slot->dest = dest;
+    slot->hops = hops;
+    slot->valid = true;
+    memcpy(slot->next_hop, next_hop, 6);
+    slot->refreshed_us = now_us;
+}
+
+void RouteCache::forget_via(const uint8_t next_hop[6])
+{
+    for (size_t i = 0; i < capacity_; ++i) {
+        if (entries_[i].valid && memcmp(entries_[i].next_hop, next_hop, 6) == 0) {
+            entries_[i].valid = false;
+        }
+    }
+}
+
+bool DuplicateFilter::check_and_insert(NodeId origin, uint16_t seq)
+{
+    uint32_t key = static_cast<uint32_t>(origin) << 16 | seq;
+    for (size_t i = 0; i < used_; ++i) {
+        if (keys_[i] == key) {
+            return true;
+        }
+    }
+    keys_[next_] = key;
+    next_ = (next_ + 1) % capacity;
+    if (used_ < capacity) {
+        ++used_;
+    }
+    return false;
+}
+
+} // namespace espnow_mesh
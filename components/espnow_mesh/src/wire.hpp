@@ -0,0 +1,90 @@
+/*
+ * On-air format. A frame is one ESP-NOW payload:
+ *
+ *   magic u8 | version u8 | sender u16 | message...
+ *
+ * and each message is a 9-byte header followed by its payload:
+ *
+ *   dest u16 | origin u16 | seq u16 | ttl:4 hops:4 | priority:2 flood:1 | len u8
+ *
+ * Integers are little-endian. hops counts the forwards so far (0 from the
+ * origin); flood marks a message broadcast because no route was known.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "espnow_mesh/mesh.hpp"
+
+namespace espnow_mesh {
+namespace wire {
+
+constexpr uint8_t magic = 0x6d;
+constexpr uint8_t version = 1;
+constexpr uint8_t max_hops = 15;
+
+struct Header {
+    NodeId dest;
+    NodeId origin;
+    uint16_t seq;
+    uint8_t ttl;
+    uint8_t hops;
+    Priority priority;
+    bool flood;
+    uint8_t len;
+};
+
+inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+inline uint16_t get_u16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+inline void encode_frame_header(NodeId sender, uint8_t *p)
+{
+    p[0] = magic;
+    p[1] = version;
+    put_u16(p + 2, sender);
+}
+
+inline bool decode_frame_header(const uint8_t *p, size_t len, NodeId *sender)
+{
+    if (len < frame_header_size || p[0] != magic || p[1] != version) {
+        return false;
+    }
+    *sender = get_u16(p + 2);
+    return true;
+}
+
+inline void encode(const Header &h, uint8_t *p)
+{
+    put_u16(p, h.dest);
+    put_u16(p + 2, h.origin);
+    put_u16(p + 4, h.seq);
+    p[6] = static_cast<uint8_t>((h.ttl & 0x0f) | (h.hops & 0x0f) << 4);
+    p[7] = static_cast<uint8_t>((static_cast<uint8_t>(h.priority) & 0x03) | (h.flood ? 0x04 : 0));
+    p[8] = h.len;
+}
+
+inline Header decode(const uint8_t *p)
+{
+    Header h;
+    h.dest = get_u16(p);
+    h.origin = get_u16(p + 2);
+    h.seq = get_u16(p + 4);
+    h.ttl = p[6] & 0x0f;
+    h.hops = p[6] >> 4;
+    h.priority = static_cast<Priority>(p[7] & 0x03);
+    h.flood = (p[7] & 0x04) != 0;
+    h.len = p[8];
+    return h;
+}
+
+} // namespace wire
+} // namespace espnow_mesh
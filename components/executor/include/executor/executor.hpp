@@ -0,0 +1,311 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "esp_err.h"
+#include "executor/job.hpp"
+#include "executor/work_deque.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lf_ring/mpsc_ring.hpp"
+#include "mem_pool/slab_pool.hpp"
+#include "sdkconfig.h"
+
+namespace executor {
+
+template <typename T>
+class Future;
+
+struct ExecutorStats {
+    uint32_t executed;
+    /** Jobs a worker took from another worker's deque. */
+    uint32_t stolen;
+    /** Jobs run synchronously by submit() because the job pool or queues were full. */
+    uint32_t ran_inline;
+};
+
+/**
+ * @brief One pinned worker per core, each with a work-stealing deque.
+ *
+ * Jobs submitted from a worker go onto that worker's deque; jobs from any
+ * other task go through a per-worker lock-free injection ring and are moved
+ * into the deque by its owner. Idle workers steal from the other deques
+ * before sleeping on their task notification, so a burst submitted on one
+ * core spreads to both without creating a task per job.
+ *
+ * Jobs are callables of at most CONFIG_EXECUTOR_JOB_SIZE bytes including
+ * their result (checked at compile time) and are stored in a slab pool, so
+ * submit() never touches the heap. Jobs may submit and wait on other jobs;
+ * a worker that waits keeps executing queued jobs instead of blocking.
+ */
+class Executor {
+public:
+    struct Config {
+        /** Job blocks in the pool, i.e. jobs queued or with a live Future. */
+        size_t max_jobs = 64;
+        uint32_t stack_size = 4096;
+        UBaseType_t priority = 5;
+        /** Core to start no worker on, e.g. one given to rt_loop; -1 uses every core. */
+        int reserved_core = -1;
+    };
+
+    static constexpr size_t max_workers = portNUM_PROCESSORS;
+
+    Executor() = default;
+    ~Executor() { deinit(); }
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    /** Create the job pool and one worker pinned to each core except Config::reserved_core. */
+    esp_err_t init(const Config &config);
+
+    /** Stop the workers. Queued jobs that have not started are discarded. */
+    void deinit();
+
+    size_t worker_count() const { return worker_count_; }
+
+    /**
+     * @brief Queue @p fn and return a Future for its result.
+     *
+     * If no job block is free the job runs immediately on the caller and the
+     * returned Future is already complete, so submit() never fails.
+     */
+    template <typename F>
+    auto submit(F &&fn) -> Future<typename std::invoke_result<typename std::decay<F>::type &>::type>
+    {
+        using JobType = detail::JobFor<F>;
+        using R = typename std::invoke_result<typename std::decay<F>::type &>::type;
+        static_assert(sizeof(JobType) <= job_block_size && alignof(JobType) <= alignof(max_align_t),
+                      "job capture too large: raise CONFIG_EXECUTOR_JOB_SIZE or capture by pointer");
+        Job *job = make_job<JobType>(std::forward<F>(fn), 2);
+        if (job != nullptr) {
+            enqueue(job);
+            return Future<R>(job);
+        }
+        ran_inline_.fetch_add(1, std::memory_order_relaxed);
+        Future<R> ready;
+        if constexpr (std::is_void<R>::value) {
+            fn();
+            ready.set_ready();
+        } else {
+            ready.set_ready(fn());
+        }
+        return ready;
+    }
+
+    /** Queue @p fn without a Future; it is released as soon as it has run. */
+    template <typename F>
+    void post(F &&fn)
+    {
+        using JobType = detail::JobFor<F>;
+        static_assert(sizeof(JobType) <= job_block_size && alignof(JobType) <= alignof(max_align_t),
+                      "job capture too large: raise CONFIG_EXECUTOR_JOB_SIZE or capture by pointer");
+        Job *job = make_job<JobType>(std::forward<F>(fn), 1);
+        if (job == nullptr) {
+            ran_inline_.fetch_add(1, std::memory_order_relaxed);
+            fn();
+            return;
+        }
+        enqueue(job);
+    }
+
+    /**
+     * @brief Run @p fn(lo, hi) over [begin, end) in chunks of @p grain, in parallel.
+     *
+     * The caller takes part and returns once every chunk has finished. Chunks
+     * are claimed dynamically, so uneven chunk costs still balance across
+     * cores. @p fn must be safe to call concurrently on disjoint ranges.
+     */
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, size_t grain, F &&fn)
+    {
+        if (begin >= end) {
+            return;
+        }
+        if (grain == 0) {
+            grain = 1;
+        }
+        /* Wrap so plain functions and const callables erase the same way. */
+        auto call = [&fn](size_t lo, size_t hi) { fn(lo, hi); };
+        using Call = decltype(call);
+        ParallelFor loop;
+        loop.next.store(begin, std::memory_order_relaxed);
+        loop.end = end;
+        loop.grain = grain;
+        loop.body = [](void *ctx, size_t lo, size_t hi) { (*static_cast<Call *>(ctx))(lo, hi); };
+        loop.ctx = &call;
+        run_parallel_for(loop);
+    }
+
+    /** True if the calling task is one of this executor's workers. */
+    bool on_worker() const { return current_worker() >= 0; }
+
+    ExecutorStats stats() const;
+
+private:
+    template <typename T>
+    friend class Future;
+
+    struct ParallelFor {
+        std::atomic<size_t> next;
+        size_t end;
+        size_t grain;
+        void (*body)(void *ctx, size_t lo, size_t hi);
+        void *ctx;
+        std::atomic<uint32_t> helpers;
+        std::atomic<TaskHandle_t> waiter;
+    };
+
+    struct alignas(lf_ring::cache_line_size) Worker {
+        WorkDeque<Job *, CONFIG_EXECUTOR_DEQUE_CAPACITY> deque;
+        lf_ring::MpscRing<Job *, CONFIG_EXECUTOR_INJECT_CAPACITY> inject;
+        std::atomic<TaskHandle_t> task{nullptr};
+        std::atomic<bool> idle{false};
+        Executor *owner = nullptr;
+        int index = 0;
+    };
+
+    template <typename JobType, typename F>
+    Job *make_job(F &&fn, uint8_t refs)
+    {
+        void *mem = jobs_.allocate();
+        if (mem == nullptr) {
+            return nullptr;
+        }
+        auto *job = new (mem) JobType(typename std::decay<F>::type(std::forward<F>(fn)));
+        job->run = &JobType::run_impl;
+        job->destroy = &JobType::destroy_impl;
+        job->owner = this;
+        job->result = &job->result_storage;
+        job->refs.store(refs, std::memory_order_relaxed);
+        job->done.store(false, std::memory_order_relaxed);
+        job->waiter.store(nullptr, std::memory_order_relaxed);
+        return job;
+    }
+
+    void enqueue(Job *job);
+    void execute(Job *job);
+    void release(Job *job);
+    Job *find_work(Worker *self);
+    void wake_one_idle(const Worker *except);
+    int current_worker() const;
+    void wait_job(Job *job);
+    void run_parallel_for(ParallelFor &loop);
+    static bool run_chunks(ParallelFor &loop);
+    static void worker_main(void *arg);
+
+    mem_pool::SlabPool jobs_;
+    Worker workers_[max_workers];
+    size_t worker_count_ = 0;
+    std::atomic<uint32_t> next_inject_{0};
+    std::atomic<bool> stopping_{false};
+    std::atomic<uint32_t> running_workers_{0};
+
+    std::atomic<uint32_t> executed_{0};
+    std::atomic<uint32_t> stolen_{0};
+    std::atomic<uint32_t> ran_inline_{0};
+};
+
+/**
+ * @brief Result of Executor::submit().
+ *
+ * Movable, not copyable. get()/wait() block a plain task on its notification
+ * value; on a worker they run other queued jobs while waiting. Dropping an
+ * unfinished Future is fine: the job still runs and its block is freed
+ * afterwards.
+ */
+template <typename T>
+class Future {
+public:
+    Future() = default;
+    ~Future() { reset(); }
+
+    Future(Future &&other) { take(other); }
+    Future &operator=(Future &&other)
+    {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    Future(const Future &) = delete;
+    Future &operator=(const Future &) = delete;
+
+    bool valid() const { return job_ != nullptr || inline_ready_; }
+
+    bool ready() const { return inline_ready_ || (job_ != nullptr && job_->done.load(std::memory_order_acquire)); }
+
+    void wait()
+    {
+        if (job_ != nullptr && !ready()) {
+            job_->owner->wait_job(job_);
+        }
+    }
+
+    /** Wait, then return the result. For non-void T the value is moved out, so call once. */
+    T get()
+    {
+        wait();
+        if constexpr (!std::is_void<T>::value) {
+            T *slot = inline_ready_ ? inline_.get() : static_cast<T *>(job_->result);
+            return std::move(*slot);
+        }
+    }
+
+    void reset()
+    {
+        if (job_ != nullptr) {
+            job_->owner->release(job_);
+            job_ = nullptr;
+        }
+        if constexpr (!std::is_void<T>::value) {
+            if (inline_ready_) {
+                inline_.get()->~T();
+            }
+        }
+        inline_ready_ = false;
+    }
+
+private:
+    friend class Executor;
+
+    explicit Future(Job *job) : job_(job) {}
+
+    void set_ready() { inline_ready_ = true; }
+
+    template <typename V>
+    void set_ready(V &&value)
+    {
+        new (inline_.get()) T(std::forward<V>(value));
+        inline_ready_ = true;
+    }
+
+    void take(Future &other)
+    {
+        job_ = other.job_;
+        other.job_ = nullptr;
+        if constexpr (!std::is_void<T>::value) {
+            if (other.inline_ready_) {
+                new (inline_.get()) T(std::move(*other.inline_.get()));
+                other.inline_.get()->~T();
+            }
+        }
+        inline_ready_ = other.inline_ready_;
+        other.inline_ready_ = false;
+    }
+
+    Job *job_ = nullptr;
+    /* Holds the value when submit() had to run the job on the caller. */
+    detail::ResultSlot<T> inline_;
+    bool inline_ready_ = false;
+};
+
+} // namespace executor
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace executor {
+
+class Executor;
+
+/** Size of one job block: header, captured callable and result together. */
+constexpr size_t job_block_size = CONFIG_EXECUTOR_JOB_SIZE;
+
+/**
+ * @brief Type-erased job living in one fixed-size block of the job pool.
+ *
+ * The block is shared by the executor (until the job has run) and an
+ * optional Future (until it is dropped); the last of the two returns it to
+ * the pool.
+ */
+struct Job {
+    void (*run)(Job *job);
+    void (*destroy)(Job *job);
+    Executor *owner;
+    /** Result slot inside the block (unused for void jobs). */
+    void *result;
+    std::atomic<uint8_t> refs;
+    std::atomic<bool> done;
+    /** Task blocked in Future::wait(), notified on completion. */
+    std::atomic<TaskHandle_t> waiter;
+};
+
+namespace detail {
+
+template <typename R>
+struct ResultSlot {
+    R *get() { return reinterpret_cast<R *>(bytes); }
+
+    alignas(R) unsigned char bytes[sizeof(R)];
+};
+
+template <>
+struct ResultSlot<void> {};
+
+template <typename F, typename R>
+struct JobImpl : Job {
+    explicit JobImpl(F &&f) : fn(std::move(f)) {}
+
+    static void run_impl(Job *job)
+    {
+        auto *self = static_cast<JobImpl *>(job);
+        if constexpr (std::is_void<R>::value) {
+            self->fn();
+        } else {
+            new (self->result_storage.get()) R(self->fn());
+        }
+    }
+
+    static void destroy_impl(Job *job)
+    {
+        auto *self = static_cast<JobImpl *>(job);
+        if constexpr (!std::is_void<R>::value) {
+            if (self->done.load(std::memory_order_acquire)) {
+                self->result_storage.get()->~R();
+            }
+        }
+        self->~JobImpl();
+    }
+
+    F fn;
+    ResultSlot<R> result_storage;
+};
+
+template <typename F>
+using JobFor = JobImpl<typename std::decay<F>::type, typename std::invoke_result<typename std::decay<F>::type &>::type>;
+
+} // namespace detail
+
+} // namespace executor
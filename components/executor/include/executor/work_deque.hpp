@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "lf_ring/notifier.hpp"
+
+namespace executor {
+
+/**
+ * @brief Fixed-capacity Chase-Lev work-stealing deque.
+ *
+ * The owning worker pushes and pops at the bottom without contention; other
+ * workers steal from the top with one CAS. Orderings follow Lê et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP'13),
+ * using 32-bit indices so every operation is a native atomic on all targets.
+ *
+ * @tparam T pointer type stored in the deque.
+ * @tparam Capacity power of two.
+ */
+template <typename T, size_t Capacity>
+class WorkDeque {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /** Owner only. @return false when full. */
+    bool push(T item)
+    {
+        int32_t bottom = bottom_.load(std::memory_order_relaxed);
+        int32_t top = top_.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int32_t>(Capacity)) {
+            return false;
+        }
+        slots_[bottom & mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /** Owner only; LIFO, so the most recently pushed (cache-warm) job runs first. */
+    T pop()
+    {
+        int32_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int32_t top = top_.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T item = slots_[bottom & mask].load(std::memory_order_relaxed);
+        if (top == bottom) {
+            /* Last item: race thieves for it. */
+            if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /** Any thread; FIFO from the top. Returns nullptr if empty or the race was lost. */
+    T steal()
+    {
+        int32_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int32_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return nullptr;
+        }
+        T item = slots_[top & mask].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    /** Approximate; for idle checks only. */
+    bool empty() const
+    {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int32_t mask = Capacity - 1;
+
+    /* Thieves hammer top_; keep it off the owner's bottom_ line. */
+    alignas(lf_ring::cache_line_size) std::atomic<int32_t> top_{0};
+    alignas(lf_ring::cache_line_size) std::atomic<int32_t> bottom_{0};
+    std::atomic<T> slots_[Capacity] = {};
+};
+
+} // namespace executor
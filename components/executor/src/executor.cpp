@@ -0,0 +1,297 @@
+#include "executor/executor.hpp"
+
+#include <cstdio>
+
+#include "esp_log.h"
+
+static const char *TAG = "executor";
+
+namespace executor {
+
+esp_err_t Executor::init(const Config &config)
+{
+    if (worker_count_ != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.reserved_core >= 0 && max_workers == 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    mem_pool::SlabPool::Config pool_config;
+    pool_config.name = "executor_jobs";
+    pool_config.block_size = job_block_size;
+    pool_config.block_count = config.max_jobs;
+    esp_err_t err = jobs_.init(pool_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    stopping_.store(false, std::memory_order_relaxed);
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        if (core == config.reserved_core) {
+            continue;
+        }
+        size_t i = worker_count_;
+        Worker &w = workers_[i];
+        w.owner = this;
+        w.index = static_cast<int>(i);
+        w.idle.store(false, std::memory_order_relaxed);
+
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "exec%d", core);
+        TaskHandle_t task = nullptr;
+        if (xTaskCreatePinnedToCore(worker_main, name, config.stack_size, &w, config.priority, &task,
+                                    static_cast<BaseType_t>(core)) != pdPASS) {
+            ESP_LOGE(TAG, "failed to start worker %u", static_cast<unsigned>(i));
+            deinit();
+            return ESP_ERR_NO_MEM;
+        }
+        w.task.store(task, std::memory_order_release);
+        w.inject.notifier().attach(task);
+        running_workers_.fetch_add(1, std::memory_order_relaxed);
+        worker_count_ = i + 1;
+        /* The worker may have gone idle before its injection ring had a
+         * notifier; nudge it so nothing submitted in between is missed. */
+        xTaskNotifyGive(task);
+    }
+    return ESP_OK;
+}
+
+void Executor::deinit()
+{
+    if (worker_count_ != 0) {
+        stopping_.store(true, std::memory_order_release);
+        for (size_t i = 0; i < worker_count_; ++i) {
+            xTaskNotifyGive(workers_[i].task.load(std::memory_order_acquire));
+        }
+        while (running_workers_.load(std::memory_order_acquire) != 0) {
+            vTaskDelay(1);
+        }
+        for (size_t i = 0; i < worker_count_; ++i) {
+            Worker &w = workers_[i];
+            Job *job;
+            while ((job = w.deque.pop()) != nullptr || w.inject.pop(job)) {
+                release(job);
+            }
+            w.inject.notifier().detach();
+            w.task.store(nullptr, std::memory_order_relaxed);
+        }
+        worker_count_ = 0;
+    }
+    jobs_.deinit();
+}
+
+int Executor::current_worker() const
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (size_t i = 0; i < worker_count_; ++i) {
+        if (workers_[i].task.load(std::memory_order_relaxed) == self) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+void Executor::wake_one_idle(const Worker *except)
+{
+    /* Pairs with the store to idle in worker_main(): either the sleeper sees
+     * the new job when it re-checks, or we see it idle here. */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (size_t i = 0; i < worker_count_; ++i) {
+        Worker &w = workers_[i];
+        if (&w == except || !w.idle.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        if (w.idle.exchange(false, std::memory_order_acq_rel)) {
+            xTaskNotifyGive(w.task.load(std::memory_order_relaxed));
+            return;
+        }
+    }
+}
+
+void Executor::enqueue(Job *job)
+{
+    int self = current_worker();
+    if (self >= 0 && workers_[self].deque.push(job)) {
+        wake_one_idle(&workers_[self]);
+        return;
+    }
+
+    /* From outside the pool, prefer an idle worker, else spread round-robin.
+     * The ring wakes its worker itself on an empty-to-non-empty push. */
+    size_t start = next_inject_.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < worker_count_; ++i) {
+        if (workers_[i].idle.load(std::memory_order_relaxed)) {
+            start = i;
+            break;
+        }
+    }
+    for (size_t i = 0; i < worker_count_; ++i) {
+        if (workers_[(start + i) % worker_count_].inject.push(job)) {
+            return;
+        }
+    }
+    ran_inline_.fetch_add(1, std::memory_order_relaxed);
+    execute(job);
+}
+
+void Executor::execute(Job *job)
+{
+    job->run(job);
+    job->done.store(true, std::memory_order_seq_cst);
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    TaskHandle_t waiter = job->waiter.load(std::memory_order_seq_cst);
+    if (waiter != nullptr) {
+        xTaskNotifyGive(waiter);
+    }
+    release(job);
+}
+
+void Executor::release(Job *job)
+{
+    if (job->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        job->destroy(job);
+        jobs_.deallocate(job);
+    }
+}
+
+Job *Executor::find_work(Worker *self)
+{
+    Job *job = self->deque.pop();
+    if (job != nullptr) {
+        return job;
+    }
+
+    /* Move injected jobs into the deque so the other worker can steal them. */
+    Job *batch[8];
+    size_t n = self->inject.pop_n(batch, sizeof(batch) / sizeof(batch[0]));
+    if (n != 0) {
+        for (size_t i = 1; i < n; ++i) {
+            if (!self->deque.push(batch[i])) {
+                execute(batch[i]);
+            }
+        }
+        if (n > 1) {
+            wake_one_idle(self);
+        }
+        return batch[0];
+    }
+
+    for (size_t i = 1; i < worker_count_; ++i) {
+        Worker &victim = workers_[(self->index + i) % worker_count_];
+        job = victim.deque.steal();
+        if (job != nullptr) {
+            stolen_.fetch_add(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void Executor::wait_job(Job *job)
+{
+    job->waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_seq_cst);
+    int self = current_worker();
+    while (!job->done.load(std::memory_order_seq_cst)) {
+        if (self >= 0) {
+            Job *other = find_work(&workers_[self]);
+            if (other != nullptr) {
+                execute(other);
+                continue;
+            }
+            /* Nothing to help with: nap until the job completes or new work arrives. */
+            ulTaskNotifyTake(pdTRUE, 1);
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+bool Executor::run_chunks(ParallelFor &loop)
+{
+    bool ran = false;
+    for (;;) {
+        size_t lo = loop.next.fetch_add(loop.grain, std::memory_order_relaxed);
+        if (lo >= loop.end) {
+            return ran;
+        }
+        size_t hi = loop.end - lo < loop.grain ? loop.end : lo + loop.grain;
+        loop.body(loop.ctx, lo, hi);
+        ran = true;
+    }
+}
+
+void Executor::run_parallel_for(ParallelFor &loop)
+{
+    size_t chunks = (loop.end - loop.next.load(std::memory_order_relaxed) + loop.grain - 1) / loop.grain;
+    int self = current_worker();
+    /* A worker caller already occupies its core; a plain task gets every worker's help. */
+    size_t helpers = worker_count_ - (self >= 0 ? 1 : 0);
+    if (helpers > chunks - 1) {
+        helpers = chunks - 1;
+    }
+    loop.helpers.store(static_cast<uint32_t>(helpers), std::memory_order_relaxed);
+    loop.waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+
+    ParallelFor *shared = &loop;
+    for (size_t i = 0; i < helpers; ++i) {
+        post([shared] {
+            run_chunks(*shared);
+            /* Read the waiter first: once helpers reaches zero the caller may
+             * return and take `loop` off its stack. */
+            TaskHandle_t waiter = shared->waiter.load(std::memory_order_relaxed);
+            if (shared->helpers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                xTaskNotifyGive(waiter);
+            }
+        });
+    }
+
+    run_chunks(loop);
+
+    while (loop.helpers.load(std::memory_order_acquire) != 0) {
+        if (self >= 0) {
+            Job *other = find_work(&workers_[self]);
+            if (other != nullptr) {
+                execute(other);
+                continue;
+            }
+            ulTaskNotifyTake(pdTRUE, 1);
+        } else {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+void Executor::worker_main(void *arg)
+{
+    auto *self = static_cast<Worker *>(arg);
+    Executor *ex = self->owner;
+    self->task.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+
+    while (!ex->stopping_.load(std::memory_order_acquire)) {
+        Job *job = ex->find_work(self);
+        if (job == nullptr) {
+            self->idle.store(true, std::memory_order_seq_cst);
+            job = ex->find_work(self);
+            if (job == nullptr) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                self->idle.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            self->idle.store(false, std::memory_order_relaxed);
+        }
+        ex->execute(job);
+    }
+    ex->running_workers_.fetch_sub(1, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+ExecutorStats Executor::stats() const
+{
+    ExecutorStats s = {};
+    s.executed = executed_.load(std::memory_order_relaxed);
+    s.stolen = stolen_.load(std::memory_order_relaxed);
+    s.ran_inline = ran_inline_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace executor
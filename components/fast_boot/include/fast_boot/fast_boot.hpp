@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+namespace fast_boot {
+
+/**
+ * @brief A piece of the system that has to be initialized before use.
+ *
+ * Subsystems are defined as globals naming the subsystems they depend on:
+ *
+ *     fast_boot::Subsystem nvs{"nvs", init_nvs};
+ *     fast_boot::Subsystem netif{"netif", init_netif};
+ *     fast_boot::Subsystem wifi{"wifi", init_wifi, nullptr, nvs, netif};
+ *
+ * Nothing runs at boot. The first require() (or start()) of a subsystem
+ * schedules it together with whatever it depends on that has not been
+ * initialized; every subsystem whose dependencies are satisfied is run at
+ * once by an init worker on each core, so independent chains (NVS and the
+ * network stack above) come up in parallel. A wake that only reads a sensor
+ * and goes back to sleep never pays for Wi-Fi.
+ *
+ * An init function runs exactly once. If it fails, every subsystem that
+ * depends on it fails with ESP_ERR_INVALID_STATE without running, and
+ * require() keeps returning the error; there is no retry.
+ */
+class Subsystem {
+public:
+    using InitFn = esp_err_t (*)(void *ctx);
+
+    static constexpr size_t max_dependencies = 6;
+
+    template <typename... Deps>
+    Subsystem(const char *name, InitFn init, void *ctx = nullptr, Deps &...deps)
+        : name_(name), init_(init), ctx_(ctx), deps_{&deps...}, dep_count_(sizeof...(Deps))
+    {
+        static_assert(sizeof...(Deps) <= max_dependencies, "too many dependencies");
+        enlist();
+    }
+
+    Subsystem(const Subsystem &) = delete;
+    Subsystem &operator=(const Subsystem &) = delete;
+
+    /**
+     * @brief Initialize this subsystem and its dependencies if that has not happened, and wait.
+     *
+     * Returns at once when the subsystem is up. While waiting the caller
+     * runs queued init functions itself, so require() may also be called
+     * from inside an init function for a dependency that was not declared.
+     * Sleeps on the calling task's notification value.
+     * @return the init function's result, or ESP_ERR_INVALID_STATE if a
+     * dependency failed.
+     */
+    esp_err_t require();
+
+    /** Schedule initialization in the background and return; a later require() finds it done or in progress. */
+    void start();
+
+    /** Run the init function on the worker for @p core; the default lets any worker take it. */
+    void set_core(BaseType_t core) { core_ = core; }
+
+    bool ready() const;
+    const char *name() const { return name_; }
+
+private:
+    friend class Orchestrator;
+
+    enum class State : uint8_t {
+        Idle,
+        /* Scheduled, waiting for dependencies. */
+        Pending,
+        Queued,
+        Running,
+        Done,
+        Failed,
+    };
+
+    void enlist();
+
+    const char *name_;
+    InitFn init_;
+    void *ctx_;
+    Subsystem *deps_[max_dependencies > 0 ? max_dependencies : 1];
+    uint8_t dep_count_;
+    BaseType_t core_ = tskNO_AFFINITY;
+
+    /* Guarded by the orchestrator lock. */
+    State state_ = State::Idle;
+    esp_err_t result_ = ESP_OK;
+    Subsystem *next_ = nullptr;
+    Subsystem *next_queued_ = nullptr;
+    int64_t queued_us_ = 0;
+    int64_t start_us_ = 0;
+    int64_t end_us_ = 0;
+    int8_t ran_on_ = -1;
+};
+
+/** Record a named point in time (e.g. "app_main", "sensor read") for the timeline. */
+void mark(const char *name);
+
+/**
+ * @brief Print every subsystem that ran and every mark on the console.
+ *
+ * Times are microseconds since esp_timer started, early in startup, so
+ * the first mark in app_main shows what the ROM, bootloader and IDF startup
+ * cost. Lines are CSV framed by BOOT_BEGIN / BOOT_END:
+ *
+ *     BOOT,<name>,<core>,<queued_us>,<start_us>,<end_us>,<result>
+ *     BOOT,<mark>,-,,<us>,,
+ */
+void print_timeline();
+
+} // namespace fast_boot
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+#include "esp_netif.h"
+
+namespace fast_boot {
+
+/**
+ * @brief Wi-Fi PHY calibration data kept in RTC memory (CONFIG_FAST_BOOT_PHY_CAL_RTC).
+ *
+ * Transparent: the component wraps the call through which ESP-IDF hands
+ * calibration data to the PHY library, so nothing has to be called for it
+ * to work. After a full calibration the result is copied to RTC_NOINIT
+ * memory; on later boots that copy is passed in instead, with no
+ * calibration after a deep-sleep wake and a partial one after other resets
+ * (the same policy ESP-IDF applies to data it stores in NVS). A copy the
+ * PHY rejects is dropped and the chip is calibrated fully.
+ */
+class PhyCalCache {
+public:
+    /** The PHY was initialized from the RTC copy on this boot. */
+    static bool used();
+
+    /** Drop the copy, e.g. after moving the board to a different RF environment. */
+    static void forget();
+};
+
+/** What one association and DHCP exchange found out, for the next wake. */
+struct NetLease {
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip;
+    esp_ip4_addr_t dns[2];
+    /** Wall-clock time (time()) at which the lease was due for renewal. */
+    int64_t renew_at;
+};
+
+/**
+ * @brief DHCP lease and access point kept in RTC memory (CONFIG_FAST_BOOT_NET_CACHE).
+ *
+ * Joining a network costs a scan of every channel and a DHCP exchange,
+ * both of which return the same answer wake after wake. Typical use:
+ *
+ *     fast_boot::NetLease lease;
+ *     bool cached = fast_boot::NetCache::load(&lease);
+ *     if (cached) {
+ *         memcpy(sta.bssid, lease.bssid, 6);   // connect without scanning
+ *         sta.bssid_set = true;
+ *         sta.channel = lease.channel;
+ *         fast_boot::NetCache::apply(netif, lease);
+ *     }
+ *     ... esp_wifi_connect(); on IP_EVENT_STA_GOT_IP with !cached:
+ *     fast_boot::NetCache::capture(netif, ap.bssid, ap.primary);
+ *
+ * A lease is only reused until its renewal time (T1), measured with the
+ * system clock, which ESP-IDF keeps running through deep sleep. An applied
+ * lease is static: the DHCP client is stopped, so a node that stays awake
+ * towards T1 should restart it. Call forget() when association with the
+ * cached BSSID fails.
+ */
+class NetCache {
+public:
+    /** @return false if nothing is cached or the cached lease is due for renewal. */
+    static bool load(NetLease *out);
+
+    /** Save the lease @p netif just obtained from DHCP, with the access point it was obtained through. */
+    static esp_err_t capture(esp_netif_t *netif, const uint8_t bssid[6], uint8_t channel);
+
+    /** Stop the DHCP client on @p netif and configure the address and DNS servers from @p lease. */
+    static esp_err_t apply(esp_netif_t *netif, const NetLease &lease);
+
+    static void forget();
+};
+
+} // namespace fast_boot
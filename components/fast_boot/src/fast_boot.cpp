@@ -0,0 +1,343 @@
+#include "fast_boot/fast_boot.hpp"
+
+#include <cstdio>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace fast_boot {
+
+static const char *TAG = "fast_boot";
+
+namespace {
+
+constexpr size_t max_waiters = 8;
+constexpr size_t max_marks = 16;
+
+struct Mark {
+    const char *name;
+    int64_t us;
+};
+
+} // namespace
+
+/* All scheduling state lives here, behind one mutex. Init functions run
+ * with it released. */
+class Orchestrator {
+public:
+    static Subsystem *registered;
+
+    static void lock();
+    static void unlock() { xSemaphoreGive(mutex); }
+
+    static void schedule(Subsystem *s);
+    static Subsystem *pop(BaseType_t core);
+    static void run(Subsystem *s);
+    static void spawn_workers();
+    static void worker_main(void *arg);
+    static bool finished(const Subsystem *s)
+    {
+        return s->state_ == Subsystem::State::Done || s->state_ == Subsystem::State::Failed;
+    }
+    static void wait_for_change();
+    static void print_timeline();
+
+    static StaticSemaphore_t mutex_storage;
+    static SemaphoreHandle_t mutex;
+    static portMUX_TYPE mutex_init;
+
+    static Subsystem *queue_head;
+    static Subsystem *queue_tail;
+    static bool worker_running[portNUM_PROCESSORS];
+    static TaskHandle_t waiters[max_waiters];
+    static size_t waiter_count;
+
+private:
+    static void enqueue(Subsystem *s);
+    static void complete(Subsystem *s, esp_err_t result);
+    static void release_dependents();
+    static void wake_waiters();
+};
+
+Subsystem *Orchestrator::registered = nullptr;
+StaticSemaphore_t Orchestrator::mutex_storage;
+SemaphoreHandle_t Orchestrator::mutex = nullptr;
+portMUX_TYPE Orchestrator::mutex_init = portMUX_INITIALIZER_UNLOCKED;
+Subsystem *Orchestrator::queue_head = nullptr;
+Subsystem *Orchestrator::queue_tail = nullptr;
+bool Orchestrator::worker_running[portNUM_PROCESSORS];
+TaskHandle_t Orchestrator::waiters[max_waiters];
+size_t Orchestrator::waiter_count = 0;
+
+static Mark marks[max_marks];
+static size_t mark_count = 0;
+
+void Orchestrator::lock()
+{
+    taskENTER_CRITICAL(&mutex_init);
+    if (mutex == nullptr) {
+        mutex = xSemaphoreCreateMutexStatic(&mutex_storage);
+    }
+    taskEXIT_CRITICAL(&mutex_init);
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void Orchestrator::enqueue(Subsystem *s)
+{
+    s->state_ = Subsystem::State::Queued;
+    s->queued_us_ = esp_timer_get_time();
+    s->next_queued_ = nullptr;
+    if (queue_tail == nullptr) {
+        queue_head = s;
+    } else {
+        queue_tail->next_queued_ = s;
+    }
+    queue_tail = s;
+}
+
+void Orchestrator::schedule(Subsystem *s)
+{
+    if (s->state_ != Subsystem::State::Idle) {
+        return;
+    }
+    s->state_ = Subsystem::State::Pending;
+    for (size_t i = 0; i < s->dep_count_; ++i) {
+        schedule(s->deps_[i]);
+    }
+    /* Dependencies that were already done make s runnable right away. */
+    release_dependents();
+}
+
+Subsystem *Orchestrator::pop(BaseType_t core)
+{
+    Subsystem *prev = nullptr;
+    for (Subsystem *s = queue_head; s != nullptr; prev = s, s = s->next_queued_) {
+        if (s->core_ != tskNO_AFFINITY && s->core_ != core) {
+            continue;
+        }
+        if (prev == nullptr) {
+            queue_head = s->next_queued_;
+        } else {
+            prev->next_queued_ = s->next_queued_;
+        }
+        if (queue_tail == s) {
+            queue_tail = prev;
+        }
+        s->state_ = Subsystem::State::Running;
+        return s;
+    }
+    return nullptr;
+}
+
+void Orchestrator::release_dependents()
+{
+    /* Repeat until stable: failing one subsystem can fail the ones above it. */
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Subsystem *s = registered; s != nullptr; s = s->next_) {
+            if (s->state_ != Subsystem::State::Pending) {
+                continue;
+            }
+            bool ready = true;
+            bool failed = false;
+            for (size_t i = 0; i < s->dep_count_; ++i) {
+                Subsystem::State dep = s->deps_[i]->state_;
+                failed |= dep == Subsystem::State::Failed;
+                ready &= dep == Subsystem::State::Done;
+            }
+            if (failed) {
+                ESP_LOGW(TAG, "%s: not started, a dependency failed", s->name_);
+                s->state_ = Subsystem::State::Failed;
+                s->result_ = ESP_ERR_INVALID_STATE;
+                changed = true;
+            } else if (ready) {
+                enqueue(s);
+            }
+        }
+    }
+}
+
+void Orchestrator::complete(Subsystem *s, esp_err_t result)
+{
+    s->result_ = result;
+    s->state_ = result == ESP_OK ? Subsystem::State::Done : Subsystem::State::Failed;
+    if (result != ESP_OK) {
+        ESP_LOGE(TAG, "%s: init failed: %s", s->name_, esp_err_to_name(result));
+    }
+    release_dependents();
+}
+
+void Orchestrator::wake_waiters()
+{
+    for (size_t i = 0; i < waiter_count; ++i) {
+        xTaskNotifyGive(waiters[i]);
+    }
+    waiter_count = 0;
+}
+
+/* Called with the lock held; returns with it held. */
+void Orchestrator::run(Subsystem *s)
+{
+    unlock();
+    int64_t start = esp_timer_get_time();
+    esp_err_t result = s->init_ != nullptr ? s->init_(s->ctx_) : ESP_OK;
+    int64_t end = esp_timer_get_time();
+    lock();
+    s->start_us_ = start;
+    s->end_us_ = end;
+    s->ran_on_ = static_cast<int8_t>(xPortGetCoreID());
+    complete(s, result);
+    wake_waiters();
+    spawn_workers();
+}
+
+/* Called with the lock held. xTaskCreate under a mutex is fine; the workers
+ * block on it until the caller lets go. */
+void Orchestrator::spawn_workers()
+{
+    if (queue_head == nullptr) {
+        return;
+    }
+    for (BaseType_t core = 0; core < portNUM_PROCESSORS; ++core) {
+        if (worker_running[core]) {
+            continue;
+        }
+        char name[12];
+        snprintf(name, sizeof(name), "boot%d", static_cast<int>(core));
+        if (xTaskCreatePinnedToCore(worker_main, name, CONFIG_FAST_BOOT_WORKER_STACK_SIZE,
+                                    reinterpret_cast<void *>(core), CONFIG_FAST_BOOT_WORKER_PRIORITY, nullptr,
+                                    core) == pdPASS) {
+            worker_running[core] = true;
+        } else {
+            ESP_LOGW(TAG, "no memory for init worker on core %d", static_cast<int>(core));
+        }
+    }
+}
+
+/* Workers live only while there is work, so a boot that initializes
+ * nothing in the background has no extra tasks and no stacks allocated. */
+void Orchestrator::worker_main(void *arg)
+{
+    auto core = static_cast<BaseType_t>(reinterpret_cast<intptr_t>(arg));
+    lock();
+    Subsystem *s;
+    while ((s = pop(core)) != nullptr) {
+        run(s);
+    }
+    worker_running[core] = false;
+    unlock();
+    vTaskDelete(nullptr);
+}
+
+/* Called with the lock held; returns with it held, after something finished. */
+void Orchestrator::wait_for_change()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (waiter_count == max_waiters) {
+        /* Too many waiters to track; poll instead. */
+        unlock();
+        vTaskDelay(1);
+        lock();
+        return;
+    }
+    waiters[waiter_count++] = self;
+    unlock();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    lock();
+}
+
+void Subsystem::enlist()
+{
+    /* Subsystems are globals, constructed before app_main with one task running. */
+    next_ = Orchestrator::registered;
+    Orchestrator::registered = this;
+}
+
+bool Subsystem::ready() const
+{
+    Orchestrator::lock();
+    bool done = state_ == State::Done;
+    Orchestrator::unlock();
+    return done;
+}
+
+void Subsystem::start()
+{
+    Orchestrator::lock();
+    Orchestrator::schedule(this);
+    Orchestrator::spawn_workers();
+    Orchestrator::unlock();
+}
+
+esp_err_t Subsystem::require()
+{
+    Orchestrator::lock();
+    Orchestrator::schedule(this);
+    Orchestrator::spawn_workers();
+    BaseType_t core = xPortGetCoreID();
+    while (!Orchestrator::finished(this)) {
+        Subsystem *s = Orchestrator::pop(core);
+        if (s != nullptr) {
+            Orchestrator::run(s);
+        } else {
+            Orchestrator::wait_for_change();
+        }
+    }
+    esp_err_t result = result_;
+    Orchestrator::unlock();
+    return result;
+}
+
+void mark(const char *name)
+{
+    int64_t now = esp_timer_get_time();
+    Orchestrator::lock();
+    if (mark_count < max_marks) {
+        marks[mark_count++] = {name, now};
+    }
+    Orchestrator::unlock();
+}
+
+void Orchestrator::print_timeline()
+{
+    lock();
+    printf("BOOT_BEGIN now_us=%lld\n", static_cast<long long>(esp_timer_get_time()));
+    printf("BOOT,name,core,queued_us,start_us,end_us,result\n");
+    for (size_t i = 0; i < mark_count; ++i) {
+        printf("BOOT,%s,-,,%lld,,\n", marks[i].name, static_cast<long long>(marks[i].us));
+    }
+    /* Registration order is reversed; print in the order they started, ties by address. */
+    const Subsystem *prev = nullptr;
+    auto before = [](const Subsystem *a, const Subsystem *b) {
+        return a->start_us_ < b->start_us_ || (a->start_us_ == b->start_us_ && a < b);
+    };
+    for (;;) {
+        const Subsystem *next = nullptr;
+        for (const Subsystem *s = registered; s != nullptr; s = s->next_) {
+            if (s->ran_on_ >= 0 && (prev == nullptr || before(prev, s)) && (next == nullptr || before(s, next))) {
+                next = s;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+        printf("BOOT,%s,%d,%lld,%lld,%lld,%s\n", next->name_, next->ran_on_, static_cast<long long>(next->queued_us_),
+               static_cast<long long>(next->start_us_), static_cast<long long>(next->end_us_),
+               esp_err_to_name(next->result_));
+        prev = next;
+    }
+    printf("BOOT_END\n");
+    fflush(stdout);
+    unlock();
+}
+
+void print_timeline()
+{
+    Orchestrator::print_timeline();
+}
+
+} // namespace fast_boot
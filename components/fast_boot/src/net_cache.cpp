@@ -0,0 +1,142 @@
+#include "fast_boot/rtc_cache.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+
+#if CONFIG_FAST_BOOT_NET_CACHE
+
+#include "esp_netif_net_stack.h"
+#include "lwip/dhcp.h"
+
+namespace fast_boot {
+
+namespace {
+
+constexpr uint32_t slot_magic = 0x5453454c; /* "LEST" */
+
+struct NetSlot {
+    uint32_t magic;
+    /* Over lease. */
+    uint32_t crc;
+    NetLease lease;
+};
+
+RTC_NOINIT_ATTR NetSlot rtc_net;
+
+uint32_t crc_of(const NetSlot &s)
+{
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&s.lease), sizeof(s.lease));
+}
+
+} // namespace
+
+bool NetCache::load(NetLease *out)
+{
+    if (rtc_net.magic != slot_magic || rtc_net.crc != crc_of(rtc_net)) {
+        return false;
+    }
+    if (static_cast<int64_t>(time(nullptr)) >= rtc_net.lease.renew_at) {
+        rtc_net.magic = 0;
+        return false;
+    }
+    *out = rtc_net.lease;
+    return true;
+}
+
+esp_err_t NetCache::capture(esp_netif_t *netif, const uint8_t bssid[6], uint8_t channel)
+{
+    NetLease lease = {};
+    memcpy(lease.bssid, bssid, sizeof(lease.bssid));
+    lease.channel = channel;
+    esp_err_t err = esp_netif_get_ip_info(netif, &lease.ip);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (lease.ip.ip.addr == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_netif_dns_info_t dns;
+    if (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK) {
+        lease.dns[0] = dns.ip.u_addr.ip4;
+    }
+    if (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns) == ESP_OK) {
+        lease.dns[1] = dns.ip.u_addr.ip4;
+    }
+
+    /* T1 as granted by the server. A word read outside the tcpip thread;
+     * it is only written when the lease is (re)bound. */
+    auto *lwip_netif = static_cast<struct netif *>(esp_netif_get_netif_impl(netif));
+    const struct dhcp *dhcp = lwip_netif != nullptr ? netif_dhcp_data(lwip_netif) : nullptr;
+    if (dhcp == nullptr || dhcp->offered_t1_renew == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    lease.renew_at = static_cast<int64_t>(time(nullptr)) + dhcp->offered_t1_renew;
+
+    rtc_net.lease = lease;
+    rtc_net.crc = crc_of(rtc_net);
+    rtc_net.magic = slot_magic;
+    return ESP_OK;
+}
+
+esp_err_t NetCache::apply(esp_netif_t *netif, const NetLease &lease)
+{
+    esp_err_t err = esp_netif_dhcpc_stop(netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        return err;
+    }
+    err = esp_netif_set_ip_info(netif, &lease.ip);
+    if (err != ESP_OK) {
+        return err;
+    }
+    const esp_netif_dns_type_t types[] = {ESP_NETIF_DNS_MAIN, ESP_NETIF_DNS_BACKUP};
+    for (size_t i = 0; i < 2; ++i) {
+        if (lease.dns[i].addr == 0) {
+            continue;
+        }
+        esp_netif_dns_info_t dns = {};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4 = lease.dns[i];
+        err = esp_netif_set_dns_info(netif, types[i], &dns);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+void NetCache::forget()
+{
+    rtc_net.magic = 0;
+}
+
+} // namespace fast_boot
+
+#else // !CONFIG_FAST_BOOT_NET_CACHE
+
+namespace fast_boot {
+
+bool NetCache::load(NetLease *)
+{
+    return false;
+}
+
+esp_err_t NetCache::capture(esp_netif_t *, const uint8_t *, uint8_t)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t NetCache::apply(esp_netif_t *, const NetLease &)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void NetCache::forget() {}
+
+} // namespace fast_boot
+
+#endif
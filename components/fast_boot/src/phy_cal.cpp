@@ -0,0 +1,123 @@
+#include "fast_boot/rtc_cache.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "sdkconfig.h"
+
+#if CONFIG_FAST_BOOT_PHY_CAL_RTC
+
+#include "esp_mac.h"
+#include "esp_phy_init.h"
+
+/* Defined in the PHY library; phy_init.c calls it once per boot. */
+extern "C" int __real_register_chipv7_phy(const esp_phy_init_data_t *init_data, esp_phy_calibration_data_t *cal_data,
+                                          esp_phy_calibration_mode_t cal_mode);
+
+namespace fast_boot {
+
+static const char *TAG = "fast_boot";
+
+namespace {
+
+constexpr uint32_t slot_magic = 0x4c414350; /* "PCAL" */
+
+/* register_chipv7_phy() result when the supplied data fails its check. */
+constexpr int cal_data_check_fail = 1;
+
+struct PhySlot {
+    uint32_t magic;
+    /* Over data. */
+    uint32_t crc;
+    esp_phy_calibration_data_t data;
+};
+
+RTC_NOINIT_ATTR PhySlot rtc_phy;
+
+bool used_cache = false;
+
+uint32_t crc_of(const PhySlot &s)
+{
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&s.data), sizeof(s.data));
+}
+
+bool valid_for(const PhySlot &s, const uint8_t *mac)
+{
+    return s.magic == slot_magic && memcmp(s.data.mac, mac, sizeof(s.data.mac)) == 0 && s.crc == crc_of(s);
+}
+
+} // namespace
+
+bool PhyCalCache::used()
+{
+    return used_cache;
+}
+
+void PhyCalCache::forget()
+{
+    rtc_phy.magic = 0;
+}
+
+} // namespace fast_boot
+
+using fast_boot::rtc_phy;
+
+extern "C" int __wrap_register_chipv7_phy(const esp_phy_init_data_t *init_data, esp_phy_calibration_data_t *cal_data,
+                                          esp_phy_calibration_mode_t cal_mode)
+{
+    /* With ESP_PHY_CALIBRATION_AND_DATA_STORAGE off ESP-IDF passes no buffer
+     * and asks for a full calibration; supply one so the result can be kept. */
+    esp_phy_calibration_data_t *data = cal_data;
+    if (data == nullptr) {
+        data = static_cast<esp_phy_calibration_data_t *>(calloc(1, sizeof(*data)));
+        if (data == nullptr) {
+            return __real_register_chipv7_phy(init_data, nullptr, cal_mode);
+        }
+        esp_efuse_mac_get_default(data->mac);
+    }
+
+    bool cached = fast_boot::valid_for(rtc_phy, data->mac);
+    if (cached) {
+        memcpy(data, &rtc_phy.data, sizeof(*data));
+        cal_mode = esp_reset_reason() == ESP_RST_DEEPSLEEP ? PHY_RF_CAL_NONE : PHY_RF_CAL_PARTIAL;
+    }
+    int ret = __real_register_chipv7_phy(init_data, data, cal_mode);
+    if (cached && ret == fast_boot::cal_data_check_fail) {
+        ESP_LOGW(fast_boot::TAG, "cached PHY calibration rejected, calibrating fully");
+        rtc_phy.magic = 0;
+        cached = false;
+        cal_mode = PHY_RF_CAL_FULL;
+        ret = __real_register_chipv7_phy(init_data, data, cal_mode);
+    }
+    fast_boot::used_cache = cached;
+    if (ret == 0 && cal_mode != PHY_RF_CAL_NONE) {
+        memcpy(&rtc_phy.data, data, sizeof(*data));
+        rtc_phy.crc = fast_boot::crc_of(rtc_phy);
+        rtc_phy.magic = fast_boot::slot_magic;
+    }
+
+    if (data != cal_data) {
+        free(data);
+    }
+    return ret;
+}
+
+#else // !CONFIG_FAST_BOOT_PHY_CAL_RTC
+
+namespace fast_boot {
+
+bool PhyCalCache::used()
+{
+    return false;
+}
+
+void PhyCalCache::forget() {}
+
+} // namespace fast_boot
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+#include "fast_gpio/pin.hpp"
+#include "soc/soc_caps.h"
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+
+#include "driver/dedic_gpio.h"
+#include "hal/dedic_gpio_cpu_ll.h"
+
+namespace fast_gpio {
+
+/**
+ * @brief Output pins driven by the CPU's dedicated GPIO channels (S2, S3, C3 and later).
+ *
+ * A write is one core-local instruction instead of a peripheral bus store
+ * (ee.wr_mask_gpio_out / wr_mask_gpio_out on Xtensa, a CSR write on RISC-V).
+ * Every pin of the bundle changes on the same cycle. Bus traffic does not
+ * affect the latency, so a loop of writes and delay_cycles() running from IRAM
+ * keeps its exact timing.
+ *
+ * Pins are bound to output channels Channel, Channel + 1, ... (bit i of a
+ * value to the i-th pin). The driver hands out the lowest free channels, so
+ * Channel must be the number of channels taken by bundles set up earlier on
+ * that core; init() checks it and fails with ESP_ERR_INVALID_STATE
+ * otherwise. Channels belong to the core that called init(): write only from
+ * a task pinned to it.
+ *
+ *     using Bus = fast_gpio::DedicatedBundle<0, 4, 5, 6, 7>;
+ *     Bus bus;
+ *     bus.init();
+ *     Bus::write(0x5);
+ */
+template <int Channel, int... Nums>
+class DedicatedBundle {
+    static constexpr int width = sizeof...(Nums);
+
+    static_assert(width >= 1, "a bundle needs at least one pin");
+    static_assert(Channel >= 0 && Channel + width <= SOC_DEDIC_GPIO_OUT_CHANNELS_NUM,
+                  "not enough dedicated output channels on this target");
+    static_assert((detail::output_pin(Nums) && ...), "not a usable output GPIO on this target");
+
+public:
+    static constexpr int channel = Channel;
+    static constexpr uint32_t mask = ((1u << width) - 1) << Channel;
+
+    DedicatedBundle() = default;
+    ~DedicatedBundle() { deinit(); }
+
+    DedicatedBundle(const DedicatedBundle &) = delete;
+    DedicatedBundle &operator=(const DedicatedBundle &) = delete;
+
+    /** Configure the pins as outputs at @p value and route them to this core's channels. */
+    esp_err_t init(uint32_t value = 0)
+    {
+        if (bundle_ != nullptr) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        esp_err_t err = detail::configure(((1ULL << Nums) | ...), Mode::Output, Pull::None);
+        if (err != ESP_OK) {
+            return err;
+        }
+        static constexpr int pins[] = {Nums...};
+        dedic_gpio_bundle_config_t config = {};
+        config.gpio_array = pins;
+        config.array_size = width;
+        config.flags.out_en = 1;
+        err = dedic_gpio_new_bundle(&config, &bundle_);
+        if (err != ESP_OK) {
+            bundle_ = nullptr;
+            return err;
+        }
+        uint32_t offset = 0;
+        dedic_gpio_get_out_offset(bundle_, &offset);
+        if (offset != static_cast<uint32_t>(Channel)) {
+            deinit();
+            return ESP_ERR_INVALID_STATE;
+        }
+        write(value);
+        return ESP_OK;
+    }
+
+    void deinit()
+    {
+        if (bundle_ == nullptr) {
+            return;
+        }
+        dedic_gpio_del_bundle(bundle_);
+        bundle_ = nullptr;
+    }
+
+    /** Drive every pin of the bundle at once from the low bits of @p value. */
+    static FAST_GPIO_INLINE void write(uint32_t value) { dedic_gpio_cpu_ll_write_mask(mask, value << Channel); }
+
+    /** Change only the pins selected by @p bits; the others keep their level. */
+    static FAST_GPIO_INLINE void write(uint32_t bits, uint32_t value)
+    {
+        dedic_gpio_cpu_ll_write_mask((bits << Channel) & mask, value << Channel);
+    }
+
+    template <int I>
+    static FAST_GPIO_INLINE void set()
+    {
+        static_assert(I >= 0 && I < width, "pin index out of range");
+        dedic_gpio_cpu_ll_write_mask(1u << (Channel + I), ~0u);
+    }
+
+    template <int I>
+    static FAST_GPIO_INLINE void clear()
+    {
+        static_assert(I >= 0 && I < width, "pin index out of range");
+        dedic_gpio_cpu_ll_write_mask(1u << (Channel + I), 0);
+    }
+
+    /** The levels last written, bit i for the i-th pin. */
+    static FAST_GPIO_INLINE uint32_t written() { return (dedic_gpio_cpu_ll_read_out() & mask) >> Channel; }
+
+private:
+    dedic_gpio_bundle_handle_t bundle_ = nullptr;
+};
+
+} // namespace fast_gpio
+
+#endif // SOC_DEDICATED_GPIO_SUPPORTED
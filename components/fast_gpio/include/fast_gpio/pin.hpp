@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "soc/gpio_reg.h"
+#include "soc/soc_caps.h"
+
+/** Pin operations must inline into the (possibly IRAM) caller. */
+#define FAST_GPIO_INLINE __attribute__((always_inline)) inline
+
+namespace fast_gpio {
+
+enum class Mode {
+    Input,
+    Output,
+    /** Output that only pulls low; set() releases the line. The input stays enabled. */
+    OpenDrain,
+    InputOutput,
+};
+
+enum class Pull {
+    None,
+    Up,
+    Down,
+};
+
+namespace detail {
+
+/* Pins the module wires to the SPI flash and PSRAM buses. */
+constexpr uint64_t reserved_mask()
+{
+    uint64_t mask = 0;
+#if CONFIG_IDF_TARGET_ESP32
+    mask |= 0x3fULL << 6; /* GPIO6-11 */
+#if CONFIG_SPIRAM
+    mask |= 0x3ULL << 16; /* GPIO16-17, PSRAM CS and CLK */
+#endif
+#elif CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
+    mask |= 0x3fULL << 27; /* GPIO27-32 */
+#if CONFIG_SPIRAM
+    mask |= 1ULL << 26; /* PSRAM CS */
+#endif
+#if CONFIG_IDF_TARGET_ESP32S3 && (CONFIG_ESPTOOLPY_OCT_FLASH || CONFIG_SPIRAM_MODE_OCT)
+    mask |= 0x1fULL << 33; /* GPIO33-37, upper octal data lines */
+#endif
+#elif CONFIG_IDF_TARGET_ESP32C3
+    mask |= 0x3fULL << 12; /* GPIO12-17 */
+#endif
+    return mask;
+}
+
+constexpr bool valid_pin(int num)
+{
+    return num >= 0 && num < SOC_GPIO_PIN_COUNT && ((SOC_GPIO_VALID_GPIO_MASK >> num) & 1) != 0 &&
+           ((reserved_mask() >> num) & 1) == 0;
+}
+
+constexpr bool output_pin(int num)
+{
+    return valid_pin(num) && ((SOC_GPIO_VALID_OUTPUT_GPIO_MASK >> num) & 1) != 0;
+}
+
+constexpr bool drives(Mode mode)
+{
+    return mode != Mode::Input;
+}
+
+constexpr bool reads(Mode mode)
+{
+    return mode != Mode::Output;
+}
+
+constexpr gpio_mode_t driver_mode(Mode mode)
+{
+    switch (mode) {
+    case Mode::Input:
+        return GPIO_MODE_INPUT;
+    case Mode::Output:
+        return GPIO_MODE_OUTPUT;
+    case Mode::OpenDrain:
+        return GPIO_MODE_INPUT_OUTPUT_OD;
+    case Mode::InputOutput:
+        break;
+    }
+    return GPIO_MODE_INPUT_OUTPUT;
+}
+
+/* Register addresses of bank 0 (GPIO0-31) or bank 1 (GPIO32 and up). */
+#if SOC_GPIO_PIN_COUNT > 32
+constexpr uint32_t out_w1ts_reg(int bank) { return bank != 0 ? GPIO_OUT1_W1TS_REG : GPIO_OUT_W1TS_REG; }
+constexpr uint32_t out_w1tc_reg(int bank) { return bank != 0 ? GPIO_OUT1_W1TC_REG : GPIO_OUT_W1TC_REG; }
+constexpr uint32_t out_reg(int bank) { return bank != 0 ? GPIO_OUT1_REG : GPIO_OUT_REG; }
+constexpr uint32_t in_reg(int bank) { return bank != 0 ? GPIO_IN1_REG : GPIO_IN_REG; }
+#else
+constexpr uint32_t out_w1ts_reg(int) { return GPIO_OUT_W1TS_REG; }
+constexpr uint32_t out_w1tc_reg(int) { return GPIO_OUT_W1TC_REG; }
+constexpr uint32_t out_reg(int) { return GPIO_OUT_REG; }
+constexpr uint32_t in_reg(int) { return GPIO_IN_REG; }
+#endif
+
+FAST_GPIO_INLINE volatile uint32_t &reg(uint32_t address)
+{
+    return *reinterpret_cast<volatile uint32_t *>(address);
+}
+
+inline esp_err_t configure(uint64_t pins, Mode mode, Pull pull)
+{
+    gpio_config_t config = {};
+    config.pin_bit_mask = pins;
+    config.mode = driver_mode(mode);
+    config.pull_up_en = pull == Pull::Up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+    config.pull_down_en = pull == Pull::Down ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE;
+    config.intr_type = GPIO_INTR_DISABLE;
+    return gpio_config(&config);
+}
+
+} // namespace detail
+
+/**
+ * @brief One GPIO whose number and mode are fixed at compile time.
+ *
+ * gpio_set_level() checks its arguments and takes a spinlock on every call.
+ * Here each operation is a single store to the GPIO block's write-1-to-set or
+ * write-1-to-clear register (GPIO.out_w1ts / out_w1tc, or out1_* for GPIO32
+ * and up), with the address and bit mask folded into the instruction stream,
+ * so a toggle in a bit-banging loop costs the store and nothing else. Stores
+ * go over the peripheral bus, so consecutive edges are a few cycles apart on
+ * every target; DedicatedBundle is tighter where the core has dedicated GPIO.
+ *
+ * Pins that the target lacks, input-only pins driven as outputs, and pins the
+ * module wires to flash or PSRAM are rejected at compile time. All functions
+ * are static; init() is the only one that goes through the driver.
+ *
+ *     using Clock = fast_gpio::Pin<4, fast_gpio::Mode::Output>;
+ *     Clock::init();
+ *     Clock::set();
+ *     Clock::clear();
+ */
+template <int Num, Mode M, Pull P = Pull::None>
+class Pin {
+    static_assert(detail::valid_pin(Num), "not a usable GPIO on this target (or wired to flash/PSRAM)");
+    static_assert(!detail::drives(M) || !detail::valid_pin(Num) || detail::output_pin(Num),
+                  "this GPIO is input-only");
+
+public:
+    static constexpr int number = Num;
+    static constexpr Mode mode = M;
+    static constexpr int bank = Num / 32;
+    static constexpr uint32_t bit = 1u << (Num % 32);
+
+    /**
+     * @brief Configure the pin through the driver (IOMUX, direction, pulls).
+     *
+     * @p level is latched before the output is enabled, so the pin does not
+     * glitch to low first. Ignored for inputs.
+     */
+    static esp_err_t init(bool level = false)
+    {
+        if constexpr (detail::drives(M)) {
+            write(level);
+        }
+        return detail::configure(1ULL << Num, M, P);
+    }
+
+    static FAST_GPIO_INLINE void set()
+    {
+        static_assert(detail::drives(M), "set() on an input pin");
+        detail::reg(detail::out_w1ts_reg(bank)) = bit;
+    }
+
+    static FAST_GPIO_INLINE void clear()
+    {
+        static_assert(detail::drives(M), "clear() on an input pin");
+        detail::reg(detail::out_w1tc_reg(bank)) = bit;
+    }
+
+    static FAST_GPIO_INLINE void write(bool level)
+    {
+        if (level) {
+            set();
+        } else {
+            clear();
+        }
+    }
+
+    /** Read-then-set/clear; not atomic against another context writing the same pin. */
+    static FAST_GPIO_INLINE void toggle() { write((detail::reg(detail::out_reg(bank)) & bit) == 0); }
+
+    /** The level on the pad. */
+    static FAST_GPIO_INLINE bool read()
+    {
+        static_assert(detail::reads(M), "read() needs the input enabled (Input, OpenDrain or InputOutput)");
+        return (detail::reg(detail::in_reg(bank)) & bit) != 0;
+    }
+};
+
+/**
+ * @brief Several output pins of one bank, written with one set and one clear store.
+ *
+ * Bit i of the value passed to write() drives the i-th pin of the list. The
+ * pins that go high change one store before the ones that go low; use a
+ * DedicatedBundle when every edge has to land on the same cycle.
+ */
+template <int... Nums>
+class PinGroup {
+    static_assert(sizeof...(Nums) >= 1 && sizeof...(Nums) <= 32, "1 to 32 pins");
+    static_assert((detail::output_pin(Nums) && ...), "not a usable output GPIO on this target");
+
+    static constexpr int first_bank()
+    {
+        constexpr int nums[] = {Nums...};
+        return nums[0] / 32;
+    }
+
+public:
+    static constexpr int bank = first_bank();
+    static constexpr uint32_t mask = ((1u << (Nums % 32)) | ...);
+
+    static_assert(((Nums / 32 == bank) && ...), "all pins of a group must be in the same 32-pin bank");
+
+    static esp_err_t init(Mode mode = Mode::Output, uint32_t value = 0)
+    {
+        write(value);
+        return detail::configure(((1ULL << Nums) | ...), mode, Pull::None);
+    }
+
+    static FAST_GPIO_INLINE void write(uint32_t value)
+    {
+        uint32_t high = spread(value);
+        detail::reg(detail::out_w1ts_reg(bank)) = high;
+        detail::reg(detail::out_w1tc_reg(bank)) = mask & ~high;
+    }
+
+    static FAST_GPIO_INLINE void set_all() { detail::reg(detail::out_w1ts_reg(bank)) = mask; }
+    static FAST_GPIO_INLINE void clear_all() { detail::reg(detail::out_w1tc_reg(bank)) = mask; }
+
+private:
+    /* Bit i of value to the bit of the i-th pin; folds to shifts and masks. */
+    static FAST_GPIO_INLINE uint32_t spread(uint32_t value)
+    {
+        uint32_t out = 0;
+        int i = 0;
+        ((out |= ((value >> i++) & 1u) << (Nums % 32)), ...);
+        return out;
+    }
+};
+
+/**
+ * @brief Exactly @p N NOPs, for padding the timing between edges.
+ *
+ * One cycle each on the Xtensa and RISC-V cores when the code runs from IRAM
+ * or a cache hit; use esp_rom_delay_us() for anything longer than a few
+ * hundred cycles.
+ */
+template <unsigned N>
+FAST_GPIO_INLINE void delay_cycles()
+{
+    static_assert(N <= 1024, "use esp_rom_delay_us() for long delays");
+    if constexpr (N > 0) {
+        asm volatile(".rept %c0\n\tnop\n\t.endr" : : "i"(N));
+    }
+}
+
+} // namespace fast_gpio
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace http_server {
+
+enum class Method : uint8_t {
+    Get,
+    Head,
+    Post,
+    Put,
+    Delete,
+    Options,
+    Patch,
+    Unknown,
+};
+
+/**
+ * @brief One parsed request, as views into the connection's receive buffer.
+ *
+ * Only valid for the duration of the handler call; copy anything that has to
+ * outlive it.
+ */
+class Request {
+public:
+    Method method() const { return method_; }
+
+    /** Target without the query string, still percent-encoded. */
+    std::string_view path() const { return path_; }
+
+    /** Text after '?', empty if there was none. */
+    std::string_view query() const { return query_; }
+
+    /** Value of the first header named @p name (case-insensitive), trimmed; empty if absent. */
+    std::string_view header(std::string_view name) const;
+
+    std::span<const uint8_t> body() const { return body_; }
+
+    /** Whether the connection stays open after the response (HTTP/1.1 default). */
+    bool keep_alive() const { return keep_alive_; }
+
+private:
+    friend class RequestParser;
+
+    Method method_ = Method::Unknown;
+    std::string_view path_;
+    std::string_view query_;
+    /* Header lines, each terminated by CRLF, without the request line. */
+    std::string_view headers_;
+    std::span<const uint8_t> body_;
+    bool keep_alive_ = true;
+};
+
+/** Case-insensitive ASCII comparison, as header names and tokens require. */
+bool equals_ignore_case(std::string_view a, std::string_view b);
+
+/** True if the comma-separated header value @p list contains @p token. */
+bool has_token(std::string_view list, std::string_view token);
+
+} // namespace http_server
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace http_server {
+
+/**
+ * @brief Pull source for a chunked response body.
+ *
+ * Called from the server task whenever the socket can take more data; fill
+ * up to @p capacity bytes of @p buf and return the count, or 0 to end the
+ * stream. Must not block: it runs on the event loop every connection shares.
+ */
+using BodySource = size_t (*)(void *ctx, uint8_t *buf, size_t capacity);
+
+/**
+ * @brief Response being built by a handler.
+ *
+ * Headers are formatted straight into the connection's transmit area; the
+ * body is never copied. send() keeps only a pointer, so the body must stay
+ * valid until the response has gone out - string literals, caller-owned
+ * static buffers and asset_store views all qualify. Handlers finish the
+ * response with exactly one of send(), stream() or send_error().
+ */
+class Response {
+public:
+    /** Extra header, emitted after the ones the server adds. @return false if the header area is full. */
+    bool add_header(std::string_view name, std::string_view value);
+
+    void send(uint16_t status, std::string_view content_type, std::span<const uint8_t> body);
+
+    void send(uint16_t status, std::string_view content_type, std::string_view body)
+    {
+        send(status, content_type, {reinterpret_cast<const uint8_t *>(body.data()), body.size()});
+    }
+
+    /** Headers only, e.g. 204 or 304. */
+    void send(uint16_t status) { send(status, {}, std::span<const uint8_t>{}); }
+
+    /** Chunked body produced by @p source; @p ctx must outlive the response. */
+    void stream(uint16_t status, std::string_view content_type, BodySource source, void *ctx);
+
+    /** Short plain-text body naming the status. */
+    void send_error(uint16_t status);
+
+    bool finished() const { return finished_; }
+
+private:
+    friend class Server;
+
+    Response(char *head, size_t capacity, bool head_only, bool keep_alive)
+        : head_(head), capacity_(capacity), head_only_(head_only), keep_alive_(keep_alive)
+    {
+    }
+
+    bool begin(uint16_t status, std::string_view content_type, const char *length_header, size_t length);
+
+    char *head_;
+    size_t capacity_;
+    size_t length_ = 0;
+    std::span<const uint8_t> body_;
+    BodySource source_ = nullptr;
+    void *source_ctx_ = nullptr;
+    bool head_only_;
+    bool keep_alive_;
+    bool finished_ = false;
+    bool overflow_ = false;
+};
+
+/** Reason phrase for @p status ("Unknown" for codes the server does not use). */
+const char *status_text(uint16_t status);
+
+} // namespace http_server
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "http_server/request.hpp"
+#include "http_server/response.hpp"
+#include "mem_pool/slab_pool.hpp"
+
+namespace asset_store {
+class Bundle;
+}
+
+namespace http_server {
+
+/** Called on the server task; must not block (see Response for body lifetime). */
+using Handler = void (*)(const Request &req, Response &res, void *ctx);
+
+struct ServerStats {
+    uint32_t accepted;
+    /** Idle keep-alive connections closed to make room for a new one. */
+    uint32_t evicted;
+    /** New connections refused because every slot was busy. */
+    uint32_t rejected;
+    uint32_t requests;
+    /** Requests answered with 4xx/5xx by the server itself (parse errors, 404, 405). */
+    uint32_t errors;
+    uint32_t active;
+};
+
+/**
+ * @brief HTTP/1.1 server on non-blocking lwIP sockets and one select() loop.
+ *
+ * All connections are multiplexed by a single task, so a slow client only
+ * costs a socket and a connection slot, never a thread. Connections are
+ * persistent (keep-alive) and pipelined requests are answered in order from
+ * the same receive buffer. I/O buffers come from a slab pool and a
+ * connection only holds one while it has a request in flight, so dozens of
+ * idle keep-alive clients (polling dashboards) cost a few dozen bytes each.
+ * If every slot is taken, the longest-idle keep-alive connection is closed to
+ * admit a new one.
+ *
+ * Responses are written with one writev() of the formatted headers plus the
+ * caller's body pointer: static files from the asset bundle go from the flash
+ * mapping into lwIP's send buffer without an intermediate copy. Large or
+ * generated bodies can be streamed with chunked transfer encoding.
+ *
+ * Limits: request bodies must fit the receive buffer (413 otherwise) and
+ * chunked request bodies are not accepted (411). Concurrent connections are
+ * capped by CONFIG_LWIP_MAX_SOCKETS, minus the sockets the rest of the
+ * firmware uses.
+ */
+class Server {
+public:
+    struct Config {
+        uint16_t port = 80;
+        size_t max_connections = 56;
+        /** I/O buffers; connections beyond this wait in their socket until one is free. */
+        size_t buffer_count = 12;
+        /** Largest request (headers and body) accepted. */
+        size_t rx_buffer_size = 1536;
+        /** Response headers, and the chunk size for streamed bodies. */
+        size_t tx_buffer_size = 1024;
+        /** Keep-alive connections with no traffic for this long are closed. */
+        uint32_t idle_timeout_ms = 30000;
+        uint32_t task_stack_size = 4096;
+        UBaseType_t task_priority = 5;
+        BaseType_t task_core = tskNO_AFFINITY;
+    };
+
+    static constexpr size_t max_routes = 16;
+
+    Server() = default;
+    ~Server() { stop(); }
+
+    Server(const Server &) = delete;
+    Server &operator=(const Server &) = delete;
+
+    /**
+     * @brief Register @p handler for @p method on @p path.
+     *
+     * A path ending in '*' matches every path with that prefix. Routes are
+     * tried in registration order. Must be called before start().
+     * @return ESP_ERR_NO_MEM if max_routes are already registered.
+     */
+    esp_err_t add_route(Method method, const char *path, Handler handler, void *ctx = nullptr);
+
+    /**
+     * @brief Serve GET/HEAD requests no route matched from @p bundle.
+     *
+     * "/<prefix>/a/b.css" maps to asset "a/b.css"; directory paths get
+     * "index.html" appended. A "<name>.gz" asset is preferred for clients
+     * that accept gzip. Responses carry the asset CRC as ETag, so revalidation
+     * with If-None-Match is answered 304.
+     */
+    void serve_assets(const asset_store::Bundle &bundle, const char *prefix = "/",
+                      const char *cache_control = "no-cache");
+
+    esp_err_t start(const Config &config);
+
+    /** Close every connection and stop the task; returns within one loop tick. */
+    void stop();
+
+    ServerStats stats() const;
+
+private:
+    enum class State : uint8_t {
+        Free,
+        Idle,
+        Writing,
+        /* Response sent on a closing connection: write side shut down, input
+         * discarded until the peer closes, so unread request bytes cannot turn
+         * the close into a reset that discards the response. */
+        Draining,
+    };
+
+    struct Route {
+        const char *path;
+        size_t length;
+        bool prefix;
+        Method method;
+        Handler handler;
+        void *ctx;
+    };
+
+    struct Connection {
+        int fd = -1;
+        State state = State::Free;
+        bool keep_alive = true;
+        bool streaming = false;
+        /* Waiting for a buffer; not polled for reads until one is released. */
+        bool starved = false;
+        /* rx area first, tx area after it; from buffers_. */
+        uint8_t *buffer = nullptr;
+        size_t rx_length = 0;
+        /* Bytes of rx the request being answered occupies. */
+        size_t request_length = 0;
+        /* Unsent headers (or chunk framing) in the tx area. */
+        const uint8_t *head = nullptr;
+        size_t head_length = 0;
+        const uint8_t *body = nullptr;
+        size_t body_length = 0;
+        BodySource source = nullptr;
+        void *source_ctx = nullptr;
+        int64_t last_active_us = 0;
+    };
+
+    static void server_task(void *arg);
+    void run();
+    void accept_connections();
+    Connection *claim_slot();
+    void close_connection(Connection &c);
+    void release_buffer(Connection &c);
+    void on_readable(Connection &c);
+    void on_writable(Connection &c);
+    void drain(Connection &c);
+    void process(Connection &c);
+    void dispatch(const Request &req, Response &res);
+    bool serve_asset(const Request &req, Response &res);
+    void next_chunk(Connection &c);
+    void finish_response(Connection &c);
+    uint8_t *tx_area(const Connection &c) const { return c.buffer + config_.rx_buffer_size; }
+
+    Config config_;
+    Route routes_[max_routes];
+    size_t route_count_ = 0;
+    const asset_store::Bundle *assets_ = nullptr;
+    const char *asset_prefix_ = "/";
+    const char *asset_cache_control_ = nullptr;
+
+    Connection *connections_ = nullptr;
+    mem_pool::SlabPool buffers_;
+    int listen_fd_ = -1;
+    TaskHandle_t task_ = nullptr;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+
+    std::atomic<uint32_t> accepted_{0};
+    std::atomic<uint32_t> evicted_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> requests_{0};
+    std::atomic<uint32_t> errors_{0};
+    std::atomic<uint32_t> active_{0};
+};
+
+} // namespace http_server
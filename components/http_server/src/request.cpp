@@ -0,0 +1,205 @@
+#include <cstring>
+
+#include "request_parser.hpp"
+
+namespace http_server {
+
+namespace {
+
+char to_lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+/** Split off the line up to CRLF; @p rest starts after it. */
+std::string_view next_line(std::string_view &rest)
+{
+    size_t end = rest.find("\r\n");
+    std::string_view line = rest.substr(0, end);
+    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 2);
+    return line;
+}
+
+bool split_header(std::string_view line, std::string_view *name, std::string_view *value)
+{
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return false;
+    }
+    *name = line.substr(0, colon);
+    *value = trim(line.substr(colon + 1));
+    return true;
+}
+
+Method parse_method(std::string_view m)
+{
+    struct Entry {
+        const char *name;
+        Method method;
+    };
+    static const Entry methods[] = {
+        {"GET", Method::Get},         {"HEAD", Method::Head},       {"POST", Method::Post},
+        {"PUT", Method::Put},         {"DELETE", Method::Delete},   {"OPTIONS", Method::Options},
+        {"PATCH", Method::Patch},
+    };
+    for (const Entry &e : methods) {
+        if (m == e.name) {
+            return e.method;
+        }
+    }
+    return Method::Unknown;
+}
+
+bool parse_length(std::string_view s, size_t *out)
+{
+    if (s.empty() || s.size() > 9) {
+        return false;
+    }
+    size_t v = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        v = v * 10 + static_cast<size_t>(c - '0');
+    }
+    *out = v;
+    return true;
+}
+
+} // namespace
+
+bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (to_lower(a[i]) != to_lower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool has_token(std::string_view list, std::string_view token)
+{
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = trim(list.substr(0, comma));
+        /* Ignore parameters such as ";q=0.8". */
+        item = trim(item.substr(0, item.find(';')));
+        if (equals_ignore_case(item, token)) {
+            return true;
+        }
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+    return false;
+}
+
+std::string_view Request::header(std::string_view name) const
+{
+    std::string_view rest = headers_;
+    while (!rest.empty()) {
+        std::string_view key;
+        std::string_view value;
+        if (split_header(next_line(rest), &key, &value) && equals_ignore_case(key, name)) {
+            return value;
+        }
+    }
+    return {};
+}
+
+ParseStatus RequestParser::parse(const uint8_t *data, size_t length, size_t capacity, Request &req, size_t *consumed)
+{
+    std::string_view text(reinterpret_cast<const char *>(data), length);
+    /* Tolerate the stray CRLF some clients send after a POST body. */
+    size_t skipped = 0;
+    while (text.substr(skipped, 2) == "\r\n") {
+        skipped += 2;
+    }
+    size_t end = text.find("\r\n\r\n", skipped);
+    if (end == std::string_view::npos) {
+        return length >= capacity ? ParseStatus::HeadersTooLarge : ParseStatus::Incomplete;
+    }
+    const size_t header_end = end + 4;
+    std::string_view rest = text.substr(skipped, header_end - 2 - skipped);
+
+    std::string_view line = next_line(rest);
+    size_t sp1 = line.find(' ');
+    size_t sp2 = line.rfind(' ');
+    if (sp1 == std::string_view::npos || sp2 == sp1) {
+        return ParseStatus::BadRequest;
+    }
+    std::string_view target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = line.substr(sp2 + 1);
+    if (target.empty() || (version != "HTTP/1.1" && version != "HTTP/1.0")) {
+        return ParseStatus::BadRequest;
+    }
+
+    req = Request();
+    req.method_ = parse_method(line.substr(0, sp1));
+    size_t question = target.find('?');
+    req.path_ = target.substr(0, question);
+    req.query_ = question == std::string_view::npos ? std::string_view() : target.substr(question + 1);
+    req.headers_ = rest;
+    req.keep_alive_ = version == "HTTP/1.1";
+
+    size_t content_length = 0;
+    while (!rest.empty()) {
+        std::string_view name;
+        std::string_view value;
+        if (!split_header(next_line(rest), &name, &value)) {
+            return ParseStatus::BadRequest;
+        }
+        if (equals_ignore_case(name, "Content-Length")) {
+            if (!parse_length(value, &content_length)) {
+                return ParseStatus::BadRequest;
+            }
+        } else if (equals_ignore_case(name, "Transfer-Encoding")) {
+            return ParseStatus::LengthRequired;
+        } else if (equals_ignore_case(name, "Connection")) {
+            if (has_token(value, "close")) {
+                req.keep_alive_ = false;
+            } else if (has_token(value, "keep-alive")) {
+                req.keep_alive_ = true;
+            }
+        }
+    }
+
+    if (content_length > capacity - header_end) {
+        return ParseStatus::BodyTooLarge;
+    }
+    if (length < header_end + content_length) {
+        return ParseStatus::Incomplete;
+    }
+    req.body_ = {data + header_end, content_length};
+    *consumed = header_end + content_length;
+    return ParseStatus::Complete;
+}
+
+uint16_t RequestParser::status_for(ParseStatus status)
+{
+    switch (status) {
+    case ParseStatus::HeadersTooLarge:
+        return 431;
+    case ParseStatus::BodyTooLarge:
+        return 413;
+    case ParseStatus::LengthRequired:
+        return 411;
+    default:
+        return 400;
+    }
+}
+
+} // namespace http_server
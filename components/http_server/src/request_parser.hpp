@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "http_server/request.hpp"
+
+namespace http_server {
+
+enum class ParseStatus : uint8_t {
+    Incomplete,
+    Complete,
+    BadRequest,
+    /** Headers do not fit the receive buffer (431). */
+    HeadersTooLarge,
+    /** Content-Length beyond the receive buffer (413). */
+    BodyTooLarge,
+    /** Transfer-Encoding on a request (411). */
+    LengthRequired,
+};
+
+class RequestParser {
+public:
+    /**
+     * @brief Parse the request at the start of @p data.
+     *
+     * Stateless: called again with more bytes after Incomplete. On Complete,
+     * @p consumed is the request's length including its body; any bytes after
+     * it belong to the next pipelined request.
+     */
+    static ParseStatus parse(const uint8_t *data, size_t length, size_t capacity, Request &req, size_t *consumed);
+
+    static uint16_t status_for(ParseStatus status);
+};
+
+} // namespace http_server
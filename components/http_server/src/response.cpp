@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstring>
+
+#include "http_server/response.hpp"
+
+namespace http_server {
+
+namespace {
+
+/* Status line and the headers the server adds itself. */
+constexpr size_t fixed_header_max = 192;
+
+bool has_body(uint16_t status)
+{
+    return status >= 200 && status != 204 && status != 304;
+}
+
+} // namespace
+
+const char *status_text(uint16_t status)
+{
+    switch (status) {
+    case 200:
+        return "OK";
+    case 201:
+        return "Created";
+    case 204:
+        return "No Content";
+    case 301:
+        return "Moved Permanently";
+    case 302:
+        return "Found";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 401:
+        return "Unauthorized";
+    case 403:
+        return "Forbidden";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 411:
+        return "Length Required";
+    case 413:
+        return "Payload Too Large";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 500:
+        return "Internal Server Error";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "Unknown";
+    }
+}
+
+bool Response::add_header(std::string_view name, std::string_view value)
+{
+    size_t needed = name.size() + 2 + value.size() + 2;
+    /* Keep room for begin() to put the fixed headers and final CRLF in front. */
+    if (finished_ || length_ + needed + fixed_header_max + 2 > capacity_) {
+        overflow_ = true;
+        return false;
+    }
+    char *p = head_ + length_;
+    memcpy(p, name.data(), name.size());
+    p += name.size();
+    memcpy(p, ": ", 2);
+    p += 2;
+    memcpy(p, value.data(), value.size());
+    p += value.size();
+    memcpy(p, "\r\n", 2);
+    length_ += needed;
+    return true;
+}
+
+bool Response::begin(uint16_t status, std::string_view content_type, const char *length_header, size_t length)
+{
+    if (finished_) {
+        return false;
+    }
+    char fixed[fixed_header_max];
+    int n = snprintf(fixed, sizeof(fixed), "HTTP/1.1 %u %s\r\n", status, status_text(status));
+    if (!content_type.empty() && content_type.size() < 64) {
+        n += snprintf(fixed + n, sizeof(fixed) - n, "Content-Type: %.*s\r\n", static_cast<int>(content_type.size()),
+                      content_type.data());
+    }
+    if (length_header != nullptr) {
+        n += snprintf(fixed + n, sizeof(fixed) - n, length_header, static_cast<unsigned long>(length));
+    }
+    if (!keep_alive_) {
+        n += snprintf(fixed + n, sizeof(fixed) - n, "Connection: close\r\n");
+    }
+    /* Extra headers were written from the start of the area; slide them
+     * behind the fixed block. add_header() guaranteed the room. */
+    memmove(head_ + n, head_, length_);
+    memcpy(head_, fixed, n);
+    length_ += n;
+    memcpy(head_ + length_, "\r\n", 2);
+    length_ += 2;
+    finished_ = true;
+    return true;
+}
+
+void Response::send(uint16_t status, std::string_view content_type, std::span<const uint8_t> body)
+{
+    const bool body_allowed = has_body(status);
+    if (!begin(status, content_type, body_allowed ? "Content-Length: %lu\r\n" : nullptr, body.size())) {
+        return;
+    }
+    if (body_allowed && !head_only_) {
+        body_ = body;
+    }
+}
+
+void Response::stream(uint16_t status, std::string_view content_type, BodySource source, void *ctx)
+{
+    if (!begin(status, content_type, "Transfer-Encoding: chunked\r\n", 0)) {
+        return;
+    }
+    if (!head_only_) {
+        source_ = source;
+        source_ctx_ = ctx;
+    }
+}
+
+void Response::send_error(uint16_t status)
+{
+    /* Drop whatever headers the handler had added. */
+    length_ = 0;
+    send(status, "text/plain", status_text(status));
+}
+
+} // namespace http_server
@@ -0,0 +1,602 @@
+#include "http_server/server.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "asset_store/asset_store.hpp"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "request_parser.hpp"
+
+static const char *TAG = "http_server";
+
+namespace http_server {
+
+namespace {
+
+/* select() timeout: bounds stop() latency and the idle sweep granularity. */
+constexpr uint32_t loop_tick_ms = 250;
+constexpr int listen_backlog = 8;
+/* Longest a closing connection waits for the peer's FIN. */
+constexpr int64_t drain_timeout_us = 2000000;
+/* Room in front of each streamed chunk for its "<hex>\r\n" size line. */
+constexpr size_t chunk_prefix = 8;
+
+struct MimeType {
+    const char *extension;
+    const char *type;
+};
+
+const MimeType mime_types[] = {
+    {"html", "text/html"},
+    {"htm", "text/html"},
+    {"css", "text/css"},
+    {"js", "application/javascript"},
+    {"json", "application/json"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"ico", "image/x-icon"},
+    {"wasm", "application/wasm"},
+    {"woff2", "font/woff2"},
+    {"txt", "text/plain"},
+    {"pem", "application/x-pem-file"},
+};
+
+const char *content_type_for(std::string_view name)
+{
+    size_t dot = name.rfind('.');
+    if (dot != std::string_view::npos) {
+        std::string_view ext = name.substr(dot + 1);
+        for (const MimeType &m : mime_types) {
+            if (equals_ignore_case(ext, m.extension)) {
+                return m.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+bool would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void set_non_blocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+} // namespace
+
+esp_err_t Server::add_route(Method method, const char *path, Handler handler, void *ctx)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (route_count_ == max_routes) {
+        return ESP_ERR_NO_MEM;
+    }
+    Route &r = routes_[route_count_++];
+    r.path = path;
+    r.length = strlen(path);
+    r.prefix = r.length != 0 && path[r.length - 1] == '*';
+    if (r.prefix) {
+        --r.length;
+    }
+    r.method = method;
+    r.handler = handler;
+    r.ctx = ctx;
+    return ESP_OK;
+}
+
+void Server::serve_assets(const asset_store::Bundle &bundle, const char *prefix, const char *cache_control)
+{
+    assets_ = &bundle;
+    asset_prefix_ = prefix;
+    asset_cache_control_ = cache_control;
+}
+
+esp_err_t Server::start(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.max_connections == 0 || config.buffer_count == 0 || config.rx_buffer_size < 256 ||
+        config.tx_buffer_size < 256) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+
+    void *mem = heap_caps_malloc(config.max_connections * sizeof(Connection), MALLOC_CAP_INTERNAL);
+    if (mem == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    connections_ = static_cast<Connection *>(mem);
+    for (size_t i = 0; i < config.max_connections; ++i) {
+        new (&connections_[i]) Connection();
+    }
+
+    mem_pool::SlabPool::Config pool;
+    pool.name = "http_io";
+    pool.block_size = config.rx_buffer_size + config.tx_buffer_size;
+    pool.block_count = config.buffer_count;
+    esp_err_t err = buffers_.init(pool);
+    if (err != ESP_OK) {
+        stop();
+        return err;
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_fd_ < 0) {
+        stop();
+        return ESP_ERR_NO_MEM;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config.port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(listen_fd_, listen_backlog) != 0) {
+        ESP_LOGE(TAG, "bind/listen on port %u failed: errno %d", config.port, errno);
+        stop();
+        return ESP_FAIL;
+    }
+    set_non_blocking(listen_fd_);
+
+    stopping_.store(false, std::memory_order_relaxed);
+    stopped_.store(false, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(server_task, "http_server", config.task_stack_size, this, config.task_priority,
+                                &task_, config.task_core) != pdPASS) {
+        task_ = nullptr;
+        stop();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "listening on port %u, %u connection slots", config.port,
+             static_cast<unsigned>(config.max_connections));
+    return ESP_OK;
+}
+
+void Server::stop()
+{
+    if (task_ != nullptr) {
+        stopping_.store(true, std::memory_order_release);
+        while (!stopped_.load(std::memory_order_acquire)) {
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
+        task_ = nullptr;
+    }
+    if (connections_ != nullptr) {
+        for (size_t i = 0; i < config_.max_connections; ++i) {
+            if (connections_[i].state != State::Free) {
+                close_connection(connections_[i]);
+            }
+        }
+        heap_caps_free(connections_);
+        connections_ = nullptr;
+    }
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+        listen_fd_ = -1;
+    }
+    buffers_.deinit();
+}
+
+void Server::server_task(void *arg)
+{
+    auto *self = static_cast<Server *>(arg);
+    self->run();
+    self->stopped_.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void Server::run()
+{
+    int64_t last_sweep_us = esp_timer_get_time();
+    while (!stopping_.load(std::memory_order_acquire)) {
+        fd_set readable;
+        fd_set writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(listen_fd_, &readable);
+        int max_fd = listen_fd_;
+        for (size_t i = 0; i < config_.max_connections; ++i) {
+            const Connection &c = connections_[i];
+            if (c.state == State::Free) {
+                continue;
+            }
+            if (c.state == State::Writing) {
+                FD_SET(c.fd, &writable);
+            } else if (!c.starved) {
+                FD_SET(c.fd, &readable);
+            }
+            if (c.fd > max_fd) {
+                max_fd = c.fd;
+            }
+        }
+
+        struct timeval tv = {0, static_cast<suseconds_t>(loop_tick_ms * 1000)};
+        int ready = select(max_fd + 1, &readable, &writable, nullptr, &tv);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                ESP_LOGE(TAG, "select failed: errno %d", errno);
+                vTaskDelay(pdMS_TO_TICKS(loop_tick_ms));
+            }
+            continue;
+        }
+        if (ready > 0) {
+            if (FD_ISSET(listen_fd_, &readable)) {
+                accept_connections();
+            }
+            for (size_t i = 0; i < config_.max_connections; ++i) {
+                Connection &c = connections_[i];
+                if (c.state == State::Free) {
+                    continue;
+                }
+                if (c.state == State::Writing && FD_ISSET(c.fd, &writable)) {
+                    on_writable(c);
+                    /* Answer requests pipelined behind the one just finished. */
+                    if (c.state == State::Idle) {
+                        process(c);
+                    }
+                } else if (c.state == State::Idle && FD_ISSET(c.fd, &readable)) {
+                    on_readable(c);
+                } else if (c.state == State::Draining && FD_ISSET(c.fd, &readable)) {
+                    drain(c);
+                }
+            }
+        }
+
+        int64_t now = esp_timer_get_time();
+        if (now - last_sweep_us >= 1000000) {
+            last_sweep_us = now;
+            const int64_t limit = static_cast<int64_t>(config_.idle_timeout_ms) * 1000;
+            for (size_t i = 0; i < config_.max_connections; ++i) {
+                Connection &c = connections_[i];
+                if (c.state != State::Free &&
+                    now - c.last_active_us > (c.state == State::Draining ? drain_timeout_us : limit)) {
+                    close_connection(c);
+                }
+            }
+        }
+    }
+}
+
+void Server::accept_connections()
+{
+    for (;;) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        Connection *c = claim_slot();
+        if (c == nullptr) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            close(fd);
+            continue;
+        }
+        set_non_blocking(fd);
+        /* Responses go out in one writev(); Nagle would only delay the tail. */
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        c->fd = fd;
+        c->state = State::Idle;
+        c->last_active_us = esp_timer_get_time();
+        accepted_.fetch_add(1, std::memory_order_relaxed);
+        active_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+Server::Connection *Server::claim_slot()
+{
+    Connection *oldest = nullptr;
+    for (size_t i = 0; i < config_.max_connections; ++i) {
+        Connection &c = connections_[i];
+        if (c.state == State::Free) {
+            return &c;
+        }
+        if ((c.state == State::Draining || (c.state == State::Idle && c.buffer == nullptr)) &&
+            (oldest == nullptr || c.last_active_us < oldest->last_active_us)) {
+            oldest = &c;
+        }
+    }
+    if (oldest != nullptr) {
+        close_connection(*oldest);
+        evicted_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return oldest;
+}
+
+void Server::close_connection(Connection &c)
+{
+    release_buffer(c);
+    close(c.fd);
+    c = Connection();
+    active_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Server::release_buffer(Connection &c)
+{
+    if (c.buffer == nullptr) {
+        return;
+    }
+    buffers_.deallocate(c.buffer);
+    c.buffer = nullptr;
+    c.rx_length = 0;
+    for (size_t i = 0; i < config_.max_connections; ++i) {
+        connections_[i].starved = false;
+    }
+}
+
+void Server::on_readable(Connection &c)
+{
+    if (c.buffer == nullptr) {
+        c.buffer = static_cast<uint8_t *>(buffers_.allocate());
+        if (c.buffer == nullptr) {
+            /* Data stays in the socket until another connection finishes. */
+            c.starved = true;
+            return;
+        }
+        c.rx_length = 0;
+    }
+    ssize_t n = recv(c.fd, c.buffer + c.rx_length, config_.rx_buffer_size - c.rx_length, 0);
+    if (n == 0 || (n < 0 && !would_block())) {
+        close_connection(c);
+        return;
+    }
+    if (n > 0) {
+        c.rx_length += static_cast<size_t>(n);
+        c.last_active_us = esp_timer_get_time();
+    }
+    process(c);
+}
+
+void Server::drain(Connection &c)
+{
+    uint8_t discard[128];
+    ssize_t n;
+    while ((n = recv(c.fd, discard, sizeof(discard), 0)) > 0) {
+    }
+    if (n == 0 || !would_block()) {
+        close_connection(c);
+    }
+}
+
+void Server::process(Connection &c)
+{
+    while (c.state == State::Idle && c.rx_length != 0) {
+        Request req;
+        size_t consumed = 0;
+        ParseStatus status = RequestParser::parse(c.buffer, c.rx_length, config_.rx_buffer_size, req, &consumed);
+        if (status == ParseStatus::Incomplete) {
+            return;
+        }
+
+        char *tx = reinterpret_cast<char *>(tx_area(c));
+        if (status == ParseStatus::Complete) {
+            requests_.fetch_add(1, std::memory_order_relaxed);
+            Response res(tx, config_.tx_buffer_size, req.method() == Method::Head, req.keep_alive());
+            dispatch(req, res);
+            c.request_length = consumed;
+            c.head_length = res.length_;
+            c.body = res.body_.data();
+            c.body_length = res.body_.size();
+            c.source = res.source_;
+            c.source_ctx = res.source_ctx_;
+            c.keep_alive = res.keep_alive_;
+        } else {
+            /* The stream can no longer be framed; answer and close. */
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            Response res(tx, config_.tx_buffer_size, false, false);
+            res.send_error(RequestParser::status_for(status));
+            c.request_length = c.rx_length;
+            c.head_length = res.length_;
+            c.body = res.body_.data();
+            c.body_length = res.body_.size();
+            c.source = nullptr;
+            c.keep_alive = false;
+        }
+        c.head = reinterpret_cast<const uint8_t *>(tx);
+        c.streaming = c.source != nullptr;
+        c.state = State::Writing;
+        on_writable(c);
+    }
+    if (c.state == State::Idle && c.rx_length == 0) {
+        release_buffer(c);
+    }
+}
+
+void Server::dispatch(const Request &req, Response &res)
+{
+    const std::string_view path = req.path();
+    bool path_matched = false;
+    for (size_t i = 0; i < route_count_; ++i) {
+        const Route &r = routes_[i];
+        std::string_view route_path(r.path, r.length);
+        if (r.prefix ? !path.starts_with(route_path) : path != route_path) {
+            continue;
+        }
+        path_matched = true;
+        if (r.method != req.method() && !(r.method == Method::Get && req.method() == Method::Head)) {
+            continue;
+        }
+        r.handler(req, res, r.ctx);
+        if (!res.finished()) {
+            ESP_LOGW(TAG, "handler for %s sent no response", r.path);
+            res.send_error(500);
+        }
+        return;
+    }
+    if (!path_matched && (req.method() == Method::Get || req.method() == Method::Head) && serve_asset(req, res)) {
+        return;
+    }
+    errors_.fetch_add(1, std::memory_order_relaxed);
+    res.send_error(path_matched ? 405 : 404);
+}
+
+bool Server::serve_asset(const Request &req, Response &res)
+{
+    if (assets_ == nullptr) {
+        return false;
+    }
+    std::string_view path = req.path();
+    std::string_view prefix(asset_prefix_);
+    if (!path.starts_with(prefix)) {
+        return false;
+    }
+    path.remove_prefix(prefix.size());
+
+    static constexpr char index_name[] = "index.html";
+    char name[128];
+    if (path.size() + sizeof(index_name) + 3 > sizeof(name)) {
+        return false;
+    }
+    memcpy(name, path.data(), path.size());
+    size_t length = path.size();
+    if (length == 0 || name[length - 1] == '/') {
+        memcpy(name + length, index_name, sizeof(index_name) - 1);
+        length += sizeof(index_name) - 1;
+    }
+    const std::string_view base(name, length);
+
+    asset_store::Asset asset;
+    bool gzip = false;
+    if (has_token(req.header("Accept-Encoding"), "gzip")) {
+        memcpy(name + length, ".gz", 3);
+        asset = assets_->find({name, length + 3});
+        gzip = static_cast<bool>(asset);
+    }
+    if (!gzip) {
+        asset = assets_->find(base);
+        if (!asset) {
+            return false;
+        }
+    }
+
+    char etag[12];
+    snprintf(etag, sizeof(etag), "\"%08lx\"", static_cast<unsigned long>(asset.crc));
+    res.add_header("ETag", etag);
+    if (asset_cache_control_ != nullptr) {
+        res.add_header("Cache-Control", asset_cache_control_);
+    }
+    std::string_view if_none_match = req.header("If-None-Match");
+    if (if_none_match == "*" || has_token(if_none_match, etag)) {
+        res.send(304);
+        return true;
+    }
+    if (gzip) {
+        res.add_header("Content-Encoding", "gzip");
+        res.add_header("Vary", "Accept-Encoding");
+    }
+    res.send(200, content_type_for(base), asset.data);
+    return true;
+}
+
+void Server::on_writable(Connection &c)
+{
+    for (;;) {
+        if (c.head_length == 0 && c.body_length == 0) {
+            if (!c.streaming) {
+                finish_response(c);
+                return;
+            }
+            next_chunk(c);
+            continue;
+        }
+        struct iovec iov[2];
+        int count = 0;
+        if (c.head_length != 0) {
+            iov[count].iov_base = const_cast<uint8_t *>(c.head);
+            iov[count].iov_len = c.head_length;
+            ++count;
+        }
+        if (c.body_length != 0) {
+            iov[count].iov_base = const_cast<uint8_t *>(c.body);
+            iov[count].iov_len = c.body_length;
+            ++count;
+        }
+        ssize_t n = lwip_writev(c.fd, iov, count);
+        if (n < 0) {
+            if (!would_block()) {
+                close_connection(c);
+            }
+            return;
+        }
+        c.last_active_us = esp_timer_get_time();
+        size_t sent = static_cast<size_t>(n);
+        size_t from_head = sent < c.head_length ? sent : c.head_length;
+        c.head += from_head;
+        c.head_length -= from_head;
+        sent -= from_head;
+        c.body += sent;
+        c.body_length -= sent;
+        if (c.head_length != 0 || c.body_length != 0) {
+            /* Send buffer full; wait for select() to report space. */
+            return;
+        }
+    }
+}
+
+void Server::next_chunk(Connection &c)
+{
+    uint8_t *tx = tx_area(c);
+    size_t n = c.source(c.source_ctx, tx + chunk_prefix, config_.tx_buffer_size - chunk_prefix - 2);
+    if (n == 0) {
+        static constexpr char last_chunk[] = "0\r\n\r\n";
+        memcpy(tx, last_chunk, sizeof(last_chunk) - 1);
+        c.head = tx;
+        c.head_length = sizeof(last_chunk) - 1;
+        c.streaming = false;
+        return;
+    }
+    /* Size line right-aligned against the data, CRLF after it: one contiguous send. */
+    char size_line[chunk_prefix + 1];
+    int len = snprintf(size_line, sizeof(size_line), "%x\r\n", static_cast<unsigned>(n));
+    uint8_t *start = tx + chunk_prefix - len;
+    memcpy(start, size_line, len);
+    memcpy(tx + chunk_prefix + n, "\r\n", 2);
+    c.head = start;
+    c.head_length = len + n + 2;
+}
+
+void Server::finish_response(Connection &c)
+{
+    c.state = State::Idle;
+    c.streaming = false;
+    c.source = nullptr;
+    c.source_ctx = nullptr;
+    c.head = nullptr;
+    c.body = nullptr;
+    if (!c.keep_alive) {
+        shutdown(c.fd, SHUT_WR);
+        release_buffer(c);
+        c.state = State::Draining;
+        return;
+    }
+    size_t rest = c.rx_length - c.request_length;
+    memmove(c.buffer, c.buffer + c.request_length, rest);
+    c.rx_length = rest;
+    c.request_length = 0;
+}
+
+ServerStats Server::stats() const
+{
+    ServerStats st;
+    st.accepted = accepted_.load(std::memory_order_relaxed);
+    st.evicted = evicted_.load(std::memory_order_relaxed);
+    st.rejected = rejected_.load(std::memory_order_relaxed);
+    st.requests = requests_.load(std::memory_order_relaxed);
+    st.errors = errors_.load(std::memory_order_relaxed);
+    st.active = active_.load(std::memory_order_relaxed);
+    return st;
+}
+
+} // namespace http_server
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "lf_ring/notifier.hpp"
+
+namespace lf_ring {
+
+/**
+ * @brief Bounded multi-producer / single-consumer ring.
+ *
+ * Any number of tasks and ISRs, on either core, may push; one context pops.
+ * Each slot carries a sequence number (Vyukov's bounded queue): producers
+ * claim slots with a CAS on the tail and publish them individually, so a
+ * slow producer only delays items behind its own slot and nobody ever spins
+ * on a lock or masks interrupts.
+ *
+ * Same constraints as SpscRing: T trivially copyable, ring object in internal
+ * RAM for ISR use, operations inlined into the caller.
+ *
+ * @tparam Capacity number of slots, a power of two.
+ */
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(Capacity <= (1u << 30), "Capacity too large for 32-bit sequence numbers");
+    static_assert(std::is_trivially_copyable<T>::value, "ring items are copied with memcpy");
+
+public:
+    using value_type = T;
+    static constexpr size_t capacity = Capacity;
+
+    MpscRing()
+    {
+        for (uint32_t i = 0; i < Capacity; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    Notifier &notifier() { return notifier_; }
+
+    /** @return false if the ring is full. */
+    LF_RING_INLINE bool push(const T &item)
+    {
+        bool was_empty;
+        if (push_many(&item, 1, &was_empty) == 0) {
+            return false;
+        }
+        if (was_empty) {
+            notifier_.notify();
+        }
+        return true;
+    }
+
+    LF_RING_INLINE bool push_from_isr(const T &item, BaseType_t *higher_priority_task_woken)
+    {
+        bool was_empty;
+        if (push_many(&item, 1, &was_empty) == 0) {
+            return false;
+        }
+        if (was_empty) {
+            notifier_.notify_from_isr(higher_priority_task_woken);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Claim @p count consecutive slots with a single CAS and fill them.
+     *
+     * All-or-nothing, so a batch from one producer is never interleaved with
+     * another's. @return @p count, or 0 if there was not enough room.
+     */
+    LF_RING_INLINE size_t push_n(const T *items, size_t count)
+    {
+        bool was_empty;
+        size_t pushed = push_many(items, count, &was_empty);
+        if (was_empty) {
+            notifier_.notify();
+        }
+        return pushed;
+    }
+
+    LF_RING_INLINE size_t push_n_from_isr(const T *items, size_t count, BaseType_t *higher_priority_task_woken)
+    {
+        bool was_empty;
+        size_t pushed = push_many(items, count, &was_empty);
+        if (was_empty) {
+            notifier_.notify_from_isr(higher_priority_task_woken);
+        }
+        return pushed;
+    }
+
+    /** @return false if the ring is empty or the next slot is still being written. */
+    LF_RING_INLINE bool pop(T &out)
+    {
+        uint32_t head = head_.index.load(std::memory_order_relaxed);
+        Slot &slot = slots_[head & mask];
+        if (slot.seq.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        memcpy(&out, &slot.item, sizeof(T));
+        slot.seq.store(head + Capacity, std::memory_order_release);
+        head_.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Pop up to @p max published items. @return number popped. */
+    LF_RING_INLINE size_t pop_n(T *out, size_t max)
+    {
+        uint32_t head = head_.index.load(std::memory_order_relaxed);
+        size_t n = 0;
+        while (n < max) {
+            Slot &slot = slots_[(head + n) & mask];
+            if (slot.seq.load(std::memory_order_acquire) != head + n + 1) {
+                break;
+            }
+            memcpy(&out[n], &slot.item, sizeof(T));
+            slot.seq.store(head + n + Capacity, std::memory_order_release);
+            ++n;
+        }
+        if (n != 0) {
+            head_.index.store(head + static_cast<uint32_t>(n), std::memory_order_release);
+        }
+        return n;
+    }
+
+    /** Consumer: pop, or sleep until a push arrives or @p timeout expires. */
+    bool pop_wait(T &out, TickType_t timeout)
+    {
+        for (;;) {
+            if (pop(out)) {
+                return true;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint32_t head = head_.index.load(std::memory_order_relaxed);
+            if (slots_[head & mask].seq.load(std::memory_order_relaxed) == head + 1) {
+                continue;
+            }
+            if (!notifier_.wait(timeout)) {
+                return pop(out);
+            }
+        }
+    }
+
+    /** Claimed slots not yet popped; approximate under concurrency. */
+    size_t size() const
+    {
+        return tail_.index.load(std::memory_order_acquire) - head_.index.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr uint32_t mask = Capacity - 1;
+
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        T item;
+    };
+
+    struct alignas(cache_line_size) Index {
+        std::atomic<uint32_t> index{0};
+    };
+
+    LF_RING_INLINE size_t push_many(const T *items, size_t count, bool *was_empty)
+    {
+        *was_empty = false;
+        if (count == 0 || count > Capacity) {
+            return 0;
+        }
+        uint32_t n = static_cast<uint32_t>(count);
+        uint32_t pos = tail_.index.load(std::memory_order_relaxed);
+        for (;;) {
+            /* The consumer frees slots in order, so if the last slot of the batch
+             * is free for this lap, every slot before it is too. */
+            uint32_t seq = slots_[(pos + n - 1) & mask].seq.load(std::memory_order_acquire);
+            auto diff = static_cast<int32_t>(seq - (pos + n - 1));
+            if (diff == 0) {
+                if (tail_.index.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed,
+                                                      std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return 0;
+            } else {
+                pos = tail_.index.load(std::memory_order_relaxed);
+            }
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+            Slot &slot = slots_[(pos + i) & mask];
+            memcpy(&slot.item, &items[i], sizeof(T));
+            slot.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        /* Pairs with the fence in pop_wait(): a consumer that had drained up to
+         * our first slot either sees it published or gets notified. */
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        *was_empty = head_.index.load(std::memory_order_relaxed) == pos;
+        return count;
+    }
+
+    Index head_;
+    Index tail_;
+    Notifier notifier_;
+    alignas(cache_line_size) Slot slots_[Capacity];
+};
+
+} // namespace lf_ring
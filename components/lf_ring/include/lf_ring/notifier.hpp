@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+/** Hot-path ring operations must inline into the (possibly IRAM) caller. */
+#define LF_RING_INLINE __attribute__((always_inline)) inline
+
+namespace lf_ring {
+
+constexpr size_t cache_line_size = CONFIG_LF_RING_CACHE_LINE_SIZE;
+
+/**
+ * @brief Wakes a consumer task through its notification value.
+ *
+ * Rings call notify() only when a push lands in a ring the consumer had
+ * drained, so a steady stream costs one notification per burst rather than
+ * one per item. The consumer's bit is set with eSetBits, so one task can
+ * wait on several rings with xTaskNotifyWait() and tell them apart.
+ */
+class Notifier {
+public:
+    /** Route wakeups to @p task, setting @p bits in its notification value. */
+    void attach(TaskHandle_t task, uint32_t bits = 1)
+    {
+        bits_ = bits;
+        task_.store(task, std::memory_order_release);
+    }
+
+    void detach() { task_.store(nullptr, std::memory_order_release); }
+
+    TaskHandle_t task() const { return task_.load(std::memory_order_acquire); }
+    uint32_t bits() const { return bits_; }
+
+    LF_RING_INLINE void notify() const
+    {
+        TaskHandle_t task = task_.load(std::memory_order_acquire);
+        if (task != nullptr) {
+            xTaskNotify(task, bits_, eSetBits);
+        }
+    }
+
+    LF_RING_INLINE void notify_from_isr(BaseType_t *higher_priority_task_woken) const
+    {
+        TaskHandle_t task = task_.load(std::memory_order_acquire);
+        if (task != nullptr) {
+            xTaskNotifyFromISR(task, bits_, eSetBits, higher_priority_task_woken);
+        }
+    }
+
+    /**
+     * @brief Block the calling (consumer) task until notified or @p timeout.
+     *
+     * Clears only this notifier's bits on exit so other rings sharing the task
+     * keep theirs. @return true if woken by a push.
+     */
+    bool wait(TickType_t timeout) const
+    {
+        uint32_t value = 0;
+        return xTaskNotifyWait(0, bits_, &value, timeout) == pdTRUE && (value & bits_) != 0;
+    }
+
+private:
+    std::atomic<TaskHandle_t> task_{nullptr};
+    uint32_t bits_ = 1;
+};
+
+} // namespace lf_ring
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "lf_ring/notifier.hpp"
+
+namespace lf_ring {
+
+/**
+ * @brief Bounded single-producer / single-consumer ring.
+ *
+ * Exactly one context may push and one may pop; they may be on different
+ * cores, and the producer may be an ISR (use the *_from_isr variants). The
+ * indices are free-running 32-bit counters on separate cache lines, and each
+ * side keeps a private copy of the other's index so it only reads the shared
+ * one when the ring looks full (producer) or empty (consumer).
+ *
+ * Items are copied with memcpy, so T must be trivially copyable. Every
+ * operation is inlined into the caller, which makes the ISR side IRAM-safe
+ * as long as the calling ISR is in IRAM and the ring object is in internal
+ * RAM (not PSRAM).
+ *
+ * @tparam Capacity number of slots, a power of two.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(Capacity <= (1u << 31), "Capacity too large for 32-bit indices");
+    static_assert(std::is_trivially_copyable<T>::value, "ring items are copied with memcpy");
+
+public:
+    using value_type = T;
+    static constexpr size_t capacity = Capacity;
+
+    SpscRing() = default;
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    /** Consumer-side wakeup routing; see Notifier. */
+    Notifier &notifier() { return notifier_; }
+
+    /** @return false if the ring is full. */
+    LF_RING_INLINE bool push(const T &item)
+    {
+        bool was_empty;
+        if (!push_one(item, &was_empty)) {
+            return false;
+        }
+        if (was_empty) {
+            notifier_.notify();
+        }
+        return true;
+    }
+
+    LF_RING_INLINE bool push_from_isr(const T &item, BaseType_t *higher_priority_task_woken)
+    {
+        bool was_empty;
+        if (!push_one(item, &was_empty)) {
+            return false;
+        }
+        if (was_empty) {
+            notifier_.notify_from_isr(higher_priority_task_woken);
+        }
+        return true;
+    }
+
+    /** Push up to @p count items in one index update. @return number pushed. */
+    LF_RING_INLINE size_t push_n(const T *items, size_t count)
+    {
+        bool was_empty;
+        size_t pushed = push_many(items, count, &was_empty);
+        if (was_empty) {
+            notifier_.notify();
+        }
+        return pushed;
+    }
+
+    LF_RING_INLINE size_t push_n_from_isr(const T *items, size_t count, BaseType_t *higher_priority_task_woken)
+    {
+        bool was_empty;
+        size_t pushed = push_many(items, count, &was_empty);
+        if (was_empty) {
+            notifier_.notify_from_isr(higher_priority_task_woken);
+        }
+        return pushed;
+    }
+
+    /** @return false if the ring is empty. */
+    LF_RING_INLINE bool pop(T &out)
+    {
+        uint32_t head = head_.index.load(std::memory_order_relaxed);
+        if (head == head_.peer) {
+            head_.peer = tail_.index.load(std::memory_order_acquire);
+            if (head == head_.peer) {
+                return false;
+            }
+        }
+        memcpy(&out, &slots_[head & mask], sizeof(T));
+        head_.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Pop up to @p max items in one index update. @return number popped. */
+    LF_RING_INLINE size_t pop_n(T *out, size_t max)
+    {
+        uint32_t head = head_.index.load(std::memory_order_relaxed);
+        size_t avail = head_.peer - head;
+        if (avail < max) {
+            head_.peer = tail_.index.load(std::memory_order_acquire);
+            avail = head_.peer - head;
+        }
+        size_t n = avail < max ? avail : max;
+        if (n == 0) {
+            return 0;
+        }
+        size_t first = head & mask;
+        size_t chunk = Capacity - first < n ? Capacity - first : n;
+        memcpy(out, &slots_[first], chunk * sizeof(T));
+        memcpy(out + chunk, &slots_[0], (n - chunk) * sizeof(T));
+        head_.index.store(head + static_cast<uint32_t>(n), std::memory_order_release);
+        return n;
+    }
+
+    /**
+     * @brief Consumer: pop, or sleep until a push arrives or @p timeout expires.
+     *
+     * The fence between the final empty check and the wait pairs with the one
+     * in the producer, so a push racing with the consumer going to sleep
+     * always results in a notification.
+     */
+    bool pop_wait(T &out, TickType_t timeout)
+    {
+        for (;;) {
+            if (pop(out)) {
+                return true;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tail_.index.load(std::memory_order_relaxed) != head_.index.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            if (!notifier_.wait(timeout)) {
+                return pop(out);
+            }
+        }
+    }
+
+    /** Approximate when called concurrently with a push or pop. */
+    size_t size() const
+    {
+        return tail_.index.load(std::memory_order_acquire) - head_.index.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+private:
+    static constexpr uint32_t mask = Capacity - 1;
+
+    /* One side's index plus its private snapshot of the other side's, on a
+     * line written only by that side. */
+    struct alignas(cache_line_size) Side {
+        std::atomic<uint32_t> index{0};
+        uint32_t peer = 0;
+    };
+
+    LF_RING_INLINE bool push_one(const T &item, bool *was_empty)
+    {
+        uint32_t tail = tail_.index.load(std::memory_order_relaxed);
+        if (tail - tail_.peer == Capacity) {
+            tail_.peer = head_.index.load(std::memory_order_acquire);
+            if (tail - tail_.peer == Capacity) {
+                *was_empty = false;
+                return false;
+            }
+        }
+        memcpy(&slots_[tail & mask], &item, sizeof(T));
+        publish(tail, 1, was_empty);
+        return true;
+    }
+
+    LF_RING_INLINE size_t push_many(const T *items, size_t count, bool *was_empty)
+    {
+        uint32_t tail = tail_.index.load(std::memory_order_relaxed);
+        size_t space = Capacity - (tail - tail_.peer);
+        if (space < count) {
+            tail_.peer = head_.index.load(std::memory_order_acquire);
+            space = Capacity - (tail - tail_.peer);
+        }
+        size_t n = space < count ? space : count;
+        if (n == 0) {
+            *was_empty = false;
+            return 0;
+        }
+        size_t first = tail & mask;
+        size_t chunk = Capacity - first < n ? Capacity - first : n;
+        memcpy(&slots_[first], items, chunk * sizeof(T));
+        memcpy(&slots_[0], items + chunk, (n - chunk) * sizeof(T));
+        publish(tail, static_cast<uint32_t>(n), was_empty);
+        return n;
+    }
+
+    /* Publish, then re-read the consumer index: if it had caught up with the
+     * old tail the consumer may be asleep and needs a wakeup. */
+    LF_RING_INLINE void publish(uint32_t tail, uint32_t n, bool *was_empty)
+    {
+        tail_.index.store(tail + n, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        tail_.peer = head_.index.load(std::memory_order_relaxed);
+        *was_empty = tail_.peer == tail;
+    }
+
+    Side head_; /* consumer; peer = last tail seen */
+    Side tail_; /* producer; peer = last head seen */
+    Notifier notifier_;
+    alignas(cache_line_size) T slots_[Capacity];
+};
+
+} // namespace lf_ring
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+
+#include "esp_heap_caps.h"
+#include "mem_pool/arena.hpp"
+#include "mem_pool/placement.hpp"
+#include "mem_pool/slab_pool.hpp"
+
+/**
+ * @file allocator.hpp
+ * @brief STL-compatible allocator adapters.
+ *
+ * Exceptions are disabled in this project, so like std::allocator these
+ * adapters abort() when memory genuinely runs out rather than returning
+ * nullptr to a container that cannot handle it.
+ *
+ * @code
+ * std::vector<Sample, mem_pool::CapsAllocator<Sample, mem_pool::Placement::Spiram>> history;
+ * std::list<Conn, mem_pool::PoolAllocator<Conn>> conns{mem_pool::PoolAllocator<Conn>(conn_pool)};
+ * @endcode
+ */
+
+namespace mem_pool {
+
+namespace detail {
+
+inline void *heap_or_abort(size_t bytes, Placement placement)
+{
+    void *p = heap_caps_malloc(bytes, caps_of(placement));
+    if (p == nullptr) {
+        abort();
+    }
+    return p;
+}
+
+} // namespace detail
+
+/** Stateless adapter placing every allocation with heap_caps_malloc(@p P). */
+template <typename T, Placement P>
+class CapsAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = CapsAllocator<U, P>;
+    };
+
+    CapsAllocator() = default;
+    template <typename U>
+    CapsAllocator(const CapsAllocator<U, P> &)
+    {
+    }
+
+    T *allocate(size_t n) { return static_cast<T *>(detail::heap_or_abort(n * sizeof(T), P)); }
+    void deallocate(T *p, size_t) { heap_caps_free(p); }
+
+    template <typename U>
+    bool operator==(const CapsAllocator<U, P> &) const
+    {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const CapsAllocator<U, P> &) const
+    {
+        return false;
+    }
+};
+
+/**
+ * @brief Node allocator backed by a SlabPool.
+ *
+ * Meant for node-based containers (list, map, set, unordered_* nodes) whose
+ * rebound node type fits one block. Requests that do not fit - array
+ * allocations, bucket tables, or an exhausted pool - go to heap_caps_malloc
+ * with the pool's placement and are counted as fallbacks in the pool stats,
+ * so an undersized pool shows up in log_stats() instead of crashing.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U>;
+    };
+
+    explicit PoolAllocator(SlabPool &pool) : pool_(&pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other) : pool_(other.pool())
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        if (n * sizeof(T) <= pool_->block_size() && alignof(T) <= pool_->alignment()) {
+            void *p = pool_->allocate();
+            if (p != nullptr) {
+                return static_cast<T *>(p);
+            }
+        }
+        pool_->note_fallback();
+        return static_cast<T *>(detail::heap_or_abort(n * sizeof(T), pool_->placement()));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        if (pool_->owns(p)) {
+            pool_->deallocate(p);
+        } else {
+            heap_caps_free(p);
+        }
+    }
+
+    SlabPool *pool() const { return pool_; }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &other) const
+    {
+        return pool_ == other.pool();
+    }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &other) const
+    {
+        return pool_ != other.pool();
+    }
+
+private:
+    SlabPool *pool_;
+};
+
+/**
+ * @brief Allocator drawing from an Arena; deallocate() is a no-op for arena memory.
+ *
+ * Suited to containers that live for one request and are dropped together
+ * with Arena::reset(). Once the arena is full, requests spill to the heap with
+ * the arena's placement and are freed normally.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = ArenaAllocator<U>;
+    };
+
+    explicit ArenaAllocator(Arena &arena) : arena_(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena_(other.arena())
+    {
+    }
+
+    T *allocate(size_t n)
+    {
+        void *p = arena_->allocate(n * sizeof(T), alignof(T));
+        if (p != nullptr) {
+            return static_cast<T *>(p);
+        }
+        arena_->note_fallback();
+        return static_cast<T *>(detail::heap_or_abort(n * sizeof(T), arena_->placement()));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        if (!arena_->owns(p)) {
+            heap_caps_free(p);
+        }
+    }
+
+    Arena *arena() const { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return arena_ == other.arena();
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const
+    {
+        return arena_ != other.arena();
+    }
+
+private:
+    Arena *arena_;
+};
+
+} // namespace mem_pool
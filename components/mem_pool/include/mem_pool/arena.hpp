@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "esp_err.h"
+#include "mem_pool/placement.hpp"
+#include "mem_pool/stats.hpp"
+
+namespace mem_pool {
+
+/**
+ * @brief Bump allocator over one heap_caps buffer, for per-request scratch.
+ *
+ * Allocation is a pointer increment; individual frees are no-ops and all
+ * memory comes back at once with reset() or rewind(). An arena is owned by
+ * one task at a time and does no locking.
+ *
+ * @code
+ * arena.reset();
+ * auto *doc = arena.create<Document>();
+ * char *scratch = static_cast<char *>(arena.allocate(512));
+ * ... handle the request ...
+ * @endcode
+ */
+class Arena : public StatsSource {
+public:
+    struct Config {
+        /** Shown by log_stats(); nullptr keeps the arena out of the registry. */
+        const char *name = nullptr;
+        size_t capacity = 0;
+        Placement placement = Placement::Internal;
+    };
+
+    /** Opaque position returned by mark() for a later rewind(). */
+    using Marker = size_t;
+
+    Arena() = default;
+    ~Arena() { deinit(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /** @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE or ESP_ERR_NO_MEM. */
+    esp_err_t init(const Config &config);
+
+    void deinit();
+
+    /** @p size bytes aligned to @p alignment (a power of two), or nullptr when full. */
+    void *allocate(size_t size, size_t alignment = alignof(max_align_t))
+    {
+        uintptr_t cur = reinterpret_cast<uintptr_t>(base_) + used_;
+        uintptr_t aligned = (cur + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+        size_t offset = aligned - reinterpret_cast<uintptr_t>(base_);
+        if (offset + size > capacity_ || offset + size < offset) {
+            ++failures_;
+            return nullptr;
+        }
+        used_ = offset + size;
+        if (used_ > high_water_) {
+            high_water_ = used_;
+        }
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    /** Placement-new a T in the arena. Its destructor is never run by the arena. */
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        void *mem = allocate(sizeof(T), alignof(T));
+        return mem != nullptr ? new (mem) T(static_cast<Args &&>(args)...) : nullptr;
+    }
+
+    /** Release everything allocated since init() or the last reset(). */
+    void reset() { used_ = 0; }
+
+    Marker mark() const { return used_; }
+
+    /** Release everything allocated after @p marker was taken. */
+    void rewind(Marker marker)
+    {
+        if (marker <= used_) {
+            used_ = marker;
+        }
+    }
+
+    /** True if @p ptr points into the arena's buffer. */
+    bool owns(const void *ptr) const
+    {
+        auto *p = static_cast<const uint8_t *>(ptr);
+        return p >= base_ && p < base_ + capacity_;
+    }
+
+    /** Record that an allocator adapter spilled a request to heap_caps_malloc. */
+    void note_fallback() { ++fallbacks_; }
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return capacity_; }
+    Placement placement() const { return placement_; }
+
+    Stats stats() const override;
+    void reset_high_water() override { high_water_ = used_; }
+
+private:
+    uint8_t *base_ = nullptr;
+    size_t capacity_ = 0;
+    size_t used_ = 0;
+    size_t high_water_ = 0;
+    uint32_t failures_ = 0;
+    uint32_t fallbacks_ = 0;
+    Placement placement_ = Placement::Internal;
+    const char *name_ = nullptr;
+};
+
+} // namespace mem_pool
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_heap_caps.h"
+
+namespace mem_pool {
+
+/**
+ * @brief Where a pool or arena takes its backing memory from.
+ *
+ * Each value is the heap_caps capability mask passed to heap_caps_malloc, so
+ * placement is explicit at every call site instead of depending on the
+ * malloc() fallback order configured in menuconfig.
+ */
+enum class Placement : uint32_t {
+    /** Internal DRAM: fastest, byte-addressable, scarce. */
+    Internal = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    /** External PSRAM through the cache: large, several times slower. */
+    Spiram = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+    /** DMA-capable internal memory for peripheral buffers. */
+    Dma = MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+};
+
+constexpr uint32_t caps_of(Placement placement)
+{
+    return static_cast<uint32_t>(placement);
+}
+
+const char *placement_name(Placement placement);
+
+} // namespace mem_pool
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "mem_pool/placement.hpp"
+#include "mem_pool/stats.hpp"
+#include "sdkconfig.h"
+
+namespace mem_pool {
+
+/**
+ * @brief Fixed-size block pool carved out of a single heap_caps allocation.
+ *
+ * allocate() and deallocate() are O(1) and lock-free: the free list is a
+ * Treiber stack of 16-bit block indices whose head carries a 16-bit ABA tag,
+ * so it fits the 32-bit compare-and-swap every ESP target provides. Both may
+ * be called from any core and from ISRs. Links live in a side table rather
+ * than inside free blocks, so a block's contents are never touched by the pool.
+ *
+ * The heap is only used by init()/deinit(); steady-state traffic never takes
+ * the global heap lock and cannot fragment it.
+ */
+class SlabPool : public StatsSource {
+public:
+    struct Config {
+        /** Shown by log_stats(); nullptr keeps the pool out of the registry. */
+        const char *name = nullptr;
+        /** Usable bytes per block; rounded up to @c alignment. */
+        size_t block_size = 0;
+        /** Number of blocks, at most max_blocks. */
+        size_t block_count = 0;
+        /** Block alignment, a power of two. Use the cache line size for DMA. */
+        size_t alignment = alignof(max_align_t);
+        Placement placement = Placement::Internal;
+    };
+
+    static constexpr size_t max_blocks = 0xfffe;
+
+    SlabPool() = default;
+    ~SlabPool() { deinit(); }
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    /**
+     * @brief Reserve backing memory for all blocks.
+     *
+     * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad config, ESP_ERR_INVALID_STATE
+     *         if already initialised, ESP_ERR_NO_MEM if the placement is exhausted.
+     */
+    esp_err_t init(const Config &config);
+
+    /** Release backing memory. Every block must have been returned. */
+    void deinit();
+
+    /** Pop a block, or nullptr if the pool is exhausted. */
+    void *allocate()
+    {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            uint16_t index = head & index_mask;
+            if (index == nil) {
+                note_failure();
+                return nullptr;
+            }
+            uint16_t next = next_[index].load(std::memory_order_relaxed);
+            uint32_t desired = next_tag(head) | next;
+            if (head_.compare_exchange_weak(head, desired, std::memory_order_acquire,
+                                            std::memory_order_acquire)) {
+                note_allocated();
+                return base_ + static_cast<size_t>(index) * block_size_;
+            }
+        }
+    }
+
+    /** Push @p ptr back. @p ptr must come from this pool's allocate(). */
+    void deallocate(void *ptr)
+    {
+        auto index = static_cast<uint16_t>((static_cast<uint8_t *>(ptr) - base_) / block_size_);
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t desired;
+        do {
+            next_[index].store(head & index_mask, std::memory_order_relaxed);
+            desired = next_tag(head) | index;
+        } while (!head_.compare_exchange_weak(head, desired, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        note_released();
+    }
+
+    /** True if @p ptr points into this pool's block range. */
+    bool owns(const void *ptr) const
+    {
+        auto *p = static_cast<const uint8_t *>(ptr);
+        return p >= base_ && p < base_ + block_size_ * block_count_;
+    }
+
+    size_t block_size() const { return block_size_; }
+    size_t block_count() const { return block_count_; }
+    size_t alignment() const { return alignment_; }
+    Placement placement() const { return placement_; }
+
+    /** Record that an allocator adapter bypassed the pool for an oversized request. */
+    void note_fallback() { fallbacks_.fetch_add(1, std::memory_order_relaxed); }
+
+    Stats stats() const override;
+    void reset_high_water() override;
+
+private:
+    static constexpr uint32_t index_mask = 0xffff;
+    static constexpr uint16_t nil = 0xffff;
+
+    static uint32_t next_tag(uint32_t head) { return (head + (index_mask + 1)) & ~index_mask; }
+
+    void note_failure()
+    {
+#if CONFIG_MEM_POOL_STATS
+        failures_.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+
+    void note_allocated()
+    {
+#if CONFIG_MEM_POOL_STATS
+        uint32_t used = in_use_.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t peak = high_water_.load(std::memory_order_relaxed);
+        while (used > peak && !high_water_.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+#endif
+    }
+
+    void note_released()
+    {
+#if CONFIG_MEM_POOL_STATS
+        in_use_.fetch_sub(1, std::memory_order_relaxed);
+#endif
+    }
+
+    std::atomic<uint32_t> head_{nil};
+    std::atomic<uint16_t> *next_ = nullptr;
+    uint8_t *base_ = nullptr;
+    size_t block_size_ = 0;
+    size_t block_count_ = 0;
+    size_t alignment_ = 0;
+    Placement placement_ = Placement::Internal;
+    const char *name_ = nullptr;
+    std::atomic<uint32_t> in_use_{0};
+    std::atomic<uint32_t> high_water_{0};
+    std::atomic<uint32_t> failures_{0};
+    std::atomic<uint32_t> fallbacks_{0};
+};
+
+} // namespace mem_pool
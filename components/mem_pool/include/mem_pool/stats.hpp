@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mem_pool/placement.hpp"
+
+namespace mem_pool {
+
+/**
+ * @brief Usage snapshot of a pool or arena.
+ *
+ * For slab pools the counters are in blocks of @c unit bytes; for arenas
+ * @c unit is 1 and the counters are in bytes. @c high_water is the peak
+ * @c in_use since init() or the last reset_high_water(), which is the number
+ * to size a pool from after running real traffic.
+ */
+struct Stats {
+    const char *name;
+    Placement placement;
+    size_t unit;
+    size_t capacity;
+    size_t in_use;
+    size_t high_water;
+    /** Requests that could not be served from the pool/arena. */
+    uint32_t failures;
+    /** Requests an allocator adapter forwarded to heap_caps_malloc instead. */
+    uint32_t fallbacks;
+};
+
+/**
+ * @brief Anything that reports Stats and can be listed by log_stats().
+ *
+ * Pools and arenas with a name link themselves into a global list on init()
+ * and unlink on deinit(); the list is only touched on those slow paths.
+ */
+class StatsSource {
+public:
+    virtual Stats stats() const = 0;
+    virtual void reset_high_water() = 0;
+
+protected:
+    StatsSource() = default;
+    ~StatsSource() = default;
+
+    void register_source();
+    void unregister_source();
+
+private:
+    friend void for_each_source(void (*fn)(const StatsSource &source, void *ctx), void *ctx);
+
+    StatsSource *next_source_ = nullptr;
+    bool registered_ = false;
+};
+
+/** Call @p fn for every registered pool and arena. */
+void for_each_source(void (*fn)(const StatsSource &source, void *ctx), void *ctx);
+
+/** Log one line per registered pool/arena with its current and peak usage. */
+void log_stats();
+
+} // namespace mem_pool
@@ -0,0 +1,67 @@
+#include "mem_pool/arena.hpp"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "mem_pool";
+
+namespace mem_pool {
+
+esp_err_t Arena::init(const Config &config)
+{
+    if (base_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.capacity == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto *base = static_cast<uint8_t *>(
+        heap_caps_aligned_alloc(alignof(max_align_t), config.capacity, caps_of(config.placement)));
+    if (base == nullptr) {
+        ESP_LOGE(TAG, "%s: no %s memory for %u bytes", config.name ? config.name : "arena",
+                 placement_name(config.placement), static_cast<unsigned>(config.capacity));
+        return ESP_ERR_NO_MEM;
+    }
+
+    base_ = base;
+    capacity_ = config.capacity;
+    used_ = 0;
+    high_water_ = 0;
+    failures_ = 0;
+    fallbacks_ = 0;
+    placement_ = config.placement;
+    name_ = config.name;
+
+    if (name_ != nullptr) {
+        register_source();
+    }
+    return ESP_OK;
+}
+
+void Arena::deinit()
+{
+    if (base_ == nullptr) {
+        return;
+    }
+    unregister_source();
+    heap_caps_free(base_);
+    base_ = nullptr;
+    capacity_ = 0;
+    used_ = 0;
+}
+
+Stats Arena::stats() const
+{
+    Stats s = {};
+    s.name = name_;
+    s.placement = placement_;
+    s.unit = 1;
+    s.capacity = capacity_;
+    s.in_use = used_;
+    s.high_water = high_water_;
+    s.failures = failures_;
+    s.fallbacks = fallbacks_;
+    return s;
+}
+
+} // namespace mem_pool
@@ -0,0 +1,104 @@
+#include "mem_pool/slab_pool.hpp"
+
+#include <new>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "mem_pool";
+
+namespace mem_pool {
+
+esp_err_t SlabPool::init(const Config &config)
+{
+    if (base_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t alignment = config.alignment;
+    if (config.block_size == 0 || config.block_count == 0 || config.block_count > max_blocks || alignment == 0 ||
+        (alignment & (alignment - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t block_size = (config.block_size + alignment - 1) & ~(alignment - 1);
+    auto *base = static_cast<uint8_t *>(
+        heap_caps_aligned_alloc(alignment, block_size * config.block_count, caps_of(config.placement)));
+    /* The link table is hit on every allocate/deallocate; keep it in internal RAM
+     * even when the blocks themselves live in PSRAM. */
+    auto *next = static_cast<std::atomic<uint16_t> *>(heap_caps_malloc(
+        sizeof(std::atomic<uint16_t>) * config.block_count, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (base == nullptr || next == nullptr) {
+        heap_caps_free(base);
+        heap_caps_free(next);
+        ESP_LOGE(TAG, "%s: no %s memory for %u x %u bytes", config.name ? config.name : "pool",
+                 placement_name(config.placement), static_cast<unsigned>(config.block_count),
+                 static_cast<unsigned>(block_size));
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < config.block_count; ++i) {
+        uint16_t link = i + 1 < config.block_count ? static_cast<uint16_t>(i + 1) : nil;
+        new (&next[i]) std::atomic<uint16_t>(link);
+    }
+
+    base_ = base;
+    next_ = next;
+    block_size_ = block_size;
+    block_count_ = config.block_count;
+    alignment_ = alignment;
+    placement_ = config.placement;
+    name_ = config.name;
+    in_use_.store(0, std::memory_order_relaxed);
+    high_water_.store(0, std::memory_order_relaxed);
+    failures_.store(0, std::memory_order_relaxed);
+    fallbacks_.store(0, std::memory_order_relaxed);
+    head_.store(0, std::memory_order_release);
+
+    if (name_ != nullptr) {
+        register_source();
+    }
+    return ESP_OK;
+}
+
+void SlabPool::deinit()
+{
+    if (base_ == nullptr) {
+        return;
+    }
+#if CONFIG_MEM_POOL_STATS
+    uint32_t in_use = in_use_.load(std::memory_order_relaxed);
+    if (in_use != 0) {
+        ESP_LOGW(TAG, "%s: deinit with %u blocks still allocated", name_ ? name_ : "pool",
+                 static_cast<unsigned>(in_use));
+    }
+#endif
+    unregister_source();
+    head_.store(nil, std::memory_order_release);
+    heap_caps_free(base_);
+    heap_caps_free(next_);
+    base_ = nullptr;
+    next_ = nullptr;
+    block_size_ = 0;
+    block_count_ = 0;
+}
+
+Stats SlabPool::stats() const
+{
+    Stats s = {};
+    s.name = name_;
+    s.placement = placement_;
+    s.unit = block_size_;
+    s.capacity = block_count_;
+    s.in_use = in_use_.load(std::memory_order_relaxed);
+    s.high_water = high_water_.load(std::memory_order_relaxed);
+    s.failures = failures_.load(std::memory_order_relaxed);
+    s.fallbacks = fallbacks_.load(std::memory_order_relaxed);
+    return s;
+}
+
+void SlabPool::reset_high_water()
+{
+    high_water_.store(in_use_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+} // namespace mem_pool
@@ -0,0 +1,79 @@
+#include "mem_pool/stats.hpp"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "mem_pool";
+
+namespace mem_pool {
+
+namespace {
+
+StatsSource *s_sources = nullptr;
+portMUX_TYPE s_sources_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void log_one(const StatsSource &source, void *)
+{
+    Stats s = source.stats();
+    ESP_LOGI(TAG, "%-16s %-8s unit=%-5u cap=%-6u used=%-6u peak=%-6u fail=%u fallback=%u", s.name,
+             placement_name(s.placement), static_cast<unsigned>(s.unit), static_cast<unsigned>(s.capacity),
+             static_cast<unsigned>(s.in_use), static_cast<unsigned>(s.high_water),
+             static_cast<unsigned>(s.failures), static_cast<unsigned>(s.fallbacks));
+}
+
+} // namespace
+
+const char *placement_name(Placement placement)
+{
+    switch (placement) {
+    case Placement::Internal:
+        return "internal";
+    case Placement::Spiram:
+        return "spiram";
+    case Placement::Dma:
+        return "dma";
+    }
+    return "?";
+}
+
+void StatsSource::register_source()
+{
+    portENTER_CRITICAL(&s_sources_lock);
+    if (!registered_) {
+        next_source_ = s_sources;
+        s_sources = this;
+        registered_ = true;
+    }
+    portEXIT_CRITICAL(&s_sources_lock);
+}
+
+void StatsSource::unregister_source()
+{
+    portENTER_CRITICAL(&s_sources_lock);
+    if (registered_) {
+        for (StatsSource **link = &s_sources; *link != nullptr; link = &(*link)->next_source_) {
+            if (*link == this) {
+                *link = next_source_;
+                break;
+            }
+        }
+        registered_ = false;
+    }
+    portEXIT_CRITICAL(&s_sources_lock);
+}
+
+void for_each_source(void (*fn)(const StatsSource &source, void *ctx), void *ctx)
+{
+    /* Sources register at init time; walking without the lock is fine as long
+     * as pools are not torn down concurrently with a dump. */
+    for (StatsSource *s = s_sources; s != nullptr; s = s->next_source_) {
+        fn(*s, ctx);
+    }
+}
+
+void log_stats()
+{
+    for_each_source(log_one, nullptr);
+}
+
+} // namespace mem_pool
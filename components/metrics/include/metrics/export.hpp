@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "esp_err.h"
+#include "metrics/metrics.hpp"
+#include "mqtt_client/client.hpp"
+#include "telemetry_enc/output.hpp"
+
+namespace http_server {
+class Server;
+}
+
+namespace metrics {
+
+/**
+ * @brief Streams the registry in the Prometheus text exposition format (0.0.4).
+ *
+ * One HELP/TYPE pair per metric name, then a sample per label set;
+ * histograms get cumulative _bucket lines and _sum/_count. Each histogram
+ * is read once, before its first line, so its buckets and count agree.
+ * read() only hands out whole lines, like profiler::DumpReader.
+ */
+class PrometheusReader {
+public:
+    PrometheusReader() { rewind(); }
+
+    void rewind();
+
+    /** Copy the next lines into @p buf. @return bytes written, 0 once the text is complete. */
+    size_t read(char *buf, size_t capacity);
+
+private:
+    struct Position {
+        const Metric *metric;
+        const char *last_name;
+        uint16_t step;
+    };
+
+    size_t format_line(char *line, size_t capacity);
+    /** Read the current metric; false if it has nothing to export this time. */
+    bool sample();
+
+    Position at_;
+    int64_t value_;
+    uint64_t sum_;
+    /** Cumulative bucket counts of the histogram being written; the last is the count. */
+    uint64_t cumulative_[64];
+};
+
+/**
+ * @brief Serve the registry as text/plain on GET @p path, for a Prometheus scraper.
+ *
+ * Must be called before the server is started.
+ */
+esp_err_t add_http_route(http_server::Server &server, const char *path = "/metrics");
+
+/**
+ * @brief Encode every current value as CBOR.
+ *
+ * `[1, uptime_ms, [entry...]]`, where a counter or gauge is `[id, value]`
+ * and a histogram `[id, sum, [bucket...]]` with per-bucket (not cumulative)
+ * counts, +Inf last. Ids are Metric::id(); encode_schema() maps them back to
+ * names, so the periodic message carries numbers only.
+ */
+bool encode_snapshot(telemetry_enc::Output &out);
+
+/**
+ * @brief Encode the registry's description as CBOR.
+ *
+ * `[1, [[id, name, labels or null, type, help, bounds...]...]]`, with type
+ * 0 counter, 1 gauge, 2 histogram, and the upper bounds only for histograms.
+ * Never changes while the firmware runs.
+ */
+bool encode_schema(telemetry_enc::Output &out);
+
+/**
+ * @brief Publish encode_snapshot() to @p topic.
+ *
+ * The snapshot is encoded into a CONFIG_METRICS_SNAPSHOT_BUFFER_SIZE heap
+ * buffer first, because publish_with() may run its encoder twice and live
+ * values would differ between the runs.
+ * @return ESP_ERR_INVALID_SIZE if the snapshot does not fit that buffer.
+ */
+esp_err_t publish_snapshot(mqtt_client::Client &client, std::string_view topic,
+                           mqtt_client::Qos qos = mqtt_client::Qos::AtMostOnce);
+
+/** Publish encode_schema() to @p topic, retained, so late subscribers can decode snapshots. */
+esp_err_t publish_schema(mqtt_client::Client &client, std::string_view topic,
+                         mqtt_client::Qos qos = mqtt_client::Qos::AtLeastOnce);
+
+} // namespace metrics
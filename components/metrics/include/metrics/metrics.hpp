@@ -0,0 +1,294 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+
+namespace metrics {
+
+enum class Type : uint8_t {
+    Counter,
+    Gauge,
+    Histogram,
+};
+
+/** Per-core counters get lines of their own, so the cores never write the same line. */
+constexpr size_t line_size = 32;
+
+#define METRICS_INLINE __attribute__((always_inline)) inline
+
+namespace detail {
+
+constexpr uint32_t fnv1a(uint32_t hash, const char *s)
+{
+    for (; s != nullptr && *s != '\0'; ++s) {
+        hash = (hash ^ static_cast<uint8_t>(*s)) * 16777619u;
+    }
+    return hash;
+}
+
+/** Stable id of name{labels}, used by the binary snapshot instead of the strings. */
+constexpr uint32_t metric_id(const char *name, const char *labels)
+{
+    return fnv1a(fnv1a(2166136261u, name), labels);
+}
+
+METRICS_INLINE void add_wide(std::atomic<uint32_t> &lo, std::atomic<uint32_t> &hi, uint32_t value)
+{
+    uint32_t old = lo.fetch_add(value, std::memory_order_relaxed);
+    if (old + value < old) {
+        hi.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t load_wide(const std::atomic<uint32_t> &lo, const std::atomic<uint32_t> &hi);
+
+} // namespace detail
+
+/**
+ * @brief What every metric shares: its name, labels and place in the registry.
+ *
+ * Metrics are namespace-scope objects with constexpr constructors, so they
+ * are constant-initialized and usable before any constructor has run; the
+ * registry only lists them, see METRICS_REGISTER. @p labels is the inside
+ * of a Prometheus label set, e.g. `cap="internal"`, or nullptr. Names
+ * follow Prometheus conventions: a unit suffix, and _total for counters.
+ */
+class Metric {
+public:
+    Metric(const Metric &) = delete;
+    Metric &operator=(const Metric &) = delete;
+
+    const char *name() const { return name_; }
+    const char *help() const { return help_; }
+    const char *labels() const { return labels_; }
+    Type type() const { return type_; }
+    uint32_t id() const { return id_; }
+    /** A CallbackGauge rather than a Gauge; both have Type::Gauge. */
+    bool is_callback() const { return callback_; }
+
+    /** Registered metrics, sorted by name. */
+    static const Metric *first();
+    const Metric *next() const { return next_; }
+
+protected:
+    constexpr Metric(Type type, const char *name, const char *help, const char *labels, bool callback = false)
+        : name_(name), help_(help), labels_(labels), id_(detail::metric_id(name, labels)), type_(type),
+          callback_(callback)
+    {
+    }
+    ~Metric() = default;
+
+private:
+    friend class Registration;
+
+    const char *name_;
+    const char *help_;
+    const char *labels_;
+    Metric *next_ = nullptr;
+    uint32_t id_;
+    Type type_;
+    bool callback_;
+};
+
+/**
+ * @brief Monotonic 64-bit count, one slot per core.
+ *
+ * add() is a relaxed fetch_add on the calling core's slot, plus a second one
+ * when its low word wraps: no lock, no allocation, safe from ISRs. A task
+ * that migrates between reading the core id and the add still adds
+ * atomically, just into the other core's slot.
+ */
+class Counter : public Metric {
+public:
+    constexpr Counter(const char *name, const char *help, const char *labels = nullptr)
+        : Metric(Type::Counter, name, help, labels)
+    {
+    }
+
+    METRICS_INLINE void add(uint32_t n = 1)
+    {
+        Slot &s = cores_[esp_cpu_get_core_id()];
+        detail::add_wide(s.lo, s.hi, n);
+    }
+
+    /** Sum over the cores; may miss adds in flight. */
+    uint64_t value() const;
+
+private:
+    struct alignas(line_size) Slot {
+        std::atomic<uint32_t> lo{0};
+        std::atomic<uint32_t> hi{0};
+    };
+
+    Slot cores_[portNUM_PROCESSORS];
+};
+
+/** Signed level that goes up and down, such as a queue depth kept by its owner. */
+class Gauge : public Metric {
+public:
+    constexpr Gauge(const char *name, const char *help, const char *labels = nullptr)
+        : Metric(Type::Gauge, name, help, labels)
+    {
+    }
+
+    METRICS_INLINE void set(int32_t v) { value_.store(v, std::memory_order_relaxed); }
+    METRICS_INLINE void add(int32_t v) { value_.fetch_add(v, std::memory_order_relaxed); }
+    METRICS_INLINE void sub(int32_t v) { value_.fetch_sub(v, std::memory_order_relaxed); }
+
+    int32_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> value_{0};
+};
+
+/**
+ * @brief Gauge read from a function at export time, for values that already exist elsewhere.
+ *
+ * Heap free sizes, uxQueueMessagesWaiting(), RSSI: nothing is recorded on
+ * the hot path at all. @p read runs on the exporting task (the HTTP server
+ * or the caller of publish_snapshot()); returning false leaves the gauge
+ * out of that export, e.g. RSSI while disconnected.
+ */
+class CallbackGauge : public Metric {
+public:
+    using ReadFn = bool (*)(void *ctx, int64_t *value);
+
+    constexpr CallbackGauge(const char *name, const char *help, ReadFn read, void *ctx = nullptr,
+                            const char *labels = nullptr)
+        : Metric(Type::Gauge, name, help, labels, true), read_(read), ctx_(ctx)
+    {
+    }
+
+    bool read(int64_t *value) const { return read_(ctx_, value); }
+
+private:
+    ReadFn read_;
+    void *ctx_;
+};
+
+/** The Histogram<N> interface used by exporters. */
+class HistogramBase : public Metric {
+public:
+    /** Buckets including the final +Inf one. */
+    size_t bucket_count() const { return bound_count_ + 1; }
+
+    /** Upper bound of bucket @p i (inclusive); bucket bound_count() is +Inf. */
+    uint32_t upper_bound(size_t i) const { return bounds_[i]; }
+    size_t bound_count() const { return bound_count_; }
+
+    /** Samples in bucket @p i alone, summed over the cores. */
+    uint64_t bucket(size_t i) const;
+    uint64_t count() const;
+    uint64_t sum() const;
+
+protected:
+    constexpr HistogramBase(const char *name, const char *help, const char *labels, const uint32_t *bounds,
+                            size_t bound_count, std::atomic<uint32_t> *words, size_t stride)
+        : Metric(Type::Histogram, name, help, labels), bounds_(bounds), words_(words), bound_count_(bound_count),
+          stride_(stride)
+    {
+    }
+
+    /* Per core, stride_ words: bucket_count() 32-bit bucket counts, then the 64-bit sum as lo, hi. */
+    METRICS_INLINE void record(size_t bucket, uint32_t value)
+    {
+        std::atomic<uint32_t> *core = words_ + esp_cpu_get_core_id() * stride_;
+        core[bucket].fetch_add(1, std::memory_order_relaxed);
+        detail::add_wide(core[bound_count_ + 1], core[bound_count_ + 2], value);
+    }
+
+private:
+    const uint32_t *bounds_;
+    std::atomic<uint32_t> *words_;
+    size_t bound_count_;
+    size_t stride_;
+};
+
+/**
+ * @brief Fixed-bucket histogram of unsigned samples (latencies, sizes).
+ *
+ * The N upper bounds are set at compile time and must be ascending; a
+ * sample goes to the first bucket whose bound is >= it, or to +Inf.
+ * observe() is a scan over the bounds and two or three relaxed atomics on
+ * the calling core's counters.
+ *
+ *     constinit metrics::Histogram<6> handler_us{
+ *         "http_handler_duration_us", "Request handler time", {50, 100, 250, 500, 1000, 5000}};
+ *     METRICS_REGISTER(handler_us);
+ */
+template <size_t N>
+class Histogram : public HistogramBase {
+    static_assert(N > 0 && N < 64, "1..63 bucket bounds");
+
+public:
+    constexpr Histogram(const char *name, const char *help, const uint32_t (&bounds)[N], const char *labels = nullptr)
+        : HistogramBase(name, help, labels, bounds_, N, &words_[0][0], stride)
+    {
+        for (size_t i = 0; i < N; ++i) {
+            bounds_[i] = bounds[i];
+        }
+    }
+
+    METRICS_INLINE void observe(uint32_t value)
+    {
+        size_t i = 0;
+        while (i < N && value > bounds_[i]) {
+            ++i;
+        }
+        record(i, value);
+    }
+
+private:
+    /* Buckets, then the sum's two words, rounded up to whole lines. */
+    static constexpr size_t stride = (N + 3 + line_size / 4 - 1) / (line_size / 4) * (line_size / 4);
+
+    uint32_t bounds_[N] = {};
+    alignas(line_size) std::atomic<uint32_t> words_[portNUM_PROCESSORS][stride] = {};
+};
+
+/**
+ * @brief Times a scope into a histogram, in CPU cycles.
+ *
+ * Cycle counters are per core; pin the task, or accept the odd bogus
+ * sample after a migration.
+ *
+ *     metrics::CycleScope timed{handler_cycles};
+ */
+template <size_t N>
+class CycleScope {
+public:
+    METRICS_INLINE explicit CycleScope(Histogram<N> &histogram)
+        : histogram_(histogram), start_(esp_cpu_get_cycle_count())
+    {
+    }
+
+    METRICS_INLINE ~CycleScope() { histogram_.observe(esp_cpu_get_cycle_count() - start_); }
+
+    CycleScope(const CycleScope &) = delete;
+    CycleScope &operator=(const CycleScope &) = delete;
+
+private:
+    Histogram<N> &histogram_;
+    uint32_t start_;
+};
+
+/**
+ * @brief Links a metric into the registry; use through METRICS_REGISTER.
+ *
+ * Runs among the static constructors, before app_main() and before any
+ * exporter can walk the list, so the list itself needs no lock. Not for
+ * metrics created later (function-local statics, heap objects).
+ */
+class Registration {
+public:
+    explicit Registration(Metric &metric);
+};
+
+/** Register the metric @p var, defined at namespace scope in the same file, for export. */
+#define METRICS_REGISTER(var) static ::metrics::Registration metrics_registration_##var{var}
+
+} // namespace metrics
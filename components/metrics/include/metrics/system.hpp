@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+
+namespace metrics {
+
+/**
+ * @brief Count Wi-Fi station connects, disconnects and reconnect attempts.
+ *
+ * Fills wifi_sta_connects_total, wifi_sta_disconnects_total and
+ * wifi_sta_connect_attempts_total from the default event loop, which must
+ * exist already. The heap, uptime and RSSI gauges of CONFIG_METRICS_SYSTEM
+ * need no call; they are read at export time.
+ */
+esp_err_t track_wifi_events();
+
+/**
+ * @brief CallbackGauge::ReadFn for the depth of the FreeRTOS queue passed as ctx.
+ *
+ *     metrics::CallbackGauge rx_depth{"rx_queue_depth", "Frames waiting", metrics::read_queue_depth};
+ *
+ * with ctx set to the QueueHandle_t; the gauge must then be defined after
+ * the queue exists, or the handle stored in a variable the ctx points to.
+ * @see read_queue_depth_at
+ */
+bool read_queue_depth(void *queue, int64_t *value);
+
+/** Like read_queue_depth(), with ctx pointing to a QueueHandle_t that may still be null. */
+bool read_queue_depth_at(void *queue_handle, int64_t *value);
+
+} // namespace metrics
@@ -0,0 +1,169 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "metrics/export.hpp"
+
+namespace metrics {
+
+namespace {
+
+const char *type_name(Type type)
+{
+    switch (type) {
+    case Type::Counter:
+        return "counter";
+    case Type::Gauge:
+        return "gauge";
+    case Type::Histogram:
+        return "histogram";
+    }
+    return "untyped";
+}
+
+size_t clamp(int n, size_t capacity)
+{
+    if (n < 0) {
+        return 0;
+    }
+    return static_cast<size_t>(n) < capacity ? static_cast<size_t>(n) : capacity - 1;
+}
+
+/** name{labels}, plus an le="..." label for histogram buckets. */
+size_t format_series(char *line, size_t capacity, const Metric &m, const char *suffix, const char *le)
+{
+    const char *labels = m.labels() != nullptr ? m.labels() : "";
+    int n;
+    if (le != nullptr) {
+        n = snprintf(line, capacity, "%s%s{%s%sle=\"%s\"} ", m.name(), suffix, labels, *labels != '\0' ? "," : "",
+                     le);
+    } else if (*labels != '\0') {
+        n = snprintf(line, capacity, "%s%s{%s} ", m.name(), suffix, labels);
+    } else {
+        n = snprintf(line, capacity, "%s%s ", m.name(), suffix);
+    }
+    return clamp(n, capacity);
+}
+
+/* Steps of a metric: sample() and HELP, TYPE, then the sample lines. */
+constexpr uint16_t first_sample = 2;
+
+} // namespace
+
+void PrometheusReader::rewind()
+{
+    at_.metric = Metric::first();
+    at_.last_name = nullptr;
+    at_.step = 0;
+}
+
+bool PrometheusReader::sample()
+{
+    const Metric &m = *at_.metric;
+    switch (m.type()) {
+    case Type::Counter:
+        value_ = static_cast<int64_t>(static_cast<const Counter &>(m).value());
+        return true;
+    case Type::Gauge:
+        if (m.is_callback()) {
+            return static_cast<const CallbackGauge &>(m).read(&value_);
+        }
+        value_ = static_cast<const Gauge &>(m).value();
+        return true;
+    case Type::Histogram: {
+        const auto &h = static_cast<const HistogramBase &>(m);
+        uint64_t total = 0;
+        for (size_t i = 0; i < h.bucket_count(); ++i) {
+            total += h.bucket(i);
+            cumulative_[i] = total;
+        }
+        sum_ = h.sum();
+        return true;
+    }
+    }
+    return false;
+}
+
+size_t PrometheusReader::format_line(char *line, size_t capacity)
+{
+    const Metric &m = *at_.metric;
+    uint16_t step = at_.step++;
+    if (step == 0) {
+        if (!sample()) {
+            at_.metric = m.next();
+            at_.step = 0;
+            return 0;
+        }
+        if (at_.last_name != nullptr && strcmp(at_.last_name, m.name()) == 0) {
+            /* Another label set of the name just described. */
+            at_.step = first_sample;
+            return 0;
+        }
+        at_.last_name = m.name();
+        return clamp(snprintf(line, capacity, "# HELP %s %s\n", m.name(), m.help()), capacity);
+    }
+    if (step == 1) {
+        return clamp(snprintf(line, capacity, "# TYPE %s %s\n", m.name(), type_name(m.type())), capacity);
+    }
+
+    size_t len;
+    int n;
+    if (m.type() != Type::Histogram) {
+        len = format_series(line, capacity, m, "", nullptr);
+        n = m.type() == Type::Counter
+                ? snprintf(line + len, capacity - len, "%" PRIu64 "\n", static_cast<uint64_t>(value_))
+                : snprintf(line + len, capacity - len, "%" PRId64 "\n", value_);
+        at_.metric = m.next();
+        at_.step = 0;
+        return len + clamp(n, capacity - len);
+    }
+
+    const auto &h = static_cast<const HistogramBase &>(m);
+    size_t bucket = step - first_sample;
+    if (bucket < h.bucket_count()) {
+        char le[12];
+        if (bucket < h.bound_count()) {
+            snprintf(le, sizeof(le), "%" PRIu32, h.upper_bound(bucket));
+        } else {
+            strcpy(le, "+Inf");
+        }
+        len = format_series(line, capacity, m, "_bucket", le);
+        n = snprintf(line + len, capacity - len, "%" PRIu64 "\n", cumulative_[bucket]);
+    } else if (bucket == h.bucket_count()) {
+        len = format_series(line, capacity, m, "_sum", nullptr);
+        n = snprintf(line + len, capacity - len, "%" PRIu64 "\n", sum_);
+    } else {
+        len = format_series(line, capacity, m, "_count", nullptr);
+        n = snprintf(line + len, capacity - len, "%" PRIu64 "\n", cumulative_[h.bound_count()]);
+        at_.metric = m.next();
+        at_.step = 0;
+    }
+    return len + clamp(n, capacity - len);
+}
+
+size_t PrometheusReader::read(char *buf, size_t capacity)
+{
+    /* Longest line: HELP with a long name and help text. */
+    char line[384];
+    size_t used = 0;
+    while (at_.metric != nullptr) {
+        Position at = at_;
+        size_t len = format_line(line, sizeof(line));
+        if (used + len > capacity) {
+            if (used == 0 && capacity != 0) {
+                /* A line longer than the caller's buffer: send it cut short. */
+                len = capacity;
+                line[len - 1] = '\n';
+            } else {
+                /* Format it again on the next call. */
+                at_ = at;
+                break;
+            }
+        }
+        memcpy(buf + used, line, len);
+        used += len;
+    }
+    return used;
+}
+
+} // namespace metrics
@@ -0,0 +1,83 @@
+#include <cstring>
+
+#include "metrics/metrics.hpp"
+
+namespace metrics {
+
+namespace {
+
+Metric *head = nullptr;
+
+} // namespace
+
+namespace detail {
+
+uint64_t load_wide(const std::atomic<uint32_t> &lo, const std::atomic<uint32_t> &hi)
+{
+    /* Re-read hi around lo so a carry between the two loads is not lost. */
+    uint32_t h;
+    uint32_t l;
+    do {
+        h = hi.load(std::memory_order_relaxed);
+        l = lo.load(std::memory_order_relaxed);
+    } while (hi.load(std::memory_order_relaxed) != h);
+    return uint64_t{h} << 32 | l;
+}
+
+} // namespace detail
+
+Registration::Registration(Metric &metric)
+{
+    /* Sorted by name so the exporters can group label sets under one HELP;
+     * equal names keep registration order. */
+    Metric **link = &head;
+    while (*link != nullptr && strcmp((*link)->name(), metric.name()) <= 0) {
+        link = &(*link)->next_;
+    }
+    metric.next_ = *link;
+    *link = &metric;
+}
+
+const Metric *Metric::first()
+{
+    return head;
+}
+
+uint64_t Counter::value() const
+{
+    uint64_t total = 0;
+    for (const Slot &s : cores_) {
+        total += detail::load_wide(s.lo, s.hi);
+    }
+    return total;
+}
+
+uint64_t HistogramBase::bucket(size_t i) const
+{
+    uint64_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        total += words_[core * stride_ + i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t HistogramBase::count() const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < bucket_count(); ++i) {
+        total += bucket(i);
+    }
+    return total;
+}
+
+uint64_t HistogramBase::sum() const
+{
+    uint64_t total = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+        const std::atomic<uint32_t> *w = words_ + core * stride_;
+        total += detail::load_wide(w[bound_count_ + 1], w[bound_count_ + 2]);
+    }
+    return total;
+}
+
+} // namespace metrics
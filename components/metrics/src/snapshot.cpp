@@ -0,0 +1,118 @@
+#include "metrics/export.hpp"
+
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "telemetry_enc/cbor_writer.hpp"
+
+namespace metrics {
+
+namespace {
+
+constexpr uint8_t format_version = 1;
+
+} // namespace
+
+bool encode_snapshot(telemetry_enc::Output &out)
+{
+    telemetry_enc::CborWriter w(out);
+    w.begin_array(3);
+    w.value(format_version);
+    w.value(esp_timer_get_time() / 1000);
+    /* Callback gauges may have nothing to report, so the count is not known up front. */
+    w.begin_array();
+    for (const Metric *m = Metric::first(); m != nullptr; m = m->next()) {
+        switch (m->type()) {
+        case Type::Counter:
+            w.begin_array(2);
+            w.value(m->id());
+            w.value(static_cast<const Counter *>(m)->value());
+            w.end_array();
+            break;
+        case Type::Gauge: {
+            int64_t v;
+            if (m->is_callback()) {
+                if (!static_cast<const CallbackGauge *>(m)->read(&v)) {
+                    break;
+                }
+            } else {
+                v = static_cast<const Gauge *>(m)->value();
+            }
+            w.begin_array(2);
+            w.value(m->id());
+            w.value(v);
+            w.end_array();
+            break;
+        }
+        case Type::Histogram: {
+            const auto *h = static_cast<const HistogramBase *>(m);
+            w.begin_array(3);
+            w.value(m->id());
+            w.value(h->sum());
+            w.begin_array(h->bucket_count());
+            for (size_t i = 0; i < h->bucket_count(); ++i) {
+                w.value(h->bucket(i));
+            }
+            w.end_array();
+            w.end_array();
+            break;
+        }
+        }
+    }
+    w.end_array();
+    w.end_array();
+    return w.ok();
+}
+
+bool encode_schema(telemetry_enc::Output &out)
+{
+    telemetry_enc::CborWriter w(out);
+    size_t count = 0;
+    for (const Metric *m = Metric::first(); m != nullptr; m = m->next()) {
+        ++count;
+    }
+    w.begin_array(2);
+    w.value(format_version);
+    w.begin_array(count);
+    for (const Metric *m = Metric::first(); m != nullptr; m = m->next()) {
+        const auto *h = m->type() == Type::Histogram ? static_cast<const HistogramBase *>(m) : nullptr;
+        w.begin_array(5 + (h != nullptr ? h->bound_count() : 0));
+        w.value(m->id());
+        w.value(m->name());
+        if (m->labels() != nullptr) {
+            w.value(m->labels());
+        } else {
+            w.null();
+        }
+        w.value(static_cast<uint8_t>(m->type()));
+        w.value(m->help());
+        for (size_t i = 0; h != nullptr && i < h->bound_count(); ++i) {
+            w.value(h->upper_bound(i));
+        }
+        w.end_array();
+    }
+    w.end_array();
+    w.end_array();
+    return w.ok();
+}
+
+esp_err_t publish_snapshot(mqtt_client::Client &client, std::string_view topic, mqtt_client::Qos qos)
+{
+    void *buffer = heap_caps_malloc(CONFIG_METRICS_SNAPSHOT_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (buffer == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_enc::BufferOutput out(buffer, CONFIG_METRICS_SNAPSHOT_BUFFER_SIZE);
+    esp_err_t err = encode_snapshot(out) ? client.publish(topic, buffer, out.size(), qos) : ESP_ERR_INVALID_SIZE;
+    heap_caps_free(buffer);
+    return err;
+}
+
+esp_err_t publish_schema(mqtt_client::Client &client, std::string_view topic, mqtt_client::Qos qos)
+{
+    /* The schema never changes, so publish_with() may safely encode it twice. */
+    return client.publish_with(
+        topic, qos, [](telemetry_enc::Output &out) { encode_schema(out); }, true);
+}
+
+} // namespace metrics
@@ -0,0 +1,129 @@
+#include "metrics/system.hpp"
+
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "metrics/metrics.hpp"
+#include "sdkconfig.h"
+
+namespace metrics {
+
+namespace {
+
+Counter wifi_connects{"wifi_sta_connects_total", "Wi-Fi station associations"};
+METRICS_REGISTER(wifi_connects);
+Counter wifi_disconnects{"wifi_sta_disconnects_total", "Wi-Fi station disconnects, including failed attempts"};
+METRICS_REGISTER(wifi_disconnects);
+Counter wifi_attempts{"wifi_sta_connect_attempts_total", "esp_wifi_connect() calls (STA_START and retries)"};
+METRICS_REGISTER(wifi_attempts);
+
+void on_wifi_event(void *, esp_event_base_t, int32_t id, void *)
+{
+    switch (id) {
+    case WIFI_EVENT_STA_START:
+        wifi_attempts.add();
+        break;
+    case WIFI_EVENT_STA_CONNECTED:
+        wifi_connects.add();
+        break;
+    case WIFI_EVENT_STA_DISCONNECTED:
+        /* Every disconnect is followed by a reconnect attempt in the usual
+         * station loop, so count both here rather than wrapping esp_wifi_connect(). */
+        wifi_disconnects.add();
+        wifi_attempts.add();
+        break;
+    default:
+        break;
+    }
+}
+
+#if CONFIG_METRICS_SYSTEM
+
+/* ctx carries the MALLOC_CAP_* mask. */
+bool read_heap_free(void *caps, int64_t *value)
+{
+    *value = heap_caps_get_free_size(reinterpret_cast<uintptr_t>(caps));
+    return true;
+}
+
+bool read_heap_minimum_free(void *caps, int64_t *value)
+{
+    *value = heap_caps_get_minimum_free_size(reinterpret_cast<uintptr_t>(caps));
+    return true;
+}
+
+bool read_heap_largest_block(void *caps, int64_t *value)
+{
+    *value = heap_caps_get_largest_free_block(reinterpret_cast<uintptr_t>(caps));
+    return true;
+}
+
+bool read_uptime(void *, int64_t *value)
+{
+    *value = esp_timer_get_time() / 1000000;
+    return true;
+}
+
+bool read_rssi(void *, int64_t *value)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return false;
+    }
+    *value = ap.rssi;
+    return true;
+}
+
+#define METRICS_HEAP_GAUGES(tag, caps)                                                                                 \
+    CallbackGauge heap_free_##tag{"heap_free_bytes", "Free heap by capability", read_heap_free,                      \
+                                  reinterpret_cast<void *>(uintptr_t{caps}), "caps=\"" #tag "\""};                    \
+    METRICS_REGISTER(heap_free_##tag);                                                                                 \
+    CallbackGauge heap_minimum_free_##tag{"heap_minimum_free_bytes", "Lowest free heap since boot by capability",    \
+                                          read_heap_minimum_free, reinterpret_cast<void *>(uintptr_t{caps}),         \
+                                          "caps=\"" #tag "\""};                                                        \
+    METRICS_REGISTER(heap_minimum_free_##tag);                                                                         \
+    CallbackGauge heap_largest_block_##tag{"heap_largest_free_block_bytes", "Largest allocatable block by capability", \
+                                           read_heap_largest_block, reinterpret_cast<void *>(uintptr_t{caps}),       \
+                                           "caps=\"" #tag "\""};                                                       \
+    METRICS_REGISTER(heap_largest_block_##tag)
+
+METRICS_HEAP_GAUGES(internal, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+METRICS_HEAP_GAUGES(dma, MALLOC_CAP_DMA);
+#if CONFIG_SPIRAM
+METRICS_HEAP_GAUGES(spiram, MALLOC_CAP_SPIRAM);
+#endif
+
+CallbackGauge uptime{"uptime_seconds", "Time since boot", read_uptime};
+METRICS_REGISTER(uptime);
+CallbackGauge rssi{"wifi_sta_rssi_dbm", "Signal strength of the associated AP", read_rssi};
+METRICS_REGISTER(rssi);
+
+#endif
+
+} // namespace
+
+esp_err_t track_wifi_events()
+{
+    return esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, on_wifi_event, nullptr);
+}
+
+bool read_queue_depth(void *queue, int64_t *value)
+{
+    *value = uxQueueMessagesWaiting(static_cast<QueueHandle_t>(queue));
+    return true;
+}
+
+bool read_queue_depth_at(void *queue_handle, int64_t *value)
+{
+    QueueHandle_t queue = *static_cast<QueueHandle_t *>(queue_handle);
+    if (queue == nullptr) {
+        return false;
+    }
+    *value = uxQueueMessagesWaiting(queue);
+    return true;
+}
+
+} // namespace metrics
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mqtt_client/transport.hpp"
+#include "telemetry_enc/output.hpp"
+
+namespace mqtt_client {
+
+enum class Qos : uint8_t {
+    AtMostOnce = 0,
+    AtLeastOnce = 1,
+};
+
+struct ClientStats {
+    /** Messages accepted by publish(). */
+    uint32_t published;
+    /** publish() calls refused because the TX buffer or the slot table was full. */
+    uint32_t rejected;
+    uint32_t acked;
+    /** QoS1 messages resent with DUP after a reconnect. */
+    uint32_t retransmitted;
+    /** writev() calls that carried data; published / batches is the coalescing factor. */
+    uint32_t batches;
+    uint32_t tx_bytes;
+    uint32_t connects;
+    /** QoS1 messages sent and not yet acknowledged. */
+    uint32_t in_flight;
+    /** TX buffer bytes held by queued and unacknowledged messages. */
+    uint32_t queued_bytes;
+};
+
+/**
+ * @brief Publish-only MQTT 3.1.1 client that batches and pipelines.
+ *
+ * publish() builds the complete PUBLISH packet in place in a TX ring and
+ * returns; a client task sends runs of queued packets with one writev(),
+ * once Config::batch_bytes have accumulated or the oldest has waited
+ * Config::linger_ms, so a burst of small messages leaves as a handful of
+ * full segments instead of one segment per message. QoS1 messages are not
+ * waited on one by one: up to Config::window of them are in flight at once,
+ * each kept in the ring until its PUBACK arrives and resent with DUP set
+ * after a reconnect.
+ *
+ * publish_with() hands the caller a telemetry_enc::Output positioned on the
+ * packet's payload bytes in the ring, so a JsonWriter or CborWriter encodes
+ * straight into the buffer that is handed to the socket.
+ *
+ * Publishing never blocks on the network; when the ring is full publish()
+ * fails with ESP_ERR_NO_MEM and the caller decides what to drop.
+ */
+class Client {
+public:
+    struct Config {
+        const char *host = nullptr;
+        uint16_t port = 1883;
+        const char *client_id = "esp32";
+        const char *username = nullptr;
+        const char *password = nullptr;
+        uint16_t keepalive_s = 60;
+        bool clean_session = true;
+        /** Stream to use; nullptr runs over an internal TcpTransport. Must outlive the client. */
+        Transport *transport = nullptr;
+        /** TX ring holding queued packets and QoS1 packets awaiting PUBACK. */
+        size_t tx_buffer_size = 8192;
+        /** Most packets queued or awaiting PUBACK at once; a power of two. */
+        size_t max_queued = 64;
+        /** Most QoS1 packets sent and not yet acknowledged. */
+        uint16_t window = 16;
+        /** Send as soon as this much is queued; about one MSS. */
+        size_t batch_bytes = 1400;
+        /** Longest a queued packet waits for others to join its batch. */
+        uint32_t linger_ms = 5;
+        uint32_t connect_timeout_ms = 10000;
+        /** First reconnect delay; doubles on each failure up to 32x. */
+        uint32_t reconnect_ms = 1000;
+        const char *task_name = "mqtt_client";
+        uint32_t stack_size = 4096;
+        UBaseType_t priority = 5;
+        BaseType_t core = tskNO_AFFINITY;
+    };
+
+    Client() = default;
+    ~Client() { deinit(); }
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    /** Allocate the ring and start the client task, which connects in the background. */
+    esp_err_t init(const Config &config);
+
+    /** Send DISCONNECT if connected and stop the task. Unsent messages are dropped. */
+    void deinit();
+
+    /** CONNACK received and the session is up. */
+    bool connected() const { return connected_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Queue one PUBLISH with a payload copied from @p payload.
+     *
+     * Callable from any task, connected or not: messages queued while the
+     * connection is down go out after the next CONNACK.
+     * @return ESP_ERR_NO_MEM if the ring is full, ESP_ERR_INVALID_SIZE if
+     * the packet can never fit.
+     */
+    esp_err_t publish(std::string_view topic, const void *payload, size_t len, Qos qos = Qos::AtMostOnce,
+                      bool retain = false);
+
+    /**
+     * @brief Queue one PUBLISH whose payload @p encode writes into the ring.
+     *
+     * @p encode is called as encode(telemetry_enc::Output &) with the client
+     * lock held, so it must not call back into the client. If the payload
+     * does not fit in the contiguous space at the end of the ring it is
+     * called a second time at the start, so it must encode the same bytes
+     * each time it is called.
+     */
+    template <typename F>
+    esp_err_t publish_with(std::string_view topic, Qos qos, F &&encode, bool retain = false)
+    {
+        Reservation r;
+        esp_err_t err = begin_publish(topic, qos, retain, &r);
+        while (err == ESP_OK) {
+            telemetry_enc::BufferOutput out(r.payload, r.capacity);
+            encode(static_cast<telemetry_enc::Output &>(out));
+            if (!out.overflowed()) {
+                return commit_publish(r, out.size());
+            }
+            err = retry_publish(&r);
+        }
+        return err;
+    }
+
+    /** Send whatever is queued now instead of waiting out the linger time. */
+    void flush();
+
+    ClientStats stats() const;
+
+private:
+    enum class SlotState : uint8_t {
+        Queued,
+        /** QoS1, written to the socket, waiting for PUBACK. */
+        Sent,
+        /** Nothing left to do; freed once every older slot is done too. */
+        Done,
+    };
+
+    /* One packet in the ring. Its region starts with room for the longest
+     * fixed header; the unused part is skipped when sending. */
+    struct Slot {
+        uint32_t offset;
+        uint32_t len;
+        uint16_t packet_id;
+        uint8_t skip;
+        SlotState state;
+    };
+
+    /* A region claimed by begin_publish(), with the lock held until commit. */
+    struct Reservation {
+        std::string_view topic;
+        uint32_t offset;
+        uint32_t region;
+        uint8_t *payload;
+        size_t capacity;
+        uint16_t packet_id;
+        uint8_t flags;
+        bool wrapped;
+    };
+
+    esp_err_t begin_publish(std::string_view topic, Qos qos, bool retain, Reservation *r);
+    esp_err_t place(Reservation *r, bool retry);
+    esp_err_t retry_publish(Reservation *r);
+    esp_err_t commit_publish(const Reservation &r, size_t payload_len);
+
+    static void client_task(void *arg);
+    void run();
+    bool open_session();
+    void close_session();
+    bool service(int64_t now);
+    bool read_input(int64_t now);
+    void discard_input(const uint8_t *bytes, size_t len);
+    bool handle_packet(uint8_t type, const uint8_t *body, size_t len);
+    void on_session_up();
+    bool send_pending(int64_t now);
+    int64_t next_deadline(int64_t now);
+    void add_control(const uint8_t *bytes, size_t len);
+    void release_done();
+    void wake();
+    void wait(uint32_t ms);
+
+    Slot &slot(uint32_t index) { return slots_[index % config_.max_queued]; }
+
+    Config config_;
+    TcpTransport tcp_;
+    Transport *transport_ = nullptr;
+    TaskHandle_t task_ = nullptr;
+    SemaphoreHandle_t lock_ = nullptr;
+    /* Wakes the client task out of select(). */
+    int event_fd_ = -1;
+
+    /* Everything below up to the RX state is guarded by lock_. */
+    uint8_t *ring_ = nullptr;
+    Slot *slots_ = nullptr;
+    /* Free-running slot indices: tail <= send <= head. */
+    uint32_t tail_ = 0;
+    uint32_t send_ = 0;
+    uint32_t head_ = 0;
+    /* Ring offset where the next packet goes. */
+    uint32_t write_ = 0;
+    /* Bytes of slot send_ already written to the socket. */
+    uint32_t send_offset_ = 0;
+    uint32_t unsent_bytes_ = 0;
+    int64_t first_unsent_us_ = 0;
+    uint16_t next_packet_id_ = 1;
+    bool flush_requested_ = false;
+
+    /* Client task only. */
+    uint8_t control_[32];
+    size_t control_len_ = 0;
+    uint8_t rx_[64];
+    size_t rx_len_ = 0;
+    /* Bytes of an oversized incoming packet still to be discarded. */
+    size_t rx_discard_ = 0;
+    /* For an oversized QoS 1/2 PUBLISH: the ack it is owed (0 for none), where
+     * its packet id sits, how much of it has been discarded, and the id. */
+    uint8_t rx_skip_ack_ = 0;
+    size_t rx_skip_id_at_ = 0;
+    size_t rx_skip_seen_ = 0;
+    uint8_t rx_skip_id_[2] = {};
+    int64_t last_rx_us_ = 0;
+    int64_t last_tx_us_ = 0;
+    bool awaiting_connack_ = false;
+    bool ping_outstanding_ = false;
+    bool want_write_ = false;
+    /* Last send stopped at a QoS1 packet because the window was full. */
+    bool window_full_ = false;
+    uint32_t backoff_ms_ = 0;
+
+    std::atomic<bool> connected_{false};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> running_{false};
+
+    std::atomic<uint32_t> published_{0};
+    std::atomic<uint32_t> rejected_{0};
+    std::atomic<uint32_t> acked_{0};
+    std::atomic<uint32_t> retransmitted_{0};
+    std::atomic<uint32_t> batches_{0};
+    std::atomic<uint32_t> tx_bytes_{0};
+    std::atomic<uint32_t> connects_{0};
+    std::atomic<uint32_t> in_flight_{0};
+};
+
+} // namespace mqtt_client
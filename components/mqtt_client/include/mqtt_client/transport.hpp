@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+struct iovec;
+
+namespace mqtt_client {
+
+/**
+ * @brief Byte stream the client runs MQTT over.
+ *
+ * The client task is the only caller. After connect_to() the stream must
+ * be non-blocking: write_some() and read_some() return 0 instead of
+ * waiting, and the client select()s on fd() until it can make progress.
+ * (The names stay clear of the socket calls lwIP may define as macros.)
+ */
+class Transport {
+public:
+    /** Blocking connect, bounded by @p timeout_ms. */
+    virtual esp_err_t connect_to(const char *host, uint16_t port, uint32_t timeout_ms) = 0;
+
+    virtual void disconnect() = 0;
+
+    /** Descriptor to select() on, or -1 when closed. */
+    virtual int fd() const = 0;
+
+    /**
+     * @brief Write as much of @p iov as fits without blocking.
+     *
+     * One call should become as few TCP segments as possible, which is the
+     * whole point of batching. @return bytes written, 0 if nothing fit, -1 on
+     * error.
+     */
+    virtual int write_some(const struct iovec *iov, int count) = 0;
+
+    /** @return bytes read, 0 if nothing is available, -1 on error or EOF. */
+    virtual int read_some(void *buf, size_t len) = 0;
+
+    /** Bytes the transport has buffered that select() on fd() would not report (TLS records). */
+    virtual size_t pending() const { return 0; }
+
+    /**
+     * @brief Accepted bytes not yet on the wire (a TLS record half written).
+     *
+     * While true the client waits for fd() to become writable and calls
+     * write_some(nullptr, 0) to push them out before writing anything new.
+     */
+    virtual bool write_pending() const { return false; }
+
+protected:
+    ~Transport() = default;
+};
+
+/** Plain TCP with Nagle disabled: the client already coalesces, so waiting for ACKs only adds latency. */
+class TcpTransport : public Transport {
+public:
+    TcpTransport() = default;
+    ~TcpTransport() { disconnect(); }
+
+    TcpTransport(const TcpTransport &) = delete;
+    TcpTransport &operator=(const TcpTransport &) = delete;
+
+    esp_err_t connect_to(const char *host, uint16_t port, uint32_t timeout_ms) override;
+    void disconnect() override;
+    int fd() const override { return fd_; }
+    int write_some(const struct iovec *iov, int count) override;
+    int read_some(void *buf, size_t len) override;
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace mqtt_client
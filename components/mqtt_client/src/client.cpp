@@ -0,0 +1,828 @@
+#include "mqtt_client/client.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_vfs_eventfd.h"
+#include "lwip/sockets.h"
+#include "packet.hpp"
+
+static const char *TAG = "mqtt_client";
+
+namespace mqtt_client {
+
+using namespace detail;
+
+namespace {
+
+/* iovecs per writev(): one per packet, so this bounds a batch's packet count. */
+constexpr int max_iov = 16;
+
+} // namespace
+
+esp_err_t Client::init(const Config &config)
+{
+    if (task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.host == nullptr || config.client_id == nullptr || config.window == 0 || config.max_queued < 2 ||
+        (config.max_queued & (config.max_queued - 1)) != 0 || config.tx_buffer_size < 128) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+    transport_ = config.transport != nullptr ? config.transport : &tcp_;
+
+    lock_ = xSemaphoreCreateMutex();
+    ring_ = static_cast<uint8_t *>(heap_caps_malloc(config.tx_buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    slots_ = static_cast<Slot *>(heap_caps_malloc(config.max_queued * sizeof(Slot), MALLOC_CAP_INTERNAL));
+    if (lock_ == nullptr || ring_ == nullptr || slots_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_vfs_eventfd_config_t eventfd_config = {};
+    eventfd_config.max_fds = 5;
+    esp_err_t err = esp_vfs_eventfd_register(&eventfd_config);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        deinit();
+        return err;
+    }
+    event_fd_ = eventfd(0, 0);
+    if (event_fd_ < 0) {
+        ESP_LOGE(TAG, "eventfd failed: errno %d", errno);
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    tail_ = send_ = head_ = 0;
+    write_ = send_offset_ = unsent_bytes_ = 0;
+    flush_requested_ = false;
+    backoff_ms_ = config.reconnect_ms;
+    stopping_.store(false, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(client_task, config.task_name, config.stack_size, this, config.priority, &task_,
+                                config.core) != pdPASS) {
+        running_.store(false, std::memory_order_relaxed);
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void Client::deinit()
+{
+    stopping_.store(true, std::memory_order_seq_cst);
+    wake();
+    while (running_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    if (event_fd_ >= 0) {
+        close(event_fd_);
+        event_fd_ = -1;
+    }
+    heap_caps_free(ring_);
+    ring_ = nullptr;
+    heap_caps_free(slots_);
+    slots_ = nullptr;
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+}
+
+esp_err_t Client::publish(std::string_view topic, const void *payload, size_t len, Qos qos, bool retain)
+{
+    if (len > config_.tx_buffer_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return publish_with(
+        topic, qos, [payload, len](telemetry_enc::Output &out) { out.write(payload, len); }, retain);
+}
+
+esp_err_t Client::begin_publish(std::string_view topic, Qos qos, bool retain, Reservation *r)
+{
+    if (ring_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (topic.empty() || topic.size() > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    if (head_ - tail_ >= config_.max_queued) {
+        xSemaphoreGive(lock_);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+    r->topic = topic;
+    r->flags = type_publish | (static_cast<uint8_t>(qos) << 1) | (retain ? 1 : 0);
+    r->packet_id = 0;
+    if (qos != Qos::AtMostOnce) {
+        r->packet_id = next_packet_id_++;
+        if (next_packet_id_ == 0) {
+            next_packet_id_ = 1;
+        }
+    }
+    r->wrapped = false;
+    esp_err_t err = place(r, false);
+    if (err != ESP_OK) {
+        if (head_ == tail_) {
+            err = ESP_ERR_INVALID_SIZE;
+        }
+        xSemaphoreGive(lock_);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return err;
+}
+
+/*
+ * Find contiguous room for a packet and write its topic and packet id.
+ * The free space is [write_, end) plus, when the live data does not wrap,
+ * [0, tail). A first attempt takes the space after write_ unless that cannot
+ * even hold the header; a retry (the payload overflowed) moves to the start
+ * if that region is larger.
+ */
+esp_err_t Client::place(Reservation *r, bool retry)
+{
+    size_t header = max_fixed_header + 2 + r->topic.size() + (r->packet_id != 0 ? 2 : 0);
+    uint32_t cap = static_cast<uint32_t>(config_.tx_buffer_size);
+    uint32_t a_start = 0;
+    uint32_t a_end = 0;
+    uint32_t b_end = 0;
+    if (head_ == tail_) {
+        write_ = 0;
+        a_end = cap;
+    } else {
+        uint32_t tail = slot(tail_).offset;
+        a_start = write_;
+        if (write_ > tail) {
+            a_end = cap;
+            b_end = tail;
+        } else {
+            a_end = tail;
+        }
+    }
+    uint32_t a_size = a_end - a_start;
+    bool at_start;
+    if (!retry) {
+        at_start = a_size <= header && b_end > header;
+    } else {
+        if (r->wrapped || b_end <= a_size) {
+            return ESP_ERR_NO_MEM;
+        }
+        at_start = true;
+    }
+    uint32_t start = at_start ? 0 : a_start;
+    uint32_t end = at_start ? b_end : a_end;
+    if (end - start <= header) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint8_t *p = ring_ + start + max_fixed_header;
+    p = put_string(p, r->topic);
+    if (r->packet_id != 0) {
+        p = put_u16(p, r->packet_id);
+    }
+    r->offset = start;
+    r->region = end - start;
+    r->payload = p;
+    r->capacity = r->region - header;
+    r->wrapped = at_start;
+    return ESP_OK;
+}
+
+esp_err_t Client::retry_publish(Reservation *r)
+{
+    esp_err_t err = place(r, true);
+    if (err != ESP_OK) {
+        if (head_ == tail_) {
+            err = ESP_ERR_INVALID_SIZE;
+        }
+        xSemaphoreGive(lock_);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return err;
+}
+
+esp_err_t Client::commit_publish(const Reservation &r, size_t payload_len)
+{
+    auto remaining = static_cast<uint32_t>(2 + r.topic.size() + (r.packet_id != 0 ? 2 : 0) + payload_len);
+    auto skip = static_cast<uint8_t>(max_fixed_header - 1 - varint_size(remaining));
+    uint8_t *p = ring_ + r.offset + skip;
+    p[0] = r.flags;
+    put_varint(p + 1, remaining);
+
+    Slot &s = slot(head_);
+    s.offset = r.offset;
+    s.len = static_cast<uint32_t>(max_fixed_header) + remaining;
+    s.packet_id = r.packet_id;
+    s.skip = skip;
+    s.state = SlotState::Queued;
+    write_ = s.offset + s.len;
+    ++head_;
+
+    uint32_t before = unsent_bytes_;
+    unsent_bytes_ += s.len - skip;
+    if (before == 0) {
+        first_unsent_us_ = esp_timer_get_time();
+    }
+    /* The task only needs waking to start the linger clock or to send a full batch. */
+    bool kick = before == 0 || (before < config_.batch_bytes && unsent_bytes_ >= config_.batch_bytes);
+    xSemaphoreGive(lock_);
+
+    published_.fetch_add(1, std::memory_order_relaxed);
+    if (kick) {
+        wake();
+    }
+    return ESP_OK;
+}
+
+void Client::flush()
+{
+    if (lock_ == nullptr) {
+        return;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    flush_requested_ = unsent_bytes_ != 0;
+    xSemaphoreGive(lock_);
+    wake();
+}
+
+ClientStats Client::stats() const
+{
+    ClientStats s = {};
+    s.published = published_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.acked = acked_.load(std::memory_order_relaxed);
+    s.retransmitted = retransmitted_.load(std::memory_order_relaxed);
+    s.batches = batches_.load(std::memory_order_relaxed);
+    s.tx_bytes = tx_bytes_.load(std::memory_order_relaxed);
+    s.connects = connects_.load(std::memory_order_relaxed);
+    s.in_flight = in_flight_.load(std::memory_order_relaxed);
+    if (lock_ != nullptr) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        for (uint32_t i = tail_; i != head_; ++i) {
+            s.queued_bytes += slots_[i % config_.max_queued].len;
+        }
+        xSemaphoreGive(lock_);
+    }
+    return s;
+}
+
+void Client::client_task(void *arg)
+{
+    static_cast<Client *>(arg)->run();
+}
+
+void Client::run()
+{
+    while (!stopping_.load(std::memory_order_acquire)) {
+        bool ok = transport_->fd() >= 0 || open_session();
+        while (ok && !stopping_.load(std::memory_order_acquire)) {
+            ok = service(esp_timer_get_time());
+        }
+        if (!ok) {
+            close_session();
+            wait(backoff_ms_);
+            backoff_ms_ = std::min(backoff_ms_ * 2, config_.reconnect_ms * 32);
+        }
+    }
+    if (connected()) {
+        const uint8_t disconnect[] = {type_disconnect, 0};
+        struct iovec iov = {const_cast<uint8_t *>(disconnect), sizeof(disconnect)};
+        transport_->write_some(&iov, 1);
+    }
+    close_session();
+    running_.store(false, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+bool Client::open_session()
+{
+    if (transport_->connect_to(config_.host, config_.port, config_.connect_timeout_ms) != ESP_OK) {
+        return false;
+    }
+
+    std::string_view id(config_.client_id);
+    std::string_view user(config_.username != nullptr ? config_.username : "");
+    std::string_view pass(config_.password != nullptr ? config_.password : "");
+    uint8_t flags = config_.clean_session ? 0x02 : 0;
+    uint32_t remaining = 10 + 2 + static_cast<uint32_t>(id.size());
+    if (config_.username != nullptr) {
+        flags |= 0x80;
+        remaining += 2 + static_cast<uint32_t>(user.size());
+    }
+    if (config_.password != nullptr) {
+        flags |= 0x40;
+        remaining += 2 + static_cast<uint32_t>(pass.size());
+    }
+
+    /* Fixed and variable header in one small buffer; the strings go out
+     * straight from the config as their own iovecs. */
+    uint8_t head[max_fixed_header + 12];
+    uint8_t user_len[2];
+    uint8_t pass_len[2];
+    uint8_t *p = head;
+    *p++ = type_connect;
+    p = put_varint(p, remaining);
+    p = put_string(p, "MQTT");
+    *p++ = 4; /* protocol level 3.1.1 */
+    *p++ = flags;
+    p = put_u16(p, config_.keepalive_s);
+    p = put_u16(p, static_cast<uint16_t>(id.size()));
+    put_u16(user_len, static_cast<uint16_t>(user.size()));
+    put_u16(pass_len, static_cast<uint16_t>(pass.size()));
+
+    struct iovec iov[5];
+    int count = 0;
+    iov[count++] = {head, static_cast<size_t>(p - head)};
+    iov[count++] = {const_cast<char *>(id.data()), id.size()};
+    if (config_.username != nullptr) {
+        iov[count++] = {user_len, sizeof(user_len)};
+        iov[count++] = {const_cast<char *>(user.data()), user.size()};
+    }
+    if (config_.password != nullptr) {
+        iov[count++] = {pass_len, sizeof(pass_len)};
+        iov[count++] = {const_cast<char *>(pass.data()), pass.size()};
+    }
+    size_t total = static_cast<size_t>(p - head) + remaining - 12;
+    /* Fits the empty send buffer of a fresh connection, so a short write means trouble. */
+    if (transport_->write_some(iov, count) != static_cast<int>(total)) {
+        ESP_LOGW(TAG, "sending CONNECT failed");
+        return false;
+    }
+    int64_t now = esp_timer_get_time();
+    last_rx_us_ = now;
+    last_tx_us_ = now;
+    awaiting_connack_ = true;
+    return true;
+}
+
+void Client::close_session()
+{
+    transport_->disconnect();
+    connected_.store(false, std::memory_order_release);
+    awaiting_connack_ = false;
+    ping_outstanding_ = false;
+    want_write_ = false;
+    window_full_ = false;
+    control_len_ = 0;
+    rx_len_ = 0;
+    rx_discard_ = 0;
+    rx_skip_ack_ = 0;
+}
+
+void Client::wake()
+{
+    if (event_fd_ >= 0) {
+        uint64_t one = 1;
+        write(event_fd_, &one, sizeof(one));
+    }
+}
+
+/* Sleep for @p ms; only deinit() cuts it short, so publishes do not defeat the backoff. */
+void Client::wait(uint32_t ms)
+{
+    int64_t deadline = esp_timer_get_time() + static_cast<int64_t>(ms) * 1000;
+    for (;;) {
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0 || stopping_.load(std::memory_order_acquire)) {
+            return;
+        }
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(event_fd_, &readable);
+        struct timeval tv = {};
+        tv.tv_sec = left / 1000000;
+        tv.tv_usec = left % 1000000;
+        if (select(event_fd_ + 1, &readable, nullptr, nullptr, &tv) > 0) {
+            uint64_t count;
+            read(event_fd_, &count, sizeof(count));
+        }
+    }
+}
+
+int64_t Client::next_deadline(int64_t now)
+{
+    int64_t keepalive_us = static_cast<int64_t>(config_.keepalive_s) * 1000000;
+    /* Nothing else due: wake once a second anyway, which costs nothing. */
+    int64_t deadline = now + 1000000;
+    if (awaiting_connack_) {
+        return std::min(deadline, last_rx_us_ + static_cast<int64_t>(config_.connect_timeout_ms) * 1000);
+    }
+    if (keepalive_us != 0) {
+        if (!ping_outstanding_) {
+            deadline = std::min(deadline, last_tx_us_ + keepalive_us * 3 / 4);
+        }
+        deadline = std::min(deadline, last_rx_us_ + keepalive_us * 3 / 2);
+    }
+    if (!want_write_ && !window_full_) {
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        if (flush_requested_ || unsent_bytes_ >= config_.batch_bytes) {
+            deadline = now;
+        } else if (unsent_bytes_ != 0) {
+            deadline = std::min(deadline, first_unsent_us_ + static_cast<int64_t>(config_.linger_ms) * 1000);
+        }
+        xSemaphoreGive(lock_);
+    }
+    return deadline;
+}
+
+/* One select() round: send what is due, wait, read, run the timers. @return false to drop the connection. */
+bool Client::service(int64_t now)
+{
+    if (connected() && !want_write_ && !send_pending(now)) {
+        return false;
+    }
+
+    int sock = transport_->fd();
+    fd_set readable;
+    fd_set writable;
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(sock, &readable);
+    FD_SET(event_fd_, &readable);
+    if (want_write_) {
+        FD_SET(sock, &writable);
+    }
+    int64_t timeout_us = std::max<int64_t>(next_deadline(now) - now, 0);
+    if (transport_->pending() != 0) {
+        timeout_us = 0;
+    }
+    struct timeval tv = {};
+    tv.tv_sec = timeout_us / 1000000;
+    tv.tv_usec = timeout_us % 1000000;
+    int ready = select(std::max(sock, event_fd_) + 1, &readable, want_write_ ? &writable : nullptr, nullptr, &tv);
+    if (ready < 0 && errno != EINTR) {
+        ESP_LOGW(TAG, "select failed: errno %d", errno);
+        return false;
+    }
+    now = esp_timer_get_time();
+    if (ready > 0) {
+        if (FD_ISSET(event_fd_, &readable)) {
+            uint64_t count;
+            read(event_fd_, &count, sizeof(count));
+        }
+        if (want_write_ && FD_ISSET(sock, &writable)) {
+            want_write_ = false;
+        }
+    }
+    if ((ready > 0 && FD_ISSET(sock, &readable)) || transport_->pending() != 0) {
+        if (!read_input(now)) {
+            return false;
+        }
+    }
+
+    if (awaiting_connack_) {
+        if (now - last_rx_us_ > static_cast<int64_t>(config_.connect_timeout_ms) * 1000) {
+            ESP_LOGW(TAG, "no CONNACK from %s", config_.host);
+            return false;
+        }
+        return true;
+    }
+    int64_t keepalive_us = static_cast<int64_t>(config_.keepalive_s) * 1000000;
+    if (keepalive_us != 0) {
+        if (now - last_rx_us_ > keepalive_us * 3 / 2) {
+            ESP_LOGW(TAG, "broker silent for %u s, reconnecting", static_cast<unsigned>(config_.keepalive_s * 3 / 2));
+            return false;
+        }
+        if (!ping_outstanding_ && now - last_tx_us_ >= keepalive_us * 3 / 4) {
+            const uint8_t ping[] = {type_pingreq, 0};
+            add_control(ping, sizeof(ping));
+            ping_outstanding_ = true;
+        }
+    }
+    return true;
+}
+
+/*
+ * Gather the control bytes plus every queued packet that is due into one
+ * writev(), then account for however much the transport took. Packets keep
+ * their order: a QoS1 packet that would exceed the window stops the batch,
+ * and everything queued behind it waits too.
+ */
+bool Client::send_pending(int64_t now)
+{
+    if (transport_->write_pending()) {
+        if (transport_->write_some(nullptr, 0) < 0) {
+            return false;
+        }
+        if (transport_->write_pending()) {
+            want_write_ = true;
+            return true;
+        }
+    }
+
+    struct iovec iov[max_iov];
+    int count = 0;
+    size_t total = 0;
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    /* A packet partly written must be finished before anything else goes on
+     * the stream: control bytes wait for the next write, and the rest of the
+     * packet goes now whatever the batching thresholds say. */
+    bool partial = send_offset_ != 0;
+    size_t control_len = partial ? 0 : control_len_;
+    if (control_len != 0) {
+        iov[count++] = {control_, control_len};
+        total += control_len;
+    }
+    bool due = partial || flush_requested_ || unsent_bytes_ >= config_.batch_bytes ||
+               (unsent_bytes_ != 0 && now - first_unsent_us_ >= static_cast<int64_t>(config_.linger_ms) * 1000);
+    window_full_ = false;
+    if (due) {
+        uint32_t in_flight = in_flight_.load(std::memory_order_relaxed);
+        for (uint32_t i = send_; i != head_ && count < max_iov; ++i) {
+            const Slot &s = slot(i);
+            if (s.state == SlotState::Done) {
+                continue;
+            }
+            if (s.packet_id != 0) {
+                if (in_flight >= config_.window) {
+                    window_full_ = true;
+                    break;
+                }
+                ++in_flight;
+            }
+            uint32_t sent = i == send_ ? send_offset_ : 0;
+            iov[count].iov_base = ring_ + s.offset + s.skip + sent;
+            iov[count].iov_len = s.len - s.skip - sent;
+            total += iov[count].iov_len;
+            ++count;
+        }
+    }
+    xSemaphoreGive(lock_);
+    if (count == 0) {
+        return true;
+    }
+
+    /* Packet bytes in the ring are not touched by publishers once committed,
+     * so the write itself runs without the lock. */
+    int written = transport_->write_some(iov, count);
+    if (written < 0) {
+        ESP_LOGW(TAG, "write failed: errno %d", errno);
+        return false;
+    }
+    want_write_ = static_cast<size_t>(written) < total || transport_->write_pending();
+    if (written == 0) {
+        return true;
+    }
+    last_tx_us_ = now;
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    tx_bytes_.fetch_add(written, std::memory_order_relaxed);
+
+    auto left = static_cast<uint32_t>(written);
+    size_t control = std::min<size_t>(left, control_len);
+    if (control != 0) {
+        memmove(control_, control_ + control, control_len_ - control);
+        control_len_ -= control;
+        left -= control;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    while (left != 0) {
+        Slot &s = slot(send_);
+        if (s.state == SlotState::Done) {
+            ++send_;
+            continue;
+        }
+        uint32_t rest = s.len - s.skip - send_offset_;
+        if (left < rest) {
+            send_offset_ += left;
+            unsent_bytes_ -= left;
+            break;
+        }
+        left -= rest;
+        unsent_bytes_ -= rest;
+        send_offset_ = 0;
+        if (s.packet_id != 0) {
+            s.state = SlotState::Sent;
+            in_flight_.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            s.state = SlotState::Done;
+        }
+        ++send_;
+    }
+    if (unsent_bytes_ == 0) {
+        flush_requested_ = false;
+    }
+    release_done();
+    xSemaphoreGive(lock_);
+    return true;
+}
+
+/* Caller holds lock_. */
+void Client::release_done()
+{
+    while (tail_ != send_ && slot(tail_).state == SlotState::Done) {
+        ++tail_;
+    }
+}
+
+void Client::add_control(const uint8_t *bytes, size_t len)
+{
+    /* Only PINGREQ and acknowledgements go here; if it is full the broker will resend. */
+    if (control_len_ + len <= sizeof(control_)) {
+        memcpy(control_ + control_len_, bytes, len);
+        control_len_ += len;
+    }
+}
+
+bool Client::read_input(int64_t now)
+{
+    for (;;) {
+        if (rx_discard_ != 0) {
+            int n = transport_->read_some(rx_, std::min(rx_discard_, sizeof(rx_)));
+            if (n <= 0) {
+                return n == 0;
+            }
+            last_rx_us_ = now;
+            discard_input(rx_, static_cast<size_t>(n));
+            continue;
+        }
+        int n = transport_->read_some(rx_ + rx_len_, sizeof(rx_) - rx_len_);
+        if (n < 0) {
+            ESP_LOGW(TAG, "connection closed by broker");
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        last_rx_us_ = now;
+        rx_len_ += static_cast<size_t>(n);
+
+        size_t pos = 0;
+        while (rx_len_ - pos >= 2) {
+            uint32_t remaining;
+            int used = get_varint(rx_ + pos + 1, rx_len_ - pos - 1, &remaining);
+            if (used < 0) {
+                ESP_LOGW(TAG, "malformed packet from broker");
+                return false;
+            }
+            if (used == 0) {
+                break;
+            }
+            size_t packet = 1 + static_cast<size_t>(used) + remaining;
+            if (packet > sizeof(rx_)) {
+                /* Nothing we handle is this large (an unsolicited PUBLISH): skip
+                 * it, but pick out the packet id that follows its topic on the
+                 * way, so a QoS 1/2 delivery is still acknowledged and not
+                 * resent on every reconnect. */
+                size_t header = 1 + static_cast<size_t>(used);
+                uint8_t qos = (rx_[pos] >> 1) & 0x03;
+                rx_skip_ack_ = 0;
+                if ((rx_[pos] & 0xf0) == type_publish && (qos == 1 || qos == 2)) {
+                    if (rx_len_ - pos < header + 2) {
+                        break;
+                    }
+                    rx_skip_id_at_ = header + 2 + get_u16(rx_ + pos + header);
+                    if (rx_skip_id_at_ + 2 <= packet) {
+                        rx_skip_ack_ = qos == 1 ? type_puback : type_pubrec;
+                    }
+                }
+                rx_skip_seen_ = 0;
+                rx_discard_ = packet;
+                discard_input(rx_ + pos, rx_len_ - pos);
+                pos = rx_len_;
+                break;
+            }
+            if (rx_len_ - pos < packet) {
+                break;
+            }
+            if (!handle_packet(rx_[pos], rx_ + pos + 1 + used, remaining)) {
+                return false;
+            }
+            pos += packet;
+        }
+        memmove(rx_, rx_ + pos, rx_len_ - pos);
+        rx_len_ -= pos;
+    }
+}
+
+/* Consumes the next @p len bytes of the oversized packet being skipped. */
+void Client::discard_input(const uint8_t *bytes, size_t len)
+{
+    for (size_t i = 0; i < sizeof(rx_skip_id_); ++i) {
+        size_t at = rx_skip_id_at_ + i;
+        if (at >= rx_skip_seen_ && at < rx_skip_seen_ + len) {
+            rx_skip_id_[i] = bytes[at - rx_skip_seen_];
+        }
+    }
+    rx_skip_seen_ += len;
+    rx_discard_ -= len;
+    if (rx_discard_ == 0 && rx_skip_ack_ != 0) {
+        uint8_t ack[4] = {rx_skip_ack_, 2, rx_skip_id_[0], rx_skip_id_[1]};
+        add_control(ack, sizeof(ack));
+        rx_skip_ack_ = 0;
+    }
+}
+
+bool Client::handle_packet(uint8_t type, const uint8_t *body, size_t len)
+{
+    switch (type & 0xf0) {
+    case type_connack:
+        if (!awaiting_connack_ || len < 2) {
+            return false;
+        }
+        if (body[1] != 0) {
+            ESP_LOGE(TAG, "broker refused connection: code %u", body[1]);
+            return false;
+        }
+        awaiting_connack_ = false;
+        backoff_ms_ = config_.reconnect_ms;
+        connects_.fetch_add(1, std::memory_order_relaxed);
+        on_session_up();
+        connected_.store(true, std::memory_order_release);
+        ESP_LOGI(TAG, "connected to %s:%u", config_.host, static_cast<unsigned>(config_.port));
+        return true;
+
+    case type_puback: {
+        if (len < 2) {
+            return false;
+        }
+        uint16_t id = get_u16(body);
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        for (uint32_t i = tail_; i != send_; ++i) {
+            Slot &s = slot(i);
+            if (s.state == SlotState::Sent && s.packet_id == id) {
+                s.state = SlotState::Done;
+                in_flight_.fetch_sub(1, std::memory_order_relaxed);
+                acked_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+        release_done();
+        xSemaphoreGive(lock_);
+        window_full_ = false;
+        return true;
+    }
+
+    case type_pingresp:
+        ping_outstanding_ = false;
+        return true;
+
+    case type_publish: {
+        /* Publish-only client: nothing is subscribed, but acknowledge a
+         * delivery anyway so the broker does not keep resending it: PUBACK
+         * for QoS 1, PUBREC for QoS 2, then PUBCOMP for its PUBREL. */
+        uint8_t qos = (type >> 1) & 0x03;
+        if (qos != 0 && len >= 2) {
+            size_t topic_len = get_u16(body);
+            if (len >= 2 + topic_len + 2) {
+                uint8_t ack[4] = {qos == 1 ? type_puback : type_pubrec, 2, body[2 + topic_len], body[3 + topic_len]};
+                add_control(ack, sizeof(ack));
+            }
+        }
+        return true;
+    }
+
+    case type_pubrel: {
+        if (len < 2) {
+            return false;
+        }
+        uint8_t comp[4] = {type_pubcomp, 2, body[0], body[1]};
+        add_control(comp, sizeof(comp));
+        return true;
+    }
+
+    default:
+        return true;
+    }
+}
+
+/*
+ * After CONNACK: everything sent on the old connection but not acknowledged
+ * goes out again, QoS1 packets with DUP set, in their original order.
+ */
+void Client::on_session_up()
+{
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    unsent_bytes_ += send_offset_;
+    send_offset_ = 0;
+    uint32_t resent = 0;
+    for (uint32_t i = tail_; i != send_; ++i) {
+        Slot &s = slot(i);
+        if (s.state == SlotState::Sent) {
+            s.state = SlotState::Queued;
+            ring_[s.offset + s.skip] |= publish_dup;
+            unsent_bytes_ += s.len - s.skip;
+            ++resent;
+        }
+    }
+    send_ = tail_;
+    in_flight_.store(0, std::memory_order_relaxed);
+    if (unsent_bytes_ != 0) {
+        /* Queued while disconnected: long past any linger deadline. */
+        flush_requested_ = true;
+    }
+    xSemaphoreGive(lock_);
+    retransmitted_.fetch_add(resent, std::memory_order_relaxed);
+    int64_t now = esp_timer_get_time();
+    last_rx_us_ = now;
+}
+
+} // namespace mqtt_client
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace mqtt_client::detail {
+
+/* MQTT 3.1.1 control packet types (high nibble of the first byte). */
+constexpr uint8_t type_connect = 0x10;
+constexpr uint8_t type_connack = 0x20;
+constexpr uint8_t type_publish = 0x30;
+constexpr uint8_t type_puback = 0x40;
+constexpr uint8_t type_pubrec = 0x50;
+/* PUBREL carries fixed header flags 0b0010. */
+constexpr uint8_t type_pubrel = 0x60;
+constexpr uint8_t type_pubcomp = 0x70;
+constexpr uint8_t type_pingreq = 0xc0;
+constexpr uint8_t type_pingresp = 0xd0;
+constexpr uint8_t type_disconnect = 0xe0;
+
+constexpr uint8_t publish_dup = 0x08;
+
+/* Type byte plus the longest remaining-length encoding. */
+constexpr size_t max_fixed_header = 5;
+
+inline size_t varint_size(uint32_t v)
+{
+    return v < 128 ? 1 : v < 16384 ? 2 : v < 2097152 ? 3 : 4;
+}
+
+inline uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    do {
+        uint8_t byte = v & 0x7f;
+        v >>= 7;
+        *p++ = v != 0 ? byte | 0x80 : byte;
+    } while (v != 0);
+    return p;
+}
+
+/**
+ * Decode a remaining length from @p p (at most @p avail bytes).
+ * @return bytes used, 0 if more input is needed, -1 if malformed.
+ */
+inline int get_varint(const uint8_t *p, size_t avail, uint32_t *v)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (static_cast<size_t>(i) >= avail) {
+            return 0;
+        }
+        value |= static_cast<uint32_t>(p[i] & 0x7f) << (7 * i);
+        if ((p[i] & 0x80) == 0) {
+            *v = value;
+            return i + 1;
+        }
+    }
+    return -1;
+}
+
+inline uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+    return p + 2;
+}
+
+inline uint16_t get_u16(const uint8_t *p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint8_t *put_string(uint8_t *p, std::string_view s)
+{
+    p = put_u16(p, static_cast<uint16_t>(s.size()));
+    memcpy(p, s.data(), s.size());
+    return p + s.size();
+}
+
+} // namespace mqtt_client::detail
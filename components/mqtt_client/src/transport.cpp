@@ -0,0 +1,93 @@
+#include "mqtt_client/transport.hpp"
+
+#include <cerrno>
+#include <cstdio>
+
+#include "esp_log.h"
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "mqtt_client";
+
+namespace mqtt_client {
+
+esp_err_t TcpTransport::connect_to(const char *host, uint16_t port, uint32_t timeout_ms)
+{
+    disconnect();
+    char service[8];
+    snprintf(service, sizeof(service), "%u", static_cast<unsigned>(port));
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res = nullptr;
+    int rc = getaddrinfo(host, service, &hints, &res);
+    if (rc != 0 || res == nullptr) {
+        ESP_LOGW(TAG, "resolving %s failed: %d", host, rc);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = ESP_FAIL;
+    fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd_ >= 0) {
+        fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+        rc = ::connect(fd_, res->ai_addr, res->ai_addrlen);
+        if (rc == 0) {
+            err = ESP_OK;
+        } else if (errno == EINPROGRESS) {
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(fd_, &writable);
+            struct timeval tv = {};
+            tv.tv_sec = timeout_ms / 1000;
+            tv.tv_usec = (timeout_ms % 1000) * 1000;
+            int so_error = 0;
+            socklen_t so_len = sizeof(so_error);
+            if (select(fd_ + 1, nullptr, &writable, nullptr, &tv) <= 0) {
+                err = ESP_ERR_TIMEOUT;
+            } else if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &so_error, &so_len) == 0 && so_error == 0) {
+                err = ESP_OK;
+            } else {
+                ESP_LOGW(TAG, "connect to %s:%u failed: errno %d", host, static_cast<unsigned>(port), so_error);
+            }
+        }
+    }
+    freeaddrinfo(res);
+    if (err != ESP_OK) {
+        disconnect();
+        return err;
+    }
+    int one = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return ESP_OK;
+}
+
+void TcpTransport::disconnect()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+int TcpTransport::write_some(const struct iovec *iov, int count)
+{
+    ssize_t n = lwip_writev(fd_, iov, count);
+    if (n >= 0) {
+        return static_cast<int>(n);
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+}
+
+int TcpTransport::read_some(void *buf, size_t len)
+{
+    ssize_t n = recv(fd_, buf, len, 0);
+    if (n > 0) {
+        return static_cast<int>(n);
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return 0;
+    }
+    return -1;
+}
+
+} // namespace mqtt_client
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nn_int8 {
+
+/**
+ * @brief Fixed-point multiplier for requantizing int32 accumulators.
+ *
+ * Represents multiplier * 2^(shift - 31), multiplier in [2^30, 2^31). Build
+ * it with make_requant() from the real scale input * weight / output.
+ */
+struct Requant {
+    int32_t multiplier;
+    int32_t shift;
+};
+
+/**
+ * @brief Requant for a real multiplier below 2^30; constexpr, so scales can be written as doubles.
+ *
+ * Multipliers below 2^-32 requantize everything to zero.
+ */
+constexpr Requant make_requant(double real)
+{
+    if (!(real > 0.0)) {
+        return Requant{0, 0};
+    }
+    int32_t shift = 0;
+    while (real < 0.5) {
+        real *= 2.0;
+        --shift;
+    }
+    while (real >= 1.0) {
+        real *= 0.5;
+        ++shift;
+    }
+    if (shift < -31) {
+        return Requant{0, 0};
+    }
+    auto q = static_cast<int64_t>(real * 2147483648.0 + 0.5);
+    if (q == (int64_t(1) << 31)) {
+        q >>= 1;
+        ++shift;
+    }
+    return Requant{static_cast<int32_t>(q), shift};
+}
+
+/**
+ * @brief acc * real multiplier, rounded half up.
+ *
+ * One 32x32->64 multiply and a shift. TFLite's reference rounds twice, so a
+ * tie can come out one step apart from it.
+ */
+inline int32_t requantize(int32_t acc, Requant r)
+{
+    int32_t total_shift = 31 - r.shift;
+    int64_t prod = static_cast<int64_t>(acc) * r.multiplier;
+    return static_cast<int32_t>((prod + (int64_t(1) << (total_shift - 1))) >> total_shift);
+}
+
+/** How accumulators become int8 outputs: bias, scale, zero point, clamp. */
+struct OutputStage {
+    /** [rows] with the input zero point folded in (fold_bias()). */
+    const int32_t *bias;
+    /** [rows] per channel, or a single entry when per_channel is false. */
+    const Requant *requant;
+    bool per_channel;
+    int32_t zero_point;
+    int8_t min;
+    int8_t max;
+};
+
+/**
+ * @brief bias[r] - input_zero_point * sum(weights[r][*]) for every row.
+ *
+ * The weights are symmetric (zero point 0), so this makes the kernels'
+ * inner loops plain dot products of the raw int8 values. @p bias may be null.
+ */
+void fold_bias(const int8_t *weights, size_t rows, size_t cols, const int32_t *bias, int32_t input_zero_point,
+               int32_t *out);
+
+/**
+ * @brief out[r] = requantized dot(in, weights[r]) for each of @p rows rows of @p cols.
+ *
+ * Any @p cols works. On the S3, with @p in and @p weights 16-byte aligned
+ * and @p cols a multiple of 16, every row runs fully vectorised; with other
+ * widths most rows start unaligned and run scalar.
+ */
+void fully_connected(const int8_t *in, const int8_t *weights, size_t rows, size_t cols, const OutputStage &stage,
+                     int8_t *out);
+
+/**
+ * @brief Valid 1D convolution over channels-last data ([length][channels]).
+ *
+ * Weights are [out_channels][kernel][in_channels], so each window of the
+ * input is one contiguous block and every output position is a
+ * fully_connected() over it.
+ */
+void conv_1d(const int8_t *in, size_t out_length, size_t in_channels, size_t kernel, size_t stride,
+             const int8_t *weights, size_t out_channels, const OutputStage &stage, int8_t *out);
+
+/** Max over non-overlapping windows of @p pool positions; a trailing partial window is dropped. */
+void max_pool_1d(const int8_t *in, size_t out_length, size_t channels, size_t pool, int8_t *out);
+
+/** Rounded mean of each channel over @p length positions; the quantization is unchanged. */
+void global_avg_pool_1d(const int8_t *in, size_t length, size_t channels, int8_t *out);
+
+/** round(in / scale) + zero_point, saturated to int8. */
+void quantize(const float *in, size_t n, float scale, int32_t zero_point, int8_t *out);
+
+/** (in - zero_point) * scale. */
+void dequantize(const int8_t *in, size_t n, float scale, int32_t zero_point, float *out);
+
+} // namespace nn_int8
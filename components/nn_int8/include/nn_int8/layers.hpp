@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "nn_int8/kernels.hpp"
+
+namespace nn_int8 {
+
+/**
+ * @brief Fully connected layer, In inputs to Out outputs.
+ *
+ * Quantization follows the TFLite int8 scheme: asymmetric activations,
+ * symmetric weights (zero point 0), int32 bias in units of input scale *
+ * weight scale. init() folds the input zero point into a private copy of
+ * the bias, so the layer owns Out words and otherwise only points at the
+ * caller's constant weights (flash is fine; internal RAM is faster).
+ */
+template <size_t In, size_t Out>
+class Dense {
+    static_assert(In >= 1 && Out >= 1, "empty layer");
+
+public:
+    static constexpr size_t input_size = In;
+    static constexpr size_t output_size = Out;
+    static constexpr size_t macs = In * Out;
+
+    struct Config {
+        /**
+         * [Out][In]; any In works. 16-byte aligned (dsp_kernels::AlignedArray)
+         * with In a multiple of 16, every row runs fully on the S3 vector path.
+         */
+        const int8_t *weights = nullptr;
+        /** [Out]; null for no bias. */
+        const int32_t *bias = nullptr;
+        /** [Out] with per_channel, otherwise one entry for the whole layer. */
+        const Requant *requant = nullptr;
+        bool per_channel = true;
+        int32_t input_zero_point = 0;
+        int32_t output_zero_point = 0;
+        /** Output clamp; set output_min to output_zero_point for a fused ReLU. */
+        int8_t output_min = -128;
+        int8_t output_max = 127;
+    };
+
+    esp_err_t init(const Config &config) { return setup(config, In, Out); }
+
+    bool ready() const { return weights_ != nullptr; }
+
+    void run(const int8_t *in, int8_t *out) const { fully_connected(in, weights_, Out, In, stage_, out); }
+
+protected:
+    esp_err_t setup(const Config &config, size_t cols, size_t rows)
+    {
+        if (config.weights == nullptr || config.requant == nullptr || config.output_min > config.output_max ||
+            config.input_zero_point < -128 || config.input_zero_point > 127 || config.output_zero_point < -128 ||
+            config.output_zero_point > 127) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        fold_bias(config.weights, rows, cols, config.bias, config.input_zero_point, bias_);
+        stage_.bias = bias_;
+        stage_.requant = config.requant;
+        stage_.per_channel = config.per_channel;
+        stage_.zero_point = config.output_zero_point;
+        stage_.min = config.output_min;
+        stage_.max = config.output_max;
+        weights_ = config.weights;
+        return ESP_OK;
+    }
+
+    const int8_t *weights_ = nullptr;
+    OutputStage stage_ = {};
+    int32_t bias_[Out] = {};
+};
+
+/**
+ * @brief Valid 1D convolution over channels-last [Length][InChannels] data.
+ *
+ * Output is [(Length - Kernel) / Stride + 1][OutChannels]; weights are
+ * [OutChannels][Kernel][InChannels], i.e. a Dense over each window, and are
+ * configured like one. Windows start Stride * InChannels bytes apart, so
+ * the S3 vector path needs that and Kernel * InChannels to be multiples
+ * of 16.
+ */
+template <size_t Length, size_t InChannels, size_t OutChannels, size_t Kernel, size_t Stride = 1>
+class Conv1D : private Dense<Kernel * InChannels, OutChannels> {
+    using Filter = Dense<Kernel * InChannels, OutChannels>;
+
+    static_assert(Kernel >= 1 && Kernel <= Length, "kernel longer than the input");
+    static_assert(Stride >= 1, "stride must be at least 1");
+
+public:
+    using Config = typename Filter::Config;
+
+    static constexpr size_t out_length = (Length - Kernel) / Stride + 1;
+    static constexpr size_t input_size = Length * InChannels;
+    static constexpr size_t output_size = out_length * OutChannels;
+    static constexpr size_t macs = out_length * Filter::macs;
+
+    esp_err_t init(const Config &config) { return this->setup(config, Kernel * InChannels, OutChannels); }
+
+    using Filter::ready;
+
+    void run(const int8_t *in, int8_t *out) const
+    {
+        conv_1d(in, out_length, InChannels, Kernel, Stride, this->weights_, OutChannels, this->stage_, out);
+    }
+};
+
+/** Max pooling with window and stride Pool; keeps the input quantization. */
+template <size_t Length, size_t Channels, size_t Pool>
+class MaxPool1D {
+    static_assert(Pool >= 1 && Pool <= Length, "pool window longer than the input");
+
+public:
+    static constexpr size_t out_length = Length / Pool;
+    static constexpr size_t input_size = Length * Channels;
+    static constexpr size_t output_size = out_length * Channels;
+    static constexpr size_t macs = 0;
+
+    bool ready() const { return true; }
+
+    void run(const int8_t *in, int8_t *out) const { max_pool_1d(in, out_length, Channels, Pool, out); }
+};
+
+/** Mean of each channel over the whole length, flattening to Channels values. */
+template <size_t Length, size_t Channels>
+class GlobalAvgPool1D {
+    static_assert(Length >= 1 && Channels >= 1, "empty layer");
+
+public:
+    static constexpr size_t input_size = Length * Channels;
+    static constexpr size_t output_size = Channels;
+    static constexpr size_t macs = 0;
+
+    bool ready() const { return true; }
+
+    void run(const int8_t *in, int8_t *out) const { global_avg_pool_1d(in, Length, Channels, out); }
+};
+
+} // namespace nn_int8
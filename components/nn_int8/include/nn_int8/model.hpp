@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+
+#include "esp_err.h"
+#include "nn_int8/layers.hpp"
+
+namespace nn_int8 {
+
+/**
+ * @brief A chain of layers with its activation memory planned at compile time.
+ *
+ * Every activation lives in one arena inside the Model object, so an
+ * inference allocates nothing and the whole footprint is sizeof(Model):
+ * declare models static or as members, not on a task stack. Layer i reads
+ * from one end of the arena and writes to the other, the ends alternating
+ * down the chain, so the arena only has to hold the largest input + output
+ * pair rather than every activation. Buffers start 16-byte aligned for the
+ * S3 vector path.
+ *
+ *     using Net = nn_int8::Model<nn_int8::Conv1D<128, 3, 16, 5, 2>,
+ *                                nn_int8::MaxPool1D<62, 16, 2>,
+ *                                nn_int8::GlobalAvgPool1D<31, 16>,
+ *                                nn_int8::Dense<16, 2>>;
+ *     static Net net;
+ *     net.layer<0>().init(conv_config);
+ *     net.layer<3>().init(dense_config);
+ *     nn_int8::quantize(features, Net::input_size, in_scale, in_zero_point, net.input());
+ *     net.invoke();
+ *     // net.output(): Net::output_size int8 values
+ */
+template <typename... Layers>
+class Model {
+    static constexpr size_t count = sizeof...(Layers);
+
+    static_assert(count >= 1, "a model needs at least one layer");
+
+    static constexpr size_t in_sizes[count] = {Layers::input_size...};
+    static constexpr size_t out_sizes[count] = {Layers::output_size...};
+
+    static constexpr size_t round_up(size_t n) { return (n + 15) & ~size_t(15); }
+
+    static constexpr bool chained()
+    {
+        for (size_t i = 1; i < count; ++i) {
+            if (in_sizes[i] != out_sizes[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr size_t plan()
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i) {
+            size_t pair = round_up(in_sizes[i]) + round_up(out_sizes[i]);
+            size = pair > size ? pair : size;
+        }
+        return size;
+    }
+
+    static_assert(chained(), "each layer's input_size must equal the previous layer's output_size");
+
+public:
+    static constexpr size_t layer_count = count;
+    static constexpr size_t input_size = in_sizes[0];
+    static constexpr size_t output_size = out_sizes[count - 1];
+    static constexpr size_t arena_size = plan();
+    static constexpr size_t macs = (Layers::macs + ...);
+
+    template <size_t I>
+    using layer_type = std::tuple_element_t<I, std::tuple<Layers...>>;
+
+    Model() = default;
+    Model(const Model &) = delete;
+    Model &operator=(const Model &) = delete;
+
+    /** Layer @p I, to init() it; pooling layers need no setup. */
+    template <size_t I>
+    layer_type<I> &layer()
+    {
+        return std::get<I>(layers_);
+    }
+
+    /** Where to write the quantized input (input_size values). */
+    int8_t *input() { return arena_ + input_offset(0); }
+
+    /** The last invoke()'s result (output_size values); overwritten by the next one. */
+    const int8_t *output() const { return arena_ + output_offset(count - 1); }
+
+    /** Run every layer. @return ESP_ERR_INVALID_STATE if a layer has not been initialized. */
+    esp_err_t invoke()
+    {
+        if (!ready(std::index_sequence_for<Layers...>{})) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        run_all(std::index_sequence_for<Layers...>{});
+        return ESP_OK;
+    }
+
+    /**
+     * @brief Run layer @p index alone, on whatever its input buffer holds.
+     *
+     * For per-layer timing; layer @p index must be initialized, and the
+     * layers after it see its output as usual.
+     */
+    void invoke_layer(size_t index) { run_one(index, std::index_sequence_for<Layers...>{}); }
+
+    /** Multiply-accumulates in layer @p index. */
+    static constexpr size_t layer_macs(size_t index)
+    {
+        constexpr size_t m[count] = {Layers::macs...};
+        return index < count ? m[index] : 0;
+    }
+
+private:
+    static constexpr size_t input_offset(size_t i) { return i % 2 == 0 ? 0 : arena_size - round_up(in_sizes[i]); }
+    static constexpr size_t output_offset(size_t i) { return i % 2 == 0 ? arena_size - round_up(out_sizes[i]) : 0; }
+
+    template <size_t I>
+    void run()
+    {
+        std::get<I>(layers_).run(arena_ + input_offset(I), arena_ + output_offset(I));
+    }
+
+    template <size_t... Is>
+    bool ready(std::index_sequence<Is...>) const
+    {
+        return (std::get<Is>(layers_).ready() && ...);
+    }
+
+    template <size_t... Is>
+    void run_all(std::index_sequence<Is...>)
+    {
+        (run<Is>(), ...);
+    }
+
+    template <size_t... Is>
+    void run_one(size_t index, std::index_sequence<Is...>)
+    {
+        static_cast<void>(((index == Is ? (run<Is>(), true) : false) || ...));
+    }
+
+    std::tuple<Layers...> layers_;
+    alignas(16) int8_t arena_[arena_size] = {};
+};
+
+} // namespace nn_int8
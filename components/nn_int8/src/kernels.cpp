@@ -0,0 +1,108 @@
+#include "nn_int8/kernels.hpp"
+
+#include "dsp_kernels/vector.hpp"
+
+namespace nn_int8 {
+
+namespace {
+
+int8_t saturate(int32_t v, int8_t lo, int8_t hi)
+{
+    return static_cast<int8_t>(v < lo ? lo : (v > hi ? hi : v));
+}
+
+} // namespace
+
+void fold_bias(const int8_t *weights, size_t rows, size_t cols, const int32_t *bias, int32_t input_zero_point,
+               int32_t *out)
+{
+    for (size_t r = 0; r < rows; ++r) {
+        int32_t sum = 0;
+        for (size_t c = 0; c < cols; ++c) {
+            sum += weights[r * cols + c];
+        }
+        out[r] = (bias != nullptr ? bias[r] : 0) - input_zero_point * sum;
+    }
+}
+
+void fully_connected(const int8_t *in, const int8_t *weights, size_t rows, size_t cols, const OutputStage &stage,
+                     int8_t *out)
+{
+    const Requant *requant = stage.requant;
+    for (size_t r = 0; r < rows; ++r) {
+        int32_t acc = dsp_kernels::dot_product(in, weights, cols) + stage.bias[r];
+        out[r] = saturate(requantize(acc, *requant) + stage.zero_point, stage.min, stage.max);
+        weights += cols;
+        if (stage.per_channel) {
+            ++requant;
+        }
+    }
+}
+
+void conv_1d(const int8_t *in, size_t out_length, size_t in_channels, size_t kernel, size_t stride,
+             const int8_t *weights, size_t out_channels, const OutputStage &stage, int8_t *out)
+{
+    size_t window = kernel * in_channels;
+    size_t step = stride * in_channels;
+    for (size_t t = 0; t < out_length; ++t) {
+        fully_connected(in, weights, out_channels, window, stage, out);
+        in += step;
+        out += out_channels;
+    }
+}
+
+void max_pool_1d(const int8_t *in, size_t out_length, size_t channels, size_t pool, int8_t *out)
+{
+    for (size_t t = 0; t < out_length; ++t) {
+        for (size_t c = 0; c < channels; ++c) {
+            int8_t m = in[c];
+            for (size_t p = 1; p < pool; ++p) {
+                int8_t v = in[p * channels + c];
+                m = v > m ? v : m;
+            }
+            out[c] = m;
+        }
+        in += pool * channels;
+        out += channels;
+    }
+}
+
+void global_avg_pool_1d(const int8_t *in, size_t length, size_t channels, int8_t *out)
+{
+    auto n = static_cast<int32_t>(length);
+    for (size_t c = 0; c < channels; ++c) {
+        int32_t sum = 0;
+        for (size_t t = 0; t < length; ++t) {
+            sum += in[t * channels + c];
+        }
+        /* Round half away from zero, like the float reference. */
+        int32_t mean = sum >= 0 ? (sum + n / 2) / n : -((-sum + n / 2) / n);
+        out[c] = saturate(mean, -128, 127);
+    }
+}
+
+void quantize(const float *in, size_t n, float scale, int32_t zero_point, int8_t *out)
+{
+    float inv = 1.0f / scale;
+    auto zp = static_cast<float>(zero_point);
+    for (size_t i = 0; i < n; ++i) {
+        /* Saturate before converting; rounding by hand avoids a libm call. */
+        float v = in[i] * inv + zp;
+        if (v >= 127.0f) {
+            out[i] = 127;
+        } else if (v <= -128.0f) {
+            out[i] = -128;
+        } else {
+            out[i] = static_cast<int8_t>(v >= 0.0f ? v + 0.5f : v - 0.5f);
+        }
+    }
+}
+
+void dequantize(const int8_t *in, size_t n, float scale, int32_t zero_point, float *out)
+{
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<float>(in[i] - zero_point) * scale;
+    }
+}
+
+} // namespace nn_int8
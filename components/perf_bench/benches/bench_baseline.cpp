@@ -0,0 +1,83 @@
+/*
+ * Reference costs every other suite is compared against: the harness loop
+ * itself, the timer/cycle-counter reads, memcpy and the general-purpose heap.
+ */
+#include <cstdlib>
+#include <cstring>
+
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+void bench_empty_loop(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        perf_bench::clobber_memory();
+    }
+}
+PERF_BENCH(bench_empty_loop, 100000);
+
+void bench_cycle_count_read(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        perf_bench::do_not_optimize(esp_cpu_get_cycle_count());
+    }
+}
+PERF_BENCH(bench_cycle_count_read, 100000);
+
+void bench_esp_timer_get_time(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        perf_bench::do_not_optimize(esp_timer_get_time());
+    }
+}
+PERF_BENCH(bench_esp_timer_get_time, 100000);
+
+void bench_memcpy(perf_bench::State &state)
+{
+    size_t len = static_cast<size_t>(state.arg());
+    auto *src = static_cast<uint8_t *>(heap_caps_malloc(len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    auto *dst = static_cast<uint8_t *>(heap_caps_malloc(len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (src == nullptr || dst == nullptr) {
+        heap_caps_free(src);
+        heap_caps_free(dst);
+        state.skip("out of internal memory");
+        return;
+    }
+    memset(src, 0xa5, len);
+    for (auto _ : state) {
+        memcpy(dst, src, len);
+        perf_bench::clobber_memory();
+    }
+    state.set_bytes_per_iteration(len);
+    heap_caps_free(src);
+    heap_caps_free(dst);
+}
+PERF_BENCH_ARGS(bench_memcpy, 10000, 16, 64, 256, 1024, 4096);
+
+void bench_malloc_free(perf_bench::State &state)
+{
+    size_t len = static_cast<size_t>(state.arg());
+    for (auto _ : state) {
+        void *p = malloc(len);
+        perf_bench::do_not_optimize(p);
+        free(p);
+    }
+}
+PERF_BENCH_ARGS(bench_malloc_free, 10000, 16, 64, 256, 1024);
+
+void bench_heap_caps_malloc_internal(perf_bench::State &state)
+{
+    size_t len = static_cast<size_t>(state.arg());
+    for (auto _ : state) {
+        void *p = heap_caps_malloc(len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        perf_bench::do_not_optimize(p);
+        heap_caps_free(p);
+    }
+}
+PERF_BENCH_ARGS(bench_heap_caps_malloc_internal, 10000, 16, 64, 256, 1024);
+
+} // namespace
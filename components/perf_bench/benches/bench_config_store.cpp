@@ -0,0 +1,127 @@
+/*
+ * config_store against NVS for settings on a control path: reading a key with
+ * nvs_get_u32 against reading the cached struct member, and changing a value
+ * through Store::set (debounced; the loop never waits on flash) against
+ * nvs_set_u32 plus nvs_commit on every change.
+ */
+#include "config_store/config_store.hpp"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+constexpr const char *bench_namespace = "bench_cfg";
+
+struct Settings {
+    float gain = 1.0f;
+    uint32_t setpoint = 500;
+    char label[24] = "bench";
+};
+
+constexpr config_store::Field settings_schema[] = {
+    CONFIG_STORE_FIELD(Settings, gain, "gain"),
+    CONFIG_STORE_FIELD(Settings, setpoint, "setpoint"),
+    CONFIG_STORE_FIELD(Settings, label, "label"),
+};
+
+Settings settings;
+
+bool open_nvs(perf_bench::State &state, nvs_handle_t *handle)
+{
+    if (nvs_flash_init() != ESP_OK || nvs_open(bench_namespace, NVS_READWRITE, handle) != ESP_OK) {
+        state.skip("nvs unavailable");
+        return false;
+    }
+    return true;
+}
+
+void erase_namespace(nvs_handle_t handle)
+{
+    nvs_erase_all(handle);
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+void bench_config_nvs_get(perf_bench::State &state)
+{
+    nvs_handle_t handle;
+    if (!open_nvs(state, &handle)) {
+        return;
+    }
+    nvs_set_u32(handle, "setpoint", 500);
+    nvs_commit(handle);
+    for (auto _ : state) {
+        uint32_t setpoint = 0;
+        nvs_get_u32(handle, "setpoint", &setpoint);
+        perf_bench::do_not_optimize(setpoint);
+    }
+    erase_namespace(handle);
+}
+PERF_BENCH(bench_config_nvs_get, 2000);
+
+void bench_config_cached_read(perf_bench::State &state)
+{
+    nvs_handle_t handle;
+    if (!open_nvs(state, &handle)) {
+        return;
+    }
+    nvs_close(handle);
+    config_store::Store store;
+    config_store::Store::Config config;
+    config.nvs_namespace = bench_namespace;
+    if (store.init(settings, settings_schema, config) != ESP_OK) {
+        state.skip("store init failed");
+        return;
+    }
+    for (auto _ : state) {
+        perf_bench::clobber_memory();
+        uint32_t setpoint = settings.setpoint;
+        perf_bench::do_not_optimize(setpoint);
+    }
+}
+PERF_BENCH(bench_config_cached_read, 2000);
+
+void bench_config_set(perf_bench::State &state)
+{
+    nvs_handle_t handle;
+    if (!open_nvs(state, &handle)) {
+        return;
+    }
+    config_store::Store store;
+    config_store::Store::Config config;
+    config.nvs_namespace = bench_namespace;
+    config.commit_delay_ms = 60000;
+    config.max_commit_delay_ms = 60000;
+    if (store.init(settings, settings_schema, config) != ESP_OK) {
+        nvs_close(handle);
+        state.skip("store init failed");
+        return;
+    }
+    uint32_t n = 0;
+    for (auto _ : state) {
+        esp_err_t err = store.set(&Settings::setpoint, 400 + (n++ & 63));
+        perf_bench::do_not_optimize(err);
+    }
+    store.deinit();
+    erase_namespace(handle);
+}
+PERF_BENCH(bench_config_set, 2000);
+
+/* What each change costs when it goes straight to flash. */
+void bench_config_nvs_write_through(perf_bench::State &state)
+{
+    nvs_handle_t handle;
+    if (!open_nvs(state, &handle)) {
+        return;
+    }
+    uint32_t n = 0;
+    for (auto _ : state) {
+        nvs_set_u32(handle, "setpoint", 400 + (n++ & 63));
+        nvs_commit(handle);
+    }
+    erase_namespace(handle);
+}
+PERF_BENCH(bench_config_nvs_write_through, 200);
+
+} // namespace
@@ -0,0 +1,209 @@
+/*
+ * Coroutine scheduler: a coroutine switch (yield and resume on the same
+ * task) against a FreeRTOS task-notification ping-pong between two tasks,
+ * and the cost of spawning a short flow from another task, which includes
+ * the frame allocation and the remote wakeup.
+ *
+ * Then queued SPI transfers from several flows, with the scheduler on the
+ * other core from the SPI ISR, so coroutines resume while the driver is
+ * still queueing their results. The bus has no pins; the case is skipped if
+ * any transfer reports an error, which is what a lost result looks like.
+ */
+#include <atomic>
+#include <cstdint>
+
+#include "coro/scheduler.hpp"
+#include "coro/spi.hpp"
+#include "coro/task.hpp"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+namespace {
+
+constexpr uint32_t switches = 64;
+
+coro::Scheduler *shared_scheduler()
+{
+    static coro::Scheduler sched;
+    static bool started = false;
+    if (!started) {
+        coro::Scheduler::Config config;
+        config.priority = uxTaskPriorityGet(nullptr);
+        config.enable_io = false;
+        if (sched.init(config) != ESP_OK) {
+            return nullptr;
+        }
+        started = true;
+    }
+    return &sched;
+}
+
+coro::Task<void> yield_loop(coro::Scheduler &sched, uint32_t count, TaskHandle_t done)
+{
+    for (uint32_t i = 0; i < count; ++i) {
+        co_await sched.yield();
+    }
+    xTaskNotifyGive(done);
+}
+
+void bench_coro_yield(perf_bench::State &state)
+{
+    coro::Scheduler *sched = shared_scheduler();
+    if (sched == nullptr) {
+        state.skip("scheduler init failed");
+        return;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (auto _ : state) {
+        sched->spawn(yield_loop(*sched, switches, self));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    state.set_items_per_iteration(switches);
+}
+PERF_BENCH(bench_coro_yield, 1000);
+
+struct PingPong {
+    TaskHandle_t peer;
+    TaskHandle_t bench;
+};
+
+void pong_task(void *arg)
+{
+    auto *pp = static_cast<PingPong *>(arg);
+    for (;;) {
+        uint32_t n = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (n == UINT32_MAX) {
+            break;
+        }
+        xTaskNotifyGive(pp->bench);
+    }
+    pp->peer = nullptr;
+    vTaskDelete(nullptr);
+}
+
+/* Same core and priority as the bench task, so each hop is a context switch. */
+void bench_task_notify_ping_pong(perf_bench::State &state)
+{
+    PingPong pp = {nullptr, xTaskGetCurrentTaskHandle()};
+    if (xTaskCreatePinnedToCore(pong_task, "pong", 2048, &pp, uxTaskPriorityGet(nullptr), &pp.peer,
+                                xPortGetCoreID()) != pdPASS) {
+        state.skip("xTaskCreate failed");
+        return;
+    }
+    for (auto _ : state) {
+        for (uint32_t i = 0; i < switches / 2; ++i) {
+            xTaskNotifyGive(pp.peer);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+    xTaskNotify(pp.peer, UINT32_MAX, eSetValueWithOverwrite);
+    while (pp.peer != nullptr) {
+        vTaskDelay(1);
+    }
+    state.set_items_per_iteration(switches);
+}
+PERF_BENCH(bench_task_notify_ping_pong, 1000);
+
+void bench_coro_spawn(perf_bench::State &state)
+{
+    coro::Scheduler *sched = shared_scheduler();
+    if (sched == nullptr) {
+        state.skip("scheduler init failed");
+        return;
+    }
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (auto _ : state) {
+        sched->spawn(yield_loop(*sched, 0, self));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+PERF_BENCH(bench_coro_spawn, 2000);
+
+#if !CONFIG_FREERTOS_UNICORE
+
+constexpr uint32_t spi_flows = 3;
+constexpr uint32_t spi_transfers = 16;
+
+struct SpiRun {
+    spi_device_handle_t device;
+    TaskHandle_t bench;
+    std::atomic<uint32_t> running{0};
+    std::atomic<uint32_t> errors{0};
+};
+
+coro::Task<void> spi_flow(coro::Scheduler &sched, SpiRun &run)
+{
+    uint8_t tx[4] = {0x5a, 0xa5, 0x0f, 0xf0};
+    for (uint32_t i = 0; i < spi_transfers; ++i) {
+        spi_transaction_t trans = {};
+        trans.length = 8 * sizeof(tx);
+        trans.tx_buffer = tx;
+        if (co_await coro::spi_transfer(sched, run.device, &trans) != ESP_OK) {
+            run.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (run.running.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        xTaskNotifyGive(run.bench);
+    }
+}
+
+void bench_coro_spi_cross_core(perf_bench::State &state)
+{
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = -1;
+    bus.miso_io_num = -1;
+    bus.sclk_io_num = -1;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = 64;
+    /* The bus ISR is allocated on this core. */
+    if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+        state.skip("SPI2 bus unavailable");
+        return;
+    }
+    spi_device_interface_config_t interface = {};
+    interface.clock_speed_hz = 20 * 1000 * 1000;
+    interface.spics_io_num = -1;
+    interface.queue_size = spi_flows;
+    interface.post_cb = coro::spi_post_transfer;
+    SpiRun run;
+    run.bench = xTaskGetCurrentTaskHandle();
+    if (spi_bus_add_device(SPI2_HOST, &interface, &run.device) != ESP_OK) {
+        spi_bus_free(SPI2_HOST);
+        state.skip("spi_bus_add_device failed");
+        return;
+    }
+    coro::Scheduler sched;
+    coro::Scheduler::Config config;
+    config.priority = uxTaskPriorityGet(nullptr);
+    config.core = xPortGetCoreID() == 0 ? 1 : 0;
+    config.enable_io = false;
+    if (sched.init(config) != ESP_OK) {
+        spi_bus_remove_device(run.device);
+        spi_bus_free(SPI2_HOST);
+        state.skip("scheduler init failed");
+        return;
+    }
+    for (auto _ : state) {
+        run.running.store(spi_flows, std::memory_order_relaxed);
+        for (uint32_t f = 0; f < spi_flows; ++f) {
+            sched.spawn(spi_flow(sched, run));
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    state.set_items_per_iteration(spi_flows * spi_transfers);
+    sched.deinit();
+    spi_bus_remove_device(run.device);
+    spi_bus_free(SPI2_HOST);
+    if (run.errors.load(std::memory_order_relaxed) != 0) {
+        state.skip("a transfer lost its result");
+    }
+}
+PERF_BENCH(bench_coro_spi_cross_core, 200);
+
+#endif // !CONFIG_FREERTOS_UNICORE
+
+} // namespace
@@ -0,0 +1,422 @@
+/*
+ * Dataflow graph: a small IMU/magnetometer fusion with thirteen derived
+ * quantities, recomputed eagerly on every sample against the lazy graph
+ * with 1, 3 or all 13 outputs subscribed (the case argument). Samples
+ * cycle through a fixed noisy sequence, so some outputs (the rounded
+ * heading, the flags) keep their value from one sample to the next. These
+ * nodes cost a few dozen cycles each, about what the graph spends per node.
+ *
+ * Then nodes that cost thousands of cycles: Goertzel energies of eight
+ * bands over a frame of audio, and the loudest band. Computed eagerly,
+ * through the graph with one band or the loudest band subscribed (the case
+ * argument, 1 or 8), and with an executor, so the level of eight bands
+ * crosses parallel_threshold_cycles and runs on both cores.
+ */
+#include <cmath>
+#include <cstdint>
+
+#include "dataflow/graph.hpp"
+#include "executor/executor.hpp"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+namespace {
+
+struct V3 {
+    float x, y, z;
+};
+
+constexpr size_t sample_count = 64;
+
+V3 accel_samples[sample_count];
+V3 gyro_samples[sample_count];
+V3 mag_samples[sample_count];
+
+void make_samples()
+{
+    uint32_t seed = 12345;
+    auto noise = [&seed] {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<float>(static_cast<int32_t>(seed >> 8) % 1000) * 1e-4f;
+    };
+    for (size_t i = 0; i < sample_count; ++i) {
+        accel_samples[i] = {0.1f + noise(), -0.2f + noise(), 9.8f + noise()};
+        gyro_samples[i] = {noise(), noise(), 0.01f + noise()};
+        mag_samples[i] = {22.0f + noise(), 5.0f + noise(), -40.0f + noise()};
+    }
+}
+
+float norm(const V3 &v)
+{
+    return sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+}
+
+V3 scale(const V3 &v, float n)
+{
+    float k = n > 0.0f ? 1.0f / n : 0.0f;
+    return {v.x * k, v.y * k, v.z * k};
+}
+
+/* Every derived quantity, as the eager baseline computes them each sample. */
+struct Fusion {
+    float accel_norm, gyro_norm, mag_norm;
+    V3 accel_unit, mag_unit;
+    float roll, pitch, heading, dip, tilt;
+    int16_t heading_deg;
+    bool moving, shock;
+};
+
+float heading_of(const V3 &m, float roll, float pitch)
+{
+    float xh = m.x * cosf(pitch) + m.z * sinf(pitch);
+    float yh = m.x * sinf(roll) * sinf(pitch) + m.y * cosf(roll) - m.z * sinf(roll) * cosf(pitch);
+    return atan2f(-yh, xh);
+}
+
+float dip_of(const V3 &a, const V3 &m)
+{
+    return asinf(a.x * m.x + a.y * m.y + a.z * m.z);
+}
+
+void fuse_eager(const V3 &a, const V3 &g, const V3 &m, Fusion &f)
+{
+    f.accel_norm = norm(a);
+    f.gyro_norm = norm(g);
+    f.mag_norm = norm(m);
+    f.accel_unit = scale(a, f.accel_norm);
+    f.mag_unit = scale(m, f.mag_norm);
+    f.roll = atan2f(f.accel_unit.y, f.accel_unit.z);
+    f.pitch = atan2f(-f.accel_unit.x, sqrtf(f.accel_unit.y * f.accel_unit.y + f.accel_unit.z * f.accel_unit.z));
+    f.heading = heading_of(f.mag_unit, f.roll, f.pitch);
+    f.dip = dip_of(f.accel_unit, f.mag_unit);
+    f.tilt = acosf(f.accel_unit.z);
+    f.heading_deg = static_cast<int16_t>(lrintf(f.heading * 57.29578f));
+    f.moving = f.gyro_norm > 0.2f;
+    f.shock = f.accel_norm > 20.0f;
+}
+
+void node_norm(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<float *>(out) = norm(in.get<V3>(0));
+}
+
+void node_unit(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<V3 *>(out) = scale(in.get<V3>(0), in.get<float>(1));
+}
+
+void node_roll(void *, const dataflow::Inputs &in, void *out)
+{
+    const V3 &u = in.get<V3>(0);
+    *static_cast<float *>(out) = atan2f(u.y, u.z);
+}
+
+void node_pitch(void *, const dataflow::Inputs &in, void *out)
+{
+    const V3 &u = in.get<V3>(0);
+    *static_cast<float *>(out) = atan2f(-u.x, sqrtf(u.y * u.y + u.z * u.z));
+}
+
+void node_heading(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<float *>(out) = heading_of(in.get<V3>(0), in.get<float>(1), in.get<float>(2));
+}
+
+void node_dip(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<float *>(out) = dip_of(in.get<V3>(0), in.get<V3>(1));
+}
+
+void node_tilt(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<float *>(out) = acosf(in.get<V3>(0).z);
+}
+
+void node_degrees(void *, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<int16_t *>(out) = static_cast<int16_t>(lrintf(in.get<float>(0) * 57.29578f));
+}
+
+void node_above(void *ctx, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<bool *>(out) = in.get<float>(0) > *static_cast<const float *>(ctx);
+}
+
+float moving_threshold = 0.2f;
+float shock_threshold = 20.0f;
+
+struct FusionGraph {
+    dataflow::Graph graph;
+    dataflow::NodeId accel, gyro, mag;
+    dataflow::NodeId outputs[13];
+    /* The subsets of the case argument take the shock flag first, then motion, then the heading. */
+    dataflow::NodeId shock, moving, heading_deg;
+
+    esp_err_t build()
+    {
+        dataflow::Graph::Config config;
+        esp_err_t err = graph.init(config);
+        dataflow::Graph &g = graph;
+        dataflow::NodeId an, gn, mn, au, mu, roll, pitch, heading, dip, tilt;
+        if (err == ESP_OK) {
+            err = g.add_source<V3>("accel", &accel);
+        }
+        if (err == ESP_OK) {
+            err = g.add_source<V3>("gyro", &gyro);
+        }
+        if (err == ESP_OK) {
+            err = g.add_source<V3>("mag", &mag);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("accel_norm", node_norm, nullptr, {accel}, &an);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("gyro_norm", node_norm, nullptr, {gyro}, &gn);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("mag_norm", node_norm, nullptr, {mag}, &mn);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<V3>("accel_unit", node_unit, nullptr, {accel, an}, &au);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<V3>("mag_unit", node_unit, nullptr, {mag, mn}, &mu);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("roll", node_roll, nullptr, {au}, &roll);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("pitch", node_pitch, nullptr, {au}, &pitch);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("heading", node_heading, nullptr, {mu, roll, pitch}, &heading);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("dip", node_dip, nullptr, {au, mu}, &dip);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<float>("tilt", node_tilt, nullptr, {au}, &tilt);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<int16_t>("heading_deg", node_degrees, nullptr, {heading}, &heading_deg);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<bool>("moving", node_above, &moving_threshold, {gn}, &moving);
+        }
+        if (err == ESP_OK) {
+            err = g.add_node<bool>("shock", node_above, &shock_threshold, {an}, &shock);
+        }
+        if (err != ESP_OK) {
+            graph.deinit();
+            return err;
+        }
+        dataflow::NodeId all[] = {an, gn, mn, au, mu, roll, pitch, heading, dip, tilt, heading_deg, moving, shock};
+        for (size_t i = 0; i < 13; ++i) {
+            outputs[i] = all[i];
+        }
+        return ESP_OK;
+    }
+};
+
+void bench_dataflow_eager(perf_bench::State &state)
+{
+    make_samples();
+    Fusion f = {};
+    size_t i = 0;
+    for (auto _ : state) {
+        fuse_eager(accel_samples[i], gyro_samples[i], mag_samples[i], f);
+        perf_bench::do_not_optimize(f);
+        i = (i + 1) % sample_count;
+    }
+}
+PERF_BENCH(bench_dataflow_eager, 2000);
+
+void bench_dataflow_lazy(perf_bench::State &state)
+{
+    make_samples();
+    static FusionGraph fg;
+    if (fg.graph.node_count() == 0 && fg.build() != ESP_OK) {
+        state.skip("graph init failed");
+        return;
+    }
+    dataflow::Graph &g = fg.graph;
+    for (size_t n = 0; n < 13; ++n) {
+        g.unsubscribe(fg.outputs[n]);
+    }
+    if (state.arg() == 13) {
+        for (size_t n = 0; n < 13; ++n) {
+            g.subscribe(fg.outputs[n]);
+        }
+    } else {
+        dataflow::NodeId subset[] = {fg.shock, fg.moving, fg.heading_deg};
+        for (int64_t n = 0; n < state.arg(); ++n) {
+            g.subscribe(subset[n]);
+        }
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        g.set(fg.accel, accel_samples[i]);
+        g.set(fg.gyro, gyro_samples[i]);
+        g.set(fg.mag, mag_samples[i]);
+        g.update();
+        perf_bench::clobber_memory();
+        i = (i + 1) % sample_count;
+    }
+}
+PERF_BENCH_ARGS(bench_dataflow_lazy, 2000, 1, 3, 13);
+
+constexpr size_t frame_len = 1024;
+constexpr size_t frame_count = 4;
+constexpr size_t band_count = 8;
+
+float frames[frame_count][frame_len];
+/* 2 cos(2 pi f / fs) for each band. */
+float band_coeff[band_count];
+
+void make_frames()
+{
+    uint32_t seed = 777;
+    for (size_t f = 0; f < frame_count; ++f) {
+        for (size_t i = 0; i < frame_len; ++i) {
+            seed = seed * 1664525u + 1013904223u;
+            float t = static_cast<float>(i) / 16000.0f;
+            frames[f][i] = sinf(6.2831853f * (440.0f * (1 + f)) * t) +
+                           static_cast<float>(static_cast<int32_t>(seed >> 8) % 1000) * 1e-4f;
+        }
+    }
+    for (size_t b = 0; b < band_count; ++b) {
+        band_coeff[b] = 2.0f * cosf(6.2831853f * (250.0f * (b + 1)) / 16000.0f);
+    }
+}
+
+float band_energy(const float *x, float coeff)
+{
+    float s1 = 0.0f;
+    float s2 = 0.0f;
+    for (size_t i = 0; i < frame_len; ++i) {
+        float s0 = x[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+uint8_t loudest(const float *energy)
+{
+    uint8_t best = 0;
+    for (uint8_t b = 1; b < band_count; ++b) {
+        if (energy[b] > energy[best]) {
+            best = b;
+        }
+    }
+    return best;
+}
+
+void node_band(void *ctx, const dataflow::Inputs &in, void *out)
+{
+    *static_cast<float *>(out) = band_energy(frames[in.get<uint32_t>(0)], *static_cast<const float *>(ctx));
+}
+
+void node_loudest(void *, const dataflow::Inputs &in, void *out)
+{
+    float energy[band_count];
+    for (size_t b = 0; b < band_count; ++b) {
+        energy[b] = in.get<float>(b);
+    }
+    *static_cast<uint8_t *>(out) = loudest(energy);
+}
+
+struct BandGraph {
+    dataflow::Graph graph;
+    dataflow::NodeId frame;
+    dataflow::NodeId bands[band_count];
+    dataflow::NodeId peak;
+
+    esp_err_t build(executor::Executor *executor)
+    {
+        dataflow::Graph::Config config;
+        config.executor = executor;
+        esp_err_t err = graph.init(config);
+        if (err == ESP_OK) {
+            err = graph.add_source<uint32_t>("frame", &frame);
+        }
+        for (size_t b = 0; b < band_count && err == ESP_OK; ++b) {
+            err = graph.add_node<float>("band", node_band, &band_coeff[b], {frame}, &bands[b]);
+        }
+        if (err == ESP_OK) {
+            dataflow::NodeSpec spec;
+            spec.name = "loudest";
+            spec.size = sizeof(uint8_t);
+            spec.compute = node_loudest;
+            spec.inputs = bands;
+            spec.input_count = band_count;
+            err = graph.add_node(spec, &peak);
+        }
+        if (err != ESP_OK) {
+            graph.deinit();
+        }
+        return err;
+    }
+};
+
+void run_bands(perf_bench::State &state, executor::Executor *executor)
+{
+    make_frames();
+    BandGraph bg;
+    if (bg.build(executor) != ESP_OK) {
+        state.skip("graph init failed");
+        return;
+    }
+    bg.graph.subscribe(state.arg() == 1 ? bg.bands[0] : bg.peak);
+    /* Let the graph measure its nodes before the timed loop. */
+    for (uint32_t f = 0; f < 16; ++f) {
+        bg.graph.set(bg.frame, f % frame_count);
+        bg.graph.update();
+    }
+    uint32_t f = 0;
+    for (auto _ : state) {
+        bg.graph.set(bg.frame, f);
+        bg.graph.update();
+        perf_bench::clobber_memory();
+        f = (f + 1) % frame_count;
+    }
+}
+
+void bench_dataflow_bands_eager(perf_bench::State &state)
+{
+    make_frames();
+    uint32_t f = 0;
+    for (auto _ : state) {
+        float energy[band_count];
+        for (size_t b = 0; b < band_count; ++b) {
+            energy[b] = band_energy(frames[f], band_coeff[b]);
+        }
+        uint8_t peak = loudest(energy);
+        perf_bench::do_not_optimize(peak);
+        f = (f + 1) % frame_count;
+    }
+}
+PERF_BENCH(bench_dataflow_bands_eager, 200);
+
+void bench_dataflow_bands(perf_bench::State &state)
+{
+    run_bands(state, nullptr);
+}
+PERF_BENCH_ARGS(bench_dataflow_bands, 200, 1, 8);
+
+#if !CONFIG_FREERTOS_UNICORE
+
+void bench_dataflow_bands_parallel(perf_bench::State &state)
+{
+    static executor::Executor ex;
+    if (ex.worker_count() == 0 && ex.init({}) != ESP_OK) {
+        state.skip("executor init failed");
+        return;
+    }
+    run_bands(state, &ex);
+}
+PERF_BENCH_ARGS(bench_dataflow_bands_parallel, 200, 8);
+
+#endif // !CONFIG_FREERTOS_UNICORE
+
+} // namespace
@@ -0,0 +1,210 @@
+/*
+ * DSP kernels, reported per sample (cycles_per_item). Each vectorised kernel
+ * also runs through its scalar implementation, so on the S3 the pair shows
+ * the PIE speed-up and elsewhere the two rows should match.
+ */
+#include <cstdint>
+
+#include "dsp_kernels/biquad.hpp"
+#include "dsp_kernels/fft.hpp"
+#include "dsp_kernels/fir.hpp"
+#include "dsp_kernels/vector.hpp"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+constexpr size_t max_len = 1024;
+constexpr size_t block = 256;
+
+dsp_kernels::AlignedArray<float, max_len> f32_a;
+dsp_kernels::AlignedArray<float, max_len> f32_b;
+dsp_kernels::AlignedArray<int16_t, max_len> q15_a;
+dsp_kernels::AlignedArray<int16_t, max_len> q15_b;
+dsp_kernels::AlignedArray<int8_t, max_len> s8_a;
+dsp_kernels::AlignedArray<int8_t, max_len> s8_b;
+
+/* Deterministic non-trivial signal so nothing folds to a constant. */
+void fill_inputs()
+{
+    static bool filled = false;
+    if (filled) {
+        return;
+    }
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < max_len; ++i) {
+        x = x * 1664525u + 1013904223u;
+        q15_a[i] = static_cast<int16_t>(x >> 16);
+        q15_b[i] = static_cast<int16_t>(x);
+        s8_a[i] = static_cast<int8_t>(x >> 24);
+        s8_b[i] = static_cast<int8_t>(x >> 8);
+        f32_a[i] = static_cast<float>(q15_a[i]) / 32768.0f;
+        f32_b[i] = static_cast<float>(q15_b[i]) / 32768.0f;
+    }
+    filled = true;
+}
+
+template <typename T, typename Kernel>
+void run_dot(perf_bench::State &state, const T *a, const T *b, Kernel kernel)
+{
+    fill_inputs();
+    size_t n = static_cast<size_t>(state.arg());
+    for (auto _ : state) {
+        auto r = kernel(a, b, n);
+        perf_bench::do_not_optimize(r);
+    }
+    state.set_items_per_iteration(n);
+}
+
+void bench_dsp_dot_f32(perf_bench::State &state)
+{
+    run_dot(state, f32_a.data(), f32_b.data(),
+            [](const float *a, const float *b, size_t n) { return dsp_kernels::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_f32, 1000, 64, 256, 1024);
+
+void bench_dsp_dot_f32_scalar(perf_bench::State &state)
+{
+    run_dot(state, f32_a.data(), f32_b.data(),
+            [](const float *a, const float *b, size_t n) { return dsp_kernels::scalar::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_f32_scalar, 1000, 64, 256, 1024);
+
+void bench_dsp_dot_q15(perf_bench::State &state)
+{
+    run_dot(state, q15_a.data(), q15_b.data(),
+            [](const int16_t *a, const int16_t *b, size_t n) { return dsp_kernels::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_q15, 1000, 64, 256, 1024);
+
+void bench_dsp_dot_q15_scalar(perf_bench::State &state)
+{
+    run_dot(state, q15_a.data(), q15_b.data(),
+            [](const int16_t *a, const int16_t *b, size_t n) { return dsp_kernels::scalar::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_q15_scalar, 1000, 64, 256, 1024);
+
+void bench_dsp_dot_s8(perf_bench::State &state)
+{
+    run_dot(state, s8_a.data(), s8_b.data(),
+            [](const int8_t *a, const int8_t *b, size_t n) { return dsp_kernels::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_s8, 1000, 64, 256, 1024);
+
+void bench_dsp_dot_s8_scalar(perf_bench::State &state)
+{
+    run_dot(state, s8_a.data(), s8_b.data(),
+            [](const int8_t *a, const int8_t *b, size_t n) { return dsp_kernels::scalar::dot_product(a, b, n); });
+}
+PERF_BENCH_ARGS(bench_dsp_dot_s8_scalar, 1000, 64, 256, 1024);
+
+/* The case argument is the tap count; every iteration filters one block. */
+template <typename T>
+void run_fir(perf_bench::State &state, const T *coeffs, T *samples, bool force_scalar)
+{
+    fill_inputs();
+    dsp_kernels::Fir<T> fir;
+    typename dsp_kernels::Fir<T>::Config config;
+    config.coeffs = coeffs;
+    config.taps = static_cast<size_t>(state.arg());
+    config.max_block = block;
+    config.force_scalar = force_scalar;
+    if (fir.init(config) != ESP_OK) {
+        state.skip("fir init failed");
+        return;
+    }
+    static dsp_kernels::AlignedArray<T, block> out;
+    for (auto _ : state) {
+        fir.process(samples, out.data(), block);
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(block);
+}
+
+void bench_dsp_fir_f32(perf_bench::State &state)
+{
+    run_fir(state, f32_b.data(), f32_a.data(), false);
+}
+PERF_BENCH_ARGS(bench_dsp_fir_f32, 50, 16, 64);
+
+void bench_dsp_fir_f32_scalar(perf_bench::State &state)
+{
+    run_fir(state, f32_b.data(), f32_a.data(), true);
+}
+PERF_BENCH_ARGS(bench_dsp_fir_f32_scalar, 50, 16, 64);
+
+void bench_dsp_fir_q15(perf_bench::State &state)
+{
+    run_fir(state, q15_b.data(), q15_a.data(), false);
+}
+PERF_BENCH_ARGS(bench_dsp_fir_q15, 50, 16, 64);
+
+void bench_dsp_fir_q15_scalar(perf_bench::State &state)
+{
+    run_fir(state, q15_b.data(), q15_a.data(), true);
+}
+PERF_BENCH_ARGS(bench_dsp_fir_q15_scalar, 50, 16, 64);
+
+void bench_dsp_biquad_cascade4(perf_bench::State &state)
+{
+    fill_inputs();
+    dsp_kernels::BiquadCascade<4> filter;
+    for (size_t i = 0; i < 4; ++i) {
+        filter.set(i, dsp_kernels::biquad_lowpass(0.05f + 0.05f * i, 0.707f));
+    }
+    static dsp_kernels::AlignedArray<float, block> out;
+    for (auto _ : state) {
+        filter.process(f32_a.data(), out.data(), block);
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(block);
+}
+PERF_BENCH(bench_dsp_biquad_cascade4, 100);
+
+/* The case argument is the transform size; items are complex points. */
+void bench_dsp_fft_f32(perf_bench::State &state)
+{
+    fill_inputs();
+    size_t n = static_cast<size_t>(state.arg());
+    dsp_kernels::Fft fft;
+    dsp_kernels::AlignedBuffer<dsp_kernels::Complex> data;
+    if (fft.init(n) != ESP_OK || data.init(n) != ESP_OK) {
+        state.skip("fft init failed");
+        return;
+    }
+    for (auto _ : state) {
+        state.pause();
+        for (size_t i = 0; i < n; ++i) {
+            data[i] = {f32_a[i], 0.0f};
+        }
+        state.resume();
+        fft.forward(data.data());
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(n);
+}
+PERF_BENCH_ARGS(bench_dsp_fft_f32, 50, 256, 1024);
+
+void bench_dsp_q15_to_float(perf_bench::State &state)
+{
+    fill_inputs();
+    for (auto _ : state) {
+        dsp_kernels::q15_to_float(q15_a.data(), f32_b.data(), block);
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(block);
+}
+PERF_BENCH(bench_dsp_q15_to_float, 500);
+
+void bench_dsp_float_to_q15(perf_bench::State &state)
+{
+    fill_inputs();
+    static dsp_kernels::AlignedArray<int16_t, block> out;
+    for (auto _ : state) {
+        dsp_kernels::float_to_q15(f32_a.data(), out.data(), block);
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(block);
+}
+PERF_BENCH(bench_dsp_float_to_q15, 500);
+
+} // namespace
@@ -0,0 +1,152 @@
+/*
+ * Work-stealing executor: a compute kernel run serially and through
+ * parallel_for (the case argument is the grain in elements), submit/get
+ * round-trip latency, and a fan-out of small jobs against creating one
+ * FreeRTOS task per job.
+ */
+#include <atomic>
+#include <cstdint>
+
+#include "executor/executor.hpp"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+constexpr size_t kernel_len = 4096;
+constexpr size_t fanout = 16;
+
+executor::Executor *shared_executor()
+{
+    static executor::Executor ex;
+    if (ex.worker_count() == 0 && ex.init({}) != ESP_OK) {
+        return nullptr;
+    }
+    return &ex;
+}
+
+uint32_t samples[kernel_len];
+uint32_t results[kernel_len];
+
+/* A few dozen cycles per element of pure ALU work, with no shared writes. */
+void kernel(size_t lo, size_t hi)
+{
+    for (size_t i = lo; i < hi; ++i) {
+        uint32_t x = samples[i] | 1;
+        for (int r = 0; r < 8; ++r) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+        }
+        results[i] = x;
+    }
+}
+
+void bench_executor_kernel_serial(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        kernel(0, kernel_len);
+        perf_bench::clobber_memory();
+    }
+    perf_bench::do_not_optimize(results);
+    state.set_items_per_iteration(kernel_len);
+}
+PERF_BENCH(bench_executor_kernel_serial, 100);
+
+void bench_executor_parallel_for(perf_bench::State &state)
+{
+    executor::Executor *ex = shared_executor();
+    if (ex == nullptr) {
+        state.skip("executor init failed");
+        return;
+    }
+    size_t grain = static_cast<size_t>(state.arg());
+    for (auto _ : state) {
+        ex->parallel_for(0, kernel_len, grain, kernel);
+        perf_bench::clobber_memory();
+    }
+    perf_bench::do_not_optimize(results);
+    state.set_items_per_iteration(kernel_len);
+}
+PERF_BENCH_ARGS(bench_executor_parallel_for, 100, 64, 256, 1024);
+
+/* One job submitted and waited for: queueing, wakeup and completion costs. */
+void bench_executor_submit_get(perf_bench::State &state)
+{
+    executor::Executor *ex = shared_executor();
+    if (ex == nullptr) {
+        state.skip("executor init failed");
+        return;
+    }
+    uint32_t sum = 0;
+    for (auto _ : state) {
+        sum += ex->submit([&sum] { return sum + 1; }).get();
+    }
+    perf_bench::do_not_optimize(sum);
+}
+PERF_BENCH(bench_executor_submit_get, 2000);
+
+void bench_executor_fanout16(perf_bench::State &state)
+{
+    executor::Executor *ex = shared_executor();
+    if (ex == nullptr) {
+        state.skip("executor init failed");
+        return;
+    }
+    constexpr size_t slice = kernel_len / fanout;
+    for (auto _ : state) {
+        executor::Future<void> jobs[fanout];
+        for (size_t i = 0; i < fanout; ++i) {
+            jobs[i] = ex->submit([i] { kernel(i * slice, (i + 1) * slice); });
+        }
+        for (auto &job : jobs) {
+            job.wait();
+        }
+    }
+    state.set_items_per_iteration(kernel_len);
+}
+PERF_BENCH(bench_executor_fanout16, 100);
+
+/* Baseline for fanout16: the same slices, each on a freshly created task. */
+struct TaskSlice {
+    size_t lo;
+    size_t hi;
+    std::atomic<uint32_t> *remaining;
+    TaskHandle_t waiter;
+};
+
+void slice_task(void *arg)
+{
+    auto *job = static_cast<TaskSlice *>(arg);
+    kernel(job->lo, job->hi);
+    TaskHandle_t waiter = job->waiter;
+    if (job->remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        xTaskNotifyGive(waiter);
+    }
+    vTaskDelete(nullptr);
+}
+
+void bench_task_per_job_fanout16(perf_bench::State &state)
+{
+    constexpr size_t slice = kernel_len / fanout;
+    TaskSlice jobs[fanout];
+    std::atomic<uint32_t> remaining{0};
+    for (auto _ : state) {
+        remaining.store(fanout, std::memory_order_relaxed);
+        for (size_t i = 0; i < fanout; ++i) {
+            jobs[i] = {i * slice, (i + 1) * slice, &remaining, xTaskGetCurrentTaskHandle()};
+            if (xTaskCreate(slice_task, "slice", 2048, &jobs[i], uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+                kernel(jobs[i].lo, jobs[i].hi);
+                remaining.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+    state.set_items_per_iteration(kernel_len);
+}
+PERF_BENCH(bench_task_per_job_fanout16, 100);
+
+} // namespace
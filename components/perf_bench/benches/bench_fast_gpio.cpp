@@ -0,0 +1,76 @@
+/*
+ * One high/low pulse per iteration on PERF_BENCH_GPIO_PIN: gpio_set_level()
+ * against fast_gpio's direct register stores and, where the core has them,
+ * dedicated GPIO channels. Leave the pin unconnected or on a logic analyser.
+ */
+#include "driver/gpio.h"
+#include "fast_gpio/dedicated.hpp"
+#include "fast_gpio/pin.hpp"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+namespace {
+
+constexpr int pin = CONFIG_PERF_BENCH_GPIO_PIN;
+using BenchPin = fast_gpio::Pin<pin, fast_gpio::Mode::Output>;
+
+void bench_gpio_set_level(perf_bench::State &state)
+{
+    if (BenchPin::init() != ESP_OK) {
+        state.skip("gpio_config failed");
+        return;
+    }
+    auto num = static_cast<gpio_num_t>(pin);
+    for (auto _ : state) {
+        gpio_set_level(num, 1);
+        gpio_set_level(num, 0);
+    }
+}
+PERF_BENCH(bench_gpio_set_level, 100000);
+
+void bench_fast_gpio_pin(perf_bench::State &state)
+{
+    if (BenchPin::init() != ESP_OK) {
+        state.skip("gpio_config failed");
+        return;
+    }
+    for (auto _ : state) {
+        BenchPin::set();
+        BenchPin::clear();
+    }
+}
+PERF_BENCH(bench_fast_gpio_pin, 100000);
+
+void bench_fast_gpio_toggle(perf_bench::State &state)
+{
+    if (BenchPin::init() != ESP_OK) {
+        state.skip("gpio_config failed");
+        return;
+    }
+    for (auto _ : state) {
+        BenchPin::toggle();
+        BenchPin::toggle();
+    }
+}
+PERF_BENCH(bench_fast_gpio_toggle, 100000);
+
+#if SOC_DEDICATED_GPIO_SUPPORTED
+
+void bench_fast_gpio_dedicated(perf_bench::State &state)
+{
+    using Bundle = fast_gpio::DedicatedBundle<0, pin>;
+    Bundle bundle;
+    if (bundle.init() != ESP_OK) {
+        state.skip("dedicated GPIO channel 0 unavailable");
+        return;
+    }
+    for (auto _ : state) {
+        Bundle::write(1);
+        Bundle::write(0);
+    }
+}
+PERF_BENCH(bench_fast_gpio_dedicated, 100000);
+
+#endif
+
+} // namespace
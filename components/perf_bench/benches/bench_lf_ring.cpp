@@ -0,0 +1,265 @@
+/*
+ * lf_ring rings against FreeRTOS queues at several payload sizes (the case
+ * argument is the item size in bytes): single-task round trips, batches of
+ * 16, and a cross-core stream where a producer on the other core feeds the
+ * benchmark task.
+ */
+#include <atomic>
+#include <cstring>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "lf_ring/mpsc_ring.hpp"
+#include "lf_ring/spsc_ring.hpp"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+namespace {
+
+constexpr size_t ring_capacity = 64;
+constexpr size_t batch = 16;
+
+template <size_t N>
+struct Payload {
+    uint8_t bytes[N];
+};
+
+/* Rings are large for the 256-byte case; keep them off the bench task's stack. */
+template <typename Ring>
+Ring &static_ring()
+{
+    static Ring ring;
+    return ring;
+}
+
+template <typename Ring>
+void ring_round_trip(perf_bench::State &state)
+{
+    using Item = typename Ring::value_type;
+    Ring &ring = static_ring<Ring>();
+    Item item = {};
+    for (auto _ : state) {
+        ring.push(item);
+        ring.pop(item);
+    }
+    perf_bench::do_not_optimize(item);
+}
+
+template <size_t N>
+void queue_round_trip(perf_bench::State &state)
+{
+    QueueHandle_t queue = xQueueCreate(ring_capacity, N);
+    if (queue == nullptr) {
+        state.skip("xQueueCreate failed");
+        return;
+    }
+    Payload<N> item = {};
+    for (auto _ : state) {
+        xQueueSend(queue, &item, 0);
+        xQueueReceive(queue, &item, 0);
+    }
+    perf_bench::do_not_optimize(item);
+    vQueueDelete(queue);
+}
+
+template <typename Ring>
+void ring_batch(perf_bench::State &state)
+{
+    using Item = typename Ring::value_type;
+    Ring &ring = static_ring<Ring>();
+    static Item items[batch];
+    for (auto _ : state) {
+        ring.push_n(items, batch);
+        ring.pop_n(items, batch);
+    }
+    state.set_items_per_iteration(batch);
+}
+
+template <size_t N>
+void queue_batch(perf_bench::State &state)
+{
+    QueueHandle_t queue = xQueueCreate(ring_capacity, N);
+    if (queue == nullptr) {
+        state.skip("xQueueCreate failed");
+        return;
+    }
+    static Payload<N> items[batch];
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            xQueueSend(queue, &items[i], 0);
+        }
+        for (size_t i = 0; i < batch; ++i) {
+            xQueueReceive(queue, &items[i], 0);
+        }
+    }
+    state.set_items_per_iteration(batch);
+    vQueueDelete(queue);
+}
+
+/* Instantiate @p Bench for the payload size given as the case argument. */
+#define DISPATCH_PAYLOAD(state, Bench)                 \
+    switch ((state).arg()) {                           \
+    case 4:                                            \
+        Bench(4);                                      \
+        break;                                         \
+    case 16:                                           \
+        Bench(16);                                     \
+        break;                                         \
+    case 64:                                           \
+        Bench(64);                                     \
+        break;                                         \
+    case 256:                                          \
+        Bench(256);                                    \
+        break;                                         \
+    default:                                           \
+        (state).skip("unsupported payload size");      \
+        break;                                         \
+    }
+
+void bench_spsc_ring_round_trip(perf_bench::State &state)
+{
+#define RUN(n) ring_round_trip<lf_ring::SpscRing<Payload<n>, ring_capacity>>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg());
+}
+PERF_BENCH_ARGS(bench_spsc_ring_round_trip, 10000, 4, 16, 64, 256);
+
+void bench_mpsc_ring_round_trip(perf_bench::State &state)
+{
+#define RUN(n) ring_round_trip<lf_ring::MpscRing<Payload<n>, ring_capacity>>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg());
+}
+PERF_BENCH_ARGS(bench_mpsc_ring_round_trip, 10000, 4, 16, 64, 256);
+
+void bench_queue_round_trip(perf_bench::State &state)
+{
+#define RUN(n) queue_round_trip<n>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg());
+}
+PERF_BENCH_ARGS(bench_queue_round_trip, 10000, 4, 16, 64, 256);
+
+void bench_spsc_ring_batch16(perf_bench::State &state)
+{
+#define RUN(n) ring_batch<lf_ring::SpscRing<Payload<n>, ring_capacity>>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg() * batch);
+}
+PERF_BENCH_ARGS(bench_spsc_ring_batch16, 1000, 4, 16, 64, 256);
+
+void bench_mpsc_ring_batch16(perf_bench::State &state)
+{
+#define RUN(n) ring_batch<lf_ring::MpscRing<Payload<n>, ring_capacity>>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg() * batch);
+}
+PERF_BENCH_ARGS(bench_mpsc_ring_batch16, 1000, 4, 16, 64, 256);
+
+void bench_queue_batch16(perf_bench::State &state)
+{
+#define RUN(n) queue_batch<n>(state)
+    DISPATCH_PAYLOAD(state, RUN)
+#undef RUN
+    state.set_bytes_per_iteration(state.arg() * batch);
+}
+PERF_BENCH_ARGS(bench_queue_batch16, 1000, 4, 16, 64, 256);
+
+#if !CONFIG_FREERTOS_UNICORE
+
+using StreamItem = Payload<16>;
+using StreamRing = lf_ring::SpscRing<StreamItem, ring_capacity>;
+
+/* Completion is a flag rather than a task notification, which the
+ * ring already uses to wake the consumer. */
+struct StreamJob {
+    StreamRing *ring;
+    QueueHandle_t queue;
+    uint32_t count;
+    std::atomic<bool> finished;
+};
+
+void wait_finished(StreamJob &job)
+{
+    while (!job.finished.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+}
+
+void ring_producer(void *arg)
+{
+    auto *job = static_cast<StreamJob *>(arg);
+    StreamItem item = {};
+    for (uint32_t i = 0; i < job->count;) {
+        if (job->ring->push(item)) {
+            ++i;
+        }
+    }
+    job->finished.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void queue_producer(void *arg)
+{
+    auto *job = static_cast<StreamJob *>(arg);
+    StreamItem item = {};
+    for (uint32_t i = 0; i < job->count; ++i) {
+        xQueueSend(job->queue, &item, portMAX_DELAY);
+    }
+    job->finished.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+BaseType_t other_core()
+{
+    return xPortGetCoreID() == 0 ? 1 : 0;
+}
+
+/* The producer runs for the whole loop; each iteration receives one item, so
+ * the result is the per-item cost with contention and wakeups included. */
+void bench_spsc_ring_cross_core(perf_bench::State &state)
+{
+    StreamRing &ring = static_ring<StreamRing>();
+    ring.notifier().attach(xTaskGetCurrentTaskHandle());
+    StreamJob job = {&ring, nullptr, state.iterations(), {false}};
+    xTaskCreatePinnedToCore(ring_producer, "ring_prod", 2048, &job, uxTaskPriorityGet(nullptr), nullptr,
+                            other_core());
+    StreamItem item;
+    for (auto _ : state) {
+        ring.pop_wait(item, portMAX_DELAY);
+    }
+    wait_finished(job);
+    ring.notifier().detach();
+    state.set_bytes_per_iteration(sizeof(StreamItem));
+}
+PERF_BENCH(bench_spsc_ring_cross_core, 20000);
+
+void bench_queue_cross_core(perf_bench::State &state)
+{
+    QueueHandle_t queue = xQueueCreate(ring_capacity, sizeof(StreamItem));
+    if (queue == nullptr) {
+        state.skip("xQueueCreate failed");
+        return;
+    }
+    StreamJob job = {nullptr, queue, state.iterations(), {false}};
+    xTaskCreatePinnedToCore(queue_producer, "queue_prod", 2048, &job, uxTaskPriorityGet(nullptr), nullptr,
+                            other_core());
+    StreamItem item;
+    for (auto _ : state) {
+        xQueueReceive(queue, &item, portMAX_DELAY);
+    }
+    wait_finished(job);
+    vQueueDelete(queue);
+    state.set_bytes_per_iteration(sizeof(StreamItem));
+}
+PERF_BENCH(bench_queue_cross_core, 20000);
+
+#endif // !CONFIG_FREERTOS_UNICORE
+
+} // namespace
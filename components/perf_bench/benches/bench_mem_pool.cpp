@@ -0,0 +1,118 @@
+/*
+ * Slab pool and arena costs, to compare with bench_malloc_free /
+ * bench_heap_caps_malloc_internal from the baseline suite.
+ */
+#include <list>
+
+#include "mem_pool/allocator.hpp"
+#include "mem_pool/arena.hpp"
+#include "mem_pool/slab_pool.hpp"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+void bench_slab_pool_alloc_free(perf_bench::State &state)
+{
+    mem_pool::SlabPool pool;
+    mem_pool::SlabPool::Config config;
+    config.block_size = static_cast<size_t>(state.arg());
+    config.block_count = 16;
+    if (pool.init(config) != ESP_OK) {
+        state.skip("pool init failed");
+        return;
+    }
+    for (auto _ : state) {
+        void *p = pool.allocate();
+        perf_bench::do_not_optimize(p);
+        pool.deallocate(p);
+    }
+}
+PERF_BENCH_ARGS(bench_slab_pool_alloc_free, 10000, 16, 64, 256, 1024);
+
+/* Allocate a burst then free it, so the free list is walked rather than
+ * bouncing the same block. */
+void bench_slab_pool_burst(perf_bench::State &state)
+{
+    constexpr size_t burst = 32;
+    mem_pool::SlabPool pool;
+    mem_pool::SlabPool::Config config;
+    config.block_size = 64;
+    config.block_count = burst;
+    if (pool.init(config) != ESP_OK) {
+        state.skip("pool init failed");
+        return;
+    }
+    void *blocks[burst];
+    for (auto _ : state) {
+        for (size_t i = 0; i < burst; ++i) {
+            blocks[i] = pool.allocate();
+        }
+        perf_bench::clobber_memory();
+        for (size_t i = 0; i < burst; ++i) {
+            pool.deallocate(blocks[i]);
+        }
+    }
+    state.set_items_per_iteration(burst);
+}
+PERF_BENCH(bench_slab_pool_burst, 1000);
+
+void bench_arena_alloc_reset(perf_bench::State &state)
+{
+    constexpr size_t allocs = 32;
+    mem_pool::Arena arena;
+    mem_pool::Arena::Config config;
+    config.capacity = allocs * static_cast<size_t>(state.arg()) + 64;
+    if (arena.init(config) != ESP_OK) {
+        state.skip("arena init failed");
+        return;
+    }
+    for (auto _ : state) {
+        for (size_t i = 0; i < allocs; ++i) {
+            perf_bench::do_not_optimize(arena.allocate(static_cast<size_t>(state.arg()), 4));
+        }
+        arena.reset();
+    }
+    state.set_items_per_iteration(allocs);
+}
+PERF_BENCH_ARGS(bench_arena_alloc_reset, 1000, 16, 64, 256);
+
+void bench_list_std_allocator(perf_bench::State &state)
+{
+    constexpr int nodes = 32;
+    for (auto _ : state) {
+        std::list<int> list;
+        for (int i = 0; i < nodes; ++i) {
+            list.push_back(i);
+        }
+        perf_bench::do_not_optimize(list.back());
+    }
+    state.set_items_per_iteration(nodes);
+}
+PERF_BENCH(bench_list_std_allocator, 1000);
+
+void bench_list_pool_allocator(perf_bench::State &state)
+{
+    constexpr int nodes = 32;
+    mem_pool::SlabPool pool;
+    mem_pool::SlabPool::Config config;
+    config.block_size = sizeof(std::list<int>::value_type) + 2 * sizeof(void *);
+    config.block_count = nodes;
+    if (pool.init(config) != ESP_OK) {
+        state.skip("pool init failed");
+        return;
+    }
+    for (auto _ : state) {
+        std::list<int, mem_pool::PoolAllocator<int>> list{mem_pool::PoolAllocator<int>(pool)};
+        for (int i = 0; i < nodes; ++i) {
+            list.push_back(i);
+        }
+        perf_bench::do_not_optimize(list.back());
+    }
+    state.set_items_per_iteration(nodes);
+    if (pool.stats().fallbacks != 0) {
+        state.skip("list node did not fit the pool block");
+    }
+}
+PERF_BENCH(bench_list_pool_allocator, 1000);
+
+} // namespace
@@ -0,0 +1,149 @@
+/*
+ * Recording cost of metrics counters, gauges and histograms against a plain
+ * 64-bit std::atomic counter, 16 records per iteration. The cross-core cases
+ * keep a task on the other core adding to the same metric, so the per-core
+ * slots of metrics::Counter are compared with one shared word. The render
+ * case writes the whole registry as Prometheus text.
+ */
+#include <atomic>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics/export.hpp"
+#include "metrics/metrics.hpp"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+
+namespace {
+
+constexpr size_t batch = 16;
+
+constinit metrics::Counter counter{"bench_counter_total", "perf_bench counter"};
+METRICS_REGISTER(counter);
+constinit metrics::Gauge gauge{"bench_gauge", "perf_bench gauge"};
+METRICS_REGISTER(gauge);
+constinit metrics::Histogram<8> histogram{
+    "bench_histogram_cycles", "perf_bench histogram", {16, 32, 64, 128, 256, 512, 1024, 2048}};
+METRICS_REGISTER(histogram);
+
+std::atomic<uint64_t> atomic_counter{0};
+std::atomic<uint32_t> shared_word{0};
+
+void bench_atomic_u64_add(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            atomic_counter.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    state.set_items_per_iteration(batch);
+}
+PERF_BENCH(bench_atomic_u64_add, 10000);
+
+void bench_metrics_counter_add(perf_bench::State &state)
+{
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            counter.add();
+        }
+    }
+    state.set_items_per_iteration(batch);
+}
+PERF_BENCH(bench_metrics_counter_add, 10000);
+
+void bench_metrics_gauge_set(perf_bench::State &state)
+{
+    int32_t v = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            gauge.set(v++);
+        }
+    }
+    state.set_items_per_iteration(batch);
+}
+PERF_BENCH(bench_metrics_gauge_set, 10000);
+
+/* Samples spread over all nine buckets, so the bound scan is not always short. */
+void bench_metrics_histogram_observe(perf_bench::State &state)
+{
+    uint32_t sample = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            histogram.observe(sample);
+            sample = (sample + 97) & 4095;
+        }
+    }
+    state.set_items_per_iteration(batch);
+}
+PERF_BENCH(bench_metrics_histogram_observe, 10000);
+
+void bench_metrics_prometheus_render(perf_bench::State &state)
+{
+    static char buf[1024];
+    size_t bytes = 0;
+    for (auto _ : state) {
+        metrics::PrometheusReader reader;
+        size_t n;
+        bytes = 0;
+        while ((n = reader.read(buf, sizeof(buf))) != 0) {
+            bytes += n;
+        }
+        perf_bench::do_not_optimize(buf);
+    }
+    state.set_bytes_per_iteration(bytes);
+}
+PERF_BENCH(bench_metrics_prometheus_render, 200);
+
+#if !CONFIG_FREERTOS_UNICORE
+
+struct Contender {
+    void (*add)();
+    std::atomic<bool> stop;
+    std::atomic<bool> finished;
+};
+
+void contend(void *arg)
+{
+    auto *c = static_cast<Contender *>(arg);
+    while (!c->stop.load(std::memory_order_relaxed)) {
+        c->add();
+    }
+    c->finished.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+template <typename F>
+void cross_core(perf_bench::State &state, void (*add)(), F &&record)
+{
+    Contender c = {add, {false}, {false}};
+    xTaskCreatePinnedToCore(contend, "contend", 2048, &c, uxTaskPriorityGet(nullptr), nullptr,
+                            xPortGetCoreID() == 0 ? 1 : 0);
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch; ++i) {
+            record();
+        }
+    }
+    c.stop.store(true, std::memory_order_relaxed);
+    while (!c.finished.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    state.set_items_per_iteration(batch);
+}
+
+void bench_shared_word_add_cross_core(perf_bench::State &state)
+{
+    cross_core(
+        state, [] { shared_word.fetch_add(1, std::memory_order_relaxed); },
+        [] { shared_word.fetch_add(1, std::memory_order_relaxed); });
+}
+PERF_BENCH(bench_shared_word_add_cross_core, 10000);
+
+void bench_metrics_counter_add_cross_core(perf_bench::State &state)
+{
+    cross_core(state, [] { counter.add(); }, [] { counter.add(); });
+}
+PERF_BENCH(bench_metrics_counter_add_cross_core, 10000);
+
+#endif
+
+} // namespace
@@ -0,0 +1,124 @@
+/*
+ * int8 inference on a small vibration anomaly model: a 1D CNN over 128
+ * samples of 4 channels followed by an MLP head. One case runs the whole
+ * model; the per-layer case (argument = layer index) runs one layer and
+ * reports cycles per multiply-accumulate as cycles_per_item (per call for
+ * the pooling layers). Weights are random; timing does not depend
+ * on their values.
+ *
+ *   0  Conv1D 128x4 -> 31x16, kernel 8, stride 4
+ *   1  Conv1D 31x16 -> 29x32, kernel 3
+ *   2  MaxPool1D 29x32 -> 14x32
+ *   3  GlobalAvgPool1D 14x32 -> 32
+ *   4  Dense 32 -> 32, ReLU
+ *   5  Dense 32 -> 16, ReLU
+ *   6  Dense 16 -> 4
+ */
+#include <cmath>
+#include <cstdint>
+
+#include "dsp_kernels/aligned_buffer.hpp"
+#include "nn_int8/model.hpp"
+#include "perf_bench/perf_bench.hpp"
+
+namespace {
+
+using Net = nn_int8::Model<nn_int8::Conv1D<128, 4, 16, 8, 4>, nn_int8::Conv1D<31, 16, 32, 3>,
+                           nn_int8::MaxPool1D<29, 32, 2>, nn_int8::GlobalAvgPool1D<14, 32>, nn_int8::Dense<32, 32>,
+                           nn_int8::Dense<32, 16>, nn_int8::Dense<16, 4>>;
+
+Net net;
+
+uint32_t lcg_state = 0x2545f491;
+
+int8_t next_random()
+{
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return static_cast<int8_t>(lcg_state >> 24);
+}
+
+/* Weights, bias and per-channel requants of one weighted layer, scaled so
+ * random inputs land mid-range instead of saturating. */
+template <typename Layer, size_t Rows, size_t Cols>
+struct Weights {
+    dsp_kernels::AlignedArray<int8_t, Rows * Cols> w;
+    int32_t bias[Rows];
+    nn_int8::Requant requant[Rows];
+
+    esp_err_t init(Layer &layer, int32_t input_zero_point, bool relu)
+    {
+        for (auto &v : w) {
+            v = next_random();
+        }
+        double scale = 1.0 / (48.0 * std::sqrt(static_cast<double>(Cols)));
+        for (size_t r = 0; r < Rows; ++r) {
+            bias[r] = next_random() * 64;
+            requant[r] = nn_int8::make_requant(scale * (1.0 + 0.01 * static_cast<double>(r)));
+        }
+        typename Layer::Config config;
+        config.weights = w.data();
+        config.bias = bias;
+        config.requant = requant;
+        config.input_zero_point = input_zero_point;
+        /* ReLU outputs put real zero at -128, so the clamp is the int8 range. */
+        config.output_zero_point = relu ? -128 : 0;
+        return layer.init(config);
+    }
+};
+
+Weights<Net::layer_type<0>, 16, 8 * 4> conv0;
+Weights<Net::layer_type<1>, 32, 3 * 16> conv1;
+Weights<Net::layer_type<4>, 32, 32> dense4;
+Weights<Net::layer_type<5>, 16, 32> dense5;
+Weights<Net::layer_type<6>, 4, 16> dense6;
+
+bool setup()
+{
+    static bool done = false;
+    if (done) {
+        return true;
+    }
+    if (conv0.init(net.layer<0>(), 0, true) != ESP_OK || conv1.init(net.layer<1>(), -128, true) != ESP_OK ||
+        dense4.init(net.layer<4>(), -128, true) != ESP_OK || dense5.init(net.layer<5>(), -128, true) != ESP_OK ||
+        dense6.init(net.layer<6>(), -128, false) != ESP_OK) {
+        return false;
+    }
+    int8_t *in = net.input();
+    for (size_t i = 0; i < Net::input_size; ++i) {
+        in[i] = next_random();
+    }
+    done = true;
+    return true;
+}
+
+void bench_nn_int8_invoke(perf_bench::State &state)
+{
+    if (!setup()) {
+        state.skip("layer init failed");
+        return;
+    }
+    for (auto _ : state) {
+        net.invoke();
+        perf_bench::clobber_memory();
+    }
+    perf_bench::do_not_optimize(net.output()[0]);
+}
+PERF_BENCH(bench_nn_int8_invoke, 200);
+
+void bench_nn_int8_layer(perf_bench::State &state)
+{
+    if (!setup()) {
+        state.skip("layer init failed");
+        return;
+    }
+    auto index = static_cast<size_t>(state.arg());
+    for (auto _ : state) {
+        net.invoke_layer(index);
+        perf_bench::clobber_memory();
+    }
+    size_t macs = Net::layer_macs(index);
+    state.set_items_per_iteration(macs != 0 ? macs : 1);
+}
+PERF_BENCH_ARGS(bench_nn_int8_layer, 200, 0, 1, 2, 3, 4, 5, 6);
+
+} // namespace
@@ -0,0 +1,240 @@
+/*
+ * session_table against std::map for a gateway's peer sessions. Lookups of
+ * present keys in tables of 64, 256 and 1024 sessions (the case argument);
+ * churn, one put and one erase per iteration at steady occupancy; and
+ * lookups while a task on the other core keeps updating sessions, against
+ * a map behind a mutex with the same writer.
+ */
+#include <atomic>
+#include <map>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "perf_bench/perf_bench.hpp"
+#include "sdkconfig.h"
+#include "session_table/session_table.hpp"
+
+namespace {
+
+struct Session {
+    uint32_t rx_packets;
+    uint32_t tx_packets;
+    uint32_t last_seq;
+    int8_t rssi;
+    uint8_t flags;
+    uint16_t mtu;
+    uint8_t peer_token[16];
+};
+
+using SessionMap = std::map<session_table::Key, Session>;
+
+/* ESP-NOW peers with scattered MACs, the way a gateway sees them. */
+session_table::Key peer_key(uint32_t i)
+{
+    uint8_t mac[6] = {0x24, 0x6f, 0x28, static_cast<uint8_t>(i * 37), static_cast<uint8_t>(i >> 8),
+                      static_cast<uint8_t>(i * 101)};
+    return session_table::mac_key(session_table::Transport::espnow, mac);
+}
+
+bool open_table(perf_bench::State &state, session_table::Table &table, size_t capacity)
+{
+    session_table::Table::Config config;
+    config.name = nullptr;
+    config.capacity = capacity;
+    config.value_size = sizeof(Session);
+    config.idle_timeout_ms = 0;
+    if (table.init(config) != ESP_OK) {
+        state.skip("table init failed");
+        return false;
+    }
+    Session s = {};
+    for (uint32_t i = 0; i < capacity; ++i) {
+        s.last_seq = i;
+        table.put(peer_key(i), &s);
+    }
+    return true;
+}
+
+void fill_map(SessionMap &map, size_t count)
+{
+    Session s = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        s.last_seq = i;
+        map[peer_key(i)] = s;
+    }
+}
+
+void bench_session_table_find(perf_bench::State &state)
+{
+    auto count = static_cast<uint32_t>(state.arg());
+    session_table::Table table;
+    if (!open_table(state, table, count)) {
+        return;
+    }
+    uint32_t i = 0;
+    Session s;
+    for (auto _ : state) {
+        bool found = table.find(peer_key(i), &s);
+        perf_bench::do_not_optimize(found);
+        perf_bench::do_not_optimize(s);
+        i = i + 1 == count ? 0 : i + 1;
+    }
+}
+PERF_BENCH_ARGS(bench_session_table_find, 20000, 64, 256, 1024);
+
+void bench_session_map_find(perf_bench::State &state)
+{
+    auto count = static_cast<uint32_t>(state.arg());
+    SessionMap map;
+    fill_map(map, count);
+    uint32_t i = 0;
+    Session s;
+    for (auto _ : state) {
+        auto it = map.find(peer_key(i));
+        if (it != map.end()) {
+            s = it->second;
+        }
+        perf_bench::do_not_optimize(s);
+        i = i + 1 == count ? 0 : i + 1;
+    }
+}
+PERF_BENCH_ARGS(bench_session_map_find, 20000, 64, 256, 1024);
+
+/* Peers 0..n-2 stay; one more joins and leaves each iteration. */
+void bench_session_table_churn(perf_bench::State &state)
+{
+    auto count = static_cast<uint32_t>(state.arg());
+    session_table::Table table;
+    if (!open_table(state, table, count)) {
+        return;
+    }
+    table.erase(peer_key(count - 1));
+    uint32_t i = count - 1;
+    Session s = {};
+    for (auto _ : state) {
+        table.put(peer_key(i), &s);
+        table.erase(peer_key(i));
+        ++i;
+    }
+}
+PERF_BENCH_ARGS(bench_session_table_churn, 5000, 64, 256, 1024);
+
+void bench_session_map_churn(perf_bench::State &state)
+{
+    auto count = static_cast<uint32_t>(state.arg());
+    SessionMap map;
+    fill_map(map, count - 1);
+    uint32_t i = count - 1;
+    Session s = {};
+    for (auto _ : state) {
+        map[peer_key(i)] = s;
+        map.erase(peer_key(i));
+        ++i;
+    }
+}
+PERF_BENCH_ARGS(bench_session_map_churn, 5000, 64, 256, 1024);
+
+#if !CONFIG_FREERTOS_UNICORE
+
+constexpr uint32_t contended_sessions = 256;
+
+struct WriterJob {
+    session_table::Table *table;
+    SessionMap *map;
+    SemaphoreHandle_t map_lock;
+    std::atomic<bool> stop;
+    std::atomic<bool> finished;
+};
+
+void table_writer(void *arg)
+{
+    auto *job = static_cast<WriterJob *>(arg);
+    uint32_t i = 0;
+    while (!job->stop.load(std::memory_order_acquire)) {
+        job->table->update<Session>(peer_key(i), [](Session &s) { ++s.rx_packets; });
+        i = i + 1 == contended_sessions ? 0 : i + 1;
+    }
+    job->finished.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void map_writer(void *arg)
+{
+    auto *job = static_cast<WriterJob *>(arg);
+    uint32_t i = 0;
+    while (!job->stop.load(std::memory_order_acquire)) {
+        xSemaphoreTake(job->map_lock, portMAX_DELAY);
+        ++(*job->map)[peer_key(i)].rx_packets;
+        xSemaphoreGive(job->map_lock);
+        i = i + 1 == contended_sessions ? 0 : i + 1;
+    }
+    job->finished.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+void stop_writer(WriterJob &job)
+{
+    job.stop.store(true, std::memory_order_release);
+    while (!job.finished.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+}
+
+BaseType_t other_core()
+{
+    return xPortGetCoreID() == 0 ? 1 : 0;
+}
+
+void bench_session_table_find_contended(perf_bench::State &state)
+{
+    session_table::Table table;
+    if (!open_table(state, table, contended_sessions)) {
+        return;
+    }
+    WriterJob job = {&table, nullptr, nullptr, {false}, {false}};
+    xTaskCreatePinnedToCore(table_writer, "table_writer", 3072, &job, uxTaskPriorityGet(nullptr), nullptr,
+                            other_core());
+    uint32_t i = 0;
+    Session s;
+    for (auto _ : state) {
+        bool found = table.find(peer_key(i), &s);
+        perf_bench::do_not_optimize(found);
+        i = i + 1 == contended_sessions ? 0 : i + 1;
+    }
+    stop_writer(job);
+}
+PERF_BENCH(bench_session_table_find_contended, 20000);
+
+void bench_session_map_find_contended(perf_bench::State &state)
+{
+    SessionMap map;
+    fill_map(map, contended_sessions);
+    SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+    if (lock == nullptr) {
+        state.skip("xSemaphoreCreateMutex failed");
+        return;
+    }
+    WriterJob job = {nullptr, &map, lock, {false}, {false}};
+    xTaskCreatePinnedToCore(map_writer, "map_writer", 3072, &job, uxTaskPriorityGet(nullptr), nullptr,
+                            other_core());
+    uint32_t i = 0;
+    Session s;
+    for (auto _ : state) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+        auto it = map.find(peer_key(i));
+        if (it != map.end()) {
+            s = it->second;
+        }
+        xSemaphoreGive(lock);
+        perf_bench::do_not_optimize(s);
+        i = i + 1 == contended_sessions ? 0 : i + 1;
+    }
+    stop_writer(job);
+    vSemaphoreDelete(lock);
+}
+PERF_BENCH(bench_session_map_find_contended, 20000);
+
+#endif // !CONFIG_FREERTOS_UNICORE
+
+} // namespace
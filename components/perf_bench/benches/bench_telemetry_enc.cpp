@@ -0,0 +1,127 @@
+/*
+ * Telemetry encoding of a 32-reading batch: cJSON (tree on the heap, then
+ * printed) against the streaming JSON and CBOR writers into a fixed buffer.
+ * Items are readings; bytes are the encoded size. The host build may lack
+ * cJSON, in which case its case skips.
+ */
+#include <cstdint>
+#include <cstring>
+
+#if __has_include("cJSON.h")
+#include "cJSON.h"
+#define BENCH_HAVE_CJSON 1
+#endif
+#include "perf_bench/perf_bench.hpp"
+#include "telemetry_enc/cbor_writer.hpp"
+#include "telemetry_enc/json_writer.hpp"
+#include "telemetry_enc/schema.hpp"
+
+namespace {
+
+constexpr size_t batch = 32;
+
+struct Reading {
+    uint32_t ts;
+    float temp;
+    float humidity;
+    int16_t rssi;
+    float accel[3];
+};
+
+constexpr auto reading_schema = telemetry_enc::schema<Reading>(
+    telemetry_enc::field("ts", &Reading::ts), telemetry_enc::field("temp", &Reading::temp),
+    telemetry_enc::field("hum", &Reading::humidity), telemetry_enc::field("rssi", &Reading::rssi),
+    telemetry_enc::field("accel", &Reading::accel));
+
+Reading readings[batch];
+uint8_t out_buf[4096];
+
+void fill_readings()
+{
+    for (size_t i = 0; i < batch; ++i) {
+        float f = static_cast<float>(i);
+        readings[i] = {static_cast<uint32_t>(1700000000 + i), 21.5f + f * 0.01f, 45.25f - f * 0.1f,
+                       static_cast<int16_t>(-60 - static_cast<int>(i)), {0.01f * f, -9.81f, 0.5f - 0.02f * f}};
+    }
+}
+
+void bench_telemetry_cjson(perf_bench::State &state)
+{
+#if BENCH_HAVE_CJSON
+    fill_readings();
+    size_t len = 0;
+    for (auto _ : state) {
+        cJSON *root = cJSON_CreateArray();
+        for (const Reading &r : readings) {
+            cJSON *item = cJSON_CreateObject();
+            cJSON_AddNumberToObject(item, "ts", r.ts);
+            cJSON_AddNumberToObject(item, "temp", r.temp);
+            cJSON_AddNumberToObject(item, "hum", r.humidity);
+            cJSON_AddNumberToObject(item, "rssi", r.rssi);
+            cJSON_AddItemToObject(item, "accel", cJSON_CreateFloatArray(r.accel, 3));
+            cJSON_AddItemToArray(root, item);
+        }
+        char *text = cJSON_PrintUnformatted(root);
+        if (text == nullptr) {
+            cJSON_Delete(root);
+            state.skip("cJSON out of memory");
+            return;
+        }
+        len = strlen(text);
+        cJSON_free(text);
+        cJSON_Delete(root);
+    }
+    state.set_items_per_iteration(batch);
+    state.set_bytes_per_iteration(len);
+#else
+    state.skip("built without cJSON");
+#endif
+}
+PERF_BENCH(bench_telemetry_cjson, 50);
+
+template <typename Writer>
+void run_writer(perf_bench::State &state)
+{
+    fill_readings();
+    size_t len = 0;
+    for (auto _ : state) {
+        telemetry_enc::BufferOutput out(out_buf, sizeof(out_buf));
+        Writer w(out);
+        telemetry_enc::encode_array(w, reading_schema, readings, batch);
+        len = out.size();
+        perf_bench::clobber_memory();
+    }
+    state.set_items_per_iteration(batch);
+    state.set_bytes_per_iteration(len);
+}
+
+void bench_telemetry_json_writer(perf_bench::State &state)
+{
+    run_writer<telemetry_enc::JsonWriter>(state);
+}
+PERF_BENCH(bench_telemetry_json_writer, 200);
+
+void bench_telemetry_cbor_writer(perf_bench::State &state)
+{
+    run_writer<telemetry_enc::CborWriter>(state);
+}
+PERF_BENCH(bench_telemetry_cbor_writer, 200);
+
+/* Sizing pass: encode without storing, as done before allocating a pbuf. */
+void bench_telemetry_cbor_count(perf_bench::State &state)
+{
+    fill_readings();
+    size_t len = 0;
+    for (auto _ : state) {
+        telemetry_enc::CountingOutput out;
+        telemetry_enc::CborWriter w(out);
+        telemetry_enc::encode_array(w, reading_schema, readings, batch);
+        len = out.size();
+        perf_bench::do_not_optimize(len);
+    }
+    state.set_items_per_iteration(batch);
+    state.set_bytes_per_iteration(len);
+}
+PERF_BENCH(bench_telemetry_cbor_count, 200);
+
+} // namespace
@@ -0,0 +1,144 @@
+/*
+ * Skewed lookups over a table too large for internal RAM: 512 values of
+ * state.arg() bytes, 90% of accesses going to 48 of them. The tiered cache
+ * (64 hot slots in internal DRAM, the rest in PSRAM) is compared with the
+ * naive placement of the whole table in PSRAM and, where it fits, in
+ * internal RAM. Every access sums the value, so the cost of reading it
+ * through the cache is part of the measurement. Cases needing PSRAM are
+ * skipped on modules without it.
+ */
+#include <cstdint>
+
+#include "esp_heap_caps.h"
+#include "perf_bench/perf_bench.hpp"
+#include "tiered_cache/tiered_cache.hpp"
+
+namespace {
+
+constexpr size_t entries = 512;
+constexpr size_t working_set = 48;
+constexpr size_t accesses = 256;
+
+/* The same key sequence for every case. */
+struct Keys {
+    uint16_t keys[accesses];
+
+    Keys()
+    {
+        uint32_t x = 0x9e3779b9;
+        for (size_t i = 0; i < accesses; ++i) {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            keys[i] = static_cast<uint16_t>(x % 10 != 0 ? (x >> 8) % working_set : (x >> 8) % entries);
+        }
+    }
+};
+
+const Keys sequence;
+
+uint32_t sum_words(const void *value, size_t size)
+{
+    auto *words = static_cast<const uint32_t *>(value);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size / sizeof(uint32_t); ++i) {
+        sum += words[i];
+    }
+    return sum;
+}
+
+void bench_table(perf_bench::State &state, uint32_t caps)
+{
+    auto size = static_cast<size_t>(state.arg());
+    auto *table = static_cast<uint8_t *>(heap_caps_malloc(entries * size, caps));
+    if (table == nullptr) {
+        state.skip("table does not fit");
+        return;
+    }
+    for (size_t i = 0; i < entries * size; ++i) {
+        table[i] = static_cast<uint8_t>(i);
+    }
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < accesses; ++i) {
+            sum += sum_words(table + sequence.keys[i] * size, size);
+        }
+        perf_bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(accesses);
+    heap_caps_free(table);
+}
+
+void bench_table_psram(perf_bench::State &state)
+{
+    bench_table(state, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+PERF_BENCH_ARGS(bench_table_psram, 100, 64, 256, 1024);
+
+void bench_table_internal(perf_bench::State &state)
+{
+    bench_table(state, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+PERF_BENCH_ARGS(bench_table_internal, 100, 64, 256, 1024);
+
+bool fill_cache(perf_bench::State &state, tiered_cache::TieredCache &cache)
+{
+    tiered_cache::TieredCache::Config config;
+    config.value_size = static_cast<size_t>(state.arg());
+    config.hot_slots = 64;
+    config.cold_slots = entries;
+    if (cache.init(config) != ESP_OK) {
+        state.skip("no PSRAM");
+        return false;
+    }
+    for (uint32_t key = 0; key < entries; ++key) {
+        auto *value = static_cast<uint8_t *>(cache.insert(key));
+        for (size_t i = 0; i < cache.value_size(); ++i) {
+            value[i] = static_cast<uint8_t>(key + i);
+        }
+    }
+    return true;
+}
+
+void bench_tiered_cache_get(perf_bench::State &state)
+{
+    tiered_cache::TieredCache cache;
+    if (!fill_cache(state, cache)) {
+        return;
+    }
+    size_t size = cache.value_size();
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < accesses; ++i) {
+            sum += sum_words(cache.get(sequence.keys[i]), size);
+        }
+        perf_bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(accesses);
+}
+PERF_BENCH_ARGS(bench_tiered_cache_get, 100, 64, 256, 1024);
+
+/* The working set pinned up front: no promotion traffic at all, the upper
+ * bound of what placement alone buys. */
+void bench_tiered_cache_pinned(perf_bench::State &state)
+{
+    tiered_cache::TieredCache cache;
+    if (!fill_cache(state, cache)) {
+        return;
+    }
+    for (uint32_t key = 0; key < working_set; ++key) {
+        cache.pin(key);
+    }
+    size_t size = cache.value_size();
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < accesses; ++i) {
+            sum += sum_words(cache.get(sequence.keys[i]), size);
+        }
+        perf_bench::do_not_optimize(sum);
+    }
+    state.set_items_per_iteration(accesses);
+}
+PERF_BENCH_ARGS(bench_tiered_cache_pinned, 100, 64, 256, 1024);
+
+} // namespace
@@ -0,0 +1,127 @@
+/*
+ * ts_store on the bench app's "tsdata" partition: the cost of append() alone,
+ * the sustained rate with every record committed to flash (the loop retries
+ * while both RAM buffers are full and ends with a flush), and replay
+ * throughput. NVS blob writes of the same record are the comparison point.
+ */
+#include <cstdio>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "perf_bench/perf_bench.hpp"
+#include "ts_store/ts_store.hpp"
+
+namespace {
+
+struct Record {
+    uint32_t values[4];
+};
+
+/* Timestamps have to keep increasing across cases and warm-up runs. */
+uint32_t next_timestamp = 1;
+
+bool open_store(perf_bench::State &state, ts_store::Store &store)
+{
+    ts_store::Store::Config config;
+    config.record_size = sizeof(Record);
+    if (store.init(config) != ESP_OK) {
+        state.skip("no tsdata partition");
+        return false;
+    }
+    store.erase_all();
+    return true;
+}
+
+void bench_ts_store_append(perf_bench::State &state)
+{
+    ts_store::Store store;
+    if (!open_store(state, store)) {
+        return;
+    }
+    Record record = {};
+    for (auto _ : state) {
+        record.values[0] = next_timestamp;
+        esp_err_t err = store.append(next_timestamp++, &record);
+        perf_bench::do_not_optimize(err);
+    }
+    state.set_bytes_per_iteration(sizeof(Record));
+}
+PERF_BENCH(bench_ts_store_append, 200);
+
+void bench_ts_store_sustained(perf_bench::State &state)
+{
+    ts_store::Store store;
+    if (!open_store(state, store)) {
+        return;
+    }
+    Record record = {};
+    for (auto _ : state) {
+        record.values[0] = next_timestamp;
+        while (store.append(next_timestamp, &record) != ESP_OK) {
+            vTaskDelay(1);
+        }
+        ++next_timestamp;
+    }
+    store.flush(portMAX_DELAY);
+    state.set_bytes_per_iteration(sizeof(Record));
+}
+PERF_BENCH(bench_ts_store_sustained, 8000);
+
+bool count_record(void *ctx, uint32_t, const void *)
+{
+    ++*static_cast<uint32_t *>(ctx);
+    return true;
+}
+
+void bench_ts_store_replay_1k(perf_bench::State &state)
+{
+    constexpr uint32_t records = 1000;
+    ts_store::Store store;
+    if (!open_store(state, store)) {
+        return;
+    }
+    Record record = {};
+    for (uint32_t i = 0; i < records; ++i) {
+        while (store.append(next_timestamp, &record) != ESP_OK) {
+            vTaskDelay(1);
+        }
+        ++next_timestamp;
+    }
+    store.flush(portMAX_DELAY);
+    for (auto _ : state) {
+        uint32_t seen = 0;
+        ts_store::Position next;
+        store.replay(records, count_record, &seen, &next);
+        perf_bench::do_not_optimize(seen);
+    }
+    state.set_items_per_iteration(records);
+    state.set_bytes_per_iteration(records * sizeof(Record));
+}
+PERF_BENCH(bench_ts_store_replay_1k, 20);
+
+/* One key per record, the way the outage buffer used NVS. */
+void bench_nvs_append(perf_bench::State &state)
+{
+    nvs_handle_t handle;
+    if (nvs_flash_init() != ESP_OK || nvs_open("bench_ts", NVS_READWRITE, &handle) != ESP_OK) {
+        state.skip("nvs unavailable");
+        return;
+    }
+    Record record = {};
+    char key[16];
+    uint32_t n = 0;
+    for (auto _ : state) {
+        snprintf(key, sizeof(key), "r%lu", static_cast<unsigned long>(n++ % 64));
+        nvs_set_blob(handle, key, &record, sizeof(record));
+        nvs_commit(handle);
+    }
+    nvs_erase_all(handle);
+    nvs_commit(handle);
+    nvs_close(handle);
+    state.set_bytes_per_iteration(sizeof(Record));
+}
+PERF_BENCH(bench_nvs_append, 200);
+
+} // namespace
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+/**
+ * @file perf_bench.hpp
+ * @brief On-target microbenchmark harness.
+ *
+ * Benchmarks are plain functions taking a State. They are registered at
+ * static-initialisation time with PERF_BENCH() / PERF_BENCH_ARGS() and run by
+ * perf_bench::run_all(). Each run prints one CSV record per case between
+ * BENCH_BEGIN / BENCH_END markers so tools/bench_capture.py can extract them
+ * from a serial or QEMU log into bench_output.txt.
+ *
+ * @code
+ * static void bench_memcpy(perf_bench::State &state)
+ * {
+ *     for (auto _ : state) {
+ *         memcpy(dst, src, state.arg());
+ *     }
+ *     state.set_bytes_per_iteration(state.arg());
+ * }
+ * PERF_BENCH_ARGS(bench_memcpy, 1000, 16, 256, 4096);
+ * @endcode
+ */
+
+namespace perf_bench {
+
+class State;
+
+using BenchFn = void (*)(State &state);
+
+/** Timing accumulated for one case/argument pair. */
+struct Result {
+    const char *name;
+    int64_t arg;
+    uint32_t iterations;
+    uint32_t items_per_iteration;
+    uint32_t bytes_per_iteration;
+    uint64_t cycles;
+    int64_t wall_us;
+};
+
+/**
+ * @brief Per-run state handed to a benchmark function.
+ *
+ * Time is only accumulated while the range-for loop over the state is running
+ * and not paused, so setup placed before the loop (or between pause() and
+ * resume()) is excluded from the result.
+ */
+class State {
+public:
+    class Iterator {
+    public:
+        /* Marked unused so `for (auto _ : state)` does not trip -Wunused. */
+        struct [[maybe_unused]] Value {};
+
+        Value operator*() const { return {}; }
+        Iterator &operator++()
+        {
+            --remaining_;
+            return *this;
+        }
+        bool operator!=(const Iterator &) const
+        {
+            if (remaining_ != 0) {
+                return true;
+            }
+            state_->stop();
+            return false;
+        }
+
+    private:
+        friend class State;
+        Iterator(State *state, uint32_t remaining) : state_(state), remaining_(remaining) {}
+
+        State *state_;
+        uint32_t remaining_;
+    };
+
+    State(uint32_t iterations, int64_t arg) : iterations_(iterations), arg_(arg) {}
+
+    State(const State &) = delete;
+    State &operator=(const State &) = delete;
+
+    Iterator begin()
+    {
+        start();
+        return Iterator(this, iterations_);
+    }
+    Iterator end() { return Iterator(this, 0); }
+
+    /** Number of loop iterations this run will execute. */
+    uint32_t iterations() const { return iterations_; }
+
+    /** Argument the case was registered with (0 for PERF_BENCH()). */
+    int64_t arg() const { return arg_; }
+
+    /** Stop accumulating time, e.g. around per-iteration setup. */
+    void pause();
+
+    /** Resume accumulating time after pause(). */
+    void resume();
+
+    /** Logical items (samples, packets, ...) processed per iteration. */
+    void set_items_per_iteration(uint32_t items) { items_per_iteration_ = items; }
+
+    /** Payload bytes processed per iteration. */
+    void set_bytes_per_iteration(uint32_t bytes) { bytes_per_iteration_ = bytes; }
+
+    /** Skip this case (missing peripheral, out of memory); it is logged and left out of the report. */
+    void skip(const char *reason) { skip_reason_ = reason; }
+
+    uint64_t cycles() const { return cycles_; }
+    int64_t wall_us() const { return wall_us_; }
+    uint32_t items_per_iteration() const { return items_per_iteration_; }
+    uint32_t bytes_per_iteration() const { return bytes_per_iteration_; }
+    const char *skip_reason() const { return skip_reason_; }
+
+private:
+    void start();
+    void stop();
+
+    uint32_t iterations_;
+    int64_t arg_;
+    uint32_t items_per_iteration_ = 1;
+    uint32_t bytes_per_iteration_ = 0;
+    const char *skip_reason_ = nullptr;
+    bool running_ = false;
+    uint32_t start_cycles_ = 0;
+    int64_t start_us_ = 0;
+    uint64_t cycles_ = 0;
+    int64_t wall_us_ = 0;
+};
+
+/**
+ * @brief Static registration record; instantiated by the PERF_BENCH macros.
+ *
+ * Cases form an intrusive singly linked list so registration never allocates.
+ */
+struct Case {
+    Case(const char *name, BenchFn fn, uint32_t iterations, const int64_t *args, size_t arg_count);
+
+    const char *name;
+    BenchFn fn;
+    uint32_t iterations;
+    const int64_t *args;
+    size_t arg_count;
+    Case *next;
+};
+
+struct RunConfig {
+    /** Only run cases whose name contains this substring (nullptr/"" = all). */
+    const char *filter = nullptr;
+    /** Untimed warm-up iterations before each measured run (cache, branch predictors). */
+    uint32_t warmup_iterations = 0;
+    /** Overrides every case's iteration count when non-zero. */
+    uint32_t iterations = 0;
+};
+
+/** First registered case, or nullptr. Iterate with Case::next. */
+const Case *first_case();
+
+/** Run a single case with one argument and return its timing. */
+esp_err_t run_case(const Case &bench_case, int64_t arg, const RunConfig &config, Result *out);
+
+/** Run every registered case matching config.filter and print the CSV report. */
+esp_err_t run_all(const RunConfig &config);
+
+/** RunConfig populated from the component's Kconfig options. */
+RunConfig default_config();
+
+/** Keep the compiler from optimising a value away inside a benchmark loop. */
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Compiler barrier: forces memory written in the loop to be considered live. */
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+} // namespace perf_bench
+
+#define PERF_BENCH_CONCAT_(a, b) a##b
+#define PERF_BENCH_CONCAT(a, b) PERF_BENCH_CONCAT_(a, b)
+
+/** Register @p fn with @p iters iterations and no argument. */
+#define PERF_BENCH(fn, iters)                                                                 \
+    static ::perf_bench::Case PERF_BENCH_CONCAT(s_perf_bench_case_, __LINE__)(#fn, fn, iters, \
+                                                                           nullptr, 0)
+
+/** Register @p fn with @p iters iterations, once per argument in the variadic list. */
+#define PERF_BENCH_ARGS(fn, iters, ...)                                                       \
+    static constexpr int64_t PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__)[] = {__VA_ARGS__}; \
+    static ::perf_bench::Case PERF_BENCH_CONCAT(s_perf_bench_case_, __LINE__)(                 \
+        #fn, fn, iters, PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__),                      \
+        sizeof(PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__)) / sizeof(int64_t))
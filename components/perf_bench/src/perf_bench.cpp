@@ -0,0 +1,178 @@
+#include "perf_bench/perf_bench.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "perf_bench";
+
+namespace perf_bench {
+
+namespace {
+
+Case *s_head = nullptr;
+Case *s_tail = nullptr;
+
+bool matches(const char *name, const char *filter)
+{
+    return filter == nullptr || filter[0] == '\0' || strstr(name, filter) != nullptr;
+}
+
+/* Fixed-point "x.yy" of num/den; keeps the report independent of printf float support. */
+void print_ratio(uint64_t num, uint64_t den)
+{
+    if (den == 0) {
+        printf("0.00");
+        return;
+    }
+    uint64_t scaled = (num * 100 + den / 2) / den;
+    printf("%" PRIu64 ".%02" PRIu64, scaled / 100, scaled % 100);
+}
+
+void print_header()
+{
+    printf("BENCH_BEGIN target=%s cpu_mhz=%d\n", CONFIG_IDF_TARGET, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    printf("BENCH,name,arg,iterations,items,bytes,cycles,wall_us,cycles_per_iter,cycles_per_item,ns_per_iter\n");
+}
+
+void print_result(const Result &r)
+{
+    uint64_t items = static_cast<uint64_t>(r.iterations) * r.items_per_iteration;
+    printf("BENCH,%s,%" PRId64 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu64 ",%" PRId64 ",", r.name, r.arg,
+           r.iterations, r.items_per_iteration, r.bytes_per_iteration, r.cycles, r.wall_us);
+    print_ratio(r.cycles, r.iterations);
+    printf(",");
+    print_ratio(r.cycles, items);
+    printf(",");
+    print_ratio(static_cast<uint64_t>(r.wall_us) * 1000, r.iterations);
+    printf("\n");
+}
+
+} // namespace
+
+void State::start()
+{
+    running_ = true;
+    start_us_ = esp_timer_get_time();
+    start_cycles_ = esp_cpu_get_cycle_count();
+}
+
+void State::stop()
+{
+    if (!running_) {
+        return;
+    }
+    /* The cycle counter is 32 bits wide; unsigned subtraction handles a single wrap. */
+    uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles_;
+    int64_t now = esp_timer_get_time();
+    cycles_ += cycles;
+    wall_us_ += now - start_us_;
+    running_ = false;
+}
+
+void State::pause()
+{
+    stop();
+}
+
+void State::resume()
+{
+    start();
+}
+
+Case::Case(const char *name, BenchFn fn, uint32_t iterations, const int64_t *args, size_t arg_count)
+    : name(name), fn(fn), iterations(iterations), args(args), arg_count(arg_count), next(nullptr)
+{
+    /* Append so cases run in link order, which keeps reports stable between builds. */
+    if (s_tail == nullptr) {
+        s_head = this;
+    } else {
+        s_tail->next = this;
+    }
+    s_tail = this;
+}
+
+const Case *first_case()
+{
+    return s_head;
+}
+
+esp_err_t run_case(const Case &bench_case, int64_t arg, const RunConfig &config, Result *out)
+{
+    if (out == nullptr || bench_case.fn == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t iterations = config.iterations != 0 ? config.iterations : bench_case.iterations;
+    if (iterations == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config.warmup_iterations != 0) {
+        State warmup(config.warmup_iterations, arg);
+        bench_case.fn(warmup);
+    }
+
+    State state(iterations, arg);
+    bench_case.fn(state);
+    if (state.skip_reason() != nullptr) {
+        ESP_LOGW(TAG, "%s(%" PRId64 ") skipped: %s", bench_case.name, arg, state.skip_reason());
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    out->name = bench_case.name;
+    out->arg = arg;
+    out->iterations = iterations;
+    out->items_per_iteration = state.items_per_iteration();
+    out->bytes_per_iteration = state.bytes_per_iteration();
+    out->cycles = state.cycles();
+    out->wall_us = state.wall_us();
+    return ESP_OK;
+}
+
+esp_err_t run_all(const RunConfig &config)
+{
+    size_t ran = 0;
+    size_t skipped = 0;
+    size_t failed = 0;
+
+    print_header();
+    for (const Case *c = s_head; c != nullptr; c = c->next) {
+        if (!matches(c->name, config.filter)) {
+            continue;
+        }
+        size_t arg_count = c->arg_count != 0 ? c->arg_count : 1;
+        for (size_t i = 0; i < arg_count; ++i) {
+            int64_t arg = c->arg_count != 0 ? c->args[i] : 0;
+            Result result;
+            esp_err_t err = run_case(*c, arg, config, &result);
+            if (err == ESP_OK) {
+                print_result(result);
+                ++ran;
+            } else if (err == ESP_ERR_NOT_SUPPORTED) {
+                ++skipped;
+            } else {
+                ++failed;
+            }
+        }
+    }
+    printf("BENCH_END ran=%u skipped=%u failed=%u\n", static_cast<unsigned>(ran), static_cast<unsigned>(skipped),
+           static_cast<unsigned>(failed));
+    fflush(stdout);
+    return failed == 0 ? ESP_OK : ESP_FAIL;
+}
+
+RunConfig default_config()
+{
+    RunConfig config;
+    config.filter = CONFIG_PERF_BENCH_FILTER;
+    config.warmup_iterations = CONFIG_PERF_BENCH_WARMUP_ITERATIONS;
+    config.iterations = CONFIG_PERF_BENCH_ITERATIONS_OVERRIDE;
+    return config;
+}
+
+} // namespace perf_bench
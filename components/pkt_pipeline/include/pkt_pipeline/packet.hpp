@@ -0,0 +1,236 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+namespace pkt_pipeline {
+
+class Pipeline;
+
+/** Called once when the last reference to a driver-owned buffer is dropped. */
+using ReleaseFn = void (*)(void *release_ctx);
+
+/** One contiguous piece of a packet, pointing into the RX buffer itself. */
+struct Segment {
+    const uint8_t *data;
+    size_t len;
+};
+
+/** Where and when a packet arrived; filled in by the source that ingested it. */
+struct Metadata {
+    int64_t rx_time_us = 0;
+    ip_addr_t src_addr = {};
+    uint16_t src_port = 0;
+};
+
+/**
+ * @brief Descriptor for one received frame. Lives in the pipeline's slab pool.
+ *
+ * Either @c chain is set (lwIP pbuf chain, released with pbuf_free) or
+ * @c data / @c len describe a single driver buffer released through
+ * @c release. Application code only sees it through PacketRef / PacketView.
+ */
+struct Packet {
+    std::atomic<uint32_t> refs;
+    struct pbuf *chain;
+    const uint8_t *data;
+    size_t len;
+    ReleaseFn release;
+    void *release_ctx;
+    Pipeline *owner;
+    Metadata meta;
+};
+
+/**
+ * @brief Non-owning window over a packet's bytes.
+ *
+ * Views never copy: segments point straight into the pbuf payloads or the
+ * driver buffer. A view is only valid while some PacketRef to the same packet
+ * is alive; stages narrow the view as they strip headers.
+ */
+class PacketView {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    PacketView() = default;
+    PacketView(const Packet *packet, size_t offset, size_t length)
+        : packet_(packet), offset_(offset), length_(length)
+    {
+    }
+
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+
+    /** Sub-window starting @p offset bytes in, clamped to this view. */
+    PacketView slice(size_t offset, size_t length = npos) const
+    {
+        if (offset > length_) {
+            offset = length_;
+        }
+        size_t avail = length_ - offset;
+        return PacketView(packet_, offset_ + offset, length < avail ? length : avail);
+    }
+
+    /** Drop @p n leading bytes, e.g. after parsing a header. */
+    void remove_prefix(size_t n)
+    {
+        n = n < length_ ? n : length_;
+        offset_ += n;
+        length_ -= n;
+    }
+
+    /**
+     * @brief Invoke @p fn(const Segment &) for each contiguous piece of the view.
+     *
+     * @p fn returns false to stop early.
+     */
+    template <typename F>
+    void for_each_segment(F &&fn) const
+    {
+        if (packet_ == nullptr || length_ == 0) {
+            return;
+        }
+        if (packet_->chain == nullptr) {
+            fn(Segment{packet_->data + offset_, length_});
+            return;
+        }
+        size_t skip = offset_;
+        size_t remaining = length_;
+        for (const struct pbuf *q = packet_->chain; q != nullptr && remaining != 0; q = q->next) {
+            if (skip >= q->len) {
+                skip -= q->len;
+                continue;
+            }
+            size_t n = q->len - skip;
+            n = n < remaining ? n : remaining;
+            if (!fn(Segment{static_cast<const uint8_t *>(q->payload) + skip, n})) {
+                return;
+            }
+            remaining -= n;
+            skip = 0;
+        }
+    }
+
+    /**
+     * @brief Pointer to @p len bytes at @p offset if they sit in one segment.
+     *
+     * Headers almost always do, so parsers try this first and fall back to
+     * copy_to() into a small stack buffer only when a field straddles pbufs.
+     */
+    const uint8_t *contiguous(size_t offset, size_t len) const
+    {
+        if (offset + len > length_) {
+            return nullptr;
+        }
+        const uint8_t *found = nullptr;
+        size_t pos = 0;
+        for_each_segment([&](const Segment &seg) {
+            if (offset >= pos && offset + len <= pos + seg.len) {
+                found = seg.data + (offset - pos);
+                return false;
+            }
+            pos += seg.len;
+            return pos <= offset;
+        });
+        return found;
+    }
+
+    /** Copy up to @p len bytes starting at @p offset into @p dst; returns bytes copied. */
+    size_t copy_to(size_t offset, void *dst, size_t len) const
+    {
+        auto *out = static_cast<uint8_t *>(dst);
+        size_t copied = 0;
+        slice(offset, len).for_each_segment([&](const Segment &seg) {
+            memcpy(out + copied, seg.data, seg.len);
+            copied += seg.len;
+            return true;
+        });
+        return copied;
+    }
+
+    const Metadata &meta() const { return packet_->meta; }
+
+private:
+    const Packet *packet_ = nullptr;
+    size_t offset_ = 0;
+    size_t length_ = 0;
+};
+
+/**
+ * @brief Counted reference to a Packet.
+ *
+ * Copying retains, destruction releases; the underlying pbuf or driver buffer
+ * goes back to its owner when the last reference is dropped. Stages that need
+ * a packet beyond their process() call (hand-off to another task, reassembly)
+ * simply keep a copy of the ref.
+ */
+class PacketRef {
+public:
+    PacketRef() = default;
+    ~PacketRef() { reset(); }
+
+    PacketRef(const PacketRef &other) : packet_(other.packet_) { retain(); }
+    PacketRef(PacketRef &&other) : packet_(other.packet_) { other.packet_ = nullptr; }
+
+    PacketRef &operator=(const PacketRef &other)
+    {
+        if (packet_ != other.packet_) {
+            reset();
+            packet_ = other.packet_;
+            retain();
+        }
+        return *this;
+    }
+
+    PacketRef &operator=(PacketRef &&other)
+    {
+        if (this != &other) {
+            reset();
+            packet_ = other.packet_;
+            other.packet_ = nullptr;
+        }
+        return *this;
+    }
+
+    /** Take over a reference that has already been counted (refs >= 1). */
+    static PacketRef adopt(Packet *packet)
+    {
+        PacketRef ref;
+        ref.packet_ = packet;
+        return ref;
+    }
+
+    /** Drop this reference. */
+    void reset();
+
+    explicit operator bool() const { return packet_ != nullptr; }
+
+    size_t size() const { return packet_ != nullptr ? packet_->len : 0; }
+
+    /** View over the whole packet. */
+    PacketView view() const { return PacketView(packet_, 0, size()); }
+
+    const Metadata &meta() const { return packet_->meta; }
+
+    /** Underlying pbuf chain, or nullptr for driver buffers. Do not free it. */
+    struct pbuf *pbuf() const { return packet_ != nullptr ? packet_->chain : nullptr; }
+
+    uint32_t use_count() const { return packet_ != nullptr ? packet_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    void retain()
+    {
+        if (packet_ != nullptr) {
+            packet_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Packet *packet_ = nullptr;
+};
+
+} // namespace pkt_pipeline
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "mem_pool/slab_pool.hpp"
+#include "pkt_pipeline/packet.hpp"
+
+namespace pkt_pipeline {
+
+/** What a stage wants done with the frame after process() returns. */
+enum class Verdict {
+    /** Hand the frame to the next stage. */
+    Continue,
+    /** Handled; later stages are skipped. The stage may have kept a PacketRef. */
+    Consumed,
+    /** Not wanted; later stages are skipped and the frame counts as dropped. */
+    Drop,
+};
+
+/** A packet travelling through the stages, plus the part still unparsed. */
+struct Frame {
+    PacketRef packet;
+    /** Starts as the whole packet; each stage narrows it past the header it parsed. */
+    PacketView payload;
+};
+
+/**
+ * @brief One handler in the pipeline.
+ *
+ * process() runs on the pipeline's worker task (or the RX context for inline
+ * pipelines) and must not block. Holding on to the data after returning
+ * means copying @c frame.packet, never the bytes.
+ */
+class Stage {
+public:
+    virtual Verdict process(Frame &frame) = 0;
+
+protected:
+    ~Stage() = default;
+};
+
+struct PipelineStats {
+    uint32_t received;
+    uint32_t processed;
+    uint32_t dropped_by_stage;
+    /** Descriptor pool exhausted: more packets in flight than Config::max_in_flight. */
+    uint32_t dropped_no_descriptor;
+    /** Worker queue full: stages are slower than the RX rate. */
+    uint32_t dropped_queue_full;
+    uint32_t in_flight;
+    /** Peak number of RX buffers held at once; size the driver's RX buffer count from this. */
+    uint32_t peak_in_flight;
+};
+
+/**
+ * @brief Runs RX buffers through a fixed chain of stages without copying them.
+ *
+ * Sources submit pbuf chains or driver buffers. Each gets a descriptor from a
+ * slab pool (O(1), no heap) and is queued by pointer to a worker task, which
+ * runs the stages in order. The buffer is released - pbuf_free() or the
+ * driver's release callback - as soon as the last PacketRef goes away, which
+ * is usually the end of the last stage, so buffers are not held any longer
+ * than the processing actually needs.
+ */
+class Pipeline {
+public:
+    struct Config {
+        const char *name = "pkt_pipeline";
+        /** Descriptors, i.e. the most RX buffers the pipeline will hold at once. */
+        size_t max_in_flight = 32;
+        /** Worker queue depth; 0 runs the stages inline in the submitting context. */
+        size_t queue_depth = 16;
+        uint32_t task_stack_size = 4096;
+        UBaseType_t task_priority = 10;
+        BaseType_t task_core = tskNO_AFFINITY;
+    };
+
+    static constexpr size_t max_stages = 8;
+
+    Pipeline() = default;
+    ~Pipeline() { deinit(); }
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    esp_err_t init(const Config &config);
+
+    /** Stop the worker and free resources. No packet may still be referenced. */
+    void deinit();
+
+    /** Append a stage. Only valid before start(). @return ESP_ERR_NO_MEM past max_stages. */
+    esp_err_t add_stage(Stage &stage);
+
+    /** Start the worker task (no-op for inline pipelines). */
+    esp_err_t start();
+
+    /**
+     * @brief Hand a received pbuf chain to the pipeline.
+     *
+     * Ownership of @p p transfers in all cases: on failure it is freed here and
+     * the drop is counted. Safe to call from the lwIP tcpip thread.
+     */
+    esp_err_t submit_pbuf(struct pbuf *p, const Metadata &meta = {});
+
+    /**
+     * @brief Hand a driver-owned buffer to the pipeline.
+     *
+     * @p release(@p release_ctx) is called exactly once, when the last
+     * reference is gone or immediately if the packet cannot be accepted.
+     * Typical use is a Wi-Fi/ESP-NOW RX callback passing the driver's buffer
+     * handle so it is returned with esp_wifi_internal_free_rx_buffer().
+     */
+    esp_err_t submit_buffer(const void *data, size_t len, ReleaseFn release, void *release_ctx,
+                            const Metadata &meta = {});
+
+    PipelineStats stats() const;
+
+private:
+    friend class PacketRef;
+
+    Packet *acquire_descriptor();
+    esp_err_t dispatch(Packet *packet);
+    void run_stages(Packet *packet);
+    void recycle(Packet *packet);
+    static void worker_task(void *arg);
+
+    mem_pool::SlabPool descriptors_;
+    QueueHandle_t queue_ = nullptr;
+    TaskHandle_t task_ = nullptr;
+    TaskHandle_t waiter_ = nullptr;
+    Config config_;
+    Stage *stages_[max_stages] = {};
+    size_t stage_count_ = 0;
+    bool started_ = false;
+
+    std::atomic<uint32_t> received_{0};
+    std::atomic<uint32_t> processed_{0};
+    std::atomic<uint32_t> dropped_by_stage_{0};
+    std::atomic<uint32_t> dropped_no_descriptor_{0};
+    std::atomic<uint32_t> dropped_queue_full_{0};
+    std::atomic<uint32_t> in_flight_{0};
+    std::atomic<uint32_t> peak_in_flight_{0};
+};
+
+} // namespace pkt_pipeline
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esp_err.h"
+#include "pkt_pipeline/pipeline.hpp"
+
+struct udp_pcb;
+
+namespace pkt_pipeline {
+
+/**
+ * @brief Feeds datagrams from an lwIP raw-API UDP PCB into a Pipeline.
+ *
+ * Bypasses the socket layer entirely: the pbuf lwIP received into is what
+ * the stages see, so there is no netconn mailbox, no socket receive buffer
+ * and no recvfrom() copy. The recv callback runs in the tcpip thread and only
+ * takes a descriptor and queues it.
+ */
+class UdpSource {
+public:
+    UdpSource() = default;
+    ~UdpSource() { close(); }
+
+    UdpSource(const UdpSource &) = delete;
+    UdpSource &operator=(const UdpSource &) = delete;
+
+    /** Bind to @p port on all interfaces and start delivering to @p pipeline. */
+    esp_err_t open(Pipeline &pipeline, uint16_t port);
+
+    void close();
+
+private:
+    struct udp_pcb *pcb_ = nullptr;
+    Pipeline *pipeline_ = nullptr;
+};
+
+} // namespace pkt_pipeline
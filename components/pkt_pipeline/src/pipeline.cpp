@@ -0,0 +1,255 @@
+#include "pkt_pipeline/pipeline.hpp"
+
+#include <new>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "pkt_pipeline";
+
+namespace pkt_pipeline {
+
+void PacketRef::reset()
+{
+    if (packet_ == nullptr) {
+        return;
+    }
+    if (packet_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        packet_->owner->recycle(packet_);
+    }
+    packet_ = nullptr;
+}
+
+esp_err_t Pipeline::init(const Config &config)
+{
+    if (descriptors_.block_count() != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.max_in_flight == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mem_pool::SlabPool::Config pool_config;
+    pool_config.name = config.name;
+    pool_config.block_size = sizeof(Packet);
+    pool_config.block_count = config.max_in_flight;
+    pool_config.alignment = alignof(Packet);
+    esp_err_t err = descriptors_.init(pool_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (config.queue_depth != 0) {
+        queue_ = xQueueCreate(config.queue_depth, sizeof(Packet *));
+        if (queue_ == nullptr) {
+            descriptors_.deinit();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    config_ = config;
+    stage_count_ = 0;
+    started_ = false;
+    return ESP_OK;
+}
+
+void Pipeline::deinit()
+{
+    if (task_ != nullptr) {
+        /* A null descriptor is the stop request; the worker acknowledges with a
+         * notification and deletes itself. */
+        waiter_ = xTaskGetCurrentTaskHandle();
+        Packet *stop = nullptr;
+        xQueueSend(queue_, &stop, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        task_ = nullptr;
+    }
+    if (queue_ != nullptr) {
+        vQueueDelete(queue_);
+        queue_ = nullptr;
+    }
+    uint32_t in_flight = in_flight_.load(std::memory_order_relaxed);
+    if (in_flight != 0) {
+        ESP_LOGW(TAG, "%s: deinit with %u packets still referenced", config_.name, static_cast<unsigned>(in_flight));
+    }
+    descriptors_.deinit();
+    started_ = false;
+}
+
+esp_err_t Pipeline::add_stage(Stage &stage)
+{
+    if (started_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (stage_count_ == max_stages) {
+        return ESP_ERR_NO_MEM;
+    }
+    stages_[stage_count_++] = &stage;
+    return ESP_OK;
+}
+
+esp_err_t Pipeline::start()
+{
+    if (started_ || descriptors_.block_count() == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (queue_ != nullptr) {
+        if (xTaskCreatePinnedToCore(worker_task, config_.name, config_.task_stack_size, this, config_.task_priority,
+                                    &task_, config_.task_core) != pdPASS) {
+            task_ = nullptr;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    started_ = true;
+    return ESP_OK;
+}
+
+Packet *Pipeline::acquire_descriptor()
+{
+    void *mem = descriptors_.allocate();
+    if (mem == nullptr) {
+        dropped_no_descriptor_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    uint32_t held = in_flight_.fetch_add(1, std::memory_order_relaxed) + 1;
+    uint32_t peak = peak_in_flight_.load(std::memory_order_relaxed);
+    while (held > peak && !peak_in_flight_.compare_exchange_weak(peak, held, std::memory_order_relaxed)) {
+    }
+    return new (mem) Packet();
+}
+
+esp_err_t Pipeline::submit_pbuf(struct pbuf *p, const Metadata &meta)
+{
+    if (p == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    received_.fetch_add(1, std::memory_order_relaxed);
+    Packet *packet = started_ ? acquire_descriptor() : nullptr;
+    if (packet == nullptr) {
+        pbuf_free(p);
+        return ESP_ERR_NO_MEM;
+    }
+    packet->refs.store(1, std::memory_order_relaxed);
+    packet->chain = p;
+    packet->data = nullptr;
+    packet->len = p->tot_len;
+    packet->release = nullptr;
+    packet->release_ctx = nullptr;
+    packet->owner = this;
+    packet->meta = meta;
+    if (packet->meta.rx_time_us == 0) {
+        packet->meta.rx_time_us = esp_timer_get_time();
+    }
+    return dispatch(packet);
+}
+
+esp_err_t Pipeline::submit_buffer(const void *data, size_t len, ReleaseFn release, void *release_ctx,
+                                  const Metadata &meta)
+{
+    if (data == nullptr && len != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    received_.fetch_add(1, std::memory_order_relaxed);
+    Packet *packet = started_ ? acquire_descriptor() : nullptr;
+    if (packet == nullptr) {
+        if (release != nullptr) {
+            release(release_ctx);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    packet->refs.store(1, std::memory_order_relaxed);
+    packet->chain = nullptr;
+    packet->data = static_cast<const uint8_t *>(data);
+    packet->len = len;
+    packet->release = release;
+    packet->release_ctx = release_ctx;
+    packet->owner = this;
+    packet->meta = meta;
+    if (packet->meta.rx_time_us == 0) {
+        packet->meta.rx_time_us = esp_timer_get_time();
+    }
+    return dispatch(packet);
+}
+
+esp_err_t Pipeline::dispatch(Packet *packet)
+{
+    if (queue_ == nullptr) {
+        run_stages(packet);
+        return ESP_OK;
+    }
+    /* Only the descriptor pointer is queued; the payload stays where the driver put it. */
+    if (xQueueSend(queue_, &packet, 0) != pdTRUE) {
+        dropped_queue_full_.fetch_add(1, std::memory_order_relaxed);
+        PacketRef::adopt(packet).reset();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void Pipeline::run_stages(Packet *packet)
+{
+    Frame frame;
+    frame.packet = PacketRef::adopt(packet);
+    frame.payload = frame.packet.view();
+    for (size_t i = 0; i < stage_count_; ++i) {
+        Verdict verdict = stages_[i]->process(frame);
+        if (verdict == Verdict::Continue) {
+            continue;
+        }
+        if (verdict == Verdict::Drop) {
+            dropped_by_stage_.fetch_add(1, std::memory_order_relaxed);
+        }
+        break;
+    }
+    processed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Pipeline::recycle(Packet *packet)
+{
+    if (packet->chain != nullptr) {
+        pbuf_free(packet->chain);
+    } else if (packet->release != nullptr) {
+        packet->release(packet->release_ctx);
+    }
+    packet->~Packet();
+    descriptors_.deallocate(packet);
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void Pipeline::worker_task(void *arg)
+{
+    auto *self = static_cast<Pipeline *>(arg);
+    for (;;) {
+        Packet *packet = nullptr;
+        if (xQueueReceive(self->queue_, &packet, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (packet == nullptr) {
+            break;
+        }
+        self->run_stages(packet);
+    }
+    /* Drain whatever raced in behind the stop request so no buffer leaks. */
+    Packet *packet = nullptr;
+    while (xQueueReceive(self->queue_, &packet, 0) == pdTRUE) {
+        if (packet != nullptr) {
+            PacketRef::adopt(packet).reset();
+        }
+    }
+    xTaskNotifyGive(self->waiter_);
+    vTaskDelete(nullptr);
+}
+
+PipelineStats Pipeline::stats() const
+{
+    PipelineStats s = {};
+    s.received = received_.load(std::memory_order_relaxed);
+    s.processed = processed_.load(std::memory_order_relaxed);
+    s.dropped_by_stage = dropped_by_stage_.load(std::memory_order_relaxed);
+    s.dropped_no_descriptor = dropped_no_descriptor_.load(std::memory_order_relaxed);
+    s.dropped_queue_full = dropped_queue_full_.load(std::memory_order_relaxed);
+    s.in_flight = in_flight_.load(std::memory_order_relaxed);
+    s.peak_in_flight = peak_in_flight_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace pkt_pipeline
@@ -0,0 +1,96 @@
+#include "pkt_pipeline/udp_source.hpp"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "lwip/udp.h"
+
+static const char *TAG = "pkt_pipeline";
+
+namespace pkt_pipeline {
+
+namespace {
+
+/* Raw-API calls must run in the tcpip thread; tcpip_api_call marshals them
+ * there whether or not core locking is enabled. */
+struct OpenCall {
+    struct tcpip_api_call_data base;
+    Pipeline *pipeline;
+    uint16_t port;
+    struct udp_pcb *pcb;
+};
+
+struct CloseCall {
+    struct tcpip_api_call_data base;
+    struct udp_pcb *pcb;
+};
+
+void on_recv(void *arg, struct udp_pcb *, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    Metadata meta;
+    meta.rx_time_us = esp_timer_get_time();
+    ip_addr_copy(meta.src_addr, *addr);
+    meta.src_port = port;
+    /* submit_pbuf owns p from here on, including freeing it on a drop. */
+    static_cast<Pipeline *>(arg)->submit_pbuf(p, meta);
+}
+
+err_t do_open(struct tcpip_api_call_data *data)
+{
+    auto *call = reinterpret_cast<OpenCall *>(data);
+    struct udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == nullptr) {
+        return ERR_MEM;
+    }
+    err_t err = udp_bind(pcb, IP_ANY_TYPE, call->port);
+    if (err != ERR_OK) {
+        udp_remove(pcb);
+        return err;
+    }
+    udp_recv(pcb, on_recv, call->pipeline);
+    call->pcb = pcb;
+    return ERR_OK;
+}
+
+err_t do_close(struct tcpip_api_call_data *data)
+{
+    auto *call = reinterpret_cast<CloseCall *>(data);
+    udp_recv(call->pcb, nullptr, nullptr);
+    udp_remove(call->pcb);
+    return ERR_OK;
+}
+
+} // namespace
+
+esp_err_t UdpSource::open(Pipeline &pipeline, uint16_t port)
+{
+    if (pcb_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    OpenCall open_call = {};
+    open_call.pipeline = &pipeline;
+    open_call.port = port;
+    err_t err = tcpip_api_call(do_open, &open_call.base);
+    if (err != ERR_OK) {
+        ESP_LOGE(TAG, "udp bind to port %u failed: %d", port, err);
+        return err == ERR_MEM ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+
+    pcb_ = open_call.pcb;
+    pipeline_ = &pipeline;
+    return ESP_OK;
+}
+
+void UdpSource::close()
+{
+    if (pcb_ == nullptr) {
+        return;
+    }
+    CloseCall call = {};
+    call.pcb = pcb_;
+    tcpip_api_call(do_close, &call.base);
+    pcb_ = nullptr;
+    pipeline_ = nullptr;
+}
+
+} // namespace pkt_pipeline
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+namespace http_server {
+class Server;
+}
+
+namespace profiler {
+
+/** Bucket 0 counts zero-cycle samples, bucket i (1..32) samples in [2^(i-1), 2^i). */
+constexpr size_t bucket_count = 33;
+
+struct ProbeStats {
+    uint32_t count;
+    /** Cycles from scope entry to exit, nested probes included. */
+    uint64_t total_cycles;
+    /** total_cycles minus the cycles spent in nested probes. */
+    uint64_t self_cycles;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint32_t buckets[bucket_count];
+};
+
+/**
+ * @brief Named cycle histogram, one per instrumented code site.
+ *
+ * Each core has its own counters and every update is a relaxed atomic on
+ * them, so recording takes no lock, never blocks and is safe from ISRs and
+ * from inside the scheduler. The constructor is constexpr and the destructor
+ * trivial: a function-local static Probe is constant-initialized with no
+ * guard variable, and it puts itself on the global probe list the first time
+ * it records.
+ *
+ * The parent is the probe whose scope enclosed the first recorded sample;
+ * the dump emits it so the host script can rebuild call stacks. A probe
+ * reached from several callers is attributed to the first one.
+ */
+class Probe {
+public:
+    constexpr explicit Probe(const char *name) : name_(name) {}
+
+    Probe(const Probe &) = delete;
+    Probe &operator=(const Probe &) = delete;
+
+    const char *name() const { return name_; }
+    const Probe *parent() const { return parent_.load(std::memory_order_acquire); }
+
+    /** Record one sample on the calling core. In IRAM; callable from ISRs. */
+    void record(uint32_t cycles, uint32_t self_cycles, const Probe *parent = nullptr);
+
+    /** Counters of @p core. Read without stopping writers, so a snapshot may be off by in-flight samples. */
+    ProbeStats stats(int core) const;
+
+    void reset();
+
+    /** Probes that have recorded at least once, newest first. */
+    static const Probe *first();
+    const Probe *next() const { return next_; }
+
+private:
+    struct Counters {
+        std::atomic<uint32_t> count{0};
+        /* 64-bit sums as two words (no 64-bit atomics on Xtensa); the high
+         * word is bumped when the low word wraps. */
+        std::atomic<uint32_t> total_lo{0};
+        std::atomic<uint32_t> total_hi{0};
+        std::atomic<uint32_t> self_lo{0};
+        std::atomic<uint32_t> self_hi{0};
+        std::atomic<uint32_t> min{UINT32_MAX};
+        std::atomic<uint32_t> max{0};
+        std::atomic<uint32_t> buckets[bucket_count] = {};
+    };
+
+    void register_self();
+
+    const char *name_;
+    std::atomic<bool> registered_{false};
+    std::atomic<const Probe *> parent_{nullptr};
+    const Probe *next_ = nullptr;
+    Counters cores_[portNUM_PROCESSORS];
+};
+
+#define PROFILER_INLINE __attribute__((always_inline)) inline
+
+/**
+ * @brief RAII timer for task code; see PERF_SCOPE.
+ *
+ * Scopes nest through a thread-local pointer to the innermost open scope:
+ * on exit a scope adds its cycles to its parent's child total, so each probe
+ * gets both inclusive and self time. The cycle counter is per core, so a
+ * task that migrates to the other core while inside a scope records a
+ * meaningless delta; pin tasks that are being profiled. Scopes longer than
+ * one wrap of the 32-bit counter (about 17 s at 240 MHz) are not measured
+ * correctly either.
+ */
+class Scope {
+public:
+    PROFILER_INLINE explicit Scope(Probe &probe) : probe_(probe), parent_(current_)
+    {
+        current_ = this;
+        start_ = esp_cpu_get_cycle_count();
+    }
+
+    PROFILER_INLINE ~Scope()
+    {
+        uint32_t cycles = esp_cpu_get_cycle_count() - start_;
+        current_ = parent_;
+        const Probe *parent_probe = nullptr;
+        if (parent_ != nullptr) {
+            parent_->children_ += cycles;
+            parent_probe = &parent_->probe_;
+        }
+        probe_.record(cycles, cycles - children_, parent_probe);
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    static inline thread_local Scope *current_ = nullptr;
+
+    Probe &probe_;
+    Scope *parent_;
+    uint32_t start_;
+    uint32_t children_ = 0;
+};
+
+/**
+ * @brief RAII timer for ISRs and code running with the scheduler suspended.
+ *
+ * Does not take part in nesting (an ISR would otherwise link itself under
+ * whatever scope the interrupted task had open), so total and self are the
+ * same.
+ */
+class IsrScope {
+public:
+    PROFILER_INLINE explicit IsrScope(Probe &probe) : probe_(probe), start_(esp_cpu_get_cycle_count()) {}
+
+    PROFILER_INLINE ~IsrScope()
+    {
+        uint32_t cycles = esp_cpu_get_cycle_count() - start_;
+        probe_.record(cycles, cycles);
+    }
+
+    IsrScope(const IsrScope &) = delete;
+    IsrScope &operator=(const IsrScope &) = delete;
+
+private:
+    Probe &probe_;
+    uint32_t start_;
+};
+
+/**
+ * @brief Streams the text dump of every probe, a buffer at a time.
+ *
+ * The format, one line per probe and core with samples, tab separated:
+ *
+ *     # profiler v1 target=esp32s3 cores=2 cpu_mhz=240
+ *     # core<TAB>name<TAB>parent<TAB>count<TAB>total<TAB>self<TAB>min<TAB>max<TAB>buckets
+ *     0<TAB>mqtt.send<TAB>-<TAB>1200<TAB>...<TAB>9:3,10:1100,11:97
+ *     # end
+ *
+ * buckets lists index:count pairs of the non-empty buckets. read() only
+ * hands out whole lines; tools/profile_report.py turns the dump into a
+ * table and folded stacks.
+ */
+class DumpReader {
+public:
+    DumpReader() { rewind(); }
+
+    void rewind();
+
+    /** Copy the next lines into @p buf. @return bytes written, 0 once the dump is complete. */
+    size_t read(char *buf, size_t capacity);
+
+private:
+    size_t format_line(char *line, size_t capacity);
+
+    const Probe *probe_;
+    int core_;
+    uint8_t stage_;
+};
+
+/** Print the dump on the console (stdout). */
+void dump();
+
+/** Zero every registered probe. */
+void reset_all();
+
+/**
+ * @brief Serve the dump as text/plain on GET @p path; ?reset=1 zeroes the probes after the dump.
+ *
+ * Must be called before the server is started.
+ */
+esp_err_t add_http_route(http_server::Server &server, const char *path = "/profile");
+
+/**
+ * @brief Measure interrupt latency with a hardware timer.
+ *
+ * Arms a general-purpose timer to alarm every @p period_us and records, for
+ * @p samples alarms, the cycles between the alarm firing and its callback
+ * running into the "isr_latency" probe. Blocks the caller until done; run it
+ * alongside the workload whose effect on latency is of interest. The timer
+ * ticks at 40 MHz, so samples have a 25 ns resolution.
+ */
+esp_err_t sample_isr_latency(uint32_t samples, uint32_t period_us = 1000);
+
+} // namespace profiler
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+
+#if CONFIG_PROFILER_ENABLE
+
+/**
+ * Time the rest of the enclosing block under probe @p name (a string literal).
+ * Compiles to nothing unless CONFIG_PROFILER_ENABLE is set.
+ */
+#define PERF_SCOPE(name)                                                                                               \
+    static ::profiler::Probe PROFILER_CONCAT(perf_probe_, __LINE__){name};                                             \
+    ::profiler::Scope PROFILER_CONCAT(perf_scope_, __LINE__) { PROFILER_CONCAT(perf_probe_, __LINE__) }
+
+/** PERF_SCOPE for ISRs; see IsrScope. */
+#define PERF_SCOPE_ISR(name)                                                                                           \
+    static ::profiler::Probe PROFILER_CONCAT(perf_probe_, __LINE__){name};                                             \
+    ::profiler::IsrScope PROFILER_CONCAT(perf_scope_, __LINE__) { PROFILER_CONCAT(perf_probe_, __LINE__) }
+
+#else
+
+#define PERF_SCOPE(name) static_cast<void>(0)
+#define PERF_SCOPE_ISR(name) static_cast<void>(0)
+
+#endif
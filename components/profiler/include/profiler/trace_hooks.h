@@ -0,0 +1,20 @@
+/*
+ * FreeRTOS trace hooks for the task switch probe. Pre-included into every C
+ * file when CONFIG_PROFILER_TRACE_HOOKS is set (see project_include.cmake);
+ * nothing else should include it.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void profiler_task_switched_out(void);
+void profiler_task_switched_in(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_OUT() profiler_task_switched_out()
+#define traceTASK_SWITCHED_IN() profiler_task_switched_in()
@@ -0,0 +1,6 @@
+# The FreeRTOS trace macros have to be defined before FreeRTOS.h is first
+# included in tasks.c, so the hook header is pre-included into every C file
+# of the build rather than hooked through FreeRTOSConfig.h.
+if(CONFIG_PROFILER_TRACE_HOOKS)
+    idf_build_set_property(C_COMPILE_OPTIONS "-include;${CMAKE_CURRENT_LIST_DIR}/include/profiler/trace_hooks.h" APPEND)
+endif()
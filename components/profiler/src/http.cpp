@@ -0,0 +1,68 @@
+#include "profiler/profiler.hpp"
+
+#include "esp_timer.h"
+#include "http_server/server.hpp"
+
+namespace profiler {
+
+namespace {
+
+/* The server never says when a streamed response is abandoned, so a stream
+ * that has not been read for this long is taken to be dead and its slot is
+ * reused. */
+constexpr int64_t stale_us = 60 * 1000 * 1000;
+
+struct Stream {
+    DumpReader reader;
+    int64_t last_read_us = 0;
+    bool busy = false;
+    bool reset_after = false;
+};
+
+/* Handlers and body sources all run on the server task, so no locking. */
+Stream streams[2];
+
+size_t read_stream(void *ctx, uint8_t *buf, size_t capacity)
+{
+    auto *s = static_cast<Stream *>(ctx);
+    size_t n = s->reader.read(reinterpret_cast<char *>(buf), capacity);
+    s->last_read_us = esp_timer_get_time();
+    if (n == 0) {
+        if (s->reset_after) {
+            reset_all();
+        }
+        s->busy = false;
+    }
+    return n;
+}
+
+void handle_profile(const http_server::Request &req, http_server::Response &res, void *)
+{
+    int64_t now = esp_timer_get_time();
+    Stream *stream = nullptr;
+    for (Stream &s : streams) {
+        if (!s.busy || now - s.last_read_us > stale_us) {
+            stream = &s;
+            break;
+        }
+    }
+    if (stream == nullptr) {
+        res.send_error(503);
+        return;
+    }
+    stream->reader.rewind();
+    stream->last_read_us = now;
+    stream->busy = true;
+    stream->reset_after = req.query().find("reset=1") != std::string_view::npos;
+    res.add_header("Cache-Control", "no-store");
+    res.stream(200, "text/plain", read_stream, stream);
+}
+
+} // namespace
+
+esp_err_t add_http_route(http_server::Server &server, const char *path)
+{
+    return server.add_route(http_server::Method::Get, path, handle_profile);
+}
+
+} // namespace profiler
@@ -0,0 +1,95 @@
+#include "profiler/profiler.hpp"
+
+#include "driver/gptimer.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "freertos/task.h"
+
+namespace profiler {
+
+static const char *TAG = "profiler";
+
+namespace {
+
+constexpr uint32_t timer_hz = 40 * 1000 * 1000;
+
+Probe isr_latency_probe{"isr_latency"};
+
+struct Sampler {
+    uint32_t remaining;
+    uint32_t cycles_per_us;
+    TaskHandle_t waiter;
+};
+
+bool IRAM_ATTR on_alarm(gptimer_handle_t, const gptimer_alarm_event_data_t *edata, void *ctx)
+{
+    auto *s = static_cast<Sampler *>(ctx);
+    if (s->remaining == 0) {
+        return false;
+    }
+    /* The counter reloads to 0 at the alarm, so its value when the callback
+     * runs is the time since the alarm fired. */
+    uint32_t ticks = static_cast<uint32_t>(edata->count_value);
+    uint32_t cycles = ticks * s->cycles_per_us / (timer_hz / 1000000);
+    isr_latency_probe.record(cycles, cycles);
+    if (--s->remaining != 0) {
+        return false;
+    }
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s->waiter, &woken);
+    return woken == pdTRUE;
+}
+
+} // namespace
+
+esp_err_t sample_isr_latency(uint32_t samples, uint32_t period_us)
+{
+    if (samples == 0 || period_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gptimer_config_t timer_config = {};
+    timer_config.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    timer_config.direction = GPTIMER_COUNT_UP;
+    timer_config.resolution_hz = timer_hz;
+    gptimer_handle_t timer = nullptr;
+    esp_err_t err = gptimer_new_timer(&timer_config, &timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "no timer for latency sampling: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    Sampler sampler = {samples, esp_rom_get_cpu_ticks_per_us(), xTaskGetCurrentTaskHandle()};
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = on_alarm;
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = static_cast<uint64_t>(period_us) * (timer_hz / 1000000);
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+
+    err = gptimer_register_event_callbacks(timer, &callbacks, &sampler);
+    if (err == ESP_OK) {
+        err = gptimer_set_alarm_action(timer, &alarm);
+    }
+    if (err == ESP_OK) {
+        err = gptimer_enable(timer);
+    }
+    if (err == ESP_OK) {
+        ulTaskNotifyValueClear(nullptr, UINT32_MAX);
+        err = gptimer_start(timer);
+        if (err == ESP_OK) {
+            /* Generous bound in case the alarm interrupt is starved entirely. */
+            TickType_t timeout = pdMS_TO_TICKS(static_cast<uint64_t>(samples) * period_us / 1000 * 2 + 1000);
+            if (ulTaskNotifyTake(pdTRUE, timeout) == 0) {
+                err = ESP_ERR_TIMEOUT;
+            }
+            gptimer_stop(timer);
+        }
+        gptimer_disable(timer);
+    }
+    gptimer_del_timer(timer);
+    return err;
+}
+
+} // namespace profiler
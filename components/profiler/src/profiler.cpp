@@ -0,0 +1,268 @@
+#include "profiler/profiler.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_attr.h"
+#include "esp_rom_sys.h"
+
+namespace profiler {
+
+namespace {
+
+std::atomic<Probe *> probes{nullptr};
+
+PROFILER_INLINE void add_wide(std::atomic<uint32_t> &lo, std::atomic<uint32_t> &hi, uint32_t value)
+{
+    uint32_t old = lo.fetch_add(value, std::memory_order_relaxed);
+    if (old + value < old) {
+        hi.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t load_wide(const std::atomic<uint32_t> &lo, const std::atomic<uint32_t> &hi)
+{
+    /* Re-read if the low word wrapped in between. */
+    uint32_t h, l;
+    do {
+        h = hi.load(std::memory_order_relaxed);
+        l = lo.load(std::memory_order_relaxed);
+    } while (h != hi.load(std::memory_order_relaxed));
+    return (static_cast<uint64_t>(h) << 32) | l;
+}
+
+PROFILER_INLINE size_t bucket_for(uint32_t cycles)
+{
+    return cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+}
+
+enum : uint8_t {
+    stage_header,
+    stage_columns,
+    stage_probes,
+    stage_end,
+    stage_done,
+};
+
+} // namespace
+
+void IRAM_ATTR Probe::record(uint32_t cycles, uint32_t self_cycles, const Probe *parent)
+{
+    if (!registered_.load(std::memory_order_relaxed)) {
+        register_self();
+    }
+    if (parent != nullptr && parent_.load(std::memory_order_relaxed) == nullptr) {
+        const Probe *expected = nullptr;
+        parent_.compare_exchange_strong(expected, parent, std::memory_order_release, std::memory_order_relaxed);
+    }
+
+    Counters &c = cores_[esp_cpu_get_core_id()];
+    c.count.fetch_add(1, std::memory_order_relaxed);
+    add_wide(c.total_lo, c.total_hi, cycles);
+    add_wide(c.self_lo, c.self_hi, self_cycles);
+    c.buckets[bucket_for(cycles)].fetch_add(1, std::memory_order_relaxed);
+
+    /* An ISR on the same core can interleave, so min/max still need a CAS. */
+    uint32_t seen = c.min.load(std::memory_order_relaxed);
+    while (cycles < seen && !c.min.compare_exchange_weak(seen, cycles, std::memory_order_relaxed)) {
+    }
+    seen = c.max.load(std::memory_order_relaxed);
+    while (cycles > seen && !c.max.compare_exchange_weak(seen, cycles, std::memory_order_relaxed)) {
+    }
+}
+
+void IRAM_ATTR Probe::register_self()
+{
+    if (registered_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    Probe *head = probes.load(std::memory_order_relaxed);
+    do {
+        next_ = head;
+    } while (!probes.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+ProbeStats Probe::stats(int core) const
+{
+    const Counters &c = cores_[core];
+    ProbeStats s;
+    s.count = c.count.load(std::memory_order_relaxed);
+    s.total_cycles = load_wide(c.total_lo, c.total_hi);
+    s.self_cycles = load_wide(c.self_lo, c.self_hi);
+    s.min_cycles = s.count == 0 ? 0 : c.min.load(std::memory_order_relaxed);
+    s.max_cycles = c.max.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < bucket_count; ++i) {
+        s.buckets[i] = c.buckets[i].load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+void Probe::reset()
+{
+    for (Counters &c : cores_) {
+        c.count.store(0, std::memory_order_relaxed);
+        c.total_lo.store(0, std::memory_order_relaxed);
+        c.total_hi.store(0, std::memory_order_relaxed);
+        c.self_lo.store(0, std::memory_order_relaxed);
+        c.self_hi.store(0, std::memory_order_relaxed);
+        c.min.store(UINT32_MAX, std::memory_order_relaxed);
+        c.max.store(0, std::memory_order_relaxed);
+        for (auto &b : c.buckets) {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+const Probe *Probe::first()
+{
+    return probes.load(std::memory_order_acquire);
+}
+
+void reset_all()
+{
+    for (Probe *p = probes.load(std::memory_order_acquire); p != nullptr; p = const_cast<Probe *>(p->next())) {
+        p->reset();
+    }
+}
+
+void DumpReader::rewind()
+{
+    probe_ = Probe::first();
+    core_ = 0;
+    stage_ = stage_header;
+}
+
+size_t DumpReader::format_line(char *line, size_t capacity)
+{
+    switch (stage_) {
+    case stage_header:
+        stage_ = stage_columns;
+        return snprintf(line, capacity, "# profiler v1 target=%s cores=%d cpu_mhz=%" PRIu32 "\n", CONFIG_IDF_TARGET,
+                        portNUM_PROCESSORS, esp_rom_get_cpu_ticks_per_us());
+    case stage_columns:
+        stage_ = stage_probes;
+        return snprintf(line, capacity, "# core\tname\tparent\tcount\ttotal\tself\tmin\tmax\tbuckets\n");
+    case stage_probes:
+        while (probe_ != nullptr) {
+            const Probe *p = probe_;
+            int core = core_;
+            if (++core_ == portNUM_PROCESSORS) {
+                core_ = 0;
+                probe_ = p->next();
+            }
+            ProbeStats s = p->stats(core);
+            if (s.count == 0) {
+                continue;
+            }
+            const Probe *parent = p->parent();
+            int n = snprintf(line, capacity, "%d\t%s\t%s\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRIu32 "\t%" PRIu32 "\t",
+                             core, p->name(), parent != nullptr ? parent->name() : "-", s.count, s.total_cycles,
+                             s.self_cycles, s.min_cycles, s.max_cycles);
+            size_t len = n < 0 ? 0 : static_cast<size_t>(n);
+            const char *sep = "";
+            for (size_t i = 0; i < bucket_count && len < capacity; ++i) {
+                if (s.buckets[i] != 0) {
+                    n = snprintf(line + len, capacity - len, "%s%u:%" PRIu32, sep, static_cast<unsigned>(i),
+                                 s.buckets[i]);
+                    len += n < 0 ? 0 : static_cast<size_t>(n);
+                    sep = ",";
+                }
+            }
+            if (len + 1 >= capacity) {
+                len = capacity - 2;
+            }
+            line[len++] = '\n';
+            line[len] = '\0';
+            return len;
+        }
+        stage_ = stage_end;
+        [[fallthrough]];
+    case stage_end:
+        stage_ = stage_done;
+        return snprintf(line, capacity, "# end\n");
+    default:
+        return 0;
+    }
+}
+
+size_t DumpReader::read(char *buf, size_t capacity)
+{
+    /* Longest line: two names plus nine numbers and 33 buckets. */
+    char line[640];
+    size_t used = 0;
+    while (stage_ != stage_done) {
+        uint8_t stage = stage_;
+        const Probe *probe = probe_;
+        int core = core_;
+        size_t len = format_line(line, sizeof(line));
+        if (len > sizeof(line) - 1) {
+            len = sizeof(line) - 1;
+        }
+        if (used + len > capacity) {
+            if (used == 0 && capacity != 0) {
+                /* A line longer than the caller's buffer: send it cut short. */
+                len = capacity;
+                line[len - 1] = '\n';
+            } else {
+                /* Format it again on the next call. */
+                stage_ = stage;
+                probe_ = probe;
+                core_ = core;
+                break;
+            }
+        }
+        memcpy(buf + used, line, len);
+        used += len;
+    }
+    return used;
+}
+
+void dump()
+{
+    DumpReader reader;
+    char buf[640];
+    size_t n;
+    while ((n = reader.read(buf, sizeof(buf))) != 0) {
+        fwrite(buf, 1, n, stdout);
+    }
+    fflush(stdout);
+}
+
+#if CONFIG_PROFILER_TRACE_HOOKS
+
+namespace {
+
+Probe task_switch_probe{"task_switch"};
+DRAM_ATTR uint32_t switched_out_at[portNUM_PROCESSORS];
+DRAM_ATTR bool switched_out[portNUM_PROCESSORS];
+
+} // namespace
+
+#endif
+
+} // namespace profiler
+
+#if CONFIG_PROFILER_TRACE_HOOKS
+
+/* Called from vTaskSwitchContext() with the kernel lock held and interrupts
+ * masked; the delta between the two is the scheduler's selection of the next
+ * task, excluding the register save and restore around it. */
+extern "C" void IRAM_ATTR profiler_task_switched_out(void)
+{
+    int core = esp_cpu_get_core_id();
+    profiler::switched_out_at[core] = esp_cpu_get_cycle_count();
+    profiler::switched_out[core] = true;
+}
+
+extern "C" void IRAM_ATTR profiler_task_switched_in(void)
+{
+    int core = esp_cpu_get_core_id();
+    if (profiler::switched_out[core]) {
+        uint32_t cycles = esp_cpu_get_cycle_count() - profiler::switched_out_at[core];
+        profiler::switched_out[core] = false;
+        profiler::task_switch_probe.record(cycles, cycles);
+    }
+}
+
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "driver/gptimer.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "profiler/profiler.hpp"
+
+namespace rt_loop {
+
+/** Runs in the timer ISR: must be IRAM_ATTR, touch DRAM only and never block. */
+using Callback = void (*)(void *ctx);
+
+struct Stats {
+    uint32_t ticks;
+    /** Ticks whose callback started more than jitter_budget_ns after the alarm. */
+    uint32_t late;
+    /** Ticks where latency plus callback time exceeded the period, delaying the next tick. */
+    uint32_t overruns;
+    /** Ticks that ran while the flash cache was disabled by a flash write or erase. */
+    uint32_t cache_disabled;
+    /** Late ticks among cache_disabled: the flash operation itself broke the budget. */
+    uint32_t cache_disabled_late;
+    uint32_t max_latency_ns;
+    uint32_t max_callback_ns;
+};
+
+/**
+ * @brief Fixed-rate control loop driven by a general-purpose timer ISR.
+ *
+ * Every period the alarm interrupt calls the callback directly; there is no
+ * task wakeup and no scheduler in the path, so the start jitter is the
+ * interrupt latency of the core alone. The interrupt is allocated on
+ * Config::core, which the rest of the firmware should leave alone: start the
+ * executor with Executor::Config::reserved_core set to it and keep Wi-Fi and
+ * its interrupts on the other core (esp_wifi_init() from a task on core 0 and
+ * CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_0).
+ *
+ * With CONFIG_RT_LOOP_IRAM_SAFE the ISR also runs while a flash write or
+ * erase has the cache disabled, so the callback, everything it calls and
+ * everything it reads must be in IRAM/DRAM; start() rejects a callback
+ * outside IRAM and a context or Loop outside internal RAM. Ticks that land
+ * in such a period, and the ones among them that missed the budget, are
+ * counted separately so flash traffic can be told apart from other sources
+ * of jitter.
+ *
+ * Each tick records its alarm-to-callback latency (the start jitter) and the
+ * callback's run time into profiler probes, so the histograms come out of
+ * the regular profiler dump.
+ */
+class Loop {
+public:
+    struct Config {
+        Callback callback = nullptr;
+        void *ctx = nullptr;
+        uint32_t period_us = 100;
+        /** Start latency above this counts as late. */
+        uint32_t jitter_budget_ns = 2000;
+        /** Core that takes the alarm interrupt. */
+        BaseType_t core = portNUM_PROCESSORS - 1;
+        /** Interrupt priority 1-3; 0 lets the driver choose. */
+        int intr_priority = 3;
+        /** Probes for the latency and callback-time histograms; null for "rt_loop.latency"/"rt_loop.callback". */
+        profiler::Probe *latency_probe = nullptr;
+        profiler::Probe *callback_probe = nullptr;
+    };
+
+    Loop() = default;
+    ~Loop() { stop(); }
+
+    Loop(const Loop &) = delete;
+    Loop &operator=(const Loop &) = delete;
+
+    /** Allocate the timer on the configured core and start ticking. */
+    esp_err_t start(const Config &config);
+
+    /** Stop ticking and free the timer. Returns after the last callback has finished. */
+    void stop();
+
+    bool running() const { return timer_ != nullptr; }
+
+    Stats stats() const;
+    void reset_stats();
+
+    /** Log the counters; ESP_LOGW if any tick was late or overran, ESP_LOGI otherwise. */
+    void report() const;
+
+private:
+    static bool on_alarm(gptimer_handle_t timer, const gptimer_alarm_event_data_t *edata, void *ctx);
+    static void setup_task(void *arg);
+
+    esp_err_t setup();
+    void record_tick(uint32_t latency_cycles, uint32_t callback_cycles, bool cache_on);
+
+    Config config_;
+    gptimer_handle_t timer_ = nullptr;
+    profiler::Probe *latency_probe_ = nullptr;
+    profiler::Probe *callback_probe_ = nullptr;
+    uint32_t cycles_per_tick_ = 0;
+    uint32_t period_cycles_ = 0;
+    uint32_t budget_cycles_ = 0;
+    uint32_t cycles_per_us_ = 0;
+
+    /* Only the ISR writes these; the atomics let tasks read them mid-run. */
+    std::atomic<uint32_t> ticks_{0};
+    std::atomic<uint32_t> late_{0};
+    std::atomic<uint32_t> overruns_{0};
+    std::atomic<uint32_t> cache_disabled_{0};
+    std::atomic<uint32_t> cache_disabled_late_{0};
+    std::atomic<uint32_t> max_latency_{0};
+    std::atomic<uint32_t> max_callback_{0};
+};
+
+} // namespace rt_loop
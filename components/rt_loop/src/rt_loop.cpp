@@ -0,0 +1,229 @@
+#include "rt_loop/rt_loop.hpp"
+
+#include <cinttypes>
+
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_memory_utils.h"
+#include "esp_private/cache_utils.h"
+#include "esp_rom_sys.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace rt_loop {
+
+static const char *TAG = "rt_loop";
+
+namespace {
+
+constexpr uint32_t timer_hz = 40 * 1000 * 1000;
+
+profiler::Probe default_latency_probe{"rt_loop.latency"};
+profiler::Probe default_callback_probe{"rt_loop.callback"};
+
+struct Setup {
+    Loop *loop;
+    TaskHandle_t caller;
+    esp_err_t err;
+};
+
+} // namespace
+
+esp_err_t Loop::start(const Config &config)
+{
+    if (timer_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.callback == nullptr || config.period_us < 10 || config.period_us > 1000000 || config.core < 0 ||
+        config.core >= portNUM_PROCESSORS || config.intr_priority < 0 || config.intr_priority > 3) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_RT_LOOP_IRAM_SAFE
+    /* The ISR runs with the cache off: a flash-resident callback or data would fault there. */
+    if (!esp_ptr_in_iram(reinterpret_cast<const void *>(config.callback))) {
+        ESP_LOGE(TAG, "callback %p is not in IRAM; mark it IRAM_ATTR", reinterpret_cast<void *>(config.callback));
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((config.ctx != nullptr && !esp_ptr_internal(config.ctx)) || !esp_ptr_internal(this)) {
+        ESP_LOGE(TAG, "loop and callback context must be in internal RAM");
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+#if CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+    if (config.core == 1) {
+        ESP_LOGW(TAG, "the Wi-Fi task is pinned to core 1 too; expect it to add jitter");
+    }
+#endif
+
+    config_ = config;
+    latency_probe_ = config.latency_probe != nullptr ? config.latency_probe : &default_latency_probe;
+    callback_probe_ = config.callback_probe != nullptr ? config.callback_probe : &default_callback_probe;
+    cycles_per_us_ = esp_rom_get_cpu_ticks_per_us();
+    period_cycles_ = config.period_us * cycles_per_us_;
+    budget_cycles_ = static_cast<uint32_t>(uint64_t{config.jitter_budget_ns} * cycles_per_us_ / 1000);
+    reset_stats();
+
+    /* gptimer allocates its interrupt on the core that registers the callbacks. */
+    Setup setup = {this, xTaskGetCurrentTaskHandle(), ESP_FAIL};
+    if (xTaskCreatePinnedToCore(setup_task, "rt_loop_setup", 3072, &setup, configMAX_PRIORITIES - 1, nullptr,
+                                config.core) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (setup.err != ESP_OK) {
+        ESP_LOGE(TAG, "timer setup failed: %s", esp_err_to_name(setup.err));
+        return setup.err;
+    }
+    ESP_LOGI(TAG, "%" PRIu32 " us period on core %d, %" PRIu32 " ns jitter budget", config.period_us,
+             static_cast<int>(config.core), config.jitter_budget_ns);
+    return ESP_OK;
+}
+
+void Loop::setup_task(void *arg)
+{
+    auto *setup = static_cast<Setup *>(arg);
+    setup->err = setup->loop->setup();
+    xTaskNotifyGive(setup->caller);
+    vTaskDelete(nullptr);
+}
+
+esp_err_t Loop::setup()
+{
+    gptimer_config_t timer_config = {};
+    timer_config.clk_src = GPTIMER_CLK_SRC_DEFAULT;
+    timer_config.direction = GPTIMER_COUNT_UP;
+    timer_config.resolution_hz = timer_hz;
+    timer_config.intr_priority = config_.intr_priority;
+    gptimer_handle_t timer = nullptr;
+    esp_err_t err = gptimer_new_timer(&timer_config, &timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    gptimer_event_callbacks_t callbacks = {};
+    callbacks.on_alarm = on_alarm;
+    gptimer_alarm_config_t alarm = {};
+    alarm.alarm_count = static_cast<uint64_t>(config_.period_us) * (timer_hz / 1000000);
+    alarm.reload_count = 0;
+    alarm.flags.auto_reload_on_alarm = true;
+
+    err = gptimer_register_event_callbacks(timer, &callbacks, this);
+    if (err == ESP_OK) {
+        err = gptimer_set_alarm_action(timer, &alarm);
+    }
+    if (err == ESP_OK) {
+        err = gptimer_enable(timer);
+    }
+    if (err == ESP_OK) {
+        timer_ = timer;
+        err = gptimer_start(timer);
+        if (err == ESP_OK) {
+            return ESP_OK;
+        }
+        timer_ = nullptr;
+        gptimer_disable(timer);
+    }
+    gptimer_del_timer(timer);
+    return err;
+}
+
+void Loop::stop()
+{
+    if (timer_ == nullptr) {
+        return;
+    }
+    gptimer_stop(timer_);
+    gptimer_disable(timer_);
+    /* Freeing the interrupt runs on its core, after any callback in progress there has returned. */
+    gptimer_del_timer(timer_);
+    timer_ = nullptr;
+}
+
+bool IRAM_ATTR Loop::on_alarm(gptimer_handle_t, const gptimer_alarm_event_data_t *edata, void *ctx)
+{
+    auto *self = static_cast<Loop *>(ctx);
+    uint32_t start = esp_cpu_get_cycle_count();
+    /* The counter reloads to 0 at the alarm, so its value when the ISR ran is
+     * the time since the alarm fired. */
+    uint32_t latency = static_cast<uint32_t>(edata->count_value) * self->cycles_per_us_ / (timer_hz / 1000000);
+    bool cache_on = spi_flash_cache_enabled();
+    self->config_.callback(self->config_.ctx);
+    self->record_tick(latency, esp_cpu_get_cycle_count() - start, cache_on);
+    return false;
+}
+
+void IRAM_ATTR Loop::record_tick(uint32_t latency_cycles, uint32_t callback_cycles, bool cache_on)
+{
+    latency_probe_->record(latency_cycles, latency_cycles);
+    callback_probe_->record(callback_cycles, callback_cycles);
+
+    /* Single writer: plain load/store is enough for the counters. */
+    ticks_.store(ticks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    bool late = latency_cycles > budget_cycles_;
+    if (late) {
+        late_.store(late_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    if (latency_cycles + callback_cycles > period_cycles_) {
+        overruns_.store(overruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    if (!cache_on) {
+        cache_disabled_.store(cache_disabled_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (late) {
+            cache_disabled_late_.store(cache_disabled_late_.load(std::memory_order_relaxed) + 1,
+                                       std::memory_order_relaxed);
+        }
+    }
+    if (latency_cycles > max_latency_.load(std::memory_order_relaxed)) {
+        max_latency_.store(latency_cycles, std::memory_order_relaxed);
+    }
+    if (callback_cycles > max_callback_.load(std::memory_order_relaxed)) {
+        max_callback_.store(callback_cycles, std::memory_order_relaxed);
+    }
+}
+
+Stats Loop::stats() const
+{
+    uint32_t cycles_per_us = cycles_per_us_ != 0 ? cycles_per_us_ : 1;
+    Stats s;
+    s.ticks = ticks_.load(std::memory_order_relaxed);
+    s.late = late_.load(std::memory_order_relaxed);
+    s.overruns = overruns_.load(std::memory_order_relaxed);
+    s.cache_disabled = cache_disabled_.load(std::memory_order_relaxed);
+    s.cache_disabled_late = cache_disabled_late_.load(std::memory_order_relaxed);
+    s.max_latency_ns = static_cast<uint32_t>(uint64_t{max_latency_.load(std::memory_order_relaxed)} * 1000 /
+                                             cycles_per_us);
+    s.max_callback_ns = static_cast<uint32_t>(uint64_t{max_callback_.load(std::memory_order_relaxed)} * 1000 /
+                                              cycles_per_us);
+    return s;
+}
+
+void Loop::reset_stats()
+{
+    ticks_.store(0, std::memory_order_relaxed);
+    late_.store(0, std::memory_order_relaxed);
+    overruns_.store(0, std::memory_order_relaxed);
+    cache_disabled_.store(0, std::memory_order_relaxed);
+    cache_disabled_late_.store(0, std::memory_order_relaxed);
+    max_latency_.store(0, std::memory_order_relaxed);
+    max_callback_.store(0, std::memory_order_relaxed);
+}
+
+void Loop::report() const
+{
+    Stats s = stats();
+    if (s.late != 0 || s.overruns != 0) {
+        ESP_LOGW(TAG,
+                 "%" PRIu32 " ticks: %" PRIu32 " late, %" PRIu32 " overruns, %" PRIu32 " with cache disabled (%" PRIu32
+                 " late); max latency %" PRIu32 " ns, max callback %" PRIu32 " ns",
+                 s.ticks, s.late, s.overruns, s.cache_disabled, s.cache_disabled_late, s.max_latency_ns,
+                 s.max_callback_ns);
+    } else {
+        ESP_LOGI(TAG,
+                 "%" PRIu32 " ticks within budget, %" PRIu32 " with cache disabled; max latency %" PRIu32
+                 " ns, max callback %" PRIu32 " ns",
+                 s.ticks, s.cache_disabled, s.max_latency_ns, s.max_callback_ns);
+    }
+}
+
+} // namespace rt_loop
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "driver/spi_master.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lf_ring/spsc_ring.hpp"
+#include "soc/soc_caps.h"
+
+namespace sensor_acq {
+
+/**
+ * @brief One completed acquisition buffer.
+ *
+ * Samples are laid out device-major:
+ * <tt>data + (device * transactions_per_block + n) * transaction_stride</tt>
+ * is the rx data of the n-th transaction on @c device. The buffer stays valid
+ * until it is handed back with SpiAcquisition::release().
+ */
+struct Block {
+    const uint8_t *data;
+    size_t size;
+    /** Increments by one per block; consumers can use it to spot lost blocks. */
+    uint32_t seq;
+    /** esp_timer time at which the last transaction of the block completed. */
+    int64_t timestamp_us;
+    /** The bus ran dry before this block started: there is a gap in the samples. */
+    bool discontinuity;
+    uint8_t buffer;
+};
+
+struct AcquisitionStats {
+    uint32_t blocks;
+    /** Times every buffer was held by the consumer and acquisition stalled. */
+    uint32_t overruns;
+    /** Buffers dropped from rotation because the driver refused a transaction (a bad Config). */
+    uint32_t queue_errors;
+    /** Time the engine task spent running; divide by elapsed time for its CPU load. */
+    uint64_t engine_busy_us;
+};
+
+/**
+ * @brief Continuous SPI sampling from several devices through queued DMA transactions.
+ *
+ * A set of MALLOC_CAP_DMA buffers (two for ping-pong, more for slack) is
+ * split into one transaction slot per sample read. A whole buffer is queued
+ * with spi_device_queue_trans(), so the SPI master ISR moves straight from
+ * one transaction to the next without any task involvement. The device
+ * post-transaction callback only counts completions; when the last
+ * transaction of a buffer finishes it pushes the buffer index to an SPSC ring
+ * for the engine task, which collects the driver's results and hands a Block
+ * to the consumer through a second ring. Released buffers are requeued
+ * straight away, so the bus never waits for the consumer while a spare
+ * buffer exists.
+ *
+ * The SPI master still takes one interrupt per transaction. For ADCs that
+ * can stream several conversions per chip-select window (continuous-read
+ * mode, daisy chains, multi-channel SAR parts) set samples_per_transaction
+ * above 1, which divides the interrupt and bookkeeping rate accordingly.
+ *
+ * Transactions run back to back, so the sample period is the transaction
+ * time: tune it with the device clock and cs_ena_posttrans/dummy bits, or use
+ * the ADC's own conversion clock with a data-ready-paced read mode.
+ *
+ * The bus must already be initialised with spi_bus_initialize() and a DMA
+ * channel, and the object must live in internal RAM because the
+ * post-transaction callback touches it from the ISR. One host drives at most SOC_SPI_MAX_CS_NUM devices; use one
+ * engine per host for more.
+ */
+class SpiAcquisition {
+public:
+    static constexpr size_t max_devices = SOC_SPI_MAX_CS_NUM;
+    static constexpr size_t max_buffers = 8;
+
+    struct Device {
+        /** Passed to spi_bus_add_device(); queue_size and post_cb are overwritten. */
+        spi_device_interface_config_t interface;
+        /** Command and address phase values, if the interface enables them. */
+        uint16_t cmd;
+        uint64_t addr;
+    };
+
+    struct Config {
+        spi_host_device_t host = SPI2_HOST;
+        const Device *devices = nullptr;
+        size_t device_count = 0;
+        /** Bytes received per sample. */
+        size_t sample_bytes = 2;
+        /** Samples read within one chip-select window. */
+        size_t samples_per_transaction = 1;
+        /** Transactions per device per buffer. */
+        size_t transactions_per_block = 64;
+        /** DMA buffers in rotation; at least 2. */
+        size_t buffer_count = 3;
+        uint32_t task_stack_size = 3072;
+        UBaseType_t task_priority = 15;
+        BaseType_t task_core = tskNO_AFFINITY;
+    };
+
+    SpiAcquisition() = default;
+    ~SpiAcquisition() { deinit(); }
+
+    SpiAcquisition(const SpiAcquisition &) = delete;
+    SpiAcquisition &operator=(const SpiAcquisition &) = delete;
+
+    /** Add the devices to the bus and allocate the DMA buffers. */
+    esp_err_t init(const Config &config);
+
+    /** Stop, wait for in-flight transactions and remove the devices. Blocks become invalid. */
+    void deinit();
+
+    /** Queue every buffer and start the engine task. */
+    esp_err_t start();
+
+    /** Stop queueing; returns once the bus is idle. Undelivered buffers are dropped. */
+    void stop();
+
+    /**
+     * @brief Wait up to @p timeout for the next completed block.
+     *
+     * Single consumer task only; the first call routes wakeups to it unless
+     * notifier() was attached already.
+     */
+    bool receive(Block &out, TickType_t timeout)
+    {
+        if (ready_.notifier().task() == nullptr) {
+            ready_.notifier().attach(xTaskGetCurrentTaskHandle());
+        }
+        return ready_.pop_wait(out, timeout);
+    }
+
+    /** Give a block's buffer back for reuse. Must be called once per received block. */
+    void release(const Block &block);
+
+    /**
+     * @brief Wakeup routing for consumers that wait on several sources.
+     *
+     * Attach with distinct bits, then use xTaskNotifyWait() and receive(..., 0).
+     */
+    lf_ring::Notifier &notifier() { return ready_.notifier(); }
+
+    /** Distance between consecutive transactions in a block, rounded up for DMA. */
+    size_t transaction_stride() const { return stride_; }
+    size_t block_size() const { return block_size_; }
+
+    AcquisitionStats stats() const;
+
+private:
+    struct Buffer {
+        SpiAcquisition *owner;
+        uint8_t *data;
+        spi_transaction_t *trans;
+        int64_t timestamp_us;
+        std::atomic<uint32_t> pending;
+        /* Transactions the driver accepted; fewer than a block's after a queue error. */
+        uint32_t queued;
+        uint8_t index;
+        bool discontinuity;
+    };
+
+    /* Task notification bits of the engine task. */
+    static constexpr uint32_t bit_done = 1u << 0;
+    static constexpr uint32_t bit_free = 1u << 1;
+    static constexpr uint32_t bit_stop = 1u << 2;
+
+    esp_err_t queue_buffer(Buffer &buffer);
+    void collect(const Buffer &buffer);
+    static void on_transaction_done(spi_transaction_t *trans);
+    static void engine_task(void *arg);
+
+    Config config_;
+    Device devices_[max_devices] = {};
+    spi_device_handle_t handles_[max_devices] = {};
+    Buffer buffers_[max_buffers] = {};
+    spi_transaction_t *trans_ = nullptr;
+    size_t stride_ = 0;
+    size_t block_size_ = 0;
+
+    /* ISR -> engine: buffers whose last transaction completed. */
+    lf_ring::SpscRing<uint8_t, max_buffers> done_;
+    /* Consumer -> engine: released buffers. */
+    lf_ring::SpscRing<uint8_t, max_buffers> free_;
+    /* Engine -> consumer: completed blocks. */
+    lf_ring::SpscRing<Block, max_buffers> ready_;
+
+    TaskHandle_t task_ = nullptr;
+    std::atomic<bool> stopped_{false};
+    /* Engine task only. */
+    uint32_t in_flight_ = 0;
+    uint32_t seq_ = 0;
+    bool stalled_ = false;
+
+    std::atomic<uint32_t> blocks_{0};
+    std::atomic<uint32_t> overruns_{0};
+    std::atomic<uint32_t> queue_errors_{0};
+    std::atomic<uint64_t> engine_busy_us_{0};
+};
+
+} // namespace sensor_acq
@@ -0,0 +1,271 @@
+#include "sensor_acq/spi_acquisition.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "sensor_acq";
+
+namespace sensor_acq {
+
+namespace {
+
+/* DMA wants word-sized rx lengths; a full cache line also keeps buffers safe
+ * on targets where DMA memory is cached. */
+constexpr size_t dma_align = 64;
+
+size_t round_up(size_t value, size_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+} // namespace
+
+esp_err_t SpiAcquisition::init(const Config &config)
+{
+    if (trans_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.devices == nullptr || config.device_count == 0 || config.device_count > max_devices ||
+        config.buffer_count < 2 || config.buffer_count > max_buffers || config.transactions_per_block == 0 ||
+        config.sample_bytes == 0 || config.samples_per_transaction == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    config_ = config;
+    const size_t rx_bytes = config.sample_bytes * config.samples_per_transaction;
+    const size_t per_buffer = config.device_count * config.transactions_per_block;
+    stride_ = round_up(rx_bytes, 4);
+    block_size_ = stride_ * per_buffer;
+
+    trans_ = static_cast<spi_transaction_t *>(heap_caps_calloc(
+        config.buffer_count * per_buffer, sizeof(spi_transaction_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (trans_ == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t b = 0; b < config.buffer_count; ++b) {
+        Buffer &buffer = buffers_[b];
+        buffer.owner = this;
+        buffer.index = static_cast<uint8_t>(b);
+        buffer.trans = trans_ + b * per_buffer;
+        buffer.data = static_cast<uint8_t *>(
+            heap_caps_aligned_calloc(dma_align, 1, round_up(block_size_, dma_align), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL));
+        if (buffer.data == nullptr) {
+            ESP_LOGE(TAG, "no DMA memory for %u byte buffer", static_cast<unsigned>(block_size_));
+            deinit();
+            return ESP_ERR_NO_MEM;
+        }
+        for (size_t d = 0; d < config.device_count; ++d) {
+            for (size_t n = 0; n < config.transactions_per_block; ++n) {
+                spi_transaction_t &t = buffer.trans[d * config.transactions_per_block + n];
+                t.cmd = config.devices[d].cmd;
+                t.addr = config.devices[d].addr;
+                t.length = rx_bytes * 8;
+                t.rx_buffer = buffer.data + (d * config.transactions_per_block + n) * stride_;
+                t.user = &buffer;
+            }
+        }
+    }
+
+    for (size_t d = 0; d < config.device_count; ++d) {
+        devices_[d] = config.devices[d];
+        spi_device_interface_config_t interface = devices_[d].interface;
+        /* Room for every buffer at once, so queueing never blocks. */
+        interface.queue_size = static_cast<int>(config.buffer_count * config.transactions_per_block);
+        interface.post_cb = on_transaction_done;
+        esp_err_t err = spi_bus_add_device(config.host, &interface, &handles_[d]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "spi_bus_add_device(%u): %s", static_cast<unsigned>(d), esp_err_to_name(err));
+            deinit();
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+void SpiAcquisition::deinit()
+{
+    stop();
+    for (size_t d = 0; d < max_devices; ++d) {
+        if (handles_[d] != nullptr) {
+            spi_bus_remove_device(handles_[d]);
+            handles_[d] = nullptr;
+        }
+    }
+    for (size_t b = 0; b < max_buffers; ++b) {
+        heap_caps_free(buffers_[b].data);
+        buffers_[b].data = nullptr;
+    }
+    heap_caps_free(trans_);
+    trans_ = nullptr;
+}
+
+esp_err_t SpiAcquisition::start()
+{
+    if (trans_ == nullptr || task_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* Every buffer starts out free; the engine queues them on its first pass. */
+    for (size_t b = 0; b < config_.buffer_count; ++b) {
+        free_.push(static_cast<uint8_t>(b));
+    }
+    stopped_.store(false, std::memory_order_relaxed);
+    in_flight_ = 0;
+    stalled_ = false;
+    if (xTaskCreatePinnedToCore(engine_task, "sensor_acq", config_.task_stack_size, this, config_.task_priority,
+                                &task_, config_.task_core) != pdPASS) {
+        task_ = nullptr;
+        uint8_t index;
+        while (free_.pop(index)) {
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    done_.notifier().attach(task_, bit_done);
+    free_.notifier().attach(task_, bit_free);
+    /* Covers buffers pushed to free_ before the notifier was attached. */
+    xTaskNotify(task_, bit_free, eSetBits);
+    return ESP_OK;
+}
+
+void SpiAcquisition::stop()
+{
+    if (task_ == nullptr) {
+        return;
+    }
+    xTaskNotify(task_, bit_stop, eSetBits);
+    /* Not a notification: the consumer's own notification value may belong to ready_. */
+    while (!stopped_.load(std::memory_order_acquire)) {
+        vTaskDelay(1);
+    }
+    task_ = nullptr;
+    done_.notifier().detach();
+    free_.notifier().detach();
+    Block block;
+    while (ready_.pop(block)) {
+    }
+    uint8_t index;
+    while (free_.pop(index)) {
+    }
+}
+
+void SpiAcquisition::release(const Block &block)
+{
+    free_.push(block.buffer);
+}
+
+esp_err_t SpiAcquisition::queue_buffer(Buffer &buffer)
+{
+    const size_t tpb = config_.transactions_per_block;
+    const auto total = static_cast<uint32_t>(config_.device_count * tpb);
+    buffer.pending.store(total, std::memory_order_relaxed);
+    buffer.queued = 0;
+    buffer.discontinuity = stalled_;
+    if (stalled_) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        stalled_ = false;
+    }
+    ++in_flight_;
+    for (size_t d = 0; d < config_.device_count; ++d) {
+        for (size_t n = 0; n < tpb; ++n) {
+            esp_err_t err = spi_device_queue_trans(handles_[d], &buffer.trans[d * tpb + n], portMAX_DELAY);
+            if (err != ESP_OK) {
+                /* Only possible with an invalid transaction, i.e. a bad Config. The
+                 * transactions already queued still complete and are collected as
+                 * usual; the buffer then drops out of rotation without a block. */
+                ESP_LOGE(TAG, "spi_device_queue_trans: %s", esp_err_to_name(err));
+                queue_errors_.fetch_add(1, std::memory_order_relaxed);
+                uint32_t unqueued = total - buffer.queued;
+                if (buffer.pending.fetch_sub(unqueued, std::memory_order_relaxed) == unqueued) {
+                    /* All of them finished already, so the ISR will not report the buffer. */
+                    collect(buffer);
+                }
+                return err;
+            }
+            ++buffer.queued;
+        }
+    }
+    return ESP_OK;
+}
+
+void SpiAcquisition::collect(const Buffer &buffer)
+{
+    /* The driver has already finished these; this only empties its result
+     * queues, device by device in the order they were queued. */
+    const size_t tpb = config_.transactions_per_block;
+    spi_transaction_t *done;
+    for (size_t d = 0; d < config_.device_count; ++d) {
+        size_t first = d * tpb;
+        size_t count = buffer.queued <= first ? 0 : std::min<size_t>(tpb, buffer.queued - first);
+        for (size_t n = 0; n < count; ++n) {
+            spi_device_get_trans_result(handles_[d], &done, portMAX_DELAY);
+        }
+    }
+    if (--in_flight_ == 0) {
+        stalled_ = true;
+    }
+}
+
+void IRAM_ATTR SpiAcquisition::on_transaction_done(spi_transaction_t *trans)
+{
+    auto *buffer = static_cast<Buffer *>(trans->user);
+    if (buffer->pending.fetch_sub(1, std::memory_order_relaxed) == 1) {
+        buffer->timestamp_us = esp_timer_get_time();
+        BaseType_t woken = pdFALSE;
+        buffer->owner->done_.push_from_isr(buffer->index, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+void SpiAcquisition::engine_task(void *arg)
+{
+    auto *self = static_cast<SpiAcquisition *>(arg);
+    bool stopping = false;
+    uint8_t index;
+    for (;;) {
+        int64_t busy_start = esp_timer_get_time();
+        while (self->done_.pop(index)) {
+            Buffer &buffer = self->buffers_[index];
+            self->collect(buffer);
+            if (stopping || buffer.queued != self->config_.device_count * self->config_.transactions_per_block) {
+                continue;
+            }
+            Block block = {buffer.data, self->block_size_, self->seq_++, buffer.timestamp_us, buffer.discontinuity,
+                           buffer.index};
+            self->ready_.push(block);
+            self->blocks_.fetch_add(1, std::memory_order_relaxed);
+        }
+        while (!stopping && self->free_.pop(index)) {
+            self->queue_buffer(self->buffers_[index]);
+        }
+        self->engine_busy_us_.fetch_add(static_cast<uint64_t>(esp_timer_get_time() - busy_start),
+                                        std::memory_order_relaxed);
+        if (stopping && self->in_flight_ == 0) {
+            break;
+        }
+
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, bit_done | bit_free | bit_stop, &bits, portMAX_DELAY);
+        if (bits & bit_stop) {
+            stopping = true;
+        }
+    }
+    self->stopped_.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+AcquisitionStats SpiAcquisition::stats() const
+{
+    AcquisitionStats s = {};
+    s.blocks = blocks_.load(std::memory_order_relaxed);
+    s.overruns = overruns_.load(std::memory_order_relaxed);
+    s.queue_errors = queue_errors_.load(std::memory_order_relaxed);
+    s.engine_busy_us = engine_busy_us_.load(std::memory_order_relaxed);
+    return s;
+}
+
+} // namespace sensor_acq
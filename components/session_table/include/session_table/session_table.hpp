@@ -0,0 +1,267 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mem_pool/arena.hpp"
+#include "mem_pool/placement.hpp"
+
+namespace session_table {
+
+/** A peer's identity, packed into 64 bits by mac_key() or ipv4_key(). */
+using Key = uint64_t;
+
+enum class Transport : uint8_t {
+    ble = 1,
+    espnow = 2,
+    tcp = 3,
+    udp = 4,
+};
+
+/** Key of a peer known by its 48-bit address (BLE, ESP-NOW). */
+constexpr Key mac_key(Transport transport, const uint8_t mac[6])
+{
+    Key k = static_cast<Key>(transport) << 56;
+    for (size_t i = 0; i < 6; ++i) {
+        k |= static_cast<Key>(mac[i]) << (40 - 8 * i);
+    }
+    return k;
+}
+
+/** Key of an IPv4 peer; @p addr and @p port as lwIP keeps them. */
+constexpr Key ipv4_key(Transport transport, uint32_t addr, uint16_t port)
+{
+    return static_cast<Key>(transport) << 56 | static_cast<Key>(port) << 32 | addr;
+}
+
+struct Stats {
+    uint32_t entries;
+    uint32_t capacity;
+    uint32_t inserts;
+    /** put() and update() calls that replaced a live entry's value. */
+    uint32_t replaced;
+    uint32_t erased;
+    uint32_t expired;
+    /** Inserts refused because the table was at capacity or its spare entries were all retired. */
+    uint32_t full;
+    /** Replaced or removed entries waiting for readers to move on before their reuse. */
+    uint32_t retired;
+    uint32_t grace_periods;
+    /** Longest probe sequence an insert has needed. */
+    uint32_t max_probe;
+};
+
+/** Called by expire() for each idle session, before its entry is retired. */
+using ExpireFn = void (*)(void *ctx, Key key, const void *value);
+
+/** Edits the copy of a session's value that update() then publishes. */
+using UpdateFn = void (*)(void *ctx, void *value);
+
+/**
+ * @brief Fixed-capacity session table: open addressing, lock-free lookups, idle expiry.
+ *
+ * Built for a gateway tracking a few hundred peers, with lookups from the
+ * packet path on one core and connection handling on the other. All memory
+ * is one mem_pool::Arena taken at init(), so it neither allocates nor
+ * fragments the heap afterwards, and the arena shows up in
+ * mem_pool::log_stats() under Config::name.
+ *
+ * The layout is a structure of arrays. A power-of-two array of 32-bit slot
+ * words, at most half full, is probed linearly; each word holds 8 bits of the
+ * key's hash and an entry index, so a probe reads consecutive words and
+ * touches a key only on a tag match. Keys, values, last-activity times and
+ * expiry links are parallel arrays indexed by entry.
+ *
+ * Readers (find(), contains(), touch()) take no lock. Writers never change a
+ * published entry: put() and update() fill a spare entry and swap it into the
+ * slot with one store, and erase() and expiry unlink entries, in the manner of
+ * RCU. A retired entry is reused only after a grace period, once every reader
+ * that might have seen it has finished, tracked by per-core counters of
+ * readers in flight. Readers therefore never take the writers' mutex, and a
+ * reader that races a replacement copies either the old value or the new one,
+ * never a mix. A miss that races erase() moving entries back probes again; the
+ * move is a short critical section, so a reader on the other core waits for a
+ * few slot stores at most and one on the same core never does. Writers
+ * serialise on a mutex.
+ *
+ * Idle sessions expire through a hashed timer wheel of Config::wheel_slots
+ * ticks of Config::tick_ms. touch() only records the time; expire() visits the
+ * sessions due in each elapsed tick, drops those idle for
+ * Config::idle_timeout_ms and moves the others to the tick their timeout now
+ * ends, so an active session costs one wheel move per timeout period.
+ */
+class Table {
+public:
+    struct Config {
+        /** Shown by mem_pool::log_stats(); nullptr keeps the arena out of the registry. */
+        const char *name = "sessions";
+        /** Sessions held at once, at most 16383. */
+        size_t capacity = 256;
+        /** Bytes of each session's value. */
+        size_t value_size = 0;
+        /** Entries beyond capacity for replacements waiting out their grace period. */
+        size_t spare_entries = 16;
+        /**
+         * How long a writer that finds every spare entry retired waits for
+         * readers to finish with one, as when a reader task was preempted
+         * inside find().
+         */
+        uint32_t reclaim_wait_ms = 10;
+        /** Idle time after which expire() drops a session; 0 keeps sessions until erased. */
+        uint32_t idle_timeout_ms = 60000;
+        /** Resolution of the timer wheel. */
+        uint32_t tick_ms = 1000;
+        /** Wheel size, a power of two spanning more than idle_timeout_ms. */
+        size_t wheel_slots = 128;
+        mem_pool::Placement placement = mem_pool::Placement::Internal;
+        ExpireFn on_expire = nullptr;
+        void *expire_ctx = nullptr;
+    };
+
+    Table() = default;
+    ~Table() { deinit(); }
+
+    Table(const Table &) = delete;
+    Table &operator=(const Table &) = delete;
+
+    /** @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE or ESP_ERR_NO_MEM. */
+    esp_err_t init(const Config &config);
+
+    /** Release the arena. No reader may be inside the table. */
+    void deinit();
+
+    /**
+     * @brief Insert the session for @p key, or replace its value and mark it active.
+     *
+     * @return ESP_ERR_NO_MEM at capacity, or when every spare entry is still
+     * retired after Config::reclaim_wait_ms.
+     */
+    esp_err_t put(Key key, const void *value);
+
+    /** Replace @p key's value with a copy edited by @p fn, which must not call back into the table's writers. */
+    esp_err_t update(Key key, UpdateFn fn, void *ctx);
+
+    /** update() with a callable taking a T &, for example a lambda. */
+    template <typename T, typename F>
+    esp_err_t update(Key key, F &&fn)
+    {
+        using Fn = std::remove_reference_t<F>;
+        return update(
+            key, [](void *ctx, void *value) { (*static_cast<Fn *>(ctx))(*static_cast<T *>(value)); }, &fn);
+    }
+
+    /** @return ESP_ERR_NOT_FOUND if @p key has no session. */
+    esp_err_t erase(Key key);
+
+    /**
+     * @brief Drop the sessions that stayed idle for Config::idle_timeout_ms.
+     *
+     * Call at least once per Config::tick_ms for timely expiry; calling less
+     * often only expires sessions later. Config::on_expire runs on the caller
+     * with the writer lock held. @return the number of sessions expired.
+     */
+    size_t expire();
+
+    /** Copy @p key's value into @p out. Lock-free, from any core or an ISR. */
+    bool find(Key key, void *out) const;
+
+    bool contains(Key key) const;
+
+    /** Mark @p key's session active so expire() keeps it. Lock-free, like find(). */
+    bool touch(Key key);
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+    size_t capacity() const { return config_.capacity; }
+    Stats stats() const;
+
+private:
+    static constexpr uint16_t nil = 0xffff;
+
+    /* Readers in flight on one core, counted by the parity of the epoch they read. */
+    struct alignas(32) ReaderCount {
+        std::atomic<uint32_t> active[2];
+    };
+
+    class ReadSection {
+    public:
+        explicit ReadSection(const Table &table)
+        {
+            uint32_t parity = table.epoch_.load(std::memory_order_acquire) & 1;
+            count_ = &table.readers_[esp_cpu_get_core_id()].active[parity];
+            count_->fetch_add(1, std::memory_order_seq_cst);
+        }
+        /* The same counter even if the task moved cores meanwhile; the writer sums them. */
+        ~ReadSection() { count_->fetch_sub(1, std::memory_order_release); }
+
+        ReadSection(const ReadSection &) = delete;
+        ReadSection &operator=(const ReadSection &) = delete;
+
+    private:
+        std::atomic<uint32_t> *count_;
+    };
+
+    /* Entry holding @p key, or nil; readers only. */
+    uint16_t lookup(Key key) const;
+    /* Slot holding @p key, or the empty slot ending its probe; writers only. */
+    size_t probe(Key key, uint32_t hash, size_t *distance) const;
+    size_t home(Key key) const;
+    uint16_t take_entry();
+    void retire(uint16_t entry);
+    void reclaim();
+    /* reclaim() once enough entries are retired to be worth a grace period. */
+    void reclaim_batch();
+    /* Empty @p slot, shifting back the entries that probed past it. */
+    void remove_slot(size_t slot);
+    void schedule(uint16_t entry, uint32_t due_tick);
+    void unschedule(uint16_t entry);
+    uint8_t *value_of(uint16_t entry) const { return values_ + static_cast<size_t>(entry) * value_stride_; }
+
+    Config config_;
+    mem_pool::Arena arena_;
+    SemaphoreHandle_t lock_ = nullptr;
+
+    /* Slot words: 0 when empty, else the hash tag (bit 7 set) << 16 | entry. */
+    std::atomic<uint32_t> *slots_ = nullptr;
+    size_t slot_mask_ = 0;
+    /* Odd while erase() shifts entries back; a reader that missed during a shift probes again. */
+    std::atomic<uint32_t> shift_seq_{0};
+    /* Keeps the shift from being preempted on its own core. */
+    portMUX_TYPE shift_lock_ = portMUX_INITIALIZER_UNLOCKED;
+
+    /* Per entry. keys_ and values_ are written only while the entry is unpublished. */
+    Key *keys_ = nullptr;
+    uint8_t *values_ = nullptr;
+    size_t value_stride_ = 0;
+    std::atomic<uint32_t> *last_active_ms_ = nullptr;
+    uint16_t *slot_of_ = nullptr;
+    /* Wheel bucket links while live; next_ chains the retired list afterwards. */
+    uint16_t *next_ = nullptr;
+    uint16_t *prev_ = nullptr;
+    uint32_t *due_tick_ = nullptr;
+    uint32_t *retired_at_ = nullptr;
+    uint16_t *free_ = nullptr;
+    size_t free_count_ = 0;
+    uint16_t retired_head_ = nil;
+    uint16_t retired_tail_ = nil;
+    size_t retired_count_ = 0;
+
+    uint16_t *wheel_ = nullptr;
+    uint32_t wheel_tick_ = 0;
+
+    /* Grace periods: readers count themselves under the parity of epoch_. */
+    std::atomic<uint32_t> epoch_{0};
+    uint32_t completed_ = 0;
+    bool draining_ = false;
+    mutable ReaderCount readers_[portNUM_PROCESSORS] = {};
+
+    std::atomic<uint32_t> count_{0};
+    Stats stats_ = {};
+};
+
+} // namespace session_table
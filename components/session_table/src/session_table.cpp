@@ -0,0 +1,551 @@
+#include "session_table/session_table.hpp"
+
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+
+static const char *TAG = "session_table";
+
+namespace session_table {
+
+namespace {
+
+constexpr size_t max_capacity = 16383;
+constexpr uint32_t tag_mask = 0xffff0000;
+constexpr uint32_t entry_mask = 0x0000ffff;
+
+/* The finaliser of MurmurHash3: keys differing in any bit spread over the whole word. */
+uint32_t hash_of(Key key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return static_cast<uint32_t>(key);
+}
+
+/* The low bits pick the slot and the top seven the tag, so the two are independent. */
+uint32_t tag_of(uint32_t hash)
+{
+    return (0x80u | (hash >> 25)) << 16;
+}
+
+size_t round_up(size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+int64_t now_ms()
+{
+    return esp_timer_get_time() / 1000;
+}
+
+} // namespace
+
+esp_err_t Table::init(const Config &config)
+{
+    if (slots_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t entries = config.capacity + config.spare_entries;
+    if (config.capacity == 0 || config.capacity > max_capacity || config.spare_entries == 0 || entries >= nil ||
+        config.tick_ms == 0 || config.wheel_slots == 0 || (config.wheel_slots & (config.wheel_slots - 1)) != 0 ||
+        config.wheel_slots > nil || config.idle_timeout_ms / config.tick_ms >= config.wheel_slots) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    config_ = config;
+
+    /* At most half full, so probes stay short and every probe meets an empty slot. */
+    size_t slot_count = 1;
+    while (slot_count < 2 * config_.capacity) {
+        slot_count <<= 1;
+    }
+    value_stride_ = round_up(config_.value_size, 4);
+    size_t wheel_count = config_.idle_timeout_ms != 0 ? config_.wheel_slots : 0;
+    constexpr size_t align = 8;
+    size_t bytes = round_up(slot_count * sizeof(uint32_t), align) + round_up(entries * sizeof(Key), align) +
+                   round_up(entries * value_stride_, align) + round_up(entries * sizeof(uint32_t), align) * 3 +
+                   round_up(entries * sizeof(uint16_t), align) * 4 + round_up(wheel_count * sizeof(uint16_t), align);
+    mem_pool::Arena::Config arena_config;
+    arena_config.name = config_.name;
+    arena_config.capacity = bytes;
+    arena_config.placement = config_.placement;
+    esp_err_t err = arena_.init(arena_config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    slots_ = static_cast<std::atomic<uint32_t> *>(arena_.allocate(slot_count * sizeof(uint32_t), align));
+    keys_ = static_cast<Key *>(arena_.allocate(entries * sizeof(Key), align));
+    values_ = static_cast<uint8_t *>(arena_.allocate(entries * value_stride_, align));
+    last_active_ms_ = static_cast<std::atomic<uint32_t> *>(arena_.allocate(entries * sizeof(uint32_t), align));
+    due_tick_ = static_cast<uint32_t *>(arena_.allocate(entries * sizeof(uint32_t), align));
+    retired_at_ = static_cast<uint32_t *>(arena_.allocate(entries * sizeof(uint32_t), align));
+    slot_of_ = static_cast<uint16_t *>(arena_.allocate(entries * sizeof(uint16_t), align));
+    next_ = static_cast<uint16_t *>(arena_.allocate(entries * sizeof(uint16_t), align));
+    prev_ = static_cast<uint16_t *>(arena_.allocate(entries * sizeof(uint16_t), align));
+    free_ = static_cast<uint16_t *>(arena_.allocate(entries * sizeof(uint16_t), align));
+    wheel_ = wheel_count != 0 ? static_cast<uint16_t *>(arena_.allocate(wheel_count * sizeof(uint16_t), align))
+                              : nullptr;
+    lock_ = xSemaphoreCreateMutex();
+    if (slots_ == nullptr || keys_ == nullptr || values_ == nullptr || last_active_ms_ == nullptr ||
+        due_tick_ == nullptr || retired_at_ == nullptr || slot_of_ == nullptr || next_ == nullptr ||
+        prev_ == nullptr || free_ == nullptr || (wheel_count != 0 && wheel_ == nullptr) || lock_ == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < slot_count; ++i) {
+        slots_[i].store(0, std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < entries; ++i) {
+        last_active_ms_[i].store(0, std::memory_order_relaxed);
+        /* Popped from the back, so entry 0 goes first. */
+        free_[i] = static_cast<uint16_t>(entries - 1 - i);
+    }
+    for (size_t i = 0; i < wheel_count; ++i) {
+        wheel_[i] = nil;
+    }
+    slot_mask_ = slot_count - 1;
+    free_count_ = entries;
+    retired_head_ = nil;
+    retired_tail_ = nil;
+    retired_count_ = 0;
+    wheel_tick_ = static_cast<uint32_t>(now_ms() / config_.tick_ms);
+    completed_ = epoch_.load(std::memory_order_relaxed);
+    draining_ = false;
+    count_.store(0, std::memory_order_relaxed);
+    stats_ = {};
+    ESP_LOGI(TAG, "%s: %u sessions of %u bytes, %u slots, %u bytes in %s",
+             config_.name != nullptr ? config_.name : "?", static_cast<unsigned>(config_.capacity),
+             static_cast<unsigned>(config_.value_size), static_cast<unsigned>(slot_count),
+             static_cast<unsigned>(bytes), mem_pool::placement_name(config_.placement));
+    return ESP_OK;
+}
+
+void Table::deinit()
+{
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+    arena_.deinit();
+    slots_ = nullptr;
+    keys_ = nullptr;
+    values_ = nullptr;
+    last_active_ms_ = nullptr;
+    due_tick_ = nullptr;
+    retired_at_ = nullptr;
+    slot_of_ = nullptr;
+    next_ = nullptr;
+    prev_ = nullptr;
+    free_ = nullptr;
+    wheel_ = nullptr;
+    free_count_ = 0;
+    count_.store(0, std::memory_order_relaxed);
+}
+
+size_t Table::home(Key key) const
+{
+    return hash_of(key) & slot_mask_;
+}
+
+size_t Table::probe(Key key, uint32_t hash, size_t *distance) const
+{
+    uint32_t tag = tag_of(hash);
+    size_t i = hash & slot_mask_;
+    size_t d = 0;
+    for (;;) {
+        uint32_t w = slots_[i].load(std::memory_order_relaxed);
+        if (w == 0 || ((w & tag_mask) == tag && keys_[w & entry_mask] == key)) {
+            *distance = d;
+            return i;
+        }
+        i = (i + 1) & slot_mask_;
+        ++d;
+    }
+}
+
+uint16_t Table::lookup(Key key) const
+{
+    uint32_t hash = hash_of(key);
+    uint32_t tag = tag_of(hash);
+    for (;;) {
+        uint32_t seq = shift_seq_.load(std::memory_order_acquire);
+        size_t i = hash & slot_mask_;
+        for (size_t n = 0; n <= slot_mask_; ++n) {
+            uint32_t w = slots_[i].load(std::memory_order_acquire);
+            if (w == 0) {
+                break;
+            }
+            if ((w & tag_mask) == tag && keys_[w & entry_mask] == key) {
+                return static_cast<uint16_t>(w & entry_mask);
+            }
+            i = (i + 1) & slot_mask_;
+        }
+        /* A miss counts only if no erase() was moving entries back meanwhile. */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) == 0 && shift_seq_.load(std::memory_order_relaxed) == seq) {
+            return nil;
+        }
+    }
+}
+
+bool Table::find(Key key, void *out) const
+{
+    if (slots_ == nullptr) {
+        return false;
+    }
+    ReadSection section(*this);
+    uint16_t e = lookup(key);
+    if (e == nil) {
+        return false;
+    }
+    if (out != nullptr) {
+        memcpy(out, value_of(e), config_.value_size);
+    }
+    return true;
+}
+
+bool Table::contains(Key key) const
+{
+    return find(key, nullptr);
+}
+
+bool Table::touch(Key key)
+{
+    if (slots_ == nullptr) {
+        return false;
+    }
+    ReadSection section(*this);
+    uint16_t e = lookup(key);
+    if (e == nil) {
+        return false;
+    }
+    /* A touch that lands on an entry being replaced is lost at worst: the session expires a little early. */
+    last_active_ms_[e].store(static_cast<uint32_t>(now_ms()), std::memory_order_relaxed);
+    return true;
+}
+
+uint16_t Table::take_entry()
+{
+    TickType_t waited = 0;
+    TickType_t limit = pdMS_TO_TICKS(config_.reclaim_wait_ms);
+    while (free_count_ == 0) {
+        reclaim();
+        if (free_count_ != 0) {
+            break;
+        }
+        if (waited >= limit) {
+            return nil;
+        }
+        vTaskDelay(1);
+        ++waited;
+    }
+    return free_[--free_count_];
+}
+
+void Table::retire(uint16_t entry)
+{
+    retired_at_[entry] = epoch_.load(std::memory_order_relaxed);
+    next_[entry] = nil;
+    if (retired_tail_ == nil) {
+        retired_head_ = entry;
+    } else {
+        next_[retired_tail_] = entry;
+    }
+    retired_tail_ = entry;
+    ++retired_count_;
+}
+
+void Table::reclaim()
+{
+    /* An entry retired at epoch r was unpublished before the flips to r + 1
+     * and r + 2; once the readers counted under each parity after its flip
+     * have drained, none can still hold the entry. */
+    while (retired_head_ != nil) {
+        uint16_t e = retired_head_;
+        if (static_cast<int32_t>(completed_ - retired_at_[e]) >= 2) {
+            retired_head_ = next_[e];
+            if (retired_head_ == nil) {
+                retired_tail_ = nil;
+            }
+            free_[free_count_++] = e;
+            --retired_count_;
+            continue;
+        }
+        if (!draining_) {
+            epoch_.fetch_add(1, std::memory_order_seq_cst);
+            draining_ = true;
+        }
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t epoch = epoch_.load(std::memory_order_relaxed);
+        uint32_t parity = (epoch - 1) & 1;
+        uint32_t in_flight = 0;
+        for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+            in_flight += readers_[core].active[parity].load(std::memory_order_acquire);
+        }
+        if (in_flight != 0) {
+            return;
+        }
+        draining_ = false;
+        completed_ = epoch;
+        ++stats_.grace_periods;
+    }
+}
+
+void Table::reclaim_batch()
+{
+    /* Two epoch flips free every entry retired before them, so waiting for
+     * half the spares spreads those flips over many writes. */
+    if (retired_count_ * 2 >= config_.spare_entries) {
+        reclaim();
+    }
+}
+
+void Table::schedule(uint16_t entry, uint32_t due_tick)
+{
+    if (wheel_ == nullptr) {
+        return;
+    }
+    uint16_t &head = wheel_[due_tick & (config_.wheel_slots - 1)];
+    due_tick_[entry] = due_tick;
+    prev_[entry] = nil;
+    next_[entry] = head;
+    if (head != nil) {
+        prev_[head] = entry;
+    }
+    head = entry;
+}
+
+void Table::unschedule(uint16_t entry)
+{
+    if (wheel_ == nullptr) {
+        return;
+    }
+    if (prev_[entry] != nil) {
+        next_[prev_[entry]] = next_[entry];
+    } else {
+        wheel_[due_tick_[entry] & (config_.wheel_slots - 1)] = next_[entry];
+    }
+    if (next_[entry] != nil) {
+        prev_[next_[entry]] = prev_[entry];
+    }
+}
+
+void Table::remove_slot(size_t slot)
+{
+    /* Linear probing without tombstones: each later entry whose home lies at
+     * or before the hole moves back into it. An entry in flight sits in two
+     * slots for a moment and never in none, but a reader passing the hole
+     * before the move and the old slot after it misses, so the sequence
+     * count sends such a reader round again. The shift runs in a critical
+     * section: a reader preempting it on this core would otherwise retry
+     * until it gave the core back, which an ISR never does. */
+    bool shifting = false;
+    size_t j = slot;
+    for (;;) {
+        j = (j + 1) & slot_mask_;
+        uint32_t w = slots_[j].load(std::memory_order_relaxed);
+        if (w == 0) {
+            break;
+        }
+        uint16_t e = static_cast<uint16_t>(w & entry_mask);
+        size_t k = home(keys_[e]);
+        if (((j - k) & slot_mask_) < ((j - slot) & slot_mask_)) {
+            continue;
+        }
+        if (!shifting) {
+            portENTER_CRITICAL(&shift_lock_);
+            shift_seq_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            shifting = true;
+        }
+        slots_[slot].store(w, std::memory_order_release);
+        slot_of_[e] = static_cast<uint16_t>(slot);
+        slot = j;
+    }
+    slots_[slot].store(0, std::memory_order_release);
+    if (shifting) {
+        shift_seq_.fetch_add(1, std::memory_order_release);
+        portEXIT_CRITICAL(&shift_lock_);
+    }
+}
+
+esp_err_t Table::put(Key key, const void *value)
+{
+    if (slots_ == nullptr || (value == nullptr && config_.value_size != 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint32_t hash = hash_of(key);
+    size_t distance;
+    size_t slot = probe(key, hash, &distance);
+    uint32_t old = slots_[slot].load(std::memory_order_relaxed);
+    if (old == 0 && count_.load(std::memory_order_relaxed) == config_.capacity) {
+        ++stats_.full;
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NO_MEM;
+    }
+    uint16_t e = take_entry();
+    if (e == nil) {
+        ++stats_.full;
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NO_MEM;
+    }
+    int64_t now = now_ms();
+    keys_[e] = key;
+    if (config_.value_size != 0) {
+        memcpy(value_of(e), value, config_.value_size);
+    }
+    last_active_ms_[e].store(static_cast<uint32_t>(now), std::memory_order_relaxed);
+    slot_of_[e] = static_cast<uint16_t>(slot);
+    if (old != 0) {
+        uint16_t prior = static_cast<uint16_t>(old & entry_mask);
+        unschedule(prior);
+        ++stats_.replaced;
+        schedule(e, static_cast<uint32_t>((now + config_.idle_timeout_ms) / config_.tick_ms));
+        slots_[slot].store(tag_of(hash) | e, std::memory_order_release);
+        retire(prior);
+    } else {
+        ++stats_.inserts;
+        if (distance + 1 > stats_.max_probe) {
+            stats_.max_probe = static_cast<uint32_t>(distance + 1);
+        }
+        schedule(e, static_cast<uint32_t>((now + config_.idle_timeout_ms) / config_.tick_ms));
+        slots_[slot].store(tag_of(hash) | e, std::memory_order_release);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    reclaim_batch();
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Table::update(Key key, UpdateFn fn, void *ctx)
+{
+    if (slots_ == nullptr || fn == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    uint32_t hash = hash_of(key);
+    size_t distance;
+    size_t slot = probe(key, hash, &distance);
+    uint32_t old = slots_[slot].load(std::memory_order_relaxed);
+    if (old == 0) {
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint16_t e = take_entry();
+    if (e == nil) {
+        ++stats_.full;
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NO_MEM;
+    }
+    uint16_t prior = static_cast<uint16_t>(old & entry_mask);
+    keys_[e] = key;
+    memcpy(value_of(e), value_of(prior), config_.value_size);
+    fn(ctx, value_of(e));
+    last_active_ms_[e].store(last_active_ms_[prior].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slot_of_[e] = static_cast<uint16_t>(slot);
+    /* Same bucket as before: the update is not activity. */
+    if (wheel_ != nullptr) {
+        uint32_t due = due_tick_[prior];
+        unschedule(prior);
+        schedule(e, due);
+    }
+    slots_[slot].store(tag_of(hash) | e, std::memory_order_release);
+    retire(prior);
+    ++stats_.replaced;
+    reclaim_batch();
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Table::erase(Key key)
+{
+    if (slots_ == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    size_t distance;
+    size_t slot = probe(key, hash_of(key), &distance);
+    uint32_t w = slots_[slot].load(std::memory_order_relaxed);
+    if (w == 0) {
+        xSemaphoreGive(lock_);
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint16_t e = static_cast<uint16_t>(w & entry_mask);
+    unschedule(e);
+    remove_slot(slot);
+    retire(e);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    ++stats_.erased;
+    reclaim_batch();
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+size_t Table::expire()
+{
+    if (slots_ == nullptr || wheel_ == nullptr) {
+        return 0;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    int64_t now = now_ms();
+    uint32_t now_tick = static_cast<uint32_t>(now / config_.tick_ms);
+    uint32_t wheel_mask = static_cast<uint32_t>(config_.wheel_slots - 1);
+    /* After a long gap one turn of the wheel visits every session. */
+    if (static_cast<int32_t>(now_tick - wheel_tick_) >= static_cast<int32_t>(config_.wheel_slots)) {
+        wheel_tick_ = now_tick - wheel_mask;
+    }
+    size_t expired = 0;
+    while (static_cast<int32_t>(now_tick - wheel_tick_) >= 0) {
+        uint16_t e = wheel_[wheel_tick_ & wheel_mask];
+        wheel_[wheel_tick_ & wheel_mask] = nil;
+        while (e != nil) {
+            uint16_t next = next_[e];
+            /* A touch() on the other core during the walk may be later than now. */
+            int32_t since = static_cast<int32_t>(static_cast<uint32_t>(now) -
+                                                 last_active_ms_[e].load(std::memory_order_relaxed));
+            uint32_t idle = since > 0 ? static_cast<uint32_t>(since) : 0;
+            if (idle >= config_.idle_timeout_ms) {
+                if (config_.on_expire != nullptr) {
+                    config_.on_expire(config_.expire_ctx, keys_[e], value_of(e));
+                }
+                remove_slot(slot_of_[e]);
+                retire(e);
+                count_.fetch_sub(1, std::memory_order_relaxed);
+                ++expired;
+            } else {
+                /* Touched since it was scheduled: move it to where its timeout now ends. */
+                uint32_t due = static_cast<uint32_t>((now - idle + config_.idle_timeout_ms) / config_.tick_ms);
+                if (static_cast<int32_t>(due - wheel_tick_) <= 0) {
+                    due = wheel_tick_ + 1;
+                }
+                schedule(e, due);
+            }
+            e = next;
+        }
+        ++wheel_tick_;
+    }
+    stats_.expired += expired;
+    reclaim();
+    xSemaphoreGive(lock_);
+    return expired;
+}
+
+Stats Table::stats() const
+{
+    Stats s = {};
+    if (lock_ == nullptr) {
+        return s;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    s = stats_;
+    s.entries = count_.load(std::memory_order_relaxed);
+    s.capacity = static_cast<uint32_t>(config_.capacity);
+    s.retired = static_cast<uint32_t>(retired_count_);
+    xSemaphoreGive(lock_);
+    return s;
+}
+
+} // namespace session_table
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "telemetry_enc/json_writer.hpp"
+#include "telemetry_enc/output.hpp"
+
+namespace telemetry_enc {
+
+/**
+ * @brief Streaming CBOR (RFC 8949) writer with the same interface as JsonWriter.
+ *
+ * Containers with a known count get a definite-length header; with
+ * unknown_size they are written indefinite-length and closed with a break
+ * byte, so a batch can be streamed without counting it first. Integers use
+ * the shortest head, floats are encoded as binary32 and doubles as binary64.
+ */
+class CborWriter {
+public:
+    static constexpr size_t max_depth = 32;
+
+    explicit CborWriter(Output &out) : out_(out) {}
+
+    void begin_object(size_t count = unknown_size) { open(5, count); }
+    void end_object() { close(); }
+    void begin_array(size_t count = unknown_size) { open(4, count); }
+    void end_array() { close(); }
+
+    void key(std::string_view name) { value(name); }
+
+    void value(bool v) { out_.put(v ? 0xf5 : 0xf4); }
+    void value(float v);
+    void value(double v);
+    void value(std::string_view v)
+    {
+        head(3, v.size());
+        out_.write(v.data(), v.size());
+    }
+    void value(const char *v) { value(std::string_view(v)); }
+    void null() { out_.put(0xf6); }
+
+    /** Byte string (major type 2); JSON has no equivalent. */
+    void bytes(const void *data, size_t len)
+    {
+        head(2, len);
+        out_.write(data, len);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type value(T v)
+    {
+        if constexpr (std::is_signed<T>::value) {
+            if (v < 0) {
+                /* Major type 1 encodes -1 - n. */
+                head(1, ~static_cast<uint64_t>(static_cast<int64_t>(v)));
+                return;
+            }
+        }
+        head(0, static_cast<uint64_t>(v));
+    }
+
+    Output &output() { return out_; }
+
+    bool ok() const { return !out_.overflowed() && depth_ == 0 && !broken_; }
+
+private:
+    void head(uint8_t major, uint64_t arg);
+    void open(uint8_t major, size_t count);
+    void close();
+
+    Output &out_;
+    /* Bit n set: level n is indefinite-length and needs a break byte. */
+    uint32_t indefinite_ = 0;
+    uint8_t depth_ = 0;
+    bool broken_ = false;
+};
+
+} // namespace telemetry_enc
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "telemetry_enc/output.hpp"
+
+namespace telemetry_enc {
+
+/** Passed as a container size when the element count is not known up front. */
+constexpr size_t unknown_size = SIZE_MAX;
+
+/**
+ * @brief Streaming JSON writer.
+ *
+ * Separators are tracked per nesting level, so callers only emit structure
+ * and values. Numbers are formatted by hand (no printf, no libm) and
+ * non-finite floats become null. Keys are written verbatim and must not
+ * need escaping; string values are escaped.
+ *
+ * Shares its interface with CborWriter so schema-driven encode() works with
+ * either; the container sizes it is given are ignored.
+ */
+class JsonWriter {
+public:
+    static constexpr size_t max_depth = 32;
+
+    /** @p float_digits: digits after the decimal point for float/double values. */
+    explicit JsonWriter(Output &out, uint8_t float_digits = 4) : out_(out), float_digits_(float_digits) {}
+
+    void begin_object(size_t count = unknown_size);
+    void end_object();
+    void begin_array(size_t count = unknown_size);
+    void end_array();
+
+    void key(std::string_view name);
+
+    void value(bool v);
+    void value(float v);
+    void value(double v);
+    void value(std::string_view v);
+    void value(const char *v) { value(std::string_view(v)); }
+    void null();
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type value(T v)
+    {
+        separate();
+        if constexpr (std::is_signed<T>::value) {
+            write_int(static_cast<int64_t>(v));
+        } else {
+            write_uint(static_cast<uint64_t>(v));
+        }
+    }
+
+    Output &output() { return out_; }
+
+    /** No overflow, and every container closed. */
+    bool ok() const { return !out_.overflowed() && depth_ == 0 && !broken_; }
+
+private:
+    void open(char bracket);
+    void close(char bracket);
+    void separate();
+    void write_int(int64_t v);
+    void write_uint(uint64_t v);
+    template <typename F>
+    void write_real(F v);
+
+    Output &out_;
+    /* Bit n set: level n already has an element, so the next one needs a comma. */
+    uint32_t has_element_ = 0;
+    uint8_t depth_ = 0;
+    uint8_t float_digits_;
+    bool after_key_ = false;
+    bool broken_ = false;
+};
+
+} // namespace telemetry_enc
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "esp_err.h"
+
+struct pbuf;
+
+namespace telemetry_enc {
+
+/**
+ * @brief Byte sink the writers encode into.
+ *
+ * Writing is a pointer bump into the current window; only when the window
+ * is full is the subclass asked for the next one (the next pbuf in a chain,
+ * say). When no more room is available the output latches overflowed() and
+ * drops everything after it, so encoders never need to check every call -
+ * check once at the end.
+ */
+class Output {
+public:
+    void put(uint8_t byte)
+    {
+        if (pos_ == end_ && !advance()) {
+            return;
+        }
+        *pos_++ = byte;
+    }
+
+    void write(const void *data, size_t len)
+    {
+        if (static_cast<size_t>(end_ - pos_) >= len) {
+            memcpy(pos_, data, len);
+            pos_ += len;
+            return;
+        }
+        write_slow(static_cast<const uint8_t *>(data), len);
+    }
+
+    /** Bytes written so far (not counting anything dropped after overflow). */
+    size_t size() const { return flushed_ + static_cast<size_t>(pos_ - start_); }
+
+    bool overflowed() const { return overflowed_; }
+
+protected:
+    /** Ask for the next window with set_window(); return false when there is none. */
+    using AdvanceFn = bool (*)(Output &self);
+
+    explicit Output(AdvanceFn advance) : advance_(advance) {}
+    ~Output() = default;
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+    void set_window(uint8_t *start, size_t len)
+    {
+        flushed_ += static_cast<size_t>(pos_ - start_);
+        start_ = start;
+        pos_ = start;
+        end_ = start + len;
+    }
+
+private:
+    bool advance();
+    void write_slow(const uint8_t *data, size_t len);
+
+    uint8_t *start_ = nullptr;
+    uint8_t *pos_ = nullptr;
+    uint8_t *end_ = nullptr;
+    size_t flushed_ = 0;
+    AdvanceFn advance_;
+    bool overflowed_ = false;
+};
+
+/** Encode into one caller-provided buffer. */
+class BufferOutput : public Output {
+public:
+    BufferOutput(void *buffer, size_t capacity);
+
+    const uint8_t *data() const { return buffer_; }
+
+private:
+    uint8_t *buffer_;
+};
+
+/**
+ * @brief Encode straight into an lwIP pbuf chain, e.g. one from
+ * pbuf_alloc(PBUF_TRANSPORT, max_len, PBUF_POOL).
+ *
+ * The chain stays owned by the caller. finish() trims it to the encoded
+ * length, ready for udp_send() / altcp_write() style calls.
+ */
+class PbufOutput : public Output {
+public:
+    explicit PbufOutput(struct pbuf *chain);
+
+    /** Shrink the chain to size(). @return ESP_ERR_NO_MEM if the encoding did not fit. */
+    esp_err_t finish();
+
+    struct pbuf *chain() const { return chain_; }
+
+private:
+    static bool next_segment(Output &self);
+
+    struct pbuf *chain_;
+    struct pbuf *current_;
+};
+
+/** Discards the bytes and only counts them, to size a buffer before encoding. */
+class CountingOutput : public Output {
+public:
+    CountingOutput();
+
+private:
+    static bool recycle(Output &self);
+
+    uint8_t scratch_[32];
+};
+
+} // namespace telemetry_enc
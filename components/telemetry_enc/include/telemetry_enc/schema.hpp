@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#include "telemetry_enc/json_writer.hpp"
+
+namespace telemetry_enc {
+
+/**
+ * @brief Compile-time description of how a struct is encoded.
+ *
+ * @code
+ * struct Reading { uint32_t ts; float temp; float accel[3]; };
+ *
+ * constexpr auto reading_schema = telemetry_enc::schema<Reading>(
+ *     telemetry_enc::field("ts", &Reading::ts),
+ *     telemetry_enc::field("temp", &Reading::temp),
+ *     telemetry_enc::field("accel", &Reading::accel));
+ *
+ * telemetry_enc::CborWriter w(out);
+ * telemetry_enc::encode_array(w, reading_schema, readings, count);
+ * @endcode
+ *
+ * The field list is a tuple of member pointers, so encode() unrolls into a
+ * straight sequence of key/value calls with the field count known up front
+ * (definite-length CBOR maps). Members may be arithmetic, bool, const char *,
+ * std::string_view, fixed arrays of those, or structs with their own schema.
+ */
+template <typename T, typename M>
+struct Field {
+    std::string_view name;
+    M T::*member;
+};
+
+template <typename T, typename M, typename S>
+struct NestedField {
+    std::string_view name;
+    M T::*member;
+    S schema;
+};
+
+template <typename T, typename... Fields>
+struct Schema {
+    using type = T;
+    static constexpr size_t field_count = sizeof...(Fields);
+
+    std::tuple<Fields...> fields;
+};
+
+template <typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::*member)
+{
+    return {name, member};
+}
+
+/** A struct-typed member encoded as a nested object with @p schema. */
+template <typename T, typename M, typename S>
+constexpr NestedField<T, M, S> field(std::string_view name, M T::*member, const S &schema)
+{
+    return {name, member, schema};
+}
+
+template <typename T, typename... Fields>
+constexpr Schema<T, Fields...> schema(Fields... fields)
+{
+    return {std::tuple<Fields...>(fields...)};
+}
+
+template <typename Writer, typename T, typename... Fields>
+void encode(Writer &w, const Schema<T, Fields...> &s, const T &obj);
+
+namespace detail {
+
+template <typename Writer, typename V>
+void encode_value(Writer &w, const V &v)
+{
+    if constexpr (std::is_array<V>::value) {
+        w.begin_array(std::extent<V>::value);
+        for (const auto &item : v) {
+            encode_value(w, item);
+        }
+        w.end_array();
+    } else {
+        w.value(v);
+    }
+}
+
+template <typename Writer, typename T, typename M>
+void encode_field(Writer &w, const Field<T, M> &f, const T &obj)
+{
+    w.key(f.name);
+    encode_value(w, obj.*f.member);
+}
+
+template <typename Writer, typename T, typename M, typename S>
+void encode_field(Writer &w, const NestedField<T, M, S> &f, const T &obj)
+{
+    w.key(f.name);
+    encode(w, f.schema, obj.*f.member);
+}
+
+} // namespace detail
+
+/** Encode @p obj as one object (JSON) / map (CBOR). */
+template <typename Writer, typename T, typename... Fields>
+void encode(Writer &w, const Schema<T, Fields...> &s, const T &obj)
+{
+    w.begin_object(sizeof...(Fields));
+    std::apply([&](const auto &...f) { (detail::encode_field(w, f, obj), ...); }, s.fields);
+    w.end_object();
+}
+
+/** Encode @p count objects as one array, e.g. a batch of readings. */
+template <typename Writer, typename T, typename... Fields>
+void encode_array(Writer &w, const Schema<T, Fields...> &s, const T *items, size_t count)
+{
+    w.begin_array(count);
+    for (size_t i = 0; i < count; ++i) {
+        encode(w, s, items[i]);
+    }
+    w.end_array();
+}
+
+} // namespace telemetry_enc
@@ -0,0 +1,84 @@
+#include "telemetry_enc/cbor_writer.hpp"
+
+#include <cstring>
+
+namespace telemetry_enc {
+
+void CborWriter::head(uint8_t major, uint64_t arg)
+{
+    const uint8_t type = static_cast<uint8_t>(major << 5);
+    if (arg < 24) {
+        out_.put(static_cast<uint8_t>(type | arg));
+        return;
+    }
+    uint8_t buf[9];
+    size_t len;
+    if (arg <= UINT8_MAX) {
+        buf[0] = type | 24;
+        len = 1;
+    } else if (arg <= UINT16_MAX) {
+        buf[0] = type | 25;
+        len = 2;
+    } else if (arg <= UINT32_MAX) {
+        buf[0] = type | 26;
+        len = 4;
+    } else {
+        buf[0] = type | 27;
+        len = 8;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        buf[len - i] = static_cast<uint8_t>(arg >> (8 * i));
+    }
+    out_.write(buf, len + 1);
+}
+
+void CborWriter::open(uint8_t major, size_t count)
+{
+    if (static_cast<size_t>(depth_) + 1 >= max_depth) {
+        broken_ = true;
+        return;
+    }
+    ++depth_;
+    if (count == unknown_size) {
+        indefinite_ |= 1u << depth_;
+        out_.put(static_cast<uint8_t>(major << 5 | 31));
+    } else {
+        indefinite_ &= ~(1u << depth_);
+        head(major, count);
+    }
+}
+
+void CborWriter::close()
+{
+    if (depth_ == 0) {
+        broken_ = true;
+        return;
+    }
+    if (indefinite_ & (1u << depth_)) {
+        out_.put(0xff);
+    }
+    --depth_;
+}
+
+void CborWriter::value(float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    const uint8_t buf[5] = {0xfa, static_cast<uint8_t>(bits >> 24), static_cast<uint8_t>(bits >> 16),
+                            static_cast<uint8_t>(bits >> 8), static_cast<uint8_t>(bits)};
+    out_.write(buf, sizeof(buf));
+}
+
+void CborWriter::value(double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    uint8_t buf[9];
+    buf[0] = 0xfb;
+    for (size_t i = 0; i < 8; ++i) {
+        buf[8 - i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    out_.write(buf, sizeof(buf));
+}
+
+} // namespace telemetry_enc
@@ -0,0 +1,241 @@
+#include "telemetry_enc/json_writer.hpp"
+
+namespace telemetry_enc {
+
+namespace {
+
+constexpr uint32_t pow10_u32[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+constexpr uint8_t max_float_digits = 9;
+
+/* Write @p v as decimal; 32-bit division where possible since 64-bit
+ * division is a libgcc call on Xtensa and RISC-V. */
+void write_decimal(Output &out, uint64_t v)
+{
+    char buf[20];
+    size_t n = 0;
+    while (v > UINT32_MAX) {
+        buf[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    }
+    uint32_t w = static_cast<uint32_t>(v);
+    do {
+        buf[n++] = static_cast<char>('0' + w % 10);
+        w /= 10;
+    } while (w != 0);
+    char rev[20];
+    for (size_t i = 0; i < n; ++i) {
+        rev[i] = buf[n - 1 - i];
+    }
+    out.write(rev, n);
+}
+
+/* Exactly @p width digits, zero padded, trailing zeros trimmed. */
+void write_fraction(Output &out, uint32_t frac, uint8_t width)
+{
+    char buf[max_float_digits];
+    for (int i = width - 1; i >= 0; --i) {
+        buf[i] = static_cast<char>('0' + frac % 10);
+        frac /= 10;
+    }
+    size_t len = width;
+    while (len > 0 && buf[len - 1] == '0') {
+        --len;
+    }
+    if (len != 0) {
+        out.put('.');
+        out.write(buf, len);
+    }
+}
+
+} // namespace
+
+void JsonWriter::separate()
+{
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    uint32_t bit = depth_ < max_depth ? 1u << depth_ : 0;
+    if (has_element_ & bit) {
+        out_.put(',');
+    }
+    has_element_ |= bit;
+}
+
+void JsonWriter::open(char bracket)
+{
+    separate();
+    out_.put(static_cast<uint8_t>(bracket));
+    if (static_cast<size_t>(depth_) + 1 >= max_depth) {
+        broken_ = true;
+        return;
+    }
+    ++depth_;
+    has_element_ &= ~(1u << depth_);
+}
+
+void JsonWriter::close(char bracket)
+{
+    if (depth_ == 0) {
+        broken_ = true;
+        return;
+    }
+    --depth_;
+    after_key_ = false;
+    out_.put(static_cast<uint8_t>(bracket));
+}
+
+void JsonWriter::begin_object(size_t)
+{
+    open('{');
+}
+
+void JsonWriter::end_object()
+{
+    close('}');
+}
+
+void JsonWriter::begin_array(size_t)
+{
+    open('[');
+}
+
+void JsonWriter::end_array()
+{
+    close(']');
+}
+
+void JsonWriter::key(std::string_view name)
+{
+    separate();
+    out_.put('"');
+    out_.write(name.data(), name.size());
+    out_.write("\":", 2);
+    after_key_ = true;
+}
+
+void JsonWriter::value(bool v)
+{
+    separate();
+    if (v) {
+        out_.write("true", 4);
+    } else {
+        out_.write("false", 5);
+    }
+}
+
+void JsonWriter::null()
+{
+    separate();
+    out_.write("null", 4);
+}
+
+void JsonWriter::value(std::string_view v)
+{
+    static const char hex[] = "0123456789abcdef";
+    separate();
+    out_.put('"');
+    size_t run = 0;
+    for (size_t i = 0; i < v.size(); ++i) {
+        auto c = static_cast<uint8_t>(v[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        /* Copy the clean run in one go, then the escape. */
+        out_.write(v.data() + run, i - run);
+        run = i + 1;
+        if (c == '"' || c == '\\') {
+            out_.put('\\');
+            out_.put(c);
+        } else if (c == '\n') {
+            out_.write("\\n", 2);
+        } else if (c == '\r') {
+            out_.write("\\r", 2);
+        } else if (c == '\t') {
+            out_.write("\\t", 2);
+        } else {
+            const char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            out_.write(esc, sizeof(esc));
+        }
+    }
+    out_.write(v.data() + run, v.size() - run);
+    out_.put('"');
+}
+
+void JsonWriter::write_int(int64_t v)
+{
+    if (v < 0) {
+        out_.put('-');
+        write_decimal(out_, ~static_cast<uint64_t>(v) + 1);
+    } else {
+        write_decimal(out_, static_cast<uint64_t>(v));
+    }
+}
+
+void JsonWriter::write_uint(uint64_t v)
+{
+    write_decimal(out_, v);
+}
+
+template <typename F>
+void JsonWriter::write_real(F v)
+{
+    separate();
+    if (v != v || v - v != v - v) {
+        out_.write("null", 4);
+        return;
+    }
+    if (v < 0) {
+        out_.put('-');
+        v = -v;
+    }
+    const uint8_t digits = float_digits_ < max_float_digits ? float_digits_ : max_float_digits;
+    const F scale = static_cast<F>(pow10_u32[digits]);
+
+    /* Plain notation covers the usual telemetry range; the rest goes through
+     * a normalised mantissa and exponent. */
+    int exponent = 0;
+    const bool scientific = v >= F(1e9) || (v != 0 && v < F(1e-4));
+    if (scientific) {
+        while (v >= F(10)) {
+            v /= F(10);
+            ++exponent;
+        }
+        while (v < F(1)) {
+            v *= F(10);
+            --exponent;
+        }
+    }
+    auto whole = static_cast<uint32_t>(v);
+    auto frac = static_cast<uint32_t>((v - static_cast<F>(whole)) * scale + F(0.5));
+    if (frac >= pow10_u32[digits]) {
+        frac -= pow10_u32[digits];
+        ++whole;
+        if (scientific && whole == 10) {
+            whole = 1;
+            ++exponent;
+        }
+    }
+    write_decimal(out_, whole);
+    write_fraction(out_, frac, digits);
+    if (scientific) {
+        out_.put('e');
+        if (exponent < 0) {
+            out_.put('-');
+            exponent = -exponent;
+        }
+        write_decimal(out_, static_cast<uint64_t>(exponent));
+    }
+}
+
+void JsonWriter::value(float v)
+{
+    write_real(v);
+}
+
+void JsonWriter::value(double v)
+{
+    write_real(v);
+}
+
+} // namespace telemetry_enc
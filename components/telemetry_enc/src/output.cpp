@@ -0,0 +1,77 @@
+#include "telemetry_enc/output.hpp"
+
+#include "lwip/pbuf.h"
+
+namespace telemetry_enc {
+
+bool Output::advance()
+{
+    if (overflowed_ || advance_ == nullptr || !advance_(*this)) {
+        overflowed_ = true;
+        return false;
+    }
+    return true;
+}
+
+void Output::write_slow(const uint8_t *data, size_t len)
+{
+    while (len != 0) {
+        if (pos_ == end_ && !advance()) {
+            return;
+        }
+        size_t room = static_cast<size_t>(end_ - pos_);
+        size_t n = room < len ? room : len;
+        memcpy(pos_, data, n);
+        pos_ += n;
+        data += n;
+        len -= n;
+    }
+}
+
+BufferOutput::BufferOutput(void *buffer, size_t capacity)
+    : Output(nullptr), buffer_(static_cast<uint8_t *>(buffer))
+{
+    set_window(buffer_, capacity);
+}
+
+PbufOutput::PbufOutput(struct pbuf *chain) : Output(next_segment), chain_(chain), current_(chain)
+{
+    if (chain != nullptr) {
+        set_window(static_cast<uint8_t *>(chain->payload), chain->len);
+    }
+}
+
+bool PbufOutput::next_segment(Output &self)
+{
+    auto &out = static_cast<PbufOutput &>(self);
+    if (out.current_ == nullptr || out.current_->next == nullptr) {
+        return false;
+    }
+    out.current_ = out.current_->next;
+    out.set_window(static_cast<uint8_t *>(out.current_->payload), out.current_->len);
+    return true;
+}
+
+esp_err_t PbufOutput::finish()
+{
+    if (chain_ == nullptr || overflowed()) {
+        return ESP_ERR_NO_MEM;
+    }
+    /* Only shrinks, freeing any segments past the end. */
+    pbuf_realloc(chain_, static_cast<u16_t>(size()));
+    return ESP_OK;
+}
+
+CountingOutput::CountingOutput() : Output(recycle)
+{
+    set_window(scratch_, sizeof(scratch_));
+}
+
+bool CountingOutput::recycle(Output &self)
+{
+    auto &out = static_cast<CountingOutput &>(self);
+    out.set_window(out.scratch_, sizeof(out.scratch_));
+    return true;
+}
+
+} // namespace telemetry_enc
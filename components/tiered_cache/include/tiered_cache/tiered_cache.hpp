@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "mem_pool/placement.hpp"
+
+namespace tiered_cache {
+
+enum class Tier : uint8_t {
+    Hot,
+    Cold,
+};
+
+struct CacheStats {
+    uint32_t hot_hits;
+    uint32_t cold_hits;
+    uint32_t misses;
+    /** Entries moved from the cold tier into the hot one, by access, prefetch() or pin(). */
+    uint32_t promotions;
+    /** Hot entries moved out to make room for a promotion or a hot insert. */
+    uint32_t demotions;
+    /** Entries dropped from the cold tier to make room. */
+    uint32_t evictions;
+    uint32_t hot_used;
+    uint32_t cold_used;
+    uint32_t pinned;
+};
+
+/**
+ * @brief Fixed-size values keyed by 32-bit ids, split between internal RAM and PSRAM.
+ *
+ * A small hot tier (Config::hot_placement, internal DRAM by default) holds
+ * the entries in use; a large cold tier (PSRAM by default) holds the rest.
+ * Both tiers are replaced with CLOCK: each access sets an entry's reference
+ * bit, and the hand skips, and clears, referenced entries until it finds one
+ * that was not touched since its last pass.
+ *
+ * A cold entry is promoted once it has been hit Config::promote_hits times
+ * since it entered the cold tier: it swaps places with the hot tier's CLOCK
+ * victim, which is demoted into the slot it vacates, so promotion never
+ * evicts. One-off reads, such as a scan over every entry, therefore stay in
+ * PSRAM instead of flushing the working set out of internal RAM. When the
+ * cold tier is full its own CLOCK victim is evicted and Config::on_evict is
+ * called.
+ *
+ * Keys, reference bits and the hash index are always internal, so a lookup
+ * touches PSRAM only to read a cold value. Pointers returned by get(),
+ * peek() and insert() stay valid until the next call that may move entries
+ * (get, insert, prefetch, pin, erase). Not thread-safe: callers serialise.
+ */
+class TieredCache {
+public:
+    /** Called with the key and the value about to be dropped from the cold tier. */
+    using EvictFn = void (*)(void *ctx, uint32_t key, void *value);
+
+    struct Config {
+        /** Bytes per value; rounded up to @c alignment. */
+        size_t value_size = 0;
+        size_t hot_slots = 16;
+        /** May be 0: a single-tier cache in hot_placement. */
+        size_t cold_slots = 256;
+        /** Cold hits that earn an entry a hot slot; 1 promotes on first use. */
+        uint8_t promote_hits = 2;
+        /** Value alignment, a power of two. Use the cache line size for DMA buffers. */
+        size_t alignment = 4;
+        mem_pool::Placement hot_placement = mem_pool::Placement::Internal;
+        mem_pool::Placement cold_placement = mem_pool::Placement::Spiram;
+        EvictFn on_evict = nullptr;
+        void *evict_ctx = nullptr;
+    };
+
+    static constexpr size_t max_slots = 0xfffe;
+
+    TieredCache() = default;
+    ~TieredCache() { deinit(); }
+
+    TieredCache(const TieredCache &) = delete;
+    TieredCache &operator=(const TieredCache &) = delete;
+
+    /**
+     * @return ESP_OK, ESP_ERR_INVALID_ARG for a bad config, ESP_ERR_INVALID_STATE
+     *         if already initialised, ESP_ERR_NO_MEM if a placement is exhausted
+     *         (e.g. no PSRAM on the module).
+     */
+    esp_err_t init(const Config &config);
+
+    /** Release both tiers. on_evict is not called for the entries still held. */
+    void deinit();
+
+    /** Value of @p key, promoting it if it has earned a hot slot, or nullptr on a miss. */
+    void *get(uint32_t key);
+
+    /** Value of @p key wherever it is; counts as neither access nor hit. */
+    void *peek(uint32_t key) const;
+
+    /**
+     * @brief Slot for @p key, to be filled by the caller.
+     *
+     * A key already present keeps its tier and contents. New keys go to the
+     * cold tier unless @p tier is Tier::Hot (data known to be used next, such
+     * as the frame being assembled). May evict the cold tier's CLOCK victim.
+     */
+    void *insert(uint32_t key, Tier tier = Tier::Cold);
+
+    /** Drop @p key. @return false if it was not cached. */
+    bool erase(uint32_t key);
+
+    /**
+     * @brief Move @p key into the hot tier ahead of use, regardless of promote_hits.
+     *
+     * E.g. the table for the next protocol state, while the current one is
+     * still being processed. @return ESP_ERR_NOT_FOUND if it is not cached.
+     */
+    esp_err_t prefetch(uint32_t key);
+
+    /**
+     * @brief Keep @p key in the hot tier until unpin(): it is never demoted or evicted.
+     *
+     * For data read with bounded latency, such as lookup tables used from
+     * ISRs. Pins nest, up to 63 deep. At most hot_slots - 1 entries may be
+     * pinned at once, so that promotion always has a slot to use.
+     * @return ESP_ERR_NOT_FOUND if @p key is not cached, ESP_ERR_NO_MEM if no
+     *         more entries may be pinned, ESP_ERR_INVALID_STATE if the pin count
+     *         would overflow.
+     */
+    esp_err_t pin(uint32_t key);
+
+    /** @return ESP_ERR_INVALID_STATE if @p key is not pinned. */
+    esp_err_t unpin(uint32_t key);
+
+    /** Tier::Hot or Tier::Cold for a cached @p key. @return false if not cached. */
+    bool tier_of(uint32_t key, Tier *out) const;
+
+    /** Accesses of @p key through get() since it was inserted, saturating at 0xffff. */
+    uint16_t accesses(uint32_t key) const;
+
+    size_t value_size() const { return value_size_; }
+    size_t size() const { return hot_used_ + cold_used_; }
+
+    CacheStats stats() const;
+    void reset_stats();
+
+private:
+    static constexpr uint16_t nil = 0xffff;
+
+    struct Slot {
+        uint32_t key;
+        uint16_t accesses;
+        /** Cold hits since the entry entered the cold tier. */
+        uint8_t cold_hits;
+        /** Pin count, 0 if unpinned. */
+        uint8_t pins : 6;
+        uint8_t referenced : 1;
+        uint8_t used : 1;
+    };
+
+    bool is_hot(uint16_t slot) const { return slot < hot_slots_; }
+    uint8_t *value(uint16_t slot) const
+    {
+        return is_hot(slot) ? hot_ + slot * value_size_ : cold_ + (slot - hot_slots_) * value_size_;
+    }
+
+    size_t bucket_of(uint32_t key) const { return (key * 2654435761u) >> index_shift_; }
+    size_t find_bucket(uint32_t key) const;
+    uint16_t find(uint32_t key) const;
+    void index_erase(size_t bucket);
+
+    uint16_t clock_victim(uint16_t first, size_t count, uint16_t *hand);
+    uint16_t take_hot_slot();
+    uint16_t take_cold_slot();
+    void evict(uint16_t slot);
+    void move(uint16_t from, uint16_t to);
+    uint16_t promote(uint16_t slot);
+    void release(uint16_t slot);
+
+    uint8_t *hot_ = nullptr;
+    uint8_t *cold_ = nullptr;
+    Slot *slots_ = nullptr;
+    uint16_t *index_ = nullptr;
+    /** Free-slot stacks: hot slots in [0, hot_slots_), cold ones above. */
+    uint16_t *free_ = nullptr;
+    uint8_t *scratch_ = nullptr;
+    size_t index_mask_ = 0;
+    unsigned index_shift_ = 0;
+    size_t value_size_ = 0;
+    size_t hot_slots_ = 0;
+    size_t cold_slots_ = 0;
+    uint8_t promote_hits_ = 0;
+    EvictFn on_evict_ = nullptr;
+    void *evict_ctx_ = nullptr;
+    uint16_t hot_hand_ = 0;
+    uint16_t cold_hand_ = 0;
+    size_t hot_used_ = 0;
+    size_t cold_used_ = 0;
+    size_t pinned_ = 0;
+    CacheStats stats_ = {};
+};
+
+} // namespace tiered_cache
@@ -0,0 +1,399 @@
+#include "tiered_cache/tiered_cache.hpp"
+
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "tiered_cache";
+
+namespace tiered_cache {
+
+namespace {
+
+constexpr uint32_t internal_caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+constexpr uint8_t max_pins = 63;
+
+} // namespace
+
+esp_err_t TieredCache::init(const Config &config)
+{
+    if (slots_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t alignment = config.alignment;
+    if (config.value_size == 0 || config.hot_slots == 0 || config.hot_slots + config.cold_slots > max_slots ||
+        config.promote_hits == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t value_size = (config.value_size + alignment - 1) & ~(alignment - 1);
+    size_t total = config.hot_slots + config.cold_slots;
+    /* At most half full, so probe sequences stay a slot or two long. */
+    unsigned bits = 4;
+    while ((size_t{1} << bits) < 2 * total) {
+        ++bits;
+    }
+    size_t buckets = size_t{1} << bits;
+
+    hot_ = static_cast<uint8_t *>(
+        heap_caps_aligned_alloc(alignment, value_size * config.hot_slots, mem_pool::caps_of(config.hot_placement)));
+    if (config.cold_slots != 0) {
+        cold_ = static_cast<uint8_t *>(heap_caps_aligned_alloc(alignment, value_size * config.cold_slots,
+                                                               mem_pool::caps_of(config.cold_placement)));
+        scratch_ = static_cast<uint8_t *>(heap_caps_malloc(value_size, internal_caps));
+    }
+    /* Bookkeeping is touched on every lookup: internal RAM whatever the value placement. */
+    slots_ = static_cast<Slot *>(heap_caps_calloc(total, sizeof(Slot), internal_caps));
+    free_ = static_cast<uint16_t *>(heap_caps_malloc(total * sizeof(uint16_t), internal_caps));
+    index_ = static_cast<uint16_t *>(heap_caps_malloc(buckets * sizeof(uint16_t), internal_caps));
+    if (hot_ == nullptr || (config.cold_slots != 0 && (cold_ == nullptr || scratch_ == nullptr)) ||
+        slots_ == nullptr || free_ == nullptr || index_ == nullptr) {
+        ESP_LOGE(TAG, "no memory for %u hot (%s) + %u cold (%s) x %u bytes", static_cast<unsigned>(config.hot_slots),
+                 mem_pool::placement_name(config.hot_placement), static_cast<unsigned>(config.cold_slots),
+                 mem_pool::placement_name(config.cold_placement), static_cast<unsigned>(value_size));
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Stacks pop from the top, so hand out low slots first. */
+    for (size_t i = 0; i < config.hot_slots; ++i) {
+        free_[i] = static_cast<uint16_t>(config.hot_slots - 1 - i);
+    }
+    for (size_t i = 0; i < config.cold_slots; ++i) {
+        free_[config.hot_slots + i] = static_cast<uint16_t>(total - 1 - i);
+    }
+    memset(index_, 0xff, buckets * sizeof(uint16_t));
+
+    index_mask_ = buckets - 1;
+    index_shift_ = 32 - bits;
+    value_size_ = value_size;
+    hot_slots_ = config.hot_slots;
+    cold_slots_ = config.cold_slots;
+    promote_hits_ = config.promote_hits;
+    on_evict_ = config.on_evict;
+    evict_ctx_ = config.evict_ctx;
+    hot_hand_ = 0;
+    cold_hand_ = 0;
+    hot_used_ = 0;
+    cold_used_ = 0;
+    pinned_ = 0;
+    stats_ = {};
+    return ESP_OK;
+}
+
+void TieredCache::deinit()
+{
+    heap_caps_free(hot_);
+    heap_caps_free(cold_);
+    heap_caps_free(scratch_);
+    heap_caps_free(slots_);
+    heap_caps_free(free_);
+    heap_caps_free(index_);
+    hot_ = nullptr;
+    cold_ = nullptr;
+    scratch_ = nullptr;
+    slots_ = nullptr;
+    free_ = nullptr;
+    index_ = nullptr;
+    hot_slots_ = 0;
+    cold_slots_ = 0;
+    hot_used_ = 0;
+    cold_used_ = 0;
+    pinned_ = 0;
+}
+
+size_t TieredCache::find_bucket(uint32_t key) const
+{
+    size_t i = bucket_of(key);
+    while (index_[i] != nil && slots_[index_[i]].key != key) {
+        i = (i + 1) & index_mask_;
+    }
+    return i;
+}
+
+uint16_t TieredCache::find(uint32_t key) const
+{
+    return slots_ != nullptr ? index_[find_bucket(key)] : nil;
+}
+
+/* Backward-shift deletion: later entries of the same probe run move into the
+ * gap, so lookups never need tombstones. */
+void TieredCache::index_erase(size_t bucket)
+{
+    size_t hole = bucket;
+    size_t i = bucket;
+    for (;;) {
+        i = (i + 1) & index_mask_;
+        if (index_[i] == nil) {
+            break;
+        }
+        size_t home = bucket_of(slots_[index_[i]].key);
+        /* Movable unless its home lies cyclically in (hole, i]. */
+        bool stays = hole <= i ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!stays) {
+            index_[hole] = index_[i];
+            hole = i;
+        }
+    }
+    index_[hole] = nil;
+}
+
+uint16_t TieredCache::clock_victim(uint16_t first, size_t count, uint16_t *hand)
+{
+    for (;;) {
+        auto slot = static_cast<uint16_t>(first + *hand);
+        *hand = static_cast<uint16_t>(*hand + 1u == count ? 0 : *hand + 1);
+        Slot &s = slots_[slot];
+        if (s.pins != 0) {
+            continue;
+        }
+        if (s.referenced) {
+            s.referenced = 0;
+            continue;
+        }
+        return slot;
+    }
+}
+
+void TieredCache::evict(uint16_t slot)
+{
+    Slot &s = slots_[slot];
+    if (on_evict_ != nullptr) {
+        on_evict_(evict_ctx_, s.key, value(slot));
+    }
+    index_erase(find_bucket(s.key));
+    s.used = 0;
+    ++stats_.evictions;
+}
+
+/* Relocate the entry in @p from to the unused slot @p to. */
+void TieredCache::move(uint16_t from, uint16_t to)
+{
+    memcpy(value(to), value(from), value_size_);
+    slots_[to] = slots_[from];
+    slots_[from].used = 0;
+    index_[find_bucket(slots_[to].key)] = to;
+}
+
+uint16_t TieredCache::take_cold_slot()
+{
+    if (cold_used_ < cold_slots_) {
+        ++cold_used_;
+        return free_[hot_slots_ + cold_slots_ - cold_used_];
+    }
+    uint16_t victim = clock_victim(static_cast<uint16_t>(hot_slots_), cold_slots_, &cold_hand_);
+    evict(victim);
+    return victim;
+}
+
+uint16_t TieredCache::take_hot_slot()
+{
+    if (hot_used_ < hot_slots_) {
+        ++hot_used_;
+        return free_[hot_slots_ - hot_used_];
+    }
+    uint16_t victim = clock_victim(0, hot_slots_, &hot_hand_);
+    if (cold_slots_ == 0) {
+        evict(victim);
+        return victim;
+    }
+    uint16_t cold = take_cold_slot();
+    move(victim, cold);
+    slots_[cold].cold_hits = 0;
+    ++stats_.demotions;
+    return victim;
+}
+
+void TieredCache::release(uint16_t slot)
+{
+    slots_[slot].used = 0;
+    if (is_hot(slot)) {
+        free_[hot_slots_ - hot_used_] = slot;
+        --hot_used_;
+    } else {
+        free_[hot_slots_ + cold_slots_ - cold_used_] = slot;
+        --cold_used_;
+    }
+}
+
+uint16_t TieredCache::promote(uint16_t slot)
+{
+    uint16_t hot;
+    if (hot_used_ < hot_slots_) {
+        ++hot_used_;
+        hot = free_[hot_slots_ - hot_used_];
+        move(slot, hot);
+        release(slot);
+    } else {
+        /* Swap with the victim: the cold slot being vacated takes it in. */
+        hot = clock_victim(0, hot_slots_, &hot_hand_);
+        size_t hot_bucket = find_bucket(slots_[hot].key);
+        size_t cold_bucket = find_bucket(slots_[slot].key);
+        memcpy(scratch_, value(hot), value_size_);
+        memcpy(value(hot), value(slot), value_size_);
+        memcpy(value(slot), scratch_, value_size_);
+        Slot demoted = slots_[hot];
+        slots_[hot] = slots_[slot];
+        slots_[slot] = demoted;
+        slots_[slot].cold_hits = 0;
+        index_[hot_bucket] = slot;
+        index_[cold_bucket] = hot;
+        ++stats_.demotions;
+    }
+    slots_[hot].cold_hits = 0;
+    slots_[hot].referenced = 1;
+    ++stats_.promotions;
+    return hot;
+}
+
+void *TieredCache::get(uint32_t key)
+{
+    uint16_t slot = find(key);
+    if (slot == nil) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    Slot &s = slots_[slot];
+    s.referenced = 1;
+    if (s.accesses != 0xffff) {
+        ++s.accesses;
+    }
+    if (is_hot(slot)) {
+        ++stats_.hot_hits;
+        return hot_ + slot * value_size_;
+    }
+    ++stats_.cold_hits;
+    if (++s.cold_hits >= promote_hits_) {
+        slot = promote(slot);
+    }
+    return value(slot);
+}
+
+void *TieredCache::peek(uint32_t key) const
+{
+    uint16_t slot = find(key);
+    return slot != nil ? value(slot) : nullptr;
+}
+
+void *TieredCache::insert(uint32_t key, Tier tier)
+{
+    if (slots_ == nullptr) {
+        return nullptr;
+    }
+    size_t bucket = find_bucket(key);
+    if (index_[bucket] != nil) {
+        return value(index_[bucket]);
+    }
+    bool hot = tier == Tier::Hot || cold_slots_ == 0;
+    uint16_t slot = hot ? take_hot_slot() : take_cold_slot();
+    Slot &s = slots_[slot];
+    s.key = key;
+    s.accesses = 0;
+    s.cold_hits = 0;
+    s.pins = 0;
+    /* Untouched cold entries are the first to go: the hand has just passed this one. */
+    s.referenced = hot ? 1 : 0;
+    s.used = 1;
+    /* Taking a slot may have evicted, and so reshuffled the probe run. */
+    index_[find_bucket(key)] = slot;
+    return value(slot);
+}
+
+bool TieredCache::erase(uint32_t key)
+{
+    if (slots_ == nullptr) {
+        return false;
+    }
+    size_t bucket = find_bucket(key);
+    uint16_t slot = index_[bucket];
+    if (slot == nil) {
+        return false;
+    }
+    if (slots_[slot].pins != 0) {
+        --pinned_;
+    }
+    index_erase(bucket);
+    release(slot);
+    return true;
+}
+
+esp_err_t TieredCache::prefetch(uint32_t key)
+{
+    uint16_t slot = find(key);
+    if (slot == nil) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (is_hot(slot)) {
+        slots_[slot].referenced = 1;
+    } else {
+        promote(slot);
+    }
+    return ESP_OK;
+}
+
+esp_err_t TieredCache::pin(uint32_t key)
+{
+    uint16_t slot = find(key);
+    if (slot == nil) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (slots_[slot].pins == max_pins) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (slots_[slot].pins == 0) {
+        if (pinned_ + 1 >= hot_slots_) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (!is_hot(slot)) {
+            slot = promote(slot);
+        }
+        ++pinned_;
+    }
+    ++slots_[slot].pins;
+    return ESP_OK;
+}
+
+esp_err_t TieredCache::unpin(uint32_t key)
+{
+    uint16_t slot = find(key);
+    if (slot == nil || slots_[slot].pins == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (--slots_[slot].pins == 0) {
+        --pinned_;
+    }
+    return ESP_OK;
+}
+
+bool TieredCache::tier_of(uint32_t key, Tier *out) const
+{
+    uint16_t slot = find(key);
+    if (slot == nil) {
+        return false;
+    }
+    *out = is_hot(slot) ? Tier::Hot : Tier::Cold;
+    return true;
+}
+
+uint16_t TieredCache::accesses(uint32_t key) const
+{
+    uint16_t slot = find(key);
+    return slot != nil ? slots_[slot].accesses : 0;
+}
+
+CacheStats TieredCache::stats() const
+{
+    CacheStats s = stats_;
+    s.hot_used = static_cast<uint32_t>(hot_used_);
+    s.cold_used = static_cast<uint32_t>(cold_used_);
+    s.pinned = static_cast<uint32_t>(pinned_);
+    return s;
+}
+
+void TieredCache::reset_stats()
+{
+    stats_ = {};
+}
+
+} // namespace tiered_cache
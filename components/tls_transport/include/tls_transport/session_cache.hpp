@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include "mbedtls/ssl.h"
+
+namespace tls_transport {
+
+/**
+ * @brief TLS sessions kept in RTC slow memory, keyed by host and port.
+ *
+ * Slots are RTC_NOINIT, so a session saved before deep sleep or a software
+ * reset is still there on the next boot and the reconnect can resume it
+ * (abbreviated handshake, no certificate chain, no ECDHE) instead of paying
+ * for a full one. Each slot carries a CRC, so the garbage RTC memory holds
+ * after a power-on reset is simply ignored. The least recently stored slot
+ * is replaced when all are in use.
+ *
+ * Safe to call from several tasks.
+ */
+class SessionCache {
+public:
+    /**
+     * @brief Restore the session cached for @p host : @p port into @p out.
+     *
+     * @p master_tag receives the tag stored with it, which identifies the
+     * master secret without holding it. @return false if none is cached.
+     */
+    static bool load(const char *host, uint16_t port, mbedtls_ssl_session *out, uint32_t *master_tag);
+
+    /** Cache @p session, replacing any older one for the same server. @return false if it is too large. */
+    static bool store(const char *host, uint16_t port, const mbedtls_ssl_session &session, uint32_t master_tag);
+
+    /** Drop the session for one server, e.g. after it failed to resume. */
+    static void forget(const char *host, uint16_t port);
+
+    static void clear();
+};
+
+} // namespace tls_transport
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mqtt_client/transport.hpp"
+
+namespace tls_transport {
+
+struct HandshakeStats {
+    uint32_t full;
+    /** Abbreviated TLS 1.2 handshakes on a cached session (ID or ticket); TLS 1.3 ones count as full. */
+    uint32_t resumed;
+    uint32_t failed;
+    /** Connects that offered a cached session; offered - resumed were refused by the server. */
+    uint32_t offered;
+    /** Sums of handshake times, for averages: full_ms_total / full. */
+    uint32_t full_ms_total;
+    uint32_t resumed_ms_total;
+    uint32_t last_ms;
+    uint32_t max_ms;
+};
+
+/**
+ * @brief Client TLS configuration shared by every connection made with it.
+ *
+ * Everything a handshake needs that does not depend on the connection - the
+ * parsed CA chain and client key, the seeded DRBG, the mbedtls_ssl_config -
+ * is built once in init() and reused across reconnects, so a reconnect only
+ * pays for the handshake itself. Resumed handshakes skip that too; see
+ * SessionCache.
+ *
+ * The offered cipher suites are restricted to ECDHE with AES-GCM or AES-CBC
+ * and SHA-256/384, on P-256 first: AES, SHA and the bignum arithmetic under
+ * ECDHE/RSA all run on the hardware accelerators (with the MBEDTLS_HARDWARE_*
+ * options, on by default), whereas ChaCha20-Poly1305 and X25519 would fall
+ * back to software.
+ *
+ * Handshakes on one context must not run concurrently unless mbedTLS is
+ * built with MBEDTLS_THREADING_C, because they share the DRBG.
+ */
+class TlsContext {
+public:
+    struct Config {
+        /** NUL-terminated PEM CA chain, or nullptr to use the ESP-IDF certificate bundle. */
+        const char *ca_pem = nullptr;
+        /** Optional client certificate and key (NUL-terminated PEM) for mutual TLS. */
+        const char *cert_pem = nullptr;
+        const char *key_pem = nullptr;
+        /** Offer and store sessions through SessionCache. */
+        bool resume_sessions = true;
+        /** Plaintext bytes per record: one record plus its overhead fits one 1436-byte MSS. */
+        size_t record_size = 1360;
+    };
+
+    TlsContext() = default;
+    ~TlsContext() { deinit(); }
+
+    TlsContext(const TlsContext &) = delete;
+    TlsContext &operator=(const TlsContext &) = delete;
+
+    esp_err_t init(const Config &config);
+    void deinit();
+
+    HandshakeStats stats() const;
+
+private:
+    friend class TlsTransport;
+
+    void record_handshake(bool resumed, uint32_t ms);
+
+    Config config_;
+    mbedtls_ssl_config conf_;
+    mbedtls_entropy_context entropy_;
+    mbedtls_ctr_drbg_context drbg_;
+    mbedtls_x509_crt ca_;
+    mbedtls_x509_crt cert_;
+    mbedtls_pk_context key_;
+    bool ready_ = false;
+
+    std::atomic<uint32_t> full_{0};
+    std::atomic<uint32_t> resumed_{0};
+    std::atomic<uint32_t> failed_{0};
+    std::atomic<uint32_t> offered_{0};
+    std::atomic<uint32_t> full_ms_total_{0};
+    std::atomic<uint32_t> resumed_ms_total_{0};
+    std::atomic<uint32_t> last_ms_{0};
+    std::atomic<uint32_t> max_ms_{0};
+};
+
+/**
+ * @brief TLS client stream for mqtt_client (or anything else that speaks Transport).
+ *
+ * connect_to() opens TCP, offers the cached session for the host if there
+ * is one, and runs the handshake against the timeout; the new session is
+ * cached afterwards. The mbedtls_ssl_context and its record buffers are set
+ * up on the first connect and only reset on later ones.
+ *
+ * write_some() packs the caller's iovecs into records of up to
+ * Config::record_size, so a batch of small MQTT packets becomes one record
+ * rather than one per packet.
+ */
+class TlsTransport : public mqtt_client::Transport {
+public:
+    explicit TlsTransport(TlsContext &context) : context_(context) {}
+    ~TlsTransport();
+
+    TlsTransport(const TlsTransport &) = delete;
+    TlsTransport &operator=(const TlsTransport &) = delete;
+
+    esp_err_t connect_to(const char *host, uint16_t port, uint32_t timeout_ms) override;
+    void disconnect() override;
+    int fd() const override { return tcp_.fd(); }
+    int write_some(const struct iovec *iov, int count) override;
+    int read_some(void *buf, size_t len) override;
+    size_t pending() const override;
+    bool write_pending() const override { return staged_len_ != 0; }
+
+private:
+    static int bio_send(void *ctx, const unsigned char *buf, size_t len);
+    static int bio_recv(void *ctx, unsigned char *buf, size_t len);
+    static void export_keys(void *ctx, mbedtls_ssl_key_export_type type, const unsigned char *secret,
+                            size_t secret_len, const unsigned char client_random[32],
+                            const unsigned char server_random[32], mbedtls_tls_prf_types prf);
+
+    esp_err_t handshake(int64_t deadline_us);
+    void save_session();
+
+    TlsContext &context_;
+    mqtt_client::TcpTransport tcp_;
+    mbedtls_ssl_context ssl_;
+    bool ssl_ready_ = false;
+    bool connected_ = false;
+    const char *host_ = nullptr;
+    uint16_t port_ = 0;
+    /* Tag of the master secret of the current session, from export_keys(). */
+    uint32_t master_tag_ = 0;
+
+    uint8_t *record_ = nullptr;
+    /* Length of a record mbedtls_ssl_write() could not finish; it must be called again with it. */
+    size_t staged_len_ = 0;
+};
+
+} // namespace tls_transport
@@ -0,0 +1,183 @@
+#include "tls_transport/session_cache.hpp"
+
+#include <cstddef>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+namespace tls_transport {
+
+#if CONFIG_TLS_TRANSPORT_SESSION_SLOTS > 0
+
+static const char *TAG = "tls_transport";
+
+namespace {
+
+constexpr uint32_t slot_magic = 0x53534c54; /* "TLSS" */
+
+struct Slot {
+    uint32_t magic;
+    uint32_t key;
+    /* Store order, for replacing the oldest slot. */
+    uint32_t seq;
+    uint32_t master_tag;
+    uint32_t len;
+    /* Over everything above and data[0, len). */
+    uint32_t crc;
+    uint8_t data[CONFIG_TLS_TRANSPORT_SESSION_SIZE];
+};
+
+RTC_NOINIT_ATTR Slot rtc_slots[CONFIG_TLS_TRANSPORT_SESSION_SLOTS];
+
+StaticSemaphore_t lock_storage;
+SemaphoreHandle_t lock = nullptr;
+portMUX_TYPE lock_init = portMUX_INITIALIZER_UNLOCKED;
+
+/* Serializing a session runs under the lock, so it must be a mutex, not a spinlock. */
+class Guard {
+public:
+    Guard()
+    {
+        taskENTER_CRITICAL(&lock_init);
+        if (lock == nullptr) {
+            lock = xSemaphoreCreateMutexStatic(&lock_storage);
+        }
+        taskEXIT_CRITICAL(&lock_init);
+        xSemaphoreTake(lock, portMAX_DELAY);
+    }
+    ~Guard() { xSemaphoreGive(lock); }
+};
+
+/* FNV-1a over host and port. */
+uint32_t key_for(const char *host, uint16_t port)
+{
+    uint32_t h = 2166136261u;
+    for (const char *p = host; *p != '\0'; ++p) {
+        h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+    }
+    h = (h ^ (port & 0xff)) * 16777619u;
+    h = (h ^ (port >> 8)) * 16777619u;
+    return h;
+}
+
+uint32_t crc_of(const Slot &s)
+{
+    uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&s), offsetof(Slot, crc));
+    return esp_rom_crc32_le(crc, s.data, s.len);
+}
+
+bool valid(const Slot &s)
+{
+    return s.magic == slot_magic && s.len <= sizeof(s.data) && s.crc == crc_of(s);
+}
+
+Slot *find(uint32_t key)
+{
+    for (Slot &s : rtc_slots) {
+        if (valid(s) && s.key == key) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+bool SessionCache::load(const char *host, uint16_t port, mbedtls_ssl_session *out, uint32_t *master_tag)
+{
+    Guard guard;
+    Slot *s = find(key_for(host, port));
+    if (s == nullptr) {
+        return false;
+    }
+    if (mbedtls_ssl_session_load(out, s->data, s->len) != 0) {
+        /* Saved by a build with a different mbedTLS configuration. */
+        s->magic = 0;
+        return false;
+    }
+    *master_tag = s->master_tag;
+    return true;
+}
+
+bool SessionCache::store(const char *host, uint16_t port, const mbedtls_ssl_session &session, uint32_t master_tag)
+{
+    Guard guard;
+    uint32_t key = key_for(host, port);
+    Slot *target = find(key);
+    uint32_t next_seq = 0;
+    if (target == nullptr) {
+        for (Slot &s : rtc_slots) {
+            if (!valid(s)) {
+                target = &s;
+                break;
+            }
+            if (target == nullptr || static_cast<int32_t>(s.seq - target->seq) < 0) {
+                target = &s;
+            }
+        }
+    }
+    for (Slot &s : rtc_slots) {
+        if (valid(s) && static_cast<int32_t>(s.seq + 1 - next_seq) > 0) {
+            next_seq = s.seq + 1;
+        }
+    }
+
+    size_t len = 0;
+    int rc = mbedtls_ssl_session_save(&session, target->data, sizeof(target->data), &len);
+    if (rc != 0) {
+        target->magic = 0;
+        if (rc == MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) {
+            ESP_LOGW(TAG, "session for %s needs %u bytes, raise TLS_TRANSPORT_SESSION_SIZE", host,
+                     static_cast<unsigned>(len));
+        }
+        return false;
+    }
+    target->magic = slot_magic;
+    target->key = key;
+    target->seq = next_seq;
+    target->master_tag = master_tag;
+    target->len = static_cast<uint32_t>(len);
+    target->crc = crc_of(*target);
+    return true;
+}
+
+void SessionCache::forget(const char *host, uint16_t port)
+{
+    Guard guard;
+    Slot *s = find(key_for(host, port));
+    if (s != nullptr) {
+        s->magic = 0;
+    }
+}
+
+void SessionCache::clear()
+{
+    Guard guard;
+    for (Slot &s : rtc_slots) {
+        s.magic = 0;
+    }
+}
+
+#else // CONFIG_TLS_TRANSPORT_SESSION_SLOTS == 0
+
+bool SessionCache::load(const char *, uint16_t, mbedtls_ssl_session *, uint32_t *)
+{
+    return false;
+}
+
+bool SessionCache::store(const char *, uint16_t, const mbedtls_ssl_session &, uint32_t)
+{
+    return false;
+}
+
+void SessionCache::forget(const char *, uint16_t) {}
+
+void SessionCache::clear() {}
+
+#endif
+
+} // namespace tls_transport
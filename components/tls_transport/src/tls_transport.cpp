@@ -0,0 +1,439 @@
+#include "tls_transport/tls_transport.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "mbedtls/net_sockets.h"
+#include "sdkconfig.h"
+#include "tls_transport/session_cache.hpp"
+
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include "esp_crt_bundle.h"
+#endif
+
+static const char *TAG = "tls_transport";
+
+namespace tls_transport {
+
+namespace {
+
+/* ECDHE only (forward secrecy), AES on the hardware engine, SHA-2 on the
+ * hardware hash; ECDSA before RSA since P-256 signatures verify faster. */
+const int cipher_suites[] = {
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    MBEDTLS_TLS1_3_AES_128_GCM_SHA256,
+    MBEDTLS_TLS1_3_AES_256_GCM_SHA384,
+#endif
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+    0,
+};
+
+/* P-256 goes through the MPI (and, where present, ECC) accelerator. */
+const uint16_t groups[] = {
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1,
+    MBEDTLS_SSL_IANA_TLS_GROUP_SECP384R1,
+    MBEDTLS_SSL_IANA_TLS_GROUP_NONE,
+};
+
+const char drbg_personalization[] = "tls_transport";
+
+template <typename T>
+void update_max(std::atomic<T> &target, T value)
+{
+    T seen = target.load(std::memory_order_relaxed);
+    while (seen < value && !target.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+esp_err_t TlsContext::init(const Config &config)
+{
+    if (ready_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.record_size == 0 || (config.cert_pem == nullptr) != (config.key_pem == nullptr)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if !CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+    if (config.ca_pem == nullptr) {
+        ESP_LOGE(TAG, "no CA chain given and the certificate bundle is disabled");
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+    config_ = config;
+    mbedtls_ssl_config_init(&conf_);
+    mbedtls_entropy_init(&entropy_);
+    mbedtls_ctr_drbg_init(&drbg_);
+    mbedtls_x509_crt_init(&ca_);
+    mbedtls_x509_crt_init(&cert_);
+    mbedtls_pk_init(&key_);
+    ready_ = true;
+
+    int rc = mbedtls_ctr_drbg_seed(&drbg_, mbedtls_entropy_func, &entropy_,
+                                   reinterpret_cast<const unsigned char *>(drbg_personalization),
+                                   sizeof(drbg_personalization) - 1);
+    if (rc == 0) {
+        rc = mbedtls_ssl_config_defaults(&conf_, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                         MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (rc != 0) {
+        ESP_LOGE(TAG, "mbedTLS setup failed: -0x%04x", static_cast<unsigned>(-rc));
+        deinit();
+        return ESP_FAIL;
+    }
+    mbedtls_ssl_conf_rng(&conf_, mbedtls_ctr_drbg_random, &drbg_);
+    mbedtls_ssl_conf_authmode(&conf_, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ciphersuites(&conf_, cipher_suites);
+    mbedtls_ssl_conf_groups(&conf_, groups);
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf_, config.resume_sessions ? MBEDTLS_SSL_SESSION_TICKETS_ENABLED
+                                                                    : MBEDTLS_SSL_SESSION_TICKETS_DISABLED);
+#endif
+
+    if (config.ca_pem != nullptr) {
+        rc = mbedtls_x509_crt_parse(&ca_, reinterpret_cast<const unsigned char *>(config.ca_pem),
+                                    strlen(config.ca_pem) + 1);
+        if (rc != 0) {
+            ESP_LOGE(TAG, "CA chain: -0x%04x", static_cast<unsigned>(-rc));
+            deinit();
+            return ESP_ERR_INVALID_ARG;
+        }
+        mbedtls_ssl_conf_ca_chain(&conf_, &ca_, nullptr);
+    } else {
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+        esp_crt_bundle_attach(&conf_);
+#endif
+    }
+
+    if (config.cert_pem != nullptr) {
+        rc = mbedtls_x509_crt_parse(&cert_, reinterpret_cast<const unsigned char *>(config.cert_pem),
+                                    strlen(config.cert_pem) + 1);
+        if (rc == 0) {
+            rc = mbedtls_pk_parse_key(&key_, reinterpret_cast<const unsigned char *>(config.key_pem),
+                                      strlen(config.key_pem) + 1, nullptr, 0, mbedtls_ctr_drbg_random, &drbg_);
+        }
+        if (rc == 0) {
+            rc = mbedtls_ssl_conf_own_cert(&conf_, &cert_, &key_);
+        }
+        if (rc != 0) {
+            ESP_LOGE(TAG, "client certificate/key: -0x%04x", static_cast<unsigned>(-rc));
+            deinit();
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+void TlsContext::deinit()
+{
+    if (!ready_) {
+        return;
+    }
+    mbedtls_ssl_config_free(&conf_);
+    mbedtls_pk_free(&key_);
+    mbedtls_x509_crt_free(&cert_);
+    mbedtls_x509_crt_free(&ca_);
+    mbedtls_ctr_drbg_free(&drbg_);
+    mbedtls_entropy_free(&entropy_);
+    ready_ = false;
+}
+
+void TlsContext::record_handshake(bool resumed, uint32_t ms)
+{
+    if (resumed) {
+        resumed_.fetch_add(1, std::memory_order_relaxed);
+        resumed_ms_total_.fetch_add(ms, std::memory_order_relaxed);
+    } else {
+        full_.fetch_add(1, std::memory_order_relaxed);
+        full_ms_total_.fetch_add(ms, std::memory_order_relaxed);
+    }
+    last_ms_.store(ms, std::memory_order_relaxed);
+    update_max(max_ms_, ms);
+}
+
+HandshakeStats TlsContext::stats() const
+{
+    HandshakeStats s;
+    s.full = full_.load(std::memory_order_relaxed);
+    s.resumed = resumed_.load(std::memory_order_relaxed);
+    s.failed = failed_.load(std::memory_order_relaxed);
+    s.offered = offered_.load(std::memory_order_relaxed);
+    s.full_ms_total = full_ms_total_.load(std::memory_order_relaxed);
+    s.resumed_ms_total = resumed_ms_total_.load(std::memory_order_relaxed);
+    s.last_ms = last_ms_.load(std::memory_order_relaxed);
+    s.max_ms = max_ms_.load(std::memory_order_relaxed);
+    return s;
+}
+
+TlsTransport::~TlsTransport()
+{
+    disconnect();
+    if (ssl_ready_) {
+        mbedtls_ssl_free(&ssl_);
+        ssl_ready_ = false;
+    }
+    heap_caps_free(record_);
+    record_ = nullptr;
+}
+
+esp_err_t TlsTransport::connect_to(const char *host, uint16_t port, uint32_t timeout_ms)
+{
+    disconnect();
+    if (!context_.ready_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int64_t deadline = esp_timer_get_time() + static_cast<int64_t>(timeout_ms) * 1000;
+    if (record_ == nullptr) {
+        record_ = static_cast<uint8_t *>(
+            heap_caps_malloc(context_.config_.record_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+        if (record_ == nullptr) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    /* The context keeps its record buffers between connections; only the
+     * first connect allocates them. */
+    int rc = ssl_ready_ ? mbedtls_ssl_session_reset(&ssl_) : 0;
+    if (!ssl_ready_) {
+        mbedtls_ssl_init(&ssl_);
+        rc = mbedtls_ssl_setup(&ssl_, &context_.conf_);
+        if (rc != 0) {
+            mbedtls_ssl_free(&ssl_);
+        } else {
+            ssl_ready_ = true;
+        }
+    }
+    if (rc == 0) {
+        rc = mbedtls_ssl_set_hostname(&ssl_, host);
+    }
+    if (rc != 0) {
+        ESP_LOGE(TAG, "ssl setup failed: -0x%04x", static_cast<unsigned>(-rc));
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = tcp_.connect_to(host, port, timeout_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+    host_ = host;
+    port_ = port;
+    mbedtls_ssl_set_bio(&ssl_, this, bio_send, bio_recv, nullptr);
+    mbedtls_ssl_set_export_keys_cb(&ssl_, export_keys, this);
+
+    uint32_t offered_tag = 0;
+    bool offered = false;
+    if (context_.config_.resume_sessions) {
+        mbedtls_ssl_session session;
+        mbedtls_ssl_session_init(&session);
+        if (SessionCache::load(host, port, &session, &offered_tag) && mbedtls_ssl_set_session(&ssl_, &session) == 0) {
+            offered = true;
+            context_.offered_.fetch_add(1, std::memory_order_relaxed);
+        }
+        mbedtls_ssl_session_free(&session);
+    }
+
+    int64_t start = esp_timer_get_time();
+    master_tag_ = 0;
+    err = handshake(deadline);
+    if (err != ESP_OK) {
+        context_.failed_.fetch_add(1, std::memory_order_relaxed);
+        if (offered) {
+            /* Do not let a session the server chokes on block every reconnect. */
+            SessionCache::forget(host, port);
+        }
+        tcp_.disconnect();
+        return err;
+    }
+    auto ms = static_cast<uint32_t>((esp_timer_get_time() - start) / 1000);
+    /* A resumed handshake reuses the cached master secret; a full one derives a new one. */
+    bool resumed = offered && master_tag_ != 0 && master_tag_ == offered_tag;
+    context_.record_handshake(resumed, ms);
+    ESP_LOGI(TAG, "%s handshake with %s in %u ms (%s)", resumed ? "resumed" : "full", host, static_cast<unsigned>(ms),
+             mbedtls_ssl_get_ciphersuite(&ssl_));
+    connected_ = true;
+    /* Also after a resumption: the server may have issued a fresh ticket. */
+    save_session();
+    return ESP_OK;
+}
+
+esp_err_t TlsTransport::handshake(int64_t deadline_us)
+{
+    for (;;) {
+        int rc = mbedtls_ssl_handshake(&ssl_);
+        if (rc == 0) {
+            return ESP_OK;
+        }
+        if (rc != MBEDTLS_ERR_SSL_WANT_READ && rc != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            uint32_t flags = mbedtls_ssl_get_verify_result(&ssl_);
+            ESP_LOGW(TAG, "handshake with %s failed: -0x%04x (verify 0x%x)", host_, static_cast<unsigned>(-rc),
+                     static_cast<unsigned>(flags));
+            return ESP_FAIL;
+        }
+        int64_t left = deadline_us - esp_timer_get_time();
+        if (left <= 0) {
+            ESP_LOGW(TAG, "handshake with %s timed out", host_);
+            return ESP_ERR_TIMEOUT;
+        }
+        int sock = tcp_.fd();
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(sock, &set);
+        struct timeval tv = {};
+        tv.tv_sec = left / 1000000;
+        tv.tv_usec = left % 1000000;
+        bool reading = rc == MBEDTLS_ERR_SSL_WANT_READ;
+        select(sock + 1, reading ? &set : nullptr, reading ? nullptr : &set, nullptr, &tv);
+    }
+}
+
+void TlsTransport::save_session()
+{
+    if (!context_.config_.resume_sessions) {
+        return;
+    }
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ssl_get_session(&ssl_, &session) == 0) {
+        SessionCache::store(host_, port_, session, master_tag_);
+    }
+    mbedtls_ssl_session_free(&session);
+}
+
+void TlsTransport::export_keys(void *ctx, mbedtls_ssl_key_export_type type, const unsigned char *secret,
+                               size_t secret_len, const unsigned char[32], const unsigned char[32],
+                               mbedtls_tls_prf_types)
+{
+    auto *self = static_cast<TlsTransport *>(ctx);
+    if (type == MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET) {
+        /* A CRC is enough to tell two master secrets apart and says nothing useful about either. */
+        self->master_tag_ = esp_rom_crc32_le(0, secret, secret_len);
+    }
+}
+
+void TlsTransport::disconnect()
+{
+    if (connected_) {
+        /* Best effort: the socket is non-blocking and about to be closed. */
+        mbedtls_ssl_close_notify(&ssl_);
+        connected_ = false;
+    }
+    staged_len_ = 0;
+    tcp_.disconnect();
+}
+
+int TlsTransport::bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    auto *self = static_cast<TlsTransport *>(ctx);
+    ssize_t n = send(self->tcp_.fd(), buf, len, 0);
+    if (n >= 0) {
+        return static_cast<int>(n);
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK ? MBEDTLS_ERR_SSL_WANT_WRITE : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int TlsTransport::bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    auto *self = static_cast<TlsTransport *>(ctx);
+    ssize_t n = recv(self->tcp_.fd(), buf, len, 0);
+    if (n > 0) {
+        return static_cast<int>(n);
+    }
+    if (n == 0) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+/*
+ * Copy the iovecs into records of up to record_size and encrypt them one at
+ * a time. When mbedtls_ssl_write() cannot push a record out it has already
+ * encrypted it, so its bytes count as accepted; the record stays staged
+ * until a later call (write_some(nullptr, 0) from the client) finishes it.
+ */
+int TlsTransport::write_some(const struct iovec *iov, int count)
+{
+    if (staged_len_ != 0) {
+        int rc = mbedtls_ssl_write(&ssl_, record_, staged_len_);
+        if (rc == MBEDTLS_ERR_SSL_WANT_WRITE || rc == MBEDTLS_ERR_SSL_WANT_READ) {
+            return 0;
+        }
+        if (rc < 0) {
+            return -1;
+        }
+        staged_len_ = 0;
+    }
+
+    size_t accepted = 0;
+    int index = 0;
+    size_t offset = 0;
+    while (index < count) {
+        size_t len = 0;
+        while (index < count && len < context_.config_.record_size) {
+            size_t take = std::min(iov[index].iov_len - offset, context_.config_.record_size - len);
+            memcpy(record_ + len, static_cast<const uint8_t *>(iov[index].iov_base) + offset, take);
+            len += take;
+            offset += take;
+            if (offset == iov[index].iov_len) {
+                ++index;
+                offset = 0;
+            }
+        }
+        if (len == 0) {
+            break;
+        }
+        int rc = mbedtls_ssl_write(&ssl_, record_, len);
+        if (rc == MBEDTLS_ERR_SSL_WANT_WRITE || rc == MBEDTLS_ERR_SSL_WANT_READ) {
+            staged_len_ = len;
+            return static_cast<int>(accepted + len);
+        }
+        if (rc < 0) {
+            ESP_LOGW(TAG, "write failed: -0x%04x", static_cast<unsigned>(-rc));
+            return accepted != 0 ? static_cast<int>(accepted) : -1;
+        }
+        accepted += static_cast<size_t>(rc);
+        if (static_cast<size_t>(rc) < len) {
+            /* record_size is above the configured maximum fragment; the caller resends the rest. */
+            break;
+        }
+    }
+    return static_cast<int>(accepted);
+}
+
+int TlsTransport::read_some(void *buf, size_t len)
+{
+    for (;;) {
+        int rc = mbedtls_ssl_read(&ssl_, static_cast<unsigned char *>(buf), len);
+        if (rc > 0) {
+            return rc;
+        }
+        if (rc == MBEDTLS_ERR_SSL_WANT_READ || rc == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return 0;
+        }
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        if (rc == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET) {
+            /* TLS 1.3 tickets arrive after the handshake. */
+            save_session();
+            continue;
+        }
+#endif
+        return -1;
+    }
+}
+
+size_t TlsTransport::pending() const
+{
+    return connected_ ? mbedtls_ssl_get_bytes_avail(&ssl_) : 0;
+}
+
+} // namespace tls_transport
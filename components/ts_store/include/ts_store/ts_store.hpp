@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+namespace ts_store {
+
+/** A point in the log: slot @c slot of the segment with sequence number @c seq. */
+struct Position {
+    uint32_t seq;
+    uint32_t slot;
+};
+
+struct StoreStats {
+    uint32_t appended;
+    /** Appends refused because both RAM buffers were full (flash writes fell behind). */
+    uint32_t dropped;
+    /** Unacknowledged records lost when the log wrapped onto them (overwrite_oldest). */
+    uint32_t overwritten;
+    /** Records on flash not yet acknowledged. */
+    uint32_t pending;
+    uint32_t segments;
+    uint32_t live_segments;
+    uint32_t erases;
+    /** Highest per-segment erase count; with a circular log all segments stay within one of it. */
+    uint32_t max_erase_count;
+};
+
+/** Called once per record; return false to stop early. */
+using Visitor = bool (*)(void *ctx, uint32_t timestamp, const void *payload);
+
+/**
+ * @brief Append-only store of fixed-size, timestamped records on a data partition.
+ *
+ * The partition is a ring of segments (a few flash sectors each). Records are
+ * appended to the newest segment, so every sector is erased once per lap of
+ * the ring - wear is spread evenly with no hot spots, and nothing is ever
+ * rewritten in place the way NVS rewrites its pages.
+ *
+ * append() only copies the record into one of two RAM buffers; a writer task
+ * programs full buffers (or a partial one every flush_interval_ms) with one
+ * esp_partition_write() each, so the caller never waits on flash and the
+ * append rate is bounded by flash throughput, not per-record latency. The
+ * same task erases reclaimed segments ahead of the write head.
+ *
+ * Every segment's sequence number and timestamp range is kept in a small RAM
+ * index built at init() from the segment headers, so a range scan skips
+ * straight to the right segments and binary-searches inside them. Upload
+ * progress is recorded with ack(): fully acknowledged segments become free
+ * for reuse, and a partial watermark in the segment header lets replay()
+ * resume close to where it stopped after a reboot (at-least-once delivery).
+ *
+ * Timestamps must not decrease. The partition must not be flagged encrypted:
+ * watermarks are 4-byte writes into already-programmed headers.
+ */
+class Store {
+public:
+    struct Config {
+        const char *partition_label = "tsdata";
+        /** Payload bytes per record, at most max_record_size. */
+        size_t record_size = 16;
+        /** Bytes per segment; a multiple of the flash erase size. */
+        size_t segment_size = 16384;
+        /** Size of each of the two RAM append buffers. */
+        size_t buffer_size = 2048;
+        /** Longest a record stays in RAM before being written out. */
+        uint32_t flush_interval_ms = 1000;
+        /** When the ring is full, reuse the oldest segment even if it is not acknowledged. */
+        bool overwrite_oldest = true;
+        uint32_t task_stack_size = 3072;
+        UBaseType_t task_priority = 3;
+        BaseType_t task_core = tskNO_AFFINITY;
+    };
+
+    static constexpr size_t max_record_size = 240;
+
+    Store() = default;
+    ~Store() { deinit(); }
+
+    Store(const Store &) = delete;
+    Store &operator=(const Store &) = delete;
+
+    /** Find the partition, rebuild the index from flash and start the writer task. */
+    esp_err_t init(const Config &config);
+
+    /** Flush buffered records, then stop. */
+    void deinit();
+
+    /**
+     * @brief Buffer one record. Never touches flash.
+     *
+     * @return ESP_ERR_INVALID_ARG if @p timestamp is older than the previous
+     *         one, ESP_ERR_NO_MEM if both buffers are full.
+     */
+    esp_err_t append(uint32_t timestamp, const void *payload);
+
+    /** Write out everything appended so far; @return ESP_ERR_TIMEOUT if that took longer than @p timeout. */
+    esp_err_t flush(TickType_t timeout);
+
+    /** Visit the records on flash with @p from <= timestamp <= @p to, oldest first. */
+    esp_err_t scan(uint32_t from, uint32_t to, Visitor visitor, void *ctx);
+
+    /**
+     * @brief Visit up to @p max unacknowledged records, oldest first.
+     *
+     * @p next receives the position after the last record visited; pass it to
+     * ack() once those records are safely delivered. The store lock is not
+     * held while @p visitor runs, so it may block on the network.
+     */
+    esp_err_t replay(size_t max, Visitor visitor, void *ctx, Position *next);
+
+    /** Mark everything before @p upto as delivered. */
+    esp_err_t ack(const Position &upto);
+
+    /** Erase every segment. Buffered records are discarded too. */
+    esp_err_t erase_all();
+
+    StoreStats stats() const;
+
+private:
+    enum class SegmentState : uint8_t {
+        Erased,
+        Live,
+        /** Fully acknowledged; erased when the write head reaches it. */
+        Reclaimable,
+        /** Unrecognised contents; erased before use. */
+        Unknown,
+    };
+
+    struct Segment {
+        uint32_t seq;
+        uint32_t count;
+        uint32_t acked;
+        uint32_t first_ts;
+        uint32_t last_ts;
+        uint32_t erase_count;
+        uint8_t ack_writes;
+        SegmentState state;
+    };
+
+    struct Buffer {
+        uint8_t *data;
+        size_t fill;
+        /* Flush generation this buffer completes once written. */
+        uint32_t generation;
+    };
+
+    size_t segment_base(size_t index) const { return index * config_.segment_size; }
+    size_t slot_address(size_t index, uint32_t slot) const;
+    size_t next_index(size_t index) const { return index + 1 == segment_count_ ? 0 : index + 1; }
+
+    esp_err_t mount();
+    void load_segment(size_t index);
+    bool read_slot(size_t index, uint32_t slot, uint8_t *out) const;
+    esp_err_t erase_segment(size_t index);
+    bool open_next_segment();
+    void write_slots(const uint8_t *data, size_t count);
+    void write_watermark(size_t index, uint32_t value, bool final);
+    void seal_active_locked();
+    size_t find_tail() const;
+    size_t find_slot(size_t index, uint32_t timestamp) const;
+    static void writer_task(void *arg);
+
+    Config config_;
+    const esp_partition_t *partition_ = nullptr;
+    Segment *segments_ = nullptr;
+    size_t segment_count_ = 0;
+    size_t slot_size_ = 0;
+    uint32_t slots_per_segment_ = 0;
+    /* Index of the segment being written, or segment_count_ before the first write. */
+    size_t head_ = 0;
+    uint32_t next_seq_ = 1;
+
+    /* Guards the index and all flash access. */
+    SemaphoreHandle_t lock_ = nullptr;
+    /* Guards the RAM buffers; held only for a memcpy. */
+    portMUX_TYPE buffer_lock_ = portMUX_INITIALIZER_UNLOCKED;
+    Buffer buffers_[2] = {};
+    uint8_t active_ = 0;
+    bool sealed_ = false;
+    bool flush_requested_ = false;
+    uint32_t last_ts_ = 0;
+    uint32_t sealed_generation_ = 0;
+    std::atomic<uint32_t> written_generation_{0};
+
+    TaskHandle_t task_ = nullptr;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> stopped_{false};
+
+    std::atomic<uint32_t> appended_{0};
+    std::atomic<uint32_t> dropped_{0};
+    uint32_t overwritten_ = 0;
+    uint32_t erases_ = 0;
+};
+
+} // namespace ts_store
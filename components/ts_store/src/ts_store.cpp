@@ -0,0 +1,736 @@
+#include "ts_store/ts_store.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "ts_store";
+
+namespace ts_store {
+
+namespace {
+
+constexpr uint32_t segment_magic = 0x31535354; /* "TSS1" */
+constexpr uint32_t erased_word = 0xffffffff;
+constexpr size_t watermark_count = 4;
+/* The last watermark is kept for the final "fully acknowledged" mark. */
+constexpr uint8_t partial_watermarks = watermark_count - 1;
+
+/* Programmed once when a segment is opened, except acked[], whose erased
+ * words are filled in one by one as upload progress is acknowledged. */
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t erase_count;
+    uint16_t record_size;
+    uint16_t slot_size;
+    uint32_t crc;
+    uint32_t acked[watermark_count];
+};
+
+constexpr size_t header_space = 48;
+static_assert(sizeof(SegmentHeader) <= header_space, "segment header outgrew its space");
+
+/* Slot: [timestamp u32][payload][crc16 over both][padding to 4 bytes]. Erased
+ * flash reads as an invalid slot with timestamp 0xffffffff, which append()
+ * refuses, so the first erased slot marks the end of a segment. */
+constexpr size_t slot_overhead = sizeof(uint32_t) + sizeof(uint16_t);
+
+uint32_t header_crc(const SegmentHeader &h)
+{
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&h), offsetof(SegmentHeader, crc));
+}
+
+uint16_t slot_crc(const uint8_t *slot, size_t record_size)
+{
+    return esp_rom_crc16_le(0, slot, sizeof(uint32_t) + record_size);
+}
+
+uint32_t slot_timestamp(const uint8_t *slot)
+{
+    uint32_t ts;
+    memcpy(&ts, slot, sizeof(ts));
+    return ts;
+}
+
+bool slot_valid(const uint8_t *slot, size_t record_size)
+{
+    uint16_t stored;
+    memcpy(&stored, slot + sizeof(uint32_t) + record_size, sizeof(stored));
+    return slot_timestamp(slot) != erased_word && stored == slot_crc(slot, record_size);
+}
+
+/* Slots per read while scanning or replaying; bounded so it fits on the stack. */
+constexpr size_t chunk_bytes = 512;
+
+} // namespace
+
+size_t Store::slot_address(size_t index, uint32_t slot) const
+{
+    return segment_base(index) + header_space + static_cast<size_t>(slot) * slot_size_;
+}
+
+esp_err_t Store::init(const Config &config)
+{
+    if (segments_ != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (config.record_size == 0 || config.record_size > max_record_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    partition_ =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, config.partition_label);
+    if (partition_ == nullptr) {
+        ESP_LOGE(TAG, "partition '%s' not found", config.partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (config.segment_size == 0 || config.segment_size % partition_->erase_size != 0 ||
+        partition_->size / config.segment_size < 2) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    config_ = config;
+    slot_size_ = (slot_overhead + config.record_size + 3) & ~size_t(3);
+    slots_per_segment_ = static_cast<uint32_t>((config.segment_size - header_space) / slot_size_);
+    config_.buffer_size = config.buffer_size / slot_size_ * slot_size_;
+    if (config_.buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    segment_count_ = partition_->size / config.segment_size;
+
+    segments_ = static_cast<Segment *>(heap_caps_calloc(segment_count_, sizeof(Segment), MALLOC_CAP_INTERNAL));
+    lock_ = xSemaphoreCreateMutex();
+    for (Buffer &b : buffers_) {
+        b = {};
+        b.data = static_cast<uint8_t *>(heap_caps_malloc(config_.buffer_size, MALLOC_CAP_INTERNAL));
+    }
+    if (segments_ == nullptr || lock_ == nullptr || buffers_[0].data == nullptr || buffers_[1].data == nullptr) {
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = mount();
+    if (err != ESP_OK) {
+        deinit();
+        return err;
+    }
+
+    stopping_.store(false, std::memory_order_relaxed);
+    stopped_.store(false, std::memory_order_relaxed);
+    if (xTaskCreatePinnedToCore(writer_task, "ts_store", config.task_stack_size, this, config.task_priority, &task_,
+                                config.task_core) != pdPASS) {
+        task_ = nullptr;
+        deinit();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void Store::deinit()
+{
+    if (task_ != nullptr) {
+        flush(pdMS_TO_TICKS(5000));
+        stopping_.store(true, std::memory_order_release);
+        xTaskNotifyGive(task_);
+        while (!stopped_.load(std::memory_order_acquire)) {
+            vTaskDelay(1);
+        }
+        task_ = nullptr;
+    }
+    for (Buffer &b : buffers_) {
+        heap_caps_free(b.data);
+        b = {};
+    }
+    if (lock_ != nullptr) {
+        vSemaphoreDelete(lock_);
+        lock_ = nullptr;
+    }
+    heap_caps_free(segments_);
+    segments_ = nullptr;
+    segment_count_ = 0;
+    partition_ = nullptr;
+}
+
+esp_err_t Store::mount()
+{
+    head_ = segment_count_;
+    uint32_t max_seq = 0;
+    for (size_t i = 0; i < segment_count_; ++i) {
+        load_segment(i);
+        const Segment &s = segments_[i];
+        if (s.state == SegmentState::Live && s.seq >= max_seq) {
+            max_seq = s.seq;
+            head_ = i;
+        }
+    }
+    uint32_t max_erases = 0;
+    size_t live = 0;
+    for (size_t i = 0; i < segment_count_; ++i) {
+        Segment &s = segments_[i];
+        if (s.erase_count > max_erases) {
+            max_erases = s.erase_count;
+        }
+        if (s.state == SegmentState::Live) {
+            ++live;
+            if (i != head_ && s.acked >= s.count) {
+                s.state = SegmentState::Reclaimable;
+            }
+        }
+    }
+    /* Segments without a header carry no count; the ring keeps them within
+     * one lap of the others, so the maximum is a close estimate. */
+    for (size_t i = 0; i < segment_count_; ++i) {
+        if (segments_[i].state == SegmentState::Erased || segments_[i].state == SegmentState::Unknown) {
+            segments_[i].erase_count = max_erases;
+        }
+    }
+    next_seq_ = max_seq + 1;
+    last_ts_ = head_ != segment_count_ ? segments_[head_].last_ts : 0;
+    ESP_LOGI(TAG, "%s: %u segments, %u with data, %u-byte slots", partition_->label,
+             static_cast<unsigned>(segment_count_), static_cast<unsigned>(live), static_cast<unsigned>(slot_size_));
+    return ESP_OK;
+}
+
+void Store::load_segment(size_t index)
+{
+    Segment &s = segments_[index];
+    s = {};
+    SegmentHeader h;
+    if (esp_partition_read(partition_, segment_base(index), &h, sizeof(h)) != ESP_OK) {
+        s.state = SegmentState::Unknown;
+        return;
+    }
+    if (h.magic == erased_word && h.seq == erased_word && h.erase_count == erased_word && h.crc == erased_word) {
+        s.state = SegmentState::Erased;
+        return;
+    }
+    if (h.magic != segment_magic || h.crc != header_crc(h) || h.record_size != config_.record_size ||
+        h.slot_size != slot_size_) {
+        if (h.magic == segment_magic && h.record_size != config_.record_size) {
+            ESP_LOGW(TAG, "segment %u has %u-byte records, discarding", static_cast<unsigned>(index),
+                     static_cast<unsigned>(h.record_size));
+        }
+        s.state = SegmentState::Unknown;
+        return;
+    }
+
+    s.state = SegmentState::Live;
+    s.seq = h.seq;
+    s.erase_count = h.erase_count;
+    for (uint32_t mark : h.acked) {
+        if (mark != erased_word) {
+            ++s.ack_writes;
+            if (mark > s.acked) {
+                s.acked = mark;
+            }
+        }
+    }
+
+    /* Slots are programmed in order, so the written ones form a prefix. */
+    uint8_t slot[max_record_size + slot_overhead + 4];
+    uint32_t lo = 0;
+    uint32_t hi = slots_per_segment_;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t ts = erased_word;
+        esp_partition_read(partition_, slot_address(index, mid), &ts, sizeof(ts));
+        if (ts == erased_word) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    s.count = lo;
+    if (s.acked > s.count) {
+        s.acked = s.count;
+    }
+    if (s.count != 0 && read_slot(index, 0, slot)) {
+        s.first_ts = slot_timestamp(slot);
+    }
+    for (uint32_t i = s.count; i > 0; --i) {
+        if (read_slot(index, i - 1, slot) && slot_valid(slot, config_.record_size)) {
+            s.last_ts = slot_timestamp(slot);
+            break;
+        }
+    }
+}
+
+bool Store::read_slot(size_t index, uint32_t slot, uint8_t *out) const
+{
+    return esp_partition_read(partition_, slot_address(index, slot), out, slot_size_) == ESP_OK;
+}
+
+esp_err_t Store::erase_segment(size_t index)
+{
+    /* Back to front: the header sector goes last, so a header that reads as
+     * erased always means the whole segment is. */
+    const size_t sector = partition_->erase_size;
+    for (size_t off = config_.segment_size; off > 0; off -= sector) {
+        esp_err_t err = esp_partition_erase_range(partition_, segment_base(index) + off - sector, sector);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "erase of segment %u failed: %s", static_cast<unsigned>(index), esp_err_to_name(err));
+            segments_[index].state = SegmentState::Unknown;
+            return err;
+        }
+    }
+    Segment &s = segments_[index];
+    uint32_t erase_count = s.erase_count + 1;
+    s = {};
+    s.erase_count = erase_count;
+    s.state = SegmentState::Erased;
+    ++erases_;
+    return ESP_OK;
+}
+
+bool Store::open_next_segment()
+{
+    if (head_ != segment_count_) {
+        Segment &old = segments_[head_];
+        if (old.acked >= old.count) {
+            old.state = SegmentState::Reclaimable;
+        }
+    }
+    const size_t next = head_ == segment_count_ ? 0 : next_index(head_);
+    Segment &s = segments_[next];
+    if (s.state == SegmentState::Live) {
+        if (!config_.overwrite_oldest) {
+            return false;
+        }
+        overwritten_ += s.count - s.acked;
+    }
+    /* Whatever it held, Live ones included, is erased before the header goes in. */
+    if (s.state != SegmentState::Erased && erase_segment(next) != ESP_OK) {
+        return false;
+    }
+
+    SegmentHeader h;
+    memset(&h, 0xff, sizeof(h));
+    h.magic = segment_magic;
+    h.seq = next_seq_;
+    h.erase_count = s.erase_count;
+    h.record_size = static_cast<uint16_t>(config_.record_size);
+    h.slot_size = static_cast<uint16_t>(slot_size_);
+    h.crc = header_crc(h);
+    esp_err_t err = esp_partition_write(partition_, segment_base(next), &h, offsetof(SegmentHeader, acked));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "header write failed: %s", esp_err_to_name(err));
+        s.state = SegmentState::Unknown;
+        return false;
+    }
+    uint32_t erase_count = s.erase_count;
+    s = {};
+    s.seq = next_seq_++;
+    s.erase_count = erase_count;
+    s.state = SegmentState::Live;
+    head_ = next;
+    return true;
+}
+
+void Store::write_slots(const uint8_t *data, size_t count)
+{
+    while (count != 0) {
+        if (head_ == segment_count_ || segments_[head_].count == slots_per_segment_) {
+            if (!open_next_segment()) {
+                dropped_.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+                return;
+            }
+        }
+        Segment &s = segments_[head_];
+        size_t n = slots_per_segment_ - s.count;
+        if (n > count) {
+            n = count;
+        }
+        esp_err_t err = esp_partition_write(partition_, slot_address(head_, s.count), data, n * slot_size_);
+        if (err != ESP_OK) {
+            /* The slots read back as invalid and are skipped; keep going. */
+            ESP_LOGE(TAG, "write failed: %s", esp_err_to_name(err));
+        }
+        if (s.count == 0) {
+            s.first_ts = slot_timestamp(data);
+        }
+        s.last_ts = slot_timestamp(data + (n - 1) * slot_size_);
+        s.count += static_cast<uint32_t>(n);
+        data += n * slot_size_;
+        count -= n;
+    }
+}
+
+void Store::write_watermark(size_t index, uint32_t value, bool final)
+{
+    Segment &s = segments_[index];
+    const uint8_t limit = final ? watermark_count : partial_watermarks;
+    if (s.ack_writes >= limit) {
+        return;
+    }
+    size_t offset = segment_base(index) + offsetof(SegmentHeader, acked) + s.ack_writes * sizeof(uint32_t);
+    if (esp_partition_write(partition_, offset, &value, sizeof(value)) == ESP_OK) {
+        ++s.ack_writes;
+    }
+}
+
+void Store::seal_active_locked()
+{
+    sealed_ = true;
+    buffers_[active_].generation = ++sealed_generation_;
+    active_ ^= 1;
+    buffers_[active_].fill = 0;
+}
+
+esp_err_t Store::append(uint32_t timestamp, const void *payload)
+{
+    if (timestamp == erased_word) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint8_t slot[max_record_size + slot_overhead + 4];
+    memcpy(slot, &timestamp, sizeof(timestamp));
+    memcpy(slot + sizeof(timestamp), payload, config_.record_size);
+    uint16_t crc = slot_crc(slot, config_.record_size);
+    memcpy(slot + sizeof(timestamp) + config_.record_size, &crc, sizeof(crc));
+    memset(slot + slot_overhead + config_.record_size, 0xff, slot_size_ - slot_overhead - config_.record_size);
+
+    bool wake = false;
+    portENTER_CRITICAL(&buffer_lock_);
+    if (timestamp < last_ts_) {
+        portEXIT_CRITICAL(&buffer_lock_);
+        return ESP_ERR_INVALID_ARG;
+    }
+    Buffer *b = &buffers_[active_];
+    if (b->fill + slot_size_ > config_.buffer_size) {
+        /* Still full: the other buffer has not been written out yet. */
+        portEXIT_CRITICAL(&buffer_lock_);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(b->data + b->fill, slot, slot_size_);
+    b->fill += slot_size_;
+    last_ts_ = timestamp;
+    if (b->fill + slot_size_ > config_.buffer_size && !sealed_) {
+        seal_active_locked();
+        wake = true;
+    }
+    portEXIT_CRITICAL(&buffer_lock_);
+
+    appended_.fetch_add(1, std::memory_order_relaxed);
+    if (wake) {
+        xTaskNotifyGive(task_);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Store::flush(TickType_t timeout)
+{
+    if (task_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&buffer_lock_);
+    /* If a sealed buffer is still pending, the writer seals the active one
+     * right after it, which makes it the next generation. */
+    uint32_t target = sealed_generation_;
+    if (buffers_[active_].fill != 0) {
+        if (!sealed_) {
+            seal_active_locked();
+            target = sealed_generation_;
+        } else {
+            target = sealed_generation_ + 1;
+        }
+    }
+    flush_requested_ = true;
+    portEXIT_CRITICAL(&buffer_lock_);
+
+    xTaskNotifyGive(task_);
+    TickType_t start = xTaskGetTickCount();
+    while (static_cast<int32_t>(written_generation_.load(std::memory_order_acquire) - target) < 0) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+void Store::writer_task(void *arg)
+{
+    auto *self = static_cast<Store *>(arg);
+    const TickType_t period = pdMS_TO_TICKS(self->config_.flush_interval_ms);
+    for (;;) {
+        bool timed_out = ulTaskNotifyTake(pdTRUE, period == 0 ? 1 : period) == 0;
+        bool stopping = self->stopping_.load(std::memory_order_acquire);
+
+        xSemaphoreTake(self->lock_, portMAX_DELAY);
+        for (;;) {
+            Buffer *pending = nullptr;
+            portENTER_CRITICAL(&self->buffer_lock_);
+            bool flush = timed_out || stopping || self->flush_requested_;
+            const Buffer &active = self->buffers_[self->active_];
+            /* A buffer that filled while the other was pending could not be
+             * sealed by append(); take it now rather than at the next timeout. */
+            bool full = active.fill + self->slot_size_ > self->config_.buffer_size;
+            if (!self->sealed_ && (flush || full) && active.fill != 0) {
+                self->seal_active_locked();
+                self->flush_requested_ = false;
+            }
+            if (self->sealed_) {
+                pending = &self->buffers_[self->active_ ^ 1];
+            } else if (flush) {
+                self->flush_requested_ = false;
+            }
+            portEXIT_CRITICAL(&self->buffer_lock_);
+            if (pending == nullptr) {
+                break;
+            }
+
+            /* append() only touches the active buffer, so this one is ours
+             * until sealed_ is cleared. */
+            self->write_slots(pending->data, pending->fill / self->slot_size_);
+            uint32_t generation = pending->generation;
+            portENTER_CRITICAL(&self->buffer_lock_);
+            pending->fill = 0;
+            self->sealed_ = false;
+            portEXIT_CRITICAL(&self->buffer_lock_);
+            self->written_generation_.store(generation, std::memory_order_release);
+        }
+
+        /* Erase ahead once the head is three-quarters full, so opening the next
+         * segment does not stall the following buffer write. */
+        if (self->head_ != self->segment_count_ &&
+            self->segments_[self->head_].count >= self->slots_per_segment_ / 4 * 3) {
+            size_t next = self->next_index(self->head_);
+            const Segment &s = self->segments_[next];
+            /* A Live one still holding unacked records is left to the write
+             * that opens it: replay may ack them before then. */
+            bool done = s.state == SegmentState::Live && s.acked >= s.count && next != self->head_;
+            if (done || s.state == SegmentState::Reclaimable || s.state == SegmentState::Unknown) {
+                self->erase_segment(next);
+            }
+        }
+        xSemaphoreGive(self->lock_);
+
+        if (stopping) {
+            break;
+        }
+    }
+    self->stopped_.store(true, std::memory_order_release);
+    vTaskDelete(nullptr);
+}
+
+size_t Store::find_tail() const
+{
+    const size_t start = head_ == segment_count_ ? 0 : next_index(head_);
+    for (size_t k = 0; k < segment_count_; ++k) {
+        size_t i = (start + k) % segment_count_;
+        const Segment &s = segments_[i];
+        if (s.state == SegmentState::Live && s.acked < s.count) {
+            return i;
+        }
+    }
+    return segment_count_;
+}
+
+size_t Store::find_slot(size_t index, uint32_t timestamp) const
+{
+    uint32_t lo = 0;
+    uint32_t hi = segments_[index].count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t ts = erased_word;
+        esp_partition_read(partition_, slot_address(index, mid), &ts, sizeof(ts));
+        if (ts < timestamp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+esp_err_t Store::scan(uint32_t from, uint32_t to, Visitor visitor, void *ctx)
+{
+    if (lock_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t chunk[chunk_bytes];
+    const uint32_t per_chunk = static_cast<uint32_t>(chunk_bytes / slot_size_);
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const size_t start = head_ == segment_count_ ? 0 : next_index(head_);
+    bool done = false;
+    for (size_t k = 0; k < segment_count_ && !done; ++k) {
+        size_t i = (start + k) % segment_count_;
+        const Segment &s = segments_[i];
+        if ((s.state != SegmentState::Live && s.state != SegmentState::Reclaimable) || s.count == 0 ||
+            s.last_ts < from || s.first_ts > to) {
+            continue;
+        }
+        for (uint32_t slot = static_cast<uint32_t>(find_slot(i, from)); slot < s.count && !done;) {
+            uint32_t n = s.count - slot < per_chunk ? s.count - slot : per_chunk;
+            if (esp_partition_read(partition_, slot_address(i, slot), chunk, n * slot_size_) != ESP_OK) {
+                break;
+            }
+            for (uint32_t j = 0; j < n; ++j) {
+                const uint8_t *p = chunk + j * slot_size_;
+                if (!slot_valid(p, config_.record_size)) {
+                    continue;
+                }
+                uint32_t ts = slot_timestamp(p);
+                if (ts > to || !visitor(ctx, ts, p + sizeof(uint32_t))) {
+                    done = true;
+                    break;
+                }
+            }
+            slot += n;
+        }
+    }
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Store::replay(size_t max, Visitor visitor, void *ctx, Position *next)
+{
+    if (lock_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t chunk[chunk_bytes];
+    const uint32_t per_chunk = static_cast<uint32_t>(chunk_bytes / slot_size_);
+
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    size_t index = find_tail();
+    if (index == segment_count_) {
+        /* Nothing pending: report the end of the log. */
+        *next = head_ == segment_count_ ? Position{0, 0} : Position{segments_[head_].seq, segments_[head_].count};
+        xSemaphoreGive(lock_);
+        return ESP_OK;
+    }
+    Position pos = {segments_[index].seq, segments_[index].acked};
+    size_t delivered = 0;
+    bool done = false;
+    while (!done && delivered < max) {
+        const Segment &s = segments_[index];
+        if (s.state != SegmentState::Live || s.seq != pos.seq) {
+            /* Overwritten while the lock was released; stop at what was delivered. */
+            break;
+        }
+        if (pos.slot >= s.count) {
+            if (index == head_) {
+                break;
+            }
+            index = next_index(index);
+            if (segments_[index].state != SegmentState::Live) {
+                break;
+            }
+            pos = {segments_[index].seq, segments_[index].acked};
+            continue;
+        }
+        size_t n = s.count - pos.slot;
+        if (n > per_chunk) {
+            n = per_chunk;
+        }
+        if (n > max - delivered) {
+            n = max - delivered;
+        }
+        if (esp_partition_read(partition_, slot_address(index, pos.slot), chunk, n * slot_size_) != ESP_OK) {
+            break;
+        }
+        xSemaphoreGive(lock_);
+        for (size_t j = 0; j < n; ++j) {
+            const uint8_t *p = chunk + j * slot_size_;
+            if (slot_valid(p, config_.record_size)) {
+                if (!visitor(ctx, slot_timestamp(p), p + sizeof(uint32_t))) {
+                    done = true;
+                    break;
+                }
+                ++delivered;
+            }
+            ++pos.slot;
+        }
+        xSemaphoreTake(lock_, portMAX_DELAY);
+    }
+    xSemaphoreGive(lock_);
+    *next = pos;
+    return ESP_OK;
+}
+
+esp_err_t Store::ack(const Position &upto)
+{
+    if (lock_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    for (size_t i = 0; i < segment_count_; ++i) {
+        Segment &s = segments_[i];
+        if (s.state != SegmentState::Live || s.seq > upto.seq) {
+            continue;
+        }
+        uint32_t acked = s.seq < upto.seq ? s.count : (upto.slot < s.count ? upto.slot : s.count);
+        if (acked <= s.acked) {
+            continue;
+        }
+        s.acked = acked;
+        const bool sealed = i != head_ || s.count == slots_per_segment_;
+        const bool final = sealed && acked == s.count;
+        write_watermark(i, acked, final);
+        if (final && i != head_) {
+            s.state = SegmentState::Reclaimable;
+        }
+    }
+    xSemaphoreGive(lock_);
+    return ESP_OK;
+}
+
+esp_err_t Store::erase_all()
+{
+    if (lock_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    portENTER_CRITICAL(&buffer_lock_);
+    buffers_[0].fill = 0;
+    buffers_[1].fill = 0;
+    sealed_ = false;
+    last_ts_ = 0;
+    portEXIT_CRITICAL(&buffer_lock_);
+    written_generation_.store(sealed_generation_, std::memory_order_release);
+
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < segment_count_; ++i) {
+        if (segments_[i].state != SegmentState::Erased) {
+            esp_err_t err = erase_segment(i);
+            if (err != ESP_OK) {
+                result = err;
+            }
+        }
+    }
+    head_ = segment_count_;
+    xSemaphoreGive(lock_);
+    return result;
+}
+
+StoreStats Store::stats() const
+{
+    StoreStats st = {};
+    st.appended = appended_.load(std::memory_order_relaxed);
+    st.dropped = dropped_.load(std::memory_order_relaxed);
+    if (lock_ == nullptr) {
+        return st;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    st.overwritten = overwritten_;
+    st.erases = erases_;
+    st.segments = static_cast<uint32_t>(segment_count_);
+    for (size_t i = 0; i < segment_count_; ++i) {
+        const Segment &s = segments_[i];
+        if (s.state == SegmentState::Live) {
+            ++st.live_segments;
+            st.pending += s.count - s.acked;
+        }
+        if (s.erase_count > st.max_erase_count) {
+            st.max_erase_count = s.erase_count;
+        }
+    }
+    xSemaphoreGive(lock_);
+    return st;
+}
+
+} // namespace ts_store
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_adc/adc_oneshot.h"
+#include "esp_err.h"
+
+namespace ulp_agg {
+
+struct Summary {
+    uint32_t count;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    /** Times consecutive samples moved between below, inside and above [low, high]. */
+    uint32_t crossings;
+    /** At least one sample was outside [low, high]. */
+    bool anomaly;
+
+    float mean() const { return count != 0 ? static_cast<float>(sum) / count : 0.0f; }
+};
+
+/**
+ * @brief A full batch, read in place in RTC slow memory.
+ *
+ * No copy is made: operator[] reads the word the ULP wrote. The batch
+ * belongs to the caller until Aggregator::release(); the ULP fills the
+ * other buffer meanwhile and only drops samples if that one fills up too.
+ */
+class Batch {
+public:
+    size_t size() const { return count_; }
+
+    /** Raw ADC reading @p i, oldest first. */
+    uint16_t operator[](size_t i) const { return static_cast<uint16_t>(words_[i]); }
+
+    const Summary &summary() const { return summary_; }
+
+    /** The ULP-written words; only the low 16 bits of each are the sample. */
+    const volatile uint32_t *words() const { return words_; }
+
+private:
+    friend class Aggregator;
+
+    const volatile uint32_t *words_ = nullptr;
+    size_t count_ = 0;
+    Summary summary_ = {};
+    uint8_t index_ = 0;
+};
+
+/**
+ * @brief Sampling and aggregation on the ULP coprocessor, between deep sleeps.
+ *
+ * The ULP (FSM or RISC-V, whichever CONFIG_ULP_COPROC_TYPE selects) wakes
+ * every Config::period_us, takes one ADC1 reading and folds it into the
+ * batch it is filling in RTC slow memory: the sample itself, count, min,
+ * max, sum and the number of threshold crossings. The main cores stay in
+ * deep sleep until a batch is full, or, with wake_on_anomaly, until the
+ * first sample of a batch falls outside [low, high]. Two buffers alternate,
+ * so the ULP keeps sampling while the main cores work through the previous
+ * batch.
+ *
+ * Typical wake cycle:
+ *
+ *     aggregator.init(config);           // loads the ULP only on a cold boot
+ *     ulp_agg::Batch batch;
+ *     while (aggregator.acquire(&batch)) {
+ *         publish(batch.summary());
+ *         aggregator.release(batch);
+ *     }
+ *     aggregator.sleep();                // does not return
+ *
+ * Requires CONFIG_ULP_COPROC_ENABLED with enough ULP_COPROC_RESERVE_MEM
+ * (see ULP_AGG_BATCH_SIZE); otherwise init() fails with
+ * ESP_ERR_NOT_SUPPORTED.
+ */
+class Aggregator {
+public:
+    struct Config {
+        /** ADC1 channel; on the FSM it must equal CONFIG_ULP_AGG_FSM_ADC_CHANNEL. */
+        adc_channel_t channel = ADC_CHANNEL_6;
+        adc_atten_t atten = ADC_ATTEN_DB_12;
+        uint32_t period_us = 100000;
+        /** Samples per batch, at most CONFIG_ULP_AGG_BATCH_SIZE. */
+        uint16_t batch_size = 64;
+        /** In-range window, in raw ADC counts. */
+        uint16_t low = 0;
+        uint16_t high = 0xffff;
+        bool wake_on_anomaly = true;
+    };
+
+    Aggregator() = default;
+    /* Leaves the ULP running: it is meant to outlive the main-core state across deep sleep. */
+    ~Aggregator() = default;
+
+    Aggregator(const Aggregator &) = delete;
+    Aggregator &operator=(const Aggregator &) = delete;
+
+    /**
+     * @brief Start the ULP program, or attach to the one already running.
+     *
+     * After a deep-sleep wake with the program still running under the same
+     * configuration, nothing is reloaded and the batches collected during
+     * sleep are kept. Otherwise the program is loaded and started afresh.
+     */
+    esp_err_t init(const Config &config);
+
+    /** Stop the ULP timer; the program finishes its current run and is not started again. */
+    void deinit();
+
+    /** Oldest full batch, if any. @return false if none is ready. */
+    bool acquire(Batch *out);
+
+    void release(const Batch &batch);
+
+    /** Summary of the batch being filled, e.g. after a wake on anomaly. Racy with the ULP by one sample. */
+    Summary current() const;
+
+    /** Samples dropped so far because both buffers were full (16-bit, wraps). */
+    uint32_t overruns() const;
+
+    /**
+     * @brief Enable the ULP wakeup source and enter deep sleep.
+     *
+     * Returns ESP_ERR_INVALID_STATE, instead of sleeping, while a full
+     * batch has not been released: the ULP would have nothing to wake the
+     * cores for until the second buffer fills.
+     */
+    esp_err_t sleep();
+
+private:
+    Summary summary_of(int buffer) const;
+
+    bool running_ = false;
+};
+
+} // namespace ulp_agg
@@ -0,0 +1,56 @@
+/*
+ * Layout of the RTC slow memory block shared by the ULP program and
+ * ulp_agg::Aggregator. Included from C, C++ and ULP FSM assembly, so
+ * preprocessor definitions only.
+ *
+ * The block is an array of 32-bit words (the ULP symbol "shared"). The FSM
+ * can only read and write the low 16 bits of a word - a store puts the PC in
+ * the upper half - so every field is a 16-bit value in the low half of its
+ * word, for both ULP types. Word indices:
+ */
+#pragma once
+
+#include "sdkconfig.h"
+
+#define ULP_AGG_MAX_BATCH CONFIG_ULP_AGG_BATCH_SIZE
+
+/* Configuration, written by the main cores before the program starts. */
+#define ULP_AGG_MAGIC 0
+#define ULP_AGG_LOW 1
+#define ULP_AGG_HIGH 2
+#define ULP_AGG_BATCH 3
+#define ULP_AGG_FLAGS 4
+#define ULP_AGG_CHANNEL 5
+
+/* ULP state. */
+#define ULP_AGG_ACTIVE 6        /* buffer being filled, 0 or 1 */
+#define ULP_AGG_FILL 7          /* samples in the active buffer */
+#define ULP_AGG_ZONE 8          /* last sample: 0 below LOW, 1 in range, 2 above HIGH */
+#define ULP_AGG_OVERRUNS 9      /* samples dropped because both buffers were full */
+#define ULP_AGG_WAKE_PENDING 10 /* FSM: a wake the main cores were not ready for */
+#define ULP_AGG_SCRATCH 11
+
+/* Summary of buffer b: ULP_AGG_SUMMARY(b) + ULP_AGG_S_*. */
+#define ULP_AGG_SUMMARY0 12
+#define ULP_AGG_SUMMARY(b) (ULP_AGG_SUMMARY0 + 8 * (b))
+#define ULP_AGG_S_COUNT 0
+#define ULP_AGG_S_MIN 1
+#define ULP_AGG_S_MAX 2
+#define ULP_AGG_S_SUM_LO 3
+#define ULP_AGG_S_SUM_HI 4
+#define ULP_AGG_S_CROSSINGS 5
+#define ULP_AGG_S_ANOMALY 6
+/* Set by the ULP when the buffer is full, cleared by the main cores once
+ * they are done with it. The ULP does not touch a ready buffer. */
+#define ULP_AGG_S_READY 7
+
+/* Samples of buffer b. */
+#define ULP_AGG_SAMPLES0 28
+#define ULP_AGG_SAMPLES(b) (ULP_AGG_SAMPLES0 + ULP_AGG_MAX_BATCH * (b))
+
+#define ULP_AGG_WORDS (ULP_AGG_SAMPLES0 + 2 * ULP_AGG_MAX_BATCH)
+
+/* ULP_AGG_FLAGS bits. */
+#define ULP_AGG_FLAG_WAKE_ON_ANOMALY 1
+
+#define ULP_AGG_MAGIC_VALUE 0x5541 /* "UA" */
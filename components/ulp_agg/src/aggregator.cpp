@@ -0,0 +1,258 @@
+#include "ulp_agg/aggregator.hpp"
+
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "sdkconfig.h"
+#include "ulp_agg/ulp_shared.h"
+
+#if CONFIG_ULP_COPROC_ENABLED
+
+#include "ulp_adc.h"
+#include "ulp_agg.h"
+#if CONFIG_ULP_COPROC_TYPE_FSM
+#include "ulp.h"
+#else
+#include "ulp_riscv.h"
+#endif
+
+extern const uint8_t ulp_agg_bin_start[] asm("_binary_ulp_agg_bin_start");
+extern const uint8_t ulp_agg_bin_end[] asm("_binary_ulp_agg_bin_end");
+
+#endif
+
+namespace ulp_agg {
+
+static const char *TAG = "ulp_agg";
+
+#if CONFIG_ULP_COPROC_ENABLED
+
+namespace {
+
+volatile uint32_t *shared_words()
+{
+    return &ulp_shared;
+}
+
+/* Only the low half of a ULP-written word is data (see ulp_shared.h). */
+uint32_t word(size_t index)
+{
+    return shared_words()[index] & 0xffff;
+}
+
+void set_word(size_t index, uint32_t value)
+{
+    shared_words()[index] = value;
+}
+
+bool ready(int buffer)
+{
+    return word(ULP_AGG_SUMMARY(buffer) + ULP_AGG_S_READY) != 0;
+}
+
+} // namespace
+
+esp_err_t Aggregator::init(const Config &config)
+{
+    if (config.batch_size == 0 || config.batch_size > ULP_AGG_MAX_BATCH || config.low > config.high) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if CONFIG_ULP_COPROC_TYPE_FSM
+    if (config.channel != CONFIG_ULP_AGG_FSM_ADC_CHANNEL) {
+        ESP_LOGE(TAG, "the FSM program samples channel %d (ULP_AGG_FSM_ADC_CHANNEL)",
+                 CONFIG_ULP_AGG_FSM_ADC_CHANNEL);
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+    uint32_t flags = config.wake_on_anomaly ? ULP_AGG_FLAG_WAKE_ON_ANOMALY : 0;
+
+    /* The ULP kept running through deep sleep: keep its batches. */
+    if (esp_reset_reason() == ESP_RST_DEEPSLEEP && word(ULP_AGG_MAGIC) == ULP_AGG_MAGIC_VALUE &&
+        word(ULP_AGG_LOW) == config.low && word(ULP_AGG_HIGH) == config.high &&
+        word(ULP_AGG_BATCH) == config.batch_size && word(ULP_AGG_FLAGS) == flags &&
+        word(ULP_AGG_CHANNEL) == static_cast<uint32_t>(config.channel)) {
+        running_ = true;
+        return ESP_OK;
+    }
+
+    ulp_adc_cfg_t adc = {};
+    adc.adc_n = ADC_UNIT_1;
+    adc.channel = config.channel;
+    adc.atten = config.atten;
+    adc.width = ADC_BITWIDTH_DEFAULT;
+#if CONFIG_ULP_COPROC_TYPE_FSM
+    adc.ulp_mode = ADC_ULP_MODE_FSM;
+#else
+    adc.ulp_mode = ADC_ULP_MODE_RISCV;
+#endif
+    esp_err_t err = ulp_adc_init(&adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC setup failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+#if CONFIG_ULP_COPROC_TYPE_FSM
+    err = ulp_load_binary(0, ulp_agg_bin_start, (ulp_agg_bin_end - ulp_agg_bin_start) / sizeof(uint32_t));
+#else
+    err = ulp_riscv_load_binary(ulp_agg_bin_start, ulp_agg_bin_end - ulp_agg_bin_start);
+#endif
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "loading the ULP program failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (size_t i = 0; i < ULP_AGG_SAMPLES0; ++i) {
+        set_word(i, 0);
+    }
+    set_word(ULP_AGG_LOW, config.low);
+    set_word(ULP_AGG_HIGH, config.high);
+    set_word(ULP_AGG_BATCH, config.batch_size);
+    set_word(ULP_AGG_FLAGS, flags);
+    set_word(ULP_AGG_CHANNEL, static_cast<uint32_t>(config.channel));
+    set_word(ULP_AGG_ZONE, 1);
+    set_word(ULP_AGG_MAGIC, ULP_AGG_MAGIC_VALUE);
+
+    err = ulp_set_wakeup_period(0, config.period_us);
+    if (err == ESP_OK) {
+#if CONFIG_ULP_COPROC_TYPE_FSM
+        err = ulp_run(&ulp_entry - RTC_SLOW_MEM);
+#else
+        err = ulp_riscv_run();
+#endif
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "starting the ULP failed: %s", esp_err_to_name(err));
+        set_word(ULP_AGG_MAGIC, 0);
+        return err;
+    }
+    running_ = true;
+    return ESP_OK;
+}
+
+void Aggregator::deinit()
+{
+    if (!running_) {
+        return;
+    }
+#if CONFIG_ULP_COPROC_TYPE_FSM
+    ulp_timer_stop();
+#else
+    ulp_riscv_timer_stop();
+#endif
+    set_word(ULP_AGG_MAGIC, 0);
+    running_ = false;
+}
+
+Summary Aggregator::summary_of(int buffer) const
+{
+    size_t base = ULP_AGG_SUMMARY(buffer);
+    Summary s;
+    s.count = word(base + ULP_AGG_S_COUNT);
+    s.min = static_cast<uint16_t>(s.count != 0 ? word(base + ULP_AGG_S_MIN) : 0);
+    s.max = static_cast<uint16_t>(word(base + ULP_AGG_S_MAX));
+    s.sum = word(base + ULP_AGG_S_SUM_HI) << 16 | word(base + ULP_AGG_S_SUM_LO);
+    s.crossings = word(base + ULP_AGG_S_CROSSINGS);
+    s.anomaly = word(base + ULP_AGG_S_ANOMALY) != 0;
+    return s;
+}
+
+bool Aggregator::acquire(Batch *out)
+{
+    if (!running_) {
+        return false;
+    }
+    /* The ULP only moves on to a full buffer when both are full, so then
+     * the active one is the older. */
+    int active = static_cast<int>(word(ULP_AGG_ACTIVE));
+    int buffer;
+    if (ready(active)) {
+        buffer = active;
+    } else if (ready(active ^ 1)) {
+        buffer = active ^ 1;
+    } else {
+        return false;
+    }
+    out->words_ = shared_words() + ULP_AGG_SAMPLES(buffer);
+    out->summary_ = summary_of(buffer);
+    out->count_ = out->summary_.count;
+    out->index_ = static_cast<uint8_t>(buffer);
+    return true;
+}
+
+void Aggregator::release(const Batch &batch)
+{
+    set_word(ULP_AGG_SUMMARY(batch.index_) + ULP_AGG_S_READY, 0);
+}
+
+Summary Aggregator::current() const
+{
+    int active = static_cast<int>(word(ULP_AGG_ACTIVE));
+    if (!running_ || ready(active) || word(ULP_AGG_FILL) == 0) {
+        return Summary{};
+    }
+    return summary_of(active);
+}
+
+uint32_t Aggregator::overruns() const
+{
+    return running_ ? word(ULP_AGG_OVERRUNS) : 0;
+}
+
+esp_err_t Aggregator::sleep()
+{
+    if (!running_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* A wake the FSM held back while the cores were up is stale now. */
+    set_word(ULP_AGG_WAKE_PENDING, 0);
+    if (ready(0) || ready(1)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = esp_sleep_enable_ulp_wakeup();
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_deep_sleep_start();
+    return ESP_OK;
+}
+
+#else // !CONFIG_ULP_COPROC_ENABLED
+
+esp_err_t Aggregator::init(const Config &)
+{
+    ESP_LOGE(TAG, "enable the ULP coprocessor (ULP_COPROC_ENABLED)");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void Aggregator::deinit() {}
+
+Summary Aggregator::summary_of(int) const
+{
+    return Summary{};
+}
+
+bool Aggregator::acquire(Batch *)
+{
+    return false;
+}
+
+void Aggregator::release(const Batch &) {}
+
+Summary Aggregator::current() const
+{
+    return Summary{};
+}
+
+uint32_t Aggregator::overruns() const
+{
+    return 0;
+}
+
+esp_err_t Aggregator::sleep()
+{
+    return ESP_ERR_INVALID_STATE;
+}
+
+#endif
+
+} // namespace ulp_agg
@@ -0,0 +1,75 @@
+/*
+ * ULP RISC-V program: one ADC sample per timer wakeup, folded into the
+ * summary of the active buffer; see ulp_agg/ulp_shared.h for the layout.
+ */
+#include <stdint.h>
+
+#include "ulp_agg/ulp_shared.h"
+#include "ulp_riscv_adc_ulp_core.h"
+#include "ulp_riscv_utils.h"
+
+volatile uint32_t shared[ULP_AGG_WORDS];
+
+int main(void)
+{
+    uint32_t active = shared[ULP_AGG_ACTIVE];
+    volatile uint32_t *summary = &shared[ULP_AGG_SUMMARY(active)];
+    if (summary[ULP_AGG_S_READY] != 0) {
+        /* Both buffers are waiting for the main cores. */
+        shared[ULP_AGG_OVERRUNS] = (shared[ULP_AGG_OVERRUNS] + 1) & 0xffff;
+        return 0;
+    }
+
+    uint32_t fill = shared[ULP_AGG_FILL];
+    if (fill == 0) {
+        summary[ULP_AGG_S_COUNT] = 0;
+        summary[ULP_AGG_S_MIN] = 0xffff;
+        summary[ULP_AGG_S_MAX] = 0;
+        summary[ULP_AGG_S_SUM_LO] = 0;
+        summary[ULP_AGG_S_SUM_HI] = 0;
+        summary[ULP_AGG_S_CROSSINGS] = 0;
+        summary[ULP_AGG_S_ANOMALY] = 0;
+    }
+
+    int32_t raw = ulp_riscv_adc_read_channel(ADC_UNIT_1, (int)shared[ULP_AGG_CHANNEL]);
+    uint32_t sample = raw < 0 ? 0 : (uint32_t)raw & 0xffff;
+    shared[ULP_AGG_SAMPLES(active) + fill] = sample;
+
+    summary[ULP_AGG_S_COUNT] = fill + 1;
+    if (sample < summary[ULP_AGG_S_MIN]) {
+        summary[ULP_AGG_S_MIN] = sample;
+    }
+    if (sample > summary[ULP_AGG_S_MAX]) {
+        summary[ULP_AGG_S_MAX] = sample;
+    }
+    /* Same 16+16-bit split as the FSM program, so the reader does not care which ran. */
+    uint32_t sum = (summary[ULP_AGG_S_SUM_HI] << 16 | summary[ULP_AGG_S_SUM_LO]) + sample;
+    summary[ULP_AGG_S_SUM_LO] = sum & 0xffff;
+    summary[ULP_AGG_S_SUM_HI] = sum >> 16;
+
+    uint32_t zone = sample < shared[ULP_AGG_LOW] ? 0 : sample > shared[ULP_AGG_HIGH] ? 2 : 1;
+    if (zone != shared[ULP_AGG_ZONE]) {
+        summary[ULP_AGG_S_CROSSINGS] = summary[ULP_AGG_S_CROSSINGS] + 1;
+        shared[ULP_AGG_ZONE] = zone;
+    }
+
+    int wake = 0;
+    if (zone != 1 && summary[ULP_AGG_S_ANOMALY] == 0) {
+        summary[ULP_AGG_S_ANOMALY] = 1;
+        wake = (shared[ULP_AGG_FLAGS] & ULP_AGG_FLAG_WAKE_ON_ANOMALY) != 0;
+    }
+
+    if (fill + 1 >= shared[ULP_AGG_BATCH]) {
+        summary[ULP_AGG_S_READY] = 1;
+        shared[ULP_AGG_FILL] = 0;
+        shared[ULP_AGG_ACTIVE] = active ^ 1;
+        wake = 1;
+    } else {
+        shared[ULP_AGG_FILL] = fill + 1;
+    }
+
+    if (wake) {
+        ulp_riscv_wakeup_main_processor();
+    }
+    return 0;
+}
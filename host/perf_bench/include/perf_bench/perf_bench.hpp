@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "benchmark/benchmark.h"
+
+/**
+ * @file perf_bench.hpp
+ * @brief Host build of the perf_bench case API, on Google Benchmark.
+ *
+ * Case files in components/perf_bench/benches compile against this header
+ * unchanged: State forwards the case loop, pause()/resume() and skip() to a
+ * benchmark::State, and PERF_BENCH() / PERF_BENCH_ARGS() register the cases
+ * for the host runner, which keeps each case's registered iteration count so
+ * per-iteration results line up with the target's. The runner writes the
+ * same CSV report as the bench app; see host/CMakeLists.txt.
+ */
+
+namespace perf_bench {
+
+class State {
+public:
+    State(benchmark::State &state, int64_t arg) : state_(state), arg_(arg) {}
+
+    State(const State &) = delete;
+    State &operator=(const State &) = delete;
+
+    benchmark::State::StateIterator begin() { return state_.begin(); }
+    benchmark::State::StateIterator end() { return state_.end(); }
+
+    /** Number of loop iterations this run will execute. */
+    uint32_t iterations() const { return static_cast<uint32_t>(state_.max_iterations); }
+
+    /** Argument the case was registered with (0 for PERF_BENCH()). */
+    int64_t arg() const { return arg_; }
+
+    void pause() { state_.PauseTiming(); }
+    void resume() { state_.ResumeTiming(); }
+
+    void set_items_per_iteration(uint32_t items) { items_per_iteration_ = items; }
+    void set_bytes_per_iteration(uint32_t bytes) { bytes_per_iteration_ = bytes; }
+
+    /** Skip this case; it is reported as skipped and left out of the CSV report. */
+    void skip(const char *reason) { state_.SkipWithError(reason); }
+
+    uint32_t items_per_iteration() const { return items_per_iteration_; }
+    uint32_t bytes_per_iteration() const { return bytes_per_iteration_; }
+
+private:
+    benchmark::State &state_;
+    int64_t arg_;
+    uint32_t items_per_iteration_ = 1;
+    uint32_t bytes_per_iteration_ = 0;
+};
+
+using BenchFn = void (*)(State &state);
+
+/** Static registration record, as on the target; the runner hands the list to Google Benchmark. */
+struct Case {
+    Case(const char *name, BenchFn fn, uint32_t iterations, const int64_t *args, size_t arg_count);
+
+    const char *name;
+    BenchFn fn;
+    uint32_t iterations;
+    const int64_t *args;
+    size_t arg_count;
+    Case *next;
+};
+
+/** First registered case, or nullptr. Iterate with Case::next. */
+const Case *first_case();
+
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+} // namespace perf_bench
+
+#define PERF_BENCH_CONCAT_(a, b) a##b
+#define PERF_BENCH_CONCAT(a, b) PERF_BENCH_CONCAT_(a, b)
+
+#define PERF_BENCH(fn, iters)                                                                 \
+    static ::perf_bench::Case PERF_BENCH_CONCAT(s_perf_bench_case_, __LINE__)(#fn, fn, iters, \
+                                                                           nullptr, 0)
+
+#define PERF_BENCH_ARGS(fn, iters, ...)                                                       \
+    static constexpr int64_t PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__)[] = {__VA_ARGS__}; \
+    static ::perf_bench::Case PERF_BENCH_CONCAT(s_perf_bench_case_, __LINE__)(                 \
+        #fn, fn, iters, PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__),                      \
+        sizeof(PERF_BENCH_CONCAT(s_perf_bench_args_, __LINE__)) / sizeof(int64_t))
@@ -0,0 +1,192 @@
+#include "perf_bench/perf_bench.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace perf_bench {
+
+namespace {
+
+Case *s_head = nullptr;
+Case *s_tail = nullptr;
+
+/* Google Benchmark renamed error_occurred to skipped in 1.8; take whichever exists. */
+template <typename Run>
+auto skipped(const Run &run, int) -> decltype(static_cast<bool>(run.skipped))
+{
+    return static_cast<bool>(run.skipped);
+}
+
+template <typename Run>
+bool skipped(const Run &run, long)
+{
+    return run.error_occurred;
+}
+
+double counter(const benchmark::BenchmarkReporter::Run &run, const char *name)
+{
+    auto it = run.counters.find(name);
+    return it != run.counters.end() ? static_cast<double>(it->second) : 0.0;
+}
+
+double ratio(double num, double den)
+{
+    return den != 0.0 ? num / den : 0.0;
+}
+
+/**
+ * @brief Writes the bench app's CSV report to a file and forwards every call to the console reporter.
+ *
+ * The host has no cycle counter that follows the core clock, so cycles are
+ * wall time times the nominal clock Google Benchmark detected; ns_per_iter
+ * is the column to compare against the target.
+ */
+class CsvReporter : public benchmark::BenchmarkReporter {
+public:
+    CsvReporter(FILE *file, benchmark::BenchmarkReporter &display) : file_(file), display_(display) {}
+
+    bool ReportContext(const Context &context) override
+    {
+        cpu_mhz_ = context.cpu_info.cycles_per_second / 1e6;
+        fprintf(out(), "# BENCH_BEGIN target=linux cpu_mhz=%.0f\n", cpu_mhz_);
+        fprintf(out(), "name,arg,iterations,items,bytes,cycles,wall_us,cycles_per_iter,cycles_per_item,ns_per_iter\n");
+        return display_.ReportContext(context);
+    }
+
+    void ReportRuns(const std::vector<Run> &runs) override
+    {
+        display_.ReportRuns(runs);
+        for (const Run &run : runs) {
+            if (run.run_type != Run::RT_Iteration) {
+                continue;
+            }
+            if (skipped(run, 0)) {
+                ++skipped_;
+                continue;
+            }
+            ++ran_;
+            const std::string &args = run.run_name.args;
+            double iterations = static_cast<double>(run.iterations);
+            double items = counter(run, "items");
+            double wall_us = run.real_accumulated_time * 1e6;
+            double cycles = wall_us * cpu_mhz_;
+            fprintf(out(), "%s,%s,%" PRId64 ",%.0f,%.0f,%.0f,%.0f,%.2f,%.2f,%.2f\n", run.run_name.function_name.c_str(),
+                    args.empty() ? "0" : args.c_str(), static_cast<int64_t>(run.iterations), items,
+                    counter(run, "bytes"), cycles, wall_us, ratio(cycles, iterations),
+                    ratio(cycles, iterations * items), ratio(wall_us * 1000, iterations));
+        }
+    }
+
+    void Finalize() override
+    {
+        fprintf(out(), "# BENCH_END ran=%u skipped=%u failed=0\n", ran_, skipped_);
+        fflush(out());
+        display_.Finalize();
+    }
+
+private:
+    FILE *out() { return file_; }
+
+    FILE *file_;
+    benchmark::BenchmarkReporter &display_;
+    double cpu_mhz_ = 0;
+    unsigned ran_ = 0;
+    unsigned skipped_ = 0;
+};
+
+void run(BenchFn fn, benchmark::State &gb, int64_t arg)
+{
+    State state(gb, arg);
+    fn(state);
+    gb.counters["items"] = state.items_per_iteration();
+    gb.counters["bytes"] = state.bytes_per_iteration();
+    gb.SetItemsProcessed(static_cast<int64_t>(gb.iterations()) * state.items_per_iteration());
+    if (state.bytes_per_iteration() != 0) {
+        gb.SetBytesProcessed(static_cast<int64_t>(gb.iterations()) * state.bytes_per_iteration());
+    }
+}
+
+void register_all(uint32_t iterations_override)
+{
+    for (const Case *c = s_head; c != nullptr; c = c->next) {
+        BenchFn fn = c->fn;
+        benchmark::internal::Benchmark *b;
+        if (c->arg_count == 0) {
+            b = benchmark::RegisterBenchmark(c->name, [fn](benchmark::State &gb) { run(fn, gb, 0); });
+        } else {
+            b = benchmark::RegisterBenchmark(c->name, [fn](benchmark::State &gb) { run(fn, gb, gb.range(0)); });
+            for (size_t i = 0; i < c->arg_count; ++i) {
+                b->Arg(c->args[i]);
+            }
+        }
+        b->Iterations(iterations_override != 0 ? iterations_override : c->iterations);
+    }
+}
+
+} // namespace
+
+Case::Case(const char *name, BenchFn fn, uint32_t iterations, const int64_t *args, size_t arg_count)
+    : name(name), fn(fn), iterations(iterations), args(args), arg_count(arg_count), next(nullptr)
+{
+    if (s_tail == nullptr) {
+        s_head = this;
+    } else {
+        s_tail->next = this;
+    }
+    s_tail = this;
+}
+
+const Case *first_case()
+{
+    return s_head;
+}
+
+} // namespace perf_bench
+
+/*
+ * Google Benchmark's own flags plus:
+ *   --perf_bench_output=<file>      CSV report (default: PERF_BENCH_OUTPUT, bench_output.txt)
+ *   --perf_bench_iterations=<n>     run every case n times instead of its registered count
+ */
+int main(int argc, char **argv)
+{
+    const char *output = PERF_BENCH_OUTPUT;
+    uint32_t iterations = 0;
+    std::vector<char *> args;
+    for (int i = 0; i < argc; ++i) {
+        if (strncmp(argv[i], "--perf_bench_output=", 20) == 0) {
+            output = argv[i] + 20;
+        } else if (strncmp(argv[i], "--perf_bench_iterations=", 24) == 0) {
+            iterations = static_cast<uint32_t>(strtoul(argv[i] + 24, nullptr, 10));
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) {
+        return 1;
+    }
+
+    FILE *file = fopen(output, "w");
+    if (file == nullptr) {
+        fprintf(stderr, "perf_bench: cannot write %s\n", output);
+        return 1;
+    }
+    perf_bench::register_all(iterations);
+    /* The console shows Google Benchmark's table; the CSV goes to the file. */
+    benchmark::ConsoleReporter console(isatty(STDOUT_FILENO) ? benchmark::ConsoleReporter::OO_ColorTabular
+                                                             : benchmark::ConsoleReporter::OO_Tabular);
+    perf_bench::CsvReporter csv(file, console);
+    benchmark::RunSpecifiedBenchmarks(&csv);
+    benchmark::Shutdown();
+    fclose(file);
+    fprintf(stderr, "perf_bench: wrote %s\n", output);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+typedef uint32_t esp_cpu_cycle_count_t;
+
+/* The time-stamp counter where there is one; it ticks at a constant rate
+ * rather than with the core clock. */
+static inline esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (esp_cpu_cycle_count_t)__builtin_ia32_rdtsc();
+#else
+    uint64_t t;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return (esp_cpu_cycle_count_t)t;
+#endif
+}
+
+/* The core the calling task was pinned to, as xPortGetCoreID() has it. */
+static inline int esp_cpu_get_core_id(void)
+{
+    return (int)xPortGetCoreID();
+}
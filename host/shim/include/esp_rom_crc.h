@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same results as the ROM functions, so host-written data matches the target's. */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
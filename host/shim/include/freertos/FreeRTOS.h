@@ -0,0 +1,61 @@
+/*
+ * FreeRTOS API subset on POSIX threads: tasks are detached threads with a
+ * notification word of their own, queues and semaphores are mutex/condvar
+ * ring buffers, critical sections are spinlocks and a tick is 1 ms of
+ * CLOCK_MONOTONIC. Priorities and core affinity are recorded and reported
+ * back but not enforced; the host scheduler places the threads.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef struct QueueDefinition *QueueHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffu)
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define configMAX_PRIORITIES 25
+#define configMAX_TASK_NAME_LEN 16
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY 0x7fffffff
+
+typedef struct {
+    volatile uint32_t owner;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+BaseType_t xPortGetCoreID(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define portENTER_CRITICAL(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux) vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+#define xPortInIsrContext() pdFALSE
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "freertos/queue.h"
+
+/* As in FreeRTOS, a semaphore is a queue of zero-sized items. */
+typedef QueueHandle_t SemaphoreHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define xSemaphoreTake(sem, timeout) xQueueReceive(sem, NULL, timeout)
+#define xSemaphoreGive(sem) xQueueSend(sem, NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) xQueueSendFromISR(sem, NULL, woken)
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
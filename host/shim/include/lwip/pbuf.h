@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef uint16_t u16_t;
+
+/* The fields telemetry_enc's PbufOutput walks; no pool behind it. */
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Shrink the chain to @p size bytes; the buffers themselves stay with their owner. */
+void pbuf_realloc(struct pbuf *p, u16_t size);
+
+#ifdef __cplusplus
+}
+#endif
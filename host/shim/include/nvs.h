@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* No NVS on the host: opening fails and the cases comparing against it skip. */
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+static inline esp_err_t nvs_open(const char *, nvs_open_mode_t, nvs_handle_t *)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t nvs_set_blob(nvs_handle_t, const char *, const void *, size_t)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t nvs_commit(nvs_handle_t)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline esp_err_t nvs_erase_all(nvs_handle_t)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static inline void nvs_close(nvs_handle_t) {}
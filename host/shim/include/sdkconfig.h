@@ -0,0 +1,13 @@
+/* Host build configuration: Kconfig defaults of the components built here,
+ * minus the target-only options (PIE kernels). */
+#pragma once
+
+#define CONFIG_IDF_TARGET "linux"
+#define CONFIG_IDF_TARGET_LINUX 1
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LF_RING_CACHE_LINE_SIZE 64
+#define CONFIG_MEM_POOL_STATS 1
+#define CONFIG_EXECUTOR_JOB_SIZE 64
+#define CONFIG_EXECUTOR_DEQUE_CAPACITY 256
+#define CONFIG_EXECUTOR_INJECT_CAPACITY 32
@@ -0,0 +1,74 @@
+#include <chrono>
+
+#include "esp_err.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+namespace {
+
+const auto boot = std::chrono::steady_clock::now();
+
+} // namespace
+
+extern "C" {
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot).count();
+}
+
+/* Reflected CRC-32 (0xEDB88320) and CRC-16/CCITT (0x8408), both inverted in
+ * and out like the ROM's _le variants. Bitwise: the host has cycles to spare. */
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; ++i) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+uint16_t esp_rom_crc16_le(uint16_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = static_cast<uint16_t>(~crc);
+    for (uint32_t i = 0; i < len; ++i) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint16_t>((crc >> 1) ^ (0x8408u & (0u - (crc & 1))));
+        }
+    }
+    return static_cast<uint16_t>(~crc);
+}
+
+} // extern "C"
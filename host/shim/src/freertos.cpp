@@ -0,0 +1,324 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct tskTaskControlBlock {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t value = 0;
+    bool pending = false;
+    UBaseType_t priority = 1;
+    BaseType_t core = 0;
+};
+
+struct QueueDefinition {
+    std::mutex lock;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    size_t item_size;
+    size_t length;
+    size_t head = 0;
+    size_t count = 0;
+    std::vector<uint8_t> items;
+};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/* Threads that were not created through xTaskCreate (main, benchmark
+ * threads) get a control block on first use that lives as long as they do. */
+thread_local tskTaskControlBlock *current = nullptr;
+thread_local tskTaskControlBlock adopted;
+
+tskTaskControlBlock *self()
+{
+    return current != nullptr ? current : &adopted;
+}
+
+/* Deadline for a FreeRTOS timeout; false for portMAX_DELAY (wait forever). */
+bool deadline_of(TickType_t timeout, Clock::time_point *deadline)
+{
+    if (timeout == portMAX_DELAY) {
+        return false;
+    }
+    *deadline = Clock::now() + std::chrono::milliseconds(uint64_t{timeout} * portTICK_PERIOD_MS);
+    return true;
+}
+
+template <typename Pred>
+bool wait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t timeout, Pred ready)
+{
+    Clock::time_point deadline;
+    if (!deadline_of(timeout, &deadline)) {
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_until(lock, deadline, ready);
+}
+
+struct Start {
+    TaskFunction_t fn;
+    void *arg;
+    tskTaskControlBlock *task;
+};
+
+const Clock::time_point boot = Clock::now();
+
+} // namespace
+
+extern "C" {
+
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    while (__atomic_exchange_n(&mux->owner, 1, __ATOMIC_ACQUIRE) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+    __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+    return self()->core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *, uint32_t, void *arg, UBaseType_t priority,
+                                   TaskHandle_t *created, BaseType_t core)
+{
+    auto *task = new tskTaskControlBlock;
+    task->priority = priority;
+    task->core = core == tskNO_AFFINITY ? 0 : core;
+    if (created != nullptr) {
+        *created = task;
+    }
+    Start start = {fn, arg, task};
+    std::thread([start] {
+        current = start.task;
+        start.fn(start.arg);
+        current = nullptr;
+        delete start.task;
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, priority, created, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    /* The thread ends when the task function returns, right after this. */
+    if (task != nullptr && task != self()) {
+        fprintf(stderr, "vTaskDelete: deleting another task is not supported on the host\n");
+        abort();
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0) {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(uint64_t{ticks} * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - boot).count();
+    return static_cast<TickType_t>(ms / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return self();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+    return (task != nullptr ? task : self())->priority;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    std::lock_guard<std::mutex> guard(task->lock);
+    switch (action) {
+    case eNoAction:
+        break;
+    case eSetBits:
+        task->value |= value;
+        break;
+    case eIncrement:
+        ++task->value;
+        break;
+    case eSetValueWithOverwrite:
+        task->value = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->pending) {
+            return pdFAIL;
+        }
+        task->value = value;
+        break;
+    }
+    task->pending = true;
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *woken)
+{
+    if (woken != nullptr) {
+        *woken = pdFALSE;
+    }
+    return xTaskNotify(task, value, action);
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    return xTaskNotify(task, 0, eIncrement);
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyFromISR(task, 0, eIncrement, woken);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t timeout)
+{
+    tskTaskControlBlock *task = self();
+    std::unique_lock<std::mutex> lock(task->lock);
+    wait(task->cv, lock, timeout, [task] { return task->value != 0; });
+    uint32_t value = task->value;
+    if (value != 0) {
+        task->value = clear_on_exit ? 0 : value - 1;
+    }
+    task->pending = false;
+    return value;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t timeout)
+{
+    tskTaskControlBlock *task = self();
+    std::unique_lock<std::mutex> lock(task->lock);
+    if (!task->pending) {
+        task->value &= ~clear_on_entry;
+    }
+    bool notified = wait(task->cv, lock, timeout, [task] { return task->pending; });
+    if (value != nullptr) {
+        *value = task->value;
+    }
+    if (!notified) {
+        return pdFALSE;
+    }
+    task->value &= ~clear_on_exit;
+    task->pending = false;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyValueClear(TaskHandle_t task, uint32_t bits)
+{
+    task = task != nullptr ? task : self();
+    std::lock_guard<std::mutex> guard(task->lock);
+    uint32_t value = task->value;
+    task->value &= ~bits;
+    return value;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (length == 0) {
+        return nullptr;
+    }
+    auto *queue = new QueueDefinition;
+    queue->item_size = item_size;
+    queue->length = length;
+    queue->items.resize(size_t{length} * item_size);
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    QueueHandle_t queue = xQueueCreate(max_count, 0);
+    if (queue != nullptr) {
+        queue->count = initial_count;
+    }
+    return queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!wait(queue->not_full, lock, timeout, [queue] { return queue->count < queue->length; })) {
+        return pdFAIL;
+    }
+    if (queue->item_size != 0) {
+        size_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(&queue->items[tail * queue->item_size], item, queue->item_size);
+    }
+    ++queue->count;
+    queue->not_empty.notify_one();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *woken)
+{
+    if (woken != nullptr) {
+        *woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if (!wait(queue->not_empty, lock, timeout, [queue] { return queue->count != 0; })) {
+        return pdFAIL;
+    }
+    if (queue->item_size != 0) {
+        memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    --queue->count;
+    queue->not_full.notify_one();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return static_cast<UBaseType_t>(queue->count);
+}
+
+} // extern "C"
@@ -0,0 +1,106 @@
+#include <cstring>
+#include <vector>
+
+#include "esp_partition.h"
+
+namespace {
+
+constexpr uint32_t sector_size = 4096;
+
+struct Partition {
+    esp_partition_t info;
+    std::vector<uint8_t> flash;
+};
+
+/* The data partitions of bench/partitions.csv that the host cases use, erased at start-up. */
+Partition *table()
+{
+    static Partition partitions[] = {
+        {{ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, 0, 0x40000, sector_size, "tsdata", false, false}, {}},
+    };
+    static const bool erased = [] {
+        for (Partition &p : partitions) {
+            p.flash.assign(p.info.size, 0xff);
+        }
+        return true;
+    }();
+    (void)erased;
+    return partitions;
+}
+
+constexpr size_t partition_count = 1;
+
+Partition *find(const esp_partition_t *partition)
+{
+    Partition *partitions = table();
+    for (size_t i = 0; i < partition_count; ++i) {
+        if (&partitions[i].info == partition) {
+            return &partitions[i];
+        }
+    }
+    return nullptr;
+}
+
+bool in_range(const Partition *p, size_t offset, size_t size)
+{
+    return p != nullptr && offset <= p->info.size && size <= p->info.size - offset;
+}
+
+} // namespace
+
+extern "C" {
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    Partition *partitions = table();
+    for (size_t i = 0; i < partition_count; ++i) {
+        const esp_partition_t &info = partitions[i].info;
+        if ((type == ESP_PARTITION_TYPE_ANY || type == info.type) &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || subtype == info.subtype) &&
+            (label == nullptr || strcmp(label, info.label) == 0)) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size)
+{
+    Partition *p = find(partition);
+    if (!in_range(p, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, p->flash.data() + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size)
+{
+    Partition *p = find(partition);
+    if (!in_range(p, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    /* NOR flash: programming can only clear bits. */
+    const auto *in = static_cast<const uint8_t *>(src);
+    uint8_t *out = p->flash.data() + dst_offset;
+    for (size_t i = 0; i < size; ++i) {
+        out[i] &= in[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    Partition *p = find(partition);
+    if (!in_range(p, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset % sector_size != 0 || size % sector_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(p->flash.data() + offset, 0xff, size);
+    return ESP_OK;
+}
+
+} // extern "C"
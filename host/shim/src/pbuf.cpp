@@ -0,0 +1,15 @@
+#include "lwip/pbuf.h"
+
+extern "C" void pbuf_realloc(struct pbuf *p, u16_t size)
+{
+    u16_t left = size;
+    for (; p != nullptr; p = p->next) {
+        p->tot_len = left;
+        if (left <= p->len) {
+            p->len = left;
+            p->next = nullptr;
+            return;
+        }
+        left = static_cast<u16_t>(left - p->len);
+    }
+}
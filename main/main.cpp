@@ -0,0 +1,8 @@
+#include "esp_log.h"
+
+static const char *TAG = "main";
+
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "started");
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Extract the perf_bench CSV report from a console log into bench_output.txt.
+
+The bench app prints::
+
+    BENCH_BEGIN target=esp32s3 cpu_mhz=240
+    BENCH,name,arg,iterations,...
+    BENCH,bench_memcpy,256,10000,...
+    BENCH_END ran=12 skipped=0 failed=0
+
+Everything between the markers is written (without the ``BENCH,`` prefix) to
+``bench_output.txt`` at the repository root. Input is read from stdin, a log
+file, or a serial port, and echoed to stdout so this can sit at the end of a
+monitor/QEMU pipe:
+
+    idf.py -C bench qemu | tools/bench_capture.py
+    tools/bench_capture.py --port /dev/ttyUSB0
+    tools/bench_capture.py build.log
+"""
+
+import argparse
+import os
+import re
+import sys
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+DEFAULT_OUTPUT = os.path.join(REPO_ROOT, 'bench_output.txt')
+
+ANSI_ESCAPE = re.compile(r'\x1b\[[0-9;]*m')
+
+
+def serial_lines(port, baud):
+    import serial  # provided by the ESP-IDF Python environment
+
+    with serial.Serial(port, baud, timeout=1) as ser:
+        while True:
+            raw = ser.readline()
+            if raw:
+                yield raw.decode('utf-8', errors='replace')
+
+
+def file_lines(path):
+    if path == '-':
+        yield from sys.stdin
+        return
+    with open(path, encoding='utf-8', errors='replace') as f:
+        yield from f
+
+
+def capture(lines, echo):
+    """Return (header, rows, footer) for the first complete BENCH_BEGIN..BENCH_END block."""
+    header = None
+    rows = []
+    for line in lines:
+        if echo:
+            sys.stdout.write(line)
+        line = ANSI_ESCAPE.sub('', line).strip()
+        if line.startswith('BENCH_BEGIN'):
+            header = line
+            rows = []
+        elif header is None:
+            continue
+        elif line.startswith('BENCH_END'):
+            return header, rows, line
+        elif line.startswith('BENCH,'):
+            rows.append(line[len('BENCH,'):])
+    if header is not None:
+        raise SystemExit('bench_capture: log ended before BENCH_END (crash or reset?)')
+    raise SystemExit('bench_capture: no BENCH_BEGIN marker found')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', default='-', help='log file to parse (default: stdin)')
+    parser.add_argument('--port', help='read from this serial port instead of a file')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('-o', '--output', default=DEFAULT_OUTPUT)
+    parser.add_argument('-q', '--quiet', action='store_true', help='do not echo the log')
+    args = parser.parse_args()
+
+    lines = serial_lines(args.port, args.baud) if args.port else file_lines(args.log)
+    header, rows, footer = capture(lines, echo=not args.quiet)
+
+    with open(args.output, 'w', encoding='utf-8') as out:
+        out.write('# ' + header + '\n')
+        for row in rows:
+            out.write(row + '\n')
+        out.write('# ' + footer + '\n')
+    print('bench_capture: wrote {} rows to {}'.format(max(len(rows) - 1, 0), args.output), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
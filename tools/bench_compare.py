@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Cross-check an on-target perf_bench report against a host run.
+
+Both inputs are perf_bench CSV reports: one captured from the bench app by
+tools/bench_capture.py, one written by the host build (host/CMakeLists.txt).
+Cases present in both are lined up by name and argument, and the target/host
+time ratio is printed for each::
+
+    idf.py -C bench flash monitor | tools/bench_capture.py -o build/bench_target.txt
+    cmake --build build/host --target bench
+    tools/bench_compare.py build/bench_target.txt bench_output.txt
+
+A target is uniformly slower than a workstation, so the ratios cluster
+around one value. A case whose ratio is more than --tolerance times away from
+the median is flagged: its cost on the target comes from something the host
+does not model (flash cache misses, PSRAM, SIMD paths, interrupts) or the
+two builds no longer measure the same thing.
+"""
+
+import argparse
+import csv
+import statistics
+import sys
+
+
+def read_report(path):
+    """(header comment, {(name, arg): row}) of a perf_bench CSV report."""
+    header = ''
+    rows = {}
+    try:
+        with open(path, encoding='utf-8') as f:
+            lines = [line for line in f if line.strip()]
+    except OSError as e:
+        sys.exit('bench_compare: {}'.format(e))
+    body = []
+    for line in lines:
+        if line.startswith('# BENCH_BEGIN'):
+            header = line[2:].strip()
+        elif not line.startswith('#'):
+            body.append(line)
+    for row in csv.DictReader(body):
+        rows[(row['name'], row['arg'])] = row
+    if not rows:
+        sys.exit('bench_compare: {} has no benchmark rows'.format(path))
+    return header, rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('target', help='report captured on the target')
+    parser.add_argument('host', help='report of the host build')
+    parser.add_argument('--column', default='ns_per_iter', help='column to compare (default: ns_per_iter)')
+    parser.add_argument('--tolerance', type=float, default=2.0,
+                        help='flag ratios this many times off the median (default: 2)')
+    args = parser.parse_args()
+
+    target_header, target = read_report(args.target)
+    host_header, host = read_report(args.host)
+    common = [key for key in target if key in host]
+    if not common:
+        sys.exit('bench_compare: the reports have no case in common')
+
+    ratios = {}
+    for key in common:
+        try:
+            t = float(target[key][args.column])
+            h = float(host[key][args.column])
+        except (KeyError, ValueError):
+            sys.exit('bench_compare: no numeric column {!r}'.format(args.column))
+        if t > 0 and h > 0:
+            ratios[key] = (t, h, t / h)
+    if not ratios:
+        sys.exit('bench_compare: no case has a non-zero {} in both reports'.format(args.column))
+    median = statistics.median(r for _, _, r in ratios.values())
+
+    print('target: {}'.format(target_header or args.target))
+    print('host:   {}'.format(host_header or args.host))
+    print('{:<40} {:>8} {:>14} {:>14} {:>9}'.format('case', 'arg', 'target', 'host', 'ratio'))
+    flagged = 0
+    for key in common:
+        if key not in ratios:
+            continue
+        t, h, r = ratios[key]
+        off = r / median if r >= median else median / r
+        mark = ' !' if off > args.tolerance else ''
+        flagged += bool(mark)
+        print('{:<40} {:>8} {:>14.2f} {:>14.2f} {:>8.1f}x{}'.format(key[0], key[1], t, h, r, mark))
+    print('median ratio {:.1f}x; {} of {} cases more than {:g}x off it'.format(median, flagged, len(ratios),
+                                                                                 args.tolerance))
+    only_target = len(target) - len(common)
+    only_host = len(host) - len(common)
+    if only_target or only_host:
+        print('{} cases only on the target, {} only on the host'.format(only_target, only_host))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""Decode bin_log frames into ESP_LOG-style text.
+
+The target sends only call-site addresses and raw argument values; the
+formats, argument types and tags are read back from the ELF file of the
+firmware that produced the stream. See
+components/bin_log/include/bin_log/format.hpp for the layout, which must be
+kept in sync with this tool::
+
+    tools/bin_log_decode.py build/app.elf capture.bin
+    tools/bin_log_decode.py build/app.elf /dev/ttyUSB1     # port set raw, e.g. stty -F /dev/ttyUSB1 raw 921600
+
+Input is read as it arrives, so a serial device or a pipe can be followed
+live; corrupt bytes are skipped up to the next frame.
+"""
+
+import argparse
+import hashlib
+import os
+import re
+import struct
+import sys
+import zlib
+
+FRAME_MAGIC = 0x31474c42  # "BLG1"
+FRAME_VERSION = 1
+FRAME = struct.Struct('<IHxxQII4sI')
+RECORD_HEADER_WORDS = 4
+LEVELS = 'NEWIDV'
+SPEC = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcsp%])')
+
+
+class Elf:
+    """Reads NUL-terminated strings and pointers at target addresses."""
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[5] != 1:
+            sys.exit('%s: not a little-endian ELF file' % path)
+        self.pointer = struct.Struct('<I' if self.data[4] == 1 else '<Q')
+        if self.data[4] == 1:
+            shoff, = struct.unpack_from('<I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2e)
+            section = struct.Struct('<IIIIIIIIII')
+        else:
+            shoff, = struct.unpack_from('<Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x3a)
+            section = struct.Struct('<IIQQQQIIQQ')
+        self.sections = []
+        for i in range(shnum):
+            _, kind, flags, addr, offset, size = section.unpack_from(self.data, shoff + i * shentsize)[:6]
+            # Allocated sections with contents (SHT_PROGBITS): rodata and initialized data.
+            if kind == 1 and flags & 2 and size:
+                self.sections.append((addr, offset, size))
+        self.sha256_prefix = hashlib.sha256(self.data).digest()[:4]
+        self.sites = {}
+
+    def offset(self, address, length):
+        for addr, offset, size in self.sections:
+            if addr <= address and address + length <= addr + size:
+                return offset + address - addr
+        return None
+
+    def string(self, address):
+        if address == 0:
+            return None
+        at = self.offset(address, 1)
+        if at is None:
+            return '<bad string 0x%x>' % address
+        return self.data[at:self.data.index(b'\0', at)].decode('utf-8', 'replace')
+
+    def site(self, address):
+        """(format, types) of the Site at address."""
+        if address not in self.sites:
+            at = self.offset(address, 2 * self.pointer.size)
+            if at is None:
+                self.sites[address] = None
+            else:
+                fmt, types = (self.pointer.unpack_from(self.data, at + i * self.pointer.size)[0] for i in range(2))
+                self.sites[address] = (self.string(fmt), self.string(types) or '')
+        return self.sites[address]
+
+
+def read_args(types, words):
+    """Raw argument values per type code; None if the record is malformed."""
+    args = []
+    at = 0
+    try:
+        for code in types:
+            if code == 'w':
+                args.append(('w', words[at]))
+                at += 1
+            elif code == 'q':
+                args.append(('q', words[at] | words[at + 1] << 32))
+                at += 2
+            elif code == 'f':
+                args.append(('f', struct.unpack('<f', struct.pack('<I', words[at]))[0]))
+                at += 1
+            elif code == 'd':
+                args.append(('d', struct.unpack('<d', struct.pack('<II', words[at], words[at + 1]))[0]))
+                at += 2
+            elif code == 's':
+                length = words[at]
+                count = (length + 3) // 4
+                raw = struct.pack('<%dI' % count, *words[at + 1:at + 1 + count])[:length]
+                if len(raw) != length:
+                    return None
+                args.append(('s', raw.decode('utf-8', 'replace')))
+                at += 1 + count
+            else:
+                return None
+    except IndexError:
+        return None
+    return args
+
+
+def as_int(arg, signed, length):
+    kind, value = arg
+    if kind in 'fd':
+        return int(value)
+    if kind == 's':
+        return 0
+    bits = 64 if kind == 'q' or length in ('ll', 'j') else 32
+    value &= (1 << bits) - 1
+    if signed and value >> (bits - 1):
+        value -= 1 << bits
+    return value
+
+
+def format_c(fmt, args):
+    """printf() with already-decoded arguments."""
+    values = iter(args)
+
+    def take():
+        return next(values, None)
+
+    def convert(match):
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == '%':
+            return '%'
+        if width == '*':
+            arg = take()
+            width = str(as_int(arg, True, None)) if arg else ''
+        if precision == '*':
+            arg = take()
+            precision = str(as_int(arg, True, None)) if arg else ''
+        spec = '%' + flags + (width or '') + ('.' + precision if precision is not None else '')
+        arg = take()
+        if arg is None:
+            return '<missing>'
+        if conversion in 'di':
+            return (spec + 'd') % as_int(arg, True, length)
+        if conversion in 'ouxX':
+            return (spec + ('d' if conversion == 'u' else conversion)) % as_int(arg, False, length)
+        if conversion == 'c':
+            return (spec + 'c') % chr(as_int(arg, False, length) & 0xff)
+        if conversion == 'p':
+            return (spec.replace('#', '') + 's') % ('0x%x' % as_int(arg, False, length))
+        if conversion == 's':
+            return (spec + 's') % (arg[1] if arg[0] == 's' else '0x%x' % arg[1])
+        value = float(arg[1]) if arg[0] in 'fd' else float(as_int(arg, True, length))
+        return (spec + conversion.replace('F', 'f').replace('a', 'e').replace('A', 'E')) % value
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode_record(elf, words, frame_time):
+    header, site_address, timestamp, tag = words[:RECORD_HEADER_WORDS]
+    level = LEVELS[(header >> 8) & 7] if (header >> 8) & 7 < len(LEVELS) else '?'
+    # Records precede the frame: step back from its 64-bit time by the 32-bit difference.
+    time_us = frame_time - ((frame_time - timestamp) & 0xffffffff)
+    site = elf.site(site_address)
+    if site is None:
+        message = '<unknown call site 0x%08x>' % site_address
+    else:
+        fmt, types = site
+        args = read_args(types, words[RECORD_HEADER_WORDS:])
+        message = '<malformed record for "%s">' % fmt if args is None else format_c(fmt, args)
+    return '%s (%d) %s: %s' % (level, time_us // 1000, elf.string(tag) or '-', message)
+
+
+def decode_frames(elf, chunks, out):
+    buffer = bytearray()
+    warned = False
+    for chunk in chunks:
+        buffer += chunk
+        while True:
+            start = buffer.find(struct.pack('<I', FRAME_MAGIC))
+            if start < 0:
+                del buffer[:max(0, len(buffer) - 3)]
+                break
+            del buffer[:start]
+            if len(buffer) < FRAME.size:
+                break
+            magic, version, time_us, payload_len, dropped, sha, crc = FRAME.unpack_from(buffer)
+            if version != FRAME_VERSION or payload_len % 4 or payload_len > 1 << 20:
+                del buffer[:1]
+                continue
+            if len(buffer) < FRAME.size + payload_len:
+                break
+            payload = bytes(buffer[FRAME.size:FRAME.size + payload_len])
+            if zlib.crc32(payload, zlib.crc32(bytes(buffer[:FRAME.size - 4]))) != crc:
+                del buffer[:1]
+                continue
+            del buffer[:FRAME.size + payload_len]
+            if sha != elf.sha256_prefix and not warned:
+                out.write('warning: stream is from an ELF with SHA-256 %s..., not this one (%s...)\n' %
+                          (sha.hex(), elf.sha256_prefix.hex()))
+                warned = True
+            words = struct.unpack('<%dI' % (payload_len // 4), payload)
+            at = 0
+            while at < len(words):
+                count = words[at] & 0xff
+                if count < RECORD_HEADER_WORDS or at + count > len(words):
+                    out.write('<corrupt record>\n')
+                    break
+                out.write(decode_record(elf, words[at:at + count], time_us) + '\n')
+                at += count
+            if dropped:
+                out.write('W (%d) bin_log: %d records dropped, rings full\n' % (time_us // 1000, dropped))
+            out.flush()
+
+
+def read_chunks(path):
+    fd = sys.stdin.fileno() if path == '-' else os.open(path, os.O_RDONLY)
+    while True:
+        chunk = os.read(fd, 65536)
+        if not chunk:
+            return
+        yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('elf', help='ELF file of the firmware that logged the stream')
+    parser.add_argument('input', nargs='?', default='-', help='captured stream, serial device or - for stdin')
+    args = parser.parse_args()
+
+    try:
+        decode_frames(Elf(args.elf), read_chunks(args.input), sys.stdout)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
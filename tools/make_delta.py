@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""Build a delta OTA patch for the delta_ota component.
+
+The patch rebuilds NEW from OLD, the image the device is running, with
+bsdiff-style diff/extra records; see
+components/delta_ota/include/delta_ota/format.hpp for the layout, which must
+be kept in sync with this tool. The body is heatshrink-compressed unless
+``--no-compress`` is given::
+
+    tools/make_delta.py old/app.bin build/app.bin -o app.patch
+    tools/make_delta.py --full build/app.bin -o app.patch     # compressed full image
+    tools/make_delta.py --apply old/app.bin app.patch -o check.bin
+
+``--apply`` runs the same decoder as the device, as a check before the patch
+is published.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+import zlib
+
+MAGIC = 0x31544f44  # "DOT1"
+VERSION = 1
+COMPRESSION_NONE = 0
+COMPRESSION_HEATSHRINK = 1
+# heatshrink sizes the updater accepts (delta_ota/format.hpp).
+MIN_WINDOW_BITS = 4
+MAX_WINDOW_BITS = 15
+MIN_LOOKAHEAD_BITS = 3
+HEADER = struct.Struct('<IHBBB3xII32s32s')
+HEADER_CRC = struct.Struct('<I')
+
+SEED = 8
+# Give up extending a match after this many bytes without improving it.
+GIVE_UP = 32
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return value * 2 if value >= 0 else -value * 2 - 1
+
+
+def extend(old, o, new, n):
+    """Length of the approximate match of new[n:] against old[o:], scored like bsdiff."""
+    limit = min(len(old) - o, len(new) - n)
+    matched = best_matched = best_length = k = 0
+    while k < limit:
+        if k + 64 <= limit and old[o + k:o + k + 64] == new[n + k:n + k + 64]:
+            k += 64
+            matched += 64
+        else:
+            if old[o + k] == new[n + k]:
+                matched += 1
+            k += 1
+            if k - best_length > GIVE_UP and 2 * matched - k <= 2 * best_matched - best_length:
+                break
+        if 2 * matched - k > 2 * best_matched - best_length:
+            best_matched, best_length = matched, k
+    return best_length
+
+
+def find_matches(old, new):
+    index = {}
+    for i in range(len(old) - SEED + 1):
+        index.setdefault(old[i:i + SEED], i)
+    matches = []
+    i = 0
+    predicted = 0
+    while i + SEED <= len(new):
+        seed = new[i:i + SEED]
+        if 0 <= predicted <= len(old) - SEED and old[predicted:predicted + SEED] == seed:
+            candidate = predicted
+        else:
+            candidate = index.get(seed)
+        if candidate is None:
+            i += 1
+            predicted += 1
+            continue
+        length = extend(old, candidate, new, i)
+        if length < SEED:
+            i += 1
+            predicted += 1
+            continue
+        matches.append((i, candidate, length))
+        i += length
+        predicted = candidate + length
+    return matches
+
+
+def diff(old, new):
+    """Control records: (diff bytes, extra bytes, adjust)."""
+    matches = find_matches(old, new)
+    records = []
+    if not matches or matches[0][0] != 0:
+        first_new = matches[0][0] if matches else len(new)
+        first_old = matches[0][1] if matches else 0
+        records.append((b'', new[:first_new], first_old))
+    for j, (n, o, length) in enumerate(matches):
+        delta = bytes((a - b) & 0xff for a, b in zip(new[n:n + length], old[o:o + length]))
+        if j + 1 < len(matches):
+            next_new, next_old, _ = matches[j + 1]
+        else:
+            next_new, next_old = len(new), o + length
+        records.append((delta, new[n + length:next_new], next_old - (o + length)))
+    return records
+
+
+def encode(records):
+    body = bytearray()
+    for delta, extra, adjust in records:
+        body += varint(len(delta)) + varint(len(extra)) + varint(zigzag(adjust))
+        body += delta + extra
+    return bytes(body)
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.count = 0
+
+    def put(self, value, bits):
+        self.acc = self.acc << bits | value
+        self.count += bits
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append(self.acc >> self.count & 0xff)
+        self.acc &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count:
+            self.out.append(self.acc << (8 - self.count) & 0xff)
+        return bytes(self.out)
+
+
+def match_length(data, p, i, limit):
+    lo, hi = 0, limit
+    while lo < hi:
+        mid = (lo + hi + 1) // 2
+        if data[p:p + mid] == data[i:i + mid]:
+            lo = mid
+        else:
+            hi = mid - 1
+    return lo
+
+
+def heatshrink_compress(data, window_bits, lookahead_bits, chain=32):
+    window = 1 << window_bits
+    max_length = 1 << lookahead_bits
+    # A back-reference costs 1 + W + L bits against 9 per literal.
+    min_length = (1 + window_bits + lookahead_bits) // 9 + 1
+    chains = {}
+    out = BitWriter()
+    i = 0
+    while i < len(data):
+        best_length = best_distance = 0
+        key = data[i:i + 3]
+        limit = min(max_length, len(data) - i)
+        if len(key) == 3:
+            for p in reversed(chains.get(key, ())[-chain:]):
+                if i - p > window:
+                    break
+                length = match_length(data, p, i, limit)
+                if length > best_length:
+                    best_length, best_distance = length, i - p
+                    if length == limit:
+                        break
+        step = best_length if best_length >= min_length else 1
+        if step > 1:
+            out.put(0, 1)
+            out.put(best_distance - 1, window_bits)
+            out.put(best_length - 1, lookahead_bits)
+        else:
+            out.put(0x100 | data[i], 9)
+        for k in range(i, i + step):
+            chains.setdefault(data[k:k + 3], []).append(k)
+        i += step
+    return out.finish()
+
+
+def heatshrink_decompress(data, window_bits, lookahead_bits):
+    out = bytearray()
+    position = 0
+    remaining = len(data) * 8
+
+    def take(n):
+        nonlocal position, remaining
+        value = 0
+        for _ in range(n):
+            value = value << 1 | data[position >> 3] >> (7 - (position & 7)) & 1
+            position += 1
+        remaining -= n
+        return value
+
+    # The encoder pads the last byte with fewer zero bits than the shortest
+    # token, which is a back-reference when 1 + window + lookahead < 9.
+    shortest = min(9, 1 + window_bits + lookahead_bits)
+    while remaining >= shortest:
+        if take(1):
+            if remaining < 8:
+                break
+            out.append(take(8))
+            continue
+        if remaining < window_bits + lookahead_bits:
+            break
+        distance = take(window_bits) + 1
+        length = take(lookahead_bits) + 1
+        for _ in range(length):
+            out.append(out[-distance] if distance <= len(out) else 0)
+    return bytes(out)
+
+
+def make_patch(old, new, window_bits, lookahead_bits, compress):
+    body = encode(diff(old, new))
+    if compress:
+        packed = heatshrink_compress(body, window_bits, lookahead_bits)
+        # Already-compressed payloads can grow; the device reads either.
+        if len(packed) < len(body):
+            body = packed
+        else:
+            compress = False
+    header = HEADER.pack(MAGIC, VERSION, COMPRESSION_HEATSHRINK if compress else COMPRESSION_NONE, window_bits,
+                         lookahead_bits, len(old), len(new), hashlib.sha256(old).digest(),
+                         hashlib.sha256(new).digest())
+    return header + HEADER_CRC.pack(zlib.crc32(header)) + body
+
+
+def read_varint(body, pos):
+    value = shift = 0
+    while True:
+        byte = body[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def apply_patch(old, patch):
+    (magic, version, compression, window_bits, lookahead_bits, source_size, target_size, source_sha,
+     target_sha) = HEADER.unpack_from(patch)
+    if magic != MAGIC or version != VERSION:
+        sys.exit('not a version %d delta patch' % VERSION)
+    if HEADER_CRC.unpack_from(patch, HEADER.size)[0] != zlib.crc32(patch[:HEADER.size]):
+        sys.exit('header CRC mismatch')
+    if len(old) < source_size or hashlib.sha256(old[:source_size]).digest() != source_sha:
+        sys.exit('patch was made against a different source image')
+    body = patch[HEADER.size + HEADER_CRC.size:]
+    if compression == COMPRESSION_HEATSHRINK:
+        body = heatshrink_decompress(body, window_bits, lookahead_bits)
+    new = bytearray()
+    pos = at = 0
+    while len(new) < target_size:
+        diff_length, at = read_varint(body, at)
+        extra_length, at = read_varint(body, at)
+        adjust, at = read_varint(body, at)
+        new += bytes((a + b) & 0xff for a, b in zip(old[pos:pos + diff_length], body[at:at + diff_length]))
+        at += diff_length
+        new += body[at:at + extra_length]
+        at += extra_length
+        pos += diff_length + (adjust >> 1 ^ -(adjust & 1))
+    if len(new) != target_size or hashlib.sha256(new).digest() != target_sha:
+        sys.exit('rebuilt image does not match the target hash')
+    return bytes(new)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('images', nargs='+', help='OLD NEW, NEW with --full, or OLD PATCH with --apply')
+    parser.add_argument('-o', '--output', required=True, help='patch (or, with --apply, image) to write')
+    parser.add_argument('--full', action='store_true', help='patch against an empty source: a compressed full image')
+    parser.add_argument('--apply', action='store_true', help='apply PATCH to OLD and write the result')
+    parser.add_argument('--window', type=int, default=11, help='heatshrink window bits (default 11)')
+    parser.add_argument('--lookahead', type=int, default=8, help='heatshrink lookahead bits (default 8)')
+    parser.add_argument('--no-compress', action='store_true', help='store the records uncompressed')
+    args = parser.parse_args()
+
+    if not MIN_WINDOW_BITS <= args.window <= MAX_WINDOW_BITS or not MIN_LOOKAHEAD_BITS <= args.lookahead < args.window:
+        parser.error('need %d <= --window <= %d and %d <= --lookahead < --window' %
+                     (MIN_WINDOW_BITS, MAX_WINDOW_BITS, MIN_LOOKAHEAD_BITS))
+    expected = 1 if args.full else 2
+    if len(args.images) != expected:
+        parser.error('expected %d image arguments' % expected)
+    blobs = []
+    for path in args.images:
+        with open(path, 'rb') as f:
+            blobs.append(f.read())
+
+    if args.apply:
+        result = apply_patch(blobs[0], blobs[1])
+    else:
+        old, new = (b'', blobs[0]) if args.full else blobs
+        result = make_patch(old, new, args.window, args.lookahead, not args.no_compress)
+        print('%d -> %d bytes (%.1f%% of the target image)' % (len(new), len(result), 100.0 * len(result) / len(new)))
+    with open(args.output, 'wb') as f:
+        f.write(result)
+
+
+if __name__ == '__main__':
+    main()
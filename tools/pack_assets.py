@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Pack files into an asset bundle for the asset_store component.
+
+Directories are walked recursively and each file is stored under its path
+relative to that directory, with ``/`` separators; a ``NAME=PATH`` argument
+stores a single file under an explicit name::
+
+    tools/pack_assets.py -o build/assets.bin web/ ca.pem=certs/root_ca.pem
+    tools/pack_assets.py -o assets.bin --size 0xa0000 assets/
+    tools/pack_assets.py --list build/assets.bin
+
+The layout is described in components/asset_store/include/asset_store/format.hpp
+and must be kept in sync with it. With ``--size`` the image is padded with
+0xff to the partition size and the tool fails if the bundle does not fit.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x31425341  # "ASB1"
+VERSION = 1
+DATA_ALIGNMENT = 16
+HEADER = struct.Struct('<IHHIII12x')
+ENTRY = struct.Struct('<IIIIHH')
+
+
+def align(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def collect(inputs):
+    assets = {}
+    for arg in inputs:
+        if '=' in arg:
+            name, path = arg.split('=', 1)
+            sources = [(name, path)]
+        elif os.path.isdir(arg):
+            sources = []
+            for root, dirs, files in os.walk(arg):
+                dirs.sort()
+                for f in sorted(files):
+                    path = os.path.join(root, f)
+                    sources.append((os.path.relpath(path, arg).replace(os.sep, '/'), path))
+        else:
+            sources = [(os.path.basename(arg), arg)]
+        for name, path in sources:
+            encoded = name.encode('utf-8')
+            if not encoded or len(encoded) > 0xffff or b'\0' in encoded:
+                sys.exit('invalid asset name: %r' % name)
+            if encoded in assets:
+                sys.exit('duplicate asset name: %s' % name)
+            with open(path, 'rb') as f:
+                assets[encoded] = f.read()
+    return assets
+
+
+def pack(assets):
+    # Sorted bytewise, matching std::string_view comparison on the target.
+    names = sorted(assets)
+    table_end = HEADER.size + ENTRY.size * len(names)
+
+    pool = bytearray()
+    name_offsets = []
+    for name in names:
+        name_offsets.append(table_end + len(pool))
+        pool += name + b'\0'
+    index_size = table_end + len(pool)
+
+    data = bytearray()
+    entries = []
+    offset = align(index_size, DATA_ALIGNMENT)
+    for name, name_offset in zip(names, name_offsets):
+        blob = assets[name]
+        data += b'\0' * (offset - index_size - len(data))
+        entries.append(ENTRY.pack(name_offset, offset, len(blob), zlib.crc32(blob), len(name), 0))
+        data += blob + b'\0'
+        offset = align(index_size + len(data), DATA_ALIGNMENT)
+    bundle_size = index_size + len(data)
+
+    index = b''.join(entries) + bytes(pool)
+    header = HEADER.pack(MAGIC, VERSION, len(names), bundle_size, index_size, zlib.crc32(index))
+    return header + index + bytes(data)
+
+
+def list_bundle(path):
+    with open(path, 'rb') as f:
+        image = f.read()
+    magic, version, count, bundle_size, index_size, index_crc = HEADER.unpack_from(image)
+    if magic != MAGIC or version != VERSION:
+        sys.exit('%s: not a version %d asset bundle' % (path, VERSION))
+    if zlib.crc32(image[HEADER.size:index_size]) != index_crc:
+        sys.exit('%s: index CRC mismatch' % path)
+    for i in range(count):
+        name_offset, data_offset, size, crc, name_length, _ = ENTRY.unpack_from(image, HEADER.size + i * ENTRY.size)
+        name = image[name_offset:name_offset + name_length].decode('utf-8')
+        ok = zlib.crc32(image[data_offset:data_offset + size]) == crc
+        print('%8d  0x%06x  %s%s' % (size, data_offset, name, '' if ok else '  (CRC mismatch)'))
+    print('%d assets, %d bytes' % (count, bundle_size))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('inputs', nargs='*', help='directories, files, or NAME=PATH pairs')
+    parser.add_argument('-o', '--output', help='bundle image to write')
+    parser.add_argument('--size', type=lambda s: int(s, 0), help='partition size to pad to and check against')
+    parser.add_argument('--list', metavar='IMAGE', help='print the contents of an existing bundle and exit')
+    args = parser.parse_args()
+
+    if args.list:
+        list_bundle(args.list)
+        return
+    if not args.output:
+        parser.error('--output is required')
+
+    image = pack(collect(args.inputs))
+    if args.size is not None:
+        if len(image) > args.size:
+            sys.exit('bundle is %d bytes, partition only %d' % (len(image), args.size))
+        image += b'\xff' * (args.size - len(image))
+    with open(args.output, 'wb') as f:
+        f.write(image)
+
+
+if __name__ == '__main__':
+    main()
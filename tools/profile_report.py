@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Turn a profiler dump into a hot-spot table and folded stacks.
+
+The dump comes from ``profiler::dump()`` on the console or from the HTTP
+route added with ``profiler::add_http_route()``::
+
+    tools/profile_report.py monitor.log
+    tools/profile_report.py --url http://192.168.4.1/profile
+    tools/profile_report.py --port /dev/ttyUSB0 --folded profile.folded
+
+The table lists every probe sorted by self time, with call counts and the
+mean and percentiles estimated from the log2 cycle histograms (so they are
+accurate to within a factor of two; min and max are exact). Per-core rows
+are merged unless --per-core is given.
+
+--folded writes one ``root;parent;probe <self cycles>`` line per probe, the
+input format of flamegraph.pl, inferno and speedscope. Stacks follow the
+parent each probe recorded first, so a probe called from several places
+appears under one of them only.
+"""
+
+import argparse
+import re
+import sys
+
+ANSI_ESCAPE = re.compile(r'\x1b\[[0-9;]*m')
+HEADER = re.compile(r'# profiler v(\d+)(.*)')
+
+
+class Probe:
+    def __init__(self, name, parent):
+        self.name = name
+        self.parent = parent
+        self.count = 0
+        self.total = 0
+        self.self_ = 0
+        self.min = None
+        self.max = 0
+        self.buckets = {}
+
+    def add(self, count, total, self_, lo, hi, buckets):
+        self.count += count
+        self.total += total
+        self.self_ += self_
+        self.min = lo if self.min is None else min(self.min, lo)
+        self.max = max(self.max, hi)
+        for index, n in buckets.items():
+            self.buckets[index] = self.buckets.get(index, 0) + n
+
+    def percentile(self, p):
+        """Cycles at percentile p, interpolated geometrically inside its bucket."""
+        if self.count == 0:
+            return 0
+        rank = p / 100.0 * self.count
+        seen = 0
+        for index in sorted(self.buckets):
+            n = self.buckets[index]
+            if seen + n >= rank:
+                if index == 0:
+                    return 0
+                lo = max(1 << (index - 1), self.min)
+                hi = max(min(1 << index, self.max), lo)
+                fraction = (rank - seen) / n
+                return lo * (hi / lo) ** fraction
+            seen += n
+        return self.max
+
+
+def serial_lines(port, baud):
+    import serial  # provided by the ESP-IDF Python environment
+
+    with serial.Serial(port, baud, timeout=1) as ser:
+        while True:
+            raw = ser.readline()
+            if raw:
+                yield raw.decode('utf-8', errors='replace')
+
+
+def url_lines(url):
+    from urllib.request import urlopen
+
+    with urlopen(url, timeout=10) as response:
+        for raw in response:
+            yield raw.decode('utf-8', errors='replace')
+
+
+def file_lines(path):
+    if path == '-':
+        yield from sys.stdin
+        return
+    with open(path, encoding='utf-8', errors='replace') as f:
+        yield from f
+
+
+def parse(lines, per_core):
+    """Return (attributes, probes) for the last complete dump in the input."""
+    attributes = None
+    probes = {}
+    complete = None
+    for line in lines:
+        line = ANSI_ESCAPE.sub('', line).rstrip('\r\n')
+        match = HEADER.match(line)
+        if match:
+            if match.group(1) != '1':
+                raise SystemExit('profile_report: unsupported dump version ' + match.group(1))
+            attributes = dict(kv.split('=', 1) for kv in match.group(2).split() if '=' in kv)
+            probes = {}
+            continue
+        if attributes is None or line.startswith('# core'):
+            continue
+        if line == '# end':
+            complete = (attributes, probes)
+            attributes = None
+            continue
+        fields = line.split('\t')
+        if len(fields) != 9:
+            continue
+        core, name, parent = fields[0], fields[1], fields[2]
+        key = (name, core) if per_core else name
+        probe = probes.get(key)
+        if probe is None:
+            probe = probes[key] = Probe(name, None if parent == '-' else parent)
+            probe.core = core
+        buckets = {}
+        for pair in filter(None, fields[8].split(',')):
+            index, n = pair.split(':')
+            buckets[int(index)] = int(n)
+        probe.add(int(fields[3]), int(fields[4]), int(fields[5]), int(fields[6]), int(fields[7]), buckets)
+    if complete is None:
+        raise SystemExit('profile_report: no complete dump ("# profiler v1" ... "# end") found')
+    return complete
+
+
+def stack_of(probe, by_name):
+    names = [probe.name]
+    seen = {probe.name}
+    parent = probe.parent
+    while parent is not None and parent not in seen:
+        names.append(parent)
+        seen.add(parent)
+        parent = by_name[parent].parent if parent in by_name else None
+    return ';'.join(reversed(names))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('log', nargs='?', default='-', help='log file to parse (default: stdin)')
+    parser.add_argument('--port', help='read from this serial port instead of a file')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--url', help='fetch the dump from this URL instead of a file')
+    parser.add_argument('--per-core', action='store_true', help='one row per probe and core')
+    parser.add_argument('--folded', help='write folded stacks of self cycles to this file')
+    parser.add_argument('--cycles', action='store_true', help='report cycles instead of microseconds')
+    args = parser.parse_args()
+
+    if args.url:
+        lines = url_lines(args.url)
+    elif args.port:
+        lines = serial_lines(args.port, args.baud)
+    else:
+        lines = file_lines(args.log)
+    attributes, probes = parse(lines, args.per_core)
+
+    mhz = float(attributes.get('cpu_mhz', 0)) or None
+    unit = 'cyc' if args.cycles or mhz is None else 'us'
+
+    def scaled(cycles):
+        return cycles if unit == 'cyc' else cycles / mhz
+
+    rows = sorted(probes.values(), key=lambda p: p.self_, reverse=True)
+    all_self = sum(p.self_ for p in rows) or 1
+    name_width = max([len('probe')] + [len(p.name) + (4 if args.per_core else 0) for p in rows])
+    columns = ('calls', 'self%', 'self', 'total', 'mean', 'p50', 'p90', 'p99', 'max')
+    print('{}  target={} cores={} cpu_mhz={}  (times in {})'.format(
+        'profile', attributes.get('target', '?'), attributes.get('cores', '?'), attributes.get('cpu_mhz', '?'), unit))
+    print('{:<{w}} '.format('probe', w=name_width) + ' '.join('{:>10}'.format(c) for c in columns))
+    for p in rows:
+        label = p.name + (' @' + p.core if args.per_core else '')
+        values = (
+            '{:d}'.format(p.count),
+            '{:.1f}'.format(100.0 * p.self_ / all_self),
+            '{:.0f}'.format(scaled(p.self_)),
+            '{:.0f}'.format(scaled(p.total)),
+            '{:.2f}'.format(scaled(p.total / p.count if p.count else 0)),
+            '{:.2f}'.format(scaled(p.percentile(50))),
+            '{:.2f}'.format(scaled(p.percentile(90))),
+            '{:.2f}'.format(scaled(p.percentile(99))),
+            '{:.2f}'.format(scaled(p.max)),
+        )
+        print('{:<{w}} '.format(label, w=name_width) + ' '.join('{:>10}'.format(v) for v in values))
+
+    if args.folded:
+        by_name = {p.name: p for p in probes.values()}
+        stacks = {}
+        for p in probes.values():
+            stack = stack_of(p, by_name)
+            stacks[stack] = stacks.get(stack, 0) + p.self_
+        with open(args.folded, 'w', encoding='utf-8') as out:
+            for stack in sorted(stacks):
+                if stacks[stack] > 0:
+                    out.write('{} {}\n'.format(stack, stacks[stack]))
+        print('profile_report: wrote {} stacks to {}'.format(len(stacks), args.folded), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()